@@ -12,6 +12,8 @@ dirs["source"] 			= os.realpath(dirs.root .. "Source/")
 dirs["dependencies"]	= os.realpath(dirs.root .. "Dependencies/")
 dirs["external"]		= os.realpath(dirs.root .. "Source/External/")
 dirs["engine"]			= os.realpath(dirs.root .. "Source/Engine")
+dirs["asset_packer"]	= os.realpath(dirs.root .. "Source/AssetPacker")
+dirs["engine_tests"]	= os.realpath(dirs.root .. "Source/EngineTests")
 dirs["settings"]		= os.realpath(dirs.root .. "Bin/settings/")
 dirs["engine_assets"] 	= os.realpath(dirs.root .. "EngineAssets/")
 
@@ -0,0 +1,51 @@
+include "../../Premake/common.lua"
+
+project "AssetPacker"
+	location (dirs.projectfiles)
+	dependson { "Engine" }
+
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++17"
+
+	debugdir "%{dirs.bin}"
+	targetdir ("%{dirs.bin}")
+	targetname("%{prj.name}_%{cfg.buildcfg}")
+	objdir ("%{dirs.temp}/%{prj.name}/%{cfg.buildcfg}")
+
+	links {"Engine"}
+
+	includedirs { dirs.engine }
+
+	files {
+		"source/**.h",
+		"source/**.cpp",
+	}
+
+	filter "configurations:Debug"
+		defines {"_DEBUG"}
+		runtime "Debug"
+		symbols "on"
+	filter "configurations:Release"
+		defines "_RELEASE"
+		runtime "Release"
+		optimize "on"
+	filter "configurations:Retail"
+		defines "_RETAIL"
+		runtime "Release"
+		optimize "on"
+
+	filter "system:windows"
+		staticruntime "off"
+		symbols "On"
+		systemversion "latest"
+		warnings "Extra"
+		flags {
+			"FatalCompileWarnings",
+			"MultiProcessorCompile"
+		}
+
+		defines {
+			"WIN32",
+			"TGE_SYSTEM_WINDOWS"
+		}
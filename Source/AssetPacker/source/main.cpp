@@ -0,0 +1,68 @@
+#include <tge/filesystem/PackWriter.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cwchar>
+#include <string>
+
+namespace
+{
+	void PrintUsage()
+	{
+		printf("Packs a directory into one file the engine reads its assets from.\n\n");
+		printf("AssetPacker <directory> <pack> [--compress] [--align <bytes>]\n\n");
+		printf("  --compress       Compresses the files LZ4 makes at least 10%% smaller.\n");
+		printf("  --align <bytes>  Starts every file at a multiple of this power of two, 16 by default.\n\n");
+		printf("A pack named after an asset root and placed next to it, like EngineAssets.pack next to EngineAssets/,\n");
+		printf("is mounted at startup. Loose files in the root are still used over the packed ones.\n");
+	}
+}
+
+int wmain(int argc, wchar_t* argv[])
+{
+	std::wstring directory;
+	std::wstring packPath;
+	Tga::PackWriterSettings settings;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (wcscmp(argv[i], L"--compress") == 0)
+		{
+			settings.myCompress = true;
+		}
+		else if (wcscmp(argv[i], L"--align") == 0 && i + 1 < argc)
+		{
+			settings.myAlignment = static_cast<uint32_t>(wcstoul(argv[++i], nullptr, 10));
+		}
+		else if (directory.empty())
+		{
+			directory = argv[i];
+		}
+		else if (packPath.empty())
+		{
+			packPath = argv[i];
+		}
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	if (packPath.empty())
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	Tga::PackWriterReport report;
+	if (!Tga::PackWriter::PackDirectory(directory, packPath, settings, report))
+	{
+		fprintf(stderr, "Packing failed: %s\n", report.myError.c_str());
+		return 1;
+	}
+
+	printf("Packed %zu files, %zu of them compressed. %llu bytes stored in %llu.\n", report.myFileCount, report.myCompressedFileCount,
+		static_cast<unsigned long long>(report.mySize), static_cast<unsigned long long>(report.myStoredSize));
+	return 0;
+}
@@ -21,10 +21,12 @@
 
 #define MAX_MESHES_PER_MODEL 32
 
+// A model switches to a coarser LOD once the simplification error would cover less than this many pixels.
+// Lower it if LOD switches are visible, raise it to draw fewer triangles.
+#define DEFAULT_LOD_PIXEL_ERROR 1.0f
+
 // do not change these without updating common.hlsli
 #define NUMBER_OF_LIGHTS_ALLOWED 8
 #define MAX_ANIMATION_BONES 64
 #define USE_NOISE // If this is defined, a texture with perlin noise will be avalible in all shaders to play with
 #define USE_LIGHTS // If this is defined, the engine will calculate per pixel lightning using Light
-
-#define MAX_MODEL_INSTANCES 64
@@ -59,7 +59,7 @@ void AnimationPlayer::Update(float aDeltaTime)
 				const Quatf R = Quatf::Slerp(currentFrameJointXform.GetQuaternion(), nextFrameJointXform.GetQuaternion(), delta);
 				const Vector3f S = Vector3f::Lerp(currentFrameJointXform.GetScale(), nextFrameJointXform.GetScale(), delta);
 
-				jointXform = Matrix4x4f::CreateScaleMatrix(S) * R.GetRotationMatrix4x4f() * Matrix4x4f::CreateTranslationMatrix(T);
+				jointXform = Transform(T, R, S).GetMatrix();
 			}
 
 			Matrix4x4f Result = jointXform;
@@ -121,10 +121,10 @@ int CustomShapeDrawer::SetShaderParameters(CustomShape& aObject)
     }
     int tris = UpdateVertexes(aObject);
 
-    unsigned int strides = sizeof(SimpleVertex);
-    unsigned int offsets = 0;
-    DX11::Context->IASetVertexBuffers(0, 1, myVertexBuffer.GetAddressOf(), &strides, &offsets);
-    DX11::Context->VSSetConstantBuffers((int)ConstantBufferSlot::Object, 1, myObjectBuffer.GetAddressOf());
+    uint32_t strides = sizeof(SimpleVertex);
+    uint32_t offsets = 0;
+    myCommands.SetVertexBuffers(0, 1, myVertexBuffer.GetAddressOf(), &strides, &offsets);
+    myCommands.SetConstantBuffer(RenderStage_Vertex, (int)ConstantBufferSlot::Object, myObjectBuffer.Get());
     return tris;
 }
 
@@ -135,17 +135,8 @@ int CustomShapeDrawer::SetShaderParameters(CustomShape2D& aObject )
         return 0;
     }
 
-    D3D11_MAPPED_SUBRESOURCE mappedObjectResource;
-
-    HRESULT result = DX11::Context->Map( myObjectBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedObjectResource );
-    if( FAILED( result ) )
-    {
-        INFO_PRINT( "Error in rendering!" );
-        return 0;
-    }
-
     CustomShapeConstantBufferData* objectDataPtr;
-    objectDataPtr = (CustomShapeConstantBufferData*)mappedObjectResource.pData;
+    objectDataPtr = static_cast<CustomShapeConstantBufferData*>(myCommands.WriteBuffer(myObjectBuffer.Get(), sizeof(CustomShapeConstantBufferData)));
 
     Matrix2x2f scalingMatrix = Matrix2x2f::CreateScaleMatrix(aObject.GetSize());
     Matrix2x2f rotationMatrix = Matrix2x2f::CreateRotation(aObject.GetRotation());
@@ -163,8 +154,6 @@ int CustomShapeDrawer::SetShaderParameters(CustomShape2D& aObject )
         p.x   ,p.y   ,0,1,
     } * graphicsStateStack.GetTransform();
 
-    DX11::Context->Unmap( myObjectBuffer.Get(), 0 );
-
     return SetShaderParameters(static_cast<CustomShape&>(aObject));
 }
 
@@ -175,47 +164,33 @@ int CustomShapeDrawer::SetShaderParameters(CustomShape3D& aObject)
         return 0;
     }
 
-    D3D11_MAPPED_SUBRESOURCE mappedObjectResource;
-
-    HRESULT result = DX11::Context->Map(myObjectBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedObjectResource);
-    if (FAILED(result))
-    {
-        INFO_PRINT("Error in rendering!");
-        return 0;
-    }
-
     CustomShapeConstantBufferData* objectDataPtr;
-    objectDataPtr = (CustomShapeConstantBufferData*)mappedObjectResource.pData;
+    objectDataPtr = static_cast<CustomShapeConstantBufferData*>(myCommands.WriteBuffer(myObjectBuffer.Get(), sizeof(CustomShapeConstantBufferData)));
 
     GraphicsStateStack& graphicsStateStack = Tga::Engine::GetInstance()->GetGraphicsEngine().GetGraphicsStateStack();
     objectDataPtr->ModelToWorld = aObject.GetTransform().GetMatrix() * graphicsStateStack.GetTransform();
 
-    DX11::Context->Unmap(myObjectBuffer.Get(), 0);
-
     return SetShaderParameters(static_cast<CustomShape&>(aObject));
 }
 
 int CustomShapeDrawer::UpdateVertexes(CustomShape& aObject )
 {
-    D3D11_MAPPED_SUBRESOURCE mappedVertexResource;
-    SimpleVertex* dataVertexPtr;
-    HRESULT result = DX11::Context->Map( myVertexBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedVertexResource );
-    if( FAILED( result ) )
+    const size_t pointCount = std::min(aObject.myPoints.size(), static_cast<size_t>(myMaxPoints));
+    if (aObject.myPoints.size() > pointCount)
+    {
+        INFO_PRINT( "%s%i%s", "Customshape:Render - Too many points rendered at one custom shape! We support: ", myMaxPoints, " skipping the rest, increase this nuber in engine_defines.h" );
+    }
+    if (pointCount == 0)
     {
-        INFO_PRINT( "Error in rendering!" );
         return 0;
     }
 
-    dataVertexPtr = (SimpleVertex*)mappedVertexResource.pData;
+    SimpleVertex* dataVertexPtr = static_cast<SimpleVertex*>(myCommands.WriteBuffer(myVertexBuffer.Get(), sizeof(SimpleVertex) * pointCount));
 
     int index = 0;
-    for( SCustomPoint& point : aObject.myPoints )
+    for (size_t i = 0; i < pointCount; i++)
     {
-        if( index >= myMaxPoints )
-        {
-            INFO_PRINT( "%s%i%s", "Customshape:Render - Too many points rendered at one custom shape! We support: ", myMaxPoints, " skipping the rest, increase this nuber in engine_defines.h" );
-            continue;
-        }
+        const SCustomPoint& point = aObject.myPoints[i];
 
         dataVertexPtr[index].X = point.myPosition.x;
         dataVertexPtr[index].Y = point.myPosition.y;
@@ -233,40 +208,35 @@ int CustomShapeDrawer::UpdateVertexes(CustomShape& aObject )
         index++;
     }
 
-    DX11::Context->Unmap( myVertexBuffer.Get(), 0 );
     return index;
 }
 
 void Tga::CustomShapeDrawer::Draw( CustomShape2D& aObject )
 {
-	if (!PrepareRender())
+	if (!PrepareRender(myCommands))
 	{
 		return;
 	}
 
-    DX11::Context->IASetPrimitiveTopology( D3D10_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
-
     int tris = SetShaderParameters( aObject );
     if( tris > 0 && tris % 3 == 0 )
     {
-        DX11::LogDrawCall();
-        DX11::Context->Draw( tris, 0 );
+        myCommands.Draw( tris, 0 );
     }
+    SubmitCommands();
 }
 
 void Tga::CustomShapeDrawer::Draw(CustomShape3D& aObject)
 {
-    if (!PrepareRender())
+    if (!PrepareRender(myCommands))
     {
         return;
     }
 
-    DX11::Context->IASetPrimitiveTopology(D3D10_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
     int tris = SetShaderParameters(aObject);
     if (tris > 0 && tris % 3 == 0)
     {
-        DX11::LogDrawCall();
-        DX11::Context->Draw(tris, 0);
+        myCommands.Draw(tris, 0);
     }
+    SubmitCommands();
 }
@@ -3,6 +3,7 @@
 #include <tge/drawers/DebugDrawer.h>
 #include <tge/drawers/DebugPerformancegraph.h>
 #include <tge/drawers/LineDrawer.h>
+#include <tge/drawers/ModelDrawer.h>
 #include <tge/engine.h>
 #include <tge/primitives/LinePrimitive.h>
 #include <tge/text/Text.h>
@@ -41,8 +42,6 @@ DebugDrawer::~DebugDrawer(void)
 
 void DebugDrawer::Init()
 {
-	myLineBuffer = std::make_unique<std::array<LinePrimitive, myMaxLines>>();
-
 	myFPS = std::make_unique<Tga::Text>(L"Text/arial.ttf", FontSize_24);
 	myFPS->SetText("--");
 	myFPS->SetColor({ 1, 1, 1, 1.0f });
@@ -200,6 +199,19 @@ void DebugDrawer::Update(float aTimeDelta)
 	mem.append("Kb (");
 	mem.append(std::to_string(memUsedMb));
 	mem.append("Mb)");
+
+	const TextureMemoryStatistics& textures = Engine::GetInstance()->GetTextureManager().GetStatistics();
+	mem.append("  Textures: ");
+	mem.append(std::to_string(textures.ResidentBytes / 1024 / 1024));
+	mem.append(" / ");
+	mem.append(std::to_string(textures.BudgetBytes / 1024 / 1024));
+	mem.append("Mb (");
+	mem.append(std::to_string(textures.ResidentCount));
+	mem.append(" resident, ");
+	mem.append(std::to_string(textures.EvictedCount));
+	mem.append(" evicted, ");
+	mem.append(std::to_string(textures.StreamingCount));
+	mem.append(" streaming)");
 	myMemUsage->SetText(mem);
 
 	static FILETIME prevSysKernel, prevSysUser;
@@ -309,6 +321,27 @@ void DebugDrawer::Render()
 		drawCalls.append("DrawCalls: ");
 		int objCount = DX11::GetPreviousDrawCallCount();
 		drawCalls.append(std::to_string(objCount));
+
+		const ModelCullingStatistics& culling = Engine::GetInstance()->GetGraphicsEngine().GetModelDrawer().GetPreviousCullingStatistics();
+		if (culling.TestedInstances > 0)
+		{
+			drawCalls.append("  Models: ");
+			drawCalls.append(std::to_string(culling.VisibleInstances));
+			drawCalls.append(" / ");
+			drawCalls.append(std::to_string(culling.TestedInstances));
+			drawCalls.append(" visible");
+		}
+
+		const GraphicsStateStatistics& states = graphicsStateStack.GetPreviousStatistics();
+		drawCalls.append("  States: ");
+		drawCalls.append(std::to_string(states.StateBinds));
+		drawCalls.append(" (");
+		drawCalls.append(std::to_string(states.AvoidedStateBinds));
+		drawCalls.append(" avoided)  Uploads: ");
+		drawCalls.append(std::to_string(states.BufferUploads));
+		drawCalls.append(" (");
+		drawCalls.append(std::to_string(states.AvoidedBufferUploads));
+		drawCalls.append(" avoided)");
 		myDrawCallText->SetText(drawCalls);
 		myDrawCallText->SetColor({ 1, 1, 1, 1 });
 		/*
@@ -329,18 +362,19 @@ void DebugDrawer::Render()
 
 }
 
-void Tga::DebugDrawer::DrawLine(Vector2f aFrom, Vector2f aTo, Color aColor)
+void Tga::DebugDrawer::DrawLine(Vector2f aFrom, Vector2f aTo, Color aColor, float aLifetime)
 {
-	if (myNumberOfRenderedLines > myMaxLines)
-	{
-		return;
-	}
-	(*myLineBuffer)[myNumberOfRenderedLines].fromPosition = Vector3f(aFrom, 0.f);
-	(*myLineBuffer)[myNumberOfRenderedLines].toPosition = Vector3f(aTo, 0.f);
-	(*myLineBuffer)[myNumberOfRenderedLines].color = aColor.AsVec4();
-	myNumberOfRenderedLines++;
+	LineDrawer& lineDrawer = Tga::Engine::GetInstance()->GetGraphicsEngine().GetLineDrawer();
+	lineDrawer.Submit(Vector3f(aFrom, 0.f), Vector3f(aTo, 0.f), aColor, aLifetime);
+}
 
-	DrawPendingDebugLines();
+void Tga::DebugDrawer::DrawBox(Vector2f aMin, Vector2f aMax, Color aColor, float aLifetime)
+{
+	LineDrawer& lineDrawer = Tga::Engine::GetInstance()->GetGraphicsEngine().GetLineDrawer();
+	lineDrawer.Submit(Vector3f(aMin.x, aMin.y, 0.f), Vector3f(aMax.x, aMin.y, 0.f), aColor, aLifetime);
+	lineDrawer.Submit(Vector3f(aMax.x, aMin.y, 0.f), Vector3f(aMax.x, aMax.y, 0.f), aColor, aLifetime);
+	lineDrawer.Submit(Vector3f(aMax.x, aMax.y, 0.f), Vector3f(aMin.x, aMax.y, 0.f), aColor, aLifetime);
+	lineDrawer.Submit(Vector3f(aMin.x, aMax.y, 0.f), Vector3f(aMin.x, aMin.y, 0.f), aColor, aLifetime);
 }
 
 void Tga::DebugDrawer::ShowErrorImage()
@@ -348,67 +382,25 @@ void Tga::DebugDrawer::ShowErrorImage()
 	myShowErrorTimer = 4.0f;
 }
 
-void DebugDrawer::DrawCircle(Vector2f aPos, float aRadius, Color aColor)
+void DebugDrawer::DrawCircle(Vector2f aPos, float aRadius, Color aColor, float aLifetime)
 {
 	const short circleResolution = 32;
 
-	struct MultiLine
-	{
-		void Zero()
-		{
-			ZeroMemory(colors, sizeof(Color) * 256);
-			ZeroMemory(fromPositions, sizeof(Vector2f) * 256);
-			ZeroMemory(toPositions, sizeof(Vector2f) * 256);
-		}
-		Color colors[256];
-		Vector3f fromPositions[256];
-		Vector3f toPositions[256];
-	};
-
-	MultiLine computedLineBuffer;
-	computedLineBuffer.Zero();
-
-	Vector3f to;
-	bool first = false;
-	int currentCount = 0;
-	for (int i = 0; i < circleResolution+1; i++)
+	LineDrawer& lineDrawer = Tga::Engine::GetInstance()->GetGraphicsEngine().GetLineDrawer();
+
+	Vector3f from(aRadius + aPos.x, aPos.y, 0.f);
+	for (int i = 1; i < circleResolution + 1; i++)
 	{
 		float angle = 2.0f * 3.14f * static_cast<float>(i) / static_cast<float>(circleResolution);
-		
-		if (!first)
-		{
-			first = true;
-			to = Vector3f( aRadius*cos(angle) + aPos.x, aRadius*sin(angle) + aPos.y, 0.f);
-			continue;
-		}
-
-		computedLineBuffer.colors[currentCount] = aColor;
-		computedLineBuffer.fromPositions[currentCount] = to;
-		computedLineBuffer.toPositions[currentCount] = Vector3f(aRadius*cos(angle) + aPos.x, aRadius*sin(angle) + aPos.y, 0.f);
+		Vector3f to(aRadius * cos(angle) + aPos.x, aRadius * sin(angle) + aPos.y, 0.f);
 
-		to = computedLineBuffer.toPositions[currentCount];
-		currentCount++;		
+		lineDrawer.Submit(from, to, aColor, aLifetime);
+		from = to;
 	}
-
-	LineMultiPrimitive multiLine;
-
-	multiLine.colors = computedLineBuffer.colors;
-	multiLine.fromPositions = computedLineBuffer.fromPositions;
-	multiLine.toPositions = computedLineBuffer.toPositions;
-	multiLine.count = currentCount;
-
-	LineDrawer& lineDrawer = Tga::Engine::GetInstance()->GetGraphicsEngine().GetLineDrawer();
-
-	lineDrawer.Draw(multiLine);
 }
 
-void DebugDrawer::DrawArrow(Vector2f aFrom, Vector2f aTo, Color aColor, float aArrowHeadSize)
+void DebugDrawer::DrawArrow(Vector2f aFrom, Vector2f aTo, Color aColor, float aArrowHeadSize, float aLifetime)
 {
-	if (myNumberOfRenderedLines+3 > myMaxLines)
-	{
-		return;
-	}
-
 	Vector2f direction = aTo - aFrom;
 	direction = direction.Normalize();
 
@@ -416,31 +408,9 @@ void DebugDrawer::DrawArrow(Vector2f aFrom, Vector2f aTo, Color aColor, float aA
 
 	Vector2f theNormal = direction.Normal();
 
-	(*myLineBuffer)[myNumberOfRenderedLines].fromPosition = Vector3f(aFrom, 0.f);
-	(*myLineBuffer)[myNumberOfRenderedLines].toPosition = Vector3f(aTo, 0.f);
-	(*myLineBuffer)[myNumberOfRenderedLines].color = aColor.AsVec4();
-	myNumberOfRenderedLines++;
-
-	(*myLineBuffer)[myNumberOfRenderedLines].fromPosition = Vector3f(aTo, 0.f);
-	(*myLineBuffer)[myNumberOfRenderedLines].toPosition = Vector3f(aTo - direction + theNormal, 0.f);
-	(*myLineBuffer)[myNumberOfRenderedLines].color = aColor.AsVec4();
-	myNumberOfRenderedLines++;
-
-	(*myLineBuffer)[myNumberOfRenderedLines].fromPosition = Vector3f(aTo, 0.f);
-	(*myLineBuffer)[myNumberOfRenderedLines].toPosition = Vector3f(aTo - direction - theNormal, 0.f);
-	(*myLineBuffer)[myNumberOfRenderedLines].color = aColor.AsVec4();
-	myNumberOfRenderedLines++;
-
-	DrawPendingDebugLines();
-}
-
-void DebugDrawer::DrawPendingDebugLines()
-{
 	LineDrawer& lineDrawer = Tga::Engine::GetInstance()->GetGraphicsEngine().GetLineDrawer();
-	for (int i = 0; i < myNumberOfRenderedLines; i++)
-	{
-		lineDrawer.Draw((*myLineBuffer)[i]);
-	}
-	myNumberOfRenderedLines = 0;
+	lineDrawer.Submit(Vector3f(aFrom, 0.f), Vector3f(aTo, 0.f), aColor, aLifetime);
+	lineDrawer.Submit(Vector3f(aTo, 0.f), Vector3f(aTo - direction + theNormal, 0.f), aColor, aLifetime);
+	lineDrawer.Submit(Vector3f(aTo, 0.f), Vector3f(aTo - direction - theNormal, 0.f), aColor, aLifetime);
 }
 #endif _RETAIL
\ No newline at end of file
@@ -5,16 +5,19 @@
 #include <tge/math/vector4.h>
 #include <tge/math/color.h>
 
+// In _RETAIL builds these expand to nothing, so the arguments are never even evaluated.
 #ifndef _RETAIL
-#define DEBUG_DRAW_LINE(aFrom, aTo, aColor) Tga::DebugDrawer::DrawLine(aFrom, aTo, aColor);
-#define DEBUG_DRAW_LINES(aFrom, aTo, aColor, aCount) Tga::DebugDrawer::DrawLines(aFrom, aTo, aColor, aCount);
-#define DEBUG_DRAW_ARROW(aFrom, aTo, aColor, aArrowHeadSize) Tga::DebugDrawer::DrawArrow(aFrom, aTo, aColor, aArrowHeadSize);
-#define DEBUG_DRAW_CIRCLE(aFrom, aRadius, aColor) Tga::DebugDrawer::DrawCircle(aFrom, aRadius, aColor);
+#define DEBUG_DRAW_LINE(aFrom, aTo, aColor) Tga::Engine::GetInstance()->GetDebugDrawer().DrawLine(aFrom, aTo, aColor);
+#define DEBUG_DRAW_ARROW(aFrom, aTo, aColor, aArrowHeadSize) Tga::Engine::GetInstance()->GetDebugDrawer().DrawArrow(aFrom, aTo, aColor, aArrowHeadSize);
+#define DEBUG_DRAW_CIRCLE(aFrom, aRadius, aColor) Tga::Engine::GetInstance()->GetDebugDrawer().DrawCircle(aFrom, aRadius, aColor);
+#define DEBUG_DRAW_BOX(aMin, aMax, aColor) Tga::Engine::GetInstance()->GetDebugDrawer().DrawBox(aMin, aMax, aColor);
+#define DEBUG_DRAW_LINE_TIMED(aFrom, aTo, aColor, aLifetime) Tga::Engine::GetInstance()->GetDebugDrawer().DrawLine(aFrom, aTo, aColor, aLifetime);
 #else
 #define DEBUG_DRAW_LINE(aFrom, aTo, aColor)
-#define DEBUG_DRAW_LINES(aFrom, aTo, aColor, aCount)
 #define DEBUG_DRAW_ARROW(aFrom, aTo, aColor, aArrowHeadSize)
-#define DEBUG_DRAW_CIRCLE(aFrom, aRadius, aColor) 
+#define DEBUG_DRAW_CIRCLE(aFrom, aRadius, aColor)
+#define DEBUG_DRAW_BOX(aMin, aMax, aColor)
+#define DEBUG_DRAW_LINE_TIMED(aFrom, aTo, aColor, aLifetime)
 #endif
 
 #ifndef _RETAIL
@@ -35,19 +38,18 @@ namespace Tga
 		void Init();
 		void Update(float aTimeDelta);
 		void Render();
-		void DrawLine(Vector2f aFrom, Vector2f aTo, Color aColor = Color(1, 1, 1, 1));
-		void DrawArrow(Vector2f aFrom, Vector2f aTo, Color aColor = Color(1, 1, 1, 1), float aArrowHeadSize = 1.0f);
-		void DrawCircle(Vector2f aPos, float aRadius, Color aColor = Color(1, 1, 1, 1));
+
+		// Lines go to the line drawer's queue and are drawn together at the end of the frame. A lifetime in seconds
+		// keeps them on screen for that long, 0 draws them once.
+		void DrawLine(Vector2f aFrom, Vector2f aTo, Color aColor = Color(1, 1, 1, 1), float aLifetime = 0.0f);
+		void DrawArrow(Vector2f aFrom, Vector2f aTo, Color aColor = Color(1, 1, 1, 1), float aArrowHeadSize = 1.0f, float aLifetime = 0.0f);
+		void DrawCircle(Vector2f aPos, float aRadius, Color aColor = Color(1, 1, 1, 1), float aLifetime = 0.0f);
+		void DrawBox(Vector2f aMin, Vector2f aMax, Color aColor = Color(1, 1, 1, 1), float aLifetime = 0.0f);
 
 	private:
-		void DrawPendingDebugLines();
 		void ShowErrorImage();
 		double CalcAverageTick(int newtick);
 
-		int myNumberOfRenderedLines = 0;
-		static constexpr int myMaxLines = 10000;
-		std::unique_ptr<std::array<LinePrimitive, myMaxLines>> myLineBuffer = nullptr;
-
 		std::unique_ptr<Text> myFPS;
 		std::unique_ptr<Text> myMemUsage;
 		std::unique_ptr<Text> myDrawCallText;
@@ -78,12 +80,10 @@ namespace Tga
 		void Init() {}
 		void Update(float /*aTimeDelta*/) {}
 		void Render() {}
-		void DrawLine(Vector2f /*aFrom*/, Vector2f /*aTo*/, Vector4f /*aColor*/) {}
-		void DrawLines(Vector2f* /*aFrom*/, Vector2f* /*aTo*/, Color* /*aColor*/, unsigned int /*aCount*/) {}
-
-		void DrawArrow(Vector2f /*aFrom*/, Vector2f /*aTo*/, Vector4f /*aColor*/, float /*aArrowHeadSize*/) {}
-		static void DrawArrow(Vector2f /*aFrom*/, Vector2f /*aTo*/, Color aColor = Color(1, 1, 1, 1), float aArrowHeadSize = 1.0f) { aColor; aArrowHeadSize; }
-		void DrawCircle(Vector2f /*aPos*/, float /*aRadius*/, Color aColor = Color(1, 1, 1, 1)) { aColor; }
+		void DrawLine(Vector2f /*aFrom*/, Vector2f /*aTo*/, Color /*aColor*/ = Color(1, 1, 1, 1), float /*aLifetime*/ = 0.0f) {}
+		void DrawArrow(Vector2f /*aFrom*/, Vector2f /*aTo*/, Color /*aColor*/ = Color(1, 1, 1, 1), float /*aArrowHeadSize*/ = 1.0f, float /*aLifetime*/ = 0.0f) {}
+		void DrawCircle(Vector2f /*aPos*/, float /*aRadius*/, Color /*aColor*/ = Color(1, 1, 1, 1), float /*aLifetime*/ = 0.0f) {}
+		void DrawBox(Vector2f /*aMin*/, Vector2f /*aMax*/, Color /*aColor*/ = Color(1, 1, 1, 1), float /*aLifetime*/ = 0.0f) {}
 		void ShowErrorImage() {}
 	private:
 
@@ -1,5 +1,8 @@
 #include "stdafx.h"
 #include <tge/drawers/LineDrawer.h>
+
+#include <algorithm>
+#include <cstring>
 #include <tge/graphics/GraphicsEngine.h>
 #include <tge/graphics/DX11.h>
 #include <tge/render/RenderObject.h>
@@ -8,6 +11,36 @@
 #include <tge/primitives/LinePrimitive.h>
 
 using namespace Tga;
+
+namespace
+{
+	bool IsSameCamera(const Camera& aLeft, const Camera& aRight)
+	{
+		const Matrix4x4f leftTransform = aLeft.GetTransform().GetMatrix();
+		const Matrix4x4f rightTransform = aRight.GetTransform().GetMatrix();
+		float leftNear, leftFar, rightNear, rightFar;
+		aLeft.GetProjectionPlanes(leftNear, leftFar);
+		aRight.GetProjectionPlanes(rightNear, rightFar);
+
+		return std::memcmp(&leftTransform, &rightTransform, sizeof(Matrix4x4f)) == 0
+			&& std::memcmp(&aLeft.GetProjection(), &aRight.GetProjection(), sizeof(Matrix4x4f)) == 0
+			&& leftNear == rightNear && leftFar == rightFar;
+	}
+
+	void SetLineVertex(SimpleVertex& outVertex, const Vector3f& aPosition, const Color& aColor)
+	{
+		outVertex.X = aPosition.x;
+		outVertex.Y = aPosition.y;
+		outVertex.Z = aPosition.z;
+		outVertex.myColorR = aColor.myR;
+		outVertex.myColorG = aColor.myG;
+		outVertex.myColorB = aColor.myB;
+		outVertex.myColorA = aColor.myA;
+		outVertex.myU = 0.0f;
+		outVertex.myV = 0.0f;
+	}
+}
+
 LineDrawer::LineDrawer(Engine& anEngine)
 	: Shader(anEngine)
 {}
@@ -25,30 +58,16 @@ bool LineDrawer::Init()
 void LineDrawer::CreateBuffer()
 {
 	D3D11_BUFFER_DESC vertexBufferDesc;
-	D3D11_SUBRESOURCE_DATA vertexData;
-
-	float theZ = 0.0f;
-	myVertices[0].X = -0.5f;
-	myVertices[0].Y = 0.5f;
-	myVertices[0].Z = theZ;
-
-	myVertices[1].X = -0.5f;
-	myVertices[1].Y = -0.5f;
-	myVertices[1].Z = theZ;
-
 	ZeroMemory(&vertexBufferDesc, sizeof(vertexBufferDesc));
 
 	vertexBufferDesc.Usage = D3D11_USAGE_DYNAMIC;       
-	vertexBufferDesc.ByteWidth = sizeof(SimpleVertex) * 2000;        
+	vertexBufferDesc.ByteWidth = sizeof(SimpleVertex) * myVertexCapacity;
 	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 	vertexBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 	vertexBufferDesc.MiscFlags = 0;
 	vertexBufferDesc.StructureByteStride = 0;
 
-	// Give the subresource structure a pointer to the vertex data.
-	vertexData.pSysMem = myVertices;
-	vertexData.SysMemPitch = 0;
-	vertexData.SysMemSlicePitch = 0;
+	// No initial data, every draw writes its vertices through the command buffer.
 	HRESULT hr = DX11::Device->CreateBuffer(&vertexBufferDesc, nullptr, myVertexBuffer.ReleaseAndGetAddressOf());
 	if (FAILED(hr))
 	{
@@ -56,32 +75,32 @@ void LineDrawer::CreateBuffer()
 		return;
 	}
 
+	myRingVertex = 0;
+
 }
 
 void Tga::LineDrawer::Draw(LineMultiPrimitive& aObject)
 {
-	assert(aObject.count <= 1000 && "A single multi Primivive can only draw 1000 lines"); //1000 is a magic number I dont know why it limits there. Maybe buffer size to graphics card.
-
 	if (!myVertexBuffer)
 	{
 		return;
 	}
-	PrepareRender();
-	DX11::Context->IASetPrimitiveTopology(D3D10_PRIMITIVE_TOPOLOGY_LINELIST);
-
-	D3D11_MAPPED_SUBRESOURCE mappedVertexResource;
-	SimpleVertex* dataVertexPtr;
-	HRESULT result = DX11::Context->Map(myVertexBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedVertexResource);
-	if (FAILED(result))
+	if (!PrepareRender(myCommands))
 	{
-		INFO_PRINT("Error in rendering!");
 		return;
 	}
+	myCommands.SetTopology(RenderTopology::LineList);
 
 	GraphicsStateStack& graphicsStateStack = Tga::Engine::GetInstance()->GetGraphicsEngine().GetGraphicsStateStack();
 	Matrix4x4f transform = graphicsStateStack.GetTransform();
 
-	dataVertexPtr = (SimpleVertex*)mappedVertexResource.pData;
+	uint32_t startVertex = 0;
+	SimpleVertex* dataVertexPtr = ReserveVertices(aObject.count * 2, startVertex);
+	if (dataVertexPtr == nullptr)
+	{
+		myCommands.Clear();
+		return;
+	}
 	int theCount = 0;
 	for (unsigned int i = 0; i < aObject.count; i++)
 	{
@@ -108,16 +127,12 @@ void Tga::LineDrawer::Draw(LineMultiPrimitive& aObject)
 		theCount += 2;
 	}
 
-	
-	DX11::Context->Unmap(myVertexBuffer.Get(), 0);
-
+	uint32_t strides = sizeof(SimpleVertex);
+	uint32_t offsets = 0;
+	myCommands.SetVertexBuffers(0, 1, myVertexBuffer.GetAddressOf(), &strides, &offsets);
 
-	unsigned int strides = sizeof(SimpleVertex);
-	unsigned int offsets = 0;
-	DX11::Context->IASetVertexBuffers(0, 1, myVertexBuffer.GetAddressOf(), &strides, &offsets);
-
-	DX11::LogDrawCall();
-	DX11::Context->Draw(aObject.count * 2, 0);
+	myCommands.Draw(aObject.count * 2, startVertex);
+	SubmitCommands();
 }
 
 bool Tga::LineDrawer::InitShaders()
@@ -161,33 +176,32 @@ bool LineDrawer::CreateInputLayout(const std::string& aVS)
 	return true;
 }
 
-void LineDrawer::SetShaderParameters(LinePrimitive& aObject)
+bool LineDrawer::SetShaderParameters(LinePrimitive& aObject, uint32_t& outStartVertex)
 {
-	UpdateVertexes(aObject);
+	if (!UpdateVertexes(aObject, outStartVertex))
+	{
+		return false;
+	}
 
-	unsigned int strides = sizeof(SimpleVertex);
-	unsigned int offsets = 0;
-	DX11::Context->IASetVertexBuffers(0, 1, myVertexBuffer.GetAddressOf(), &strides, &offsets);
+	uint32_t strides = sizeof(SimpleVertex);
+	uint32_t offsets = 0;
+	myCommands.SetVertexBuffers(0, 1, myVertexBuffer.GetAddressOf(), &strides, &offsets);
+	return true;
 }
 
-void LineDrawer::UpdateVertexes(LinePrimitive& aObject)
+bool LineDrawer::UpdateVertexes(LinePrimitive& aObject, uint32_t& outStartVertex)
 {
-	D3D11_MAPPED_SUBRESOURCE mappedVertexResource;
-	SimpleVertex* dataVertexPtr;
-	HRESULT result = DX11::Context->Map(myVertexBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedVertexResource);
-	if(FAILED(result))
-	{
-		INFO_PRINT("Error in rendering!");
-		return;
-	}
-
 	GraphicsStateStack& graphicsStateStack = Tga::Engine::GetInstance()->GetGraphicsEngine().GetGraphicsStateStack();
 	Matrix4x4f transform = graphicsStateStack.GetTransform();
 
 	Vector3f fromPos = Vector4f(aObject.fromPosition, 1.f) * transform;
 	Vector3f toPos = Vector4f(aObject.toPosition, 1.f) * transform;
 
-	dataVertexPtr = (SimpleVertex*)mappedVertexResource.pData;
+	SimpleVertex* dataVertexPtr = ReserveVertices(2, outStartVertex);
+	if (dataVertexPtr == nullptr)
+	{
+		return false;
+	}
 
 	dataVertexPtr[0].X = fromPos.x;
 	dataVertexPtr[0].Y = fromPos.y;
@@ -207,16 +221,209 @@ void LineDrawer::UpdateVertexes(LinePrimitive& aObject)
 	dataVertexPtr[1].myColorG = aObject.color.y;
 	dataVertexPtr[1].myColorB = aObject.color.z;
 
-	DX11::Context->Unmap(myVertexBuffer.Get(), 0);
+	return true;
 }
 
 
 void LineDrawer::Draw(LinePrimitive& aObject)
 {
-	PrepareRender();
-	DX11::Context->IASetPrimitiveTopology(D3D10_PRIMITIVE_TOPOLOGY_LINELIST);
+	if (!myVertexBuffer)
+	{
+		return;
+	}
+	if (!PrepareRender(myCommands))
+	{
+		return;
+	}
+	myCommands.SetTopology(RenderTopology::LineList);
+
+	uint32_t startVertex = 0;
+	if (!SetShaderParameters(aObject, startVertex))
+	{
+		myCommands.Clear();
+		return;
+	}
+	myCommands.Draw(2, startVertex);
+	SubmitCommands();
+}
+
+void LineDrawer::Submit(const Vector3f& aFrom, const Vector3f& aTo, const Color& aColor, float aLifetime)
+{
+	if (!myIsQueueEnabled)
+		return;
+
+	const Matrix4x4f& transform = myGraphicsEngine->GetGraphicsStateStack().GetTransform();
+
+	LineBatch& batch = aLifetime > 0.0f ? GetBatch(myPersistentBatches, myPersistentBatchCount, false) : GetBatch(myQueuedBatches, myQueuedBatchCount, true);
+	const size_t first = batch.vertices.size();
+	batch.vertices.resize(first + 2);
+	SetLineVertex(batch.vertices[first], Vector4f(aFrom, 1.f) * transform, aColor);
+	SetLineVertex(batch.vertices[first + 1], Vector4f(aTo, 1.f) * transform, aColor);
+
+	if (aLifetime > 0.0f)
+	{
+		batch.timeLeft.push_back(aLifetime);
+	}
+}
+
+void LineDrawer::Submit(const LinePrimitive& aLine, float aLifetime)
+{
+	Submit(aLine.fromPosition, aLine.toPosition, Color(aLine.color.x, aLine.color.y, aLine.color.z, aLine.color.w), aLifetime);
+}
+
+void LineDrawer::Submit(const LineMultiPrimitive& someLines, float aLifetime)
+{
+	for (unsigned int i = 0; i < someLines.count; i++)
+	{
+		Submit(someLines.fromPositions[i], someLines.toPositions[i], someLines.colors[i], aLifetime);
+	}
+}
+
+LineDrawer::LineBatch& LineDrawer::GetBatch(std::vector<LineBatch>& someBatches, size_t& aBatchCount, bool anOnlyLast)
+{
+	const GraphicsStateStack& graphicsStateStack = myGraphicsEngine->GetGraphicsStateStack();
+	const Camera& camera = graphicsStateStack.GetCamera();
+	const DepthStencilState depthStencilState = graphicsStateStack.GetDepthStencilState();
+
+	// Queued lines keep their submission order, so only the last batch can be extended. Persistent lines are drawn
+	// in their own pass anyway and can go in any batch with the same state.
+	for (size_t i = anOnlyLast && aBatchCount > 0 ? aBatchCount - 1 : 0; i < aBatchCount; i++)
+	{
+		LineBatch& batch = someBatches[i];
+		if (batch.state.depthStencilState == depthStencilState && IsSameCamera(batch.state.camera, camera))
+			return batch;
+	}
+
+	// Batches past the count are left over from earlier frames and keep their allocations.
+	if (aBatchCount == someBatches.size())
+	{
+		someBatches.emplace_back();
+	}
+	LineBatch& batch = someBatches[aBatchCount++];
+	batch.state.camera = camera;
+	batch.state.depthStencilState = depthStencilState;
+	batch.vertices.clear();
+	batch.timeLeft.clear();
+	return batch;
+}
+
+void LineDrawer::FlushQueue(float aDeltaTime)
+{
+	for (size_t i = 0; i < myQueuedBatchCount; i++)
+	{
+		DrawBatch(myQueuedBatches[i]);
+	}
+	myQueuedBatchCount = 0;
+
+	for (size_t i = 0; i < myPersistentBatchCount;)
+	{
+		LineBatch& batch = myPersistentBatches[i];
+		DrawBatch(batch);
+
+		// Age after drawing, so every line is seen at least once. Expired lines are replaced by the last one.
+		size_t line = 0;
+		while (line < batch.timeLeft.size())
+		{
+			batch.timeLeft[line] -= aDeltaTime;
+			if (batch.timeLeft[line] > 0.0f)
+			{
+				line++;
+				continue;
+			}
+
+			const size_t last = batch.timeLeft.size() - 1;
+			batch.timeLeft[line] = batch.timeLeft[last];
+			batch.vertices[line * 2] = batch.vertices[last * 2];
+			batch.vertices[line * 2 + 1] = batch.vertices[last * 2 + 1];
+			batch.timeLeft.pop_back();
+			batch.vertices.resize(last * 2);
+		}
+
+		if (batch.timeLeft.empty())
+		{
+			std::swap(batch, myPersistentBatches[--myPersistentBatchCount]);
+			continue;
+		}
+		i++;
+	}
+}
+
+void LineDrawer::DrawBatch(const LineBatch& aBatch)
+{
+	if (aBatch.vertices.empty() || !myVertexBuffer)
+		return;
+
+	GraphicsStateStack& graphicsStateStack = myGraphicsEngine->GetGraphicsStateStack();
+	graphicsStateStack.Push();
+	graphicsStateStack.SetCamera(aBatch.state.camera);
+	graphicsStateStack.SetDepthStencilState(aBatch.state.depthStencilState);
+
+	if (PrepareRender(myCommands))
+	{
+		myCommands.SetTopology(RenderTopology::LineList);
+
+		uint32_t startVertex = 0;
+		const uint32_t vertexCount = static_cast<uint32_t>(aBatch.vertices.size());
+		if (SimpleVertex* vertices = ReserveVertices(vertexCount, startVertex))
+		{
+			memcpy(vertices, aBatch.vertices.data(), sizeof(SimpleVertex) * vertexCount);
+
+			uint32_t strides = sizeof(SimpleVertex);
+			uint32_t offsets = 0;
+			myCommands.SetVertexBuffers(0, 1, myVertexBuffer.GetAddressOf(), &strides, &offsets);
+			myCommands.Draw(vertexCount, startVertex);
+		}
+		SubmitCommands();
+	}
+
+	graphicsStateStack.Pop();
+}
+
+void LineDrawer::SetQueueEnabled(bool anIsEnabled)
+{
+	myIsQueueEnabled = anIsEnabled;
+	if (!anIsEnabled)
+	{
+		myQueuedBatchCount = 0;
+		myPersistentBatchCount = 0;
+	}
+}
+
+size_t LineDrawer::GetQueuedLineCount() const
+{
+	size_t count = 0;
+	for (size_t i = 0; i < myQueuedBatchCount; i++)
+	{
+		count += myQueuedBatches[i].vertices.size() / 2;
+	}
+	for (size_t i = 0; i < myPersistentBatchCount; i++)
+	{
+		count += myPersistentBatches[i].timeLeft.size();
+	}
+	return count;
+}
+
+SimpleVertex* LineDrawer::ReserveVertices(uint32_t aCount, uint32_t& outStartVertex)
+{
+	if (aCount > myVertexCapacity)
+	{
+		myVertexCapacity = std::max(myVertexCapacity * 2, aCount);
+		CreateBuffer();
+	}
+	if (!myVertexBuffer)
+	{
+		return nullptr;
+	}
+
+	// Nothing before myRingVertex is written again until the buffer is discarded, so the GPU never waits on it.
+	if (myRingVertex == 0 || myRingVertex + aCount > myVertexCapacity)
+	{
+		outStartVertex = 0;
+		myRingVertex = aCount;
+		return static_cast<SimpleVertex*>(myCommands.WriteBuffer(myVertexBuffer.Get(), sizeof(SimpleVertex) * aCount));
+	}
 
-	SetShaderParameters(aObject);
-	DX11::LogDrawCall();
-	DX11::Context->Draw(2, 0);
+	outStartVertex = myRingVertex;
+	myRingVertex += aCount;
+	return static_cast<SimpleVertex*>(myCommands.WriteBufferNoOverwrite(myVertexBuffer.Get(), sizeof(SimpleVertex) * aCount, sizeof(SimpleVertex) * outStartVertex));
 }
\ No newline at end of file
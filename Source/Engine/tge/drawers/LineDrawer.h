@@ -1,4 +1,6 @@
 #pragma once
+#include <vector>
+#include <tge/graphics/Camera.h>
 #include <tge/render/RenderCommon.h>
 #include <tge/shaders/Shader.h>
 
@@ -15,15 +17,75 @@ namespace Tga
         bool Init() override;
         void Draw(LinePrimitive& aObject);
 		void Draw(LineMultiPrimitive& aObject);
+
+		/**
+		 * Queues a line for the next FlushQueue instead of drawing it right away. The line is transformed by the graphics
+		 * state stack now and drawn with the camera and depth stencil state that are set now.
+		 * @param aLifetime Seconds the line stays on screen. 0 draws it in the next FlushQueue only.
+		 */
+		void Submit(const Vector3f& aFrom, const Vector3f& aTo, const Color& aColor, float aLifetime = 0.0f);
+		void Submit(const LinePrimitive& aLine, float aLifetime = 0.0f);
+		void Submit(const LineMultiPrimitive& someLines, float aLifetime = 0.0f);
+
+		/**
+		 * Draws everything queued, one draw per camera and depth stencil state that lines were submitted with, and ages
+		 * the lines that have a lifetime by aDeltaTime. Called by the engine at the end of every frame.
+		 */
+		void FlushQueue(float aDeltaTime);
+
+		/**
+		 * Turns Submit into a no-op and drops everything queued, so debug lines can stay in the code at no cost.
+		 */
+		void SetQueueEnabled(bool anIsEnabled);
+		bool IsQueueEnabled() const { return myIsQueueEnabled; }
+
+		size_t GetQueuedLineCount() const;
+
     private:
+		// The state queued lines are drawn with. Lines are only batched with others that share it.
+		struct LineState
+		{
+			Camera camera;
+			DepthStencilState depthStencilState;
+		};
+
+		struct LineBatch
+		{
+			LineState state;
+			// Two vertices per line, already transformed.
+			std::vector<SimpleVertex> vertices;
+			// Seconds left per line. Only used for lines with a lifetime.
+			std::vector<float> timeLeft;
+		};
+
         LineDrawer &operator =( const LineDrawer &anOther ) = delete;
         bool CreateInputLayout(const std::string& aVS) override;
         bool InitShaders();
         void CreateBuffer();
 
-        void SetShaderParameters(LinePrimitive& aObject);
-        void UpdateVertexes(LinePrimitive& aObject);
+        bool SetShaderParameters(LinePrimitive& aObject, uint32_t& outStartVertex);
+        bool UpdateVertexes(LinePrimitive& aObject, uint32_t& outStartVertex);
+
+		/**
+		 * Records a write of aCount vertices into the ring buffer and returns where to put them.
+		 * Grows the buffer if aCount doesn't fit at all.
+		 */
+		SimpleVertex* ReserveVertices(uint32_t aCount, uint32_t& outStartVertex);
+		LineBatch& GetBatch(std::vector<LineBatch>& someBatches, size_t& aBatchCount, bool anOnlyLast);
+		void DrawBatch(const LineBatch& aBatch);
+
         ComPtr<ID3D11Buffer> myVertexBuffer;
-        SimpleVertex myVertices[2] = {{},{}};
+
+		// Size of myVertexBuffer and where the next write goes. Writes go after each other without overwriting anything
+		// the GPU might still read, until the end is reached and the buffer is discarded.
+		uint32_t myVertexCapacity = 2000;
+		uint32_t myRingVertex = 0;
+
+		// Only the first count batches are in use, the rest keep their allocations for later frames.
+		std::vector<LineBatch> myQueuedBatches;
+		size_t myQueuedBatchCount = 0;
+		std::vector<LineBatch> myPersistentBatches;
+		size_t myPersistentBatchCount = 0;
+		bool myIsQueueEnabled = true;
     };
-}
\ No newline at end of file
+}
@@ -2,7 +2,10 @@
 
 #include <tge/drawers/ModelDrawer.h>
 #include <tge/shaders/ModelShader.h>
+#include <tge/graphics/Camera.h>
+#include <tge/graphics/Frustum.h>
 #include <tge/graphics/GraphicsEngine.h>
+#include <tge/graphics/GraphicsStateStack.h>
 #include <tge/graphics/DX11.h>
 #include <tge/engine.h>
 #include <tge/math/Matrix2x2.h>
@@ -10,11 +13,14 @@
 #include <tge/model/ModelInstance.h>
 
 #include <tge/model/ModelInstancer.h>
+#include <tge/render/RenderBackend.h>
 #include <tge/shaders/InstancedModelShader.h>
 
 using namespace Tga;
 
 constexpr size_t BATCH_SIZE = 1024;
+// Instances per recording job. Small enough to balance well, big enough that a job isn't mostly overhead.
+constexpr size_t RECORD_SLICE_SIZE = 64;
 
 ModelDrawer::ModelDrawer()
 {
@@ -56,9 +62,52 @@ bool ModelDrawer::Init()
 		return false;
 	}
 
+	myWorkerThreads.Init();
+
 	return true;
 }
 
+Frustum ModelDrawer::GetCameraFrustum() const
+{
+	return Frustum::CreateFromCamera(Engine::GetInstance()->GetGraphicsEngine().GetGraphicsStateStack().GetCamera());
+}
+
+bool ModelDrawer::IsVisible(const ModelInstance& modelInstance)
+{
+	myCullingStatistics.TestedInstances++;
+	if (!modelInstance.IsVisible(GetCameraFrustum()))
+	{
+		return false;
+	}
+
+	myCullingStatistics.VisibleInstances++;
+	return true;
+}
+
+void ModelDrawer::PrepareInstancer(const ModelInstancer& modelInstancer, const Frustum& aFrustum)
+{
+	if (!modelInstancer.IsCulledWith(aFrustum))
+	{
+		modelInstancer.Cull(aFrustum);
+	}
+
+	myCullingStatistics.TestedInstances += modelInstancer.GetInstanceCount();
+	myCullingStatistics.VisibleInstances += modelInstancer.GetVisibleCount();
+}
+
+void ModelDrawer::CullInstancers(const ModelInstancer* const* someInstancers, size_t anInstancerCount)
+{
+	const Frustum frustum = GetCameraFrustum();
+
+	myWorkerThreads.ParallelFor(anInstancerCount, [&](size_t anIndex)
+	{
+		if (!someInstancers[anIndex]->IsCulledWith(frustum))
+		{
+			someInstancers[anIndex]->Cull(frustum);
+		}
+	});
+}
+
 void ModelDrawer::Draw(const AnimatedModelInstance& modelInstance)
 {
 	modelInstance.Render(*myDefaultAnimatedModelShader);
@@ -66,12 +115,82 @@ void ModelDrawer::Draw(const AnimatedModelInstance& modelInstance)
 
 void ModelDrawer::Draw(const ModelInstance& modelInstance)
 {
-	modelInstance.Render(*myDefaultShader);
+	if (IsVisible(modelInstance))
+	{
+		modelInstance.Render(*myDefaultShader);
+	}
 }
 
 void ModelDrawer::Draw(const ModelInstancer& modelInstancer)
 {
-	modelInstancer.Render(*myDefaultInstancedModelShader);
+	const ModelInstancer* instancer = &modelInstancer;
+	Draw(&instancer, 1);
+}
+
+void ModelDrawer::Draw(const ModelInstancer* const* someInstancers, size_t anInstancerCount)
+{
+	if (anInstancerCount == 0)
+		return;
+
+	CullInstancers(someInstancers, anInstancerCount);
+
+	const Frustum frustum = GetCameraFrustum();
+	for (size_t i = 0; i < anInstancerCount; i++)
+	{
+		PrepareInstancer(*someInstancers[i], frustum);
+		someInstancers[i]->Render(*myDefaultInstancedModelShader);
+	}
+}
+
+void ModelDrawer::Draw(const ModelInstance* const* someInstances, size_t anInstanceCount, const ModelShader* aShader, const uint64_t* someSortKeys)
+{
+	if (anInstanceCount == 0)
+		return;
+
+	const ModelShader& shader = aShader ? *aShader : *myDefaultShader;
+
+	GraphicsEngine& graphicsEngine = Engine::GetInstance()->GetGraphicsEngine();
+	GraphicsStateStack& graphicsStateStack = graphicsEngine.GetGraphicsStateStack();
+	const Frustum frustum = GetCameraFrustum();
+	const Matrix4x4f transform = graphicsStateStack.GetTransform();
+	// The slices are recorded on worker threads, which must not read the graphics state stack.
+	const LODView lodView = LODView::GetActive();
+
+	const size_t sliceCount = (anInstanceCount + RECORD_SLICE_SIZE - 1) / RECORD_SLICE_SIZE;
+	mySliceStatistics.assign(sliceCount, {});
+
+	myRecorder.Clear();
+	myRecorder.Record(sliceCount, [&](size_t aSlice, RenderCommandBuffer& aCommands)
+	{
+		ModelCullingStatistics& statistics = mySliceStatistics[aSlice];
+		const size_t end = std::min(anInstanceCount, (aSlice + 1) * RECORD_SLICE_SIZE);
+		for (size_t i = aSlice * RECORD_SLICE_SIZE; i < end; i++)
+		{
+			const ModelInstance& instance = *someInstances[i];
+
+			statistics.TestedInstances++;
+			if (!instance.IsVisible(frustum))
+				continue;
+			statistics.VisibleInstances++;
+
+			aCommands.BeginPacket(someSortKeys ? someSortKeys[i] : i);
+			instance.Record(shader, aCommands, transform, lodView);
+		}
+	});
+
+	for (const ModelCullingStatistics& statistics : mySliceStatistics)
+	{
+		myCullingStatistics.TestedInstances += statistics.TestedInstances;
+		myCullingStatistics.VisibleInstances += statistics.VisibleInstances;
+	}
+
+	const RenderCommandBuffer& commands = myRecorder.Merge();
+	if (!commands.IsEmpty())
+	{
+		graphicsStateStack.UpdateGpuStates();
+		graphicsEngine.GetRenderBackend().Execute(commands);
+	}
+	myRecorder.Clear();
 }
 
 void ModelDrawer::DrawPbr(const AnimatedModelInstance& modelInstance)
@@ -81,7 +200,10 @@ void ModelDrawer::DrawPbr(const AnimatedModelInstance& modelInstance)
 
 void ModelDrawer::DrawPbr(const ModelInstance& modelInstance)
 {
-	modelInstance.Render(*myPbrShader);
+	if (IsVisible(modelInstance))
+	{
+		modelInstance.Render(*myPbrShader);
+	}
 }
 
 void ModelDrawer::Draw(const AnimatedModelInstance& modelInstance, const ModelShader& shader)
@@ -91,5 +213,8 @@ void ModelDrawer::Draw(const AnimatedModelInstance& modelInstance, const ModelSh
 
 void ModelDrawer::Draw(const ModelInstance& modelInstance, const ModelShader& shader)
 {
-	modelInstance.Render(shader);
+	if (IsVisible(modelInstance))
+	{
+		modelInstance.Render(shader);
+	}
 }
\ No newline at end of file
@@ -1,9 +1,11 @@
 #pragma once
 
 #include <memory>
+#include <tge/render/ParallelRenderRecorder.h>
 #include <tge/render/RenderCommon.h>
 #include <tge/render/RenderObject.h>
 #include <tge/shaders/ShaderCommon.h>
+#include <tge/util/ThreadPool.h>
 #include <wrl\client.h>
 
 struct ID3D11Buffer;
@@ -16,7 +18,20 @@ namespace Tga
 	class AnimatedModelInstance;
 	class ModelInstance;
 	class ModelShader;
+	class Frustum;
 
+	struct ModelCullingStatistics
+	{
+		// Instances that went through a visibility test, single model instances and instancer instances alike.
+		size_t TestedInstances = 0;
+		size_t VisibleInstances = 0;
+	};
+
+	/// <summary>
+	/// Draws models with the built in shaders.
+	/// ModelInstances and ModelInstancers are culled against the active camera before they are drawn. Animated models
+	/// aren't culled since their bounds don't account for the animation.
+	/// </summary>
 	class ModelDrawer
 	{
 	public:
@@ -33,18 +48,55 @@ namespace Tga
 
 		void Draw(const ModelInstancer& modelInstancer);
 
+		/**
+		 * Draws many instancers. They are all culled up front with CullInstancers, so the culling runs in parallel and
+		 * drawing each one only reuses the result.
+		 */
+		void Draw(const ModelInstancer* const* someInstancers, size_t anInstancerCount);
+
+		/**
+		 * Culls and records many instances on worker threads, then submits them all at once.
+		 * Draws are ordered by someSortKeys when given, with ties kept in array order, otherwise by array index, which
+		 * gives exactly what calling Draw on every instance in turn would. An instance may only be in the array once.
+		 * @param aShader Shader to draw with, nullptr for the default one.
+		 */
+		void Draw(const ModelInstance* const* someInstances, size_t anInstanceCount, const ModelShader* aShader = nullptr, const uint64_t* someSortKeys = nullptr);
+
+		/**
+		 * Culls a set of instancers against the active camera, one instancer per job spread over worker threads.
+		 * Drawing one of them afterwards reuses the result as long as the camera and the instances haven't changed,
+		 * otherwise Draw culls it again on the calling thread. Drawing an array of instancers calls this itself.
+		 */
+		void CullInstancers(const ModelInstancer* const* someInstancers, size_t anInstancerCount);
+
+		/**
+		 * Called once per frame by the engine.
+		 */
+		void ResetCullingStatistics() { myPreviousCullingStatistics = myCullingStatistics; myCullingStatistics = {}; }
+		const ModelCullingStatistics& GetPreviousCullingStatistics() const { return myPreviousCullingStatistics; }
+
 		const ModelShader& GetDefaultShader() { return *myDefaultShader; }
 		const ModelShader& GetDefaultAnimatedShader() { return *myDefaultAnimatedModelShader; }
 		const ModelShader& GetPbrShader() { return *myPbrShader; }
 		const ModelShader& GetPbrAnimatedShader() { return *myPbrAnimatedModelShader; }
 
 	private:
+		Frustum GetCameraFrustum() const;
+		bool IsVisible(const ModelInstance& modelInstance);
+		void PrepareInstancer(const ModelInstancer& modelInstancer, const Frustum& aFrustum);
+
 		std::unique_ptr<ModelShader> myDefaultShader;
 		std::unique_ptr<ModelShader> myDefaultAnimatedModelShader;
 		std::unique_ptr<ModelShader> myPbrShader;
 		std::unique_ptr<ModelShader> myPbrAnimatedModelShader;
 		std::unique_ptr<InstancedModelShader> myDefaultInstancedModelShader;
 
+		ThreadPool myWorkerThreads;
+		ParallelRenderRecorder myRecorder{ myWorkerThreads };
+		std::vector<ModelCullingStatistics> mySliceStatistics;
+		ModelCullingStatistics myCullingStatistics;
+		ModelCullingStatistics myPreviousCullingStatistics;
+
 		bool myIsLoaded = false;
 		bool myIsInBatch = false;
 	};
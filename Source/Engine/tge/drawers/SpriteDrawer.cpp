@@ -1,13 +1,13 @@
 #include "stdafx.h"
 
 #include <tge/drawers/SpriteDrawer.h>
+#include <tge/drawers/SpritePacking.h>
 #include <tge/graphics/GraphicsEngine.h>
 #include <tge/graphics/DX11.h>
 #include <tge/sprite/sprite.h>
 #include <tge/texture/TextureManager.h>
 #include <tge/shaders/SpriteShader.h>
-
-#include <tge/math/Matrix2x2.h>
+#include <cmath>
 
 using namespace Tga;
 
@@ -31,48 +31,21 @@ void SpriteBatchScope::Draw(const Sprite2DInstanceData& aInstance)
 void SpriteBatchScope::Draw(const Sprite2DInstanceData* aInstances, size_t aInstanceCount)
 {
 	GraphicsStateStack& graphicsStateStack = Tga::Engine::GetInstance()->GetGraphicsEngine().GetGraphicsStateStack();
+	const Matrix4x4f& transform = graphicsStateStack.GetTransform();
+	ReportScreenSize(aInstances, aInstanceCount, transform);
 
-	assert(myInstanceCount < BATCH_SIZE);
-
-	Vector2ui resolution = DX11::GetResolution();
-
-	for (int i = 0; i < aInstanceCount; i++)
+	while (aInstanceCount > 0)
 	{
-		const Sprite2DInstanceData& instance = aInstances[i];
-
-		if (instance.myIsHidden)
-			continue;
-
-		SpriteShaderInstanceData& shaderInstance = myInstanceData[myInstanceCount];
-
-		Vector2f pivot = Vector2f(-instance.myPivot.x, instance.myPivot.y);
-		Matrix2x2f scalingMatrix = Matrix2x2f::CreateScaleMatrix(Vector2f((instance.mySize.x) * instance.mySizeMultiplier.x, (instance.mySize.y) * instance.mySizeMultiplier.y));
-		Matrix2x2f rotationMatrix = Matrix2x2f::CreateRotation(instance.myRotation);
-		
-		Matrix2x2f m = scalingMatrix * rotationMatrix;
-		Vector2f p = pivot * m + instance.myPosition;
-
-		shaderInstance.myTransform = Matrix4x4f
-		{
-			m(1,1),m(1,2),0,0,
-			m(2,1),m(2,2),0,0,
-			0     ,0     ,1,0,
-			p.x   ,p.y   ,0,1,
-		} * graphicsStateStack.GetTransform();
-
-		shaderInstance.myUVRect.x = instance.myTextureRect.myStartX;
-		shaderInstance.myUVRect.y = instance.myTextureRect.myEndY;
-		shaderInstance.myUVRect.z = instance.myTextureRect.myEndX;
-		shaderInstance.myUVRect.w = instance.myTextureRect.myStartY;
+		assert(myInstanceCount < BATCH_SIZE);
+		if (myInstanceData == nullptr)
+			return;
 
-		shaderInstance.myUV.x = instance.myUV.x;
-		shaderInstance.myUV.y = instance.myUV.y;
-		shaderInstance.myUV.z = instance.myUVScale.x;
-		shaderInstance.myUV.w = instance.myUVScale.y;
-
-		shaderInstance.myColor = instance.myColor.AsLinearVec4();
+		// Hidden sprites are skipped, so the packer never writes more than it reads.
+		const size_t count = std::min(aInstanceCount, BATCH_SIZE - myInstanceCount);
+		myInstanceCount += SpritePacking::Pack2D(aInstances, count, transform, myInstanceData + myInstanceCount);
+		aInstances += count;
+		aInstanceCount -= count;
 
-		myInstanceCount++;
 		if (myInstanceCount >= BATCH_SIZE)
 		{
 			UnMapAndRender();
@@ -81,6 +54,34 @@ void SpriteBatchScope::Draw(const Sprite2DInstanceData* aInstances, size_t aInst
 	}
 };
 
+void SpriteBatchScope::ReportScreenSize(const Sprite2DInstanceData* aInstances, size_t aInstanceCount, const Matrix4x4f& aTransform) const
+{
+	if (!myTexture || !myTexture->HasScreenSizeFeedback())
+	{
+		return;
+	}
+
+	// The size the whole texture would be drawn at, the texture rect and UV scale only show part of it.
+	float largestSize = 0.0f;
+	for (size_t i = 0; i < aInstanceCount; i++)
+	{
+		const Sprite2DInstanceData& instance = aInstances[i];
+		if (instance.myIsHidden)
+		{
+			continue;
+		}
+
+		const float shownX = std::max(std::abs((instance.myTextureRect.myEndX - instance.myTextureRect.myStartX) * instance.myUVScale.x), 0.001f);
+		const float shownY = std::max(std::abs((instance.myTextureRect.myEndY - instance.myTextureRect.myStartY) * instance.myUVScale.y), 0.001f);
+		largestSize = std::max(largestSize, std::abs(instance.mySize.x * instance.mySizeMultiplier.x) / shownX);
+		largestSize = std::max(largestSize, std::abs(instance.mySize.y * instance.mySizeMultiplier.y) / shownY);
+	}
+
+	const float scaleX = std::sqrt(aTransform(1, 1) * aTransform(1, 1) + aTransform(1, 2) * aTransform(1, 2));
+	const float scaleY = std::sqrt(aTransform(2, 1) * aTransform(2, 1) + aTransform(2, 2) * aTransform(2, 2));
+	myTexture->ReportScreenSize(largestSize * std::max(scaleX, scaleY));
+}
+
 void SpriteBatchScope::Draw(const Sprite3DInstanceData& aInstance)
 {
 	Draw(&aInstance, 1);
@@ -124,15 +125,52 @@ void SpriteBatchScope::Draw(const Sprite3DInstanceData* aInstances, size_t aInst
 	}
 }
 
+SpriteShaderInstanceData* SpriteBatchScope::Reserve(size_t aCount, size_t& outReservedCount)
+{
+	if (myInstanceCount >= BATCH_SIZE)
+	{
+		UnMapAndRender();
+		Map();
+	}
+
+	if (myInstanceData == nullptr)
+	{
+		outReservedCount = 0;
+		return nullptr;
+	}
+
+	outReservedCount = std::min(aCount, BATCH_SIZE - myInstanceCount);
+	return myInstanceData + myInstanceCount;
+}
+
+void SpriteBatchScope::Commit(size_t aCount)
+{
+	assert(myInstanceCount + aCount <= BATCH_SIZE);
+	myInstanceCount += aCount;
+
+	if (myInstanceCount >= BATCH_SIZE)
+	{
+		UnMapAndRender();
+		Map();
+	}
+}
+
 void SpriteBatchScope::UnMapAndRender()
 {
 	assert(mySpriteDrawer);
 
-	ID3D11DeviceContext* context = DX11::Context;
+	RenderCommandBuffer& commands = mySpriteDrawer->myCommands;
 
-	context->Unmap(mySpriteDrawer->myInstanceBuffer.Get(), 0);
-	DX11::LogDrawCall();
-	context->DrawInstanced(6, (UINT)myInstanceCount, 0, 0);
+	if (myInstanceData != nullptr)
+	{
+		commands.TrimLastWrite(sizeof(SpriteShaderInstanceData) * myInstanceCount);
+	}
+	if (myInstanceCount > 0)
+	{
+		commands.DrawInstanced(6, (uint32_t)myInstanceCount);
+	}
+
+	Tga::Engine::GetInstance()->GetGraphicsEngine().Submit(commands);
 
 	myInstanceData = nullptr;
 	myInstanceCount = 0;
@@ -143,15 +181,9 @@ void SpriteBatchScope::Map()
 	assert(mySpriteDrawer);
 	assert(myInstanceCount == 0);
 
-	D3D11_MAPPED_SUBRESOURCE mappedObjectResource;
-	HRESULT result = DX11::Context->Map(mySpriteDrawer->myInstanceBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedObjectResource);
-	if (FAILED(result))
-	{
-		INFO_PRINT("Error in rendering!");
-		return;
-	}
-
-	myInstanceData = static_cast<SpriteShaderInstanceData*>(mappedObjectResource.pData);
+	// Room for a whole batch is reserved up front and trimmed to what was used when the batch is drawn.
+	void* instanceData = mySpriteDrawer->myCommands.WriteBuffer(mySpriteDrawer->myInstanceBuffer.Get(), sizeof(SpriteShaderInstanceData) * BATCH_SIZE);
+	myInstanceData = static_cast<SpriteShaderInstanceData*>(instanceData);
 }
 
 SpriteDrawer::SpriteDrawer()
@@ -268,15 +300,15 @@ SpriteBatchScope SpriteDrawer::BeginBatch(const SpriteSharedData& aSharedData)
 
 	if (aSharedData.myCustomShader)
 	{
-		aSharedData.myCustomShader->PrepareRender(aSharedData);
+		aSharedData.myCustomShader->PrepareRender(aSharedData, myCommands);
 	}
 	else
 	{
-		myDefaultShader->PrepareRender(aSharedData);
+		myDefaultShader->PrepareRender(aSharedData, myCommands);
 	}
 
-	unsigned int strides[2];
-	unsigned int offsets[2];
+	uint32_t strides[2];
+	uint32_t offsets[2];
 	ID3D11Buffer* bufferPointers[2];
 
 	strides[0] = sizeof(VertexInstanced);
@@ -288,14 +320,25 @@ SpriteBatchScope SpriteDrawer::BeginBatch(const SpriteSharedData& aSharedData)
 	bufferPointers[0] = myVertexBuffer.Get();
 	bufferPointers[1] = myInstanceBuffer.Get();
 
-	DX11::Context->IASetVertexBuffers(0, 2, bufferPointers, strides, offsets);
+	myCommands.SetVertexBuffers(0, 2, bufferPointers, strides, offsets);
 
-	SpriteBatchScope scope(*this);
+	SpriteBatchScope scope(*this, aSharedData.myTexture);
 	scope.Map();
 
 	return scope;
 }
 
+size_t SpriteDrawer::GetMaxBatchSize() const
+{
+	return BATCH_SIZE;
+}
+
+void SpriteDrawer::DrawBatch(const SpriteSharedData& aSharedData, const Sprite2DInstanceData* someInstances, size_t anInstanceCount)
+{
+	SpriteBatchScope scope = BeginBatch(aSharedData);
+	scope.Draw(someInstances, anInstanceCount);
+}
+
 void SpriteDrawer::EndBatch()
 {
 	assert(myIsInBatch);
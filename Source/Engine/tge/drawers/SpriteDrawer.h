@@ -1,9 +1,11 @@
 #pragma once
 
 #include <memory>
+#include <tge/render/RenderCommandBuffer.h>
 #include <tge/render/RenderCommon.h>
 #include <tge/render/RenderObject.h>
 #include <tge/shaders/ShaderCommon.h>
+#include <tge/drawers/SpriteRenderQueue.h>
 
 struct ID3D11Buffer;
 using Microsoft::WRL::ComPtr;
@@ -11,6 +13,7 @@ using Microsoft::WRL::ComPtr;
 namespace Tga
 {
 	class Texture;
+	class TextureResource;
 	class SpriteDrawer;
 	class SpriteShader;
 	struct Sprite2DInstanceData;
@@ -26,11 +29,22 @@ namespace Tga
 		void Draw(const Sprite2DInstanceData* aInstances, size_t aInstanceCount);
 		void Draw(const Sprite3DInstanceData& aInstance);
 		void Draw(const Sprite3DInstanceData* aInstances, size_t aInstanceCount);
+
+		/**
+		 * Gives direct access to the current batch's instance data for code that writes SpriteShaderInstanceData itself.
+		 * Flushes first if the current batch is full. Write at most outReservedCount instances, then call Commit.
+		 * In a fresh scope the reserved counts are always whole batches, so they stay multiples of four.
+		 * @returns Where to write, or nullptr if no batch is open.
+		 */
+		SpriteShaderInstanceData* Reserve(size_t aCount, size_t& outReservedCount);
+		void Commit(size_t aCount);
 	private:
-		SpriteBatchScope(SpriteDrawer& aSpriteDrawer)
-			: mySpriteDrawer(&aSpriteDrawer) {}
+		SpriteBatchScope(SpriteDrawer& aSpriteDrawer, const TextureResource* aTexture)
+			: mySpriteDrawer(&aSpriteDrawer)
+			, myTexture(aTexture) {}
 		SpriteBatchScope(SpriteBatchScope&& scope) noexcept
 			: mySpriteDrawer(scope.mySpriteDrawer)
+			, myTexture(scope.myTexture)
 			, myInstanceData(scope.myInstanceData)
 			, myInstanceCount(scope.myInstanceCount) 
 		{
@@ -44,13 +58,15 @@ namespace Tga
 
 		void UnMapAndRender();
 		void Map();
+		void ReportScreenSize(const Sprite2DInstanceData* aInstances, size_t aInstanceCount, const Matrix4x4f& aTransform) const;
 
 		SpriteDrawer* mySpriteDrawer;
+		const TextureResource* myTexture = nullptr;
 		SpriteShaderInstanceData* myInstanceData = nullptr;
 		size_t myInstanceCount = 0;
 	};
 
-	class SpriteDrawer
+	class SpriteDrawer : public SpriteRenderBackend
 	{
 		friend class SpriteBatchScope;
 	public:
@@ -65,6 +81,23 @@ namespace Tga
 
 		SpriteBatchScope BeginBatch(const SpriteSharedData& aSharedData);
 
+		/**
+		 * Queues sprites for the next FlushQueue instead of drawing them right away.
+		 * Queued sprites are sorted by (layer, shader, texture) and drawn in as few batches as possible.
+		 */
+		void Submit(const SpriteSharedData& aSharedData, const Sprite2DInstanceData& aInstance, int aLayer = 0) { myQueue.Submit(aSharedData, aInstance, aLayer); }
+		void Submit(const SpriteSharedData& aSharedData, const Sprite2DInstanceData* aInstances, size_t aInstanceCount, int aLayer = 0) { myQueue.Submit(aSharedData, aInstances, aInstanceCount, aLayer); }
+
+		/**
+		 * Draws everything submitted since the last flush with the current graphics state.
+		 * The engine flushes whatever is left at the end of the frame.
+		 */
+		void FlushQueue() { myQueue.Flush(*this); }
+		const SpriteRenderQueue& GetQueue() const { return myQueue; }
+
+		size_t GetMaxBatchSize() const override;
+		void DrawBatch(const SpriteSharedData& aSharedData, const Sprite2DInstanceData* someInstances, size_t anInstanceCount) override;
+
 	private:
 		void EndBatch();
 
@@ -75,7 +108,11 @@ namespace Tga
 		ComPtr<ID3D11Buffer> myInstanceBuffer = nullptr;
 		VertexInstanced myVertices[6] = {};
 
+		// Binds and instance data for the open batch, submitted every time a batch is drawn.
+		RenderCommandBuffer myCommands;
+
 		std::unique_ptr<SpriteShader> myDefaultShader;
+		SpriteRenderQueue myQueue;
 		bool myIsLoaded = false;
 		bool myIsInBatch = false;
 	};
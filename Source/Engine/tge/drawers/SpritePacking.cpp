@@ -0,0 +1,273 @@
+#include "stdafx.h"
+#include "SpritePacking.h"
+
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <emmintrin.h>
+#include <tge/math/SimdMath.h>
+
+using namespace Tga;
+
+namespace
+{
+	// The sprite matrix is
+	//   m11 m12 0 0
+	//   m21 m22 0 0
+	//   0   0   1 0
+	//   px  py  0 1
+	// so multiplying it with the transform only needs combinations of the transform rows.
+	// Everything goes out as whole 16 byte stores. The output is command buffer payload in ordinary heap memory that is
+	// copied to the GPU buffer soon after, so the stores go through the cache rather than around it.
+	template<bool Aligned>
+	void WriteInstance(SpriteShaderInstanceData& outInstance, const __m128* someTransformRows,
+		float aM11, float aM12, float aM21, float aM22, float aPositionX, float aPositionY, __m128 aLinearColor, __m128 aUV, __m128 aUVRect)
+	{
+		float* out = reinterpret_cast<float*>(&outInstance);
+		const __m128 data[7] =
+		{
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(aM11), someTransformRows[0]), _mm_mul_ps(_mm_set1_ps(aM12), someTransformRows[1])),
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(aM21), someTransformRows[0]), _mm_mul_ps(_mm_set1_ps(aM22), someTransformRows[1])),
+			someTransformRows[2],
+			_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(aPositionX), someTransformRows[0]), _mm_mul_ps(_mm_set1_ps(aPositionY), someTransformRows[1])), someTransformRows[3]),
+			aLinearColor,
+			aUV,
+			aUVRect,
+		};
+
+		for (int i = 0; i < 7; i++)
+		{
+			if (Aligned)
+				_mm_store_ps(out + i * 4, data[i]);
+			else
+				_mm_storeu_ps(out + i * 4, data[i]);
+		}
+	}
+
+	__m128 GetUV(const Sprite2DInstanceData& anInstance)
+	{
+		return _mm_setr_ps(anInstance.myUV.x, anInstance.myUV.y, anInstance.myUVScale.x, anInstance.myUVScale.y);
+	}
+
+	// The shader wants the rect as (start x, end y, end x, start y).
+	__m128 GetUVRect(const TextureRext& aRect)
+	{
+		return _mm_setr_ps(aRect.myStartX, aRect.myEndY, aRect.myEndX, aRect.myStartY);
+	}
+
+	template<bool Aligned>
+	size_t PackReference(const Sprite2DInstanceData* someInstances, size_t anInstanceCount, const __m128* someTransformRows, SpriteShaderInstanceData* outInstances)
+	{
+		size_t written = 0;
+
+		for (size_t i = 0; i < anInstanceCount; i++)
+		{
+			const Sprite2DInstanceData& instance = someInstances[i];
+			if (instance.myIsHidden)
+				continue;
+
+			const float scaleX = instance.mySize.x * instance.mySizeMultiplier.x;
+			const float scaleY = instance.mySize.y * instance.mySizeMultiplier.y;
+			const float cos = std::cos(instance.myRotation);
+			const float sin = std::sin(instance.myRotation);
+
+			const float m11 = scaleX * cos;
+			const float m12 = scaleX * sin;
+			const float m21 = -scaleY * sin;
+			const float m22 = scaleY * cos;
+
+			const float positionX = m11 * -instance.myPivot.x + m21 * instance.myPivot.y + instance.myPosition.x;
+			const float positionY = m12 * -instance.myPivot.x + m22 * instance.myPivot.y + instance.myPosition.y;
+
+			const Vector4f color = instance.myColor.AsLinearVec4();
+
+			WriteInstance<Aligned>(outInstances[written++], someTransformRows, m11, m12, m21, m22, positionX, positionY,
+				_mm_setr_ps(color.x, color.y, color.z, color.w), GetUV(instance), GetUVRect(instance.myTextureRect));
+		}
+
+		return written;
+	}
+
+	template<bool Aligned>
+	size_t Pack(const Sprite2DInstanceData* someInstances, size_t anInstanceCount, const __m128* someTransformRows, SpriteShaderInstanceData* outInstances)
+	{
+		size_t written = 0;
+		size_t i = 0;
+
+		for (; i + 4 <= anInstanceCount; i += 4)
+		{
+			const Sprite2DInstanceData& a = someInstances[i + 0];
+			const Sprite2DInstanceData& b = someInstances[i + 1];
+			const Sprite2DInstanceData& c = someInstances[i + 2];
+			const Sprite2DInstanceData& d = someInstances[i + 3];
+
+			const int visible = (a.myIsHidden ? 0 : 1) | (b.myIsHidden ? 0 : 2) | (c.myIsHidden ? 0 : 4) | (d.myIsHidden ? 0 : 8);
+			if (visible == 0)
+				continue;
+
+			const __m128 scaleX = _mm_mul_ps(
+				_mm_setr_ps(a.mySize.x, b.mySize.x, c.mySize.x, d.mySize.x),
+				_mm_setr_ps(a.mySizeMultiplier.x, b.mySizeMultiplier.x, c.mySizeMultiplier.x, d.mySizeMultiplier.x));
+			const __m128 scaleY = _mm_mul_ps(
+				_mm_setr_ps(a.mySize.y, b.mySize.y, c.mySize.y, d.mySize.y),
+				_mm_setr_ps(a.mySizeMultiplier.y, b.mySizeMultiplier.y, c.mySizeMultiplier.y, d.mySizeMultiplier.y));
+
+			__m128 m11, m12, m21, m22;
+			const __m128 rotation = _mm_setr_ps(a.myRotation, b.myRotation, c.myRotation, d.myRotation);
+			if (_mm_movemask_ps(_mm_cmpneq_ps(rotation, _mm_setzero_ps())) == 0)
+			{
+				m11 = scaleX;
+				m12 = _mm_setzero_ps();
+				m21 = _mm_setzero_ps();
+				m22 = scaleY;
+			}
+			else
+			{
+				__m128 sin, cos;
+				Simd::SinCos(rotation, sin, cos);
+				m11 = _mm_mul_ps(scaleX, cos);
+				m12 = _mm_mul_ps(scaleX, sin);
+				m21 = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(scaleY, sin));
+				m22 = _mm_mul_ps(scaleY, cos);
+			}
+
+			// The pivot is (-pivot.x, pivot.y) run through the sprite matrix, then offset by the position.
+			const __m128 pivotX = _mm_setr_ps(-a.myPivot.x, -b.myPivot.x, -c.myPivot.x, -d.myPivot.x);
+			const __m128 pivotY = _mm_setr_ps(a.myPivot.y, b.myPivot.y, c.myPivot.y, d.myPivot.y);
+			const __m128 positionX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m11, pivotX), _mm_mul_ps(m21, pivotY)),
+				_mm_setr_ps(a.myPosition.x, b.myPosition.x, c.myPosition.x, d.myPosition.x));
+			const __m128 positionY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m12, pivotX), _mm_mul_ps(m22, pivotY)),
+				_mm_setr_ps(a.myPosition.y, b.myPosition.y, c.myPosition.y, d.myPosition.y));
+
+			// Convert four lanes of r, g, b, a and transpose them into one rgba per sprite.
+			__m128 colors[4] =
+			{
+				Simd::InverseEOTF(_mm_setr_ps(a.myColor.myR, b.myColor.myR, c.myColor.myR, d.myColor.myR)),
+				Simd::InverseEOTF(_mm_setr_ps(a.myColor.myG, b.myColor.myG, c.myColor.myG, d.myColor.myG)),
+				Simd::InverseEOTF(_mm_setr_ps(a.myColor.myB, b.myColor.myB, c.myColor.myB, d.myColor.myB)),
+				_mm_setr_ps(a.myColor.myA, b.myColor.myA, c.myColor.myA, d.myColor.myA),
+			};
+			_MM_TRANSPOSE4_PS(colors[0], colors[1], colors[2], colors[3]);
+
+			alignas(16) float lanes[6][4];
+			_mm_store_ps(lanes[0], m11);
+			_mm_store_ps(lanes[1], m12);
+			_mm_store_ps(lanes[2], m21);
+			_mm_store_ps(lanes[3], m22);
+			_mm_store_ps(lanes[4], positionX);
+			_mm_store_ps(lanes[5], positionY);
+
+			for (int lane = 0; lane < 4; lane++)
+			{
+				if ((visible & (1 << lane)) == 0)
+					continue;
+
+				const Sprite2DInstanceData& instance = someInstances[i + lane];
+				WriteInstance<Aligned>(outInstances[written++], someTransformRows,
+					lanes[0][lane], lanes[1][lane], lanes[2][lane], lanes[3][lane], lanes[4][lane], lanes[5][lane], colors[lane],
+					GetUV(instance), GetUVRect(instance.myTextureRect));
+			}
+		}
+
+		return written + PackReference<Aligned>(someInstances + i, anInstanceCount - i, someTransformRows, outInstances + written);
+	}
+
+	template<bool Aligned>
+	void PackSoA(const Sprite2DSoAData& someSprites, size_t aCount, const __m128* someTransformRows, SpriteShaderInstanceData* outInstances)
+	{
+		const __m128 uv = _mm_setr_ps(someSprites.UV.x, someSprites.UV.y, someSprites.UVScale.x, someSprites.UVScale.y);
+		const __m128 uvRect = GetUVRect(someSprites.TextureRect);
+		const __m128 pivotX = _mm_set1_ps(-someSprites.Pivot.x);
+		const __m128 pivotY = _mm_set1_ps(someSprites.Pivot.y);
+
+		for (size_t i = 0; i < aCount; i += 4)
+		{
+			const __m128 scaleX = _mm_load_ps(someSprites.SizeX + i);
+			const __m128 scaleY = _mm_load_ps(someSprites.SizeY + i);
+
+			__m128 m11 = scaleX;
+			__m128 m12 = _mm_setzero_ps();
+			__m128 m21 = _mm_setzero_ps();
+			__m128 m22 = scaleY;
+			if (someSprites.Rotation)
+			{
+				const __m128 rotation = _mm_load_ps(someSprites.Rotation + i);
+				if (_mm_movemask_ps(_mm_cmpneq_ps(rotation, _mm_setzero_ps())) != 0)
+				{
+					__m128 sin, cos;
+					Simd::SinCos(rotation, sin, cos);
+					m11 = _mm_mul_ps(scaleX, cos);
+					m12 = _mm_mul_ps(scaleX, sin);
+					m21 = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(scaleY, sin));
+					m22 = _mm_mul_ps(scaleY, cos);
+				}
+			}
+
+			const __m128 positionX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m11, pivotX), _mm_mul_ps(m21, pivotY)), _mm_load_ps(someSprites.PositionX + i));
+			const __m128 positionY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m12, pivotX), _mm_mul_ps(m22, pivotY)), _mm_load_ps(someSprites.PositionY + i));
+
+			__m128 colors[4] =
+			{
+				_mm_load_ps(someSprites.ColorR + i),
+				_mm_load_ps(someSprites.ColorG + i),
+				_mm_load_ps(someSprites.ColorB + i),
+				_mm_load_ps(someSprites.ColorA + i),
+			};
+			_MM_TRANSPOSE4_PS(colors[0], colors[1], colors[2], colors[3]);
+
+			alignas(16) float lanes[6][4];
+			_mm_store_ps(lanes[0], m11);
+			_mm_store_ps(lanes[1], m12);
+			_mm_store_ps(lanes[2], m21);
+			_mm_store_ps(lanes[3], m22);
+			_mm_store_ps(lanes[4], positionX);
+			_mm_store_ps(lanes[5], positionY);
+
+			const int laneCount = static_cast<int>(std::min<size_t>(4, aCount - i));
+			for (int lane = 0; lane < laneCount; lane++)
+			{
+				WriteInstance<Aligned>(outInstances[i + lane], someTransformRows,
+					lanes[0][lane], lanes[1][lane], lanes[2][lane], lanes[3][lane], lanes[4][lane], lanes[5][lane], colors[lane], uv, uvRect);
+			}
+		}
+	}
+
+	void LoadTransformRows(const Matrix4x4f& aTransform, __m128* outRows)
+	{
+		const float* transform = &aTransform(1, 1);
+		for (int i = 0; i < 4; i++)
+			outRows[i] = _mm_loadu_ps(transform + i * 4);
+	}
+}
+
+size_t SpritePacking::Pack2D(const Sprite2DInstanceData* someInstances, size_t anInstanceCount, const Matrix4x4f& aTransform, SpriteShaderInstanceData* outInstances)
+{
+	__m128 rows[4];
+	LoadTransformRows(aTransform, rows);
+
+	if ((reinterpret_cast<uintptr_t>(outInstances) & 15) == 0)
+		return Pack<true>(someInstances, anInstanceCount, rows, outInstances);
+
+	return Pack<false>(someInstances, anInstanceCount, rows, outInstances);
+}
+
+size_t SpritePacking::Pack2DReference(const Sprite2DInstanceData* someInstances, size_t anInstanceCount, const Matrix4x4f& aTransform, SpriteShaderInstanceData* outInstances)
+{
+	__m128 rows[4];
+	LoadTransformRows(aTransform, rows);
+	return PackReference<false>(someInstances, anInstanceCount, rows, outInstances);
+}
+
+void SpritePacking::Pack2DSoA(const Sprite2DSoAData& someSprites, size_t aCount, const Matrix4x4f& aTransform, SpriteShaderInstanceData* outInstances)
+{
+	__m128 rows[4];
+	LoadTransformRows(aTransform, rows);
+
+	if ((reinterpret_cast<uintptr_t>(outInstances) & 15) == 0)
+	{
+		PackSoA<true>(someSprites, aCount, rows, outInstances);
+		return;
+	}
+
+	PackSoA<false>(someSprites, aCount, rows, outInstances);
+}
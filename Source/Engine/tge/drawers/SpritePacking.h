@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <tge/sprite/sprite.h>
+#include <tge/shaders/ShaderCommon.h>
+
+namespace Tga
+{
+
+/// <summary>
+/// Sprites stored as separate arrays, for systems like particles that already keep their data that way.
+/// Every array must be 16 byte aligned and readable up to the count rounded up to a multiple of four.
+/// Colors are expected to already be linear. Pivot, UV and texture rect are shared by all sprites.
+/// </summary>
+struct Sprite2DSoAData
+{
+	const float* PositionX = nullptr;
+	const float* PositionY = nullptr;
+	const float* SizeX = nullptr;
+	const float* SizeY = nullptr;
+	// Leave as nullptr if nothing rotates.
+	const float* Rotation = nullptr;
+	const float* ColorR = nullptr;
+	const float* ColorG = nullptr;
+	const float* ColorB = nullptr;
+	const float* ColorA = nullptr;
+
+	Vector2f Pivot = { 0.5f, 0.5f };
+	Vector2f UV = { 0.0f, 0.0f };
+	Vector2f UVScale = { 1.0f, 1.0f };
+	TextureRext TextureRect = { 0.0f, 0.0f, 1.0f, 1.0f };
+};
+
+/// <summary>
+/// Converts 2D sprite instances into the per-instance data the sprite shader reads.
+/// </summary>
+namespace SpritePacking
+{
+	/**
+	 * SSE path, four sprites per iteration. Uses a polynomial sincos (skipped when all four rotations are zero) and a
+	 * polynomial sRGB to linear conversion, so results match Pack2DReference to within about 1e-5.
+	 * @param aTransform The graphics state transform every sprite is multiplied with.
+	 * @param outInstances Must have room for anInstanceCount entries.
+	 * @returns How many instances were written. Hidden instances are skipped.
+	 */
+	size_t Pack2D(const Sprite2DInstanceData* someInstances, size_t anInstanceCount, const Matrix4x4f& aTransform, SpriteShaderInstanceData* outInstances);
+
+	/**
+	 * Same as Pack2D for sprites stored as arrays. Writes exactly aCount instances.
+	 */
+	void Pack2DSoA(const Sprite2DSoAData& someSprites, size_t aCount, const Matrix4x4f& aTransform, SpriteShaderInstanceData* outInstances);
+
+	/**
+	 * Scalar version using std::sin/std::cos and Color::AsLinearVec4, kept to compare the SSE path against.
+	 */
+	size_t Pack2DReference(const Sprite2DInstanceData* someInstances, size_t anInstanceCount, const Matrix4x4f& aTransform, SpriteShaderInstanceData* outInstances);
+}
+
+} // namespace Tga
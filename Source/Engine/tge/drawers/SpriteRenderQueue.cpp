@@ -0,0 +1,180 @@
+#include "stdafx.h"
+#include "SpriteRenderQueue.h"
+
+#include <algorithm>
+#include <functional>
+
+using namespace Tga;
+
+size_t SpriteRenderQueue::SharedDataHash::operator()(const SpriteSharedData& aSharedData) const
+{
+	size_t hash = std::hash<const void*>()(aSharedData.myTexture);
+	hash ^= std::hash<const void*>()(aSharedData.myCustomShader) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	for (int i = 0; i < MAP_MAX; i++)
+	{
+		hash ^= std::hash<const void*>()(aSharedData.myMaps[i]) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	}
+	return hash;
+}
+
+bool SpriteRenderQueue::SharedDataEqual::operator()(const SpriteSharedData& aLeft, const SpriteSharedData& aRight) const
+{
+	if (aLeft.myTexture != aRight.myTexture || aLeft.myCustomShader != aRight.myCustomShader)
+		return false;
+
+	for (int i = 0; i < MAP_MAX; i++)
+	{
+		if (aLeft.myMaps[i] != aRight.myMaps[i])
+			return false;
+	}
+	return true;
+}
+
+uint32_t SpriteRenderQueue::GetSharedDataIndex(const SpriteSharedData& aSharedData)
+{
+	// Most callers submit runs with the same shared data, so check the last one before hashing.
+	if (!mySharedData.empty() && SharedDataEqual()(mySharedData.back(), aSharedData))
+		return static_cast<uint32_t>(mySharedData.size() - 1);
+
+	auto it = mySharedDataLookup.find(aSharedData);
+	if (it != mySharedDataLookup.end())
+		return it->second;
+
+	const uint32_t index = static_cast<uint32_t>(mySharedData.size());
+	mySharedData.push_back(aSharedData);
+	mySharedDataLookup.emplace(aSharedData, index);
+	return index;
+}
+
+void SpriteRenderQueue::Submit(const SpriteSharedData& aSharedData, const Sprite2DInstanceData& anInstance, int aLayer)
+{
+	Submit(aSharedData, &anInstance, 1, aLayer);
+}
+
+void SpriteRenderQueue::Submit(const SpriteSharedData& aSharedData, const Sprite2DInstanceData* someInstances, size_t anInstanceCount, int aLayer)
+{
+	const uint32_t sharedDataIndex = GetSharedDataIndex(aSharedData);
+
+	for (size_t i = 0; i < anInstanceCount; i++)
+	{
+		if (someInstances[i].myIsHidden)
+			continue;
+
+		myInstances.push_back(someInstances[i]);
+		myInstanceSharedData.push_back(sharedDataIndex);
+		myInstanceLayers.push_back(aLayer);
+	}
+}
+
+void SpriteRenderQueue::Flush(SpriteRenderBackend& aBackend)
+{
+	myLastFlushStatistics = SpriteRenderQueueStatistics();
+	if (myInstances.empty())
+	{
+		Clear();
+		return;
+	}
+
+	// Rank the distinct shared data by (shader, texture) once, so sorting the sprites is a plain integer sort.
+	// Shaders and textures are ordered by when they were first submitted rather than by address, so the draw order
+	// is the same every run. mySharedData is already in first submission order.
+	myShaderFirstUse.clear();
+	myTextureFirstUse.clear();
+	myShaderOrder.resize(mySharedData.size());
+	myTextureOrder.resize(mySharedData.size());
+	for (uint32_t i = 0; i < mySharedData.size(); i++)
+	{
+		myShaderOrder[i] = myShaderFirstUse.emplace(mySharedData[i].myCustomShader, i).first->second;
+		myTextureOrder[i] = myTextureFirstUse.emplace(mySharedData[i].myTexture, i).first->second;
+	}
+
+	mySharedDataOrder.resize(mySharedData.size());
+	for (uint32_t i = 0; i < mySharedDataOrder.size(); i++)
+		mySharedDataOrder[i] = i;
+
+	std::sort(mySharedDataOrder.begin(), mySharedDataOrder.end(), [this](uint32_t aLeft, uint32_t aRight)
+	{
+		if (myShaderOrder[aLeft] != myShaderOrder[aRight])
+			return myShaderOrder[aLeft] < myShaderOrder[aRight];
+		if (myTextureOrder[aLeft] != myTextureOrder[aRight])
+			return myTextureOrder[aLeft] < myTextureOrder[aRight];
+		return aLeft < aRight;
+	});
+
+	mySharedDataRank.resize(mySharedData.size());
+	for (uint32_t rank = 0; rank < mySharedDataOrder.size(); rank++)
+		mySharedDataRank[mySharedDataOrder[rank]] = rank;
+
+	const size_t count = myInstances.size();
+	mySortEntries.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		// Flip the sign bit so negative layers sort before positive ones.
+		const uint64_t layer = static_cast<uint32_t>(myInstanceLayers[i]) ^ 0x80000000u;
+		mySortEntries[i].Key = (layer << 32) | mySharedDataRank[myInstanceSharedData[i]];
+		mySortEntries[i].Index = static_cast<uint32_t>(i);
+	}
+
+	// LSD radix sort, one byte at a time. It is stable, so submission order is kept within a key, and bytes that
+	// are the same for every sprite (usually most of the layer) are skipped.
+	mySortScratch.resize(count);
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		size_t histogram[256] = {};
+		for (size_t i = 0; i < count; i++)
+			histogram[(mySortEntries[i].Key >> shift) & 0xff]++;
+
+		if (histogram[(mySortEntries[0].Key >> shift) & 0xff] == count)
+			continue;
+
+		size_t offset = 0;
+		for (size_t& bucket : histogram)
+		{
+			const size_t bucketCount = bucket;
+			bucket = offset;
+			offset += bucketCount;
+		}
+
+		for (size_t i = 0; i < count; i++)
+			mySortScratch[histogram[(mySortEntries[i].Key >> shift) & 0xff]++] = mySortEntries[i];
+
+		mySortEntries.swap(mySortScratch);
+	}
+
+	mySortedInstances.resize(count);
+	for (size_t i = 0; i < count; i++)
+		mySortedInstances[i] = myInstances[mySortEntries[i].Index];
+
+	const size_t maxBatchSize = std::max<size_t>(1, aBackend.GetMaxBatchSize());
+
+	size_t runStart = 0;
+	while (runStart < count)
+	{
+		const uint64_t key = mySortEntries[runStart].Key;
+		size_t runEnd = runStart + 1;
+		while (runEnd < count && mySortEntries[runEnd].Key == key)
+			runEnd++;
+
+		const SpriteSharedData& sharedData = mySharedData[myInstanceSharedData[mySortEntries[runStart].Index]];
+		for (size_t batchStart = runStart; batchStart < runEnd; batchStart += maxBatchSize)
+		{
+			const size_t batchCount = std::min(maxBatchSize, runEnd - batchStart);
+			aBackend.DrawBatch(sharedData, &mySortedInstances[batchStart], batchCount);
+			myLastFlushStatistics.BatchCount++;
+		}
+
+		runStart = runEnd;
+	}
+
+	myLastFlushStatistics.SpriteCount = count;
+	Clear();
+}
+
+void SpriteRenderQueue::Clear()
+{
+	mySharedData.clear();
+	mySharedDataLookup.clear();
+	myInstances.clear();
+	myInstanceSharedData.clear();
+	myInstanceLayers.clear();
+}
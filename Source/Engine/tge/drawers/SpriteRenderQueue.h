@@ -0,0 +1,97 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <tge/sprite/sprite.h>
+
+namespace Tga
+{
+	/// <summary>
+	/// Whatever actually draws the batches a SpriteRenderQueue produces.
+	/// SpriteDrawer is the DX11 implementation. Anything else (a recorder, a null backend) can be used to run the
+	/// sorting and batching without a device.
+	/// </summary>
+	class SpriteRenderBackend
+	{
+	public:
+		virtual ~SpriteRenderBackend() = default;
+
+		/**
+		 * The most instances a single DrawBatch call may receive.
+		 */
+		virtual size_t GetMaxBatchSize() const = 0;
+
+		/**
+		 * Draws one instanced batch. Every instance shares aSharedData and none of them are hidden.
+		 */
+		virtual void DrawBatch(const SpriteSharedData& aSharedData, const Sprite2DInstanceData* someInstances, size_t anInstanceCount) = 0;
+	};
+
+	struct SpriteRenderQueueStatistics
+	{
+		size_t SpriteCount = 0;
+		size_t BatchCount = 0;
+	};
+
+	/// <summary>
+	/// Records 2D sprites during the frame and draws them in as few instanced batches as possible.
+	/// Sprites are sorted by (layer, shader, texture), with shaders and textures in the order they were first submitted,
+	/// so the result doesn't depend on where they happen to live in memory. Sprites with the same key keep the order
+	/// they were submitted in, so use layers for anything that has to be drawn on top of something else.
+	/// The graphics state (transform, camera, blend state) used is the one active when Flush is called.
+	/// </summary>
+	class SpriteRenderQueue
+	{
+	public:
+		void Submit(const SpriteSharedData& aSharedData, const Sprite2DInstanceData& anInstance, int aLayer = 0);
+		void Submit(const SpriteSharedData& aSharedData, const Sprite2DInstanceData* someInstances, size_t anInstanceCount, int aLayer = 0);
+
+		/**
+		 * Sorts everything submitted since the last flush, hands it to aBackend in batches and clears the queue.
+		 */
+		void Flush(SpriteRenderBackend& aBackend);
+		void Clear();
+
+		bool IsEmpty() const { return myInstances.empty(); }
+		size_t GetSubmittedCount() const { return myInstances.size(); }
+		const SpriteRenderQueueStatistics& GetLastFlushStatistics() const { return myLastFlushStatistics; }
+
+	private:
+		struct SharedDataHash
+		{
+			size_t operator()(const SpriteSharedData& aSharedData) const;
+		};
+		struct SharedDataEqual
+		{
+			bool operator()(const SpriteSharedData& aLeft, const SpriteSharedData& aRight) const;
+		};
+		struct SortEntry
+		{
+			uint64_t Key;
+			uint32_t Index;
+		};
+
+		uint32_t GetSharedDataIndex(const SpriteSharedData& aSharedData);
+
+		std::vector<SpriteSharedData> mySharedData;
+		std::unordered_map<SpriteSharedData, uint32_t, SharedDataHash, SharedDataEqual> mySharedDataLookup;
+
+		std::vector<Sprite2DInstanceData> myInstances;
+		std::vector<uint32_t> myInstanceSharedData;
+		std::vector<int> myInstanceLayers;
+
+		// Scratch space kept between flushes to avoid reallocating every frame.
+		std::unordered_map<const void*, uint32_t> myShaderFirstUse;
+		std::unordered_map<const void*, uint32_t> myTextureFirstUse;
+		std::vector<uint32_t> myShaderOrder;
+		std::vector<uint32_t> myTextureOrder;
+		std::vector<uint32_t> mySharedDataOrder;
+		std::vector<uint32_t> mySharedDataRank;
+		std::vector<SortEntry> mySortEntries;
+		std::vector<SortEntry> mySortScratch;
+		std::vector<Sprite2DInstanceData> mySortedInstances;
+
+		SpriteRenderQueueStatistics myLastFlushStatistics;
+	};
+}
@@ -2,8 +2,11 @@
 
 #include <tge/engine.h>
 #include <tge/graphics/GraphicsEngine.h>
+#include <tge/drawers/LineDrawer.h>
 #include <tge/debugging/MemoryTracker.h>
 #include <tge/drawers/DebugDrawer.h>
+#include <tge/drawers/ModelDrawer.h>
+#include <tge/drawers/SpriteDrawer.h>
 #include <tge/error/ErrorManager.h>
 #include <tge/filewatcher/FileWatcher.h>
 #include <tge/graphics/dx11.h>
@@ -12,6 +15,7 @@
 #include <tge/model/ModelFactory.h>
 #include <tge/windows/WindowsWindow.h>
 #include <tge/settings/settings.h>
+#include <tge/filesystem/VirtualFileSystem.h>
 
 #define WIN32_LEAN_AND_MEAN 
 #define NOMINMAX 
@@ -124,7 +128,8 @@ bool Engine::InternalStart()
 {
 	INFO_PRINT("%s", "#########################################");
 	INFO_PRINT("%s", "---TGA 2D Starting, dream big and dare to fail---");
-	myFileWatcher = std::make_unique<FileWatcher>();
+	myFileWatcher = std::make_unique<FileWatcher>(IsDebugFeatureOn(DebugFeature::Filewatcher));
+	Settings::GetFileSystem().WatchForChanges(*myFileWatcher);
 	myWindow = std::make_unique<WindowsWindow>();
 	if (!myWindow->Init(myWindowConfiguration, myWindowConfiguration.myHInstance, myWindowConfiguration.myHwnd)) 
 	{
@@ -405,10 +410,17 @@ bool Engine::BeginFrame()
 	
 	myDx11->BeginFrame(myWindowConfiguration.myClearColor);
     myTextureManager->Update();
+	myTextService->BeginFrame();
+
+	if (ModelFactory* modelFactory = ModelFactory::TryGetInstance())
+	{
+		modelFactory->ProcessCompletedLoads();
+	}
 	
 	myGraphicsEngine->GetGraphicsStateStack().BeginFrame();
 
 	DX11::ResetDrawCallCounter();
+	myGraphicsEngine->GetModelDrawer().ResetCullingStatistics();
 
 	return true;
 }
@@ -416,6 +428,10 @@ bool Engine::BeginFrame()
 
 void Engine::EndFrame( void )
 {
+	// Anything still queued is drawn before the overlays so queued sprites and lines never leak into the next frame.
+	myGraphicsEngine->GetSpriteDrawer().FlushQueue();
+	myGraphicsEngine->GetLineDrawer().FlushQueue(myDeltaTime);
+
 #ifndef _RETAIL
 	myImguiInterFace->Render();
 #endif // !_RETAIL
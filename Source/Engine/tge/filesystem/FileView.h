@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <tge/util/MappedFile.h>
+
+namespace Tga
+{
+
+class PackFile;
+
+/// <summary>
+/// The contents of a file opened through the VirtualFileSystem. Loose files are memory mapped and packed files point
+/// straight into the mapped pack, only compressed pack entries are decompressed into memory of their own. The view
+/// keeps its pack mapped, so the data stays valid until Close() or destruction. Empty files are open with a size of 0.
+/// </summary>
+class FileView
+{
+public:
+	FileView() = default;
+	FileView(const FileView&) = delete;
+	FileView& operator=(const FileView&) = delete;
+	FileView(FileView&& anOther) noexcept
+	{
+		*this = std::move(anOther);
+	}
+
+	FileView& operator=(FileView&& anOther) noexcept
+	{
+		if (this != &anOther)
+		{
+			// The data stays where it is, in the mapping or the heap buffer that moves along with it.
+			myData = anOther.myData;
+			mySize = anOther.mySize;
+			myFile = std::move(anOther.myFile);
+			myPack = std::move(anOther.myPack);
+			myDecompressed = std::move(anOther.myDecompressed);
+			anOther.myData = nullptr;
+			anOther.mySize = 0;
+		}
+		return *this;
+	}
+
+	bool IsOpen() const { return myData != nullptr; }
+	const uint8_t* GetData() const { return myData; }
+	size_t GetSize() const { return mySize; }
+
+	void Close()
+	{
+		myData = nullptr;
+		mySize = 0;
+		myFile.Close();
+		myPack.reset();
+		myDecompressed.clear();
+		myDecompressed.shrink_to_fit();
+	}
+
+private:
+	friend class VirtualFileSystem;
+
+	const uint8_t* myData = nullptr;
+	size_t mySize = 0;
+
+	MappedFile myFile;
+	std::shared_ptr<const PackFile> myPack;
+	std::vector<uint8_t> myDecompressed;
+};
+
+} // namespace Tga
@@ -0,0 +1,240 @@
+#include "stdafx.h"
+#include <tge/filesystem/LZ4.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+using namespace Tga;
+
+namespace
+{
+	constexpr size_t MinMatch = 4;
+	// The format wants the last 5 bytes of a block to be literals, and the last match to start at least 12 bytes before the end.
+	constexpr size_t LastLiterals = 5;
+	constexpr size_t MatchStartLimit = 12;
+	constexpr size_t MaxOffset = 65535;
+	constexpr uint32_t HashBits = 16;
+
+	uint32_t Read32(const uint8_t* aPointer)
+	{
+		uint32_t value;
+		memcpy(&value, aPointer, sizeof(value));
+		return value;
+	}
+
+	uint32_t Hash(uint32_t aSequence)
+	{
+		return (aSequence * 2654435761u) >> (32 - HashBits);
+	}
+
+	// Lengths that don't fit in their 4 bits of the token continue as bytes, 255 meaning another byte follows.
+	uint8_t* WriteLength(uint8_t* outData, size_t aLength)
+	{
+		while (aLength >= 255)
+		{
+			*outData++ = 255;
+			aLength -= 255;
+		}
+		*outData++ = static_cast<uint8_t>(aLength);
+		return outData;
+	}
+
+	bool ReadLength(const uint8_t*& aData, const uint8_t* anEnd, size_t& inOutLength)
+	{
+		uint8_t value;
+		do
+		{
+			if (aData >= anEnd)
+			{
+				return false;
+			}
+			value = *aData++;
+			inOutLength += value;
+		} while (value == 255);
+		return true;
+	}
+
+	size_t GetSequenceSize(size_t aLiteralLength, size_t aMatchLength)
+	{
+		return 1 + (aLiteralLength >= 15 ? aLiteralLength / 255 + 1 : 0) + aLiteralLength + 2 + (aMatchLength >= 15 ? aMatchLength / 255 + 1 : 0);
+	}
+}
+
+size_t LZ4::Compress(const uint8_t* someData, size_t aSize, uint8_t* outData, size_t aCapacity)
+{
+	// Empty data is stored as is, someData may be null then. Positions are kept as 32 bits, larger data is better
+	// split or stored as is.
+	if (aSize == 0 || aSize > UINT32_MAX)
+	{
+		return 0;
+	}
+
+	uint8_t* out = outData;
+	const uint8_t* const outEnd = outData + aCapacity;
+	const uint8_t* const end = someData + aSize;
+	const uint8_t* anchor = someData;
+
+	if (aSize > MatchStartLimit)
+	{
+		// Last position each 4 byte sequence was seen at. Every candidate is compared before it is used, so stale or
+		// colliding positions only cost a missed match.
+		std::unique_ptr<uint32_t[]> table = std::make_unique<uint32_t[]>(size_t(1) << HashBits);
+		memset(table.get(), 0, sizeof(uint32_t) << HashBits);
+
+		const uint8_t* const matchStartLimit = end - MatchStartLimit;
+		const uint8_t* const matchEndLimit = end - LastLiterals;
+		const uint8_t* ip = someData + 1;
+		while (ip <= matchStartLimit)
+		{
+			const uint32_t sequence = Read32(ip);
+			uint32_t& entry = table[Hash(sequence)];
+			const uint8_t* match = someData + entry;
+			entry = static_cast<uint32_t>(ip - someData);
+
+			if (match >= ip || static_cast<size_t>(ip - match) > MaxOffset || Read32(match) != sequence)
+			{
+				ip++;
+				continue;
+			}
+
+			// The bytes before the sequence may match too, they're cheaper as part of the match than as literals.
+			while (ip > anchor && match > someData && ip[-1] == match[-1])
+			{
+				ip--;
+				match--;
+			}
+
+			const uint8_t* matchEnd = ip + MinMatch;
+			const uint8_t* reference = match + MinMatch;
+			while (matchEnd < matchEndLimit && *matchEnd == *reference)
+			{
+				matchEnd++;
+				reference++;
+			}
+
+			const size_t literalLength = static_cast<size_t>(ip - anchor);
+			const size_t matchLength = static_cast<size_t>(matchEnd - ip) - MinMatch;
+			if (static_cast<size_t>(outEnd - out) < GetSequenceSize(literalLength, matchLength))
+			{
+				return 0;
+			}
+
+			uint8_t* token = out++;
+			*token = static_cast<uint8_t>(std::min<size_t>(literalLength, 15) << 4);
+			if (literalLength >= 15)
+			{
+				out = WriteLength(out, literalLength - 15);
+			}
+			memcpy(out, anchor, literalLength);
+			out += literalLength;
+
+			const size_t offset = static_cast<size_t>(ip - match);
+			*out++ = static_cast<uint8_t>(offset & 0xff);
+			*out++ = static_cast<uint8_t>(offset >> 8);
+
+			*token |= static_cast<uint8_t>(std::min<size_t>(matchLength, 15));
+			if (matchLength >= 15)
+			{
+				out = WriteLength(out, matchLength - 15);
+			}
+
+			ip = matchEnd;
+			anchor = matchEnd;
+		}
+	}
+
+	// The block ends with a sequence of literals only.
+	const size_t literalLength = static_cast<size_t>(end - anchor);
+	if (static_cast<size_t>(outEnd - out) < GetSequenceSize(literalLength, 0) - 2)
+	{
+		return 0;
+	}
+	uint8_t* token = out++;
+	*token = static_cast<uint8_t>(std::min<size_t>(literalLength, 15) << 4);
+	if (literalLength >= 15)
+	{
+		out = WriteLength(out, literalLength - 15);
+	}
+	memcpy(out, anchor, literalLength);
+	out += literalLength;
+
+	return static_cast<size_t>(out - outData);
+}
+
+bool LZ4::Decompress(const uint8_t* someData, size_t aCompressedSize, uint8_t* outData, size_t aSize)
+{
+	// outData may be null. Another LZ4 implementation writes an empty block as one token without literals.
+	if (aSize == 0)
+	{
+		return aCompressedSize == 0 || (aCompressedSize == 1 && someData[0] == 0);
+	}
+
+	const uint8_t* in = someData;
+	const uint8_t* const inEnd = someData + aCompressedSize;
+	uint8_t* out = outData;
+	uint8_t* const outEnd = outData + aSize;
+
+	while (in < inEnd)
+	{
+		const uint8_t token = *in++;
+
+		size_t literalLength = token >> 4;
+		if (literalLength == 15 && !ReadLength(in, inEnd, literalLength))
+		{
+			return false;
+		}
+		if (static_cast<size_t>(inEnd - in) < literalLength || static_cast<size_t>(outEnd - out) < literalLength)
+		{
+			return false;
+		}
+		memcpy(out, in, literalLength);
+		in += literalLength;
+		out += literalLength;
+
+		// Only the last sequence has no match.
+		if (in == inEnd)
+		{
+			break;
+		}
+
+		if (inEnd - in < 2)
+		{
+			return false;
+		}
+		const size_t offset = in[0] | (static_cast<size_t>(in[1]) << 8);
+		in += 2;
+		if (offset == 0 || offset > static_cast<size_t>(out - outData))
+		{
+			return false;
+		}
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !ReadLength(in, inEnd, matchLength))
+		{
+			return false;
+		}
+		matchLength += MinMatch;
+		if (static_cast<size_t>(outEnd - out) < matchLength)
+		{
+			return false;
+		}
+
+		const uint8_t* match = out - offset;
+		if (offset >= matchLength)
+		{
+			memcpy(out, match, matchLength);
+			out += matchLength;
+		}
+		else
+		{
+			// Overlapping matches repeat the last offset bytes, so they're copied one byte at a time.
+			for (size_t i = 0; i < matchLength; i++)
+			{
+				*out++ = *match++;
+			}
+		}
+	}
+
+	return out == outEnd;
+}
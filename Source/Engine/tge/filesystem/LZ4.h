@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace Tga
+{
+
+/// <summary>
+/// Compressor and decompressor for the LZ4 block format, so data packed with it can be read back by any LZ4
+/// implementation and the other way around. Fast enough to decompress on load, the compression is greedy.
+/// </summary>
+namespace LZ4
+{
+	/**
+	 * @returns The largest size aSize bytes can compress to, for sizing the output of Compress.
+	 */
+	constexpr size_t CompressBound(size_t aSize)
+	{
+		return aSize + aSize / 255 + 16;
+	}
+
+	/**
+	 * Compresses someData into one LZ4 block.
+	 * @returns The compressed size, or 0 if aSize is 0 or it doesn't fit in aCapacity bytes. Store the data as is then.
+	 */
+	size_t Compress(const uint8_t* someData, size_t aSize, uint8_t* outData, size_t aCapacity);
+
+	/**
+	 * Decompresses one LZ4 block that is exactly aSize bytes when decompressed. Never reads or writes out of bounds,
+	 * whatever someData holds. Nothing is written when aSize is 0, outData may be null then.
+	 * @returns false if someData is corrupt or doesn't decompress to exactly aSize bytes.
+	 */
+	bool Decompress(const uint8_t* someData, size_t aCompressedSize, uint8_t* outData, size_t aSize);
+}
+
+} // namespace Tga
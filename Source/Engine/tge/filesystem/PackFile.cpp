@@ -0,0 +1,97 @@
+#include "stdafx.h"
+#include <tge/filesystem/PackFile.h>
+
+#include <cstring>
+
+using namespace Tga;
+
+uint64_t PackFile::HashKey(const std::string& aKey)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (const char c : aKey)
+	{
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+bool PackFile::Open(const std::wstring& aPath)
+{
+	if (!myFile.Open(aPath) || myFile.GetSize() < sizeof(PackHeader))
+	{
+		myFile.Close();
+		return false;
+	}
+
+	const uint8_t* data = myFile.GetData();
+	const uint64_t size = myFile.GetSize();
+
+	PackHeader header;
+	memcpy(&header, data, sizeof(header));
+	const uint64_t tocEnd = sizeof(PackHeader) + static_cast<uint64_t>(header.myEntryCount) * sizeof(PackEntry);
+	if (memcmp(header.myMagic, PackHeader::Magic, sizeof(header.myMagic)) != 0
+		|| header.myVersion != PackHeader::CurrentVersion
+		|| tocEnd > size
+		|| header.myNamesOffset < tocEnd
+		|| header.myNamesOffset > size
+		|| header.myNamesSize > size - header.myNamesOffset
+		|| (header.myNamesSize > 0 && data[header.myNamesOffset + header.myNamesSize - 1] != 0))
+	{
+		myFile.Close();
+		return false;
+	}
+
+	// The entries are used in place, the header is 32 bytes so they stay 8 byte aligned in the mapping.
+	const PackEntry* entries = reinterpret_cast<const PackEntry*>(data + sizeof(PackHeader));
+	for (uint32_t i = 0; i < header.myEntryCount; i++)
+	{
+		const PackEntry& entry = entries[i];
+		const bool isCompressionValid = entry.myCompression == PackCompression::None ? entry.myStoredSize == entry.mySize : entry.myCompression == PackCompression::LZ4;
+		if (!isCompressionValid
+			|| entry.myOffset > size
+			|| entry.myStoredSize > size - entry.myOffset
+			|| entry.myNameOffset >= header.myNamesSize
+			|| (i > 0 && entries[i - 1].myHash > entry.myHash))
+		{
+			myFile.Close();
+			return false;
+		}
+	}
+
+	myEntries = entries;
+	myEntryCount = header.myEntryCount;
+	myNames = reinterpret_cast<const char*>(data + header.myNamesOffset);
+	return true;
+}
+
+const PackEntry* PackFile::Find(const std::string& aKey) const
+{
+	const uint64_t hash = HashKey(aKey);
+
+	size_t first = 0;
+	size_t count = myEntryCount;
+	while (count > 0)
+	{
+		const size_t step = count / 2;
+		if (myEntries[first + step].myHash < hash)
+		{
+			first += step + 1;
+			count -= step + 1;
+		}
+		else
+		{
+			count = step;
+		}
+	}
+
+	// Different keys can share a hash, the names tell them apart.
+	for (size_t i = first; i < myEntryCount && myEntries[i].myHash == hash; i++)
+	{
+		if (aKey == GetName(myEntries[i]))
+		{
+			return &myEntries[i];
+		}
+	}
+	return nullptr;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <tge/util/MappedFile.h>
+
+namespace Tga
+{
+
+/*
+ * A pack is one file holding many assets, laid out as
+ *   PackHeader
+ *   PackEntry[myEntryCount], sorted by myHash
+ *   names, the key of every entry, each ending with a 0
+ *   the data of every entry, each starting at a multiple of myAlignment
+ * Keys are paths relative to the packed directory as VirtualFileSystem::MakeKey gives them, so lower case and /
+ * separated. All values are little endian.
+ */
+
+enum class PackCompression : uint16_t
+{
+	None = 0,
+	// One LZ4 block, see LZ4.h.
+	LZ4 = 1,
+};
+
+struct PackHeader
+{
+	static constexpr char Magic[4] = { 'T', 'G', 'E', 'P' };
+	static constexpr uint32_t CurrentVersion = 1;
+
+	char myMagic[4];
+	uint32_t myVersion;
+	uint32_t myEntryCount;
+	uint32_t myAlignment;
+	uint64_t myNamesOffset;
+	uint64_t myNamesSize;
+};
+
+struct PackEntry
+{
+	// PackFile::HashKey of the entry's key.
+	uint64_t myHash;
+	uint64_t myOffset;
+	// Bytes in the pack, equal to mySize for entries that aren't compressed.
+	uint64_t myStoredSize;
+	uint64_t mySize;
+	// Where the key is in the names.
+	uint32_t myNameOffset;
+	PackCompression myCompression;
+	uint16_t myPadding;
+};
+
+static_assert(sizeof(PackHeader) == 32, "PackHeader is read from files as is");
+static_assert(sizeof(PackEntry) == 40, "PackEntry is read from files as is");
+
+/// <summary>
+/// A pack file mapped into memory. Entries that aren't compressed can be used straight from the mapping.
+/// Immutable once opened, so it can be read from any thread.
+/// </summary>
+class PackFile
+{
+public:
+	/**
+	 * Maps a pack and checks that its table of contents is in bounds and sorted, so entries can be trusted after.
+	 * @returns false if the file can't be opened or isn't a valid pack.
+	 */
+	bool Open(const std::wstring& aPath);
+
+	/**
+	 * @param aKey Key relative to the packed directory.
+	 * @returns The entry, or nullptr if the pack doesn't have it.
+	 */
+	const PackEntry* Find(const std::string& aKey) const;
+
+	const uint8_t* GetData(const PackEntry& anEntry) const { return myFile.GetData() + anEntry.myOffset; }
+	const char* GetName(const PackEntry& anEntry) const { return myNames + anEntry.myNameOffset; }
+
+	const PackEntry* GetEntries() const { return myEntries; }
+	size_t GetEntryCount() const { return myEntryCount; }
+
+	/**
+	 * 64 bit FNV-1a, the hash the table of contents is sorted by.
+	 */
+	static uint64_t HashKey(const std::string& aKey);
+
+private:
+	MappedFile myFile;
+	const PackEntry* myEntries = nullptr;
+	size_t myEntryCount = 0;
+	const char* myNames = nullptr;
+};
+
+} // namespace Tga
@@ -0,0 +1,223 @@
+#include "stdafx.h"
+#include <tge/filesystem/PackWriter.h>
+#include <tge/filesystem/LZ4.h>
+#include <tge/filesystem/PackFile.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+using namespace Tga;
+namespace fs = std::filesystem;
+
+namespace
+{
+	struct PackedFile
+	{
+		std::string myKey;
+		fs::path myPath;
+		PackEntry myEntry;
+	};
+
+	// Paths listed from a directory have no . or .. segments, so this gives the same key as VirtualFileSystem::MakeKey.
+	std::string MakeKey(const fs::path& aRelativePath)
+	{
+		std::string key = aRelativePath.generic_u8string();
+		for (char& c : key)
+		{
+			if (c >= 'A' && c <= 'Z')
+			{
+				c = static_cast<char>(c - 'A' + 'a');
+			}
+		}
+		return key;
+	}
+
+	uint64_t AlignUp(uint64_t aValue, uint32_t anAlignment)
+	{
+		return (aValue + anAlignment - 1) & ~static_cast<uint64_t>(anAlignment - 1);
+	}
+
+	bool ReadWholeFile(const fs::path& aPath, std::vector<uint8_t>& outData)
+	{
+		std::ifstream file(aPath, std::ios::binary | std::ios::ate);
+		if (!file)
+		{
+			return false;
+		}
+
+		const std::streamsize size = file.tellg();
+		if (size < 0)
+		{
+			return false;
+		}
+
+		outData.resize(static_cast<size_t>(size));
+		file.seekg(0);
+		return size == 0 || static_cast<bool>(file.read(reinterpret_cast<char*>(outData.data()), size));
+	}
+}
+
+bool PackWriter::PackDirectory(const std::wstring& aDirectory, const std::wstring& aPackPath, const PackWriterSettings& someSettings, PackWriterReport& outReport)
+{
+	outReport = PackWriterReport();
+
+	const uint32_t alignment = someSettings.myAlignment;
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+	{
+		outReport.myError = "The alignment has to be a power of two";
+		return false;
+	}
+
+	const fs::path directory(aDirectory);
+	const fs::path packPath(aPackPath);
+	const fs::path temporaryPath = fs::path(aPackPath + L".tmp");
+
+	std::vector<PackedFile> files;
+	std::error_code error;
+	for (fs::recursive_directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+	{
+		std::error_code fileError;
+		if (!it->is_regular_file(fileError) || fs::equivalent(it->path(), packPath, fileError) || fs::equivalent(it->path(), temporaryPath, fileError))
+		{
+			continue;
+		}
+
+		PackedFile file;
+		file.myKey = MakeKey(it->path().lexically_relative(directory));
+		file.myPath = it->path();
+		file.myEntry = {};
+		file.myEntry.myHash = PackFile::HashKey(file.myKey);
+		files.push_back(std::move(file));
+	}
+	if (error)
+	{
+		outReport.myError = "Couldn't list " + directory.u8string() + ": " + error.message();
+		return false;
+	}
+
+	// Sorted by key, files in the same directory end up next to each other in the pack.
+	std::sort(files.begin(), files.end(), [](const PackedFile& aLeft, const PackedFile& aRight) { return aLeft.myKey < aRight.myKey; });
+	for (size_t i = 1; i < files.size(); i++)
+	{
+		if (files[i - 1].myKey == files[i].myKey)
+		{
+			outReport.myError = files[i - 1].myPath.u8string() + " and " + files[i].myPath.u8string() + " only differ in case";
+			return false;
+		}
+	}
+
+	std::string names;
+	for (PackedFile& file : files)
+	{
+		file.myEntry.myNameOffset = static_cast<uint32_t>(names.size());
+		names += file.myKey;
+		names.push_back('\0');
+	}
+	if (names.size() > UINT32_MAX)
+	{
+		outReport.myError = "Too many files to pack";
+		return false;
+	}
+
+	std::ofstream pack(temporaryPath, std::ios::binary | std::ios::trunc);
+	if (!pack)
+	{
+		outReport.myError = "Couldn't create " + temporaryPath.u8string();
+		return false;
+	}
+
+	// The header and table of contents are written last, once the offsets and sizes of the entries are known.
+	const uint64_t namesOffset = sizeof(PackHeader) + files.size() * sizeof(PackEntry);
+	const std::vector<char> zeros(std::max<size_t>(alignment, static_cast<size_t>(namesOffset)), 0);
+	pack.write(zeros.data(), static_cast<std::streamsize>(namesOffset));
+	pack.write(names.data(), static_cast<std::streamsize>(names.size()));
+
+	uint64_t offset = namesOffset + names.size();
+	std::vector<uint8_t> data;
+	std::vector<uint8_t> compressed;
+	for (PackedFile& file : files)
+	{
+		const uint64_t alignedOffset = AlignUp(offset, alignment);
+		pack.write(zeros.data(), static_cast<std::streamsize>(alignedOffset - offset));
+		offset = alignedOffset;
+
+		if (!ReadWholeFile(file.myPath, data))
+		{
+			pack.close();
+			fs::remove(temporaryPath, error);
+			outReport.myError = "Couldn't read " + file.myPath.u8string();
+			return false;
+		}
+
+		PackEntry& entry = file.myEntry;
+		entry.myOffset = offset;
+		entry.mySize = data.size();
+		entry.myStoredSize = data.size();
+		entry.myCompression = PackCompression::None;
+		const uint8_t* stored = data.data();
+
+		if (someSettings.myCompress && !data.empty())
+		{
+			compressed.resize(LZ4::CompressBound(data.size()));
+			const size_t compressedSize = LZ4::Compress(data.data(), data.size(), compressed.data(), compressed.size());
+			const size_t maxSize = data.size() - static_cast<size_t>(data.size() * static_cast<double>(someSettings.myMinCompressionSaving));
+			if (compressedSize > 0 && compressedSize <= maxSize)
+			{
+				entry.myStoredSize = compressedSize;
+				entry.myCompression = PackCompression::LZ4;
+				stored = compressed.data();
+				outReport.myCompressedFileCount++;
+			}
+		}
+
+		pack.write(reinterpret_cast<const char*>(stored), static_cast<std::streamsize>(entry.myStoredSize));
+		offset += entry.myStoredSize;
+
+		outReport.myFileCount++;
+		outReport.mySize += entry.mySize;
+		outReport.myStoredSize += entry.myStoredSize;
+	}
+
+	std::vector<PackEntry> entries;
+	entries.reserve(files.size());
+	for (const PackedFile& file : files)
+	{
+		entries.push_back(file.myEntry);
+	}
+	// Entries with the same hash stay in key order, so the same files always give the same pack.
+	std::sort(entries.begin(), entries.end(), [](const PackEntry& aLeft, const PackEntry& aRight)
+	{
+		return aLeft.myHash != aRight.myHash ? aLeft.myHash < aRight.myHash : aLeft.myNameOffset < aRight.myNameOffset;
+	});
+
+	PackHeader header = {};
+	memcpy(header.myMagic, PackHeader::Magic, sizeof(header.myMagic));
+	header.myVersion = PackHeader::CurrentVersion;
+	header.myEntryCount = static_cast<uint32_t>(entries.size());
+	header.myAlignment = alignment;
+	header.myNamesOffset = namesOffset;
+	header.myNamesSize = names.size();
+
+	pack.seekp(0);
+	pack.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	pack.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(PackEntry)));
+	pack.close();
+	if (!pack)
+	{
+		fs::remove(temporaryPath, error);
+		outReport.myError = "Couldn't write " + temporaryPath.u8string();
+		return false;
+	}
+
+	fs::rename(temporaryPath, packPath, error);
+	if (error)
+	{
+		fs::remove(temporaryPath, error);
+		outReport.myError = "Couldn't replace " + packPath.u8string() + ", is it in use?";
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Tga
+{
+
+struct PackWriterSettings
+{
+	// Compresses entries with LZ4 where it pays off. Compressed entries are decompressed on every open instead of
+	// being used straight from the mapping.
+	bool myCompress = false;
+	// Entries are only kept compressed if that saves at least this part of their size.
+	float myMinCompressionSaving = 0.1f;
+	// Every entry starts at a multiple of this, a power of two.
+	uint32_t myAlignment = 16;
+};
+
+struct PackWriterReport
+{
+	size_t myFileCount = 0;
+	size_t myCompressedFileCount = 0;
+	// Sum of the entries' sizes, and of what they take in the pack.
+	uint64_t mySize = 0;
+	uint64_t myStoredSize = 0;
+	// Why writing failed, empty if it didn't.
+	std::string myError;
+};
+
+/// <summary>
+/// Writes packs for the VirtualFileSystem, see PackFile.h for the format. Used by the AssetPacker tool.
+/// </summary>
+namespace PackWriter
+{
+	/**
+	 * Packs every file under aDirectory, recursively, into aPackPath. The pack is written next to aPackPath first and
+	 * only replaces it once it is complete. aPackPath itself is left out if it is under aDirectory.
+	 * @returns false if a file can't be read, two files only differ in case, or the pack can't be written.
+	 */
+	bool PackDirectory(const std::wstring& aDirectory, const std::wstring& aPackPath, const PackWriterSettings& someSettings, PackWriterReport& outReport);
+}
+
+} // namespace Tga
@@ -0,0 +1,444 @@
+#include "stdafx.h"
+#include <tge/filesystem/VirtualFileSystem.h>
+#include <tge/filesystem/FileView.h>
+#include <tge/filesystem/LZ4.h>
+#include <tge/filesystem/PackFile.h>
+#include <tge/filewatcher/FileWatcher.h>
+#include <tge/EngineUtilities.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <mutex>
+#include <io.h>
+
+using namespace Tga;
+namespace fs = std::filesystem;
+
+namespace
+{
+	std::string JoinKey(const std::string& aDirectoryKey, const std::string& aName)
+	{
+		return aDirectoryKey.empty() ? aName : aDirectoryKey + "/" + aName;
+	}
+
+	std::string LowerCase(std::string aString)
+	{
+		for (char& c : aString)
+		{
+			if (c >= 'A' && c <= 'Z')
+			{
+				c = static_cast<char>(c - 'A' + 'a');
+			}
+		}
+		return aString;
+	}
+
+	std::wstring GetWatchPath(const std::string& aPath)
+	{
+		return aPath.empty() ? std::wstring(L".") : ToWstring(aPath);
+	}
+}
+
+std::string VirtualFileSystem::MakeKey(const std::string& aPath)
+{
+	std::string key;
+	key.reserve(aPath.size());
+
+	// Keeps the start of absolute paths, "/" or a drive like "c:/", out of the segments.
+	size_t start = 0;
+	if (aPath.size() >= 2 && aPath[1] == ':')
+	{
+		key += LowerCase(aPath.substr(0, 2));
+		start = 2;
+	}
+	if (start < aPath.size() && (aPath[start] == '/' || aPath[start] == '\\'))
+	{
+		key += '/';
+		start++;
+	}
+	const size_t rootLength = key.size();
+
+	size_t segmentStart = start;
+	for (size_t i = start; i <= aPath.size(); i++)
+	{
+		if (i < aPath.size() && aPath[i] != '/' && aPath[i] != '\\')
+		{
+			continue;
+		}
+
+		const size_t length = i - segmentStart;
+		const char* segment = aPath.data() + segmentStart;
+		segmentStart = i + 1;
+
+		if (length == 0 || (length == 1 && segment[0] == '.'))
+		{
+			continue;
+		}
+		if (length == 2 && segment[0] == '.' && segment[1] == '.')
+		{
+			// Removes the last segment unless there is none or it is a .. itself.
+			const size_t lastSlash = key.find_last_of('/');
+			const size_t lastStart = lastSlash == std::string::npos || lastSlash < rootLength ? rootLength : lastSlash + 1;
+			if (key.size() > rootLength && key.compare(lastStart, std::string::npos, "..") != 0)
+			{
+				key.resize(lastStart > rootLength ? lastStart - 1 : rootLength);
+				continue;
+			}
+			if (rootLength > 0)
+			{
+				// Above the root of an absolute path is the root.
+				continue;
+			}
+		}
+
+		if (key.size() > rootLength)
+		{
+			key += '/';
+		}
+		for (size_t c = 0; c < length; c++)
+		{
+			key += segment[c] >= 'A' && segment[c] <= 'Z' ? static_cast<char>(segment[c] - 'A' + 'a') : segment[c];
+		}
+	}
+	return key;
+}
+
+bool VirtualFileSystem::IsUnderIndexedRoot(const std::string& aKey) const
+{
+	for (const Root& root : myRoots)
+	{
+		if (!root.myIsIndexed)
+		{
+			continue;
+		}
+		if (root.myKey.empty())
+		{
+			// The working directory holds every relative path that doesn't climb out of it.
+			const bool isAbsolute = (!aKey.empty() && aKey[0] == '/') || (aKey.size() >= 2 && aKey[1] == ':');
+			const bool isAbove = aKey == ".." || aKey.compare(0, 3, "../") == 0;
+			if (!isAbsolute && !isAbove)
+			{
+				return true;
+			}
+		}
+		else if (aKey.compare(0, root.myKey.size(), root.myKey) == 0 || aKey + "/" == root.myKey)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool VirtualFileSystem::ScanDirectory(const std::string& aPath, const std::string& aKey, bool anIsRecursive, ScanResult& outResult)
+{
+	// References into an unordered_map stay valid while the recursion adds to it.
+	Directory& directory = outResult.myDirectories[aKey];
+	directory.myPath = aPath;
+
+	std::error_code error;
+	for (fs::directory_iterator it(aPath.empty() ? fs::path(".") : fs::path(aPath), fs::directory_options::skip_permission_denied, error), end; !error && it != end; it.increment(error))
+	{
+		const std::string name = it->path().filename().u8string();
+		const std::string key = JoinKey(aKey, LowerCase(name));
+
+		std::error_code typeError;
+		if (it->is_directory(typeError))
+		{
+			directory.mySubdirectories.push_back(key);
+			if (!anIsRecursive)
+			{
+				// Listed without its contents, keys are lower case but the path has to keep its case for the disk.
+				outResult.myDirectories[key].myPath = JoinKey(aPath, name);
+			}
+			else if (!ScanDirectory(JoinKey(aPath, name), key, true, outResult))
+			{
+				return false;
+			}
+			continue;
+		}
+
+		directory.myFiles.push_back(key);
+		if (++outResult.myFileCount > MaxFilesPerRoot)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void VirtualFileSystem::AddScanResult(ScanResult& aResult)
+{
+	for (auto& [key, directory] : aResult.myDirectories)
+	{
+		myEntries.insert(key);
+		myEntries.insert(directory.myFiles.begin(), directory.myFiles.end());
+		if (myFileWatcher)
+		{
+			WatchDirectory(key, directory.myPath);
+		}
+		myDirectories[key] = std::move(directory);
+	}
+}
+
+void VirtualFileSystem::RemoveDirectory(const std::string& aKey)
+{
+	auto it = myDirectories.find(aKey);
+	if (it == myDirectories.end())
+	{
+		return;
+	}
+
+	const Directory directory = std::move(it->second);
+	myDirectories.erase(it);
+	myEntries.erase(aKey);
+	// Stops watching so the directory is watched again if it comes back.
+	if (myFileWatcher && myWatchedDirectories.erase(aKey) > 0)
+	{
+		myFileWatcher->StopWatching(GetWatchPath(directory.myPath));
+	}
+	for (const std::string& file : directory.myFiles)
+	{
+		myEntries.erase(file);
+	}
+	for (const std::string& subdirectory : directory.mySubdirectories)
+	{
+		RemoveDirectory(subdirectory);
+	}
+}
+
+void VirtualFileSystem::MountDirectory(const std::string& aDirectory)
+{
+	std::string key = MakeKey(aDirectory);
+	{
+		std::shared_lock<std::shared_mutex> lock(myMutex);
+		if (IsUnderIndexedRoot(key.empty() ? std::string(".") : key))
+		{
+			return;
+		}
+	}
+
+	// The working directory is scanned as "" so its keys don't start with "./".
+	std::string path = key.empty() ? std::string() : aDirectory;
+	while (path.size() > 1 && (path.back() == '/' || path.back() == '\\'))
+	{
+		path.pop_back();
+	}
+
+	// Roots that are too large to index are looked up on disk instead.
+	ScanResult result;
+	const bool isIndexed = ScanDirectory(path, key, true, result);
+
+	std::unique_lock<std::shared_mutex> lock(myMutex);
+	Root root;
+	root.myKey = key.empty() ? key : key + "/";
+	root.myIsIndexed = isIndexed;
+	myRoots.push_back(root);
+	if (isIndexed)
+	{
+		AddScanResult(result);
+	}
+}
+
+bool VirtualFileSystem::MountPack(const std::string& aPackPath, const std::string& aDirectory)
+{
+	std::shared_ptr<PackFile> pack = std::make_shared<PackFile>();
+	if (!pack->Open(ToWstring(aPackPath)))
+	{
+		return false;
+	}
+
+	const std::string key = MakeKey(aDirectory);
+	MountedPack mountedPack;
+	mountedPack.myKey = key.empty() ? key : key + "/";
+	mountedPack.myPack = std::move(pack);
+
+	std::unique_lock<std::shared_mutex> lock(myMutex);
+	myPacks.push_back(std::move(mountedPack));
+	return true;
+}
+
+const PackEntry* VirtualFileSystem::FindPacked(const std::string& aKey, std::shared_ptr<const PackFile>* outPack) const
+{
+	for (auto it = myPacks.rbegin(); it != myPacks.rend(); ++it)
+	{
+		if (aKey.size() <= it->myKey.size() || aKey.compare(0, it->myKey.size(), it->myKey) != 0)
+		{
+			continue;
+		}
+
+		if (const PackEntry* entry = it->myPack->Find(aKey.substr(it->myKey.size())))
+		{
+			if (outPack)
+			{
+				*outPack = it->myPack;
+			}
+			return entry;
+		}
+	}
+	return nullptr;
+}
+
+void VirtualFileSystem::WatchForChanges(FileWatcher& aFileWatcher)
+{
+	std::unique_lock<std::shared_mutex> lock(myMutex);
+	myFileWatcher = &aFileWatcher;
+	for (const auto& [key, directory] : myDirectories)
+	{
+		WatchDirectory(key, directory.myPath);
+	}
+}
+
+void VirtualFileSystem::WatchDirectory(const std::string& aKey, const std::string& aPath)
+{
+	if (!myWatchedDirectories.insert(aKey).second)
+	{
+		return;
+	}
+
+	// Called back when files are added to, removed from or renamed in the directory.
+	myFileWatcher->WatchFileChange(GetWatchPath(aPath), [this, aKey](const std::wstring&)
+	{
+		OnDirectoryChanged(aKey);
+	});
+}
+
+void VirtualFileSystem::OnDirectoryChanged(const std::string& aKey)
+{
+	std::string path;
+	{
+		std::shared_lock<std::shared_mutex> lock(myMutex);
+		auto it = myDirectories.find(aKey);
+		if (it == myDirectories.end())
+		{
+			return;
+		}
+		path = it->second.myPath;
+	}
+
+	ScanResult result;
+	if (!ScanDirectory(path, aKey, false, result))
+	{
+		return;
+	}
+
+	std::unique_lock<std::shared_mutex> lock(myMutex);
+	Directory& directory = myDirectories[aKey];
+	const Directory& scanned = result.myDirectories[aKey];
+
+	for (const std::string& file : directory.myFiles)
+	{
+		myEntries.erase(file);
+	}
+	directory.myFiles = scanned.myFiles;
+	myEntries.insert(directory.myFiles.begin(), directory.myFiles.end());
+
+	// Removed subdirectories take their files with them, new ones are scanned in full.
+	const std::vector<std::string> oldSubdirectories = std::move(directory.mySubdirectories);
+	directory.mySubdirectories = scanned.mySubdirectories;
+	for (const std::string& subdirectory : oldSubdirectories)
+	{
+		if (std::find(scanned.mySubdirectories.begin(), scanned.mySubdirectories.end(), subdirectory) == scanned.mySubdirectories.end())
+		{
+			RemoveDirectory(subdirectory);
+		}
+	}
+
+	std::vector<std::pair<std::string, std::string>> added;
+	for (const std::string& subdirectory : scanned.mySubdirectories)
+	{
+		if (myDirectories.find(subdirectory) == myDirectories.end())
+		{
+			added.push_back({ subdirectory, result.myDirectories[subdirectory].myPath });
+		}
+	}
+	lock.unlock();
+
+	for (const auto& [key, subdirectoryPath] : added)
+	{
+		ScanResult subdirectoryResult;
+		ScanDirectory(subdirectoryPath, key, true, subdirectoryResult);
+
+		lock.lock();
+		AddScanResult(subdirectoryResult);
+		lock.unlock();
+	}
+}
+
+bool VirtualFileSystem::Exists(const std::string& aPath)
+{
+	const std::string key = MakeKey(aPath);
+	{
+		std::shared_lock<std::shared_mutex> lock(myMutex);
+		if (myEntries.find(key) != myEntries.end() || FindPacked(key, nullptr))
+		{
+			return true;
+		}
+		if (IsUnderIndexedRoot(key))
+		{
+			return false;
+		}
+	}
+
+	// Not added to myEntries: nothing watches these paths, so a file deleted later would still be found, and an
+	// entry would hide a pack that has the same path from Open.
+	return _access_s(aPath.c_str(), 0) == 0;
+}
+
+bool VirtualFileSystem::Open(const std::string& aPath, FileView& outFile)
+{
+	return Open(MakeKey(aPath), ToWstring(aPath), outFile);
+}
+
+bool VirtualFileSystem::Open(const std::wstring& aPath, FileView& outFile)
+{
+	return Open(MakeKey(FromWstring(aPath)), aPath, outFile);
+}
+
+bool VirtualFileSystem::Open(const std::string& aKey, const std::wstring& aPath, FileView& outFile)
+{
+	outFile.Close();
+
+	const PackEntry* entry = nullptr;
+	std::shared_ptr<const PackFile> pack;
+	{
+		std::shared_lock<std::shared_mutex> lock(myMutex);
+		if (myEntries.find(aKey) == myEntries.end())
+		{
+			entry = FindPacked(aKey, &pack);
+		}
+	}
+
+	if (!entry)
+	{
+		if (!outFile.myFile.Open(aPath))
+		{
+			return false;
+		}
+		outFile.myData = outFile.myFile.GetData();
+		outFile.mySize = outFile.myFile.GetSize();
+		return true;
+	}
+
+	if (entry->myCompression == PackCompression::LZ4)
+	{
+		outFile.myDecompressed.resize(static_cast<size_t>(entry->mySize));
+		if (!LZ4::Decompress(pack->GetData(*entry), static_cast<size_t>(entry->myStoredSize), outFile.myDecompressed.data(), outFile.myDecompressed.size()))
+		{
+			outFile.Close();
+			return false;
+		}
+
+		// An empty entry has no buffer to point to, it points into the pack like a stored entry so it reads as open.
+		if (!outFile.myDecompressed.empty())
+		{
+			outFile.myData = outFile.myDecompressed.data();
+			outFile.mySize = outFile.myDecompressed.size();
+			return true;
+		}
+	}
+
+	outFile.myPack = std::move(pack);
+	outFile.myData = outFile.myPack->GetData(*entry);
+	outFile.mySize = static_cast<size_t>(entry->mySize);
+	return true;
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Tga
+{
+
+class FileView;
+class FileWatcher;
+class PackFile;
+struct PackEntry;
+
+/// <summary>
+/// In-memory index of every file under the mounted asset roots, so asset paths are resolved without probing the disk.
+/// Roots are scanned once when they are mounted and kept up to date by watching their directories. Packs mounted on
+/// top of them serve their files from one mapping, as if they were loose files in the directory that was packed.
+/// Safe to call from any thread.
+/// </summary>
+class VirtualFileSystem
+{
+public:
+	// Roots with more files than this aren't indexed, paths under them are checked on disk like paths outside any root.
+	static constexpr size_t MaxFilesPerRoot = 200000;
+
+	VirtualFileSystem() = default;
+	VirtualFileSystem(const VirtualFileSystem&) = delete;
+	VirtualFileSystem& operator=(const VirtualFileSystem&) = delete;
+
+	/**
+	 * Scans aDirectory recursively and indexes its files. "" is the working directory. Mounting a directory that is
+	 * already under a mounted root does nothing.
+	 */
+	void MountDirectory(const std::string& aDirectory);
+
+	/**
+	 * Maps a pack made by the AssetPacker and serves its files under aDirectory, the directory it was packed from.
+	 * Packs mounted later take precedence over earlier ones, and loose files under a mounted root take precedence
+	 * over every pack, so edited assets are used without packing them again.
+	 * @returns false if the pack can't be opened or isn't valid.
+	 */
+	bool MountPack(const std::string& aPackPath, const std::string& aDirectory);
+
+	/**
+	 * Watches every indexed directory, so files that are added or removed later are picked up when the file watcher
+	 * flushes its changes. Without it new files under a root are only found once the root is mounted again.
+	 */
+	void WatchForChanges(FileWatcher& aFileWatcher);
+
+	/**
+	 * @returns true if aPath is a file or directory. Paths under a mounted root are answered from the index. Other
+	 * paths are checked on disk every time.
+	 */
+	bool Exists(const std::string& aPath);
+
+	/**
+	 * Opens a file for reading, from the pack that has it or from disk. Uncompressed pack entries aren't copied.
+	 * @returns false if the file doesn't exist or can't be read.
+	 */
+	bool Open(const std::string& aPath, FileView& outFile);
+	bool Open(const std::wstring& aPath, FileView& outFile);
+
+	/**
+	 * Lower case, / separated and without . or .. segments that can be removed, so every spelling of a path gives the
+	 * same key.
+	 */
+	static std::string MakeKey(const std::string& aPath);
+
+private:
+	struct Root
+	{
+		// Key of the root directory followed by a /, or empty for the working directory.
+		std::string myKey;
+		bool myIsIndexed = false;
+	};
+
+	struct MountedPack
+	{
+		// Like Root::myKey, for the directory the pack is mounted as.
+		std::string myKey;
+		std::shared_ptr<const PackFile> myPack;
+	};
+
+	struct Directory
+	{
+		std::string myPath;
+		std::vector<std::string> myFiles;
+		std::vector<std::string> mySubdirectories;
+	};
+
+	struct ScanResult
+	{
+		std::unordered_map<std::string, Directory> myDirectories;
+		size_t myFileCount = 0;
+	};
+
+	static bool ScanDirectory(const std::string& aPath, const std::string& aKey, bool anIsRecursive, ScanResult& outResult);
+	void AddScanResult(ScanResult& aResult);
+	void RemoveDirectory(const std::string& aKey);
+	void WatchDirectory(const std::string& aKey, const std::string& aPath);
+	void OnDirectoryChanged(const std::string& aKey);
+	bool IsUnderIndexedRoot(const std::string& aKey) const;
+	const PackEntry* FindPacked(const std::string& aKey, std::shared_ptr<const PackFile>* outPack) const;
+	bool Open(const std::string& aKey, const std::wstring& aPath, FileView& outFile);
+
+	std::vector<Root> myRoots;
+	std::vector<MountedPack> myPacks;
+	// Keys of every indexed file and directory.
+	std::unordered_set<std::string> myEntries;
+	// Keyed like myEntries, so a directory that changed can be listed again.
+	std::unordered_map<std::string, Directory> myDirectories;
+	std::unordered_set<std::string> myWatchedDirectories;
+	FileWatcher* myFileWatcher = nullptr;
+	mutable std::shared_mutex myMutex;
+};
+
+} // namespace Tga
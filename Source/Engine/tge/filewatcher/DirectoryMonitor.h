@@ -0,0 +1,44 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace Tga
+{
+
+/// <summary>
+/// The platform part of the FileWatcher. Keeps one operating system watch per directory, ReadDirectoryChangesW on
+/// Windows and inotify on Linux, and reports what happens in them from a thread of its own. The thread is blocked in
+/// the operating system while nothing changes.
+/// </summary>
+class DirectoryMonitor
+{
+public:
+	/**
+	 * Called on the monitor's thread for every change in a watched directory.
+	 * @param aDirectory The directory as it was passed to AddDirectory.
+	 * @param aName The name of the entry that changed. Empty if changes were lost, then anything in the directory may have changed.
+	 * @param aIsNameChange True when the entry was added, removed or renamed, false when only its contents or attributes changed.
+	 */
+	typedef std::function<void(const std::wstring& aDirectory, const std::wstring& aName, bool aIsNameChange)> EventCallback;
+
+	explicit DirectoryMonitor(EventCallback aCallback);
+	~DirectoryMonitor();
+
+	DirectoryMonitor(const DirectoryMonitor&) = delete;
+	DirectoryMonitor& operator=(const DirectoryMonitor&) = delete;
+
+	/**
+	 * Starts watching the entries directly in aDirectory, not the ones in its subdirectories. Does nothing if it is
+	 * already watched. The watch ends by itself when the directory is removed.
+	 * @returns false if the directory can't be watched.
+	 */
+	bool AddDirectory(const std::wstring& aDirectory);
+	void RemoveDirectory(const std::wstring& aDirectory);
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> myImpl;
+};
+
+} // namespace Tga
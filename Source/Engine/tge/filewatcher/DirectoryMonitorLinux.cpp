@@ -0,0 +1,214 @@
+#include "stdafx.h"
+#ifdef __linux__
+#include <tge/filewatcher/DirectoryMonitor.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+using namespace Tga;
+
+namespace
+{
+	constexpr uint32_t NameChangeMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+	constexpr uint32_t WatchMask = NameChangeMask | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_ONLYDIR;
+}
+
+struct DirectoryMonitor::Impl
+{
+	EventCallback myCallback;
+	int myInotify = -1;
+	// Written to when the thread should stop, it waits on this and the inotify descriptor.
+	int myWakeEvent = -1;
+	std::thread myThread;
+
+	std::mutex myMutex;
+	// Paths to the same directory get the same watch, so a watch has every path it was added with. It is removed with
+	// the last of them, and its events are reported for each.
+	std::unordered_map<int, std::vector<std::wstring>> myDirectories;
+	std::unordered_map<std::wstring, int> myWatches;
+
+	void Run();
+	void OnEvent(const inotify_event& anEvent);
+};
+
+DirectoryMonitor::DirectoryMonitor(EventCallback aCallback)
+	: myImpl(std::make_unique<Impl>())
+{
+	myImpl->myCallback = std::move(aCallback);
+	myImpl->myInotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	myImpl->myWakeEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (myImpl->myInotify >= 0 && myImpl->myWakeEvent >= 0)
+	{
+		myImpl->myThread = std::thread(&Impl::Run, myImpl.get());
+	}
+}
+
+DirectoryMonitor::~DirectoryMonitor()
+{
+	if (myImpl->myThread.joinable())
+	{
+		const uint64_t wake = 1;
+		(void)write(myImpl->myWakeEvent, &wake, sizeof(wake));
+		myImpl->myThread.join();
+	}
+
+	// Closing the inotify descriptor removes all its watches.
+	if (myImpl->myInotify >= 0)
+	{
+		close(myImpl->myInotify);
+	}
+	if (myImpl->myWakeEvent >= 0)
+	{
+		close(myImpl->myWakeEvent);
+	}
+}
+
+bool DirectoryMonitor::AddDirectory(const std::wstring& aDirectory)
+{
+	if (!myImpl->myThread.joinable())
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(myImpl->myMutex);
+	if (myImpl->myWatches.find(aDirectory) != myImpl->myWatches.end())
+	{
+		return true;
+	}
+
+	const int watch = inotify_add_watch(myImpl->myInotify, std::filesystem::path(aDirectory).c_str(), WatchMask);
+	if (watch < 0)
+	{
+		return false;
+	}
+
+	myImpl->myDirectories[watch].push_back(aDirectory);
+	myImpl->myWatches[aDirectory] = watch;
+	return true;
+}
+
+void DirectoryMonitor::RemoveDirectory(const std::wstring& aDirectory)
+{
+	std::lock_guard<std::mutex> lock(myImpl->myMutex);
+	auto it = myImpl->myWatches.find(aDirectory);
+	if (it == myImpl->myWatches.end())
+	{
+		return;
+	}
+
+	const int watch = it->second;
+	myImpl->myWatches.erase(it);
+
+	std::vector<std::wstring>& directories = myImpl->myDirectories[watch];
+	directories.erase(std::remove(directories.begin(), directories.end(), aDirectory), directories.end());
+	if (directories.empty())
+	{
+		inotify_rm_watch(myImpl->myInotify, watch);
+		myImpl->myDirectories.erase(watch);
+	}
+}
+
+void DirectoryMonitor::Impl::Run()
+{
+	alignas(inotify_event) char buffer[64 * 1024];
+	pollfd descriptors[2] = { { myInotify, POLLIN, 0 }, { myWakeEvent, POLLIN, 0 } };
+
+	for (;;)
+	{
+		if (poll(descriptors, 2, -1) < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return;
+		}
+		if (descriptors[1].revents != 0)
+		{
+			return;
+		}
+
+		for (;;)
+		{
+			const ssize_t size = read(myInotify, buffer, sizeof(buffer));
+			if (size <= 0)
+			{
+				break;
+			}
+
+			for (ssize_t offset = 0; offset < size;)
+			{
+				const inotify_event& event = *reinterpret_cast<const inotify_event*>(buffer + offset);
+				OnEvent(event);
+				offset += sizeof(inotify_event) + event.len;
+			}
+		}
+	}
+}
+
+void DirectoryMonitor::Impl::OnEvent(const inotify_event& anEvent)
+{
+	// The kernel dropped events, so every directory may have changed.
+	if (anEvent.mask & IN_Q_OVERFLOW)
+	{
+		std::vector<std::wstring> directories;
+		{
+			std::lock_guard<std::mutex> lock(myMutex);
+			for (const auto& [watch, watchDirectories] : myDirectories)
+			{
+				directories.insert(directories.end(), watchDirectories.begin(), watchDirectories.end());
+			}
+		}
+		for (const std::wstring& directory : directories)
+		{
+			myCallback(directory, std::wstring(), true);
+		}
+		return;
+	}
+
+	std::vector<std::wstring> directories;
+	{
+		std::lock_guard<std::mutex> lock(myMutex);
+		auto it = myDirectories.find(anEvent.wd);
+		if (it == myDirectories.end())
+		{
+			return;
+		}
+
+		// The directory was removed. Forget the watch and all its paths so they can be added again. A watch removed by
+		// RemoveDirectory is already forgotten.
+		if (anEvent.mask & IN_IGNORED)
+		{
+			for (const std::wstring& directory : it->second)
+			{
+				myWatches.erase(directory);
+			}
+			myDirectories.erase(it);
+			return;
+		}
+
+		if (anEvent.len == 0)
+		{
+			return;
+		}
+		directories = it->second;
+	}
+
+	const std::wstring name = std::filesystem::path(anEvent.name).wstring();
+	for (const std::wstring& directory : directories)
+	{
+		myCallback(directory, name, (anEvent.mask & NameChangeMask) != 0);
+	}
+}
+
+#endif
@@ -0,0 +1,209 @@
+#include "stdafx.h"
+#ifdef _WIN32
+#include <tge/filewatcher/DirectoryMonitor.h>
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace Tga;
+
+namespace
+{
+	constexpr DWORD NotifyFilter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE;
+
+	struct Watch
+	{
+		std::wstring myDirectory;
+		HANDLE myHandle = INVALID_HANDLE_VALUE;
+		OVERLAPPED myOverlapped = {};
+		// Set by RemoveDirectory, the thread deletes the watch when its read comes back cancelled.
+		bool myIsRemoved = false;
+		alignas(DWORD) BYTE myBuffer[64 * 1024];
+	};
+}
+
+struct DirectoryMonitor::Impl
+{
+	EventCallback myCallback;
+	// Every directory handle completes its reads here, the thread blocks on it.
+	HANDLE myCompletionPort = nullptr;
+	std::thread myThread;
+
+	std::mutex myMutex;
+	std::unordered_map<std::wstring, Watch*> myWatches;
+	// Includes removed watches whose cancelled read hasn't come back yet.
+	std::unordered_set<Watch*> myPendingWatches;
+
+	void Run();
+	bool Read(Watch& aWatch);
+	void Delete(Watch* aWatch);
+};
+
+DirectoryMonitor::DirectoryMonitor(EventCallback aCallback)
+	: myImpl(std::make_unique<Impl>())
+{
+	myImpl->myCallback = std::move(aCallback);
+	myImpl->myCompletionPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+	if (myImpl->myCompletionPort)
+	{
+		myImpl->myThread = std::thread(&Impl::Run, myImpl.get());
+	}
+}
+
+DirectoryMonitor::~DirectoryMonitor()
+{
+	if (myImpl->myThread.joinable())
+	{
+		// A packet without a watch tells the thread to stop.
+		PostQueuedCompletionStatus(myImpl->myCompletionPort, 0, 0, nullptr);
+		myImpl->myThread.join();
+	}
+
+	// The reads still in flight have to finish before their buffers can be freed.
+	for (Watch* watch : myImpl->myPendingWatches)
+	{
+		DWORD size = 0;
+		CancelIoEx(watch->myHandle, &watch->myOverlapped);
+		GetOverlappedResult(watch->myHandle, &watch->myOverlapped, &size, TRUE);
+		CloseHandle(watch->myHandle);
+		delete watch;
+	}
+
+	if (myImpl->myCompletionPort)
+	{
+		CloseHandle(myImpl->myCompletionPort);
+	}
+}
+
+bool DirectoryMonitor::AddDirectory(const std::wstring& aDirectory)
+{
+	if (!myImpl->myThread.joinable())
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(myImpl->myMutex);
+	if (myImpl->myWatches.find(aDirectory) != myImpl->myWatches.end())
+	{
+		return true;
+	}
+
+	// Shared for delete as well, so the watch doesn't stop the directory from being removed or renamed.
+	HANDLE handle = CreateFileW(aDirectory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+		OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	Watch* watch = new Watch();
+	watch->myDirectory = aDirectory;
+	watch->myHandle = handle;
+	if (!CreateIoCompletionPort(handle, myImpl->myCompletionPort, reinterpret_cast<ULONG_PTR>(watch), 0) || !myImpl->Read(*watch))
+	{
+		CloseHandle(handle);
+		delete watch;
+		return false;
+	}
+
+	myImpl->myWatches[aDirectory] = watch;
+	myImpl->myPendingWatches.insert(watch);
+	return true;
+}
+
+void DirectoryMonitor::RemoveDirectory(const std::wstring& aDirectory)
+{
+	std::lock_guard<std::mutex> lock(myImpl->myMutex);
+	auto it = myImpl->myWatches.find(aDirectory);
+	if (it == myImpl->myWatches.end())
+	{
+		return;
+	}
+
+	it->second->myIsRemoved = true;
+	CancelIoEx(it->second->myHandle, &it->second->myOverlapped);
+	myImpl->myWatches.erase(it);
+}
+
+bool DirectoryMonitor::Impl::Read(Watch& aWatch)
+{
+	aWatch.myOverlapped = {};
+	return ReadDirectoryChangesW(aWatch.myHandle, aWatch.myBuffer, sizeof(aWatch.myBuffer), FALSE, NotifyFilter, nullptr, &aWatch.myOverlapped, nullptr) != FALSE;
+}
+
+void DirectoryMonitor::Impl::Delete(Watch* aWatch)
+{
+	auto it = myWatches.find(aWatch->myDirectory);
+	if (it != myWatches.end() && it->second == aWatch)
+	{
+		myWatches.erase(it);
+	}
+	myPendingWatches.erase(aWatch);
+	CloseHandle(aWatch->myHandle);
+	delete aWatch;
+}
+
+void DirectoryMonitor::Impl::Run()
+{
+	for (;;)
+	{
+		DWORD size = 0;
+		ULONG_PTR key = 0;
+		OVERLAPPED* overlapped = nullptr;
+		const BOOL succeeded = GetQueuedCompletionStatus(myCompletionPort, &size, &key, &overlapped, INFINITE);
+		// The stop packet from the destructor, or the port itself failed.
+		if (!overlapped)
+		{
+			return;
+		}
+
+		// The buffer overflowed and the changes were lost. Depending on the Windows version the read fails with this or
+		// completes without data, either way the directory is still there to watch.
+		const bool isOverflow = !succeeded && GetLastError() == ERROR_NOTIFY_ENUM_DIR;
+
+		Watch* watch = reinterpret_cast<Watch*>(key);
+		{
+			// Removed or failed, the directory is most likely gone.
+			std::lock_guard<std::mutex> lock(myMutex);
+			if ((!succeeded && !isOverflow) || watch->myIsRemoved)
+			{
+				Delete(watch);
+				continue;
+			}
+		}
+
+		// A read that completes without data overflowed too.
+		if (isOverflow || size == 0)
+		{
+			myCallback(watch->myDirectory, std::wstring(), true);
+		}
+		else
+		{
+			for (DWORD offset = 0;;)
+			{
+				const FILE_NOTIFY_INFORMATION& information = *reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(watch->myBuffer + offset);
+				const std::wstring name(information.FileName, information.FileNameLength / sizeof(WCHAR));
+				myCallback(watch->myDirectory, name, information.Action != FILE_ACTION_MODIFIED);
+
+				if (information.NextEntryOffset == 0)
+				{
+					break;
+				}
+				offset += information.NextEntryOffset;
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(myMutex);
+		if (watch->myIsRemoved || !Read(*watch))
+		{
+			Delete(watch);
+		}
+	}
+}
+
+#endif
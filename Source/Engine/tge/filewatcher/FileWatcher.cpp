@@ -1,160 +1,227 @@
 #include "stdafx.h"
 #include <tge/filewatcher/FileWatcher.h>
-#define WIN32_LEAN_AND_MEAN 
-#define NOMINMAX 
-#include <windows.h>
-#include <fstream>
+#include <tge/filewatcher/DirectoryMonitor.h>
 #include <algorithm>
+#include <cwctype>
+#include <filesystem>
 
 using namespace Tga;
 namespace fs = std::filesystem;
-FileWatcher::FileWatcher()
-	: myThread(nullptr)
-	, myShouldEndThread(false)
-	, myThreadIsDone(false)
 
+namespace
 {
-}
+	// How long a path has to be left alone before its change is reported.
+	constexpr std::chrono::milliseconds SettleTime(100);
 
+	std::wstring NormalizeName(std::wstring aName)
+	{
+#ifdef _WIN32
+		// Windows paths ignore case, so the keys do too.
+		std::transform(aName.begin(), aName.end(), aName.begin(), [](wchar_t c) { return static_cast<wchar_t>(std::towlower(c)); });
+#endif
+		return aName;
+	}
 
-FileWatcher::~FileWatcher()
-{
-	myShouldEndThread = true;
-	if (myThread)
+	// Absolute and normalized, so every way of writing a path gives the same key.
+	std::wstring MakeKey(const std::wstring& aPath)
 	{
-		while (!myThreadIsDone)
+		std::error_code error;
+		std::wstring key = NormalizeName(fs::absolute(aPath, error).lexically_normal().generic_wstring());
+		if (key.size() > 1 && key.back() == L'/' && key[key.size() - 2] != L':')
 		{
-			std::this_thread::sleep_for(std::chrono::nanoseconds(1));
+			key.pop_back();
 		}
-		myThread->join();
-		delete myThread;
+		return key;
 	}
 
+	std::wstring JoinKey(const std::wstring& aDirectory, const std::wstring& aName)
+	{
+		return (fs::path(aDirectory) / aName).generic_wstring();
+	}
 }
 
+FileWatcher::FileWatcher(bool anIsEnabled)
+	: myHasPendingChanges(false)
+	, myIsEnabled(anIsEnabled)
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+	// Stops the monitor's thread before the state it reports into goes away.
+	myMonitor.reset();
+}
 
 void FileWatcher::FlushChanges()
 {
-	if (!Engine::GetInstance()->IsDebugFeatureOn(DebugFeature::Filewatcher) || !myThread)
+	if (!myIsEnabled || !myHasPendingChanges.load(std::memory_order_acquire))
 	{
 		return;
 	}
-	std::lock_guard<std::mutex> guard(myMutex);
 
-	myFileChanged.swap(myFileChangedThreaded);
-
-	for (fs::path& theString : myFileChanged)
+	std::vector<std::wstring> changes;
 	{
-		std::wstring comparrableStringFromPath = theString.wstring();
-		std::replace(comparrableStringFromPath.begin(), comparrableStringFromPath.end(), '\\', '#');
-		std::replace(comparrableStringFromPath.begin(), comparrableStringFromPath.end(), '/', '#');
-		std::vector<callback_function_file> callbacks = myCallbacks[comparrableStringFromPath];
-		for (unsigned int i = 0; i < callbacks.size(); i++)
+		std::lock_guard<std::mutex> guard(myMutex);
+		const std::chrono::steady_clock::time_point settled = std::chrono::steady_clock::now() - SettleTime;
+		for (auto it = myPendingChanges.begin(); it != myPendingChanges.end();)
 		{
-			if (callbacks[i])
+			if (it->second <= settled)
+			{
+				changes.push_back(it->first);
+				it = myPendingChanges.erase(it);
+			}
+			else
 			{
-				callbacks[i](theString.wstring());
+				++it;
 			}
 		}
+		myHasPendingChanges.store(!myPendingChanges.empty(), std::memory_order_release);
 	}
 
-
-	myFileChanged.clear();
-
-
-}
-
-long long GetFileTimeStamp(const fs::path& aFilePath)
-{
-	if (std::filesystem::exists(aFilePath) == false)
-	{
-		return 0;
-	}
-	return std::filesystem::last_write_time(aFilePath).time_since_epoch().count();
-}
-
-
-void FileWatcher::UpdateChanges()
-{
-	while (!myShouldEndThread)
+	for (const std::wstring& key : changes)
 	{
-		myMutex.lock();
-		myAddNewFolderMutex.lock();
+		auto it = myCallbacks.find(key);
+		if (it == myCallbacks.end())
+		{
+			continue;
+		}
 
-		for (auto& iter : myThreadedFilesToWatch)
+		// Copied, the callbacks may watch or stop watching paths themselves.
+		const std::vector<Callback> callbacks = it->second;
+		for (const Callback& callback : callbacks)
 		{
-			CheckFileChages(iter.first, iter.second);
+			if (callback.myFunction)
+			{
+				callback.myFunction(callback.myPath);
+			}
 		}
-		
-		myMutex.unlock();
-		myAddNewFolderMutex.unlock();
-	
-		std::this_thread::sleep_for(std::chrono::milliseconds(32));
 	}
-	myThreadIsDone = true;
 }
 
-void FileWatcher::CheckFileChages(const fs::path& aFile, long long aTimeStampLastChanged)
+void FileWatcher::OnDirectoryEvent(const std::wstring& aDirectory, const std::wstring& aName, bool aIsNameChange)
 {
-	long long latestTimeStamp = GetFileTimeStamp(aFile);
-	if (latestTimeStamp > aTimeStampLastChanged)
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	std::lock_guard<std::mutex> guard(myMutex);
+	auto it = myDirectories.find(aDirectory);
+	if (it == myDirectories.end())
 	{
-		OnFileChange(aFile);
-		myThreadedFilesToWatch[aFile] = latestTimeStamp;
+		return;
 	}
-}
 
-void FileWatcher::OnFileChange(const fs::path& aFile)
-{
-	for (unsigned int i = 0; i < myFileChangedThreaded.size(); i++)
+	const WatchedDirectory& directory = it->second;
+	const size_t pendingCount = myPendingChanges.size();
+	if (aName.empty())
 	{
-		if (myFileChangedThreaded[i].compare(aFile) == 0)
+		// Changes were lost, so everything watched in the directory may have changed.
+		if (directory.myIsWatched)
 		{
-			return;
+			myPendingChanges[aDirectory] = now;
+		}
+		for (const std::wstring& file : directory.myFiles)
+		{
+			myPendingChanges[JoinKey(aDirectory, file)] = now;
 		}
 	}
+	else
+	{
+		if (aIsNameChange && directory.myIsWatched)
+		{
+			myPendingChanges[aDirectory] = now;
+		}
 
-	myFileChangedThreaded.push_back(aFile);
+		const std::wstring name = NormalizeName(aName);
+		if (directory.myFiles.find(name) != directory.myFiles.end())
+		{
+			myPendingChanges[JoinKey(aDirectory, name)] = now;
+		}
+	}
 
-}
-bool CheckIsFileExits(const wchar_t * aFilePath)
-{
-	return std::filesystem::exists(aFilePath);
+	if (myPendingChanges.size() != pendingCount)
+	{
+		myHasPendingChanges.store(true, std::memory_order_release);
+	}
 }
 
-
 bool FileWatcher::WatchFileChange(std::wstring aFile, callback_function_file aFunctionToCallOnChange)
 {
-	if (!Engine::GetInstance()->IsDebugFeatureOn(DebugFeature::Filewatcher))
+	if (!myIsEnabled)
 	{
 		return false;
 	}
 
-	if (!CheckIsFileExits(aFile.c_str()))
+	std::error_code error;
+	const fs::file_status status = fs::status(aFile, error);
+	if (!fs::exists(status))
 	{
 		return false;
 	}
 
-	std::wstring comparrableStringFromPath = aFile;
-	std::replace(comparrableStringFromPath.begin(), comparrableStringFromPath.end(), '\\', '#');
-	std::replace(comparrableStringFromPath.begin(), comparrableStringFromPath.end(), '/', '#');
-
-	myCallbacks[comparrableStringFromPath].push_back(aFunctionToCallOnChange);
+	// Files are watched through the directory they are in.
+	const std::wstring key = MakeKey(aFile);
+	const bool isDirectory = fs::is_directory(status);
+	const std::wstring directory = isDirectory ? key : fs::path(key).parent_path().generic_wstring();
 
-	long long timeStampChanged = GetFileTimeStamp(aFile.c_str());
-	if (myThread)
+	if (!myMonitor)
 	{
-		myAddNewFolderMutex.lock();
-		myThreadedFilesToWatch[aFile] = timeStampChanged;
-		myAddNewFolderMutex.unlock();
+		myMonitor = std::make_unique<DirectoryMonitor>([this](const std::wstring& aDirectory, const std::wstring& aName, bool aIsNameChange)
+		{
+			OnDirectoryEvent(aDirectory, aName, aIsNameChange);
+		});
 	}
-	else
+	if (!myMonitor->AddDirectory(directory))
 	{
-		myThreadedFilesToWatch[aFile] = timeStampChanged;
-		myThread = new std::thread(&FileWatcher::UpdateChanges, this);
+		return false;
 	}
 
+	{
+		std::lock_guard<std::mutex> guard(myMutex);
+		WatchedDirectory& watchedDirectory = myDirectories[directory];
+		if (isDirectory)
+		{
+			watchedDirectory.myIsWatched = true;
+		}
+		else
+		{
+			watchedDirectory.myFiles.insert(fs::path(key).filename().wstring());
+		}
+	}
 
+	myCallbacks[key].push_back({ aFile, std::move(aFunctionToCallOnChange) });
 	return true;
 }
 
+void FileWatcher::StopWatching(const std::wstring& aPath)
+{
+	const std::wstring key = MakeKey(aPath);
+	if (myCallbacks.erase(key) == 0)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> guard(myMutex);
+	myPendingChanges.erase(key);
+
+	auto directory = myDirectories.find(key);
+	if (directory != myDirectories.end() && directory->second.myIsWatched)
+	{
+		directory->second.myIsWatched = false;
+	}
+	else
+	{
+		const fs::path path(key);
+		directory = myDirectories.find(path.parent_path().generic_wstring());
+		if (directory == myDirectories.end())
+		{
+			return;
+		}
+		directory->second.myFiles.erase(path.filename().wstring());
+	}
+
+	// Nothing left to watch in the directory.
+	if (!directory->second.myIsWatched && directory->second.myFiles.empty())
+	{
+		myMonitor->RemoveDirectory(directory->first);
+		myDirectories.erase(directory);
+	}
+}
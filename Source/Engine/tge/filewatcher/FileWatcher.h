@@ -1,40 +1,73 @@
 #pragma once
+#include <atomic>
+#include <chrono>
 #include <functional>
-#include <thread>
+#include <map>
+#include <memory>
 #include <mutex>
-#include <filesystem>
-namespace fs = std::filesystem;
+#include <set>
+#include <string>
+#include <vector>
 namespace Tga
 {
 	typedef std::function<void(const std::wstring&)> callback_function_file;
+
+	class DirectoryMonitor;
+
+	/// <summary>
+	/// Calls back when watched files change, or when entries are added to, removed from or renamed in watched directories.
+	/// The operating system reports changes per directory, so nothing is polled. Changes to the same path are merged and
+	/// only reported once the path has been quiet for a moment, so a save that writes a file in several steps reloads it once.
+	/// </summary>
 	class FileWatcher
 	{
 	public:
-		FileWatcher();
+		/**
+		 * @param anIsEnabled A disabled watcher watches nothing, the engine only enables its own with the file
+		 * watcher debug feature.
+		 */
+		explicit FileWatcher(bool anIsEnabled = true);
 		~FileWatcher();
 
-		/* Will check the file for includes and add them as well*/
+		/**
+		 * Watches a file for changes, or a directory for entries being added, removed or renamed.
+		 * @param aFunctionToCallOnChange Called from FlushChanges with aFile as it was passed here.
+		 * @returns false if the path doesn't exist, can't be watched, or the watcher is disabled.
+		 */
 		bool WatchFileChange(std::wstring aFile, callback_function_file aFunctionToCallOnChange);
 
+		/** Removes every callback for aPath. */
+		void StopWatching(const std::wstring& aPath);
+
+		/** Calls back for the changes that have settled. Costs next to nothing when nothing changed. */
 		void FlushChanges();
 	private:
-		void UpdateChanges();
-		void CheckFileChages(const fs::path& aFile, long long aTimeStampLastChanged);
-		void OnFileChange(const fs::path& aFile);
-		std::thread* myThread;
+		struct Callback
+		{
+			std::wstring myPath;
+			callback_function_file myFunction;
+		};
+
+		struct WatchedDirectory
+		{
+			// Whether the directory itself is watched, or only files in it.
+			bool myIsWatched = false;
+			std::set<std::wstring> myFiles;
+		};
 
-		typedef std::map<std::wstring, std::vector<WIN32_FIND_DATA>> FolderMap;
-		FolderMap myFolders;
+		// Called on the monitor's thread.
+		void OnDirectoryEvent(const std::wstring& aDirectory, const std::wstring& aName, bool aIsNameChange);
 
-		std::vector<fs::path> myFileChangedThreaded;
-		std::vector<fs::path> myFileChanged;
-		std::map<std::wstring, std::vector<callback_function_file> > myCallbacks;
-		std::map<fs::path, long long> myThreadedFilesToWatch;
+		std::unique_ptr<DirectoryMonitor> myMonitor;
+		std::map<std::wstring, std::vector<Callback>> myCallbacks;
 
+		// Guards the directories and pending changes, shared with the monitor's thread.
 		std::mutex myMutex;
-		std::mutex myAddNewFolderMutex;
-		bool myShouldEndThread;
-		bool myThreadIsDone;
+		std::map<std::wstring, WatchedDirectory> myDirectories;
+		// The last time each changed path was reported.
+		std::map<std::wstring, std::chrono::steady_clock::time_point> myPendingChanges;
+		std::atomic<bool> myHasPendingChanges;
+		const bool myIsEnabled;
 	};
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,139 @@
+#include "stdafx.h"
+#include "DX11RenderBackend.h"
+
+#include <cstring>
+#include <d3d11.h>
+#include <tge/graphics/DX11.h>
+#include <tge/render/RenderCommandBuffer.h>
+
+using namespace Tga;
+
+namespace
+{
+	D3D11_PRIMITIVE_TOPOLOGY ToD3D11(RenderTopology aTopology)
+	{
+		switch (aTopology)
+		{
+		case RenderTopology::LineList:
+			return D3D11_PRIMITIVE_TOPOLOGY_LINELIST;
+		case RenderTopology::TriangleList:
+		default:
+			return D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+		}
+	}
+
+	DXGI_FORMAT ToD3D11(RenderIndexFormat aFormat)
+	{
+		return aFormat == RenderIndexFormat::UInt16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+	}
+}
+
+void DX11RenderBackend::Execute(const RenderCommandBuffer& aCommands)
+{
+	ID3D11DeviceContext* context = DX11::Context;
+
+	const RenderCommand* commands = aCommands.GetCommands();
+	const size_t count = aCommands.GetCommandCount();
+	for (size_t i = 0; i < count; i++)
+	{
+		const RenderCommand& command = commands[i];
+		switch (command.Type)
+		{
+		case RenderCommandType::SetShaders:
+			context->VSSetShader(command.Shaders.VertexShader, nullptr, 0);
+			context->PSSetShader(command.Shaders.PixelShader, nullptr, 0);
+			break;
+		case RenderCommandType::SetInputLayout:
+			context->IASetInputLayout(command.InputLayout.Layout);
+			break;
+		case RenderCommandType::SetTopology:
+			context->IASetPrimitiveTopology(ToD3D11(command.Topology.Topology));
+			break;
+		case RenderCommandType::SetVertexBuffers:
+		{
+			const RenderCommand::VertexBuffersData& data = command.VertexBuffers;
+			context->IASetVertexBuffers(data.StartSlot, data.Count, data.Buffers, data.Strides, data.Offsets);
+			break;
+		}
+		case RenderCommandType::SetIndexBuffer:
+			context->IASetIndexBuffer(command.IndexBuffer.Buffer, ToD3D11(command.IndexBuffer.Format), command.IndexBuffer.Offset);
+			break;
+		case RenderCommandType::SetConstantBuffer:
+		{
+			const RenderCommand::ConstantBufferData& data = command.ConstantBuffer;
+			if (data.Stages & RenderStage_Vertex)
+			{
+				context->VSSetConstantBuffers(data.Slot, 1, &data.Buffer);
+			}
+			if (data.Stages & RenderStage_Pixel)
+			{
+				context->PSSetConstantBuffers(data.Slot, 1, &data.Buffer);
+			}
+			break;
+		}
+		case RenderCommandType::SetShaderResources:
+			context->PSSetShaderResources(command.ShaderResources.StartSlot, command.ShaderResources.Count, command.ShaderResources.Views);
+			break;
+		case RenderCommandType::SetBlendState:
+			context->OMSetBlendState(command.BlendState.State, nullptr, 0xffffffff);
+			break;
+		case RenderCommandType::SetDepthStencilState:
+			context->OMSetDepthStencilState(command.DepthStencilState.State, 0);
+			break;
+		case RenderCommandType::SetRasterizerState:
+			context->RSSetState(command.RasterizerState.State);
+			break;
+		case RenderCommandType::SetSamplers:
+			context->PSSetSamplers(command.Samplers.StartSlot, command.Samplers.Count, command.Samplers.Samplers);
+			break;
+		case RenderCommandType::WriteBuffer:
+		{
+			const RenderCommand::WriteBufferData& data = command.WriteBuffer;
+			const void* payload = aCommands.GetPayload(data.PayloadOffset);
+			if (data.Discard || data.NoOverwrite)
+			{
+				D3D11_MAPPED_SUBRESOURCE mappedResource;
+				HRESULT result = context->Map(data.Buffer, 0, data.Discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE, 0, &mappedResource);
+				if (FAILED(result))
+				{
+					INFO_PRINT("Error in rendering!");
+					break;
+				}
+				std::memcpy(static_cast<uint8_t*>(mappedResource.pData) + data.DestinationOffset, payload, data.Size);
+				context->Unmap(data.Buffer, 0);
+			}
+			else
+			{
+				D3D11_BOX box = { data.DestinationOffset, 0, 0, data.DestinationOffset + data.Size, 1, 1 };
+				context->UpdateSubresource(data.Buffer, 0, &box, payload, 0, 0);
+			}
+			break;
+		}
+		case RenderCommandType::Draw:
+			DX11::LogDrawCall();
+			context->Draw(command.Draw.VertexCount, command.Draw.StartVertex);
+			break;
+		case RenderCommandType::DrawIndexed:
+			DX11::LogDrawCall();
+			context->DrawIndexed(command.DrawIndexed.IndexCount, command.DrawIndexed.StartIndex, command.DrawIndexed.BaseVertex);
+			break;
+		case RenderCommandType::DrawInstanced:
+		{
+			const RenderCommand::DrawInstancedData& data = command.DrawInstanced;
+			DX11::LogDrawCall();
+			context->DrawInstanced(data.VertexCountPerInstance, data.InstanceCount, data.StartVertex, data.StartInstance);
+			break;
+		}
+		case RenderCommandType::DrawIndexedInstanced:
+		{
+			const RenderCommand::DrawIndexedInstancedData& data = command.DrawIndexedInstanced;
+			DX11::LogDrawCall();
+			context->DrawIndexedInstanced(data.IndexCountPerInstance, data.InstanceCount, data.StartIndex, data.BaseVertex, data.StartInstance);
+			break;
+		}
+		default:
+			assert(false && "Unknown render command");
+			break;
+		}
+	}
+}
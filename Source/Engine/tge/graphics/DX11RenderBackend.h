@@ -0,0 +1,15 @@
+#pragma once
+#include <tge/render/RenderBackend.h>
+
+namespace Tga
+{
+	/// <summary>
+	/// Submits recorded commands to DX11::Context. This is the backend the engine uses unless another one is set on the
+	/// graphics engine.
+	/// </summary>
+	class DX11RenderBackend : public RenderBackend
+	{
+	public:
+		void Execute(const RenderCommandBuffer& aCommands) override;
+	};
+}
@@ -0,0 +1,108 @@
+#include "stdafx.h"
+#include "Frustum.h"
+
+#include <cstring>
+#include <xmmintrin.h>
+
+#include <tge/graphics/Camera.h>
+
+using namespace Tga;
+
+namespace
+{
+	Vector4f NormalizePlane(const Vector4f& aPlane)
+	{
+		const float length = std::sqrt(aPlane.X * aPlane.X + aPlane.Y * aPlane.Y + aPlane.Z * aPlane.Z);
+		return length > 0.0f ? aPlane * (1.0f / length) : aPlane;
+	}
+}
+
+Frustum Frustum::CreateFromViewProjection(const Matrix4x4f& aViewProjection)
+{
+	// With row vectors clip = v * M, so each clip component is the dot product of v with a column of M.
+	const Matrix4x4f& m = aViewProjection;
+	const Vector4f column1(m(1, 1), m(2, 1), m(3, 1), m(4, 1));
+	const Vector4f column2(m(1, 2), m(2, 2), m(3, 2), m(4, 2));
+	const Vector4f column3(m(1, 3), m(2, 3), m(3, 3), m(4, 3));
+	const Vector4f column4(m(1, 4), m(2, 4), m(3, 4), m(4, 4));
+
+	Frustum frustum;
+	frustum.myPlanes[Left] = NormalizePlane(column4 + column1);
+	frustum.myPlanes[Right] = NormalizePlane(column4 - column1);
+	frustum.myPlanes[Bottom] = NormalizePlane(column4 + column2);
+	frustum.myPlanes[Top] = NormalizePlane(column4 - column2);
+	frustum.myPlanes[Near] = NormalizePlane(column3);
+	frustum.myPlanes[Far] = NormalizePlane(column4 - column3);
+	return frustum;
+}
+
+Frustum Frustum::CreateFromCamera(const Camera& aCamera)
+{
+	const Matrix4x4f toCamera = Matrix4x4f::GetFastInverse(aCamera.GetTransform().GetMatrix());
+	return CreateFromViewProjection(toCamera * aCamera.GetProjection());
+}
+
+bool Frustum::IntersectsSphere(const Vector3f& aCenter, float aRadius) const
+{
+	for (const Vector4f& plane : myPlanes)
+	{
+		if (plane.X * aCenter.X + plane.Y * aCenter.Y + plane.Z * aCenter.Z + plane.W < -aRadius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Frustum::IntersectsBox(const Vector3f& aCenter, const Vector3f& anExtents, const Matrix4x4f& aToWorld) const
+{
+	const Vector4f center = Vector4f(aCenter, 1.0f) * aToWorld;
+
+	// The matrix rows are the world-space box axes, scaled by the instance scale.
+	const Vector3f axisX = Vector3f(aToWorld(1, 1), aToWorld(1, 2), aToWorld(1, 3)) * anExtents.X;
+	const Vector3f axisY = Vector3f(aToWorld(2, 1), aToWorld(2, 2), aToWorld(2, 3)) * anExtents.Y;
+	const Vector3f axisZ = Vector3f(aToWorld(3, 1), aToWorld(3, 2), aToWorld(3, 3)) * anExtents.Z;
+
+	for (const Vector4f& plane : myPlanes)
+	{
+		const Vector3f normal(plane.X, plane.Y, plane.Z);
+		const float distance = normal.X * center.X + normal.Y * center.Y + normal.Z * center.Z + plane.W;
+		const float projectedRadius = std::abs(normal.Dot(axisX)) + std::abs(normal.Dot(axisY)) + std::abs(normal.Dot(axisZ));
+		if (distance < -projectedRadius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int Frustum::IntersectsSpheres4(const float* someX, const float* someY, const float* someZ, const float* someRadii, int& outCrossingMask) const
+{
+	const __m128 x = _mm_loadu_ps(someX);
+	const __m128 y = _mm_loadu_ps(someY);
+	const __m128 z = _mm_loadu_ps(someZ);
+	const __m128 radius = _mm_loadu_ps(someRadii);
+	const __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), radius);
+
+	__m128 outside = _mm_setzero_ps();
+	__m128 crossing = _mm_setzero_ps();
+	for (const Vector4f& plane : myPlanes)
+	{
+		__m128 distance = _mm_mul_ps(x, _mm_set1_ps(plane.X));
+		distance = _mm_add_ps(distance, _mm_mul_ps(y, _mm_set1_ps(plane.Y)));
+		distance = _mm_add_ps(distance, _mm_mul_ps(z, _mm_set1_ps(plane.Z)));
+		distance = _mm_add_ps(distance, _mm_set1_ps(plane.W));
+
+		outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeRadius));
+		crossing = _mm_or_ps(crossing, _mm_cmplt_ps(distance, radius));
+	}
+
+	const int visible = ~_mm_movemask_ps(outside) & 0xF;
+	outCrossingMask = _mm_movemask_ps(crossing) & visible;
+	return visible;
+}
+
+bool Frustum::operator==(const Frustum& anOther) const
+{
+	return std::memcmp(myPlanes, anOther.myPlanes, sizeof(myPlanes)) == 0;
+}
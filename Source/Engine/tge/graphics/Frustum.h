@@ -0,0 +1,64 @@
+#pragma once
+#include <tge/Math/Matrix4x4.h>
+#include <tge/Math/Vector.h>
+
+namespace Tga
+{
+
+class Camera;
+
+/// <summary>
+/// The six planes of a view frustum in world space. Plane normals point inwards, so a point p is inside a plane when
+/// dot(normal, p) + distance >= 0.
+/// </summary>
+class Frustum
+{
+public:
+	enum Plane
+	{
+		Left,
+		Right,
+		Bottom,
+		Top,
+		Near,
+		Far,
+		PlaneCount
+	};
+
+	Frustum() = default;
+
+	/**
+	 * Extracts the planes from a combined view * projection matrix (row vector convention, D3D depth range).
+	 */
+	static Frustum CreateFromViewProjection(const Matrix4x4f& aViewProjection);
+	static Frustum CreateFromCamera(const Camera& aCamera);
+
+	const Vector4f& GetPlane(Plane aPlane) const { return myPlanes[aPlane]; }
+
+	bool IntersectsSphere(const Vector3f& aCenter, float aRadius) const;
+
+	/**
+	 * Tests a box given in local space against the frustum.
+	 * @param aCenter The local-space center of the box.
+	 * @param anExtents Half the size of the box along each local axis.
+	 * @param aToWorld The local to world matrix, may contain non-uniform scale.
+	 */
+	bool IntersectsBox(const Vector3f& aCenter, const Vector3f& anExtents, const Matrix4x4f& aToWorld) const;
+
+	/**
+	 * SSE test of four spheres at once, each array holds four values and doesn't need to be aligned.
+	 * @param outCrossingMask Gets a bit set for every sphere that is visible but crosses at least one plane, those can
+	 * be worth a tighter test.
+	 * @returns A bit per sphere (bit 0 is the first) that is set if the sphere is at least partly inside.
+	 */
+	int IntersectsSpheres4(const float* someX, const float* someY, const float* someZ, const float* someRadii, int& outCrossingMask) const;
+
+	bool operator==(const Frustum& anOther) const;
+	bool operator!=(const Frustum& anOther) const { return !(*this == anOther); }
+
+private:
+	// xyz is the normalized inward normal, w the distance.
+	Vector4f myPlanes[PlaneCount];
+};
+
+} // namespace Tga
@@ -8,10 +8,12 @@
 #include <tge/drawers/SpriteDrawer.h>
 #include <tge/graphics/Camera.h>
 #include <tge/graphics/DX11.h>
+#include <tge/graphics/DX11RenderBackend.h>
 #include <tge/graphics/FullscreenEffect.h>
 #include <tge/graphics/GraphicsStateStack.h>
 #include <tge/math/CommonMath.h>
 #include <tge/render/RenderCommon.h>
+#include <tge/render/RenderCommandBuffer.h>
 #include <tge/render/RenderObject.h>
 #include <tge/texture/texture.h>
 #include <tge/texture/TextureManager.h>
@@ -36,8 +38,11 @@ using namespace Tga;
 
 
 GraphicsEngine::GraphicsEngine()
-	: myIsInitiated(false)
-{}
+	: myDX11RenderBackend(std::make_unique<DX11RenderBackend>())
+	, myIsInitiated(false)
+{
+	myRenderBackend = myDX11RenderBackend.get();
+}
 
 GraphicsEngine::~GraphicsEngine(void)
 {}
@@ -77,7 +82,7 @@ bool GraphicsEngine::Init()
 		return false;
 
 	myGraphicsStateStack = std::make_unique<GraphicsStateStack>();
-	if (!myGraphicsStateStack->Init())
+	if (!myGraphicsStateStack->Init(*this))
 		return false;
 
 	INFO_PRINT("%s", "All done, starting...");
@@ -94,4 +99,18 @@ bool GraphicsEngine::IsInitiated()
 void Tga::GraphicsEngine::SetFullScreen(bool aFullScreen)
 {
 	DX11::SwapChain->SetFullscreenState(aFullScreen, nullptr);
-}
\ No newline at end of file
+}
+
+void Tga::GraphicsEngine::SetRenderBackend(RenderBackend* aBackend)
+{
+	myRenderBackend = aBackend ? aBackend : myDX11RenderBackend.get();
+}
+
+void Tga::GraphicsEngine::Submit(RenderCommandBuffer& aCommands)
+{
+	if (aCommands.IsEmpty())
+		return;
+
+	myRenderBackend->Execute(aCommands);
+	aCommands.Clear();
+}
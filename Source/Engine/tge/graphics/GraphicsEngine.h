@@ -21,6 +21,9 @@ namespace Tga
 	class Camera;
 	class FullscreenEffect;
 	class GraphicsStateStack;
+	class RenderBackend;
+	class RenderCommandBuffer;
+	class DX11RenderBackend;
 
 	class GraphicsEngine
 	{
@@ -37,6 +40,18 @@ namespace Tga
 
 		GraphicsStateStack& GetGraphicsStateStack() { return *myGraphicsStateStack; };
 
+		/**
+		 * Replaces the backend the drawers submit their commands to, for example with a RecordingRenderBackend to
+		 * gather statistics. The backend is not owned. Pass nullptr to go back to the DX11 backend.
+		 */
+		void SetRenderBackend(RenderBackend* aBackend);
+		RenderBackend& GetRenderBackend() { return *myRenderBackend; };
+
+		/**
+		 * Executes aCommands on the current backend and clears them.
+		 */
+		void Submit(RenderCommandBuffer& aCommands);
+
 		FullscreenEffect& GetFullscreenEffectCopy() { return *myFullscreenCopy; };
 		FullscreenEffect& GetFullscreenEffectTonemap() { return *myFullscreenTonemap; };
 		FullscreenEffect& GetFullscreenEffectVerticalGaussianBlur() { return *myFullscreenVerticalGaussianBlur; };
@@ -54,6 +69,9 @@ namespace Tga
 
 		std::unique_ptr<GraphicsStateStack> myGraphicsStateStack;
 
+		std::unique_ptr<DX11RenderBackend> myDX11RenderBackend;
+		RenderBackend* myRenderBackend;
+
 		std::unique_ptr<FullscreenEffect> myFullscreenCopy;
 		std::unique_ptr<FullscreenEffect> myFullscreenTonemap;
 		std::unique_ptr<FullscreenEffect> myFullscreenVerticalGaussianBlur;
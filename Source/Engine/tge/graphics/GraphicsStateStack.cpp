@@ -1,7 +1,9 @@
 #include "stdafx.h"
 #include "GraphicsStateStack.h"
 
+#include <cstring>
 #include <tge/graphics/DX11.h>
+#include <tge/graphics/GraphicsEngine.h>
 #include <tge/shaders/ShaderCommon.h>
 
 using namespace Tga;
@@ -52,8 +54,18 @@ struct LightConstantBufferData
 	Vector4f myDirectionalLightColorAndIntensity;
 };
 
-bool GraphicsStateStack::Init()
+namespace
 {
+	uint32_t PackFixedFunctionState(BlendState aBlendState, DepthStencilState aDepthStencilState, RasterizerState aRasterizerState, SamplerFilter aFilter, SamplerAddressMode anAddressMode)
+	{
+		return (uint32_t)aBlendState | (uint32_t)aDepthStencilState << 4 | (uint32_t)aRasterizerState << 8 | (uint32_t)aFilter << 12 | (uint32_t)anAddressMode << 16;
+	}
+}
+
+bool GraphicsStateStack::Init(GraphicsEngine& aGraphicsEngine)
+{
+	myGraphicsEngine = &aGraphicsEngine;
+
 	if (!CreateBlendStates())
 		return false;
 	if (!CreateDepthStencilStates())
@@ -75,23 +87,16 @@ void GraphicsStateStack::BeginFrame()
 {
 	assert(myRenderStateStack.size() == 1);
 
+	myPreviousStatistics = myStatistics;
+	myStatistics = {};
+
 	// Frame buffer is only set once per frame
 	{
-		D3D11_MAPPED_SUBRESOURCE mappedResourceCommon;
-		FrameConstantBufferData* dataPtrCommon;
-		HRESULT result = DX11::Context->Map(myFrameConstantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResourceCommon);
-		if (FAILED(result))
-		{
-			INFO_PRINT("Error in rendering!");
-			return;
-		}
-
-		dataPtrCommon = (FrameConstantBufferData*)mappedResourceCommon.pData;
+		FrameConstantBufferData* dataPtrCommon = static_cast<FrameConstantBufferData*>(myCommands.WriteBuffer(myFrameConstantBuffer.Get(), sizeof(FrameConstantBufferData)));
 		dataPtrCommon->myResolution = Vector4f(static_cast<float>(DX11::GetResolution().x), static_cast<float>(DX11::GetResolution().y), 0, 0);
 		dataPtrCommon->myTimings.x = Engine::GetInstance()->GetTotalTime();
 		dataPtrCommon->myTimings.y = Engine::GetInstance()->GetDeltaTime();
-
-		DX11::Context->Unmap(myFrameConstantBuffer.Get(), 0);
+		myStatistics.BufferUploads++;
 	}
 
 	// reset everything else to default values
@@ -350,131 +355,151 @@ void GraphicsStateStack::UpdateGpuStates(bool fullReset)
 {
 	RenderState& state = myRenderStateStack.back();
 
-	if (fullReset || state.blendState != myGpuRenderState.blendState)
+	const uint32_t fixedFunctionKey = PackFixedFunctionState(state.blendState, state.depthStencilState, state.rasterizerState, state.samplerFilter, state.samplerAddressMode);
+	if (fullReset || fixedFunctionKey != myGpuFixedFunctionKey)
 	{
-		DX11::Context->OMSetBlendState(myBlendStates[(int)state.blendState].Get(), nullptr, 0xffffffff);
-	}
+		if (fullReset || state.blendState != myGpuRenderState.blendState)
+		{
+			myCommands.SetBlendState(myBlendStates[(int)state.blendState].Get());
+			myStatistics.StateBinds++;
+		}
+		else
+		{
+			myStatistics.AvoidedStateBinds++;
+		}
 
-	if (fullReset || state.depthStencilState != myGpuRenderState.depthStencilState)
-	{
-		DX11::Context->OMSetDepthStencilState(myDepthStencilStates[(int)state.depthStencilState].Get(), 0);
-	}
+		if (fullReset || state.depthStencilState != myGpuRenderState.depthStencilState)
+		{
+			myCommands.SetDepthStencilState(myDepthStencilStates[(int)state.depthStencilState].Get());
+			myStatistics.StateBinds++;
+		}
+		else
+		{
+			myStatistics.AvoidedStateBinds++;
+		}
 
-	if (fullReset || state.rasterizerState != myGpuRenderState.rasterizerState)
-	{
-		DX11::Context->RSSetState(myRasterizerStates[(int)state.rasterizerState].Get());
-	}
+		if (fullReset || state.rasterizerState != myGpuRenderState.rasterizerState)
+		{
+			myCommands.SetRasterizerState(myRasterizerStates[(int)state.rasterizerState].Get());
+			myStatistics.StateBinds++;
+		}
+		else
+		{
+			myStatistics.AvoidedStateBinds++;
+		}
 
-	if (fullReset || state.samplerFilter != myGpuRenderState.samplerFilter || state.samplerAddressMode != myGpuRenderState.samplerAddressMode)
+		if (fullReset || state.samplerFilter != myGpuRenderState.samplerFilter || state.samplerAddressMode != myGpuRenderState.samplerAddressMode)
+		{
+			// The texture slot and every map slot sample the same way.
+			ID3D11SamplerState* samplers[1 + ShaderMap::MAP_MAX];
+			for (ID3D11SamplerState*& sampler : samplers)
+			{
+				sampler = mySamplerStates[(int)state.samplerFilter][(int)state.samplerAddressMode].Get();
+			}
+			myCommands.SetSamplers(0, 1 + ShaderMap::MAP_MAX, samplers);
+			myStatistics.StateBinds++;
+		}
+		else
+		{
+			myStatistics.AvoidedStateBinds++;
+		}
+
+		myGpuFixedFunctionKey = fixedFunctionKey;
+	}
+	else
 	{
-		DX11::Context->PSSetSamplers(0, 1 + ShaderMap::MAP_MAX, mySamplerStates[(int)state.samplerFilter][(int)state.samplerAddressMode].GetAddressOf());
+		myStatistics.AvoidedStateBinds += 4;
 	}
 
+	// A changed version only means something was set since the last upload. Setting a value back, or a Pop back to a
+	// state with the same data, still has to be compared against what the buffer holds.
 	if (fullReset || state.shaderDataVersion != myGpuRenderState.shaderDataVersion)
 	{
-		D3D11_MAPPED_SUBRESOURCE mappedResource;
-		ShaderSettingsConstantBufferData* dataPtr;
-		HRESULT result = DX11::Context->Map(myShaderSettingsConstantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-		if (FAILED(result))
-		{
-			INFO_PRINT("Error in rendering!");
-			return;
-		}
-
-		dataPtr = (ShaderSettingsConstantBufferData*)mappedResource.pData;
-		dataPtr->alphaTestThreshold = state.alphaTestThreshold;
-		dataPtr->customShaderParameters = state.customShaderParameters;
-
-		DX11::Context->Unmap(myShaderSettingsConstantBuffer.Get(), 0);
+		ShaderSettingsConstantBufferData data = {};
+		data.alphaTestThreshold = state.alphaTestThreshold;
+		data.customShaderParameters = state.customShaderParameters;
+		UpdateBuffer(myShaderSettingsConstantBuffer.Get(), myShaderSettingsShadow, &data, sizeof(data));
 	}
 
 	if (fullReset || state.cameraDataVersion != myGpuRenderState.cameraDataVersion)
 	{
-		D3D11_MAPPED_SUBRESOURCE mappedResourceCommon;
-		CameraConstantBufferData* dataPtrCommon;
-		HRESULT result = DX11::Context->Map(myCameraConstantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResourceCommon);
-		if (FAILED(result))
-		{
-			INFO_PRINT("Error in rendering!");
-			return;
-		}
-
-		dataPtrCommon = (CameraConstantBufferData*)mappedResourceCommon.pData;
-		dataPtrCommon->myToCamera = Matrix4x4f::GetFastInverse(state.camera.GetTransform().GetMatrix());
-		dataPtrCommon->myToProjection = state.camera.GetProjection();
+		CameraConstantBufferData data = {};
+		data.myToCamera = Matrix4x4f::GetFastInverse(state.camera.GetTransform().GetMatrix());
+		data.myToProjection = state.camera.GetProjection();
 
 		float camNearPlane = 0;
 		float camFarPlane = 0;
 		state.camera.GetProjectionPlanes(camNearPlane, camFarPlane);
 
-		dataPtrCommon->myNearPlane = camNearPlane;
-		dataPtrCommon->myFarPlane = camFarPlane;
-		dataPtrCommon->myCameraPosition = state.camera.GetTransform().GetMatrix().GetPosition();
+		data.myNearPlane = camNearPlane;
+		data.myFarPlane = camFarPlane;
+		data.myCameraPosition = state.camera.GetTransform().GetMatrix().GetPosition();
 
-		DX11::Context->Unmap(myCameraConstantBuffer.Get(), 0);
+		UpdateBuffer(myCameraConstantBuffer.Get(), myCameraShadow, &data, sizeof(data));
 	}
 
 	if (fullReset || state.lightDataVersion != myGpuRenderState.lightDataVersion)
 	{
 #ifdef USE_LIGHTS
-
-		D3D11_MAPPED_SUBRESOURCE mappedResourceLight;
-		LightConstantBufferData* dataPtrLights;
-
-		HRESULT result = DX11::Context->Map(myLightConstantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResourceLight);
-		if (FAILED(result))
-		{
-			INFO_PRINT("Error in rendering! Could not map lights");
-			return;
-		}
+		LightConstantBufferData data = {};
 
 		size_t pointLightCount = state.pointLightCount;
 		const PointLight* pointLights = state.pointLights;
-		dataPtrLights = (LightConstantBufferData*)mappedResourceLight.pData;
-		*dataPtrLights = {};
 
-		dataPtrLights->myNumberOfLights = static_cast<unsigned int>(pointLightCount);
+		data.myNumberOfLights = static_cast<unsigned int>(pointLightCount);
 
 		for (int i = 0; i < pointLightCount; i++)
 		{
 			const PointLight& pointLight = pointLights[i];
-			dataPtrLights->myPointLights[i].myColorAndIntensity = pointLight.GetColor().AsLinearVec4();
-			dataPtrLights->myPointLights[i].myColorAndIntensity.w = pointLight.GetIntensity();
-			dataPtrLights->myPointLights[i].myRange = pointLight.GetRange();
-			dataPtrLights->myPointLights[i].myPosition = pointLight.GetTransform().GetPosition();
+			data.myPointLights[i].myColorAndIntensity = pointLight.GetColor().AsLinearVec4();
+			data.myPointLights[i].myColorAndIntensity.w = pointLight.GetIntensity();
+			data.myPointLights[i].myRange = pointLight.GetRange();
+			data.myPointLights[i].myPosition = pointLight.GetTransform().GetPosition();
 		}
 
 		const DirectionalLight& directionalLight = state.directionalLight;
 		const AmbientLight& ambientLight = state.ambientLight;
-		dataPtrLights->myDirectionalLightDirection = directionalLight.GetTransform().GetMatrix().GetForward();
-		dataPtrLights->myDirectionalLightColorAndIntensity = directionalLight.GetColor().AsLinearVec4();
-		dataPtrLights->myDirectionalLightColorAndIntensity.w = directionalLight.GetIntensity();
-		dataPtrLights->myNumEnvMapMipLevels = ambientLight.GetNumMips();
-		dataPtrLights->myAmbientLightColorAndIntensity = ambientLight.GetColor().AsLinearVec4();
-		dataPtrLights->myAmbientLightColorAndIntensity.w = ambientLight.GetIntensity();
-
-		DX11::Context->Unmap(myLightConstantBuffer.Get(), 0);
-
-		DX11::Context->PSSetShaderResources(0, 1, ambientLight.GetCubemap());
+		data.myDirectionalLightDirection = directionalLight.GetTransform().GetMatrix().GetForward();
+		data.myDirectionalLightColorAndIntensity = directionalLight.GetColor().AsLinearVec4();
+		data.myDirectionalLightColorAndIntensity.w = directionalLight.GetIntensity();
+		data.myNumEnvMapMipLevels = ambientLight.GetNumMips();
+		data.myAmbientLightColorAndIntensity = ambientLight.GetColor().AsLinearVec4();
+		data.myAmbientLightColorAndIntensity.w = ambientLight.GetIntensity();
+
+		UpdateBuffer(myLightConstantBuffer.Get(), myLightShadow, &data, sizeof(data));
+
+		// Postprocessing binds texture slot 0 straight on the context, so the cubemap is not shadowed.
+		myCommands.SetShaderResources(0, 1, ambientLight.GetCubemap());
+		myStatistics.StateBinds++;
 #endif
 	}
 
 	if (fullReset)
 	{
-		DX11::Context->VSSetConstantBuffers((int)ConstantBufferSlot::Frame, 1, myFrameConstantBuffer.GetAddressOf());
-		DX11::Context->PSSetConstantBuffers((int)ConstantBufferSlot::Frame, 1, myFrameConstantBuffer.GetAddressOf());
+		myCommands.SetConstantBuffer(RenderStage_VertexAndPixel, (int)ConstantBufferSlot::Frame, myFrameConstantBuffer.Get());
+		myCommands.SetConstantBuffer(RenderStage_VertexAndPixel, (int)ConstantBufferSlot::Camera, myCameraConstantBuffer.Get());
+		myCommands.SetConstantBuffer(RenderStage_VertexAndPixel, (int)ConstantBufferSlot::ShaderSettings, myShaderSettingsConstantBuffer.Get());
+		myCommands.SetConstantBuffer(RenderStage_VertexAndPixel, (int)ConstantBufferSlot::Light, myLightConstantBuffer.Get());
+	}
 
-		DX11::Context->VSSetConstantBuffers((int)ConstantBufferSlot::Camera, 1, myCameraConstantBuffer.GetAddressOf());
-		DX11::Context->PSSetConstantBuffers((int)ConstantBufferSlot::Camera, 1, myCameraConstantBuffer.GetAddressOf());
+	myGpuRenderState = state;
 
-		DX11::Context->VSSetConstantBuffers((int)ConstantBufferSlot::ShaderSettings, 1, myShaderSettingsConstantBuffer.GetAddressOf());
-		DX11::Context->PSSetConstantBuffers((int)ConstantBufferSlot::ShaderSettings, 1, myShaderSettingsConstantBuffer.GetAddressOf());
+	myGraphicsEngine->Submit(myCommands);
+}
 
-		DX11::Context->VSSetConstantBuffers((int)ConstantBufferSlot::Light, 1, myLightConstantBuffer.GetAddressOf());
-		DX11::Context->PSSetConstantBuffers((int)ConstantBufferSlot::Light, 1, myLightConstantBuffer.GetAddressOf());
+void GraphicsStateStack::UpdateBuffer(ID3D11Buffer* aBuffer, std::vector<uint8_t>& aShadow, const void* someData, size_t aSize)
+{
+	// Only the state stack writes these buffers and they keep their contents through a full reset, so identical data
+	// can be skipped even then.
+	if (aShadow.size() == aSize && std::memcmp(aShadow.data(), someData, aSize) == 0)
+	{
+		myStatistics.AvoidedBufferUploads++;
+		return;
 	}
 
-	myGpuRenderState = state;
+	aShadow.assign(static_cast<const uint8_t*>(someData), static_cast<const uint8_t*>(someData) + aSize);
+	myCommands.WriteBuffer(aBuffer, someData, aSize);
+	myStatistics.BufferUploads++;
 }
 
 bool GraphicsStateStack::CreateBlendStates()
@@ -4,6 +4,7 @@
 #include <tge/graphics/DirectionalLight.h>
 #include <tge/graphics/AmbientLight.h>
 #include <tge/graphics/Camera.h>
+#include <tge/render/RenderCommandBuffer.h>
 
 #include <wrl/client.h>
 
@@ -16,6 +17,25 @@ struct ID3D11BlendState;
 
 namespace Tga
 {
+	class GraphicsEngine;
+
+	struct GraphicsStateStatistics
+	{
+		// Blend, depth stencil, rasterizer and sampler binds that were recorded, and ones skipped since the state
+		// matched what was already bound.
+		size_t StateBinds = 0;
+		size_t AvoidedStateBinds = 0;
+		// Shared constant buffer uploads, and uploads skipped because the data had been touched but came out identical,
+		// which is what Push, set, Pop around a draw does.
+		size_t BufferUploads = 0;
+		size_t AvoidedBufferUploads = 0;
+	};
+
+	/// <summary>
+	/// Keeps a shadow copy of the state it has bound and of the data in the shared constant buffers, and only records
+	/// what differs from it. The binds are recorded into a command buffer and submitted like any drawer's, so a
+	/// RecordingRenderBackend sees them too.
+	/// </summary>
 	class GraphicsStateStack
 	{
 		struct RenderState
@@ -47,7 +67,7 @@ namespace Tga
 		GraphicsStateStack(const GraphicsStateStack&) = delete;
 		GraphicsStateStack& operator=(const GraphicsStateStack&) = delete;
 
-		bool Init();
+		bool Init(GraphicsEngine& aGraphicsEngine);
 
 		void SetAllStatesToDefault(bool force = false);
 		void BeginFrame();
@@ -116,6 +136,11 @@ namespace Tga
 
 		void UpdateGpuStates(bool force = false);
 
+		/**
+		 * Counters for the previous frame, for the debug overlay.
+		 */
+		const GraphicsStateStatistics& GetPreviousStatistics() const { return myPreviousStatistics; }
+
 	private:
 		bool CreateBlendStates();
 		bool CreateDepthStencilStates();
@@ -124,8 +149,21 @@ namespace Tga
 		bool CreateConstantBuffers();
 
 		void SetAllStates(const RenderState& RenderState);
+		void UpdateBuffer(ID3D11Buffer* aBuffer, std::vector<uint8_t>& aShadow, const void* someData, size_t aSize);
+
+		GraphicsEngine* myGraphicsEngine = nullptr;
+		RenderCommandBuffer myCommands;
+		GraphicsStateStatistics myStatistics;
+		GraphicsStateStatistics myPreviousStatistics;
 
 		RenderState myGpuRenderState;
+		// Blend, depth stencil, rasterizer and sampler state packed into one value, so the common case where none of
+		// them changed is a single compare.
+		uint32_t myGpuFixedFunctionKey = 0;
+		// Last data uploaded to each shared constant buffer, empty until the first upload.
+		std::vector<uint8_t> myShaderSettingsShadow;
+		std::vector<uint8_t> myCameraShadow;
+		std::vector<uint8_t> myLightShadow;
 		std::vector<RenderState> myRenderStateStack;
 
 		uint32_t myLatestShaderDataVersion = 0;
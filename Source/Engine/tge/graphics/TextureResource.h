@@ -2,6 +2,8 @@
 
 #include <tge/Math/Vector.h>
 #include <wrl/client.h>
+#include <atomic>
+#include <cstdint>
 
 using Microsoft::WRL::ComPtr;
 
@@ -24,6 +26,31 @@ public:
 	ID3D11ShaderResourceView* GetShaderResourceView() const { return mySRV.Get(); };
 	void SetShaderResourceView(ID3D11ShaderResourceView* aSRV);
 	Vector2ui CalculateTextureSize() const;
+
+	/**
+	 * Tells the texture streamer the texture is drawn aScreenSize pixels large, in its largest dimension. Does nothing
+	 * for textures that aren't mip streamed, and can be called from any thread.
+	 */
+	void ReportScreenSize(float aScreenSize) const
+	{
+		if (!myScreenSizeFeedback)
+		{
+			return;
+		}
+
+		// Bounds the camera is inside of report FLT_MAX.
+		const uint32_t size = aScreenSize < 65536.0f ? static_cast<uint32_t>(aScreenSize) : 65536u;
+		uint32_t current = myScreenSizeFeedback->load(std::memory_order_relaxed);
+		while (size > current && !myScreenSizeFeedback->compare_exchange_weak(current, size, std::memory_order_relaxed))
+		{
+		}
+	}
+	bool HasScreenSizeFeedback() const { return myScreenSizeFeedback != nullptr; }
+	void SetScreenSizeFeedback(std::atomic<uint32_t>* aFeedback) { myScreenSizeFeedback = aFeedback; }
+
+private:
+	// Owned by the TextureManager, set while the texture is mip streamed.
+	std::atomic<uint32_t>* myScreenSizeFeedback = nullptr;
 };
 
 } // namespace Tga
\ No newline at end of file
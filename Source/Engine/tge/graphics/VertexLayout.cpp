@@ -0,0 +1,503 @@
+#include "stdafx.h"
+#include <tge/graphics/VertexLayout.h>
+
+#include <cmath>
+#include <cstring>
+
+using namespace Tga;
+
+namespace
+{
+	constexpr uint32_t ColorAttributes[VertexLayout::MaxColorSets] =
+	{
+		static_cast<uint32_t>(VertexAttribute::Color0),
+		static_cast<uint32_t>(VertexAttribute::Color1),
+		static_cast<uint32_t>(VertexAttribute::Color2),
+		static_cast<uint32_t>(VertexAttribute::Color3),
+	};
+
+	constexpr uint32_t UVAttributes[VertexLayout::MaxUVSets] =
+	{
+		static_cast<uint32_t>(VertexAttribute::UV0),
+		static_cast<uint32_t>(VertexAttribute::UV1),
+		static_cast<uint32_t>(VertexAttribute::UV2),
+		static_cast<uint32_t>(VertexAttribute::UV3),
+	};
+
+	constexpr uint16_t BinormalSignBit = 1;
+
+	// Where each kind of element finds its default in VertexLayout::DefaultData.
+	constexpr uint32_t DefaultColorOffset = 0;
+	constexpr uint32_t DefaultZeroOffset = 4;
+	constexpr uint32_t DefaultPositionOffset = 4;
+	constexpr uint32_t DefaultDirectionOffset = 8;
+
+	uint8_t FloatToUnorm8(float aValue)
+	{
+		const float clamped = aValue < 0.0f ? 0.0f : (aValue > 1.0f ? 1.0f : aValue);
+		return static_cast<uint8_t>(clamped * 255.0f + 0.5f);
+	}
+
+	float Unorm8ToFloat(uint8_t aValue)
+	{
+		return static_cast<float>(aValue) * (1.0f / 255.0f);
+	}
+
+	int16_t FloatToSnorm16(float aValue)
+	{
+		const float clamped = aValue < -1.0f ? -1.0f : (aValue > 1.0f ? 1.0f : aValue);
+		return static_cast<int16_t>(std::lround(clamped * 32767.0f));
+	}
+
+	float Snorm16ToFloat(int16_t aValue)
+	{
+		const float value = static_cast<float>(aValue) * (1.0f / 32767.0f);
+		return value < -1.0f ? -1.0f : value;
+	}
+
+	float SignNotZero(float aValue)
+	{
+		return aValue >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	bool IsZero(const Vector3f& aVector)
+	{
+		return aVector.x == 0.0f && aVector.y == 0.0f && aVector.z == 0.0f;
+	}
+
+	template<typename T>
+	void Write(uint8_t*& inOutCursor, const T& aValue)
+	{
+		memcpy(inOutCursor, &aValue, sizeof(T));
+		inOutCursor += sizeof(T);
+	}
+
+	template<typename T>
+	T Read(const uint8_t*& inOutCursor)
+	{
+		T value;
+		memcpy(&value, inOutCursor, sizeof(T));
+		inOutCursor += sizeof(T);
+		return value;
+	}
+}
+
+// White, then zeros. Zero is also +Z in the octahedral encoding of the normal and tangent.
+const uint8_t VertexLayout::DefaultData[VertexLayout::DefaultDataSize] =
+{
+	0xFF, 0xFF, 0xFF, 0xFF,
+	0, 0, 0, 0,
+	0, 0, 0, 0,
+	0, 0, 0, 0,
+};
+
+uint16_t VertexQuantization::FloatToHalf(float aValue)
+{
+	uint32_t bits;
+	memcpy(&bits, &aValue, sizeof(float));
+
+	const uint32_t sign = (bits >> 16) & 0x8000;
+	const uint32_t floatExponent = (bits >> 23) & 0xFF;
+	uint32_t mantissa = bits & 0x7FFFFF;
+
+	if (floatExponent == 0xFF)
+	{
+		// Inf stays inf, NaN stays NaN.
+		return static_cast<uint16_t>(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+	}
+
+	const int32_t exponent = static_cast<int32_t>(floatExponent) - 127 + 15;
+	if (exponent >= 31)
+	{
+		return static_cast<uint16_t>(sign | 0x7C00);
+	}
+
+	if (exponent <= 0)
+	{
+		if (exponent < -10)
+		{
+			return static_cast<uint16_t>(sign);
+		}
+
+		// Denormal, shift in the implicit one and round to nearest even.
+		mantissa |= 0x800000;
+		const uint32_t shift = static_cast<uint32_t>(14 - exponent);
+		uint32_t half = mantissa >> shift;
+		const uint32_t remainder = mantissa & ((1u << shift) - 1);
+		const uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1)))
+		{
+			half++;
+		}
+		return static_cast<uint16_t>(sign | half);
+	}
+
+	uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+	const uint32_t remainder = mantissa & 0x1FFF;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+	{
+		// A carry into the exponent is correct here, it rounds up to the next power of two (or inf).
+		half++;
+	}
+	return static_cast<uint16_t>(sign | half);
+}
+
+float VertexQuantization::HalfToFloat(uint16_t aValue)
+{
+	const uint32_t sign = static_cast<uint32_t>(aValue & 0x8000) << 16;
+	int32_t exponent = (aValue >> 10) & 0x1F;
+	uint32_t mantissa = aValue & 0x3FF;
+
+	uint32_t bits;
+	if (exponent == 0)
+	{
+		if (mantissa == 0)
+		{
+			bits = sign;
+		}
+		else
+		{
+			// Denormal, normalize it for the float representation.
+			exponent = 1;
+			while ((mantissa & 0x400) == 0)
+			{
+				mantissa <<= 1;
+				exponent--;
+			}
+			mantissa &= 0x3FF;
+			bits = sign | (static_cast<uint32_t>(exponent + 127 - 15) << 23) | (mantissa << 13);
+		}
+	}
+	else if (exponent == 31)
+	{
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	}
+	else
+	{
+		bits = sign | (static_cast<uint32_t>(exponent + 127 - 15) << 23) | (mantissa << 13);
+	}
+
+	float result;
+	memcpy(&result, &bits, sizeof(float));
+	return result;
+}
+
+uint32_t VertexQuantization::EncodeOctahedral(const Vector3f& aDirection)
+{
+	const float length = std::fabs(aDirection.x) + std::fabs(aDirection.y) + std::fabs(aDirection.z);
+	if (length <= 0.0f)
+	{
+		// (0, 0) is +Z.
+		return 0;
+	}
+
+	float x = aDirection.x / length;
+	float y = aDirection.y / length;
+	if (aDirection.z < 0.0f)
+	{
+		// Fold the lower hemisphere over the diagonals.
+		const float foldedX = (1.0f - std::fabs(y)) * SignNotZero(x);
+		const float foldedY = (1.0f - std::fabs(x)) * SignNotZero(y);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	const uint16_t encodedX = static_cast<uint16_t>(FloatToSnorm16(x));
+	const uint16_t encodedY = static_cast<uint16_t>(FloatToSnorm16(y));
+	return static_cast<uint32_t>(encodedX) | (static_cast<uint32_t>(encodedY) << 16);
+}
+
+Vector3f VertexQuantization::DecodeOctahedral(uint32_t anEncoded)
+{
+	float x = Snorm16ToFloat(static_cast<int16_t>(anEncoded & 0xFFFF));
+	float y = Snorm16ToFloat(static_cast<int16_t>(anEncoded >> 16));
+	const float z = 1.0f - std::fabs(x) - std::fabs(y);
+	if (z < 0.0f)
+	{
+		const float unfoldedX = (1.0f - std::fabs(y)) * SignNotZero(x);
+		const float unfoldedY = (1.0f - std::fabs(x)) * SignNotZero(y);
+		x = unfoldedX;
+		y = unfoldedY;
+	}
+
+	return Vector3f(x, y, z).GetNormalized();
+}
+
+VertexLayout VertexLayout::Build(const Vertex* someVertices, size_t aVertexCount)
+{
+	uint32_t attributes = static_cast<uint32_t>(VertexAttribute::Position);
+
+	for (size_t v = 0; v < aVertexCount; v++)
+	{
+		const Vertex& vertex = someVertices[v];
+
+		for (int c = 0; c < MaxColorSets; c++)
+		{
+			// The importer writes white into empty color sets, so anything else is real data.
+			const Vector4f& color = vertex.VertexColors[c];
+			if (color.x != 1.0f || color.y != 1.0f || color.z != 1.0f || color.w != 1.0f)
+			{
+				attributes |= ColorAttributes[c];
+			}
+		}
+
+		for (int uv = 0; uv < MaxUVSets; uv++)
+		{
+			if (vertex.UVs[uv].x != 0.0f || vertex.UVs[uv].y != 0.0f)
+			{
+				attributes |= UVAttributes[uv];
+			}
+		}
+
+		if (!IsZero(vertex.Normal))
+		{
+			attributes |= static_cast<uint32_t>(VertexAttribute::Normal);
+		}
+
+		if (!IsZero(vertex.Tangent) || !IsZero(vertex.Binormal))
+		{
+			attributes |= static_cast<uint32_t>(VertexAttribute::Tangent);
+		}
+
+		if (vertex.Weights.x != 0.0f || vertex.Weights.y != 0.0f || vertex.Weights.z != 0.0f || vertex.Weights.w != 0.0f)
+		{
+			attributes |= static_cast<uint32_t>(VertexAttribute::Skin);
+		}
+	}
+
+	return FromAttributes(attributes);
+}
+
+VertexLayout VertexLayout::FromAttributes(uint32_t someAttributes)
+{
+	VertexLayout layout;
+	layout.Attributes = someAttributes;
+	layout.Stride = 0;
+
+	if (layout.Has(VertexAttribute::Position))
+		layout.Stride += sizeof(float) * 3;
+
+	for (int c = 0; c < MaxColorSets; c++)
+	{
+		if (someAttributes & ColorAttributes[c])
+			layout.Stride += sizeof(uint8_t) * 4;
+	}
+
+	for (int uv = 0; uv < MaxUVSets; uv++)
+	{
+		if (someAttributes & UVAttributes[uv])
+			layout.Stride += sizeof(uint16_t) * 2;
+	}
+
+	if (layout.Has(VertexAttribute::Normal))
+		layout.Stride += sizeof(uint32_t);
+
+	if (layout.Has(VertexAttribute::Tangent))
+		layout.Stride += sizeof(uint32_t);
+
+	if (layout.Has(VertexAttribute::Skin))
+		layout.Stride += sizeof(uint8_t) * 8;
+
+	return layout;
+}
+
+void VertexLayout::Encode(const Vertex& aVertex, uint8_t* outData) const
+{
+	uint8_t* cursor = outData;
+
+	if (Has(VertexAttribute::Position))
+	{
+		Write(cursor, aVertex.Position.x);
+		Write(cursor, aVertex.Position.y);
+		Write(cursor, aVertex.Position.z);
+	}
+
+	for (int c = 0; c < MaxColorSets; c++)
+	{
+		if (Attributes & ColorAttributes[c])
+		{
+			const Vector4f& color = aVertex.VertexColors[c];
+			Write(cursor, FloatToUnorm8(color.x));
+			Write(cursor, FloatToUnorm8(color.y));
+			Write(cursor, FloatToUnorm8(color.z));
+			Write(cursor, FloatToUnorm8(color.w));
+		}
+	}
+
+	for (int uv = 0; uv < MaxUVSets; uv++)
+	{
+		if (Attributes & UVAttributes[uv])
+		{
+			Write(cursor, VertexQuantization::FloatToHalf(aVertex.UVs[uv].x));
+			Write(cursor, VertexQuantization::FloatToHalf(aVertex.UVs[uv].y));
+		}
+	}
+
+	if (Has(VertexAttribute::Normal))
+	{
+		Write(cursor, VertexQuantization::EncodeOctahedral(aVertex.Normal));
+	}
+
+	if (Has(VertexAttribute::Tangent))
+	{
+		// The binormal is rebuilt as sign * (N x T), so only the handedness needs to be stored.
+		const bool isMirrored = aVertex.Normal.Cross(aVertex.Tangent).Dot(aVertex.Binormal) < 0.0f;
+		uint32_t tangent = VertexQuantization::EncodeOctahedral(aVertex.Tangent);
+		tangent &= ~(static_cast<uint32_t>(BinormalSignBit) << 16);
+		if (isMirrored)
+		{
+			tangent |= static_cast<uint32_t>(BinormalSignBit) << 16;
+		}
+		Write(cursor, tangent);
+	}
+
+	if (Has(VertexAttribute::Skin))
+	{
+		const float bones[4] = { aVertex.Bones.x, aVertex.Bones.y, aVertex.Bones.z, aVertex.Bones.w };
+		const float weights[4] = { aVertex.Weights.x, aVertex.Weights.y, aVertex.Weights.z, aVertex.Weights.w };
+
+		uint8_t quantizedWeights[4];
+		int weightSum = 0;
+		int largest = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			assert(bones[i] >= 0.0f && bones[i] < 256.0f && "Bone index doesn't fit the compact vertex layout");
+			Write(cursor, static_cast<uint8_t>(bones[i]));
+
+			quantizedWeights[i] = FloatToUnorm8(weights[i]);
+			weightSum += quantizedWeights[i];
+			if (weights[i] > weights[largest])
+			{
+				largest = i;
+			}
+		}
+
+		// Put the rounding error on the largest weight so the weights still sum to one.
+		if (weightSum > 0)
+		{
+			const int corrected = static_cast<int>(quantizedWeights[largest]) + (255 - weightSum);
+			quantizedWeights[largest] = static_cast<uint8_t>(corrected < 0 ? 0 : (corrected > 255 ? 255 : corrected));
+		}
+
+		for (int i = 0; i < 4; i++)
+		{
+			Write(cursor, quantizedWeights[i]);
+		}
+	}
+
+	assert(static_cast<uint32_t>(cursor - outData) == Stride);
+}
+
+void VertexLayout::Decode(const uint8_t* someData, Vertex& outVertex) const
+{
+	const uint8_t* cursor = someData;
+	outVertex = Vertex();
+
+	if (Has(VertexAttribute::Position))
+	{
+		const float x = Read<float>(cursor);
+		const float y = Read<float>(cursor);
+		const float z = Read<float>(cursor);
+		outVertex.Position = { x, y, z, 1.0f };
+	}
+
+	for (int c = 0; c < MaxColorSets; c++)
+	{
+		if (Attributes & ColorAttributes[c])
+		{
+			const float r = Unorm8ToFloat(Read<uint8_t>(cursor));
+			const float g = Unorm8ToFloat(Read<uint8_t>(cursor));
+			const float b = Unorm8ToFloat(Read<uint8_t>(cursor));
+			const float a = Unorm8ToFloat(Read<uint8_t>(cursor));
+			outVertex.VertexColors[c] = { r, g, b, a };
+		}
+		else
+		{
+			outVertex.VertexColors[c] = { 1, 1, 1, 1 };
+		}
+	}
+
+	for (int uv = 0; uv < MaxUVSets; uv++)
+	{
+		if (Attributes & UVAttributes[uv])
+		{
+			const float u = VertexQuantization::HalfToFloat(Read<uint16_t>(cursor));
+			const float v = VertexQuantization::HalfToFloat(Read<uint16_t>(cursor));
+			outVertex.UVs[uv] = { u, v };
+		}
+	}
+
+	// Missing directions decode the way the shaders read them from DefaultData.
+	const uint32_t normal = Has(VertexAttribute::Normal) ? Read<uint32_t>(cursor) : 0;
+	outVertex.Normal = VertexQuantization::DecodeOctahedral(normal);
+
+	const uint32_t tangent = Has(VertexAttribute::Tangent) ? Read<uint32_t>(cursor) : 0;
+	const bool isMirrored = (tangent & (static_cast<uint32_t>(BinormalSignBit) << 16)) != 0;
+	outVertex.Tangent = VertexQuantization::DecodeOctahedral(tangent);
+	outVertex.Binormal = outVertex.Normal.Cross(outVertex.Tangent) * (isMirrored ? -1.0f : 1.0f);
+
+	if (Has(VertexAttribute::Skin))
+	{
+		const float b0 = static_cast<float>(Read<uint8_t>(cursor));
+		const float b1 = static_cast<float>(Read<uint8_t>(cursor));
+		const float b2 = static_cast<float>(Read<uint8_t>(cursor));
+		const float b3 = static_cast<float>(Read<uint8_t>(cursor));
+		outVertex.Bones = { b0, b1, b2, b3 };
+
+		const float w0 = Unorm8ToFloat(Read<uint8_t>(cursor));
+		const float w1 = Unorm8ToFloat(Read<uint8_t>(cursor));
+		const float w2 = Unorm8ToFloat(Read<uint8_t>(cursor));
+		const float w3 = Unorm8ToFloat(Read<uint8_t>(cursor));
+		outVertex.Weights = { w0, w1, w2, w3 };
+	}
+}
+
+void VertexLayout::EncodeVertices(const Vertex* someVertices, size_t aVertexCount, uint8_t* outData) const
+{
+	for (size_t v = 0; v < aVertexCount; v++)
+	{
+		Encode(someVertices[v], outData + v * Stride);
+	}
+}
+
+void VertexLayout::DecodeVertices(const uint8_t* someData, size_t aVertexCount, Vertex* outVertices) const
+{
+	for (size_t v = 0; v < aVertexCount; v++)
+	{
+		Decode(someData + v * Stride, outVertices[v]);
+	}
+}
+
+void VertexLayout::GetElements(VertexElement outElements[ElementCount]) const
+{
+	uint32_t offset = 0;
+	uint32_t count = 0;
+	auto add = [&](const char* aSemanticName, uint32_t aSemanticIndex, VertexElementFormat aFormat, bool anIsStored, uint32_t aSize, uint32_t aDefaultOffset)
+	{
+		outElements[count++] = { aSemanticName, aSemanticIndex, aFormat, anIsStored, anIsStored ? offset : aDefaultOffset };
+		if (anIsStored)
+		{
+			offset += aSize;
+		}
+	};
+
+	add("POSITION", 0, VertexElementFormat::Float3, Has(VertexAttribute::Position), sizeof(float) * 3, DefaultPositionOffset);
+
+	for (uint32_t c = 0; c < MaxColorSets; c++)
+	{
+		add("COLOR", c, VertexElementFormat::Unorm8x4, (Attributes & ColorAttributes[c]) != 0, 4, DefaultColorOffset);
+	}
+
+	for (uint32_t uv = 0; uv < MaxUVSets; uv++)
+	{
+		add("TEXCOORD", uv, VertexElementFormat::Half2, (Attributes & UVAttributes[uv]) != 0, 4, DefaultZeroOffset);
+	}
+
+	add("NORMAL", 0, VertexElementFormat::Snorm16x2, Has(VertexAttribute::Normal), 4, DefaultDirectionOffset);
+	// Read as integers so the shader gets the binormal sign bit as it is.
+	add("TANGENT", 0, VertexElementFormat::Sint16x2, Has(VertexAttribute::Tangent), 4, DefaultDirectionOffset);
+	add("BONES", 0, VertexElementFormat::Uint8x4, Has(VertexAttribute::Skin), 4, DefaultZeroOffset);
+	add("WEIGHTS", 0, VertexElementFormat::Unorm8x4, Has(VertexAttribute::Skin), 4, DefaultZeroOffset);
+
+	assert(count == ElementCount && offset == Stride);
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include <tge/math/Vector.h>
+#include <tge/graphics/Vertex.h>
+
+namespace Tga
+{
+
+enum class VertexAttribute : uint32_t
+{
+	None = 0,
+	Position = 1 << 0,
+	Color0 = 1 << 1,
+	Color1 = 1 << 2,
+	Color2 = 1 << 3,
+	Color3 = 1 << 4,
+	UV0 = 1 << 5,
+	UV1 = 1 << 6,
+	UV2 = 1 << 7,
+	UV3 = 1 << 8,
+	Normal = 1 << 9,
+	Tangent = 1 << 10,
+	Skin = 1 << 11,
+};
+
+enum class VertexElementFormat : uint8_t
+{
+	Float3,
+	Unorm8x4,
+	Half2,
+	Snorm16x2,
+	Sint16x2,
+	Uint8x4,
+};
+
+/// <summary>
+/// One input of the model vertex shaders, as the GPU reads it from a compact vertex.
+/// </summary>
+struct VertexElement
+{
+	const char* SemanticName;
+	uint32_t SemanticIndex;
+	VertexElementFormat Format;
+	// Elements the layout doesn't store are read from VertexLayout::DefaultData, bound with a stride of zero.
+	bool IsStored;
+	// Into the vertex when stored, into DefaultData otherwise.
+	uint32_t Offset;
+};
+
+/// <summary>
+/// Compact vertex layout built at import time from the attributes a mesh actually uses. The GPU reads it as it is,
+/// the model vertex shaders decode the normal and tangent.
+///
+/// Encodings:
+///  Position  float3                      12 bytes
+///  Color     unorm8x4                     4 bytes per set
+///  UV        half2                        4 bytes per set
+///  Normal    octahedral snorm16x2         4 bytes
+///  Tangent   octahedral snorm16x2         4 bytes, lowest bit of y is the binormal sign
+///  Skin      uint8x4 bones, unorm8x4 weights  8 bytes
+///
+/// Attributes a mesh doesn't have are left out of the attribute mask. They decode to white colors, zero UVs and
+/// weights, and a +Z normal and tangent, the same on the CPU as from DefaultData on the GPU.
+/// </summary>
+struct VertexLayout
+{
+	static constexpr int MaxColorSets = 4;
+	static constexpr int MaxUVSets = 4;
+	// Bone indices are stored as uint8, a skinned mesh can't reference joints past this.
+	static constexpr uint32_t MaxBones = 256;
+	// Position, colors, UVs, normal, tangent, bones and weights.
+	static constexpr uint32_t ElementCount = 1 + MaxColorSets + MaxUVSets + 4;
+
+	static constexpr uint32_t DefaultDataSize = 16;
+	static const uint8_t DefaultData[DefaultDataSize];
+
+	uint32_t Attributes = 0;
+	uint32_t Stride = 0;
+
+	bool Has(VertexAttribute anAttribute) const { return (Attributes & static_cast<uint32_t>(anAttribute)) != 0; }
+
+	/**
+	 * Looks through the vertices and builds a layout containing only the attributes that carry data.
+	 */
+	static VertexLayout Build(const Vertex* someVertices, size_t aVertexCount);
+
+	/**
+	 * Recreates a layout from the attribute mask stored in cooked data.
+	 */
+	static VertexLayout FromAttributes(uint32_t someAttributes);
+
+	void Encode(const Vertex& aVertex, uint8_t* outData) const;
+	void Decode(const uint8_t* someData, Vertex& outVertex) const;
+
+	void EncodeVertices(const Vertex* someVertices, size_t aVertexCount, uint8_t* outData) const;
+	void DecodeVertices(const uint8_t* someData, size_t aVertexCount, Vertex* outVertices) const;
+
+	/**
+	 * Describes every model vertex shader input in this layout, in the order of ModelVertexInput in common.hlsli.
+	 */
+	void GetElements(VertexElement outElements[ElementCount]) const;
+};
+
+namespace VertexQuantization
+{
+	uint16_t FloatToHalf(float aValue);
+	float HalfToFloat(uint16_t aValue);
+
+	/**
+	 * Octahedral encoding of a unit vector into two snorm16 values packed in a uint32 (x low, y high).
+	 * A zero vector has no direction and encodes as +Z, which is also what 0 decodes to.
+	 */
+	uint32_t EncodeOctahedral(const Vector3f& aDirection);
+	Vector3f DecodeOctahedral(uint32_t anEncoded);
+}
+
+} // namespace Tga
@@ -1,12 +1,15 @@
 #include "stdafx.h"
-#include <cstdio>
-#include <cassert>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <memory>
-#include <iostream>
-#define WIN32_LEAN_AND_MEAN 
-#define NOMINMAX 
-#include <windows.h>
+#include <vector>
+#include <intrin.h>
+#include <tmmintrin.h>
 #include <tge/loaders/tgaloader.h>
+#include <tge/util/MappedFile.h>
+
+static_assert(sizeof(Tga32::TgaHeader) == 18, "TgaHeader has to match the file layout");
 
 Tga32::Tga32()
 {
@@ -15,77 +18,374 @@ Tga32::~Tga32()
 {
 }
 Tga32::Image::Image()
+	: myWidth(0)
+	, myHeight(0)
+	, myBitDepth(0)
+	, myImage(nullptr)
 {
 }
 Tga32::Image::~Image()
 {
-	delete myImage;
+	delete[] myImage;
 }
 
-
-void FlipImageDataFast(const Tga32::TgaHeader& header, unsigned char* source, unsigned char* destination)
+namespace
 {
-	int height = header.myHeight;
-	const unsigned short stride = header.myWidth * 4;
+	enum ImageType : unsigned char
+	{
+		ColorMapped = 1,
+		TrueColor = 2,
+		Grayscale = 3,
+		RLEColorMapped = 9,
+		RLETrueColor = 10,
+		RLEGrayscale = 11,
+	};
 
-	unsigned char* row = (unsigned char*)malloc(stride);
-	unsigned char* low = source;
-	unsigned char* high = &source[(height - 1) * stride];
+	// Image descriptor bits.
+	constexpr unsigned char AlphaBitsMask = 0x0F;
+	constexpr unsigned char RightToLeft = 0x10;
+	constexpr unsigned char TopToBottom = 0x20;
 
-	for (; low < high; low += stride, high -= stride)
+	bool HasSSSE3()
 	{
-		memcpy(row, low, stride);
-		memcpy(low, high, stride);
-		memcpy(high, row, stride);
+		static const bool hasSSSE3 = []()
+		{
+			int info[4];
+			__cpuid(info, 1);
+			return (info[2] & (1 << 9)) != 0;
+		}();
+		return hasSSSE3;
 	}
-	free(row);
-	row = NULL;
 
-	for (int i = 0; i < height * stride; i += 4)
+	// Pixels are kept as one little endian uint32, which is RGBA8 in memory.
+	uint32_t MakeRGBA(uint32_t aR, uint32_t aG, uint32_t aB, uint32_t aA)
 	{
-		unsigned char temp = std::move(source[i]);
-		source[i] = std::move(source[i + 2]);
-		source[i + 2] = std::move(temp);
+		return aR | (aG << 8) | (aB << 16) | (aA << 24);
 	}
 
-	memcpy(destination, source, sizeof(source));
-}
+	// A1R5G5B5, little endian. The attribute bit is only alpha if the descriptor says there are alpha bits.
+	uint32_t Expand16(const unsigned char* aSource, bool aHasAlpha)
+	{
+		const uint32_t value = aSource[0] | (aSource[1] << 8);
+		const uint32_t r = (value >> 10) & 0x1F;
+		const uint32_t g = (value >> 5) & 0x1F;
+		const uint32_t b = value & 0x1F;
+		const uint32_t a = !aHasAlpha || (value & 0x8000) ? 255 : 0;
+		return MakeRGBA((r << 3) | (r >> 2), (g << 3) | (g >> 2), (b << 3) | (b >> 2), a);
+	}
 
+	/// <summary>
+	/// Converts runs of source pixels of one image to RGBA8. Bulk runs of 24 and 32 bit pixels are swizzled with
+	/// SSSE3 shuffles when the CPU has them.
+	/// </summary>
+	struct PixelConverter
+	{
+		unsigned char myBytesPerPixel = 0;
+		bool myIsGrayscale = false;
+		bool myHasAlpha = false;
+		// Indexed by the raw index for color mapped images, entries before the map's origin are transparent black.
+		// Empty for every other image type.
+		std::vector<uint32_t> myPalette;
 
+		uint32_t ConvertOne(const unsigned char* aSource) const
+		{
+			if (!myPalette.empty())
+			{
+				const size_t index = myBytesPerPixel == 1 ? aSource[0] : (aSource[0] | (aSource[1] << 8));
+				return index < myPalette.size() ? myPalette[index] : 0;
+			}
+			if (myIsGrayscale)
+			{
+				return MakeRGBA(aSource[0], aSource[0], aSource[0], myBytesPerPixel == 2 ? aSource[1] : 255);
+			}
+			switch (myBytesPerPixel)
+			{
+			case 2: return Expand16(aSource, myHasAlpha);
+			case 3: return MakeRGBA(aSource[2], aSource[1], aSource[0], 255);
+			default: return MakeRGBA(aSource[2], aSource[1], aSource[0], aSource[3]);
+			}
+		}
 
+		void Convert(const unsigned char* aSource, size_t aCount, uint32_t* outPixels) const
+		{
+			size_t i = 0;
+			if (myPalette.empty() && !myIsGrayscale && HasSSSE3())
+			{
+				if (myBytesPerPixel == 4)
+				{
+					const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+					for (; i + 4 <= aCount; i += 4)
+					{
+						const __m128i bgra = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSource + i * 4));
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(outPixels + i), _mm_shuffle_epi8(bgra, shuffle));
+					}
+				}
+				else if (myBytesPerPixel == 3)
+				{
+					// Four pixels are 12 of the 16 loaded bytes, so the loop stops while 16 bytes are still left.
+					const __m128i shuffle = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+					const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+					for (; i + 6 <= aCount; i += 4)
+					{
+						const __m128i bgr = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSource + i * 3));
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(outPixels + i), _mm_or_si128(_mm_shuffle_epi8(bgr, shuffle), alpha));
+					}
+				}
+			}
 
-Tga32::Image *Tga32::Load( const wchar_t* aName )
-{
-	FILE* fp = NULL;
-	Image* myImage;
+			for (; i < aCount; i++)
+			{
+				outPixels[i] = ConvertOne(aSource + i * myBytesPerPixel);
+			}
+		}
+	};
 
-	myImage = new Image(); //allocates return object
+	bool IsSupported(const Tga32::TgaHeader& aHeader)
+	{
+		if (aHeader.myWidth == 0 || aHeader.myHeight == 0)
+		{
+			return false;
+		}
 
-	_wfopen_s(&fp, aName, L"rb");
-	assert(fp != NULL);
+		switch (aHeader.myImageType)
+		{
+		case ColorMapped:
+		case RLEColorMapped:
+			return aHeader.myColorMapType == 1 && aHeader.myColorMapLength > 0
+				&& (aHeader.myBpp == 8 || aHeader.myBpp == 16)
+				&& (aHeader.myColorMapEntrySize == 15 || aHeader.myColorMapEntrySize == 16 || aHeader.myColorMapEntrySize == 24 || aHeader.myColorMapEntrySize == 32);
+		case TrueColor:
+		case RLETrueColor:
+			return aHeader.myBpp == 15 || aHeader.myBpp == 16 || aHeader.myBpp == 24 || aHeader.myBpp == 32;
+		case Grayscale:
+		case RLEGrayscale:
+			return aHeader.myBpp == 8 || aHeader.myBpp == 16;
+		default:
+			return false;
+		}
+	}
 
-	TgaHeader header;
-	fread(&header, sizeof(header), 1, fp); // loads the header
+	/// <summary>
+	/// Hands out destination rows in file order, which is bottom up unless the descriptor says otherwise, and mirrors
+	/// each row once it is complete if the file is stored right to left.
+	/// </summary>
+	class RowWriter
+	{
+	public:
+		RowWriter(const Tga32::TgaHeader& aHeader, unsigned char* outPixels, size_t aRowPitch)
+			: myPixels(outPixels)
+			, myRowPitch(aRowPitch)
+			, myWidth(aHeader.myWidth)
+			, myHeight(aHeader.myHeight)
+			, myIsTopToBottom((aHeader.myImageDescriptor & TopToBottom) != 0)
+			, myIsRightToLeft((aHeader.myImageDescriptor & RightToLeft) != 0)
+		{
+		}
+
+		bool IsDone() const { return myRow == myHeight; }
+		size_t GetRemainingInRow() const { return myWidth - myColumn; }
+		uint32_t* GetCurrent() const { return GetRow(myRow) + myColumn; }
+
+		void Advance(size_t aCount)
+		{
+			myColumn += aCount;
+			if (myColumn == myWidth)
+			{
+				if (myIsRightToLeft)
+				{
+					std::reverse(GetRow(myRow), GetRow(myRow) + myWidth);
+				}
+				myColumn = 0;
+				myRow++;
+			}
+		}
 
-	myImage->myWidth = header.myWidth;
-	myImage->myHeight = header.myHeight;
+	private:
+		uint32_t* GetRow(size_t aFileRow) const
+		{
+			const size_t row = myIsTopToBottom ? aFileRow : myHeight - 1 - aFileRow;
+			return reinterpret_cast<uint32_t*>(myPixels + row * myRowPitch);
+		}
 
-	if( header.myBpp == 32 )
+		unsigned char* myPixels;
+		size_t myRowPitch;
+		size_t myWidth;
+		size_t myHeight;
+		size_t myRow = 0;
+		size_t myColumn = 0;
+		bool myIsTopToBottom;
+		bool myIsRightToLeft;
+	};
+
+	// The caller checks the whole map is in the file.
+	bool ReadPalette(const Tga32::TgaHeader& aHeader, const unsigned char* someData, PixelConverter& outConverter)
+	{
+		const size_t entryBytes = (aHeader.myColorMapEntrySize + 7) / 8;
+		PixelConverter entryConverter;
+		entryConverter.myBytesPerPixel = static_cast<unsigned char>(entryBytes);
+		entryConverter.myHasAlpha = aHeader.myColorMapEntrySize == 16 && (aHeader.myImageDescriptor & AlphaBitsMask) != 0;
+
+		outConverter.myPalette.assign(static_cast<size_t>(aHeader.myColorMapOrigin) + aHeader.myColorMapLength, 0);
+		entryConverter.Convert(someData, aHeader.myColorMapLength, outConverter.myPalette.data() + aHeader.myColorMapOrigin);
+		return true;
+	}
+
+	bool DecodeUncompressed(const unsigned char* someData, const unsigned char* anEnd, const PixelConverter& aConverter, RowWriter& aWriter)
+	{
+		while (!aWriter.IsDone())
+		{
+			const size_t count = aWriter.GetRemainingInRow();
+			if (static_cast<size_t>(anEnd - someData) < count * aConverter.myBytesPerPixel)
+			{
+				return false;
+			}
+			aConverter.Convert(someData, count, aWriter.GetCurrent());
+			someData += count * aConverter.myBytesPerPixel;
+			aWriter.Advance(count);
+		}
+		return true;
+	}
+
+	// Most runs are short, so they are written four pixels at a time while the row has room for it instead of looping
+	// per pixel. Writing past the run is fine, those pixels are written again by the next packets.
+	void FillRun(uint32_t* outPixels, size_t aCount, size_t aRoomInRow, uint32_t aPixel)
 	{
-		myImage->myImage = (unsigned char*)malloc(myImage->myHeight * myImage->myWidth * 4 + myImage->myWidth * 4);
+		const size_t roundedCount = (aCount + 3) & ~static_cast<size_t>(3);
+		if (roundedCount > aRoomInRow)
+		{
+			std::fill_n(outPixels, aCount, aPixel);
+			return;
+		}
 
-		unsigned char* buffer;
-		buffer = myImage->myImage + myImage->myWidth * 4;
+		const __m128i pixels = _mm_set1_epi32(static_cast<int>(aPixel));
+		for (size_t i = 0; i < roundedCount; i += 4)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(outPixels + i), pixels);
+		}
+	}
 
-		fread(buffer, myImage->myHeight * myImage->myWidth * 4, 1, fp); // loads the image
+	// Packets may run across rows, every packet is split at row ends so the rows can be mirrored as they complete.
+	bool DecodeRLE(const unsigned char* someData, const unsigned char* anEnd, const PixelConverter& aConverter, RowWriter& aWriter)
+	{
+		const size_t bytesPerPixel = aConverter.myBytesPerPixel;
+		while (!aWriter.IsDone())
+		{
+			if (someData == anEnd)
+			{
+				return false;
+			}
+			const unsigned char packet = *someData++;
+			size_t count = (packet & 0x7F) + 1;
 
-		fclose(fp);
+			if (packet & 0x80)
+			{
+				if (static_cast<size_t>(anEnd - someData) < bytesPerPixel)
+				{
+					return false;
+				}
+				const uint32_t pixel = aConverter.ConvertOne(someData);
+				someData += bytesPerPixel;
 
-		FlipImageDataFast(header, buffer, myImage->myImage);
+				while (count > 0 && !aWriter.IsDone())
+				{
+					const size_t remaining = aWriter.GetRemainingInRow();
+					const size_t runCount = std::min(count, remaining);
+					FillRun(aWriter.GetCurrent(), runCount, remaining, pixel);
+					aWriter.Advance(runCount);
+					count -= runCount;
+				}
+			}
+			else
+			{
+				if (static_cast<size_t>(anEnd - someData) < count * bytesPerPixel)
+				{
+					return false;
+				}
 
-		myImage->myBitDepth=32;
-		return(myImage);
+				while (count > 0 && !aWriter.IsDone())
+				{
+					const size_t rawCount = std::min(count, aWriter.GetRemainingInRow());
+					aConverter.Convert(someData, rawCount, aWriter.GetCurrent());
+					someData += rawCount * bytesPerPixel;
+					aWriter.Advance(rawCount);
+					count -= rawCount;
+				}
+			}
+		}
+		return true;
+	}
+}
+
+bool Tga32::ReadHeader(const unsigned char* someData, size_t aSize, TgaHeader& outHeader)
+{
+	if (!someData || aSize < sizeof(TgaHeader))
+	{
+		return false;
+	}
+	memcpy(&outHeader, someData, sizeof(TgaHeader));
+	return IsSupported(outHeader);
+}
+
+bool Tga32::Decode(const unsigned char* someData, size_t aSize, unsigned char* outPixels, size_t aRowPitch)
+{
+	TgaHeader header;
+	if (!ReadHeader(someData, aSize, header) || aRowPitch < static_cast<size_t>(header.myWidth) * 4)
+	{
+		return false;
+	}
+
+	const unsigned char* end = someData + aSize;
+	const unsigned char* data = someData + sizeof(TgaHeader);
+	if (static_cast<size_t>(end - data) < header.myIdLength)
+	{
+		return false;
+	}
+	data += header.myIdLength;
+
+	PixelConverter converter;
+	converter.myBytesPerPixel = static_cast<unsigned char>((header.myBpp + 7) / 8);
+	converter.myIsGrayscale = header.myImageType == Grayscale || header.myImageType == RLEGrayscale;
+	converter.myHasAlpha = header.myBpp != 15 && (header.myImageDescriptor & AlphaBitsMask) != 0;
+
+	const bool isColorMapped = header.myImageType == ColorMapped || header.myImageType == RLEColorMapped;
+	if (header.myColorMapType == 1)
+	{
+		// Images that aren't color mapped may still carry a map, it only has to be skipped.
+		const size_t mapSize = header.myColorMapLength * static_cast<size_t>((header.myColorMapEntrySize + 7) / 8);
+		if (static_cast<size_t>(end - data) < mapSize || (isColorMapped && !ReadPalette(header, data, converter)))
+		{
+			return false;
+		}
+		data += mapSize;
+	}
+
+	RowWriter writer(header, outPixels, aRowPitch);
+	const bool isRLE = header.myImageType >= RLEColorMapped;
+	return isRLE ? DecodeRLE(data, end, converter, writer) : DecodeUncompressed(data, end, converter, writer);
+}
+
+Tga32::Image *Tga32::Load( const wchar_t* aName )
+{
+	Tga::MappedFile file;
+	if (!aName || !file.Open(aName))
+	{
+		return nullptr;
+	}
+
+	TgaHeader header;
+	if (!ReadHeader(file.GetData(), file.GetSize(), header))
+	{
+		return nullptr;
+	}
+
+	std::unique_ptr<Image> image(new Image());
+	image->myWidth = header.myWidth;
+	image->myHeight = header.myHeight;
+	image->myBitDepth = 32;
+	image->myImage = new unsigned char[static_cast<size_t>(header.myWidth) * header.myHeight * 4];
+	if (!Decode(file.GetData(), file.GetSize(), image->myImage, static_cast<size_t>(header.myWidth) * 4))
+	{
+		return nullptr;
 	}
-	
-	return( NULL );
+	return image.release();
 }
@@ -1,24 +1,28 @@
 #ifndef _OPTIMIZABLE_TGA_H_
 #define _OPTIMIZABLE_TGA_H_
 
+#include <cstddef>
+
 class Tga32
 {
 public:		struct Image
 			{
 				unsigned short myWidth;
 				unsigned short myHeight;
+				// Always 32, images are decoded to RGBA8 with the top row first.
 				unsigned char myBitDepth;
 				unsigned char *myImage;
 				Image();
 				~Image();
 			};
-				
-				
+
+			// The 18 bytes at the start of every .tga file.
+#pragma pack(push, 1)
 			struct TgaHeader {
 				unsigned char myIdLength;
 				unsigned char myColorMapType;
 				unsigned char myImageType;
-				unsigned char myColorMapOrigin;
+				unsigned short myColorMapOrigin;
 				unsigned short myColorMapLength;
 				unsigned char myColorMapEntrySize;
 				unsigned short myImageOriginX;
@@ -28,13 +32,32 @@ public:		struct Image
 				unsigned char myBpp;
 				unsigned char myImageDescriptor;
 			};
-				
-				
+#pragma pack(pop)
+
 			Tga32();
 			~Tga32();
-				
+
+			/**
+			 * Memory maps and decodes a .tga file.
+			 * @returns nullptr if the file can't be opened or isn't a supported .tga.
+			 */
 			static Image* Load( const wchar_t* aName );
-			
+
+			/**
+			 * Reads the header of a .tga file in memory. Color mapped, true color and grayscale images are supported,
+			 * RLE compressed or not, in every bit depth and origin the format allows.
+			 * @returns false if the file is truncated or isn't a supported .tga.
+			 */
+			static bool ReadHeader( const unsigned char* someData, size_t aSize, TgaHeader& outHeader );
+
+			/**
+			 * Decodes a .tga file in memory to RGBA8, top row first, straight into outPixels. Nothing else is
+			 * allocated except the palette of color mapped images.
+			 * @param aRowPitch Bytes from one row of outPixels to the next, at least width * 4.
+			 * @returns false if the file is truncated or isn't a supported .tga, outPixels may be partly written.
+			 */
+			static bool Decode( const unsigned char* someData, size_t aSize, unsigned char* outPixels, size_t aRowPitch );
+
 };
 
 
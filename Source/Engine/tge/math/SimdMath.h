@@ -0,0 +1,109 @@
+#pragma once
+#include <emmintrin.h>
+
+namespace Tga
+{
+
+/// <summary>
+/// Four-wide SSE2 approximations shared by the sprite and particle code.
+/// </summary>
+namespace Simd
+{
+	inline __m128 Select(__m128 aMask, __m128 aTrue, __m128 aFalse)
+	{
+		return _mm_or_ps(_mm_and_ps(aMask, aTrue), _mm_andnot_ps(aMask, aFalse));
+	}
+
+	// Polynomial sincos, max error around 1e-7 in [-pi, pi] after range reduction.
+	inline void SinCos(__m128 anAngle, __m128& outSin, __m128& outCos)
+	{
+		const __m128 pi = _mm_set1_ps(3.1415926535f);
+		const __m128 halfPi = _mm_set1_ps(1.5707963267f);
+		const __m128 signBit = _mm_set1_ps(-0.0f);
+
+		// Wrap to [-pi, pi]. 2pi is split in two so large angles don't lose precision.
+		const __m128 quotient = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(anAngle, _mm_set1_ps(0.1591549430f))));
+		__m128 y = _mm_sub_ps(anAngle, _mm_mul_ps(quotient, _mm_set1_ps(6.28125f)));
+		y = _mm_sub_ps(y, _mm_mul_ps(quotient, _mm_set1_ps(1.9353071795864769e-3f)));
+
+		// Reflect into [-pi/2, pi/2], which flips the sign of the cosine.
+		const __m128 ySign = _mm_and_ps(y, signBit);
+		const __m128 reflect = _mm_cmpgt_ps(_mm_andnot_ps(signBit, y), halfPi);
+		y = Select(reflect, _mm_sub_ps(_mm_or_ps(pi, ySign), y), y);
+		const __m128 cosSign = _mm_and_ps(reflect, signBit);
+
+		const __m128 y2 = _mm_mul_ps(y, y);
+
+		__m128 sin = _mm_set1_ps(-2.3889859e-08f);
+		sin = _mm_add_ps(_mm_mul_ps(sin, y2), _mm_set1_ps(2.7525562e-06f));
+		sin = _mm_add_ps(_mm_mul_ps(sin, y2), _mm_set1_ps(-0.00019840874f));
+		sin = _mm_add_ps(_mm_mul_ps(sin, y2), _mm_set1_ps(0.0083333310f));
+		sin = _mm_add_ps(_mm_mul_ps(sin, y2), _mm_set1_ps(-0.16666667f));
+		sin = _mm_add_ps(_mm_mul_ps(sin, y2), _mm_set1_ps(1.0f));
+		outSin = _mm_mul_ps(sin, y);
+
+		__m128 cos = _mm_set1_ps(-2.6051615e-07f);
+		cos = _mm_add_ps(_mm_mul_ps(cos, y2), _mm_set1_ps(2.4760495e-05f));
+		cos = _mm_add_ps(_mm_mul_ps(cos, y2), _mm_set1_ps(-0.0013888378f));
+		cos = _mm_add_ps(_mm_mul_ps(cos, y2), _mm_set1_ps(0.041666638f));
+		cos = _mm_add_ps(_mm_mul_ps(cos, y2), _mm_set1_ps(-0.5f));
+		cos = _mm_add_ps(_mm_mul_ps(cos, y2), _mm_set1_ps(1.0f));
+		outCos = _mm_xor_ps(cos, cosSign);
+	}
+
+	// log2 for positive, normal inputs.
+	inline __m128 Log2(__m128 aValue)
+	{
+		const __m128i exponentMask = _mm_set1_epi32(0x7f800000);
+		const __m128i mantissaMask = _mm_set1_epi32(0x007fffff);
+		const __m128i bits = _mm_castps_si128(aValue);
+
+		const __m128 exponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(_mm_and_si128(bits, exponentMask), 23), _mm_set1_epi32(127)));
+		const __m128 mantissa = _mm_or_ps(_mm_castsi128_ps(_mm_and_si128(bits, mantissaMask)), _mm_set1_ps(1.0f));
+
+		__m128 p = _mm_set1_ps(-3.4436006e-2f);
+		p = _mm_add_ps(_mm_mul_ps(p, mantissa), _mm_set1_ps(3.1821337e-1f));
+		p = _mm_add_ps(_mm_mul_ps(p, mantissa), _mm_set1_ps(-1.2315303f));
+		p = _mm_add_ps(_mm_mul_ps(p, mantissa), _mm_set1_ps(2.5988452f));
+		p = _mm_add_ps(_mm_mul_ps(p, mantissa), _mm_set1_ps(-3.3241990f));
+		p = _mm_add_ps(_mm_mul_ps(p, mantissa), _mm_set1_ps(3.1157899f));
+
+		return _mm_add_ps(_mm_mul_ps(p, _mm_sub_ps(mantissa, _mm_set1_ps(1.0f))), exponent);
+	}
+
+	inline __m128 Exp2(__m128 aValue)
+	{
+		aValue = _mm_max_ps(_mm_min_ps(aValue, _mm_set1_ps(127.0f)), _mm_set1_ps(-126.0f));
+
+		// Floor without SSE4.1.
+		__m128 whole = _mm_cvtepi32_ps(_mm_cvttps_epi32(aValue));
+		whole = _mm_sub_ps(whole, _mm_and_ps(_mm_cmpgt_ps(whole, aValue), _mm_set1_ps(1.0f)));
+		const __m128 fraction = _mm_sub_ps(aValue, whole);
+
+		const __m128 power = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_cvtps_epi32(whole), _mm_set1_epi32(127)), 23));
+
+		__m128 p = _mm_set1_ps(1.8775767e-3f);
+		p = _mm_add_ps(_mm_mul_ps(p, fraction), _mm_set1_ps(8.9893397e-3f));
+		p = _mm_add_ps(_mm_mul_ps(p, fraction), _mm_set1_ps(5.5826318e-2f));
+		p = _mm_add_ps(_mm_mul_ps(p, fraction), _mm_set1_ps(2.4015361e-1f));
+		p = _mm_add_ps(_mm_mul_ps(p, fraction), _mm_set1_ps(6.9315308e-1f));
+		p = _mm_add_ps(_mm_mul_ps(p, fraction), _mm_set1_ps(9.9999994e-1f));
+
+		return _mm_mul_ps(p, power);
+	}
+
+	// Same curve as Color::InverseEOTF.
+	inline __m128 InverseEOTF(__m128 aValue)
+	{
+		const __m128 threshold = _mm_set1_ps(0.04045f);
+		const __m128 linear = _mm_mul_ps(aValue, _mm_set1_ps(1.0f / 12.92f));
+
+		// Clamp the base so lanes that take the linear branch never feed log2 a negative.
+		const __m128 base = _mm_mul_ps(_mm_add_ps(_mm_max_ps(aValue, threshold), _mm_set1_ps(0.055f)), _mm_set1_ps(1.0f / 1.055f));
+		const __m128 curve = Exp2(_mm_mul_ps(Log2(base), _mm_set1_ps(2.4f)));
+
+		return Select(_mm_cmpge_ps(aValue, threshold), curve, linear);
+	}
+}
+
+} // namespace Tga
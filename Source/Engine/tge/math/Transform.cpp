@@ -4,12 +4,12 @@
 using namespace Tga;
 
 Transform::Transform(Vector3f somePosition, Rotator someRotation, Vector3f someScale) : myPosition(somePosition),
-	myRotation(someRotation), myScale(someScale)
+	myRotation(someRotation * FMath::DegToRad), myScale(someScale)
 {
 }
 
 Transform::Transform(Vector3f somePosition, Quaternionf someRotation, Vector3f someScale) : myPosition(somePosition),
-	myRotation(someRotation.GetEulerAnglesDegrees()), myScale(someScale)
+	myRotation(someRotation.GetNormalized()), myScale(someScale)
 {
 }
 
@@ -20,7 +20,12 @@ void Transform::SetPosition(Vector3f somePosition)
 
 void Transform::SetRotation(Rotator someRotation)
 {
-	myRotation = someRotation;
+	myRotation = Quatf(someRotation * FMath::DegToRad);
+}
+
+void Transform::SetRotation(const Quatf& someRotation)
+{
+	myRotation = someRotation.GetNormalized();
 }
 
 void Transform::SetScale(Vector3f someScale)
@@ -30,5 +35,6 @@ void Transform::SetScale(Vector3f someScale)
 
 void Transform::AddRotation(Rotator someRotation)
 {
-	SetRotation(myRotation + someRotation);
+	// Quaternion products apply the left rotation first, so the delta is applied on top of the current rotation.
+	myRotation = (myRotation * Quatf(someRotation * FMath::DegToRad)).GetNormalized();
 }
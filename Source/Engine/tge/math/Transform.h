@@ -17,7 +17,7 @@ struct Transform
 	
 private:
 	Vector3f myPosition = Vector3f::Zero;
-	Vector3f myRotation = Vector3f::Zero;
+	Quatf myRotation;
 	Vector3f myScale = Vector3f::One;
 	
 public:
@@ -27,51 +27,49 @@ public:
 	Transform(Vector3f somePosition, Quaternionf someRotation, Vector3f someScale = Vector3f::One);
 
 	Vector3f GetPosition() const { return myPosition; }
-	Rotator GetRotation() const { return myRotation; }
-	Quatf GetQuaternion() const { return Quatf(GetMatrix()); } 
+	// Euler angles in degrees, converted from the stored quaternion.
+	Rotator GetRotation() const { return myRotation.GetEulerAnglesDegrees(); }
+	const Quatf& GetQuaternion() const { return myRotation; }
 	Vector3f GetScale() const { return myScale; }
 
 	void SetPosition(Vector3f somePosition);
 	void SetRotation(Rotator someRotation);
+	void SetRotation(const Quatf& someRotation);
 	void SetScale(Vector3f someScale);
 
+	/**
+	 * Rotates by someRotation, in degrees, after the current rotation. Stays on the quaternion, so it doesn't drift
+	 * or flip the way adding Euler angles does.
+	 */
 	void AddRotation(Rotator someRotation);
 
+	/**
+	 * Builds scale * rotation * translation straight from the quaternion, without any intermediate matrix multiplies.
+	 * @param bNoScale Leaves the scale out of the matrix.
+	 */
 	Matrix4x4f GetMatrix(bool bNoScale = false) const
 	{
-		Matrix4x4f result = Matrix4x4f::CreateIdentityMatrix();
-
-		if (bNoScale)
-			result *= Matrix4x4f::CreateScaleMatrix({ 1, 1, 1 });
-		else
-			result *= Matrix4x4f::CreateScaleMatrix(myScale);
-
-		result *= Matrix4x4f::CreateRollPitchYawMatrix(myRotation);
-		result *= Matrix4x4f::CreateTranslationMatrix(myPosition);
-
-		return result;
+		const float x = myRotation.X;
+		const float y = myRotation.Y;
+		const float z = myRotation.Z;
+		const float w = myRotation.W;
+
+		const float xx = x * x, yy = y * y, zz = z * z;
+		const float xy = x * y, xz = x * z, yz = y * z;
+		const float wx = w * x, wy = w * y, wz = w * z;
+
+		const float sx = bNoScale ? 1.0f : myScale.X;
+		const float sy = bNoScale ? 1.0f : myScale.Y;
+		const float sz = bNoScale ? 1.0f : myScale.Z;
+
+		return
+		{
+			sx * (1.0f - 2.0f * (yy + zz)), sx * (2.0f * (xy + wz)), sx * (2.0f * (xz - wy)), 0.0f,
+			sy * (2.0f * (xy - wz)), sy * (1.0f - 2.0f * (xx + zz)), sy * (2.0f * (yz + wx)), 0.0f,
+			sz * (2.0f * (xz + wy)), sz * (2.0f * (yz - wx)), sz * (1.0f - 2.0f * (xx + yy)), 0.0f,
+			myPosition.X, myPosition.Y, myPosition.Z, 1.0f
+		};
 	}
-	
-	//FORCEINLINE Matrix4x4f GetMatrix(bool bNoScale = false)
-	//{
-	//	if(IsDirty)
-	//	{
-	//		matrixCache = Matrix4x4f::CreateIdentityMatrix();
-
-	//		if (bNoScale)
-	//			matrixCache *= Matrix4x4f::CreateScaleMatrix({ 1, 1, 1 });
-	//		else
-	//			matrixCache *= Matrix4x4f::CreateScaleMatrix(myScale);
-
-	//		matrixCache *= Matrix4x4f::CreateRollPitchYawMatrix(myRotation);
-	//		matrixCache *= Matrix4x4f::CreateTranslationMatrix(myPosition);
-	//		
-	//		IsDirty = false;
-	//	}
-
-
-	//	return matrixCache;
-	//}
 
 	VectorRegister VectorTransformVector(const VectorRegister& VecP, const void* MatrixM) const
 	{
@@ -117,6 +115,46 @@ public:
 	}
 };
 
+/// <summary>
+/// A Transform that keeps its matrix around until it is changed.
+/// Use it for things that are drawn every frame but rarely move. GetMatrix rebuilds the cache lazily,
+/// so the first call after a change must not race with other readers.
+/// </summary>
+class CachedTransform
+{
+public:
+	CachedTransform() = default;
+	CachedTransform(const Transform& aTransform) : myTransform(aTransform) {}
+
+	const Transform& GetTransform() const { return myTransform; }
+	void SetTransform(const Transform& aTransform) { myTransform = aTransform; myIsDirty = true; }
+
+	Vector3f GetPosition() const { return myTransform.GetPosition(); }
+	Rotator GetRotation() const { return myTransform.GetRotation(); }
+	const Quatf& GetQuaternion() const { return myTransform.GetQuaternion(); }
+	Vector3f GetScale() const { return myTransform.GetScale(); }
+
+	void SetPosition(Vector3f somePosition) { myTransform.SetPosition(somePosition); myIsDirty = true; }
+	void SetRotation(Rotator someRotation) { myTransform.SetRotation(someRotation); myIsDirty = true; }
+	void SetRotation(const Quatf& someRotation) { myTransform.SetRotation(someRotation); myIsDirty = true; }
+	void SetScale(Vector3f someScale) { myTransform.SetScale(someScale); myIsDirty = true; }
+
+	const Matrix4x4f& GetMatrix() const
+	{
+		if (myIsDirty)
+		{
+			myMatrix = myTransform.GetMatrix();
+			myIsDirty = false;
+		}
+		return myMatrix;
+	}
+
+private:
+	Transform myTransform;
+	mutable Matrix4x4f myMatrix;
+	mutable bool myIsDirty = true;
+};
+
 } // namespace Tga
 
 #undef SHUFFLEMASK
@@ -6,6 +6,7 @@
 #include <tge/animation/Pose.h>
 #include <tge/drawers/DebugDrawer.h>
 #include <tge/shaders/ModelShader.h>
+#include <tge/texture/texture.h>
 
 using namespace Tga;
 
@@ -26,7 +27,7 @@ void AnimatedModelInstance::Init(std::shared_ptr<Model> aModel)
 
 void AnimatedModelInstance::SetTransform(const Transform& someTransform)
 {
-	myTransform = someTransform;
+	myTransform.SetTransform(someTransform);
 }
 
 void AnimatedModelInstance::SetRotation(Rotator someRotation)
@@ -46,13 +47,24 @@ void AnimatedModelInstance::SetScale(Vector3f someScale)
 	myTransform.SetScale(someScale);
 }
 
+int AnimatedModelInstance::SelectLOD(int aMeshIndex) const
+{
+	if (myForcedLOD >= 0)
+	{
+		return myForcedLOD;
+	}
+
+	// Bounds are from the bind pose, close enough for picking a LOD.
+	return myModel->SelectLOD(aMeshIndex, myTransform.GetTransform(), myMaxLODPixelError, LODView::GetActive());
+}
+
 void AnimatedModelInstance::Render(const ModelShader& shader) const
 {
 	const std::vector<Model::MeshData>& meshData = myModel->GetMeshDataList();
 
 	for (int j = 0; j < meshData.size(); j++)
 	{
-		shader.Render(myTextures[j], meshData[j], myTransform.GetMatrix(), myBoneTransforms);
+		shader.Render(myTextures[j], meshData[j], myTransform.GetMatrix(), myBoneTransforms, SelectLOD(j));
 	}
 }
 
@@ -63,7 +75,7 @@ void AnimatedModelInstance::Render(const ModelShader& shader, int aMeshIndex) co
 	assert(aMeshIndex < meshData.size());
 	if (aMeshIndex < meshData.size())
 	{
-		shader.Render(myTextures[aMeshIndex], meshData[aMeshIndex], myTransform.GetMatrix(), myBoneTransforms);
+		shader.Render(myTextures[aMeshIndex], meshData[aMeshIndex], myTransform.GetMatrix(), myBoneTransforms, SelectLOD(aMeshIndex));
 	}
 }
 
@@ -92,3 +104,23 @@ void AnimatedModelInstance::ResetPose()
 		myBoneTransforms[i] = Matrix4x4f::CreateIdentityMatrix();
 	}
 }
+
+void AnimatedModelInstance::SetTexture(int meshIndex, int textureIndex, TextureResource* texture)
+{
+	myTextures[meshIndex][textureIndex] = texture;
+	if (!myTextureHandles.empty())
+	{
+		myTextureHandles[meshIndex * 4 + textureIndex].Reset();
+	}
+}
+
+void AnimatedModelInstance::SetTexture(int meshIndex, int textureIndex, TextureHandle texture)
+{
+	myTextures[meshIndex][textureIndex] = texture.Get();
+	// Only allocated once a handle is set, textures set by pointer are kept alive by whoever set them.
+	if (myTextureHandles.empty())
+	{
+		myTextureHandles.resize(MAX_MESHES_PER_MODEL * 4);
+	}
+	myTextureHandles[meshIndex * 4 + textureIndex] = std::move(texture);
+}
@@ -6,6 +6,8 @@
 #include <tge/EngineDefines.h>
 #include <tge/model/model.h>
 #include <tge/render/RenderCommon.h>
+#include <tge/texture/TextureHandle.h>
+#include <vector>
 
 #include <tge/EngineMacros.h>
 
@@ -29,15 +31,31 @@ namespace Tga
 		void Render(const ModelShader& shader) const;
 		void Render(const ModelShader& shader, int aMeshIndex) const;
 
-		const Transform& GetTransform() const { return myTransform; }
+		const Transform& GetTransform() const { return myTransform.GetTransform(); }
 		void SetTransform(const Transform& someTransform);
 		void SetRotation(Rotator someRotation);
 		void SetLocation(Vector3f someLocation);
 		void SetScale(Vector3f someScale);
 		bool IsValid() const { return myModel ? true : false; }
-		void SetTexture(int meshIndex, int textureIndex, TextureResource* texture) { myTextures[meshIndex][textureIndex] = texture; }
+		void SetTexture(int meshIndex, int textureIndex, TextureResource* texture);
+		/**
+		 * Same as above but keeps the handle, so the texture stays loaded for as long as this instance uses it.
+		 */
+		void SetTexture(int meshIndex, int textureIndex, TextureHandle texture);
 		const TextureResource* const* GetTextures(size_t meshIndex) const { return myTextures[meshIndex]; }
 
+		/**
+		 * Instances pick the coarsest LOD whose error projects to at most this many pixels.
+		 */
+		void SetMaxLODPixelError(float aPixelError) { myMaxLODPixelError = aPixelError; }
+		float GetMaxLODPixelError() const { return myMaxLODPixelError; }
+
+		/**
+		 * Forces a LOD for every mesh, -1 goes back to picking one from the projected size.
+		 */
+		void SetForcedLOD(int aLOD) { myForcedLOD = aLOD; }
+		int SelectLOD(int aMeshIndex) const;
+
 		void SetPose(const LocalSpacePose& pose);
 		void SetPose(const ModelSpacePose& pose);
 		void SetPose(const AnimationPlayer& animationInstance);
@@ -46,11 +64,14 @@ namespace Tga
 		std::shared_ptr<Model> GetModel() { return myModel; }
 		const std::shared_ptr<const Model> GetModel() const { return myModel; }
 	private:
-		Transform myTransform;
+		CachedTransform myTransform;
 		std::shared_ptr<Model> myModel = nullptr;
 
 		const TextureResource* myTextures[MAX_MESHES_PER_MODEL][4] = {};
+		std::vector<TextureHandle> myTextureHandles;
 		Matrix4x4f myBoneTransforms[MAX_ANIMATION_BONES];
+		float myMaxLODPixelError = DEFAULT_LOD_PIXEL_ERROR;
+		int myForcedLOD = -1;
 	};
 
 }
@@ -0,0 +1,420 @@
+#include "stdafx.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace Tga;
+
+namespace
+{
+	// Tuning values from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation".
+	constexpr int ForsythCacheSize = 32;
+	constexpr float CacheDecayPower = 1.5f;
+	constexpr float LastTriangleScore = 0.75f;
+	constexpr float ValenceBoostScale = 2.0f;
+	constexpr float ValenceBoostPower = 0.5f;
+
+	constexpr unsigned int InvalidIndex = ~0u;
+
+	float ComputeVertexScore(int aCachePosition, unsigned int aRemainingTriangles)
+	{
+		if (aRemainingTriangles == 0)
+		{
+			// No triangles left that use this vertex, it should never be picked.
+			return -1.0f;
+		}
+
+		float score = 0.0f;
+		if (aCachePosition >= 0)
+		{
+			if (aCachePosition < 3)
+			{
+				// Used by the last triangle, deliberately a bit lower than the next ones so we don't
+				// just keep fanning around the same vertex.
+				score = LastTriangleScore;
+			}
+			else
+			{
+				const float scaler = 1.0f / static_cast<float>(ForsythCacheSize - 3);
+				score = std::pow(1.0f - static_cast<float>(aCachePosition - 3) * scaler, CacheDecayPower);
+			}
+		}
+
+		// Boost vertices with few triangles left so we get rid of lone triangles early.
+		score += ValenceBoostScale * std::pow(static_cast<float>(aRemainingTriangles), -ValenceBoostPower);
+		return score;
+	}
+
+	struct Float3
+	{
+		float X, Y, Z;
+	};
+
+	Float3 ReadPosition(const uint8_t* somePositions, size_t aStride, unsigned int anIndex)
+	{
+		Float3 position;
+		memcpy(&position, somePositions + static_cast<size_t>(anIndex) * aStride, sizeof(Float3));
+		return position;
+	}
+}
+
+VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(const unsigned int* someIndices, size_t anIndexCount, size_t aVertexCount, unsigned int aCacheSize)
+{
+	VertexCacheStatistics result;
+	const size_t triangleCount = anIndexCount / 3;
+	if (triangleCount == 0 || aVertexCount == 0)
+	{
+		return result;
+	}
+
+	// A vertex is in the FIFO if it was inserted within the last aCacheSize misses.
+	std::vector<unsigned int> insertedAt(aVertexCount, 0);
+	std::vector<bool> isReferenced(aVertexCount, false);
+	unsigned int time = aCacheSize + 1;
+	unsigned int misses = 0;
+	unsigned int referencedCount = 0;
+
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		const unsigned int index = someIndices[i];
+		if (time - insertedAt[index] > aCacheSize)
+		{
+			insertedAt[index] = time++;
+			misses++;
+		}
+
+		if (!isReferenced[index])
+		{
+			isReferenced[index] = true;
+			referencedCount++;
+		}
+	}
+
+	result.ACMR = static_cast<float>(misses) / static_cast<float>(triangleCount);
+	result.ATVR = referencedCount > 0 ? static_cast<float>(misses) / static_cast<float>(referencedCount) : 0.0f;
+	return result;
+}
+
+void MeshOptimizer::OptimizeVertexCache(unsigned int* someIndices, size_t anIndexCount, size_t aVertexCount)
+{
+	const size_t triangleCount = anIndexCount / 3;
+	if (triangleCount == 0 || aVertexCount == 0)
+	{
+		return;
+	}
+
+	// Vertex to triangle adjacency, packed into one array. The live part of each vertex list
+	// is [offset, offset + remaining), emitted triangles get swapped out past the end.
+	std::vector<unsigned int> remaining(aVertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		remaining[someIndices[i]]++;
+	}
+
+	std::vector<unsigned int> adjacencyOffsets(aVertexCount + 1, 0);
+	for (size_t v = 0; v < aVertexCount; v++)
+	{
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remaining[v];
+	}
+
+	std::vector<unsigned int> adjacency(triangleCount * 3);
+	{
+		std::vector<unsigned int> writeCursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				adjacency[writeCursor[someIndices[t * 3 + k]]++] = static_cast<unsigned int>(t);
+			}
+		}
+	}
+
+	std::vector<int> cachePosition(aVertexCount, -1);
+	std::vector<float> vertexScores(aVertexCount);
+	for (size_t v = 0; v < aVertexCount; v++)
+	{
+		vertexScores[v] = ComputeVertexScore(-1, remaining[v]);
+	}
+
+	std::vector<bool> isEmitted(triangleCount, false);
+	int bestTriangle = -1;
+	float bestScore = -1.0f;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const float score = vertexScores[someIndices[t * 3]] + vertexScores[someIndices[t * 3 + 1]] + vertexScores[someIndices[t * 3 + 2]];
+		if (score > bestScore)
+		{
+			bestScore = score;
+			bestTriangle = static_cast<int>(t);
+		}
+	}
+
+	std::vector<unsigned int> output;
+	output.reserve(triangleCount * 3);
+
+	unsigned int cache[ForsythCacheSize + 3];
+	int cacheCount = 0;
+	size_t fallbackCursor = 0;
+
+	while (bestTriangle >= 0)
+	{
+		const unsigned int* triangle = someIndices + static_cast<size_t>(bestTriangle) * 3;
+		isEmitted[bestTriangle] = true;
+
+		for (int k = 0; k < 3; k++)
+		{
+			const unsigned int vertex = triangle[k];
+			output.push_back(vertex);
+
+			unsigned int* list = adjacency.data() + adjacencyOffsets[vertex];
+			for (unsigned int i = 0; i < remaining[vertex]; i++)
+			{
+				if (list[i] == static_cast<unsigned int>(bestTriangle))
+				{
+					list[i] = list[remaining[vertex] - 1];
+					list[remaining[vertex] - 1] = static_cast<unsigned int>(bestTriangle);
+					remaining[vertex]--;
+					break;
+				}
+			}
+		}
+
+		// The emitted vertices go to the front of the LRU, everything else shifts back.
+		unsigned int newCache[ForsythCacheSize + 3];
+		int newCacheCount = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			bool isDuplicate = false;
+			for (int i = 0; i < newCacheCount; i++)
+			{
+				isDuplicate |= newCache[i] == triangle[k];
+			}
+			if (!isDuplicate)
+			{
+				newCache[newCacheCount++] = triangle[k];
+			}
+		}
+
+		for (int i = 0; i < cacheCount; i++)
+		{
+			const unsigned int vertex = cache[i];
+			if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+			{
+				newCache[newCacheCount++] = vertex;
+			}
+		}
+
+		for (int i = ForsythCacheSize; i < newCacheCount; i++)
+		{
+			const unsigned int evicted = newCache[i];
+			cachePosition[evicted] = -1;
+			vertexScores[evicted] = ComputeVertexScore(-1, remaining[evicted]);
+		}
+
+		cacheCount = newCacheCount < ForsythCacheSize ? newCacheCount : ForsythCacheSize;
+		memcpy(cache, newCache, sizeof(unsigned int) * cacheCount);
+
+		for (int i = 0; i < cacheCount; i++)
+		{
+			cachePosition[cache[i]] = i;
+			vertexScores[cache[i]] = ComputeVertexScore(i, remaining[cache[i]]);
+		}
+
+		// Only triangles touching the cache can have changed, so that's where the next one comes from.
+		bestTriangle = -1;
+		bestScore = -1.0f;
+		for (int i = 0; i < cacheCount; i++)
+		{
+			const unsigned int vertex = cache[i];
+			const unsigned int* list = adjacency.data() + adjacencyOffsets[vertex];
+			for (unsigned int j = 0; j < remaining[vertex]; j++)
+			{
+				const unsigned int t = list[j];
+				const float score = vertexScores[someIndices[t * 3]] + vertexScores[someIndices[t * 3 + 1]] + vertexScores[someIndices[t * 3 + 2]];
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = static_cast<int>(t);
+				}
+			}
+		}
+
+		if (bestTriangle < 0)
+		{
+			// Nothing connected to the cache, continue with the next disconnected piece.
+			while (fallbackCursor < triangleCount && isEmitted[fallbackCursor])
+			{
+				fallbackCursor++;
+			}
+			if (fallbackCursor < triangleCount)
+			{
+				bestTriangle = static_cast<int>(fallbackCursor);
+			}
+		}
+	}
+
+	memcpy(someIndices, output.data(), sizeof(unsigned int) * output.size());
+}
+
+void MeshOptimizer::OptimizeOverdraw(unsigned int* someIndices, size_t anIndexCount, const uint8_t* somePositions, size_t aPositionStride, size_t aVertexCount, float aThreshold)
+{
+	const size_t triangleCount = anIndexCount / 3;
+	if (triangleCount < 2 || aVertexCount == 0)
+	{
+		return;
+	}
+
+	const VertexCacheStatistics before = AnalyzeVertexCache(someIndices, anIndexCount, aVertexCount);
+
+	// Split into clusters where the cache starts over (all three vertices miss),
+	// moving whole clusters around then costs almost nothing in cache efficiency.
+	std::vector<size_t> clusterStarts;
+	{
+		std::vector<unsigned int> insertedAt(aVertexCount, 0);
+		unsigned int time = DefaultCacheSize + 1;
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			int misses = 0;
+			for (int k = 0; k < 3; k++)
+			{
+				const unsigned int index = someIndices[t * 3 + k];
+				if (time - insertedAt[index] > DefaultCacheSize)
+				{
+					insertedAt[index] = time++;
+					misses++;
+				}
+			}
+
+			if (t == 0 || misses == 3)
+			{
+				clusterStarts.push_back(t);
+			}
+		}
+	}
+
+	if (clusterStarts.size() < 2)
+	{
+		return;
+	}
+
+	struct Cluster
+	{
+		size_t FirstTriangle;
+		size_t TriangleCount;
+		Float3 Centroid;
+		Float3 Normal;
+		float Area;
+		float SortKey;
+	};
+
+	std::vector<Cluster> clusters(clusterStarts.size());
+	Float3 meshCentroid = { 0, 0, 0 };
+	float meshArea = 0.0f;
+
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		Cluster& cluster = clusters[c];
+		cluster.FirstTriangle = clusterStarts[c];
+		cluster.TriangleCount = (c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : triangleCount) - cluster.FirstTriangle;
+		cluster.Centroid = { 0, 0, 0 };
+		cluster.Normal = { 0, 0, 0 };
+		cluster.Area = 0.0f;
+
+		for (size_t t = cluster.FirstTriangle; t < cluster.FirstTriangle + cluster.TriangleCount; t++)
+		{
+			const Float3 p0 = ReadPosition(somePositions, aPositionStride, someIndices[t * 3]);
+			const Float3 p1 = ReadPosition(somePositions, aPositionStride, someIndices[t * 3 + 1]);
+			const Float3 p2 = ReadPosition(somePositions, aPositionStride, someIndices[t * 3 + 2]);
+
+			const Float3 e0 = { p1.X - p0.X, p1.Y - p0.Y, p1.Z - p0.Z };
+			const Float3 e1 = { p2.X - p0.X, p2.Y - p0.Y, p2.Z - p0.Z };
+			const Float3 normal = { e0.Y * e1.Z - e0.Z * e1.Y, e0.Z * e1.X - e0.X * e1.Z, e0.X * e1.Y - e0.Y * e1.X };
+			const float area = std::sqrt(normal.X * normal.X + normal.Y * normal.Y + normal.Z * normal.Z);
+
+			cluster.Centroid.X += (p0.X + p1.X + p2.X) * area;
+			cluster.Centroid.Y += (p0.Y + p1.Y + p2.Y) * area;
+			cluster.Centroid.Z += (p0.Z + p1.Z + p2.Z) * area;
+			cluster.Normal.X += normal.X;
+			cluster.Normal.Y += normal.Y;
+			cluster.Normal.Z += normal.Z;
+			cluster.Area += area;
+		}
+
+		meshCentroid.X += cluster.Centroid.X;
+		meshCentroid.Y += cluster.Centroid.Y;
+		meshCentroid.Z += cluster.Centroid.Z;
+		meshArea += cluster.Area;
+
+		if (cluster.Area > 0.0f)
+		{
+			const float inverseArea = 1.0f / (cluster.Area * 3.0f);
+			cluster.Centroid = { cluster.Centroid.X * inverseArea, cluster.Centroid.Y * inverseArea, cluster.Centroid.Z * inverseArea };
+		}
+	}
+
+	if (meshArea <= 0.0f)
+	{
+		return;
+	}
+
+	const float inverseMeshArea = 1.0f / (meshArea * 3.0f);
+	meshCentroid = { meshCentroid.X * inverseMeshArea, meshCentroid.Y * inverseMeshArea, meshCentroid.Z * inverseMeshArea };
+
+	for (Cluster& cluster : clusters)
+	{
+		// Clusters facing away from the middle of the mesh are the ones most likely to occlude the rest.
+		const float normalLength = std::sqrt(cluster.Normal.X * cluster.Normal.X + cluster.Normal.Y * cluster.Normal.Y + cluster.Normal.Z * cluster.Normal.Z);
+		const Float3 toCluster = { cluster.Centroid.X - meshCentroid.X, cluster.Centroid.Y - meshCentroid.Y, cluster.Centroid.Z - meshCentroid.Z };
+		cluster.SortKey = normalLength > 0.0f ? (toCluster.X * cluster.Normal.X + toCluster.Y * cluster.Normal.Y + toCluster.Z * cluster.Normal.Z) / normalLength : 0.0f;
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& aLeft, const Cluster& aRight)
+	{
+		return aLeft.SortKey > aRight.SortKey;
+	});
+
+	std::vector<unsigned int> output;
+	output.reserve(triangleCount * 3);
+	for (const Cluster& cluster : clusters)
+	{
+		output.insert(output.end(), someIndices + cluster.FirstTriangle * 3, someIndices + (cluster.FirstTriangle + cluster.TriangleCount) * 3);
+	}
+
+	// Keep the original order if the reorder cost more cache efficiency than we allow.
+	const VertexCacheStatistics after = AnalyzeVertexCache(output.data(), output.size(), aVertexCount);
+	if (after.ACMR <= before.ACMR * aThreshold)
+	{
+		memcpy(someIndices, output.data(), sizeof(unsigned int) * output.size());
+	}
+}
+
+size_t MeshOptimizer::OptimizeVertexFetch(std::vector<uint8_t>& inOutVertexData, size_t aVertexStride, unsigned int* someIndices, size_t anIndexCount)
+{
+	const size_t vertexCount = aVertexStride > 0 ? inOutVertexData.size() / aVertexStride : 0;
+
+	std::vector<unsigned int> remap(vertexCount, InvalidIndex);
+	unsigned int nextVertex = 0;
+	for (size_t i = 0; i < anIndexCount; i++)
+	{
+		unsigned int& index = someIndices[i];
+		if (remap[index] == InvalidIndex)
+		{
+			remap[index] = nextVertex++;
+		}
+		index = remap[index];
+	}
+
+	std::vector<uint8_t> reordered(static_cast<size_t>(nextVertex) * aVertexStride);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		if (remap[v] != InvalidIndex)
+		{
+			memcpy(reordered.data() + static_cast<size_t>(remap[v]) * aVertexStride, inOutVertexData.data() + v * aVertexStride, aVertexStride);
+		}
+	}
+
+	inOutVertexData.swap(reordered);
+	return nextVertex;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Tga
+{
+
+/// <summary>
+/// Post-transform cache statistics for an index buffer.
+/// ACMR is cache misses per triangle (0.5 is ideal for a large regular grid, 3 is worst case).
+/// ATVR is cache misses per vertex (1 is ideal).
+/// </summary>
+struct VertexCacheStatistics
+{
+	float ACMR = 0.0f;
+	float ATVR = 0.0f;
+};
+
+/// <summary>
+/// CPU-only index and vertex reordering run when meshes are cooked.
+/// Everything works on raw index lists and strided vertex bytes so it can run on synthetic meshes.
+/// </summary>
+namespace MeshOptimizer
+{
+	// Matches the FIFO post-transform cache size we assume when measuring.
+	constexpr unsigned int DefaultCacheSize = 16;
+
+	/**
+	 * Simulates a FIFO post-transform cache over the triangle list.
+	 */
+	VertexCacheStatistics AnalyzeVertexCache(const unsigned int* someIndices, size_t anIndexCount, size_t aVertexCount, unsigned int aCacheSize = DefaultCacheSize);
+
+	/**
+	 * Reorders triangles for post-transform cache reuse using Tom Forsyth's linear-speed algorithm.
+	 */
+	void OptimizeVertexCache(unsigned int* someIndices, size_t anIndexCount, size_t aVertexCount);
+
+	/**
+	 * Reorders triangle clusters so outward facing clusters come first, which reduces overdraw from most views.
+	 * Clusters are split where the cache restarts so vertex cache efficiency is kept within aThreshold of the input.
+	 * @param somePositions Vertex positions, read as three floats at the start of each strided vertex.
+	 * @param aThreshold How much worse the ACMR is allowed to get, 1.05 allows 5%.
+	 */
+	void OptimizeOverdraw(unsigned int* someIndices, size_t anIndexCount, const uint8_t* somePositions, size_t aPositionStride, size_t aVertexCount, float aThreshold = 1.05f);
+
+	/**
+	 * Reorders vertices in the order they are first referenced by the index buffer and drops unreferenced ones.
+	 * @returns The new number of vertices.
+	 */
+	size_t OptimizeVertexFetch(std::vector<uint8_t>& inOutVertexData, size_t aVertexStride, unsigned int* someIndices, size_t anIndexCount);
+}
+
+} // namespace Tga
@@ -0,0 +1,563 @@
+#include "stdafx.h"
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+using namespace Tga;
+
+namespace
+{
+	// Border planes are weighted well above the surface so silhouettes of open meshes hold their shape.
+	constexpr double BorderWeight = 10.0;
+	// Scales the squared edge length by how much the skin weights differ, 1 means a full bone swap costs as much as
+	// moving the vertex the whole edge length off the surface.
+	constexpr double SkinWeight = 1.0;
+	// Each pass collapses a set of independent edges, this is only a safety net for meshes that refuse to converge.
+	constexpr int MaxPasses = 100;
+	// Seams where more wedges than this meet are simply left alone.
+	constexpr int MaxWedges = 16;
+
+	enum class VertexKind : uint8_t
+	{
+		Interior,
+		Border,
+		Locked,
+	};
+
+	struct Vec3
+	{
+		double X, Y, Z;
+	};
+
+	Vec3 Subtract(const Vec3& aLeft, const Vec3& aRight)
+	{
+		return { aLeft.X - aRight.X, aLeft.Y - aRight.Y, aLeft.Z - aRight.Z };
+	}
+
+	Vec3 Cross(const Vec3& aLeft, const Vec3& aRight)
+	{
+		return { aLeft.Y * aRight.Z - aLeft.Z * aRight.Y, aLeft.Z * aRight.X - aLeft.X * aRight.Z, aLeft.X * aRight.Y - aLeft.Y * aRight.X };
+	}
+
+	double Dot(const Vec3& aLeft, const Vec3& aRight)
+	{
+		return aLeft.X * aRight.X + aLeft.Y * aRight.Y + aLeft.Z * aRight.Z;
+	}
+
+	/// Symmetric 4x4 error quadric, Q(p) = p^T A p + 2 b.p + c.
+	/// The total weight is kept so the error can be read back as a squared distance.
+	struct Quadric
+	{
+		double A00 = 0, A11 = 0, A22 = 0, A01 = 0, A02 = 0, A12 = 0;
+		double B0 = 0, B1 = 0, B2 = 0;
+		double C = 0;
+		double Weight = 0;
+
+		void AddPlane(const Vec3& aNormal, double aDistance, double aWeight)
+		{
+			A00 += aWeight * aNormal.X * aNormal.X;
+			A11 += aWeight * aNormal.Y * aNormal.Y;
+			A22 += aWeight * aNormal.Z * aNormal.Z;
+			A01 += aWeight * aNormal.X * aNormal.Y;
+			A02 += aWeight * aNormal.X * aNormal.Z;
+			A12 += aWeight * aNormal.Y * aNormal.Z;
+			B0 += aWeight * aNormal.X * aDistance;
+			B1 += aWeight * aNormal.Y * aDistance;
+			B2 += aWeight * aNormal.Z * aDistance;
+			C += aWeight * aDistance * aDistance;
+			Weight += aWeight;
+		}
+
+		void Add(const Quadric& anOther)
+		{
+			A00 += anOther.A00; A11 += anOther.A11; A22 += anOther.A22;
+			A01 += anOther.A01; A02 += anOther.A02; A12 += anOther.A12;
+			B0 += anOther.B0; B1 += anOther.B1; B2 += anOther.B2;
+			C += anOther.C;
+			Weight += anOther.Weight;
+		}
+
+		double Evaluate(const Vec3& aPoint) const
+		{
+			if (Weight <= 0.0)
+			{
+				return 0.0;
+			}
+
+			const double x = aPoint.X, y = aPoint.Y, z = aPoint.Z;
+			const double result = A00 * x * x + A11 * y * y + A22 * z * z
+				+ 2.0 * (A01 * x * y + A02 * x * z + A12 * y * z)
+				+ 2.0 * (B0 * x + B1 * y + B2 * z)
+				+ C;
+			// Rounding can push it slightly below zero for points on the surface.
+			return result > 0.0 ? result / Weight : 0.0;
+		}
+	};
+
+	uint64_t EdgeKey(unsigned int aFirst, unsigned int aSecond)
+	{
+		if (aFirst > aSecond)
+		{
+			std::swap(aFirst, aSecond);
+		}
+		return (static_cast<uint64_t>(aFirst) << 32) | aSecond;
+	}
+
+	/// Vertex to triangle lookup for the current index list.
+	struct TriangleAdjacency
+	{
+		std::vector<unsigned int> Offsets;
+		std::vector<unsigned int> Triangles;
+
+		void Build(const std::vector<unsigned int>& someIndices, size_t aVertexCount)
+		{
+			Offsets.assign(aVertexCount + 1, 0);
+			for (unsigned int index : someIndices)
+			{
+				Offsets[index + 1]++;
+			}
+			for (size_t v = 0; v < aVertexCount; v++)
+			{
+				Offsets[v + 1] += Offsets[v];
+			}
+
+			Triangles.resize(someIndices.size());
+			std::vector<unsigned int> writeCursor(Offsets.begin(), Offsets.end() - 1);
+			for (size_t i = 0; i < someIndices.size(); i++)
+			{
+				Triangles[writeCursor[someIndices[i]]++] = static_cast<unsigned int>(i / 3);
+			}
+		}
+
+		const unsigned int* Begin(unsigned int aVertex) const { return Triangles.data() + Offsets[aVertex]; }
+		const unsigned int* End(unsigned int aVertex) const { return Triangles.data() + Offsets[aVertex + 1]; }
+	};
+
+	double SkinDifference(const uint8_t* aFirst, const uint8_t* aSecond, const SimplifierVertexFormat& aFormat)
+	{
+		float firstBones[4], firstWeights[4], secondBones[4], secondWeights[4];
+		memcpy(firstBones, aFirst + aFormat.BoneOffset, sizeof(firstBones));
+		memcpy(firstWeights, aFirst + aFormat.WeightOffset, sizeof(firstWeights));
+		memcpy(secondBones, aSecond + aFormat.BoneOffset, sizeof(secondBones));
+		memcpy(secondWeights, aSecond + aFormat.WeightOffset, sizeof(secondWeights));
+
+		double difference = 0.0;
+		for (int i = 0; i < 4; i++)
+		{
+			if (firstWeights[i] == 0.0f)
+			{
+				continue;
+			}
+
+			float matchingWeight = 0.0f;
+			for (int j = 0; j < 4; j++)
+			{
+				if (secondBones[j] == firstBones[i])
+				{
+					matchingWeight += secondWeights[j];
+				}
+			}
+			difference += std::abs(firstWeights[i] - matchingWeight);
+		}
+
+		for (int j = 0; j < 4; j++)
+		{
+			if (secondWeights[j] == 0.0f)
+			{
+				continue;
+			}
+
+			bool isShared = false;
+			for (int i = 0; i < 4; i++)
+			{
+				isShared |= firstWeights[i] != 0.0f && firstBones[i] == secondBones[j];
+			}
+			if (!isShared)
+			{
+				difference += secondWeights[j];
+			}
+		}
+
+		return difference;
+	}
+}
+
+float MeshSimplifier::Simplify(const unsigned int* someIndices, size_t anIndexCount, const uint8_t* someVertices, size_t aVertexStride, size_t aVertexCount,
+	const SimplifierVertexFormat& aFormat, size_t aTargetIndexCount, float aTargetError, std::vector<unsigned int>& outIndices)
+{
+	outIndices.assign(someIndices, someIndices + (anIndexCount - anIndexCount % 3));
+	if (outIndices.empty() || aVertexCount == 0 || outIndices.size() <= aTargetIndexCount)
+	{
+		return 0.0f;
+	}
+
+	std::vector<float> rawPositions(aVertexCount * 3);
+	std::vector<Vec3> positions(aVertexCount);
+	Vec3 minExtents = { HUGE_VAL, HUGE_VAL, HUGE_VAL };
+	Vec3 maxExtents = { -HUGE_VAL, -HUGE_VAL, -HUGE_VAL };
+	for (size_t v = 0; v < aVertexCount; v++)
+	{
+		float* position = &rawPositions[v * 3];
+		memcpy(position, someVertices + v * aVertexStride + aFormat.PositionOffset, sizeof(float) * 3);
+		positions[v] = { position[0], position[1], position[2] };
+
+		minExtents = { std::min(minExtents.X, positions[v].X), std::min(minExtents.Y, positions[v].Y), std::min(minExtents.Z, positions[v].Z) };
+		maxExtents = { std::max(maxExtents.X, positions[v].X), std::max(maxExtents.Y, positions[v].Y), std::max(maxExtents.Z, positions[v].Z) };
+	}
+
+	const double scale = std::max(maxExtents.X - minExtents.X, std::max(maxExtents.Y - minExtents.Y, maxExtents.Z - minExtents.Z));
+	if (scale <= 0.0)
+	{
+		return 0.0f;
+	}
+
+	// Vertices split at the same position (UV or normal seams) are grouped, the copies within a group are
+	// called wedges and linked in a circular list. Quadrics and topology work on groups, collapses on wedges.
+	std::vector<unsigned int> group(aVertexCount);
+	std::vector<unsigned int> wedgeNext(aVertexCount);
+	{
+		std::vector<unsigned int> order(aVertexCount);
+		std::iota(order.begin(), order.end(), 0u);
+		std::sort(order.begin(), order.end(), [&rawPositions](unsigned int aLeft, unsigned int aRight)
+		{
+			return std::lexicographical_compare(&rawPositions[aLeft * 3], &rawPositions[aLeft * 3 + 3], &rawPositions[aRight * 3], &rawPositions[aRight * 3 + 3]);
+		});
+
+		size_t runStart = 0;
+		for (size_t i = 1; i <= aVertexCount; i++)
+		{
+			if (i < aVertexCount && memcmp(&rawPositions[order[i] * 3], &rawPositions[order[runStart] * 3], sizeof(float) * 3) == 0)
+			{
+				continue;
+			}
+
+			for (size_t j = runStart; j < i; j++)
+			{
+				group[order[j]] = order[runStart];
+				wedgeNext[order[j]] = order[j + 1 < i ? j + 1 : runStart];
+			}
+			runStart = i;
+		}
+	}
+
+	const bool hasSkin = aFormat.BoneOffset >= 0 && aFormat.WeightOffset >= 0;
+
+	// Quadrics are stored on the group representative.
+	std::vector<Quadric> quadrics(aVertexCount);
+	std::unordered_map<uint64_t, unsigned int> edgeCounts;
+	edgeCounts.reserve(outIndices.size());
+
+	for (size_t i = 0; i < outIndices.size(); i += 3)
+	{
+		const unsigned int triangle[3] = { outIndices[i], outIndices[i + 1], outIndices[i + 2] };
+		const Vec3 normal = Cross(Subtract(positions[triangle[1]], positions[triangle[0]]), Subtract(positions[triangle[2]], positions[triangle[0]]));
+		const double length = std::sqrt(Dot(normal, normal));
+		if (length > 0.0)
+		{
+			const Vec3 unitNormal = { normal.X / length, normal.Y / length, normal.Z / length };
+			const double distance = -Dot(unitNormal, positions[triangle[0]]);
+			for (int k = 0; k < 3; k++)
+			{
+				quadrics[group[triangle[k]]].AddPlane(unitNormal, distance, length * 0.5);
+			}
+		}
+
+		for (int k = 0; k < 3; k++)
+		{
+			const unsigned int first = group[triangle[k]];
+			const unsigned int second = group[triangle[(k + 1) % 3]];
+			if (first != second)
+			{
+				edgeCounts[EdgeKey(first, second)]++;
+			}
+		}
+	}
+
+	// Edges with a single triangle are open borders. Vertices with exactly two border edges can slide along the
+	// border, anything more complicated than that stays where it is.
+	std::vector<uint8_t> borderEdgeCount(aVertexCount, 0);
+	for (size_t i = 0; i < outIndices.size(); i += 3)
+	{
+		const unsigned int triangle[3] = { outIndices[i], outIndices[i + 1], outIndices[i + 2] };
+		const Vec3 normal = Cross(Subtract(positions[triangle[1]], positions[triangle[0]]), Subtract(positions[triangle[2]], positions[triangle[0]]));
+
+		for (int k = 0; k < 3; k++)
+		{
+			const unsigned int first = group[triangle[k]];
+			const unsigned int second = group[triangle[(k + 1) % 3]];
+			if (first == second || edgeCounts[EdgeKey(first, second)] != 1)
+			{
+				continue;
+			}
+
+			borderEdgeCount[first] = static_cast<uint8_t>(std::min(borderEdgeCount[first] + 1, 255));
+			borderEdgeCount[second] = static_cast<uint8_t>(std::min(borderEdgeCount[second] + 1, 255));
+
+			const Vec3 edge = Subtract(positions[second], positions[first]);
+			const double edgeLengthSquared = Dot(edge, edge);
+			const Vec3 borderNormal = Cross(edge, normal);
+			const double borderNormalLength = std::sqrt(Dot(borderNormal, borderNormal));
+			if (borderNormalLength > 0.0)
+			{
+				const Vec3 unitNormal = { borderNormal.X / borderNormalLength, borderNormal.Y / borderNormalLength, borderNormal.Z / borderNormalLength };
+				const double distance = -Dot(unitNormal, positions[first]);
+				quadrics[first].AddPlane(unitNormal, distance, edgeLengthSquared * BorderWeight);
+				quadrics[second].AddPlane(unitNormal, distance, edgeLengthSquared * BorderWeight);
+			}
+		}
+	}
+
+	std::vector<VertexKind> kinds(aVertexCount, VertexKind::Interior);
+	for (size_t v = 0; v < aVertexCount; v++)
+	{
+		if (group[v] != v)
+		{
+			continue;
+		}
+
+		unsigned int wedgeCount = 1;
+		for (unsigned int w = wedgeNext[v]; w != v; w = wedgeNext[w])
+		{
+			wedgeCount++;
+		}
+
+		if (wedgeCount > MaxWedges || (borderEdgeCount[v] != 0 && borderEdgeCount[v] != 2))
+		{
+			kinds[v] = VertexKind::Locked;
+		}
+		else if (borderEdgeCount[v] == 2)
+		{
+			kinds[v] = VertexKind::Border;
+		}
+	}
+
+	struct Collapse
+	{
+		unsigned int From;
+		unsigned int To;
+		double Cost;
+	};
+
+	const double errorLimit = static_cast<double>(aTargetError) * static_cast<double>(aTargetError) * scale * scale;
+	double maxError = 0.0;
+
+	TriangleAdjacency adjacency;
+	std::vector<Collapse> collapses;
+	std::vector<unsigned int> remap(aVertexCount);
+	std::vector<bool> isTouched(aVertexCount);
+
+	for (int pass = 0; pass < MaxPasses && outIndices.size() > aTargetIndexCount; pass++)
+	{
+		adjacency.Build(outIndices, aVertexCount);
+
+		edgeCounts.clear();
+		for (size_t i = 0; i < outIndices.size(); i += 3)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				edgeCounts[EdgeKey(group[outIndices[i + k]], group[outIndices[i + (k + 1) % 3]])]++;
+			}
+		}
+
+		collapses.clear();
+		for (size_t i = 0; i < outIndices.size(); i += 3)
+		{
+			for (int k = 0; k < 6; k++)
+			{
+				const unsigned int from = outIndices[i + k % 3];
+				const unsigned int to = outIndices[i + (k < 3 ? (k + 1) % 3 : (k + 2) % 3)];
+				const unsigned int fromGroup = group[from];
+				const unsigned int toGroup = group[to];
+
+				if (fromGroup == toGroup || kinds[fromGroup] == VertexKind::Locked)
+				{
+					continue;
+				}
+
+				if (kinds[fromGroup] == VertexKind::Border && edgeCounts[EdgeKey(fromGroup, toGroup)] != 1)
+				{
+					continue;
+				}
+
+				double cost = quadrics[fromGroup].Evaluate(positions[to]);
+				if (hasSkin)
+				{
+					const Vec3 edge = Subtract(positions[to], positions[from]);
+					cost += SkinWeight * SkinDifference(someVertices + from * aVertexStride, someVertices + to * aVertexStride, aFormat) * Dot(edge, edge);
+				}
+
+				collapses.push_back({ from, to, cost });
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& aLeft, const Collapse& aRight)
+		{
+			return aLeft.Cost < aRight.Cost;
+		});
+
+		std::iota(remap.begin(), remap.end(), 0u);
+		std::fill(isTouched.begin(), isTouched.end(), false);
+
+		size_t triangleCount = outIndices.size() / 3;
+		int collapseCount = 0;
+
+		for (const Collapse& collapse : collapses)
+		{
+			if (collapse.Cost > errorLimit || triangleCount * 3 <= aTargetIndexCount)
+			{
+				break;
+			}
+
+			const unsigned int fromGroup = group[collapse.From];
+			const unsigned int toGroup = group[collapse.To];
+			if (isTouched[fromGroup] || isTouched[toGroup])
+			{
+				continue;
+			}
+
+			// Every wedge we move needs a wedge on the other end that it shares a triangle with, otherwise the
+			// collapse would go across a seam and tear it open.
+			unsigned int wedgePairs[MaxWedges][2];
+			int wedgePairCount = 0;
+			bool isValid = true;
+
+			unsigned int from = collapse.From;
+			do
+			{
+				unsigned int match = ~0u;
+				for (const unsigned int* t = adjacency.Begin(from); t != adjacency.End(from) && match == ~0u; t++)
+				{
+					for (int k = 0; k < 3; k++)
+					{
+						if (group[outIndices[*t * 3 + k]] == toGroup)
+						{
+							match = outIndices[*t * 3 + k];
+							break;
+						}
+					}
+				}
+
+				const bool isUsed = adjacency.Begin(from) != adjacency.End(from);
+				if (match == ~0u && isUsed)
+				{
+					isValid = false;
+					break;
+				}
+
+				if (isUsed)
+				{
+					wedgePairs[wedgePairCount][0] = from;
+					wedgePairs[wedgePairCount][1] = match;
+					wedgePairCount++;
+				}
+
+				from = wedgeNext[from];
+			} while (from != collapse.From);
+
+			if (!isValid || wedgePairCount == 0)
+			{
+				continue;
+			}
+
+			// Triangles around the moved vertex must not flip or touch anything already changed this pass.
+			size_t removedTriangles = 0;
+			for (int p = 0; p < wedgePairCount && isValid; p++)
+			{
+				const unsigned int wedge = wedgePairs[p][0];
+				for (const unsigned int* t = adjacency.Begin(wedge); t != adjacency.End(wedge); t++)
+				{
+					const unsigned int* triangle = &outIndices[*t * 3];
+
+					bool isRemoved = false;
+					for (int k = 0; k < 3; k++)
+					{
+						isRemoved |= group[triangle[k]] == toGroup;
+						if (triangle[k] != wedge && isTouched[group[triangle[k]]])
+						{
+							isValid = false;
+						}
+					}
+
+					if (isRemoved)
+					{
+						removedTriangles++;
+						continue;
+					}
+
+					Vec3 corners[3];
+					for (int k = 0; k < 3; k++)
+					{
+						corners[k] = positions[triangle[k]];
+					}
+					const Vec3 normalBefore = Cross(Subtract(corners[1], corners[0]), Subtract(corners[2], corners[0]));
+					for (int k = 0; k < 3; k++)
+					{
+						if (triangle[k] == wedge)
+						{
+							corners[k] = positions[collapse.To];
+						}
+					}
+					const Vec3 normalAfter = Cross(Subtract(corners[1], corners[0]), Subtract(corners[2], corners[0]));
+
+					if (Dot(normalBefore, normalAfter) <= 0.0)
+					{
+						isValid = false;
+					}
+				}
+			}
+
+			if (!isValid)
+			{
+				continue;
+			}
+
+			for (int p = 0; p < wedgePairCount; p++)
+			{
+				remap[wedgePairs[p][0]] = wedgePairs[p][1];
+
+				for (const unsigned int* t = adjacency.Begin(wedgePairs[p][0]); t != adjacency.End(wedgePairs[p][0]); t++)
+				{
+					for (int k = 0; k < 3; k++)
+					{
+						isTouched[group[outIndices[*t * 3 + k]]] = true;
+					}
+				}
+			}
+
+			quadrics[toGroup].Add(quadrics[fromGroup]);
+			isTouched[fromGroup] = true;
+			isTouched[toGroup] = true;
+
+			triangleCount -= removedTriangles;
+			maxError = std::max(maxError, collapse.Cost);
+			collapseCount++;
+		}
+
+		if (collapseCount == 0)
+		{
+			break;
+		}
+
+		size_t writeIndex = 0;
+		for (size_t i = 0; i < outIndices.size(); i += 3)
+		{
+			const unsigned int a = remap[outIndices[i]];
+			const unsigned int b = remap[outIndices[i + 1]];
+			const unsigned int c = remap[outIndices[i + 2]];
+
+			if (group[a] != group[b] && group[b] != group[c] && group[a] != group[c])
+			{
+				outIndices[writeIndex++] = a;
+				outIndices[writeIndex++] = b;
+				outIndices[writeIndex++] = c;
+			}
+		}
+		outIndices.resize(writeIndex);
+	}
+
+	return static_cast<float>(std::sqrt(maxError) / scale);
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Tga
+{
+
+/// <summary>
+/// Where the simplifier finds the data it cares about inside each strided vertex.
+/// Positions are three floats, bones and weights four floats each. Leave the skin offsets at -1 for static meshes.
+/// </summary>
+struct SimplifierVertexFormat
+{
+	size_t PositionOffset = 0;
+	int BoneOffset = -1;
+	int WeightOffset = -1;
+};
+
+/// <summary>
+/// Quadric error metric simplification used to build LOD chains when meshes are cooked.
+/// Collapses edges onto existing vertices, so simplified index lists keep using the original vertex buffer.
+/// UV and normal seams (vertices split at the same position) only collapse along the seam, open borders only
+/// collapse along the border, and collapses between vertices with different skin weights are penalized.
+/// </summary>
+namespace MeshSimplifier
+{
+	/**
+	 * Simplifies a triangle list towards the target index count.
+	 * @param someVertices Strided vertex data, described by aFormat.
+	 * @param aTargetIndexCount Stop when the index count reaches this.
+	 * @param aTargetError Stop before any collapse with a larger error, relative to the mesh extents.
+	 * @param outIndices Receives the simplified triangle list.
+	 * @returns The largest error introduced, relative to the mesh extents.
+	 */
+	float Simplify(const unsigned int* someIndices, size_t anIndexCount, const uint8_t* someVertices, size_t aVertexStride, size_t aVertexCount,
+		const SimplifierVertexFormat& aFormat, size_t aTargetIndexCount, float aTargetError, std::vector<unsigned int>& outIndices);
+}
+
+} // namespace Tga
@@ -1,12 +1,18 @@
 #include "stdafx.h"
 #include <tge/model/Model.h>
 
+#include <tge/engine.h>
+#include <tge/graphics/Camera.h>
+#include <tge/graphics/GraphicsEngine.h>
+#include <tge/graphics/GraphicsStateStack.h>
+
 using namespace Tga;
 
 void Model::Init(MeshData& aMeshData, const std::wstring& aPath)
 {
 	myMeshData.push_back(aMeshData);
 	myPath = aPath;
+	CalculateBounds();
 }
 
 void Model::Init(std::vector<MeshData>& someMeshData, const std::wstring& aPath)
@@ -15,4 +21,111 @@ void Model::Init(std::vector<MeshData>& someMeshData, const std::wstring& aPath)
 
 	myMeshData = someMeshData;
 	myPath = aPath;
+	CalculateBounds();
+}
+
+void Model::CalculateBounds()
+{
+	if (myMeshData.empty())
+	{
+		myBounds = {};
+		return;
+	}
+
+	Vector3f boxMin = myMeshData[0].Bounds.Center - myMeshData[0].Bounds.BoxExtents;
+	Vector3f boxMax = myMeshData[0].Bounds.Center + myMeshData[0].Bounds.BoxExtents;
+	for (const MeshData& meshData : myMeshData)
+	{
+		const BoxSphereBounds& bounds = meshData.Bounds;
+		boxMin.X = FMath::Min(boxMin.X, bounds.Center.X - bounds.BoxExtents.X);
+		boxMin.Y = FMath::Min(boxMin.Y, bounds.Center.Y - bounds.BoxExtents.Y);
+		boxMin.Z = FMath::Min(boxMin.Z, bounds.Center.Z - bounds.BoxExtents.Z);
+		boxMax.X = FMath::Max(boxMax.X, bounds.Center.X + bounds.BoxExtents.X);
+		boxMax.Y = FMath::Max(boxMax.Y, bounds.Center.Y + bounds.BoxExtents.Y);
+		boxMax.Z = FMath::Max(boxMax.Z, bounds.Center.Z + bounds.BoxExtents.Z);
+	}
+
+	myBounds.Center = (boxMin + boxMax) * 0.5f;
+	myBounds.BoxExtents = (boxMax - boxMin) * 0.5f;
+
+	// The sphere around the box can be much larger than the mesh spheres, use whichever is tighter.
+	float radius = 0.0f;
+	for (const MeshData& meshData : myMeshData)
+	{
+		radius = FMath::Max(radius, (meshData.Bounds.Center - myBounds.Center).Length() + meshData.Bounds.Radius);
+	}
+	myBounds.Radius = FMath::Min(radius, myBounds.BoxExtents.Length());
+}
+
+MeshLOD Model::MeshData::GetLOD(int aLOD) const
+{
+	if (LODs.empty())
+	{
+		return { 0, NumberOfIndices, 0.0f };
+	}
+
+	return LODs[aLOD < 0 ? 0 : (aLOD < static_cast<int>(LODs.size()) ? aLOD : static_cast<int>(LODs.size()) - 1)];
+}
+
+int Model::MeshData::SelectLOD(float aScreenSize, float aMaxPixelError) const
+{
+	for (int lod = static_cast<int>(LODs.size()) - 1; lod > 0; lod--)
+	{
+		if (LODs[lod].Error * aScreenSize <= aMaxPixelError)
+		{
+			return lod;
+		}
+	}
+
+	return 0;
+}
+
+LODView LODView::Create(const Camera& aCamera, float aRenderHeight)
+{
+	LODView view;
+	view.Projection = aCamera.GetProjection();
+	view.CameraPosition = aCamera.GetTransform().GetPosition();
+	view.RenderHeight = aRenderHeight;
+	return view;
+}
+
+LODView LODView::GetActive()
+{
+	const Engine& engine = *Engine::GetInstance();
+	return Create(engine.GetGraphicsEngine().GetGraphicsStateStack().GetCamera(), static_cast<float>(engine.GetRenderSize().y));
+}
+
+float Model::CalculateScreenSize(const BoxSphereBounds& someBounds, const Transform& aTransform, const LODView& aView)
+{
+	const Vector3f scale = aTransform.GetScale();
+	const float radius = someBounds.Radius * FMath::Max(FMath::Abs(scale.X), FMath::Max(FMath::Abs(scale.Y), FMath::Abs(scale.Z)));
+
+	const Matrix4x4f& projection = aView.Projection;
+	if (projection(4, 4) != 0.0f)
+	{
+		// Orthographic, the size doesn't depend on the distance.
+		return radius * projection(2, 2) * aView.RenderHeight;
+	}
+
+	const Vector4f center = Vector4f(someBounds.Center, 1.0f) * aTransform.GetMatrix();
+	const Vector3f toCenter = Vector3f(center.X, center.Y, center.Z) - aView.CameraPosition;
+	const float distance = toCenter.Length();
+	if (distance <= radius)
+	{
+		// The camera is inside the bounds.
+		return FLT_MAX;
+	}
+
+	return radius * projection(2, 2) * aView.RenderHeight / distance;
+}
+
+int Model::SelectLOD(unsigned int aMeshIndex, const Transform& aTransform, float aMaxPixelError, const LODView& aView) const
+{
+	const MeshData& meshData = myMeshData[aMeshIndex];
+	if (meshData.LODs.size() < 2)
+	{
+		return 0;
+	}
+
+	return meshData.SelectLOD(CalculateScreenSize(meshData.Bounds, aTransform, aView), aMaxPixelError);
 }
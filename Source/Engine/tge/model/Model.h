@@ -12,6 +12,7 @@ struct ID3D11Buffer;
 namespace Tga
 {
 
+class Camera;
 class TextureResource;
 
 struct BoxSphereBounds
@@ -24,6 +25,33 @@ struct BoxSphereBounds
 	Vector3f Center;
 };
 
+struct MeshLOD
+{
+	// Where this LOD starts in the index buffer of the mesh.
+	uint32_t StartIndex;
+	uint32_t NumberOfIndices;
+	// Simplification error relative to the mesh extents, 0 for the full detail mesh.
+	float Error;
+};
+
+/// <summary>
+/// What LOD selection needs from the active camera. Captured on the main thread before meshes are recorded on worker
+/// threads, which must not read the graphics state stack.
+/// </summary>
+struct LODView
+{
+	Matrix4x4f Projection;
+	Vector3f CameraPosition;
+	float RenderHeight = 0.0f;
+
+	static LODView Create(const Camera& aCamera, float aRenderHeight);
+
+	/**
+	 * The camera on the graphics state stack and the engine render height. Main thread only.
+	 */
+	static LODView GetActive();
+};
+
 class Model
 {
 public:
@@ -37,10 +65,23 @@ public:
 		uint32_t NumberOfVertices;
 		uint32_t NumberOfIndices;
 		uint32_t Stride;
+		// The VertexAttribute mask of the compact vertex layout, which picks the input layout to draw with.
+		uint32_t VertexAttributes;
 		uint32_t Offset;
 		ID3D11Buffer* VertexBuffer;
 		ID3D11Buffer* IndexBuffer;
 		BoxSphereBounds Bounds;
+		// LOD 0 is the full mesh, the rest share its vertex and index buffers.
+		// Meshes created without LODs leave this empty and always draw NumberOfIndices from the start.
+		std::vector<MeshLOD> LODs;
+
+		MeshLOD GetLOD(int aLOD) const;
+
+		/**
+		 * Picks the coarsest LOD whose error is at most aMaxPixelError pixels at the given projected size.
+		 * @param aScreenSize The projected diameter of the mesh bounds in pixels.
+		 */
+		int SelectLOD(float aScreenSize, float aMaxPixelError) const;
 	};
 		
 	void Init(MeshData& aMeshData, const std::wstring& aPath);
@@ -55,11 +96,30 @@ public:
 
 	const std::wstring& GetPath() { return myPath; }
 	const Skeleton* GetSkeleton() const { return &mySkeleton; }
+	void SetSkeleton(const Skeleton& aSkeleton) { mySkeleton = aSkeleton; }
+
+	/**
+	 * Local-space bounds enclosing every mesh, used for culling.
+	 */
+	const BoxSphereBounds& GetBounds() const { return myBounds; }
+
+	/**
+	 * Projects the bounds of a mesh through the camera in aView.
+	 * @returns The projected diameter of the bounds in pixels.
+	 */
+	static float CalculateScreenSize(const BoxSphereBounds& someBounds, const Transform& aTransform, const LODView& aView);
+
+	/**
+	 * Picks a LOD for a mesh from its projected size with the camera in aView.
+	 */
+	int SelectLOD(unsigned int aMeshIndex, const Transform& aTransform, float aMaxPixelError, const LODView& aView) const;
 
 private:
+	void CalculateBounds();
 
 	Skeleton mySkeleton;
 	std::vector<MeshData> myMeshData;
+	BoxSphereBounds myBounds = {};
 	std::wstring myPath;
 };
 
@@ -0,0 +1,665 @@
+#include "stdafx.h"
+#include "ModelCooker.h"
+
+#include <cstddef>
+#include <cstring>
+#include <unordered_map>
+
+#include <tge/graphics/VertexLayout.h>
+#include <tge/math/FMath.h>
+#include <tge/math/Matrix4x4.h>
+#include <tge/model/MeshOptimizer.h>
+#include <tge/model/MeshSimplifier.h>
+
+#include "xxh64_en.hpp"
+
+using namespace Tga;
+
+namespace
+{
+	// Bump this whenever the layout below or Tga::Vertex changes, old caches will then be re-cooked.
+	constexpr uint32_t COOKED_MESH_MAGIC = 0x4D414754; // 'TGAM'
+	constexpr uint32_t COOKED_MESH_VERSION = 6;
+	constexpr size_t COOKED_BLOB_ALIGNMENT = 16;
+	constexpr size_t SOURCE_HASH_BLOCK_SIZE = 4096;
+
+	struct FileHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		int64_t SourceTimestamp;
+		uint64_t SourceHash;
+		uint32_t VertexStride;
+		uint32_t ElementCount;
+		uint32_t JointCount;
+		uint32_t StringTableSize;
+		uint64_t StringTableOffset;
+		uint64_t TotalSize;
+	};
+
+	struct ElementEntry
+	{
+		uint64_t VertexOffset;
+		uint64_t IndexOffset;
+		uint32_t VertexCount;
+		uint32_t IndexCount;
+		uint32_t NameOffset;
+		uint32_t MaterialNameOffset;
+		float Radius;
+		float BoxExtents[3];
+		float Center[3];
+		uint32_t VertexAttributes;
+		uint32_t VertexStride;
+		uint32_t LODCount;
+		uint64_t LODOffset;
+	};
+
+	struct LODEntry
+	{
+		uint32_t StartIndex;
+		uint32_t IndexCount;
+		float Error;
+		uint32_t Padding;
+	};
+
+	struct JointEntry
+	{
+		float BindPoseInverse[16];
+		int32_t Parent;
+		uint32_t NameOffset;
+		uint64_t ChildrenOffset;
+		uint32_t ChildCount;
+		uint32_t Padding;
+	};
+
+	size_t AlignUp(size_t aValue, size_t anAlignment)
+	{
+		return (aValue + anAlignment - 1) & ~(anAlignment - 1);
+	}
+
+	size_t AppendAligned(std::vector<uint8_t>& someData, const void* aSource, size_t aSize)
+	{
+		const size_t offset = AlignUp(someData.size(), COOKED_BLOB_ALIGNMENT);
+		someData.resize(offset + aSize);
+		if (aSize > 0)
+		{
+			memcpy(someData.data() + offset, aSource, aSize);
+		}
+		return offset;
+	}
+
+	uint32_t AddString(std::vector<char>& someStringTable, const std::string& aString)
+	{
+		const uint32_t offset = static_cast<uint32_t>(someStringTable.size());
+		someStringTable.insert(someStringTable.end(), aString.begin(), aString.end());
+		someStringTable.push_back('\0');
+		return offset;
+	}
+
+	bool IsRangeValid(uint64_t anOffset, uint64_t aSize, size_t aTotalSize)
+	{
+		return anOffset <= aTotalSize && aSize <= aTotalSize - anOffset;
+	}
+
+	bool IsAligned(uint64_t anOffset, size_t anAlignment)
+	{
+		return anOffset % anAlignment == 0;
+	}
+
+	// Quantizing collapses vertices that only differed by float noise, so merge those again
+	// and remap the indices. Compares the encoded bytes, which is all the GPU will ever see.
+	void WeldVertices(const VertexLayout& aLayout, std::vector<uint8_t>& inOutVertexData, std::vector<unsigned int>& inOutIndices)
+	{
+		const size_t stride = aLayout.Stride;
+		const size_t vertexCount = stride > 0 ? inOutVertexData.size() / stride : 0;
+
+		std::vector<unsigned int> remap(vertexCount);
+		std::unordered_map<uint64_t, std::vector<unsigned int>> buckets;
+		buckets.reserve(vertexCount);
+
+		unsigned int uniqueCount = 0;
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			const uint8_t* vertex = inOutVertexData.data() + v * stride;
+			const uint64_t hash = xxh64::hash(reinterpret_cast<const char*>(vertex), stride, 0);
+
+			std::vector<unsigned int>& bucket = buckets[hash];
+			bool found = false;
+			for (unsigned int candidate : bucket)
+			{
+				if (memcmp(inOutVertexData.data() + candidate * stride, vertex, stride) == 0)
+				{
+					remap[v] = candidate;
+					found = true;
+					break;
+				}
+			}
+
+			if (!found)
+			{
+				if (uniqueCount != v)
+				{
+					memmove(inOutVertexData.data() + uniqueCount * stride, vertex, stride);
+				}
+				bucket.push_back(uniqueCount);
+				remap[v] = uniqueCount;
+				uniqueCount++;
+			}
+		}
+
+		inOutVertexData.resize(uniqueCount * stride);
+		for (unsigned int& index : inOutIndices)
+		{
+			index = remap[index];
+		}
+	}
+
+	const char* GetString(const FileHeader& aHeader, const uint8_t* someData, uint32_t anOffset)
+	{
+		if (anOffset >= aHeader.StringTableSize)
+		{
+			return nullptr;
+		}
+		return reinterpret_cast<const char*>(someData + aHeader.StringTableOffset + anOffset);
+	}
+}
+
+void ModelCooker::ConvertVertices(const TGA::FBX::Mesh::Element& anElement, std::vector<Vertex>& outVertices)
+{
+	outVertices.resize(anElement.Vertices.size());
+
+	for (size_t v = 0; v < anElement.Vertices.size(); v++)
+	{
+		const TGA::FBX::Vertex& source = anElement.Vertices[v];
+		Vertex& target = outVertices[v];
+
+		// The most important part, the position!
+		target.Position = {
+			source.Position[0],
+			source.Position[1],
+			source.Position[2],
+			source.Position[3]
+		};
+
+		// All four vertex color channels I have.
+		for (int vCol = 0; vCol < 4; vCol++)
+		{
+			target.VertexColors[vCol] = {
+				source.VertexColors[vCol][0],
+				source.VertexColors[vCol][1],
+				source.VertexColors[vCol][2],
+				source.VertexColors[vCol][3]
+			};
+
+			//FIX ME. Sets vertex colors to 1 if no data given
+			// The FBX importer reads vertex colors as-is, so a missing set comes through as black
+			// which made models transparent.
+			if (source.VertexColors[vCol][0] + source.VertexColors[vCol][1] + source.VertexColors[vCol][2] + source.VertexColors[vCol][3] == 0)
+			{
+				target.VertexColors[vCol] = { 1,1,1,1 };
+			}
+		}
+
+		target.Normal = Vector3f(source.Normal[0], source.Normal[1], source.Normal[2]);
+		target.Binormal = Vector3f(source.BiNormal[0], source.BiNormal[1], source.BiNormal[2]);
+		target.Tangent = Vector3f(source.Tangent[0], source.Tangent[1], source.Tangent[2]);
+
+		for (unsigned int UVch = 0; UVch < 4; UVch++)
+		{
+			target.UVs[UVch] = {
+				 source.UVs[UVch][0],
+				 source.UVs[UVch][1]
+			};
+		}
+
+		target.Bones = {
+			static_cast<float>(source.BoneIDs[0]),
+			static_cast<float>(source.BoneIDs[1]),
+			static_cast<float>(source.BoneIDs[2]),
+			static_cast<float>(source.BoneIDs[3])
+		};
+
+		target.Weights = {
+			source.BoneWeights[0],
+			source.BoneWeights[1],
+			source.BoneWeights[2],
+			source.BoneWeights[3]
+		};
+	}
+}
+
+BoxSphereBounds ModelCooker::CalculateBoxSphereBounds(const Vertex* someVertices, size_t aVertexCount)
+{
+	if (aVertexCount == 0)
+	{
+		return { 0.0f, Vector3f::Zero, Vector3f::Zero };
+	}
+
+	// Start from a vertex rather than the origin, or meshes away from it get bounds stretched back to it.
+	const Vector4f& firstPosition = someVertices[0].Position;
+	Vector3f minExtents(firstPosition.x, firstPosition.y, firstPosition.z);
+	Vector3f maxExtents = minExtents;
+
+	for (size_t v = 1; v < aVertexCount; v++)
+	{
+		const Vector4f& position = someVertices[v].Position;
+
+		maxExtents.X = FMath::Max(maxExtents.X, position.x);
+		maxExtents.Y = FMath::Max(maxExtents.Y, position.y);
+		maxExtents.Z = FMath::Max(maxExtents.Z, position.z);
+
+		minExtents.X = FMath::Min(minExtents.X, position.x);
+		minExtents.Y = FMath::Min(minExtents.Y, position.y);
+		minExtents.Z = FMath::Min(minExtents.Z, position.z);
+	}
+
+	const Vector3f extentsCenter = 0.5f * (minExtents + maxExtents);
+	const Vector3f boxExtents = 0.5f * (maxExtents - minExtents);
+	// The sphere has to reach the corners of the box, otherwise culling against it drops visible meshes.
+	const float boxSphereRadius = boxExtents.Length();
+	return { boxSphereRadius, boxExtents, extentsCenter };
+}
+
+uint64_t ModelCooker::HashSource(const uint8_t* someData, size_t aSize)
+{
+	// xxh64 here is the recursive constexpr flavour, so feed it in blocks and chain the seed
+	// instead of handing it a whole FBX at once.
+	uint64_t hash = 0;
+	for (size_t offset = 0; offset < aSize; offset += SOURCE_HASH_BLOCK_SIZE)
+	{
+		const size_t blockSize = std::min(SOURCE_HASH_BLOCK_SIZE, aSize - offset);
+		hash = xxh64::hash(reinterpret_cast<const char*>(someData + offset), blockSize, hash);
+	}
+	return hash;
+}
+
+bool ModelCooker::Cook(const TGA::FBX::Mesh& aMesh, const CookedMeshSourceKey& aSourceKey, std::vector<uint8_t>& outData, const ModelCookSettings& someSettings, ModelCookReport* outReport)
+{
+	auto fail = [outReport](std::string anError)
+	{
+		if (outReport)
+		{
+			outReport->Error = std::move(anError);
+		}
+		return false;
+	};
+
+	if (aMesh.Elements.size() > MAX_MESHES_PER_MODEL)
+	{
+		return fail("More than " + std::to_string(MAX_MESHES_PER_MODEL) + " elements");
+	}
+
+	const size_t elementCount = aMesh.Elements.size();
+	const size_t jointCount = aMesh.Skeleton.GetRoot() ? aMesh.Skeleton.Bones.size() : 0;
+
+	std::vector<ElementEntry> elements(elementCount);
+	std::vector<JointEntry> joints(jointCount);
+	std::vector<char> stringTable;
+
+	outData.clear();
+	outData.resize(sizeof(FileHeader) + sizeof(ElementEntry) * elementCount + sizeof(JointEntry) * jointCount);
+
+	for (size_t i = 0; i < elementCount; i++)
+	{
+		const TGA::FBX::Mesh::Element& element = aMesh.Elements[i];
+		ElementEntry& entry = elements[i];
+		memset(&entry, 0, sizeof(ElementEntry));
+
+		std::vector<Vertex> vertices;
+		ConvertVertices(element, vertices);
+
+		const BoxSphereBounds bounds = CalculateBoxSphereBounds(vertices.data(), vertices.size());
+		entry.Radius = bounds.Radius;
+		entry.BoxExtents[0] = bounds.BoxExtents.X;
+		entry.BoxExtents[1] = bounds.BoxExtents.Y;
+		entry.BoxExtents[2] = bounds.BoxExtents.Z;
+		entry.Center[0] = bounds.Center.X;
+		entry.Center[1] = bounds.Center.Y;
+		entry.Center[2] = bounds.Center.Z;
+
+		const VertexLayout layout = VertexLayout::Build(vertices.data(), vertices.size());
+		if (layout.Has(VertexAttribute::Skin))
+		{
+			// Encoding would truncate the index and bind the vertex to the wrong joint.
+			for (const Vertex& vertex : vertices)
+			{
+				const float largestBone = FMath::Max(FMath::Max(vertex.Bones.x, vertex.Bones.y), FMath::Max(vertex.Bones.z, vertex.Bones.w));
+				if (largestBone >= static_cast<float>(VertexLayout::MaxBones))
+				{
+					return fail(element.MeshName + " is skinned to bone " + std::to_string(static_cast<uint32_t>(largestBone)) +
+						", only " + std::to_string(VertexLayout::MaxBones) + " bones are supported");
+				}
+			}
+		}
+
+		std::vector<uint8_t> vertexData(layout.Stride * vertices.size());
+		layout.EncodeVertices(vertices.data(), vertices.size(), vertexData.data());
+
+		std::vector<unsigned int> indices = element.Indices;
+		WeldVertices(layout, vertexData, indices);
+
+		const size_t weldedVertexCount = vertexData.size() / layout.Stride;
+		const VertexCacheStatistics statisticsBefore = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), weldedVertexCount);
+
+		// Every LOD is simplified from the one before it and indexes into the same vertices.
+		std::vector<std::vector<unsigned int>> lodIndices;
+		std::vector<float> lodErrors;
+		lodIndices.push_back(std::move(indices));
+		lodErrors.push_back(0.0f);
+		indices.clear();
+
+		if (!someSettings.LODTriangleRatios.empty() && !lodIndices[0].empty())
+		{
+			std::vector<Vertex> weldedVertices(weldedVertexCount);
+			layout.DecodeVertices(vertexData.data(), weldedVertexCount, weldedVertices.data());
+
+			SimplifierVertexFormat format;
+			format.PositionOffset = offsetof(Vertex, Position);
+			if (layout.Has(VertexAttribute::Skin))
+			{
+				format.BoneOffset = static_cast<int>(offsetof(Vertex, Bones));
+				format.WeightOffset = static_cast<int>(offsetof(Vertex, Weights));
+			}
+
+			for (float ratio : someSettings.LODTriangleRatios)
+			{
+				const std::vector<unsigned int>& previous = lodIndices.back();
+				const size_t targetIndexCount = static_cast<size_t>(static_cast<float>(lodIndices[0].size() / 3) * ratio) * 3;
+				if (targetIndexCount >= previous.size())
+				{
+					continue;
+				}
+
+				std::vector<unsigned int> simplified;
+				const float error = MeshSimplifier::Simplify(previous.data(), previous.size(), reinterpret_cast<const uint8_t*>(weldedVertices.data()), sizeof(Vertex),
+					weldedVertexCount, format, targetIndexCount, someSettings.LODMaxError, simplified);
+
+				// Hit the error limit before getting anywhere, coarser ratios won't do better.
+				if (simplified.empty() || static_cast<float>(simplified.size()) > static_cast<float>(previous.size()) * someSettings.LODMinReduction)
+				{
+					break;
+				}
+
+				lodIndices.push_back(std::move(simplified));
+				lodErrors.push_back(lodErrors.back() + error);
+			}
+		}
+
+		for (size_t lod = 0; lod < lodIndices.size(); lod++)
+		{
+			std::vector<unsigned int>& lodList = lodIndices[lod];
+
+			if (someSettings.OptimizeVertexCache)
+			{
+				MeshOptimizer::OptimizeVertexCache(lodList.data(), lodList.size(), weldedVertexCount);
+			}
+
+			if (someSettings.OptimizeOverdraw && lod == 0)
+			{
+				// Position is always the first attribute of the compact layout.
+				MeshOptimizer::OptimizeOverdraw(lodList.data(), lodList.size(), vertexData.data(), layout.Stride, weldedVertexCount, someSettings.OverdrawThreshold);
+			}
+		}
+
+		std::vector<LODEntry> lods(lodIndices.size());
+		for (size_t lod = 0; lod < lodIndices.size(); lod++)
+		{
+			lods[lod].StartIndex = static_cast<uint32_t>(indices.size());
+			lods[lod].IndexCount = static_cast<uint32_t>(lodIndices[lod].size());
+			lods[lod].Error = lodErrors[lod];
+			lods[lod].Padding = 0;
+			indices.insert(indices.end(), lodIndices[lod].begin(), lodIndices[lod].end());
+		}
+
+		// LOD 0 comes first in the index buffer, so the vertex order ends up tuned for the full mesh.
+		if (someSettings.OptimizeVertexCache || someSettings.OptimizeOverdraw)
+		{
+			MeshOptimizer::OptimizeVertexFetch(vertexData, layout.Stride, indices.data(), indices.size());
+		}
+
+		if (outReport)
+		{
+			ModelCookReport::Element& reportElement = outReport->Elements.emplace_back();
+			reportElement.Name = element.MeshName;
+			reportElement.Before = statisticsBefore;
+			reportElement.After = MeshOptimizer::AnalyzeVertexCache(indices.data(), lods[0].IndexCount, vertexData.size() / layout.Stride);
+			for (const LODEntry& lod : lods)
+			{
+				reportElement.LODs.push_back({ lod.IndexCount / 3, lod.Error });
+			}
+		}
+
+		entry.VertexAttributes = layout.Attributes;
+		entry.VertexStride = layout.Stride;
+		entry.VertexCount = static_cast<uint32_t>(vertexData.size() / layout.Stride);
+		entry.VertexOffset = AppendAligned(outData, vertexData.data(), vertexData.size());
+		entry.IndexCount = static_cast<uint32_t>(indices.size());
+		entry.IndexOffset = AppendAligned(outData, indices.data(), sizeof(unsigned int) * indices.size());
+		entry.LODCount = static_cast<uint32_t>(lods.size());
+		entry.LODOffset = AppendAligned(outData, lods.data(), sizeof(LODEntry) * lods.size());
+
+		entry.NameOffset = AddString(stringTable, element.MeshName);
+		entry.MaterialNameOffset = AddString(stringTable,
+			element.MaterialIndex < aMesh.Materials.size() ? aMesh.Materials[element.MaterialIndex].MaterialName : std::string());
+	}
+
+	for (size_t j = 0; j < jointCount; j++)
+	{
+		const TGA::FBX::Skeleton::Bone& bone = aMesh.Skeleton.Bones[j];
+		JointEntry& entry = joints[j];
+		memset(&entry, 0, sizeof(JointEntry));
+
+		// Store the bind pose the way the engine wants it so loading is a straight copy.
+		Matrix4x4f bindPoseInverseTranspose;
+		memcpy(&bindPoseInverseTranspose, &bone.BindPoseInverse, sizeof(float) * 16);
+		const Matrix4x4f bindPoseInverse = Matrix4x4f::Transpose(bindPoseInverseTranspose);
+		memcpy(entry.BindPoseInverse, &bindPoseInverse, sizeof(float) * 16);
+
+		entry.Parent = bone.ParentIdx;
+		entry.NameOffset = AddString(stringTable, bone.Name);
+		entry.ChildCount = static_cast<uint32_t>(bone.Children.size());
+		entry.ChildrenOffset = AppendAligned(outData, bone.Children.data(), sizeof(unsigned int) * bone.Children.size());
+	}
+
+	FileHeader header;
+	memset(&header, 0, sizeof(FileHeader));
+	header.Magic = COOKED_MESH_MAGIC;
+	header.Version = COOKED_MESH_VERSION;
+	header.SourceTimestamp = aSourceKey.Timestamp;
+	header.SourceHash = aSourceKey.Hash;
+	header.VertexStride = sizeof(Vertex);
+	header.ElementCount = static_cast<uint32_t>(elementCount);
+	header.JointCount = static_cast<uint32_t>(jointCount);
+	header.StringTableSize = static_cast<uint32_t>(stringTable.size());
+	header.StringTableOffset = AppendAligned(outData, stringTable.data(), stringTable.size());
+	header.TotalSize = outData.size();
+
+	uint8_t* writePtr = outData.data();
+	memcpy(writePtr, &header, sizeof(FileHeader));
+	writePtr += sizeof(FileHeader);
+	memcpy(writePtr, elements.data(), sizeof(ElementEntry) * elementCount);
+	writePtr += sizeof(ElementEntry) * elementCount;
+	if (jointCount > 0)
+	{
+		memcpy(writePtr, joints.data(), sizeof(JointEntry) * jointCount);
+	}
+
+	return true;
+}
+
+bool ModelCooker::ReadSourceKey(const uint8_t* someData, size_t aSize, CookedMeshSourceKey& outSourceKey)
+{
+	if (!someData || aSize < sizeof(FileHeader))
+	{
+		return false;
+	}
+
+	FileHeader header;
+	memcpy(&header, someData, sizeof(FileHeader));
+	if (header.Magic != COOKED_MESH_MAGIC || header.Version != COOKED_MESH_VERSION || header.TotalSize != aSize)
+	{
+		return false;
+	}
+
+	outSourceKey.Timestamp = header.SourceTimestamp;
+	outSourceKey.Hash = header.SourceHash;
+	return true;
+}
+
+bool ModelCooker::WriteSourceKey(uint8_t* someData, size_t aSize, const CookedMeshSourceKey& aSourceKey)
+{
+	if (!someData || aSize < sizeof(FileHeader))
+	{
+		return false;
+	}
+
+	FileHeader header;
+	memcpy(&header, someData, sizeof(FileHeader));
+	if (header.Magic != COOKED_MESH_MAGIC || header.Version != COOKED_MESH_VERSION)
+	{
+		return false;
+	}
+
+	header.SourceTimestamp = aSourceKey.Timestamp;
+	header.SourceHash = aSourceKey.Hash;
+	memcpy(someData, &header, sizeof(FileHeader));
+	return true;
+}
+
+size_t ModelCooker::GetHeaderSize()
+{
+	return sizeof(FileHeader);
+}
+
+bool ModelCooker::Parse(const uint8_t* someData, size_t aSize, CookedModelView& outView)
+{
+	outView = CookedModelView();
+
+	if (!ReadSourceKey(someData, aSize, outView.SourceKey))
+	{
+		return false;
+	}
+
+	const FileHeader& header = *reinterpret_cast<const FileHeader*>(someData);
+	if (header.VertexStride != sizeof(Vertex) || header.ElementCount > MAX_MESHES_PER_MODEL)
+	{
+		return false;
+	}
+
+	const uint64_t tableSize = sizeof(FileHeader) + sizeof(ElementEntry) * static_cast<uint64_t>(header.ElementCount) + sizeof(JointEntry) * static_cast<uint64_t>(header.JointCount);
+	if (!IsRangeValid(0, tableSize, aSize) || !IsRangeValid(header.StringTableOffset, header.StringTableSize, aSize))
+	{
+		return false;
+	}
+
+	// Every string must be terminated inside the table or GetString could run off the end.
+	if (header.StringTableSize > 0 && someData[header.StringTableOffset + header.StringTableSize - 1] != '\0')
+	{
+		return false;
+	}
+
+	const ElementEntry* elements = reinterpret_cast<const ElementEntry*>(someData + sizeof(FileHeader));
+	const JointEntry* joints = reinterpret_cast<const JointEntry*>(elements + header.ElementCount);
+
+	outView.Elements.resize(header.ElementCount);
+	for (uint32_t i = 0; i < header.ElementCount; i++)
+	{
+		const ElementEntry& entry = elements[i];
+		CookedModelView::Element& element = outView.Elements[i];
+
+		element.Layout = VertexLayout::FromAttributes(entry.VertexAttributes);
+		if (element.Layout.Stride != entry.VertexStride ||
+			!IsRangeValid(entry.VertexOffset, element.Layout.Stride * static_cast<uint64_t>(entry.VertexCount), aSize) ||
+			!IsRangeValid(entry.IndexOffset, sizeof(unsigned int) * static_cast<uint64_t>(entry.IndexCount), aSize) ||
+			!IsRangeValid(entry.LODOffset, sizeof(LODEntry) * static_cast<uint64_t>(entry.LODCount), aSize) ||
+			!IsAligned(entry.IndexOffset, alignof(unsigned int)) || !IsAligned(entry.LODOffset, alignof(LODEntry)) ||
+			entry.IndexCount % 3 != 0)
+		{
+			return false;
+		}
+
+		// The indices go straight into an index buffer, one pointing past the vertices would read out of bounds on the GPU.
+		const unsigned int* indices = reinterpret_cast<const unsigned int*>(someData + entry.IndexOffset);
+		for (uint32_t index = 0; index < entry.IndexCount; index++)
+		{
+			if (indices[index] >= entry.VertexCount)
+			{
+				return false;
+			}
+		}
+
+		const LODEntry* lods = reinterpret_cast<const LODEntry*>(someData + entry.LODOffset);
+		element.LODs.resize(entry.LODCount);
+		for (uint32_t lod = 0; lod < entry.LODCount; lod++)
+		{
+			if (static_cast<uint64_t>(lods[lod].StartIndex) + lods[lod].IndexCount > entry.IndexCount ||
+				lods[lod].StartIndex % 3 != 0 || lods[lod].IndexCount % 3 != 0)
+			{
+				return false;
+			}
+			element.LODs[lod] = { lods[lod].StartIndex, lods[lod].IndexCount, lods[lod].Error };
+		}
+
+		element.Name = GetString(header, someData, entry.NameOffset);
+		element.MaterialName = GetString(header, someData, entry.MaterialNameOffset);
+		if (!element.Name || !element.MaterialName)
+		{
+			return false;
+		}
+
+		element.VertexData = someData + entry.VertexOffset;
+		element.NumberOfVertices = entry.VertexCount;
+		element.Indices = indices;
+		element.NumberOfIndices = entry.IndexCount;
+		element.Bounds.Radius = entry.Radius;
+		element.Bounds.BoxExtents = { entry.BoxExtents[0], entry.BoxExtents[1], entry.BoxExtents[2] };
+		element.Bounds.Center = { entry.Center[0], entry.Center[1], entry.Center[2] };
+	}
+
+	outView.Joints.resize(header.JointCount);
+	for (uint32_t j = 0; j < header.JointCount; j++)
+	{
+		const JointEntry& entry = joints[j];
+		CookedModelView::Joint& joint = outView.Joints[j];
+
+		if (!IsRangeValid(entry.ChildrenOffset, sizeof(unsigned int) * static_cast<uint64_t>(entry.ChildCount), aSize) ||
+			!IsAligned(entry.ChildrenOffset, alignof(unsigned int)) ||
+			entry.Parent < -1 || (entry.Parent >= 0 && static_cast<uint32_t>(entry.Parent) >= header.JointCount))
+		{
+			return false;
+		}
+
+		const unsigned int* children = reinterpret_cast<const unsigned int*>(someData + entry.ChildrenOffset);
+		for (uint32_t child = 0; child < entry.ChildCount; child++)
+		{
+			if (children[child] >= header.JointCount)
+			{
+				return false;
+			}
+		}
+
+		joint.Name = GetString(header, someData, entry.NameOffset);
+		if (!joint.Name)
+		{
+			return false;
+		}
+
+		joint.BindPoseInverse = entry.BindPoseInverse;
+		joint.Parent = entry.Parent;
+		joint.Children = children;
+		joint.NumberOfChildren = entry.ChildCount;
+	}
+
+	return true;
+}
+
+std::wstring ModelCooker::GetCookedPath(const std::wstring& aSourcePath)
+{
+	const size_t extension = aSourcePath.find_last_of(L'.');
+	const size_t separator = aSourcePath.find_last_of(L"/\\");
+	if (extension == std::wstring::npos || (separator != std::wstring::npos && extension < separator))
+	{
+		return aSourcePath + FileExtension;
+	}
+	return aSourcePath.substr(0, extension) + FileExtension;
+}
@@ -0,0 +1,161 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <tge/math/Vector.h>
+#include <tge/graphics/Vertex.h>
+#include <tge/graphics/VertexLayout.h>
+#include <tge/model/MeshOptimizer.h>
+#include <tge/model/Model.h>
+
+#include <TGAFBXImporter/source/TgaFbxStructs.h>
+
+namespace Tga
+{
+
+/// <summary>
+/// Identifies the source asset a cooked mesh was built from.
+/// The timestamp is checked first, the content hash is only used when the timestamp differs (e.g. after a checkout).
+/// </summary>
+struct CookedMeshSourceKey
+{
+	int64_t Timestamp = 0;
+	uint64_t Hash = 0;
+};
+
+/// <summary>
+/// A parsed view into a cooked .tgamesh blob. All pointers reference the blob itself,
+/// so the view is only valid as long as the blob (or the mapped file) is alive.
+/// </summary>
+struct CookedModelView
+{
+	struct Element
+	{
+		const char* Name = nullptr;
+		const char* MaterialName = nullptr;
+		// Vertices in the compact layout, decode with Layout before handing them to the GPU.
+		const uint8_t* VertexData = nullptr;
+		VertexLayout Layout;
+		// All LODs back to back, LOD 0 first.
+		const unsigned int* Indices = nullptr;
+		uint32_t NumberOfVertices = 0;
+		uint32_t NumberOfIndices = 0;
+		BoxSphereBounds Bounds;
+		std::vector<MeshLOD> LODs;
+	};
+
+	struct Joint
+	{
+		const float* BindPoseInverse = nullptr;
+		const unsigned int* Children = nullptr;
+		const char* Name = nullptr;
+		uint32_t NumberOfChildren = 0;
+		int Parent = -1;
+	};
+
+	CookedMeshSourceKey SourceKey;
+	std::vector<Element> Elements;
+	std::vector<Joint> Joints;
+};
+
+/// <summary>
+/// Controls the optimization passes run on each element while cooking.
+/// </summary>
+struct ModelCookSettings
+{
+	bool OptimizeVertexCache = true;
+	// Off by default, it only pays off on meshes that are drawn with depth testing and overlap themselves a lot.
+	bool OptimizeOverdraw = false;
+	float OverdrawThreshold = 1.05f;
+
+	// Triangle count of each generated LOD relative to the full mesh. Leave empty to skip LOD generation.
+	std::vector<float> LODTriangleRatios = { 0.5f, 0.25f, 0.125f };
+	// Largest error a single LOD step may introduce, relative to the mesh extents.
+	float LODMaxError = 0.05f;
+	// A LOD is only kept if it has at most this fraction of the triangles of the previous one.
+	float LODMinReduction = 0.9f;
+};
+
+/// <summary>
+/// Vertex cache statistics per element, before and after the optimization passes, and what each LOD ended up as.
+/// </summary>
+struct ModelCookReport
+{
+	struct LOD
+	{
+		uint32_t TriangleCount;
+		// Relative to the mesh extents.
+		float Error;
+	};
+
+	struct Element
+	{
+		std::string Name;
+		VertexCacheStatistics Before;
+		VertexCacheStatistics After;
+		std::vector<LOD> LODs;
+	};
+
+	std::vector<Element> Elements;
+	// Why the cook failed, empty when it succeeded.
+	std::string Error;
+};
+
+/// <summary>
+/// Converts imported FBX meshes into the engine native .tgamesh format and reads it back.
+/// Does not touch the FBX SDK or the GPU, everything here works on plain memory.
+/// </summary>
+class ModelCooker
+{
+public:
+	static constexpr const wchar_t* FileExtension = L".tgamesh";
+
+	/**
+	 * Converts the vertices of an imported element to the engine vertex format.
+	 * @param anElement The imported element.
+	 * @param outVertices Receives one engine vertex per imported vertex.
+	 */
+	static void ConvertVertices(const TGA::FBX::Mesh::Element& anElement, std::vector<Vertex>& outVertices);
+
+	static BoxSphereBounds CalculateBoxSphereBounds(const Vertex* someVertices, size_t aVertexCount);
+
+	/**
+	 * Hashes the raw contents of a source asset. Used as the fallback key when timestamps don't match.
+	 */
+	static uint64_t HashSource(const uint8_t* someData, size_t aSize);
+
+	/**
+	 * Writes the mesh, including skeleton, material names and bounds, to a .tgamesh blob.
+	 * @param aMesh The imported mesh.
+	 * @param aSourceKey The key of the source file the mesh was imported from.
+	 * @param outData Receives the cooked blob.
+	 * @param someSettings Which optimization passes to run on the index and vertex buffers.
+	 * @param outReport Optional, receives vertex cache statistics for each element, or the reason the cook failed.
+	 * @returns True if the mesh could be cooked. False if it has too many elements or a vertex uses a bone the compact layout can't store.
+	 */
+	static bool Cook(const TGA::FBX::Mesh& aMesh, const CookedMeshSourceKey& aSourceKey, std::vector<uint8_t>& outData, const ModelCookSettings& someSettings = ModelCookSettings(), ModelCookReport* outReport = nullptr);
+
+	/**
+	 * Validates a .tgamesh blob and builds a view into it without copying any vertex or index data.
+	 * @returns False if the blob is truncated, corrupt or was cooked with a different version.
+	 */
+	static bool Parse(const uint8_t* someData, size_t aSize, CookedModelView& outView);
+
+	/**
+	 * Reads only the source key from a .tgamesh blob. Cheaper than Parse when checking if the cache is stale.
+	 */
+	static bool ReadSourceKey(const uint8_t* someData, size_t aSize, CookedMeshSourceKey& outSourceKey);
+
+	/**
+	 * Replaces the source key in the header of a .tgamesh blob. Only the first GetHeaderSize() bytes are needed.
+	 * @returns False if someData doesn't start with a header of the current version.
+	 */
+	static bool WriteSourceKey(uint8_t* someData, size_t aSize, const CookedMeshSourceKey& aSourceKey);
+
+	static size_t GetHeaderSize();
+
+	static std::wstring GetCookedPath(const std::wstring& aSourcePath);
+};
+
+} // namespace Tga
@@ -1,17 +1,24 @@
 #include "stdafx.h"
 #include "ModelFactory.h"
 
+#include <filesystem>
 #include <fstream>
+#include <stdexcept>
 
 #include <tge/animation/animationPlayer.h>
 #include <tge/graphics/DX11.h>
 #include <tge/util/StringCast.h>
 #include <tge/model/Model.h>
+#include <tge/model/ModelCooker.h>
 #include <tge/model/ModelInstance.h>
 #include <tge/graphics/Vertex.h>
+#include <tge/graphics/VertexLayout.h>
 #include <tge/math/matrix4x4.h>
 #include <tge/texture/texture.h>
 #include <tge/texture/TextureManager.h>
+#include <tge/util/MappedFile.h>
+#include <tge/filesystem/FileView.h>
+#include <tge/filesystem/VirtualFileSystem.h>
 
 #include <TGAFBXImporter/source/Importer.h>
 #include <DDSTextureLoader/DDSTextureLoader11.h>
@@ -19,6 +26,29 @@
 using namespace Tga;
 ModelFactory* ModelFactory::myInstance = nullptr;
 
+struct ModelFactory::PreparedModel
+{
+	std::wstring ResolvedPath;
+	// View points into CookedFile when the cache was current, or into CookedData after a fresh cook.
+	FileView CookedFile;
+	std::vector<uint8_t> CookedData;
+	CookedModelView View;
+};
+
+struct ModelFactory::PendingModel
+{
+	std::promise<std::shared_ptr<Model>> Promise;
+	std::shared_future<std::shared_ptr<Model>> Future;
+	std::vector<ModelLoadCallback> Callbacks;
+};
+
+struct ModelFactory::PendingAnimation
+{
+	std::promise<std::shared_ptr<Animation>> Promise;
+	std::shared_future<std::shared_ptr<Animation>> Future;
+	std::vector<AnimationLoadCallback> Callbacks;
+};
+
 #define TEXTURE_SET_0 0
 #define TEXTURE_SET_1 1
 #define TEXTURE_SET_2 2
@@ -333,15 +363,20 @@ bool ModelFactory::InitUnitCube()
 	//const Vector3f boxExtents = 0.5f * (maxExtents - minExtents);
 	//const float myBoxSphereRadius = FMath::Max(boxExtents.X, FMath::Max(boxExtents.Y, boxExtents.Z));
 
+	// Uploaded in the same compact layout as cooked meshes, which is what the model shaders read.
+	const VertexLayout layout = VertexLayout::Build(mdlVertices.data(), mdlVertices.size());
+	std::vector<uint8_t> vertexData(layout.Stride * mdlVertices.size());
+	layout.EncodeVertices(mdlVertices.data(), mdlVertices.size(), vertexData.data());
+
 	HRESULT result;
 
 	D3D11_BUFFER_DESC vertexBufferDesc{};
-	vertexBufferDesc.ByteWidth = static_cast<UINT>(mdlVertices.size()) * static_cast<UINT>(sizeof(Vertex));
+	vertexBufferDesc.ByteWidth = static_cast<UINT>(vertexData.size());
 	vertexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
 	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 
 	D3D11_SUBRESOURCE_DATA vertexSubresourceData{};
-	vertexSubresourceData.pSysMem = &mdlVertices[0];
+	vertexSubresourceData.pSysMem = vertexData.data();
 
 	ID3D11Buffer* vertexBuffer;
 	result = DX11::Device->CreateBuffer(&vertexBufferDesc, &vertexSubresourceData, &vertexBuffer);
@@ -370,7 +405,8 @@ bool ModelFactory::InitUnitCube()
 	Model::MeshData meshData = {};
 	meshData.NumberOfVertices = static_cast<UINT>(mdlVertices.size());
 	meshData.NumberOfIndices = static_cast<UINT>(mdlIndices.size());
-	meshData.Stride = sizeof(Vertex);
+	meshData.Stride = layout.Stride;
+	meshData.VertexAttributes = layout.Attributes;
 	meshData.Offset = 0;
 	meshData.VertexBuffer = vertexBuffer;
 	meshData.IndexBuffer = indexBuffer;
@@ -429,15 +465,20 @@ bool ModelFactory::InitUnitPlane()
 	//const Vector3f boxExtents = 0.5f * (maxExtents - minExtents);
 	//const float myBoxSphereRadius = FMath::Max(boxExtents.X, FMath::Max(boxExtents.Y, boxExtents.Z));
 
+	// Uploaded in the same compact layout as cooked meshes, which is what the model shaders read.
+	const VertexLayout layout = VertexLayout::Build(mdlVertices.data(), mdlVertices.size());
+	std::vector<uint8_t> vertexData(layout.Stride * mdlVertices.size());
+	layout.EncodeVertices(mdlVertices.data(), mdlVertices.size(), vertexData.data());
+
 	HRESULT result;
 
 	D3D11_BUFFER_DESC vertexBufferDesc{};
-	vertexBufferDesc.ByteWidth = static_cast<UINT>(mdlVertices.size()) * static_cast<UINT>(sizeof(Vertex));
+	vertexBufferDesc.ByteWidth = static_cast<UINT>(vertexData.size());
 	vertexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
 	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 
 	D3D11_SUBRESOURCE_DATA vertexSubresourceData{};
-	vertexSubresourceData.pSysMem = &mdlVertices[0];
+	vertexSubresourceData.pSysMem = vertexData.data();
 
 	ID3D11Buffer* vertexBuffer;
 	result = DX11::Device->CreateBuffer(&vertexBufferDesc, &vertexSubresourceData, &vertexBuffer);
@@ -466,7 +507,8 @@ bool ModelFactory::InitUnitPlane()
 	Model::MeshData meshData = {};
 	meshData.NumberOfVertices = static_cast<UINT>(mdlVertices.size());
 	meshData.NumberOfIndices = static_cast<UINT>(mdlIndices.size());
-	meshData.Stride = sizeof(Vertex);
+	meshData.Stride = layout.Stride;
+	meshData.VertexAttributes = layout.Attributes;
 	meshData.Offset = 0;
 	meshData.VertexBuffer = vertexBuffer;
 	meshData.IndexBuffer = indexBuffer;
@@ -492,11 +534,23 @@ ModelFactory::ModelFactory()
 {
 	TGA::FBX::Importer::InitImporter();
 	InitPrimitives();
+	// Started here rather than on the first async load, which could come from several threads at once.
+	myLoadThreads.Init();
 	myInstance = this;
 }
 
 ModelFactory::~ModelFactory()
 {
+	// Workers may be in the middle of an import, let them and the queued loads finish before the importer goes away.
+	myLoadThreads.Shutdown();
+
+	// Models are only created by the completions on the main thread, which won't run anymore.
+	for (auto& pending : myPendingModels)
+	{
+		pending.second->Promise.set_exception(std::make_exception_ptr(std::runtime_error("ModelFactory was destroyed before the model finished loading")));
+	}
+	myPendingModels.clear();
+
 	myInstance = nullptr;
 	TGA::FBX::Importer::UninitImporter();
 }
@@ -513,74 +567,74 @@ void AssignMaterials(const std::wstring& someFilePath, Model* Mdl, ModelInstance
 
 		std::wstring materialFileName = path + string_cast<std::wstring>(Mdl->GetMaterialName(i));
 
-		TextureResource* albedoTexture = nullptr;
+		TextureHandle albedoTexture;
 
-		if (albedoTexture == nullptr)
+		if (!albedoTexture)
 		{
 			std::wstring fnAlbedo = materialFileName + L"_C.dds";
-			albedoTexture = engine.GetTextureManager().TryGetTexture(fnAlbedo.c_str());
+			albedoTexture = engine.GetTextureManager().TryAcquireTexture(fnAlbedo.c_str());
 		}
 
-		if (albedoTexture == nullptr)
+		if (!albedoTexture)
 		{
 			std::wstring fnAlbedo = materialFileName + L"_D.dds";
-			albedoTexture = engine.GetTextureManager().TryGetTexture(fnAlbedo.c_str());
+			albedoTexture = engine.GetTextureManager().TryAcquireTexture(fnAlbedo.c_str());
 		}
 
-		if (albedoTexture == nullptr)
+		if (!albedoTexture)
 		{
 			std::wstring fnAlbedo = baseFileName + L"_C.dds";
-			albedoTexture = engine.GetTextureManager().TryGetTexture(fnAlbedo.c_str());
+			albedoTexture = engine.GetTextureManager().TryAcquireTexture(fnAlbedo.c_str());
 		}
 
-		if (albedoTexture == nullptr)
+		if (!albedoTexture)
 		{
 			std::wstring fnAlbedo = baseFileName + L"_D.dds";
-			albedoTexture = engine.GetTextureManager().TryGetTexture(fnAlbedo.c_str());
+			albedoTexture = engine.GetTextureManager().TryAcquireTexture(fnAlbedo.c_str());
 		}
 
-		if (albedoTexture == nullptr)
-			albedoTexture = engine.GetTextureManager().GetTexture(L"Textures/T_Default_BC.dds");
+		if (!albedoTexture)
+			albedoTexture = engine.GetTextureManager().AcquireTexture(L"Textures/T_Default_BC.dds");
 
-		MI.SetTexture(i, 0, albedoTexture);
+		MI.SetTexture(i, 0, std::move(albedoTexture));
 
-		TextureResource* normalTexture = nullptr;
+		TextureHandle normalTexture;
 
-		if (normalTexture == nullptr)
+		if (!normalTexture)
 		{
 			std::wstring fnNormal = materialFileName + L"_N.dds";
-			normalTexture = engine.GetTextureManager().TryGetTexture(fnNormal.c_str(), false);
+			normalTexture = engine.GetTextureManager().TryAcquireTexture(fnNormal.c_str(), false);
 		}
 
-		if (normalTexture == nullptr)
+		if (!normalTexture)
 		{
 			std::wstring fnNormal = baseFileName + L"_N.dds";
-			normalTexture = engine.GetTextureManager().TryGetTexture(fnNormal.c_str(), false);
+			normalTexture = engine.GetTextureManager().TryAcquireTexture(fnNormal.c_str(), false);
 		}
 
-		if (normalTexture == nullptr)
-			normalTexture = engine.GetTextureManager().GetTexture(L"Textures/T_Default_N.dds", false);
+		if (!normalTexture)
+			normalTexture = engine.GetTextureManager().AcquireTexture(L"Textures/T_Default_N.dds", false);
 
-		MI.SetTexture(i, 1, normalTexture);
+		MI.SetTexture(i, 1, std::move(normalTexture));
 
-		TextureResource* materialTexture = nullptr;
+		TextureHandle materialTexture;
 
-		if (materialTexture == nullptr)
+		if (!materialTexture)
 		{
 			std::wstring fnMaterial = materialFileName + L"_M.dds";
-			materialTexture = engine.GetTextureManager().TryGetTexture(fnMaterial.c_str(), false);
+			materialTexture = engine.GetTextureManager().TryAcquireTexture(fnMaterial.c_str(), false);
 		}
 
-		if (materialTexture == nullptr)
+		if (!materialTexture)
 		{
 			std::wstring fnMaterial = baseFileName + L"_M.dds";
-			materialTexture = engine.GetTextureManager().TryGetTexture(fnMaterial.c_str(), false);
+			materialTexture = engine.GetTextureManager().TryAcquireTexture(fnMaterial.c_str(), false);
 		}
 
-		if (materialTexture == nullptr)
-			materialTexture = engine.GetTextureManager().GetTexture(L"Textures/T_Default_M.dds", false);
+		if (!materialTexture)
+			materialTexture = engine.GetTextureManager().AcquireTexture(L"Textures/T_Default_M.dds", false);
 
-		MI.SetTexture(i, 2, materialTexture);
+		MI.SetTexture(i, 2, std::move(materialTexture));
 	}
 }
 
@@ -656,253 +710,338 @@ bool ModelFactory::ModelHasMesh(const std::wstring&)
 	//return TGA::FBX::Importer::IsValidModelFile(ansiFileName);
 }
 
+namespace
+{
+	int64_t GetSourceTimestamp(const std::wstring& aFilePath)
+	{
+		std::error_code error;
+		const std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(aFilePath, error);
+		return error ? 0 : static_cast<int64_t>(writeTime.time_since_epoch().count());
+	}
+
+	uint64_t GetSourceHash(const std::wstring& aFilePath)
+	{
+		MappedFile sourceFile;
+		if (!sourceFile.Open(aFilePath))
+			return 0;
+
+		return ModelCooker::HashSource(sourceFile.GetData(), sourceFile.GetSize());
+	}
+
+	// The timestamp is the fast path. If it differs the file may just have been touched (checkouts, copies),
+	// so fall back to comparing the content hash before throwing the cooked data away.
+	// outIsTimestampStale is set when only the hash matched, the cooked header should then get the new timestamp.
+	bool IsCookedMeshCurrent(const FileView& aCookedFile, const std::wstring& aSourcePath, CookedMeshSourceKey& inOutSourceKey, bool& outIsTimestampStale)
+	{
+		outIsTimestampStale = false;
+
+		CookedMeshSourceKey cookedKey;
+		if (!ModelCooker::ReadSourceKey(aCookedFile.GetData(), aCookedFile.GetSize(), cookedKey))
+			return false;
+
+		// A source that isn't a loose file is packed or missing. It can't be imported either way, so the cooked mesh
+		// is used as it is.
+		if (inOutSourceKey.Timestamp == 0)
+			return true;
+
+		if (cookedKey.Timestamp == inOutSourceKey.Timestamp)
+			return true;
+
+		inOutSourceKey.Hash = GetSourceHash(aSourcePath);
+		outIsTimestampStale = inOutSourceKey.Hash != 0 && cookedKey.Hash == inOutSourceKey.Hash;
+		return outIsTimestampStale;
+	}
+
+	// Stores the source's new timestamp in the cooked header, so the next load takes the fast path again instead of
+	// hashing the whole source.
+	void UpdateCookedSourceKey(const std::wstring& aCookedPath, const CookedMeshSourceKey& aSourceKey)
+	{
+		std::fstream file(std::filesystem::path(aCookedPath), std::ios::binary | std::ios::in | std::ios::out);
+		std::vector<uint8_t> header(ModelCooker::GetHeaderSize());
+		if (!file.read(reinterpret_cast<char*>(header.data()), static_cast<std::streamsize>(header.size())) ||
+			!ModelCooker::WriteSourceKey(header.data(), header.size(), aSourceKey))
+		{
+			return;
+		}
+
+		// Failing to write is not an error, the hash still matches next time.
+		file.seekp(0);
+		file.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+	}
+
+	void WriteCookedMesh(const std::wstring& aCookedPath, const std::vector<uint8_t>& someCookedData)
+	{
+		// Failing to write the cache is not an error, we'll just import again next time.
+		std::ofstream file(std::filesystem::path(aCookedPath), std::ios::binary | std::ios::trunc);
+		if (file)
+		{
+			file.write(reinterpret_cast<const char*>(someCookedData.data()), static_cast<std::streamsize>(someCookedData.size()));
+		}
+	}
+}
+
 std::shared_ptr<Model> ModelFactory::LoadModelW(const std::wstring& someFilePath)
+{
+	PreparedModel preparedModel;
+	if (!PrepareModel(someFilePath, preparedModel))
+	{
+		return nullptr;
+	}
+
+	std::shared_ptr<Model> model = CreateModel(preparedModel);
+	if (model)
+	{
+		// Someone else may have loaded the same path meanwhile, everyone should end up sharing one model.
+		std::lock_guard<std::mutex> lock(myModelMutex);
+		model = myLoadedModels.insert(std::pair<std::wstring, std::shared_ptr<Model>>(someFilePath, model)).first->second;
+	}
+	return model;
+}
+
+bool ModelFactory::PrepareModel(const std::wstring& someFilePath, PreparedModel& outPreparedModel)
 {
 	// The FBX SDK doesn't like widechar :(.
 	//const std::string ansiFileName = string_cast<std::string>(someFilePath);
 	std::wstring resolved_path = Tga::Settings::ResolveAssetPathW(someFilePath);
 	const std::string path = Tga::Settings::ResolveAssetPath(string_cast<std::string>(resolved_path));
 
-	TGA::FBX::Mesh tgaModel;
-	if (TGA::FBX::Importer::LoadMeshA(path, tgaModel))
-	{
-		Skeleton mdlSkeleton;
+	const std::wstring cookedPath = ModelCooker::GetCookedPath(resolved_path);
+	CookedMeshSourceKey sourceKey;
+	sourceKey.Timestamp = GetSourceTimestamp(resolved_path);
 
-		if (tgaModel.Skeleton.GetRoot())
-		{
-			mdlSkeleton.Joints.resize(tgaModel.Skeleton.Bones.size());
-			mdlSkeleton.JointNameToIndex.reserve(mdlSkeleton.Joints.size());
-			mdlSkeleton.JointName.resize(mdlSkeleton.Joints.size());
-			for (size_t j = 0; j < tgaModel.Skeleton.Bones.size(); j++)
-			{
-				Skeleton::Joint& mdlJoint = mdlSkeleton.Joints[j];
-				TGA::FBX::Skeleton::Bone& tgaJoint = tgaModel.Skeleton.Bones[j];
+	outPreparedModel.ResolvedPath = resolved_path;
 
-				Matrix4x4f bindPoseInverseTranspose;
-				memcpy(&bindPoseInverseTranspose, &tgaJoint.BindPoseInverse, sizeof(float) * 16);
+	// Fast path, the mesh has been cooked before and the source hasn't changed since.
+	bool isTimestampStale = false;
+	bool isCookedMeshCurrent = Tga::Settings::GetFileSystem().Open(cookedPath, outPreparedModel.CookedFile) &&
+		IsCookedMeshCurrent(outPreparedModel.CookedFile, resolved_path, sourceKey, isTimestampStale);
 
-				mdlJoint.BindPoseInverse = Matrix4x4f::Transpose(bindPoseInverseTranspose);
-				mdlJoint.Name = tgaJoint.Name;
-				mdlJoint.Parent = tgaJoint.ParentIdx;
-				mdlJoint.Children = tgaJoint.Children;
+	if (isCookedMeshCurrent && isTimestampStale)
+	{
+		// The mapping keeps the file from being written, so let go of it while the header is updated.
+		outPreparedModel.CookedFile.Close();
+		UpdateCookedSourceKey(cookedPath, sourceKey);
+		isCookedMeshCurrent = Tga::Settings::GetFileSystem().Open(cookedPath, outPreparedModel.CookedFile);
+	}
 
-				mdlSkeleton.JointNameToIndex.insert({ mdlJoint.Name, j });
-				mdlSkeleton.JointName[j] = mdlJoint.Name;
-			}
-			assert(MAX_ANIMATION_BONES >= mdlSkeleton.Joints.size() && "More joints in animation than defined in EngingeDefines.h");
+	isCookedMeshCurrent = isCookedMeshCurrent &&
+		ModelCooker::Parse(outPreparedModel.CookedFile.GetData(), outPreparedModel.CookedFile.GetSize(), outPreparedModel.View);
+
+	if (!isCookedMeshCurrent)
+	{
+		outPreparedModel.CookedFile.Close();
+
+		TGA::FBX::Mesh tgaModel;
+		bool isImported = false;
+		{
+			std::lock_guard<std::mutex> lock(myImportMutex);
+			isImported = TGA::FBX::Importer::LoadMeshA(path, tgaModel);
 		}
 
-		std::vector<Model::MeshData> mdlMeshData;
-		mdlMeshData.resize(tgaModel.Elements.size());
+		if (!isImported)
+		{
+			return false;
+		}
 
-		// Convert model to our own format.
-		for (size_t i = 0; i < tgaModel.Elements.size(); i++)
+		if (sourceKey.Hash == 0)
 		{
-			// The imported element data.
-			TGA::FBX::Mesh::Element& element = tgaModel.Elements[i];
+			sourceKey.Hash = GetSourceHash(resolved_path);
+		}
 
-			// And where we'll put it in our structures.
-			Model::MeshData& meshData = mdlMeshData[i];
+		ModelCookReport cookReport;
+		if (!ModelCooker::Cook(tgaModel, sourceKey, outPreparedModel.CookedData, ModelCookSettings(), &cookReport))
+		{
+			ERROR_PRINT("Failed to cook %s: %s", path.c_str(), cookReport.Error.c_str());
+			return false;
+		}
 
-			// Convert vertices to your own format
-			std::vector<Vertex> mdlVertices;
-			mdlVertices.resize(element.Vertices.size());
+		if (!ModelCooker::Parse(outPreparedModel.CookedData.data(), outPreparedModel.CookedData.size(), outPreparedModel.View))
+		{
+			return false;
+		}
 
-			for (size_t v = 0; v < element.Vertices.size(); v++)
+		for (const ModelCookReport::Element& reportElement : cookReport.Elements)
+		{
+			INFO_PRINT("Cooked %s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", reportElement.Name.c_str(), reportElement.Before.ACMR, reportElement.After.ACMR, reportElement.Before.ATVR, reportElement.After.ATVR);
+			for (size_t lod = 1; lod < reportElement.LODs.size(); lod++)
 			{
-				// The most important part, the position!
-				mdlVertices[v].Position = {
-					element.Vertices[v].Position[0],
-					element.Vertices[v].Position[1],
-					element.Vertices[v].Position[2],
-					element.Vertices[v].Position[3]
-				};
-
-				// All four vertex color channels I have.
-				for (int vCol = 0; vCol < 4; vCol++)
-				{
-					mdlVertices[v].VertexColors[vCol] = {
-						element.Vertices[v].VertexColors[vCol][0],
-						element.Vertices[v].VertexColors[vCol][1],
-						element.Vertices[v].VertexColors[vCol][2],
-						element.Vertices[v].VertexColors[vCol][3]
-					};
-
-					//FIX ME. Sets vertex colors to 1 if no data given
-					// Daniel sger att FBX inportern lser vertex collors rtt, och om den lser frgerna rtt s fr den det vrdet. 
-					// Vilket leder till svart i vertex colors -> modeller blev transparenta.
-					if (element.Vertices[v].VertexColors[vCol][0] + element.Vertices[v].VertexColors[vCol][1] + element.Vertices[v].VertexColors[vCol][2] + element.Vertices[v].VertexColors[vCol][3] == 0)
-					{
-						mdlVertices[v].VertexColors[vCol] = { 1,1,1,1 };
-					}
-
-				}
+				INFO_PRINT("  LOD %zu: %u triangles, error %.4f", lod, reportElement.LODs[lod].TriangleCount, reportElement.LODs[lod].Error);
+			}
+		}
 
-				mdlVertices[v].Normal = Vector3f(element.Vertices[v].Normal[0], element.Vertices[v].Normal[1], element.Vertices[v].Normal[2]);
-				mdlVertices[v].Binormal = Vector3f(element.Vertices[v].BiNormal[0], element.Vertices[v].BiNormal[1], element.Vertices[v].BiNormal[2]);
-				mdlVertices[v].Tangent = Vector3f(element.Vertices[v].Tangent[0], element.Vertices[v].Tangent[1], element.Vertices[v].Tangent[2]);
+		WriteCookedMesh(cookedPath, outPreparedModel.CookedData);
+	}
 
-				for (unsigned int UVch = 0; UVch < 4; UVch++)
-				{
-					mdlVertices[v].UVs[UVch] = {
-						 element.Vertices[v].UVs[UVch][0],
-						 element.Vertices[v].UVs[UVch][1]
-					};
-				}
+	return true;
+}
 
-				mdlVertices[v].Bones = {
-					static_cast<float>(element.Vertices[v].BoneIDs[0]),
-					static_cast<float>(element.Vertices[v].BoneIDs[1]),
-					static_cast<float>(element.Vertices[v].BoneIDs[2]),
-					static_cast<float>(element.Vertices[v].BoneIDs[3])
-				};
-
-				mdlVertices[v].Weights = {
-					element.Vertices[v].BoneWeights[0],
-					element.Vertices[v].BoneWeights[1],
-					element.Vertices[v].BoneWeights[2],
-					element.Vertices[v].BoneWeights[3]
-				};
-			}
+std::shared_ptr<Model> ModelFactory::CreateModel(const PreparedModel& aPreparedModel)
+{
+	const CookedModelView& aCookedModel = aPreparedModel.View;
+	Skeleton mdlSkeleton;
 
-			std::vector<unsigned int>& mdlIndices = element.Indices;
+	if (!aCookedModel.Joints.empty())
+	{
+		mdlSkeleton.Joints.resize(aCookedModel.Joints.size());
+		mdlSkeleton.JointNameToIndex.reserve(mdlSkeleton.Joints.size());
+		mdlSkeleton.JointName.resize(mdlSkeleton.Joints.size());
+		for (size_t j = 0; j < aCookedModel.Joints.size(); j++)
+		{
+			Skeleton::Joint& mdlJoint = mdlSkeleton.Joints[j];
+			const CookedModelView::Joint& cookedJoint = aCookedModel.Joints[j];
 
-			HRESULT result;
+			// Already transposed when cooked.
+			memcpy(&mdlJoint.BindPoseInverse, cookedJoint.BindPoseInverse, sizeof(float) * 16);
+			mdlJoint.Name = cookedJoint.Name;
+			mdlJoint.Parent = cookedJoint.Parent;
+			mdlJoint.Children.assign(cookedJoint.Children, cookedJoint.Children + cookedJoint.NumberOfChildren);
 
-			D3D11_BUFFER_DESC vertexBufferDesc{};
-			vertexBufferDesc.ByteWidth = static_cast<UINT>(mdlVertices.size()) * static_cast<UINT>(sizeof(Vertex));
-			vertexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
-			vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+			mdlSkeleton.JointNameToIndex.insert({ mdlJoint.Name, j });
+			mdlSkeleton.JointName[j] = mdlJoint.Name;
+		}
+		assert(MAX_ANIMATION_BONES >= mdlSkeleton.Joints.size() && "More joints in animation than defined in EngingeDefines.h");
+	}
 
-			D3D11_SUBRESOURCE_DATA vertexSubresourceData{};
-			vertexSubresourceData.pSysMem = &mdlVertices[0];
+	std::vector<Model::MeshData> mdlMeshData;
+	mdlMeshData.resize(aCookedModel.Elements.size());
 
-			ID3D11Buffer* vertexBuffer;
-			result = DX11::Device->CreateBuffer(&vertexBufferDesc, &vertexSubresourceData, &vertexBuffer);
-			if (FAILED(result))
-			{
-				return nullptr;
-			}
+	for (size_t i = 0; i < aCookedModel.Elements.size(); i++)
+	{
+		const CookedModelView::Element& element = aCookedModel.Elements[i];
+		Model::MeshData& meshData = mdlMeshData[i];
 
-			D3D11_BUFFER_DESC indexBufferDesc{};
-			indexBufferDesc.ByteWidth = static_cast<UINT>(mdlIndices.size()) * static_cast<UINT>(sizeof(float)); // TODO: What :P Sizeof should be uint.
-			indexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
-			indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+		HRESULT result;
 
-			D3D11_SUBRESOURCE_DATA indexSubresourceData{};
-			indexSubresourceData.pSysMem = &mdlIndices[0];
+		// The compact cooked vertices go up as they are, the model shaders decode them.
+		D3D11_BUFFER_DESC vertexBufferDesc{};
+		vertexBufferDesc.ByteWidth = element.NumberOfVertices * element.Layout.Stride;
+		vertexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 
-			ID3D11Buffer* indexBuffer;
-			result = DX11::Device->CreateBuffer(&indexBufferDesc, &indexSubresourceData, &indexBuffer);
-			if (FAILED(result))
-			{
-				return nullptr;
-			}
+		D3D11_SUBRESOURCE_DATA vertexSubresourceData{};
+		vertexSubresourceData.pSysMem = element.VertexData;
 
-			meshData.NumberOfVertices = static_cast<UINT>(mdlVertices.size());
-			meshData.NumberOfIndices = static_cast<UINT>(mdlIndices.size());
-			meshData.Stride = sizeof(Vertex);
-			meshData.Offset = 0;
-			meshData.VertexBuffer = vertexBuffer;
-			meshData.IndexBuffer = indexBuffer;
-			meshData.Name = element.MeshName;
-			if (tgaModel.Materials.size() > element.MaterialIndex)
-			{
-				meshData.MaterialName = tgaModel.Materials[element.MaterialIndex].MaterialName;
-			}
-			else
-			{
-				meshData.MaterialName = "";
-			}
-			meshData.Bounds = CalculateBoxSphereBounds(mdlVertices);
+		ID3D11Buffer* vertexBuffer;
+		result = DX11::Device->CreateBuffer(&vertexBufferDesc, &vertexSubresourceData, &vertexBuffer);
+		if (FAILED(result))
+		{
+			return nullptr;
 		}
 
-		std::shared_ptr<Model> model = std::make_shared<Model>();
+		D3D11_BUFFER_DESC indexBufferDesc{};
+		indexBufferDesc.ByteWidth = element.NumberOfIndices * static_cast<UINT>(sizeof(unsigned int));
+		indexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+
+		D3D11_SUBRESOURCE_DATA indexSubresourceData{};
+		indexSubresourceData.pSysMem = element.Indices;
 
-		model->Init(mdlMeshData, resolved_path);
-		if (mdlSkeleton.Joints.size() > 0)
+		ID3D11Buffer* indexBuffer;
+		result = DX11::Device->CreateBuffer(&indexBufferDesc, &indexSubresourceData, &indexBuffer);
+		if (FAILED(result))
 		{
-			model->mySkeleton = std::move(mdlSkeleton);
+			return nullptr;
 		}
 
-		myLoadedModels.insert(std::pair<std::wstring, std::shared_ptr<Model>>(someFilePath, model));
+		meshData.NumberOfVertices = element.NumberOfVertices;
+		// The index buffer holds every LOD, draws without a LOD only use the full mesh at the start.
+		meshData.NumberOfIndices = element.LODs.empty() ? element.NumberOfIndices : element.LODs[0].NumberOfIndices;
+		meshData.Stride = element.Layout.Stride;
+		meshData.VertexAttributes = element.Layout.Attributes;
+		meshData.Offset = 0;
+		meshData.VertexBuffer = vertexBuffer;
+		meshData.IndexBuffer = indexBuffer;
+		meshData.Name = element.Name;
+		meshData.MaterialName = element.MaterialName;
+		meshData.Bounds = element.Bounds;
+		meshData.LODs = element.LODs;
+	}
 
-		return model;
+	std::shared_ptr<Model> model = std::make_shared<Model>();
+
+	model->Init(mdlMeshData, aPreparedModel.ResolvedPath);
+	if (mdlSkeleton.Joints.size() > 0)
+	{
+		model->mySkeleton = std::move(mdlSkeleton);
 	}
 
-	return nullptr;
+	return model;
 }
 
-Tga::BoxSphereBounds Tga::ModelFactory::CalculateBoxSphereBounds(std::vector<Tga::Vertex> somePositions)
+Tga::BoxSphereBounds Tga::ModelFactory::CalculateBoxSphereBounds(const std::vector<Tga::Vertex>& somePositions)
 {
-	Vector3f minExtents = Vector3f::Zero;
-	Vector3f maxExtents = Vector3f::Zero;
-
-	for (unsigned int v = 0; v < somePositions.size(); v++)
-	{
-		if (somePositions[v].Position.x > maxExtents.X)
-			maxExtents.X = somePositions[v].Position.x;
-		if (somePositions[v].Position.y > maxExtents.Y)
-			maxExtents.Y = somePositions[v].Position.y;
-		if (somePositions[v].Position.z > maxExtents.Z)
-			maxExtents.Z = somePositions[v].Position.z;
-
-		if (somePositions[v].Position.x < minExtents.X)
-			minExtents.X = somePositions[v].Position.x;
-		if (somePositions[v].Position.y < minExtents.Y)
-			minExtents.Y = somePositions[v].Position.y;
-		if (somePositions[v].Position.z < minExtents.Z)
-			minExtents.Z = somePositions[v].Position.z;
-	}
-
-	const Vector3f extentsCenter = 0.5f * (minExtents + maxExtents);
-	const Vector3f boxExtents = 0.5f * (maxExtents - minExtents);
-	const float myBoxSphereRadius = FMath::Max(boxExtents.X, FMath::Max(boxExtents.Y, boxExtents.Z));
-	return { myBoxSphereRadius, boxExtents, extentsCenter };
+	return ModelCooker::CalculateBoxSphereBounds(somePositions.data(), somePositions.size());
 }
 
 std::shared_ptr<Animation> ModelFactory::GetAnimation(const std::wstring& someFilePath, const std::shared_ptr<Model>& aModel)
+{
+	std::shared_future<std::shared_ptr<Animation>> pendingLoad;
+	{
+		std::lock_guard<std::mutex> lock(myAnimationMutex);
+
+		auto it = myLoadedAnimations.find(AnimationIdentifer{ someFilePath , aModel });
+		if (it != myLoadedAnimations.end())
+			return it->second;
+
+		auto pending = myPendingAnimations.find(AnimationIdentifer{ someFilePath , aModel });
+		if (pending != myPendingAnimations.end())
+			pendingLoad = pending->second->Future;
+	}
+
+	// Animations are finished on the loader threads, so waiting here can't deadlock.
+	if (pendingLoad.valid())
+		return pendingLoad.get();
+
+	std::shared_ptr<Animation> animation = LoadAnimation(someFilePath);
+	if (animation)
+	{
+		std::lock_guard<std::mutex> lock(myAnimationMutex);
+		animation = myLoadedAnimations.insert({ AnimationIdentifer{ someFilePath , aModel }, animation }).first->second;
+	}
+
+	return animation;
+}
+
+std::shared_ptr<Animation> ModelFactory::LoadAnimation(const std::wstring& someFilePath)
 {
 	// The FBX SDK doesn't like widechar :(.
 	const std::string ansiFileName = string_cast<std::string>(someFilePath);
 	TGA::FBX::Animation fbxAnimation;
 
-	auto it = myLoadedAnimations.find(AnimationIdentifer{ someFilePath , aModel });
-	if (it != myLoadedAnimations.end())
-		return it->second;
-
-	if (TGA::FBX::Importer::LoadAnimationA(ansiFileName, fbxAnimation))
+	bool isImported = false;
 	{
-		std::shared_ptr<Animation> animation = std::make_shared<Animation>();
-		animation->Name = string_cast<std::wstring>(fbxAnimation.Name);
-		animation->Length = fbxAnimation.Length;
-		animation->FramesPerSecond = fbxAnimation.FramesPerSecond;
-		animation->Frames.resize(fbxAnimation.Frames.size());
-		animation->Duration = static_cast<float>(fbxAnimation.Duration);
+		std::lock_guard<std::mutex> lock(myImportMutex);
+		isImported = TGA::FBX::Importer::LoadAnimationA(ansiFileName, fbxAnimation);
+	}
 
-		for (size_t f = 0; f < animation->Frames.size(); f++)
-		{
-			animation->Frames[f].LocalTransforms.reserve(fbxAnimation.Frames[f].LocalTransforms.size());
+	if (!isImported)
+		return nullptr;
 
-			for (const auto& [boneName, boneTransform] : fbxAnimation.Frames[f].LocalTransforms)
-			{
-				Matrix4x4f localMatrix;
-				memcpy_s(&localMatrix, sizeof(Matrix4x4f), boneTransform.Data, sizeof(float) * 16);
-
-				Vector3f T, R, S;
-				localMatrix.DecomposeMatrix(T, R, S);
-				Quatf Rot(localMatrix);
-				Transform t = { T, Rot, S };
-				animation->Frames[f].LocalTransforms.emplace(boneName, t);
-			}
-		}
+	std::shared_ptr<Animation> animation = std::make_shared<Animation>();
+	animation->Name = string_cast<std::wstring>(fbxAnimation.Name);
+	animation->Length = fbxAnimation.Length;
+	animation->FramesPerSecond = fbxAnimation.FramesPerSecond;
+	animation->Frames.resize(fbxAnimation.Frames.size());
+	animation->Duration = static_cast<float>(fbxAnimation.Duration);
 
-		myLoadedAnimations[AnimationIdentifer{ someFilePath , aModel }] = animation;
+	for (size_t f = 0; f < animation->Frames.size(); f++)
+	{
+		animation->Frames[f].LocalTransforms.reserve(fbxAnimation.Frames[f].LocalTransforms.size());
 
-		return animation;
+		for (const auto& [boneName, boneTransform] : fbxAnimation.Frames[f].LocalTransforms)
+		{
+			Matrix4x4f localMatrix;
+			memcpy_s(&localMatrix, sizeof(Matrix4x4f), boneTransform.Data, sizeof(float) * 16);
+
+			Vector3f T, R, S;
+			localMatrix.DecomposeMatrix(T, R, S);
+			Quatf Rot(localMatrix);
+			Transform t = { T, Rot, S };
+			animation->Frames[f].LocalTransforms.emplace(boneName, t);
+		}
 	}
 
-	return nullptr;
+	return animation;
 }
 
 AnimationPlayer ModelFactory::GetAnimationPlayer(const std::wstring& someFilePath, const std::shared_ptr<Model>& aModel)
@@ -917,9 +1056,229 @@ AnimationPlayer ModelFactory::GetAnimationPlayer(const std::wstring& someFilePat
 
 std::shared_ptr<Model> ModelFactory::GetModel(const std::wstring& someFilePath)
 {
-	auto it = myLoadedModels.find(someFilePath);
-	if (it != myLoadedModels.end())
-		return it->second;
+	std::shared_future<std::shared_ptr<Model>> pendingLoad;
+	{
+		std::lock_guard<std::mutex> lock(myModelMutex);
+
+		auto it = myLoadedModels.find(someFilePath);
+		if (it != myLoadedModels.end())
+			return it->second;
+
+		auto pending = myPendingModels.find(someFilePath);
+		if (pending != myPendingModels.end())
+			pendingLoad = pending->second->Future;
+	}
+
+	if (pendingLoad.valid())
+	{
+		// Already loading in the background. The last step runs on the main thread, so if that's us nobody
+		// else is going to finish it.
+		if (DX11::IsOnSameThreadAsEngine())
+		{
+			while (pendingLoad.wait_for(std::chrono::milliseconds(1)) != std::future_status::ready)
+			{
+				ProcessCompletedLoads();
+			}
+		}
+		return pendingLoad.get();
+	}
 
 	return LoadModelW(someFilePath);
-}
\ No newline at end of file
+}
+
+std::shared_future<std::shared_ptr<Model>> ModelFactory::LoadAsync(const std::wstring& someFilePath, ModelLoadCallback aCallback)
+{
+	std::shared_ptr<PendingModel> pendingModel;
+	{
+		std::lock_guard<std::mutex> lock(myModelMutex);
+
+		auto loaded = myLoadedModels.find(someFilePath);
+		if (loaded != myLoadedModels.end())
+		{
+			std::promise<std::shared_ptr<Model>> promise;
+			promise.set_value(loaded->second);
+			if (aCallback)
+			{
+				// Still called from ProcessCompletedLoads so callers see the same order of events either way.
+				QueueCompletion([aCallback, model = loaded->second]() { aCallback(model); });
+			}
+			return promise.get_future().share();
+		}
+
+		auto pending = myPendingModels.find(someFilePath);
+		if (pending != myPendingModels.end())
+		{
+			if (aCallback)
+			{
+				pending->second->Callbacks.push_back(std::move(aCallback));
+			}
+			return pending->second->Future;
+		}
+
+		pendingModel = std::make_shared<PendingModel>();
+		pendingModel->Future = pendingModel->Promise.get_future().share();
+		if (aCallback)
+		{
+			pendingModel->Callbacks.push_back(std::move(aCallback));
+		}
+		myPendingModels.insert({ someFilePath, pendingModel });
+	}
+
+	myLoadThreads.Enqueue([this, someFilePath]()
+	{
+		std::shared_ptr<PreparedModel> preparedModel = std::make_shared<PreparedModel>();
+		bool isPrepared = false;
+		try
+		{
+			isPrepared = PrepareModel(someFilePath, *preparedModel);
+		}
+		catch (const std::exception& anException)
+		{
+			ERROR_PRINT("Failed to load %s: %s", string_cast<std::string>(someFilePath).c_str(), anException.what());
+		}
+
+		QueueCompletion([this, someFilePath, preparedModel, isPrepared]()
+		{
+			std::shared_ptr<Model> model = isPrepared ? CreateModel(*preparedModel) : nullptr;
+
+			std::shared_ptr<PendingModel> finishedModel;
+			{
+				std::lock_guard<std::mutex> lock(myModelMutex);
+				if (model)
+				{
+					model = myLoadedModels.insert({ someFilePath, model }).first->second;
+				}
+
+				auto pending = myPendingModels.find(someFilePath);
+				finishedModel = pending->second;
+				myPendingModels.erase(pending);
+			}
+
+			finishedModel->Promise.set_value(model);
+			for (const ModelLoadCallback& callback : finishedModel->Callbacks)
+			{
+				callback(model);
+			}
+		});
+	});
+
+	return pendingModel->Future;
+}
+
+std::shared_future<std::shared_ptr<Animation>> ModelFactory::LoadAnimationAsync(const std::wstring& someFilePath, const std::shared_ptr<Model>& aModel, AnimationLoadCallback aCallback)
+{
+	const AnimationIdentifer identifier{ someFilePath, aModel };
+
+	std::shared_ptr<PendingAnimation> pendingAnimation;
+	{
+		std::lock_guard<std::mutex> lock(myAnimationMutex);
+
+		auto loaded = myLoadedAnimations.find(identifier);
+		if (loaded != myLoadedAnimations.end())
+		{
+			std::promise<std::shared_ptr<Animation>> promise;
+			promise.set_value(loaded->second);
+			if (aCallback)
+			{
+				QueueCompletion([aCallback, animation = loaded->second]() { aCallback(animation); });
+			}
+			return promise.get_future().share();
+		}
+
+		auto pending = myPendingAnimations.find(identifier);
+		if (pending != myPendingAnimations.end())
+		{
+			if (aCallback)
+			{
+				pending->second->Callbacks.push_back(std::move(aCallback));
+			}
+			return pending->second->Future;
+		}
+
+		pendingAnimation = std::make_shared<PendingAnimation>();
+		pendingAnimation->Future = pendingAnimation->Promise.get_future().share();
+		if (aCallback)
+		{
+			pendingAnimation->Callbacks.push_back(std::move(aCallback));
+		}
+		myPendingAnimations.insert({ identifier, pendingAnimation });
+	}
+
+	myLoadThreads.Enqueue([this, identifier]()
+	{
+		std::shared_ptr<Animation> animation;
+		try
+		{
+			animation = LoadAnimation(identifier.Path);
+		}
+		catch (const std::exception& anException)
+		{
+			ERROR_PRINT("Failed to load %s: %s", string_cast<std::string>(identifier.Path).c_str(), anException.what());
+		}
+
+		std::shared_ptr<PendingAnimation> finishedAnimation;
+		{
+			std::lock_guard<std::mutex> lock(myAnimationMutex);
+			if (animation)
+			{
+				animation = myLoadedAnimations.insert({ identifier, animation }).first->second;
+			}
+
+			auto pending = myPendingAnimations.find(identifier);
+			finishedAnimation = pending->second;
+			myPendingAnimations.erase(pending);
+		}
+
+		finishedAnimation->Promise.set_value(animation);
+		if (!finishedAnimation->Callbacks.empty())
+		{
+			QueueCompletion([finishedAnimation, animation]()
+			{
+				for (const AnimationLoadCallback& callback : finishedAnimation->Callbacks)
+				{
+					callback(animation);
+				}
+			});
+		}
+	});
+
+	return pendingAnimation->Future;
+}
+
+void ModelFactory::QueueCompletion(std::function<void()> aCompletion)
+{
+	std::lock_guard<std::mutex> lock(myCompletionMutex);
+	myCompletionQueue.push_back(std::move(aCompletion));
+}
+
+void ModelFactory::ProcessCompletedLoads()
+{
+	std::vector<std::function<void()>> completions;
+	{
+		std::lock_guard<std::mutex> lock(myCompletionMutex);
+		completions.swap(myCompletionQueue);
+	}
+
+	// Run outside the lock, callbacks are free to start new loads.
+	for (const std::function<void()>& completion : completions)
+	{
+		completion();
+	}
+}
+
+bool ModelFactory::HasPendingLoads()
+{
+	{
+		std::lock_guard<std::mutex> lock(myModelMutex);
+		if (!myPendingModels.empty())
+			return true;
+	}
+	{
+		std::lock_guard<std::mutex> lock(myAnimationMutex);
+		if (!myPendingAnimations.empty())
+			return true;
+	}
+
+	std::lock_guard<std::mutex> lock(myCompletionMutex);
+	return !myCompletionQueue.empty();
+}
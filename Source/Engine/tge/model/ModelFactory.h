@@ -1,5 +1,8 @@
 #pragma once
+#include <functional>
+#include <future>
 #include <map>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <tge/animation/animation.h>
@@ -7,6 +10,8 @@
 #include <tge/model/model.h>
 #include <tge/model/AnimatedModelInstance.h>
 
+#include <tge/util/ThreadPool.h>
+
 #include "ModelInstancer.h"
 
 struct ID3D11Device;
@@ -30,7 +35,11 @@ private:
 	~ModelFactory();
 public:
 
+	using ModelLoadCallback = std::function<void(const std::shared_ptr<Model>&)>;
+	using AnimationLoadCallback = std::function<void(const std::shared_ptr<Animation>&)>;
+
 	static ModelFactory& GetInstance() { if (!myInstance) { myInstance = new ModelFactory(); } return *myInstance; }
+	static ModelFactory* TryGetInstance() { return myInstance; }
 	static void DestroyInstance() { if (myInstance) { delete myInstance; myInstance = nullptr; } }
 
 	std::shared_ptr<Model> GetModel(const std::wstring& someFilePath);
@@ -42,13 +51,40 @@ public:
 
 	ModelInstancer GetModelInstancer(const std::wstring& someFilePath);
 
+	/**
+	 * Starts loading a model on the loader threads. Reading the cache, importing, cooking and decoding all run there,
+	 * only the GPU buffers are created on the main thread in ProcessCompletedLoads.
+	 * Requests for a path that is already loading share that load.
+	 * @param aCallback Called on the main thread when the model is ready, with nullptr if it failed to load.
+	 */
+	std::shared_future<std::shared_ptr<Model>> LoadAsync(const std::wstring& someFilePath, ModelLoadCallback aCallback = nullptr);
+
+	/**
+	 * Same as LoadAsync but for animations. Animations don't need the GPU, so they are done entirely on the loader threads.
+	 */
+	std::shared_future<std::shared_ptr<Animation>> LoadAnimationAsync(const std::wstring& someFilePath, const std::shared_ptr<Model>& aModel, AnimationLoadCallback aCallback = nullptr);
+
+	/**
+	 * Finishes async loads whose CPU work is done and runs their callbacks. Called by the engine once per frame.
+	 */
+	void ProcessCompletedLoads();
+	bool HasPendingLoads();
+
 	ModelInstance GetUnitCube();
 	ModelInstance GetUnitPlane();
 	bool ModelHasMesh(const std::wstring& someFilePath);
 protected:
-	
+	struct PreparedModel;
+	struct PendingModel;
+	struct PendingAnimation;
+
 	std::shared_ptr<Model> LoadModelW(const std::wstring& someFilePath);
-	Tga::BoxSphereBounds CalculateBoxSphereBounds(std::vector<Tga::Vertex> somePositions);
+	// Everything up to the GPU upload, safe to call from any thread.
+	bool PrepareModel(const std::wstring& someFilePath, PreparedModel& outPreparedModel);
+	std::shared_ptr<Model> CreateModel(const PreparedModel& aPreparedModel);
+	std::shared_ptr<Animation> LoadAnimation(const std::wstring& someFilePath);
+	void QueueCompletion(std::function<void()> aCompletion);
+	Tga::BoxSphereBounds CalculateBoxSphereBounds(const std::vector<Tga::Vertex>& somePositions);
 private:	
 	struct AnimationIdentifer
 	{
@@ -70,6 +106,19 @@ private:
 	std::unordered_map<std::wstring, std::shared_ptr<Model>> myLoadedModels;	
 	std::unordered_map<AnimationIdentifer, std::shared_ptr<Animation>, AnimationIdentiferHash> myLoadedAnimations;
 
+	// In-flight async loads, guarded by the same mutex as the loaded map they end up in.
+	std::unordered_map<std::wstring, std::shared_ptr<PendingModel>> myPendingModels;
+	std::unordered_map<AnimationIdentifer, std::shared_ptr<PendingAnimation>, AnimationIdentiferHash> myPendingAnimations;
+	std::mutex myModelMutex;
+	std::mutex myAnimationMutex;
+	// The FBX SDK shares one manager between all imports, so only one import can run at a time.
+	std::mutex myImportMutex;
+
+	std::vector<std::function<void()>> myCompletionQueue;
+	std::mutex myCompletionMutex;
+
+	ThreadPool myLoadThreads;
+
 	static ModelFactory* myInstance;
 };
 
@@ -1,7 +1,10 @@
 #include "stdafx.h"
 #include <tge/model/ModelInstance.h>
+#include <tge/graphics/Frustum.h>
+#include <tge/graphics/TextureResource.h>
 #include <tge/model/Model.h>
 #include <tge/shaders/ModelShader.h>
+#include <tge/texture/texture.h>
 
 using namespace Tga;
 
@@ -17,7 +20,7 @@ std::shared_ptr<Model> ModelInstance::GetModel() const
 
 void ModelInstance::SetTransform(const Transform& someTransform)
 {
-	myTransform = someTransform;
+	myTransform.SetTransform(someTransform);
 }
 
 void ModelInstance::SetRotation(Rotator someRotation)
@@ -37,13 +40,81 @@ void ModelInstance::SetScale(Vector3f someScale)
 	myTransform.SetScale(someScale);
 }
 
+int ModelInstance::SelectLOD(int aMeshIndex) const
+{
+	return SelectLOD(aMeshIndex, LODView::GetActive());
+}
+
+int ModelInstance::SelectLOD(int aMeshIndex, const LODView& aView) const
+{
+	if (myForcedLOD >= 0)
+	{
+		return myForcedLOD;
+	}
+
+	return myModel->SelectLOD(aMeshIndex, myTransform.GetTransform(), myMaxLODPixelError, aView);
+}
+
+bool ModelInstance::IsVisible(const Frustum& aFrustum) const
+{
+	if (!myModel)
+	{
+		return false;
+	}
+
+	const BoxSphereBounds& bounds = myModel->GetBounds();
+	const Matrix4x4f& toWorld = myTransform.GetMatrix();
+	const Vector3f scale = myTransform.GetTransform().GetScale();
+
+	const Vector4f center = Vector4f(bounds.Center, 1.0f) * toWorld;
+	const float radius = bounds.Radius * FMath::Max(FMath::Abs(scale.X), FMath::Max(FMath::Abs(scale.Y), FMath::Abs(scale.Z)));
+	if (!aFrustum.IntersectsSphere(Vector3f(center.X, center.Y, center.Z), radius))
+	{
+		return false;
+	}
+
+	return aFrustum.IntersectsBox(bounds.Center, bounds.BoxExtents, toWorld);
+}
+
+void ModelInstance::ReportTextureScreenSizes(const LODView& aView) const
+{
+	const std::vector<Model::MeshData>& meshData = myModel->GetMeshDataList();
+
+	for (int j = 0; j < meshData.size(); j++)
+	{
+		const TextureResource* const* textures = myTextures[j];
+		bool hasStreamedTexture = false;
+		for (int t = 0; t < 4; t++)
+		{
+			hasStreamedTexture |= textures[t] && textures[t]->HasScreenSizeFeedback();
+		}
+		if (!hasStreamedTexture)
+		{
+			continue;
+		}
+
+		// Assumes the mesh's UVs cover its textures about once.
+		const float screenSize = Model::CalculateScreenSize(meshData[j].Bounds, myTransform.GetTransform(), aView);
+		for (int t = 0; t < 4; t++)
+		{
+			if (textures[t])
+			{
+				textures[t]->ReportScreenSize(screenSize);
+			}
+		}
+	}
+}
+
 void ModelInstance::Render(const ModelShader& shader) const
 {
+	const LODView view = LODView::GetActive();
+	ReportTextureScreenSizes(view);
+
 	const std::vector<Model::MeshData>& meshData = myModel->GetMeshDataList();
 
 	for (int j = 0; j < meshData.size(); j++)
 	{
-		shader.Render(myTextures[j], meshData[j], myTransform.GetMatrix());
+		shader.Render(myTextures[j], meshData[j], myTransform.GetMatrix(), nullptr, SelectLOD(j, view));
 	}
 }
 
@@ -54,6 +125,39 @@ void ModelInstance::Render(const ModelShader& shader, int aMeshIndex) const
 	assert(aMeshIndex < meshData.size());
 	if (aMeshIndex < meshData.size())
 	{
-		shader.Render(myTextures[aMeshIndex], meshData[aMeshIndex], myTransform.GetMatrix());
+		shader.Render(myTextures[aMeshIndex], meshData[aMeshIndex], myTransform.GetMatrix(), nullptr, SelectLOD(aMeshIndex));
+	}
+}
+
+void ModelInstance::Record(const ModelShader& shader, RenderCommandBuffer& aCommands, const Matrix4x4f& aTransform, const LODView& aView) const
+{
+	ReportTextureScreenSizes(aView);
+
+	const std::vector<Model::MeshData>& meshData = myModel->GetMeshDataList();
+	const Matrix4x4f obToWorld = myTransform.GetMatrix() * aTransform;
+
+	for (int j = 0; j < meshData.size(); j++)
+	{
+		shader.Record(aCommands, myTextures[j], meshData[j], obToWorld, nullptr, SelectLOD(j, aView));
+	}
+}
+
+void ModelInstance::SetTexture(int meshIndex, int textureIndex, TextureResource* texture)
+{
+	myTextures[meshIndex][textureIndex] = texture;
+	if (!myTextureHandles.empty())
+	{
+		myTextureHandles[meshIndex * 4 + textureIndex].Reset();
+	}
+}
+
+void ModelInstance::SetTexture(int meshIndex, int textureIndex, TextureHandle texture)
+{
+	myTextures[meshIndex][textureIndex] = texture.Get();
+	// Only allocated once a handle is set, textures set by pointer are kept alive by whoever set them.
+	if (myTextureHandles.empty())
+	{
+		myTextureHandles.resize(MAX_MESHES_PER_MODEL * 4);
 	}
+	myTextureHandles[meshIndex * 4 + textureIndex] = std::move(texture);
 }
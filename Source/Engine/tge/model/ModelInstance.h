@@ -3,12 +3,17 @@
 #include <tge/Math/Matrix4x4.h>
 #include <tge/Math/Transform.h>
 #include <tge/EngineDefines.h>
+#include <tge/texture/TextureHandle.h>
+#include <vector>
 
 namespace Tga
 {
 
+class Frustum;
 class Model;
+struct LODView;
 class ModelShader;
+class RenderCommandBuffer;
 class ModelInstance
 {
 public:
@@ -16,23 +21,59 @@ public:
 
 	std::shared_ptr<Model> GetModel() const;
 
-	const Transform& GetTransform() const { return myTransform; }
+	const Transform& GetTransform() const { return myTransform.GetTransform(); }
 	void SetTransform(const Transform& someTransform);
 
 	void SetRotation(Rotator someRotation);
 	void SetLocation(Vector3f someLocation);
 	void SetScale(Vector3f someScale);
-	void SetTexture(int meshIndex, int textureIndex, TextureResource* texture) { myTextures[meshIndex][textureIndex] = texture; }
+	void SetTexture(int meshIndex, int textureIndex, TextureResource* texture);
+	/**
+	 * Same as above but keeps the handle, so the texture stays loaded for as long as this instance uses it.
+	 */
+	void SetTexture(int meshIndex, int textureIndex, TextureHandle texture);
 
 	const TextureResource* const* GetTextures(size_t meshIndex) const { return myTextures[meshIndex]; }
 	bool IsValid() { return myModel ? true : false; }
+
+	/**
+	 * Instances pick the coarsest LOD whose error projects to at most this many pixels.
+	 */
+	void SetMaxLODPixelError(float aPixelError) { myMaxLODPixelError = aPixelError; }
+	float GetMaxLODPixelError() const { return myMaxLODPixelError; }
+
+	/**
+	 * Forces a LOD for every mesh, -1 goes back to picking one from the projected size.
+	 */
+	void SetForcedLOD(int aLOD) { myForcedLOD = aLOD; }
+	int SelectLOD(int aMeshIndex) const;
+	int SelectLOD(int aMeshIndex, const LODView& aView) const;
+
+	/**
+	 * Tests the model bounds against aFrustum, the cheap bounding sphere first and then the box.
+	 */
+	bool IsVisible(const Frustum& aFrustum) const;
+
 	void Render(const ModelShader& shader) const;
 	void Render(const ModelShader& shader, int aMeshIndex) const;
+
+	/**
+	 * Records every mesh into aCommands instead of drawing it, see ModelShader::Record.
+	 * Safe to call from worker threads, everything it needs from the graphics state is passed in.
+	 * @param aTransform The graphics state stack transform to apply on top of the instance transform.
+	 * @param aView The camera to pick LODs and texture screen sizes with, captured on the main thread.
+	 */
+	void Record(const ModelShader& shader, RenderCommandBuffer& aCommands, const Matrix4x4f& aTransform, const LODView& aView) const;
 private:
+	// Tells mip streamed textures how large each mesh is on screen, done whenever the instance is drawn.
+	void ReportTextureScreenSizes(const LODView& aView) const;
 
 	std::shared_ptr<Model> myModel{};
 	const TextureResource* myTextures[MAX_MESHES_PER_MODEL][4] = {};
-	Transform myTransform{};
+	std::vector<TextureHandle> myTextureHandles;
+	CachedTransform myTransform{};
+	float myMaxLODPixelError = DEFAULT_LOD_PIXEL_ERROR;
+	int myForcedLOD = -1;
 };
 
 } // namespace Tga
\ No newline at end of file
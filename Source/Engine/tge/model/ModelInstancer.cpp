@@ -1,81 +1,385 @@
 #include "stdafx.h"
 #include "ModelInstancer.h"
 
+#include <algorithm>
+#include <cstring>
+#include <tge/engine.h>
 #include <tge/graphics/DX11.h>
 #include <tge/graphics/GraphicsEngine.h>
 #include <tge/shaders/InstancedModelShader.h>
+#include <tge/texture/texture.h>
+
+namespace
+{
+	// Dirty slots closer than this are uploaded as one range. Re-sending up to 2 KB of unchanged matrices is cheaper
+	// than another buffer write.
+	constexpr uint32_t DIRTY_RANGE_MERGE_GAP = 32;
+	constexpr unsigned int MIN_INSTANCE_BUFFER_CAPACITY = 64;
+}
 
 ID3D11Buffer* Tga::ModelInstancer::GetInstanceBuffer() const
 {
-	return myInstanceBuffer;
+	return myVisibleCount < myBufferNumInstances ? myVisibleBuffer.Get() : myInstanceBuffer.Get();
 }
 
 void Tga::ModelInstancer::Init(std::shared_ptr<Model> aModel)
 {
 	myModel = aModel;
 	myBufferNumInstances = 0;
-	isDirty = false;
 }
 
-bool Tga::ModelInstancer::AddInstance(const Transform& aTransform)
+void Tga::ModelInstancer::Reserve(size_t aCount)
+{
+	myInstances.reserve(aCount);
+	mySlotHandles.reserve(aCount);
+	myHandles.reserve(aCount);
+	mySlotIsDirty.reserve(aCount);
+	myInstanceMatrices.reserve(aCount);
+	myBoundsX.reserve(aCount + 3);
+	myBoundsY.reserve(aCount + 3);
+	myBoundsZ.reserve(aCount + 3);
+	myBoundsRadius.reserve(aCount + 3);
+	myVisibleInstances.reserve(aCount);
+}
+
+Tga::ModelInstanceHandle Tga::ModelInstancer::AddInstance(const Transform& aTransform)
+{
+	const uint32_t slot = static_cast<uint32_t>(myInstances.size());
+
+	uint32_t handleIndex;
+	if (!myFreeHandles.empty())
+	{
+		handleIndex = myFreeHandles.back();
+		myFreeHandles.pop_back();
+	}
+	else
+	{
+		handleIndex = static_cast<uint32_t>(myHandles.size());
+		myHandles.push_back({ 0, 0 });
+	}
+	myHandles[handleIndex].Slot = slot;
+
+	myInstances.push_back(aTransform);
+	mySlotHandles.push_back(handleIndex);
+	mySlotIsDirty.push_back(0);
+	MarkDirty(slot);
+
+	return { handleIndex, myHandles[handleIndex].Generation };
+}
+
+bool Tga::ModelInstancer::RemoveInstance(ModelInstanceHandle aHandle)
 {
-	if(myInstances.size() < MAX_MODEL_INSTANCES)
+	if (!IsValid(aHandle))
 	{
-		isDirty = true;
-		myInstances.push_back(aTransform);
-		return true;
+		return false;
 	}
 
-	return false;
+	const uint32_t slot = myHandles[aHandle.Index].Slot;
+	const uint32_t lastSlot = static_cast<uint32_t>(myInstances.size()) - 1;
+
+	if (slot != lastSlot)
+	{
+		myInstances[slot] = myInstances[lastSlot];
+		mySlotHandles[slot] = mySlotHandles[lastSlot];
+		myHandles[mySlotHandles[slot]].Slot = slot;
+		MarkDirty(slot);
+	}
+
+	myInstances.pop_back();
+	mySlotHandles.pop_back();
+	mySlotIsDirty.pop_back();
+
+	// Bumping the generation makes any copies of the handle invalid.
+	myHandles[aHandle.Index].Generation++;
+	myFreeHandles.push_back(aHandle.Index);
+
+	myIsCulled = false;
+	return true;
+}
+
+bool Tga::ModelInstancer::SetInstanceTransform(ModelInstanceHandle aHandle, const Transform& aTransform)
+{
+	if (!IsValid(aHandle))
+	{
+		return false;
+	}
+
+	const uint32_t slot = myHandles[aHandle.Index].Slot;
+	myInstances[slot] = aTransform;
+	MarkDirty(slot);
+	return true;
+}
+
+const Tga::Transform* Tga::ModelInstancer::GetInstanceTransform(ModelInstanceHandle aHandle) const
+{
+	return IsValid(aHandle) ? &myInstances[myHandles[aHandle.Index].Slot] : nullptr;
+}
+
+bool Tga::ModelInstancer::IsValid(ModelInstanceHandle aHandle) const
+{
+	// Removing an instance bumps the generation, so stale handles never match.
+	return aHandle.Index < myHandles.size() && myHandles[aHandle.Index].Generation == aHandle.Generation;
 }
 
-bool Tga::ModelInstancer::RemoveInstance(unsigned int anIdx)
+void Tga::ModelInstancer::MarkDirty(uint32_t aSlot)
 {
-	if(anIdx < static_cast<unsigned int>(myInstances.size()))
+	if (!mySlotIsDirty[aSlot])
 	{
-		isDirty = true;
-		myInstances.erase(myInstances.begin() + anIdx);
-		return true;
+		mySlotIsDirty[aSlot] = 1;
+		myDirtySlots.push_back(aSlot);
 	}
+	myIsCulled = false;
+}
+
+void Tga::ModelInstancer::UpdateInstance(uint32_t aSlot)
+{
+	const BoxSphereBounds& bounds = myModel->GetBounds();
+	const Transform& transform = myInstances[aSlot];
+
+	myInstanceMatrices[aSlot] = transform.GetMatrix();
 
-	return false;
+	const Vector4f center = Vector4f(bounds.Center, 1.0f) * myInstanceMatrices[aSlot];
+	const Vector3f scale = transform.GetScale();
+	myBoundsX[aSlot] = center.X;
+	myBoundsY[aSlot] = center.Y;
+	myBoundsZ[aSlot] = center.Z;
+	myBoundsRadius[aSlot] = bounds.Radius * FMath::Max(FMath::Abs(scale.X), FMath::Max(FMath::Abs(scale.Y), FMath::Abs(scale.Z)));
 }
 
 void Tga::ModelInstancer::RebuildInstances()
 {
-	if(isDirty)
+	RebuildInstances(myUploadCommands);
+	Engine::GetInstance()->GetGraphicsEngine().Submit(myUploadCommands);
+}
+
+void Tga::ModelInstancer::RebuildInstances(RenderCommandBuffer& aCommands)
+{
+	const size_t instanceCount = myInstances.size();
+	if (myDirtySlots.empty() && instanceCount == myBufferNumInstances)
+	{
+		return;
+	}
+	myIsCulled = false;
+
+	const size_t paddedCount = (instanceCount + 3) & ~static_cast<size_t>(3);
+	myInstanceMatrices.resize(instanceCount);
+	myBoundsX.resize(paddedCount);
+	myBoundsY.resize(paddedCount);
+	myBoundsZ.resize(paddedCount);
+	myBoundsRadius.resize(paddedCount);
+	myVisibleInstances.resize(instanceCount);
+
+	// Removed instances can leave slots past the end in the list, they have nothing to update.
+	myDirtySlots.erase(std::remove_if(myDirtySlots.begin(), myDirtySlots.end(), [instanceCount](uint32_t aSlot) { return aSlot >= instanceCount; }), myDirtySlots.end());
+	for (uint32_t slot : myDirtySlots)
 	{
-		isDirty = false;
+		UpdateInstance(slot);
+		mySlotIsDirty[slot] = 0;
+	}
 
-		D3D11_BUFFER_DESC instanceBufferDesc;
-		instanceBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
-		instanceBufferDesc.ByteWidth = sizeof(InstanceBufferData) * static_cast<UINT>(myInstances.size());
-		instanceBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-		instanceBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-		instanceBufferDesc.MiscFlags = 0;
-		instanceBufferDesc.StructureByteStride = 0;
+	// Padding spheres get a radius no plane can reach, so they are always outside.
+	for (size_t i = instanceCount; i < paddedCount; i++)
+	{
+		myBoundsX[i] = 0.0f;
+		myBoundsY[i] = 0.0f;
+		myBoundsZ[i] = 0.0f;
+		myBoundsRadius[i] = -FLT_MAX;
+	}
 
-		std::vector<Matrix4x4f> instanceMatrices;
-		instanceMatrices.resize(myInstances.size());
-		for(size_t i = 0; i < myInstances.size(); i++)
+	myBufferNumInstances = static_cast<unsigned int>(instanceCount);
+	if (instanceCount > 0)
+	{
+		if (instanceCount > myInstanceBufferCapacity)
 		{
-			instanceMatrices[i] = myInstances[i].GetMatrix();
+			// Grow geometrically so adding instances one at a time doesn't recreate the buffer every frame.
+			unsigned int capacity = FMath::Max(myInstanceBufferCapacity * 2, MIN_INSTANCE_BUFFER_CAPACITY);
+			while (capacity < instanceCount)
+			{
+				capacity *= 2;
+			}
+
+			D3D11_BUFFER_DESC instanceBufferDesc;
+			instanceBufferDesc.Usage = D3D11_USAGE_DEFAULT;
+			instanceBufferDesc.ByteWidth = sizeof(InstanceBufferData) * capacity;
+			instanceBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+			instanceBufferDesc.CPUAccessFlags = 0;
+			instanceBufferDesc.MiscFlags = 0;
+			instanceBufferDesc.StructureByteStride = 0;
+
+			myInstanceBuffer.Reset();
+			const HRESULT result = DX11::Device->CreateBuffer(&instanceBufferDesc, nullptr, myInstanceBuffer.GetAddressOf());
+			assert(!FAILED(result));
+			myInstanceBufferCapacity = FAILED(result) ? 0 : capacity;
+			myNeedsFullUpload = true;
 		}
 
-		D3D11_SUBRESOURCE_DATA instanceData;
-		instanceData.pSysMem = &instanceMatrices[0];
-		instanceData.SysMemPitch = 0;
-		instanceData.SysMemSlicePitch = 0;
+		UploadDirtyRanges(aCommands);
+	}
+
+	myDirtySlots.clear();
+	myNeedsFullUpload = false;
+}
+
+void Tga::ModelInstancer::UploadDirtyRanges(RenderCommandBuffer& aCommands)
+{
+	if (!myInstanceBuffer)
+	{
+		return;
+	}
 
-		const HRESULT result = DX11::Device->CreateBuffer(&instanceBufferDesc, &instanceData, &myInstanceBuffer);
-		assert(!FAILED(result));
+	static_assert(sizeof(InstanceBufferData) == sizeof(Matrix4x4f), "The instance buffer is written straight from the matrices");
+	auto uploadRange = [this, &aCommands](uint32_t aBegin, uint32_t anEnd)
+	{
+		aCommands.WriteBuffer(myInstanceBuffer.Get(), &myInstanceMatrices[aBegin], (anEnd - aBegin) * sizeof(InstanceBufferData), false, aBegin * sizeof(InstanceBufferData));
+	};
 
-		myBufferNumInstances = static_cast<unsigned int>(myInstances.size());
+	if (myNeedsFullUpload)
+	{
+		uploadRange(0, myBufferNumInstances);
+		return;
 	}
+
+	std::sort(myDirtySlots.begin(), myDirtySlots.end());
+
+	size_t i = 0;
+	while (i < myDirtySlots.size())
+	{
+		const uint32_t begin = myDirtySlots[i];
+		uint32_t end = begin + 1;
+		for (i++; i < myDirtySlots.size() && myDirtySlots[i] <= end + DIRTY_RANGE_MERGE_GAP; i++)
+		{
+			end = myDirtySlots[i] + 1;
+		}
+		uploadRange(begin, end);
+	}
+}
+
+size_t Tga::ModelInstancer::CullRange(const Frustum& aFrustum, size_t aBegin, size_t anEnd, uint32_t* outVisible) const
+{
+	assert((aBegin & 3) == 0);
+
+	const BoxSphereBounds& bounds = myModel->GetBounds();
+	size_t visibleCount = 0;
+
+	for (size_t i = aBegin; i < anEnd; i += 4)
+	{
+		int crossingMask;
+		const int visibleMask = aFrustum.IntersectsSpheres4(&myBoundsX[i], &myBoundsY[i], &myBoundsZ[i], &myBoundsRadius[i], crossingMask);
+
+		for (int lane = 0; lane < 4; lane++)
+		{
+			const size_t index = i + lane;
+			if (!((visibleMask >> lane) & 1) || index >= anEnd)
+			{
+				continue;
+			}
+
+			// Spheres fully inside are visible as they are, the box is only tested for the ones on the edge.
+			if ((crossingMask >> lane) & 1)
+			{
+				if (!aFrustum.IntersectsBox(bounds.Center, bounds.BoxExtents, myInstanceMatrices[index]))
+				{
+					continue;
+				}
+			}
+
+			outVisible[visibleCount++] = static_cast<uint32_t>(index);
+		}
+	}
+
+	return visibleCount;
+}
+
+void Tga::ModelInstancer::Cull(const Frustum& aFrustum) const
+{
+	myVisibleCount = static_cast<unsigned int>(CullRange(aFrustum, 0, myBufferNumInstances, myVisibleInstances.data()));
+	myCulledFrustum = aFrustum;
+	myIsCulled = true;
+	myNeedsUpload = true;
+}
+
+void Tga::ModelInstancer::UploadVisibleInstances(RenderCommandBuffer& aCommands) const
+{
+	// With nothing culled the instance buffer is drawn as it is.
+	if (!myNeedsUpload || myVisibleCount == 0 || myVisibleCount == myBufferNumInstances)
+	{
+		return;
+	}
+	myNeedsUpload = false;
+
+	if (myVisibleCount > myVisibleBufferCapacity)
+	{
+		unsigned int capacity = FMath::Max(myVisibleBufferCapacity * 2, MIN_INSTANCE_BUFFER_CAPACITY);
+		while (capacity < myVisibleCount)
+		{
+			capacity *= 2;
+		}
+
+		D3D11_BUFFER_DESC visibleBufferDesc;
+		visibleBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+		visibleBufferDesc.ByteWidth = sizeof(InstanceBufferData) * capacity;
+		visibleBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		visibleBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		visibleBufferDesc.MiscFlags = 0;
+		visibleBufferDesc.StructureByteStride = 0;
+
+		myVisibleBuffer.Reset();
+		const HRESULT result = DX11::Device->CreateBuffer(&visibleBufferDesc, nullptr, myVisibleBuffer.GetAddressOf());
+		if (FAILED(result))
+		{
+			ERROR_PRINT("Failed to create the visible instance buffer: %i", result);
+			myVisibleBufferCapacity = 0;
+			return;
+		}
+		myVisibleBufferCapacity = capacity;
+	}
+
+	InstanceBufferData* instanceData = static_cast<InstanceBufferData*>(aCommands.WriteBuffer(myVisibleBuffer.Get(), sizeof(InstanceBufferData) * myVisibleCount));
+	for (unsigned int i = 0; i < myVisibleCount; i++)
+	{
+		std::memcpy(&instanceData[i].myToWorld, &myInstanceMatrices[myVisibleInstances[i]], sizeof(Matrix4x4f));
+	}
+}
+
+int Tga::ModelInstancer::SelectLOD(int aMeshIndex) const
+{
+	if (myForcedLOD >= 0)
+	{
+		return myForcedLOD;
+	}
+
+	const Model::MeshData& meshData = myModel->GetMeshDataList()[aMeshIndex];
+	if (meshData.LODs.size() < 2)
+	{
+		return 0;
+	}
+
+	const LODView view = LODView::GetActive();
+
+	// Culled instances don't affect the LOD. Instances changed since the last rebuild are judged by their new transform.
+	float largestScreenSize = 0.0f;
+	for (unsigned int i = 0; i < myVisibleCount; i++)
+	{
+		const uint32_t index = myVisibleInstances[i];
+		if (index < myInstances.size())
+		{
+			largestScreenSize = FMath::Max(largestScreenSize, Model::CalculateScreenSize(meshData.Bounds, myInstances[index], view));
+		}
+	}
+
+	return meshData.SelectLOD(largestScreenSize, myMaxLODPixelError);
 }
 
 void Tga::ModelInstancer::Render(InstancedModelShader& aShader) const
 {
+	if (myVisibleCount == 0)
+	{
+		return;
+	}
+	// The uploads go ahead of the draws, which the shader records and submits itself.
+	UploadVisibleInstances(myUploadCommands);
+	Engine::GetInstance()->GetGraphicsEngine().Submit(myUploadCommands);
+
 	const std::vector<Model::MeshData>& meshData = myModel->GetMeshDataList();
 	const size_t meshCount = myModel->GetMeshCount();
 
@@ -85,3 +389,23 @@ void Tga::ModelInstancer::Render(InstancedModelShader& aShader) const
 		aShader.Render(myTextures[j], meshData[j], Identity, *this);
 	}
 }
+
+void Tga::ModelInstancer::SetTexture(int meshIndex, int textureIndex, TextureResource* texture)
+{
+	myTextures[meshIndex][textureIndex] = texture;
+	if (!myTextureHandles.empty())
+	{
+		myTextureHandles[meshIndex * 4 + textureIndex].Reset();
+	}
+}
+
+void Tga::ModelInstancer::SetTexture(int meshIndex, int textureIndex, TextureHandle texture)
+{
+	myTextures[meshIndex][textureIndex] = texture.Get();
+	// Only allocated once a handle is set, textures set by pointer are kept alive by whoever set them.
+	if (myTextureHandles.empty())
+	{
+		myTextureHandles.resize(MAX_MESHES_PER_MODEL * 4);
+	}
+	myTextureHandles[meshIndex * 4 + textureIndex] = std::move(texture);
+}
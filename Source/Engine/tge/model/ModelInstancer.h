@@ -1,19 +1,69 @@
 #pragma once
+#include <tge/EngineDefines.h>
+#include <tge/graphics/Frustum.h>
 #include <tge/math/Transform.h>
 #include <tge/model/Model.h>
+#include <tge/render/RenderCommandBuffer.h>
+#include <tge/texture/TextureHandle.h>
+#include <wrl/client.h>
+
+#include <memory>
+
+using Microsoft::WRL::ComPtr;
 
 namespace Tga
 {
 	class ModelInstance;
+	class InstancedModelShader;
+	class TextureResource;
+
+	/// <summary>
+	/// Refers to one instance in a ModelInstancer. Stays valid while other instances are added and removed.
+	/// </summary>
+	struct ModelInstanceHandle
+	{
+		uint32_t Index = UINT32_MAX;
+		uint32_t Generation = 0;
+
+		bool IsValid() const { return Index != UINT32_MAX; }
+	};
 
+	/// <summary>
+	/// Draws many copies of one model with a single instanced draw call per mesh.
+	/// Instances are kept densely packed, removing one moves the last instance into its slot. Only instances that
+	/// changed since the last RebuildInstances get their matrix recomputed and uploaded.
+	/// </summary>
 	class ModelInstancer
 	{
 		friend class InstancedModelShader;
+		friend class ModelDrawer;
+
+		struct HandleEntry
+		{
+			uint32_t Slot;
+			uint32_t Generation;
+		};
+
+		// Holds every instance in slot order, updated in dirty ranges.
+		ComPtr<ID3D11Buffer> myInstanceBuffer;
+		unsigned int myInstanceBufferCapacity = 0;
+		// Holds only the visible instances, used when culling removed any.
+		mutable ComPtr<ID3D11Buffer> myVisibleBuffer;
+		mutable unsigned int myVisibleBufferCapacity = 0;
 
-		ID3D11Buffer* myInstanceBuffer;
-		std::vector<Transform> myInstances;
 		std::shared_ptr<Model> myModel;
-		unsigned int myBufferNumInstances;
+		unsigned int myBufferNumInstances = 0;
+
+		// Everything below indexed by slot is dense, slot i is instance i in the instance buffer.
+		std::vector<Transform> myInstances;
+		std::vector<uint32_t> mySlotHandles;
+		std::vector<HandleEntry> myHandles;
+		std::vector<uint32_t> myFreeHandles;
+
+		// Slots whose transform changed since the last rebuild.
+		std::vector<uint32_t> myDirtySlots;
+		std::vector<uint8_t> mySlotIsDirty;
+		bool myNeedsFullUpload = false;
 
 		struct InstanceBufferData
 		{
@@ -21,33 +71,117 @@ namespace Tga
 		} myInstanceBufferData;
 
 		const TextureResource* myTextures[MAX_MESHES_PER_MODEL][4] = {};
+		std::vector<TextureHandle> myTextureHandles;
 
 		ID3D11Buffer* GetInstanceBuffer() const;
 
-		bool isDirty;
+		void MarkDirty(uint32_t aSlot);
+		void UpdateInstance(uint32_t aSlot);
+		void UploadDirtyRanges(RenderCommandBuffer& aCommands);
+
+		/**
+		 * Writes the indices of the instances in [aBegin, anEnd) that intersect the frustum to outVisible.
+		 * Only reads data built by RebuildInstances, so it is safe to run on a worker thread.
+		 * @returns The number of indices written.
+		 */
+		size_t CullRange(const Frustum& aFrustum, size_t aBegin, size_t anEnd, uint32_t* outVisible) const;
+		void UploadVisibleInstances(RenderCommandBuffer& aCommands) const;
+
+		// World matrices and bounding spheres of the instances as of the last RebuildInstances. The spheres are stored
+		// as separate arrays padded to a multiple of four, so they can be tested four at a time.
+		std::vector<Matrix4x4f> myInstanceMatrices;
+		std::vector<float> myBoundsX;
+		std::vector<float> myBoundsY;
+		std::vector<float> myBoundsZ;
+		std::vector<float> myBoundsRadius;
+
+		// Result of the last Cull. When some instances were culled the visible buffer holds the rest, in this order.
+		mutable std::vector<uint32_t> myVisibleInstances;
+		mutable unsigned int myVisibleCount = 0;
+		mutable Frustum myCulledFrustum;
+		mutable bool myIsCulled = false;
+		mutable bool myNeedsUpload = false;
+		// Buffer writes recorded by RebuildInstances and Render, kept to reuse the allocations.
+		mutable RenderCommandBuffer myUploadCommands;
+
+		float myMaxLODPixelError = DEFAULT_LOD_PIXEL_ERROR;
+		int myForcedLOD = -1;
 		
 	public:
 
 		void Init(std::shared_ptr<Model> aModel);
 
+		/**
+		 * Makes room for at least aCount instances without reallocating.
+		 */
+		void Reserve(size_t aCount);
+
 		/**
 		 * Adds an instance with the specified transform.
 		 * @param aTransform The transform of the new instance.
-		 * @returns True if the instance could be added.
+		 * @returns A handle that stays valid until the instance is removed.
 		 */
-		bool AddInstance(const Transform& aTransform);
+		ModelInstanceHandle AddInstance(const Transform& aTransform);
 
 		/**
-		 * Removes the instance at the specified index.
-		 * @param anIdx The index to remove at.
-		 * @returns True if the instance was successfully removed.
+		 * Removes an instance. The last instance is moved into its slot, so this is O(1).
+		 * @returns True if the handle referred to a live instance.
 		 */
-		bool RemoveInstance(unsigned int anIdx);
+		bool RemoveInstance(ModelInstanceHandle aHandle);
 
+		/**
+		 * Moves an instance. Only instances changed this way are recomputed by RebuildInstances.
+		 * @returns True if the handle referred to a live instance.
+		 */
+		bool SetInstanceTransform(ModelInstanceHandle aHandle, const Transform& aTransform);
+
+		/**
+		 * @returns nullptr if the handle doesn't refer to a live instance.
+		 */
+		const Transform* GetInstanceTransform(ModelInstanceHandle aHandle) const;
+		bool IsValid(ModelInstanceHandle aHandle) const;
+
+		/**
+		 * Recomputes the matrices and bounds of the instances that changed and uploads them through the graphics
+		 * engine's render backend, growing the instance buffer if needed. Must be called on the render thread, changes
+		 * aren't visible until it has been.
+		 */
 		void RebuildInstances();
 
+		/**
+		 * Same as RebuildInstances, but only records the uploads into aCommands. They must be executed before the
+		 * instancer is drawn or rebuilt again, since a rebuild that grows the instance buffer releases the old one.
+		 */
+		void RebuildInstances(RenderCommandBuffer& aCommands);
+
+		unsigned int GetInstanceCount() const { return myBufferNumInstances; }
+
+		/**
+		 * Culls every instance against aFrustum, testing bounding spheres four at a time and then the bounding box of
+		 * any sphere that crosses a plane. The result is kept until the next rebuild or the next Cull.
+		 */
+		void Cull(const Frustum& aFrustum) const;
+		bool IsCulledWith(const Frustum& aFrustum) const { return myIsCulled && myCulledFrustum == aFrustum; }
+		unsigned int GetVisibleCount() const { return myVisibleCount; }
+
 		const TextureResource* const* GetTextures(int meshIndex) const { return myTextures[meshIndex]; }
-		void SetTexture(int meshIndex, int textureIndex, TextureResource* texture) { myTextures[meshIndex][textureIndex] = texture; }
+		void SetTexture(int meshIndex, int textureIndex, TextureResource* texture);
+		/**
+		 * Same as above but keeps the handle, so the texture stays loaded for as long as this instance uses it.
+		 */
+		void SetTexture(int meshIndex, int textureIndex, TextureHandle texture);
+
+		/**
+		 * All instances are drawn with the same LOD, picked from the visible instance closest to the camera.
+		 */
+		void SetMaxLODPixelError(float aPixelError) { myMaxLODPixelError = aPixelError; }
+		float GetMaxLODPixelError() const { return myMaxLODPixelError; }
+
+		/**
+		 * Forces a LOD for every mesh, -1 goes back to picking one from the projected size.
+		 */
+		void SetForcedLOD(int aLOD) { myForcedLOD = aLOD; }
+		int SelectLOD(int aMeshIndex) const;
 
 		void Render(InstancedModelShader& aShader) const;
 	};
@@ -0,0 +1,319 @@
+#include "stdafx.h"
+#include "ParticleEmitter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <new>
+#include <emmintrin.h>
+
+#include <tge/engine.h>
+#include <tge/drawers/SpriteDrawer.h>
+#include <tge/drawers/SpritePacking.h>
+#include <tge/graphics/GraphicsEngine.h>
+#include <tge/graphics/GraphicsStateStack.h>
+
+using namespace Tga;
+
+namespace
+{
+	constexpr std::align_val_t StreamAlignment = std::align_val_t(16);
+
+	__m128 EvaluateCurve(const ParticleCurve& aCurve, __m128 aTime)
+	{
+		// A piecewise linear curve is its first value plus one clamped ramp per segment.
+		__m128 result = _mm_set1_ps(aCurve.Values[0]);
+		for (int k = 1; k < aCurve.KeyCount; k++)
+		{
+			const float segmentLength = aCurve.Times[k] - aCurve.Times[k - 1];
+			const __m128 delta = _mm_set1_ps(aCurve.Values[k] - aCurve.Values[k - 1]);
+
+			__m128 ramp;
+			if (segmentLength <= 0.0f)
+			{
+				ramp = _mm_and_ps(_mm_cmpge_ps(aTime, _mm_set1_ps(aCurve.Times[k])), _mm_set1_ps(1.0f));
+			}
+			else
+			{
+				ramp = _mm_mul_ps(_mm_sub_ps(aTime, _mm_set1_ps(aCurve.Times[k - 1])), _mm_set1_ps(1.0f / segmentLength));
+				ramp = _mm_min_ps(_mm_max_ps(ramp, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+			}
+
+			result = _mm_add_ps(result, _mm_mul_ps(delta, ramp));
+		}
+		return result;
+	}
+}
+
+ParticleCurve ParticleCurve::Constant(float aValue)
+{
+	return Linear(aValue, aValue);
+}
+
+ParticleCurve ParticleCurve::Linear(float aStart, float anEnd)
+{
+	ParticleCurve curve;
+	curve.Values[0] = aStart;
+	curve.Values[1] = anEnd;
+	return curve;
+}
+
+bool ParticleCurve::AddKey(float aTime, float aValue)
+{
+	if (KeyCount >= MaxKeys)
+		return false;
+
+	Times[KeyCount] = aTime;
+	Values[KeyCount] = aValue;
+	KeyCount++;
+	return true;
+}
+
+float ParticleCurve::Evaluate(float aTime) const
+{
+	alignas(16) float result[4];
+	_mm_store_ps(result, EvaluateCurve(*this, _mm_set1_ps(aTime)));
+	return result[0];
+}
+
+ParticleEmitter::~ParticleEmitter()
+{
+	if (myStorage)
+	{
+		::operator delete(myStorage, StreamAlignment);
+	}
+}
+
+void ParticleEmitter::Init(const ParticleEmitterSettings& someSettings, const SpriteSharedData& aSharedData)
+{
+	mySettings = someSettings;
+	mySharedData = aSharedData;
+
+	if (myStorage)
+	{
+		::operator delete(myStorage, StreamAlignment);
+		myStorage = nullptr;
+	}
+
+	// Round up so the kernels can always work on whole groups of four.
+	myCapacity = (mySettings.MaxParticles + 3) & ~static_cast<size_t>(3);
+	myCount = 0;
+	mySpawnAccumulator = 0.0f;
+
+	const size_t bytes = sizeof(float) * myCapacity * StreamCount;
+	if (bytes > 0)
+	{
+		myStorage = static_cast<float*>(::operator new(bytes, StreamAlignment));
+		std::memset(myStorage, 0, bytes);
+	}
+
+	for (int i = 0; i < StreamCount; i++)
+	{
+		myStreams[i] = myStorage ? myStorage + myCapacity * i : nullptr;
+	}
+
+	myLinearStartColor[0] = Color::InverseEOTF(mySettings.StartColor.myR);
+	myLinearStartColor[1] = Color::InverseEOTF(mySettings.StartColor.myG);
+	myLinearStartColor[2] = Color::InverseEOTF(mySettings.StartColor.myB);
+	myLinearStartColor[3] = mySettings.StartColor.myA;
+	myLinearEndColor[0] = Color::InverseEOTF(mySettings.EndColor.myR);
+	myLinearEndColor[1] = Color::InverseEOTF(mySettings.EndColor.myG);
+	myLinearEndColor[2] = Color::InverseEOTF(mySettings.EndColor.myB);
+	myLinearEndColor[3] = mySettings.EndColor.myA;
+}
+
+void ParticleEmitter::Burst(size_t aCount)
+{
+	Spawn(aCount);
+}
+
+float ParticleEmitter::Random()
+{
+	// xorshift32, plenty for particle variation.
+	myRandomState ^= myRandomState << 13;
+	myRandomState ^= myRandomState >> 17;
+	myRandomState ^= myRandomState << 5;
+	return static_cast<float>(myRandomState >> 8) * (1.0f / 16777216.0f);
+}
+
+void ParticleEmitter::Spawn(size_t aCount)
+{
+	const size_t count = std::min(aCount, myCapacity - myCount);
+	const float twoPi = 6.2831853f;
+
+	for (size_t n = 0; n < count; n++)
+	{
+		const size_t i = myCount++;
+
+		float x = myPosition.x;
+		float y = myPosition.y;
+		if (mySettings.SpawnRadius > 0.0f)
+		{
+			const float radius = mySettings.SpawnRadius * std::sqrt(Random());
+			const float angle = Random() * twoPi;
+			x += std::cos(angle) * radius;
+			y += std::sin(angle) * radius;
+		}
+
+		const float direction = mySettings.Direction + Random(-mySettings.Spread, mySettings.Spread);
+		const float speed = Random(mySettings.SpeedMin, mySettings.SpeedMax);
+		const float lifetime = std::max(Random(mySettings.LifetimeMin, mySettings.LifetimeMax), 0.0001f);
+
+		myStreams[PositionX][i] = x;
+		myStreams[PositionY][i] = y;
+		myStreams[VelocityX][i] = std::cos(direction) * speed;
+		myStreams[VelocityY][i] = std::sin(direction) * speed;
+		myStreams[Age][i] = 0.0f;
+		myStreams[AgeRate][i] = 1.0f / lifetime;
+		myStreams[Rotation][i] = Random() * twoPi;
+		myStreams[RotationSpeed][i] = Random(mySettings.RotationSpeedMin, mySettings.RotationSpeedMax);
+	}
+}
+
+void ParticleEmitter::Update(float aDeltaTime)
+{
+	if (myStorage == nullptr)
+		return;
+
+	Integrate(aDeltaTime);
+	RemoveDead();
+
+	if (myIsEmitting)
+	{
+		mySpawnAccumulator += mySettings.SpawnRate * aDeltaTime;
+		const float whole = std::floor(mySpawnAccumulator);
+		mySpawnAccumulator -= whole;
+		Spawn(static_cast<size_t>(whole));
+	}
+}
+
+void ParticleEmitter::Integrate(float aDeltaTime)
+{
+	const __m128 dt = _mm_set1_ps(aDeltaTime);
+	const __m128 gravityX = _mm_set1_ps(mySettings.Gravity.x * aDeltaTime);
+	const __m128 gravityY = _mm_set1_ps(mySettings.Gravity.y * aDeltaTime);
+	const __m128 drag = _mm_set1_ps(std::max(0.0f, 1.0f - mySettings.Drag * aDeltaTime));
+
+	float* positionX = myStreams[PositionX];
+	float* positionY = myStreams[PositionY];
+	float* velocityX = myStreams[VelocityX];
+	float* velocityY = myStreams[VelocityY];
+	float* age = myStreams[Age];
+	const float* ageRate = myStreams[AgeRate];
+	float* rotation = myStreams[Rotation];
+	const float* rotationSpeed = myStreams[RotationSpeed];
+
+	// The padding after myCount is part of the allocation, so whole groups are always safe.
+	for (size_t i = 0; i < myCount; i += 4)
+	{
+		const __m128 vx = _mm_mul_ps(_mm_add_ps(_mm_load_ps(velocityX + i), gravityX), drag);
+		const __m128 vy = _mm_mul_ps(_mm_add_ps(_mm_load_ps(velocityY + i), gravityY), drag);
+		_mm_store_ps(velocityX + i, vx);
+		_mm_store_ps(velocityY + i, vy);
+
+		_mm_store_ps(positionX + i, _mm_add_ps(_mm_load_ps(positionX + i), _mm_mul_ps(vx, dt)));
+		_mm_store_ps(positionY + i, _mm_add_ps(_mm_load_ps(positionY + i), _mm_mul_ps(vy, dt)));
+		_mm_store_ps(age + i, _mm_add_ps(_mm_load_ps(age + i), _mm_mul_ps(_mm_load_ps(ageRate + i), dt)));
+		_mm_store_ps(rotation + i, _mm_add_ps(_mm_load_ps(rotation + i), _mm_mul_ps(_mm_load_ps(rotationSpeed + i), dt)));
+	}
+}
+
+void ParticleEmitter::RemoveDead()
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const float* age = myStreams[Age];
+
+	size_t i = 0;
+	while (i < myCount)
+	{
+		// Skip four live particles at a time, which is the common case.
+		if (i + 4 <= myCount && _mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(age + i), one)) == 0)
+		{
+			i += 4;
+			continue;
+		}
+
+		if (age[i] < 1.0f)
+		{
+			i++;
+			continue;
+		}
+
+		// Move the last particle into the dead slot and check the same slot again.
+		myCount--;
+		for (int stream = PositionX; stream <= RotationSpeed; stream++)
+		{
+			myStreams[stream][i] = myStreams[stream][myCount];
+		}
+	}
+}
+
+void ParticleEmitter::EvaluateCurves()
+{
+	const float* age = myStreams[Age];
+	float* size = myStreams[Size];
+	float* colors[4] = { myStreams[ColorR], myStreams[ColorG], myStreams[ColorB], myStreams[ColorA] };
+
+	__m128 start[4];
+	__m128 range[4];
+	for (int c = 0; c < 4; c++)
+	{
+		start[c] = _mm_set1_ps(myLinearStartColor[c]);
+		range[c] = _mm_set1_ps(myLinearEndColor[c] - myLinearStartColor[c]);
+	}
+
+	for (size_t i = 0; i < myCount; i += 4)
+	{
+		const __m128 t = _mm_min_ps(_mm_max_ps(_mm_load_ps(age + i), _mm_setzero_ps()), _mm_set1_ps(1.0f));
+
+		_mm_store_ps(size + i, EvaluateCurve(mySettings.Size, t));
+
+		for (int c = 0; c < 3; c++)
+		{
+			_mm_store_ps(colors[c] + i, _mm_add_ps(start[c], _mm_mul_ps(range[c], t)));
+		}
+
+		const __m128 alpha = _mm_add_ps(start[3], _mm_mul_ps(range[3], t));
+		_mm_store_ps(colors[3] + i, _mm_mul_ps(alpha, EvaluateCurve(mySettings.Alpha, t)));
+	}
+}
+
+void ParticleEmitter::Render(SpriteDrawer& aSpriteDrawer)
+{
+	if (myCount == 0)
+		return;
+
+	EvaluateCurves();
+
+	const bool rotates = mySettings.RotationSpeedMin != 0.0f || mySettings.RotationSpeedMax != 0.0f;
+	const Matrix4x4f& transform = Engine::GetInstance()->GetGraphicsEngine().GetGraphicsStateStack().GetTransform();
+
+	SpriteBatchScope scope = aSpriteDrawer.BeginBatch(mySharedData);
+
+	size_t offset = 0;
+	while (offset < myCount)
+	{
+		size_t reserved = 0;
+		SpriteShaderInstanceData* instances = scope.Reserve(myCount - offset, reserved);
+		if (instances == nullptr || reserved == 0)
+			break;
+
+		// The scope is fresh, so every reservation but the last is a whole batch and the offset stays aligned.
+		assert((offset & 3) == 0);
+
+		Sprite2DSoAData sprites;
+		sprites.PositionX = myStreams[PositionX] + offset;
+		sprites.PositionY = myStreams[PositionY] + offset;
+		sprites.SizeX = myStreams[Size] + offset;
+		sprites.SizeY = myStreams[Size] + offset;
+		sprites.Rotation = rotates ? myStreams[Rotation] + offset : nullptr;
+		sprites.ColorR = myStreams[ColorR] + offset;
+		sprites.ColorG = myStreams[ColorG] + offset;
+		sprites.ColorB = myStreams[ColorB] + offset;
+		sprites.ColorA = myStreams[ColorA] + offset;
+
+		SpritePacking::Pack2DSoA(sprites, reserved, transform, instances);
+		scope.Commit(reserved);
+		offset += reserved;
+	}
+}
@@ -0,0 +1,162 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <tge/math/color.h>
+#include <tge/math/vector2.h>
+#include <tge/sprite/sprite.h>
+
+namespace Tga
+{
+	class SpriteDrawer;
+
+	/// <summary>
+	/// Piecewise linear curve over a particle's normalized age (0 at spawn, 1 at death).
+	/// Keys must be added in increasing time order.
+	/// </summary>
+	struct ParticleCurve
+	{
+		static constexpr int MaxKeys = 4;
+
+		float Times[MaxKeys] = { 0.0f, 1.0f, 1.0f, 1.0f };
+		float Values[MaxKeys] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		int KeyCount = 2;
+
+		static ParticleCurve Constant(float aValue);
+		static ParticleCurve Linear(float aStart, float anEnd);
+
+		/**
+		 * @returns False if the curve already has MaxKeys keys.
+		 */
+		bool AddKey(float aTime, float aValue);
+		float Evaluate(float aTime) const;
+	};
+
+	struct ParticleEmitterSettings
+	{
+		// Particles per second while the emitter is running.
+		float SpawnRate = 50.0f;
+		size_t MaxParticles = 10000;
+
+		float LifetimeMin = 1.0f;
+		float LifetimeMax = 2.0f;
+
+		// Initial velocity. Direction is in radians, Spread is the half angle around it.
+		float SpeedMin = 50.0f;
+		float SpeedMax = 100.0f;
+		float Direction = 1.5707963f;
+		float Spread = 3.1415926f;
+
+		// Particles spawn uniformly inside a circle with this radius around the emitter.
+		float SpawnRadius = 0.0f;
+
+		Vector2f Gravity = { 0.0f, 0.0f };
+		// Fraction of the velocity lost per second.
+		float Drag = 0.0f;
+
+		float RotationSpeedMin = 0.0f;
+		float RotationSpeedMax = 0.0f;
+
+		// Size in pixels and opacity over the particle's life.
+		ParticleCurve Size = ParticleCurve::Linear(16.0f, 0.0f);
+		ParticleCurve Alpha = ParticleCurve::Linear(1.0f, 0.0f);
+
+		Color StartColor = { 1.0f, 1.0f, 1.0f, 1.0f };
+		Color EndColor = { 1.0f, 1.0f, 1.0f, 1.0f };
+	};
+
+	/// <summary>
+	/// CPU particle emitter with structure-of-arrays storage.
+	/// Every particle stream is its own 16 byte aligned array, so the update and render kernels run four particles at a
+	/// time. Dead particles are removed by moving the last particle into their slot, so nothing is allocated after Init.
+	/// </summary>
+	class ParticleEmitter
+	{
+	public:
+		ParticleEmitter() = default;
+		~ParticleEmitter();
+
+		ParticleEmitter(const ParticleEmitter&) = delete;
+		ParticleEmitter& operator=(const ParticleEmitter&) = delete;
+
+		void Init(const ParticleEmitterSettings& someSettings, const SpriteSharedData& aSharedData);
+
+		void SetPosition(const Vector2f& aPosition) { myPosition = aPosition; }
+		const Vector2f& GetPosition() const { return myPosition; }
+
+		const ParticleEmitterSettings& GetSettings() const { return mySettings; }
+
+		/**
+		 * Starts or stops continuous spawning. Particles that are already alive live out their lifetime.
+		 */
+		void Start() { myIsEmitting = true; }
+		void Stop() { myIsEmitting = false; }
+		bool IsEmitting() const { return myIsEmitting; }
+
+		/**
+		 * Spawns up to aCount particles right away, whether the emitter is running or not.
+		 */
+		void Burst(size_t aCount);
+
+		/**
+		 * Kills every particle.
+		 */
+		void Clear() { myCount = 0; }
+
+		void Update(float aDeltaTime);
+
+		/**
+		 * Writes all live particles straight into the sprite drawer's instance buffer.
+		 */
+		void Render(SpriteDrawer& aSpriteDrawer);
+
+		size_t GetParticleCount() const { return myCount; }
+		bool IsAlive() const { return myIsEmitting || myCount > 0; }
+
+	private:
+		enum Stream
+		{
+			PositionX,
+			PositionY,
+			VelocityX,
+			VelocityY,
+			// Normalized age, 0 at spawn, the particle dies at 1.
+			Age,
+			// 1 / lifetime, added to Age every second.
+			AgeRate,
+			Rotation,
+			RotationSpeed,
+			// Evaluated from the curves right before rendering.
+			Size,
+			ColorR,
+			ColorG,
+			ColorB,
+			ColorA,
+			StreamCount
+		};
+
+		void Spawn(size_t aCount);
+		void Integrate(float aDeltaTime);
+		void RemoveDead();
+		void EvaluateCurves();
+		float Random();
+		float Random(float aMin, float aMax) { return aMin + (aMax - aMin) * Random(); }
+
+		ParticleEmitterSettings mySettings;
+		SpriteSharedData mySharedData;
+		Vector2f myPosition = { 0.0f, 0.0f };
+
+		// One allocation, split into StreamCount arrays of myCapacity floats each.
+		float* myStorage = nullptr;
+		float* myStreams[StreamCount] = {};
+		size_t myCapacity = 0;
+		size_t myCount = 0;
+
+		// Start and end color converted to linear once, the render kernel interpolates in linear space.
+		float myLinearStartColor[4] = {};
+		float myLinearEndColor[4] = {};
+
+		float mySpawnAccumulator = 0.0f;
+		uint32_t myRandomState = 0x9e3779b9u;
+		bool myIsEmitting = false;
+	};
+}
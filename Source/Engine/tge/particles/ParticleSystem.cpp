@@ -0,0 +1,103 @@
+#include "stdafx.h"
+#include "ParticleSystem.h"
+
+using namespace Tga;
+
+int ParticleSystem::CreateEmitter(const ParticleEmitterSettings& someSettings, const SpriteSharedData& aSharedData, const Vector2f& aPosition)
+{
+	Entry entry;
+	entry.Emitter = std::make_unique<ParticleEmitter>();
+	entry.Emitter->Init(someSettings, aSharedData);
+	entry.Emitter->SetPosition(aPosition);
+	if (someSettings.SpawnRate > 0.0f)
+	{
+		entry.Emitter->Start();
+	}
+
+	const int id = myNextID++;
+	myEmitters.emplace(id, std::move(entry));
+	return id;
+}
+
+ParticleEmitter* ParticleSystem::GetEmitter(int anID)
+{
+	auto it = myEmitters.find(anID);
+	return it != myEmitters.end() ? it->second.Emitter.get() : nullptr;
+}
+
+bool ParticleSystem::Burst(int anID, size_t aCount)
+{
+	ParticleEmitter* emitter = GetEmitter(anID);
+	if (emitter == nullptr)
+		return false;
+
+	emitter->Burst(aCount);
+	return true;
+}
+
+bool ParticleSystem::SetPosition(int anID, const Vector2f& aPosition)
+{
+	ParticleEmitter* emitter = GetEmitter(anID);
+	if (emitter == nullptr)
+		return false;
+
+	emitter->SetPosition(aPosition);
+	return true;
+}
+
+bool ParticleSystem::Stop(int anID)
+{
+	auto it = myEmitters.find(anID);
+	if (it == myEmitters.end())
+		return false;
+
+	it->second.Emitter->Stop();
+	it->second.IsReleased = true;
+	return true;
+}
+
+void ParticleSystem::DestroyEmitter(int anID)
+{
+	myEmitters.erase(anID);
+}
+
+void ParticleSystem::Clear()
+{
+	myEmitters.clear();
+}
+
+void ParticleSystem::Update(float aDeltaTime)
+{
+	for (auto it = myEmitters.begin(); it != myEmitters.end();)
+	{
+		Entry& entry = it->second;
+		entry.Emitter->Update(aDeltaTime);
+
+		if (entry.IsReleased && !entry.Emitter->IsAlive())
+		{
+			it = myEmitters.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+void ParticleSystem::Render(SpriteDrawer& aSpriteDrawer)
+{
+	for (auto& [id, entry] : myEmitters)
+	{
+		entry.Emitter->Render(aSpriteDrawer);
+	}
+}
+
+size_t ParticleSystem::GetParticleCount() const
+{
+	size_t count = 0;
+	for (const auto& [id, entry] : myEmitters)
+	{
+		count += entry.Emitter->GetParticleCount();
+	}
+	return count;
+}
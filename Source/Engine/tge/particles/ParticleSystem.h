@@ -0,0 +1,58 @@
+#pragma once
+#include <memory>
+#include <map>
+#include <tge/particles/ParticleEmitter.h>
+
+namespace Tga
+{
+	/// <summary>
+	/// Owns a set of particle emitters and hands out integer IDs for them, so they can be driven from places that cannot
+	/// hold pointers, like script graphs.
+	/// An emitter that has been stopped is destroyed once its last particle has died.
+	/// </summary>
+	class ParticleSystem
+	{
+	public:
+		/**
+		 * Creates an emitter at aPosition. It starts spawning right away unless SpawnRate is 0.
+		 * @returns The ID of the new emitter.
+		 */
+		int CreateEmitter(const ParticleEmitterSettings& someSettings, const SpriteSharedData& aSharedData, const Vector2f& aPosition);
+
+		/**
+		 * @returns nullptr if there is no emitter with that ID, either because it never existed or it has finished.
+		 */
+		ParticleEmitter* GetEmitter(int anID);
+
+		bool Burst(int anID, size_t aCount);
+		bool SetPosition(int anID, const Vector2f& aPosition);
+
+		/**
+		 * Stops spawning. The emitter is removed once its remaining particles have died.
+		 */
+		bool Stop(int anID);
+
+		/**
+		 * Removes the emitter and its particles immediately.
+		 */
+		void DestroyEmitter(int anID);
+		void Clear();
+
+		void Update(float aDeltaTime);
+		void Render(SpriteDrawer& aSpriteDrawer);
+
+		size_t GetEmitterCount() const { return myEmitters.size(); }
+		size_t GetParticleCount() const;
+
+	private:
+		struct Entry
+		{
+			std::unique_ptr<ParticleEmitter> Emitter;
+			bool IsReleased = false;
+		};
+
+		// Ordered so emitters draw in the order they were created.
+		std::map<int, Entry> myEmitters;
+		int myNextID = 1;
+	};
+}
@@ -0,0 +1,45 @@
+#include "stdafx.h"
+#include "ParallelRenderRecorder.h"
+
+#include <tge/util/ThreadPool.h>
+
+using namespace Tga;
+
+void ParallelRenderRecorder::Record(size_t aSliceCount, const RecordFunction& aRecord)
+{
+	const size_t firstSlice = mySliceCount;
+	mySliceCount += aSliceCount;
+	while (mySlices.size() < mySliceCount)
+	{
+		mySlices.push_back(std::make_unique<RenderCommandBuffer>());
+	}
+
+	myThreads.ParallelFor(aSliceCount, [&](size_t aSlice)
+	{
+		RenderCommandBuffer& commands = *mySlices[firstSlice + aSlice];
+		commands.Clear();
+		aRecord(aSlice, commands);
+	});
+}
+
+const RenderCommandBuffer& ParallelRenderRecorder::Merge()
+{
+	mySlicePointers.clear();
+	for (size_t i = 0; i < mySliceCount; i++)
+	{
+		mySlicePointers.push_back(mySlices[i].get());
+	}
+
+	myMerged.Clear();
+	myMerger.Merge(mySlicePointers.data(), mySlicePointers.size(), myMerged);
+	return myMerged;
+}
+
+void ParallelRenderRecorder::Clear()
+{
+	for (size_t i = 0; i < mySliceCount; i++)
+	{
+		mySlices[i]->Clear();
+	}
+	mySliceCount = 0;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <tge/render/RenderCommandBuffer.h>
+#include <tge/render/RenderCommandMerger.h>
+
+namespace Tga
+{
+	class ThreadPool;
+
+	/// <summary>
+	/// Records render commands for independent slices of a scene on worker threads and merges them by sort key.
+	/// Every slice records into its own command buffer, picked by slice index rather than by thread, so the merged
+	/// stream is the same no matter how the slices were scheduled.
+	/// Recording only fills command buffers, it must not touch the device or the graphics state stack. Submit the merged
+	/// result on the main thread.
+	/// </summary>
+	class ParallelRenderRecorder
+	{
+	public:
+		using RecordFunction = std::function<void(size_t aSlice, RenderCommandBuffer& aCommands)>;
+
+		/**
+		 * @param aThreads Pool the slices are recorded on, shared with whatever else the owner uses it for. The calling
+		 * thread records too, so a pool that isn't running just records everything on the calling thread.
+		 */
+		explicit ParallelRenderRecorder(ThreadPool& aThreads)
+			: myThreads(aThreads) {}
+
+		/**
+		 * Calls aRecord once for every slice in [0, aSliceCount), spread over the workers and the calling thread, and
+		 * returns when all of them are done. Slices recorded by earlier calls since the last Clear are kept.
+		 */
+		void Record(size_t aSliceCount, const RecordFunction& aRecord);
+
+		/**
+		 * Merges every recorded slice into one buffer. Valid until the next Record or Clear.
+		 */
+		const RenderCommandBuffer& Merge();
+
+		/**
+		 * Forgets all recorded slices. The command buffers are kept for reuse.
+		 */
+		void Clear();
+
+		size_t GetSliceCount() const { return mySliceCount; }
+		const RenderCommandBuffer& GetSlice(size_t aSlice) const { return *mySlices[aSlice]; }
+
+	private:
+		ThreadPool& myThreads;
+		RenderCommandMerger myMerger;
+		// unique_ptr so the buffers don't move when more slices are added.
+		std::vector<std::unique_ptr<RenderCommandBuffer>> mySlices;
+		std::vector<const RenderCommandBuffer*> mySlicePointers;
+		RenderCommandBuffer myMerged;
+		size_t mySliceCount = 0;
+	};
+}
@@ -0,0 +1,317 @@
+#include "stdafx.h"
+#include "RecordingRenderBackend.h"
+
+#include <cassert>
+#include <cstring>
+
+using namespace Tga;
+
+namespace
+{
+	constexpr uint64_t FnvOffsetBasis = 14695981039346656037ull;
+	constexpr uint64_t FnvPrime = 1099511628211ull;
+
+	// Never a valid resource, so the first bind of every slot counts as a change.
+	const void* const UnknownResource = reinterpret_cast<const void*>(~uintptr_t(0));
+	constexpr uint32_t UnknownValue = ~0u;
+}
+
+RecordingRenderBackend::RecordingRenderBackend(RenderBackend* aForwardBackend)
+	: myForwardBackend(aForwardBackend)
+{
+	BeginFrame();
+}
+
+void RecordingRenderBackend::BeginFrame()
+{
+	myStatistics = RenderCommandStatistics();
+	myHash = FnvOffsetBasis;
+	myResourceIds.clear();
+
+	myVertexShader = UnknownResource;
+	myPixelShader = UnknownResource;
+	myInputLayout = UnknownResource;
+	myTopology = UnknownValue;
+	for (VertexBufferBinding& binding : myVertexBuffers)
+	{
+		binding = { UnknownResource, UnknownValue, UnknownValue };
+	}
+	myIndexBuffer = UnknownResource;
+	myIndexBufferOffset = UnknownValue;
+	myIndexFormat = UnknownValue;
+	for (auto& stage : myConstantBuffers)
+	{
+		for (const void*& buffer : stage)
+		{
+			buffer = UnknownResource;
+		}
+	}
+	for (const void*& view : myShaderResources)
+	{
+		view = UnknownResource;
+	}
+	myBlendState = UnknownResource;
+	myDepthStencilState = UnknownResource;
+	myRasterizerState = UnknownResource;
+	for (const void*& sampler : mySamplers)
+	{
+		sampler = UnknownResource;
+	}
+}
+
+void RecordingRenderBackend::Execute(const RenderCommandBuffer& aCommands)
+{
+	myStatistics.SubmitCount++;
+
+	const RenderCommand* commands = aCommands.GetCommands();
+	const size_t count = aCommands.GetCommandCount();
+	for (size_t i = 0; i < count; i++)
+	{
+		ExecuteCommand(commands[i], aCommands);
+	}
+
+	if (myForwardBackend)
+	{
+		myForwardBackend->Execute(aCommands);
+	}
+}
+
+void RecordingRenderBackend::ExecuteCommand(const RenderCommand& aCommand, const RenderCommandBuffer& aCommands)
+{
+	myStatistics.CommandCount++;
+	myStatistics.CommandCounts[(int)aCommand.Type]++;
+	Hash(static_cast<uint32_t>(aCommand.Type));
+	const size_t redundantStateChanges = myStatistics.RedundantStateChanges;
+
+	switch (aCommand.Type)
+	{
+	case RenderCommandType::SetShaders:
+	{
+		const RenderCommand::ShadersData& data = aCommand.Shaders;
+		CountStateChange(data.VertexShader != myVertexShader || data.PixelShader != myPixelShader);
+		myVertexShader = data.VertexShader;
+		myPixelShader = data.PixelShader;
+		HashResource(data.VertexShader);
+		HashResource(data.PixelShader);
+		break;
+	}
+	case RenderCommandType::SetInputLayout:
+	{
+		CountStateChange(aCommand.InputLayout.Layout != myInputLayout);
+		myInputLayout = aCommand.InputLayout.Layout;
+		HashResource(aCommand.InputLayout.Layout);
+		break;
+	}
+	case RenderCommandType::SetTopology:
+	{
+		const uint32_t topology = static_cast<uint32_t>(aCommand.Topology.Topology);
+		CountStateChange(topology != myTopology);
+		myTopology = topology;
+		Hash(topology);
+		break;
+	}
+	case RenderCommandType::SetVertexBuffers:
+	{
+		const RenderCommand::VertexBuffersData& data = aCommand.VertexBuffers;
+		bool changed = false;
+		Hash(data.StartSlot);
+		Hash(data.Count);
+		for (uint32_t i = 0; i < data.Count; i++)
+		{
+			const uint32_t slot = data.StartSlot + i;
+			assert(slot < RenderCommand::MaxVertexBuffers);
+			VertexBufferBinding& binding = myVertexBuffers[slot];
+			changed |= binding.Buffer != data.Buffers[i] || binding.Stride != data.Strides[i] || binding.Offset != data.Offsets[i];
+			binding = { data.Buffers[i], data.Strides[i], data.Offsets[i] };
+
+			HashResource(data.Buffers[i]);
+			Hash(data.Strides[i]);
+			Hash(data.Offsets[i]);
+		}
+		CountStateChange(changed);
+		break;
+	}
+	case RenderCommandType::SetIndexBuffer:
+	{
+		const RenderCommand::IndexBufferData& data = aCommand.IndexBuffer;
+		const uint32_t format = static_cast<uint32_t>(data.Format);
+		CountStateChange(data.Buffer != myIndexBuffer || data.Offset != myIndexBufferOffset || format != myIndexFormat);
+		myIndexBuffer = data.Buffer;
+		myIndexBufferOffset = data.Offset;
+		myIndexFormat = format;
+		HashResource(data.Buffer);
+		Hash(data.Offset);
+		Hash(format);
+		break;
+	}
+	case RenderCommandType::SetConstantBuffer:
+	{
+		const RenderCommand::ConstantBufferData& data = aCommand.ConstantBuffer;
+		assert(data.Slot < MaxConstantBufferSlots);
+		bool changed = false;
+		for (int stage = 0; stage < 2; stage++)
+		{
+			if (data.Stages & (1 << stage))
+			{
+				changed |= myConstantBuffers[stage][data.Slot] != data.Buffer;
+				myConstantBuffers[stage][data.Slot] = data.Buffer;
+			}
+		}
+		CountStateChange(changed);
+		HashResource(data.Buffer);
+		Hash(data.Slot);
+		Hash(data.Stages);
+		break;
+	}
+	case RenderCommandType::SetShaderResources:
+	{
+		const RenderCommand::ShaderResourcesData& data = aCommand.ShaderResources;
+		bool changed = false;
+		Hash(data.StartSlot);
+		Hash(data.Count);
+		for (uint32_t i = 0; i < data.Count; i++)
+		{
+			const uint32_t slot = data.StartSlot + i;
+			assert(slot < MaxShaderResourceSlots);
+			changed |= myShaderResources[slot] != data.Views[i];
+			myShaderResources[slot] = data.Views[i];
+			HashResource(data.Views[i]);
+		}
+		CountStateChange(changed);
+		break;
+	}
+	case RenderCommandType::SetBlendState:
+		TrackState(myBlendState, aCommand.BlendState.State);
+		break;
+	case RenderCommandType::SetDepthStencilState:
+		TrackState(myDepthStencilState, aCommand.DepthStencilState.State);
+		break;
+	case RenderCommandType::SetRasterizerState:
+		TrackState(myRasterizerState, aCommand.RasterizerState.State);
+		break;
+	case RenderCommandType::SetSamplers:
+	{
+		const RenderCommand::SamplersData& data = aCommand.Samplers;
+		bool changed = false;
+		Hash(data.StartSlot);
+		Hash(data.Count);
+		for (uint32_t i = 0; i < data.Count; i++)
+		{
+			const uint32_t slot = data.StartSlot + i;
+			assert(slot < MaxSamplerSlots);
+			changed |= mySamplers[slot] != data.Samplers[i];
+			mySamplers[slot] = data.Samplers[i];
+			HashResource(data.Samplers[i]);
+		}
+		CountStateChange(changed);
+		break;
+	}
+	case RenderCommandType::WriteBuffer:
+	{
+		const RenderCommand::WriteBufferData& data = aCommand.WriteBuffer;
+		myStatistics.BytesWritten += data.Size;
+		HashResource(data.Buffer);
+		Hash(data.Size);
+		Hash(data.DestinationOffset);
+		Hash(data.Discard ? 1u : 0u);
+		Hash(data.NoOverwrite ? 1u : 0u);
+		Hash(aCommands.GetPayload(data.PayloadOffset), data.Size);
+		break;
+	}
+	case RenderCommandType::Draw:
+		myStatistics.DrawCount++;
+		myStatistics.InstanceCount++;
+		Hash(aCommand.Draw.VertexCount);
+		Hash(aCommand.Draw.StartVertex);
+		break;
+	case RenderCommandType::DrawIndexed:
+		myStatistics.DrawCount++;
+		myStatistics.InstanceCount++;
+		Hash(aCommand.DrawIndexed.IndexCount);
+		Hash(aCommand.DrawIndexed.StartIndex);
+		Hash(static_cast<uint32_t>(aCommand.DrawIndexed.BaseVertex));
+		break;
+	case RenderCommandType::DrawInstanced:
+		myStatistics.DrawCount++;
+		myStatistics.InstanceCount += aCommand.DrawInstanced.InstanceCount;
+		Hash(aCommand.DrawInstanced.VertexCountPerInstance);
+		Hash(aCommand.DrawInstanced.InstanceCount);
+		Hash(aCommand.DrawInstanced.StartVertex);
+		Hash(aCommand.DrawInstanced.StartInstance);
+		break;
+	case RenderCommandType::DrawIndexedInstanced:
+		myStatistics.DrawCount++;
+		myStatistics.InstanceCount += aCommand.DrawIndexedInstanced.InstanceCount;
+		Hash(aCommand.DrawIndexedInstanced.IndexCountPerInstance);
+		Hash(aCommand.DrawIndexedInstanced.InstanceCount);
+		Hash(aCommand.DrawIndexedInstanced.StartIndex);
+		Hash(static_cast<uint32_t>(aCommand.DrawIndexedInstanced.BaseVertex));
+		Hash(aCommand.DrawIndexedInstanced.StartInstance);
+		break;
+	default:
+		assert(false && "Unknown render command");
+		break;
+	}
+
+	myStatistics.RedundantCommandCounts[(int)aCommand.Type] += myStatistics.RedundantStateChanges - redundantStateChanges;
+}
+
+void RecordingRenderBackend::CountStateChange(bool aChanged)
+{
+	if (aChanged)
+	{
+		myStatistics.StateChanges++;
+	}
+	else
+	{
+		myStatistics.RedundantStateChanges++;
+	}
+}
+
+void RecordingRenderBackend::TrackState(const void*& aBound, const void* aState)
+{
+	CountStateChange(aState != aBound);
+	aBound = aState;
+	HashResource(aState);
+}
+
+uint32_t RecordingRenderBackend::GetResourceId(const void* aResource)
+{
+	if (aResource == nullptr)
+		return 0;
+
+	// Ids start at 1 so that nullptr keeps its own id.
+	auto result = myResourceIds.try_emplace(aResource, static_cast<uint32_t>(myResourceIds.size() + 1));
+	return result.first->second;
+}
+
+void RecordingRenderBackend::Hash(const void* someData, size_t aSize)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(someData);
+	size_t i = 0;
+
+	// Large writes (bones, sprite batches) are hashed as four independent FNV-1a lanes over 64 bit words and folded in
+	// afterwards. Hashing byte by byte in one chain made the payloads cost several times more than everything else.
+	if (aSize >= 4 * sizeof(uint64_t))
+	{
+		uint64_t lanes[4] = { myHash, myHash ^ 1, myHash ^ 2, myHash ^ 3 };
+		for (; i + 4 * sizeof(uint64_t) <= aSize; i += 4 * sizeof(uint64_t))
+		{
+			uint64_t words[4];
+			std::memcpy(words, bytes + i, sizeof(words));
+			for (int lane = 0; lane < 4; lane++)
+			{
+				lanes[lane] = (lanes[lane] ^ words[lane]) * FnvPrime;
+			}
+		}
+		for (uint64_t lane : lanes)
+		{
+			myHash = (myHash ^ lane) * FnvPrime;
+		}
+	}
+
+	for (; i < aSize; i++)
+	{
+		myHash = (myHash ^ bytes[i]) * FnvPrime;
+	}
+}
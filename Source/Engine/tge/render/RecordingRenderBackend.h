@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <tge/render/RenderBackend.h>
+#include <tge/render/RenderCommandBuffer.h>
+
+namespace Tga
+{
+	struct RenderCommandStatistics
+	{
+		size_t CommandCounts[(int)RenderCommandType::Count] = {};
+		size_t CommandCount = 0;
+		// Number of Execute calls, roughly how often the drawers hand their work over.
+		size_t SubmitCount = 0;
+		size_t DrawCount = 0;
+		size_t InstanceCount = 0;
+		size_t BytesWritten = 0;
+		// Bind commands that changed at least one slot, and ones that set exactly what was already bound.
+		size_t StateChanges = 0;
+		size_t RedundantStateChanges = 0;
+		// RedundantStateChanges split up by the bind command that caused them.
+		size_t RedundantCommandCounts[(int)RenderCommandType::Count] = {};
+	};
+
+	/// <summary>
+	/// Backend that never touches a device. It tracks what would be bound to count real and redundant state changes,
+	/// and hashes the command stream with every resource replaced by the order it was first seen in, so two runs that
+	/// record the same frame get the same hash even though the resource pointers differ.
+	/// Pass another backend to the constructor to get statistics for a real frame while it still renders.
+	/// </summary>
+	class RecordingRenderBackend : public RenderBackend
+	{
+	public:
+		explicit RecordingRenderBackend(RenderBackend* aForwardBackend = nullptr);
+
+		void Execute(const RenderCommandBuffer& aCommands) override;
+
+		/**
+		 * Resets the statistics, the hash and the tracked device state. Call once per frame.
+		 */
+		void BeginFrame();
+
+		const RenderCommandStatistics& GetStatistics() const { return myStatistics; }
+		uint64_t GetHash() const { return myHash; }
+
+	private:
+		static constexpr uint32_t MaxConstantBufferSlots = 16;
+		static constexpr uint32_t MaxShaderResourceSlots = 16;
+		static constexpr uint32_t MaxSamplerSlots = 16;
+
+		struct VertexBufferBinding
+		{
+			const void* Buffer;
+			uint32_t Stride;
+			uint32_t Offset;
+		};
+
+		void ExecuteCommand(const RenderCommand& aCommand, const RenderCommandBuffer& aCommands);
+		void CountStateChange(bool aChanged);
+		void TrackState(const void*& aBound, const void* aState);
+		uint32_t GetResourceId(const void* aResource);
+		void Hash(const void* someData, size_t aSize);
+		void Hash(uint32_t aValue) { Hash(&aValue, sizeof(aValue)); }
+		void HashResource(const void* aResource) { Hash(GetResourceId(aResource)); }
+
+		RenderBackend* myForwardBackend;
+		RenderCommandStatistics myStatistics;
+		uint64_t myHash = 0;
+		std::unordered_map<const void*, uint32_t> myResourceIds;
+
+		// What the device would have bound. Unknown until the first bind of the frame.
+		const void* myVertexShader;
+		const void* myPixelShader;
+		const void* myInputLayout;
+		uint32_t myTopology;
+		VertexBufferBinding myVertexBuffers[RenderCommand::MaxVertexBuffers];
+		const void* myIndexBuffer;
+		uint32_t myIndexBufferOffset;
+		uint32_t myIndexFormat;
+		const void* myConstantBuffers[2][MaxConstantBufferSlots];
+		const void* myShaderResources[MaxShaderResourceSlots];
+		const void* myBlendState;
+		const void* myDepthStencilState;
+		const void* myRasterizerState;
+		const void* mySamplers[MaxSamplerSlots];
+	};
+}
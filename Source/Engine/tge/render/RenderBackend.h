@@ -0,0 +1,21 @@
+#pragma once
+
+namespace Tga
+{
+	class RenderCommandBuffer;
+
+	/// <summary>
+	/// Consumes recorded render commands. DX11RenderBackend submits them to the device, RecordingRenderBackend only
+	/// counts and hashes them, which is what runs on machines without a GPU.
+	/// </summary>
+	class RenderBackend
+	{
+	public:
+		virtual ~RenderBackend() = default;
+
+		/**
+		 * Runs every command in aCommands in order. The buffer is left untouched, clearing it is up to the caller.
+		 */
+		virtual void Execute(const RenderCommandBuffer& aCommands) = 0;
+	};
+}
@@ -0,0 +1,303 @@
+#include "stdafx.h"
+#include "RenderCommandBuffer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+using namespace Tga;
+
+namespace
+{
+	constexpr size_t PayloadAlignment = 16;
+
+	size_t AlignPayloadSize(size_t aSize)
+	{
+		return (aSize + PayloadAlignment - 1) & ~(PayloadAlignment - 1);
+	}
+}
+
+void RenderCommandBuffer::BeginPacket(uint64_t aSortKey)
+{
+	// An empty packet can just be reused, which keeps callers that begin one per object from leaving gaps behind.
+	if (!myPackets.empty() && myPackets.back().CommandCount == 0)
+	{
+		myPackets.back().SortKey = aSortKey;
+		return;
+	}
+
+	myPackets.push_back({ aSortKey, static_cast<uint32_t>(myCommands.size()), 0 });
+}
+
+void RenderCommandBuffer::AppendPackets(const RenderCommandBuffer& aSource, size_t aFirstPacket, size_t aPacketCount)
+{
+	if (aPacketCount == 0)
+		return;
+
+	const RenderPacket* packets = aSource.myPackets.data() + aFirstPacket;
+	const size_t firstCommand = packets[0].FirstCommand;
+	const size_t endCommand = packets[aPacketCount - 1].FirstCommand + packets[aPacketCount - 1].CommandCount;
+
+	// Payload is allocated in recording order, so the writes of consecutive packets sit in one contiguous range.
+	size_t payloadBegin = SIZE_MAX;
+	size_t payloadEnd = 0;
+	for (size_t i = firstCommand; i < endCommand; i++)
+	{
+		const RenderCommand& command = aSource.myCommands[i];
+		if (command.Type == RenderCommandType::WriteBuffer)
+		{
+			payloadBegin = std::min<size_t>(payloadBegin, command.WriteBuffer.PayloadOffset);
+			payloadEnd = std::max<size_t>(payloadEnd, command.WriteBuffer.PayloadOffset + AlignPayloadSize(command.WriteBuffer.Size));
+		}
+	}
+
+	// Copy the bytes along in one go and move the offsets of the copied writes by the same amount.
+	int64_t payloadDelta = 0;
+	if (payloadBegin < payloadEnd)
+	{
+		size_t offset;
+		std::memcpy(AllocatePayload(payloadEnd - payloadBegin, offset), aSource.GetPayload(static_cast<uint32_t>(payloadBegin)), payloadEnd - payloadBegin);
+		payloadDelta = static_cast<int64_t>(offset) - static_cast<int64_t>(payloadBegin);
+	}
+
+	const size_t commandDelta = myCommands.size();
+	myCommands.insert(myCommands.end(), aSource.myCommands.begin() + firstCommand, aSource.myCommands.begin() + endCommand);
+	for (size_t i = commandDelta; i < myCommands.size(); i++)
+	{
+		RenderCommand& command = myCommands[i];
+		if (command.Type == RenderCommandType::WriteBuffer)
+		{
+			command.WriteBuffer.PayloadOffset = static_cast<uint32_t>(command.WriteBuffer.PayloadOffset + payloadDelta);
+		}
+	}
+
+	// Reusing an empty last packet the way BeginPacket does keeps the packet list free of gaps.
+	if (!myPackets.empty() && myPackets.back().CommandCount == 0)
+	{
+		myPackets.pop_back();
+	}
+	for (size_t i = 0; i < aPacketCount; i++)
+	{
+		const uint32_t first = static_cast<uint32_t>(packets[i].FirstCommand - firstCommand + commandDelta);
+		myPackets.push_back({ packets[i].SortKey, first, packets[i].CommandCount });
+	}
+}
+
+RenderCommand& RenderCommandBuffer::Push(RenderCommandType aType)
+{
+	if (myPackets.empty())
+	{
+		myPackets.push_back({ 0, static_cast<uint32_t>(myCommands.size()), 0 });
+	}
+	myPackets.back().CommandCount++;
+
+	RenderCommand& command = myCommands.emplace_back();
+	std::memset(&command, 0, sizeof(RenderCommand));
+	command.Type = aType;
+	return command;
+}
+
+void RenderCommandBuffer::SetShaders(ID3D11VertexShader* aVertexShader, ID3D11PixelShader* aPixelShader)
+{
+	RenderCommand& command = Push(RenderCommandType::SetShaders);
+	command.Shaders.VertexShader = aVertexShader;
+	command.Shaders.PixelShader = aPixelShader;
+}
+
+void RenderCommandBuffer::SetInputLayout(ID3D11InputLayout* aLayout)
+{
+	Push(RenderCommandType::SetInputLayout).InputLayout.Layout = aLayout;
+}
+
+void RenderCommandBuffer::SetTopology(RenderTopology aTopology)
+{
+	Push(RenderCommandType::SetTopology).Topology.Topology = aTopology;
+}
+
+void RenderCommandBuffer::SetVertexBuffers(uint32_t aStartSlot, uint32_t aCount, ID3D11Buffer* const* someBuffers, const uint32_t* someStrides, const uint32_t* someOffsets)
+{
+	assert(aCount <= RenderCommand::MaxVertexBuffers);
+
+	RenderCommand& command = Push(RenderCommandType::SetVertexBuffers);
+	command.VertexBuffers.StartSlot = static_cast<uint8_t>(aStartSlot);
+	command.VertexBuffers.Count = static_cast<uint8_t>(aCount);
+	for (uint32_t i = 0; i < aCount; i++)
+	{
+		command.VertexBuffers.Buffers[i] = someBuffers[i];
+		command.VertexBuffers.Strides[i] = someStrides[i];
+		command.VertexBuffers.Offsets[i] = someOffsets[i];
+	}
+}
+
+void RenderCommandBuffer::SetIndexBuffer(ID3D11Buffer* aBuffer, RenderIndexFormat aFormat, uint32_t anOffset)
+{
+	RenderCommand& command = Push(RenderCommandType::SetIndexBuffer);
+	command.IndexBuffer.Buffer = aBuffer;
+	command.IndexBuffer.Format = aFormat;
+	command.IndexBuffer.Offset = anOffset;
+}
+
+void RenderCommandBuffer::SetConstantBuffer(uint8_t someStages, uint32_t aSlot, ID3D11Buffer* aBuffer)
+{
+	RenderCommand& command = Push(RenderCommandType::SetConstantBuffer);
+	command.ConstantBuffer.Buffer = aBuffer;
+	command.ConstantBuffer.Slot = static_cast<uint8_t>(aSlot);
+	command.ConstantBuffer.Stages = someStages;
+}
+
+void RenderCommandBuffer::SetShaderResources(uint32_t aStartSlot, uint32_t aCount, ID3D11ShaderResourceView* const* someViews)
+{
+	while (aCount > 0)
+	{
+		const uint32_t count = std::min(aCount, RenderCommand::MaxShaderResources);
+
+		RenderCommand& command = Push(RenderCommandType::SetShaderResources);
+		command.ShaderResources.StartSlot = static_cast<uint8_t>(aStartSlot);
+		command.ShaderResources.Count = static_cast<uint8_t>(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			command.ShaderResources.Views[i] = someViews[i];
+		}
+
+		aStartSlot += count;
+		someViews += count;
+		aCount -= count;
+	}
+}
+
+void RenderCommandBuffer::SetBlendState(ID3D11BlendState* aState)
+{
+	Push(RenderCommandType::SetBlendState).BlendState.State = aState;
+}
+
+void RenderCommandBuffer::SetDepthStencilState(ID3D11DepthStencilState* aState)
+{
+	Push(RenderCommandType::SetDepthStencilState).DepthStencilState.State = aState;
+}
+
+void RenderCommandBuffer::SetRasterizerState(ID3D11RasterizerState* aState)
+{
+	Push(RenderCommandType::SetRasterizerState).RasterizerState.State = aState;
+}
+
+void RenderCommandBuffer::SetSamplers(uint32_t aStartSlot, uint32_t aCount, ID3D11SamplerState* const* someSamplers)
+{
+	assert(aCount <= RenderCommand::MaxSamplers);
+
+	RenderCommand& command = Push(RenderCommandType::SetSamplers);
+	command.Samplers.StartSlot = static_cast<uint8_t>(aStartSlot);
+	command.Samplers.Count = static_cast<uint8_t>(aCount);
+	for (uint32_t i = 0; i < aCount; i++)
+	{
+		command.Samplers.Samplers[i] = someSamplers[i];
+	}
+}
+
+void* RenderCommandBuffer::WriteBuffer(ID3D11Buffer* aBuffer, size_t aSize, bool aDiscard, uint32_t aDestinationOffset)
+{
+	assert(!aDiscard || aDestinationOffset == 0);
+
+	size_t offset;
+	void* payload = AllocatePayload(aSize, offset);
+
+	RenderCommand& command = Push(RenderCommandType::WriteBuffer);
+	command.WriteBuffer.Buffer = aBuffer;
+	command.WriteBuffer.PayloadOffset = static_cast<uint32_t>(offset);
+	command.WriteBuffer.Size = static_cast<uint32_t>(aSize);
+	command.WriteBuffer.DestinationOffset = aDestinationOffset;
+	command.WriteBuffer.Discard = aDiscard;
+
+	return payload;
+}
+
+void* RenderCommandBuffer::AllocatePayload(size_t aSize, size_t& outOffset)
+{
+	outOffset = myPayloadSize;
+	myPayloadSize += AlignPayloadSize(aSize);
+	if (myPayloadSize > myPayload.size() * sizeof(PayloadBlock))
+	{
+		myPayload.resize(std::max(myPayload.size() * 2, myPayloadSize / sizeof(PayloadBlock)));
+	}
+
+	return reinterpret_cast<uint8_t*>(myPayload.data()) + outOffset;
+}
+
+void RenderCommandBuffer::WriteBuffer(ID3D11Buffer* aBuffer, const void* someData, size_t aSize, bool aDiscard, uint32_t aDestinationOffset)
+{
+	std::memcpy(WriteBuffer(aBuffer, aSize, aDiscard, aDestinationOffset), someData, aSize);
+}
+
+void* RenderCommandBuffer::WriteBufferNoOverwrite(ID3D11Buffer* aBuffer, size_t aSize, uint32_t aDestinationOffset)
+{
+	void* payload = WriteBuffer(aBuffer, aSize, false, aDestinationOffset);
+	myCommands.back().WriteBuffer.NoOverwrite = true;
+	return payload;
+}
+
+void RenderCommandBuffer::TrimLastWrite(size_t aSize)
+{
+	assert(!myCommands.empty() && myCommands.back().Type == RenderCommandType::WriteBuffer);
+
+	RenderCommand::WriteBufferData& write = myCommands.back().WriteBuffer;
+	assert(aSize <= write.Size);
+
+	myPayloadSize = write.PayloadOffset + AlignPayloadSize(aSize);
+	if (aSize == 0)
+	{
+		myCommands.pop_back();
+		myPackets.back().CommandCount--;
+		return;
+	}
+
+	write.Size = static_cast<uint32_t>(aSize);
+}
+
+void RenderCommandBuffer::Draw(uint32_t aVertexCount, uint32_t aStartVertex)
+{
+	RenderCommand& command = Push(RenderCommandType::Draw);
+	command.Draw.VertexCount = aVertexCount;
+	command.Draw.StartVertex = aStartVertex;
+}
+
+void RenderCommandBuffer::DrawIndexed(uint32_t anIndexCount, uint32_t aStartIndex, int32_t aBaseVertex)
+{
+	RenderCommand& command = Push(RenderCommandType::DrawIndexed);
+	command.DrawIndexed.IndexCount = anIndexCount;
+	command.DrawIndexed.StartIndex = aStartIndex;
+	command.DrawIndexed.BaseVertex = aBaseVertex;
+}
+
+void RenderCommandBuffer::DrawInstanced(uint32_t aVertexCountPerInstance, uint32_t anInstanceCount, uint32_t aStartVertex, uint32_t aStartInstance)
+{
+	RenderCommand& command = Push(RenderCommandType::DrawInstanced);
+	command.DrawInstanced.VertexCountPerInstance = aVertexCountPerInstance;
+	command.DrawInstanced.InstanceCount = anInstanceCount;
+	command.DrawInstanced.StartVertex = aStartVertex;
+	command.DrawInstanced.StartInstance = aStartInstance;
+}
+
+void RenderCommandBuffer::DrawIndexedInstanced(uint32_t anIndexCountPerInstance, uint32_t anInstanceCount, uint32_t aStartIndex, int32_t aBaseVertex, uint32_t aStartInstance)
+{
+	RenderCommand& command = Push(RenderCommandType::DrawIndexedInstanced);
+	command.DrawIndexedInstanced.IndexCountPerInstance = anIndexCountPerInstance;
+	command.DrawIndexedInstanced.InstanceCount = anInstanceCount;
+	command.DrawIndexedInstanced.StartIndex = aStartIndex;
+	command.DrawIndexedInstanced.BaseVertex = aBaseVertex;
+	command.DrawIndexedInstanced.StartInstance = aStartInstance;
+}
+
+void RenderCommandBuffer::Clear()
+{
+	myCommands.clear();
+	myPackets.clear();
+	myPayloadSize = 0;
+}
+
+void RenderCommandBuffer::Reserve(size_t aCommandCount, size_t aPayloadSize)
+{
+	myCommands.reserve(aCommandCount);
+	if (AlignPayloadSize(aPayloadSize) > myPayload.size() * sizeof(PayloadBlock))
+	{
+		myPayload.resize(AlignPayloadSize(aPayloadSize) / sizeof(PayloadBlock));
+	}
+}
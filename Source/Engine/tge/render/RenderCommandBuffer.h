@@ -0,0 +1,293 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct ID3D11BlendState;
+struct ID3D11Buffer;
+struct ID3D11DepthStencilState;
+struct ID3D11InputLayout;
+struct ID3D11PixelShader;
+struct ID3D11RasterizerState;
+struct ID3D11SamplerState;
+struct ID3D11ShaderResourceView;
+struct ID3D11VertexShader;
+
+namespace Tga
+{
+	enum class RenderCommandType : uint8_t
+	{
+		SetShaders,
+		SetInputLayout,
+		SetTopology,
+		SetVertexBuffers,
+		SetIndexBuffer,
+		SetConstantBuffer,
+		SetShaderResources,
+		SetBlendState,
+		SetDepthStencilState,
+		SetRasterizerState,
+		SetSamplers,
+		WriteBuffer,
+		Draw,
+		DrawIndexed,
+		DrawInstanced,
+		DrawIndexedInstanced,
+		Count
+	};
+
+	enum class RenderTopology : uint8_t
+	{
+		TriangleList,
+		LineList,
+	};
+
+	enum class RenderIndexFormat : uint8_t
+	{
+		UInt16,
+		UInt32,
+	};
+
+	// Which shader stages a constant buffer is bound to.
+	enum RenderStageFlags : uint8_t
+	{
+		RenderStage_Vertex = 1 << 0,
+		RenderStage_Pixel = 1 << 1,
+		RenderStage_VertexAndPixel = RenderStage_Vertex | RenderStage_Pixel,
+	};
+
+	/// <summary>
+	/// One recorded command. Resources are stored as the raw D3D pointers, but only a backend ever dereferences them,
+	/// so everything else can treat them as opaque handles.
+	/// </summary>
+	struct RenderCommand
+	{
+		static constexpr uint32_t MaxVertexBuffers = 3;
+		static constexpr uint32_t MaxShaderResources = 4;
+		static constexpr uint32_t MaxSamplers = 4;
+
+		struct ShadersData
+		{
+			ID3D11VertexShader* VertexShader;
+			ID3D11PixelShader* PixelShader;
+		};
+		struct InputLayoutData
+		{
+			ID3D11InputLayout* Layout;
+		};
+		struct TopologyData
+		{
+			RenderTopology Topology;
+		};
+		struct VertexBuffersData
+		{
+			ID3D11Buffer* Buffers[MaxVertexBuffers];
+			uint32_t Strides[MaxVertexBuffers];
+			uint32_t Offsets[MaxVertexBuffers];
+			uint8_t StartSlot;
+			uint8_t Count;
+		};
+		struct IndexBufferData
+		{
+			ID3D11Buffer* Buffer;
+			uint32_t Offset;
+			RenderIndexFormat Format;
+		};
+		struct ConstantBufferData
+		{
+			ID3D11Buffer* Buffer;
+			uint8_t Slot;
+			uint8_t Stages;
+		};
+		// Pixel shader stage only, which is the only stage the drawers bind textures to.
+		struct ShaderResourcesData
+		{
+			ID3D11ShaderResourceView* Views[MaxShaderResources];
+			uint8_t StartSlot;
+			uint8_t Count;
+		};
+		struct BlendStateData
+		{
+			ID3D11BlendState* State;
+		};
+		struct DepthStencilStateData
+		{
+			ID3D11DepthStencilState* State;
+		};
+		struct RasterizerStateData
+		{
+			ID3D11RasterizerState* State;
+		};
+		// Pixel shader stage only, like the shader resources.
+		struct SamplersData
+		{
+			ID3D11SamplerState* Samplers[MaxSamplers];
+			uint8_t StartSlot;
+			uint8_t Count;
+		};
+		struct WriteBufferData
+		{
+			ID3D11Buffer* Buffer;
+			// Where the bytes are in the command buffer's payload.
+			uint32_t PayloadOffset;
+			uint32_t Size;
+			// Byte offset into the destination buffer. Always 0 for discarding writes.
+			uint32_t DestinationOffset;
+			// Discarding writes replace the whole buffer (a dynamic buffer mapped with discard), others update a range.
+			bool Discard;
+			// Writes a range of a dynamic buffer mapped with no overwrite, for buffers used as a ring.
+			bool NoOverwrite;
+		};
+		struct DrawData
+		{
+			uint32_t VertexCount;
+			uint32_t StartVertex;
+		};
+		struct DrawIndexedData
+		{
+			uint32_t IndexCount;
+			uint32_t StartIndex;
+			int32_t BaseVertex;
+		};
+		struct DrawInstancedData
+		{
+			uint32_t VertexCountPerInstance;
+			uint32_t InstanceCount;
+			uint32_t StartVertex;
+			uint32_t StartInstance;
+		};
+		struct DrawIndexedInstancedData
+		{
+			uint32_t IndexCountPerInstance;
+			uint32_t InstanceCount;
+			uint32_t StartIndex;
+			int32_t BaseVertex;
+			uint32_t StartInstance;
+		};
+
+		RenderCommandType Type;
+		union
+		{
+			ShadersData Shaders;
+			InputLayoutData InputLayout;
+			TopologyData Topology;
+			VertexBuffersData VertexBuffers;
+			IndexBufferData IndexBuffer;
+			ConstantBufferData ConstantBuffer;
+			ShaderResourcesData ShaderResources;
+			BlendStateData BlendState;
+			DepthStencilStateData DepthStencilState;
+			RasterizerStateData RasterizerState;
+			SamplersData Samplers;
+			WriteBufferData WriteBuffer;
+			DrawData Draw;
+			DrawIndexedData DrawIndexed;
+			DrawInstancedData DrawInstanced;
+			DrawIndexedInstancedData DrawIndexedInstanced;
+		};
+	};
+
+	/// <summary>
+	/// A run of commands that has to stay together, ordered against other packets by SortKey when buffers are merged.
+	/// </summary>
+	struct RenderPacket
+	{
+		uint64_t SortKey;
+		uint32_t FirstCommand;
+		uint32_t CommandCount;
+	};
+
+	/// <summary>
+	/// Flat list of state binds, buffer writes and draws, recorded by the drawers and consumed by a RenderBackend.
+	/// Data for buffer writes is copied into a 16 byte aligned payload owned by the command buffer, so the recorded
+	/// stream is self contained and can be replayed, counted or hashed without a device.
+	/// Clear keeps the allocations, so a buffer that is reused every frame stops allocating after the first one.
+	/// Commands are grouped in packets. Anything recorded before the first BeginPacket goes in a packet with key 0.
+	/// Since a packet can end up after packets from other buffers, it should bind everything its draws depend on.
+	/// </summary>
+	class RenderCommandBuffer
+	{
+	public:
+		/**
+		 * Starts a new packet, everything recorded until the next BeginPacket belongs to it.
+		 */
+		void BeginPacket(uint64_t aSortKey);
+
+		/**
+		 * Appends aPacketCount consecutive packets of aSource, with their payload, as new packets of this buffer.
+		 */
+		void AppendPackets(const RenderCommandBuffer& aSource, size_t aFirstPacket, size_t aPacketCount);
+
+		void SetShaders(ID3D11VertexShader* aVertexShader, ID3D11PixelShader* aPixelShader);
+		void SetInputLayout(ID3D11InputLayout* aLayout);
+		void SetTopology(RenderTopology aTopology);
+		void SetVertexBuffers(uint32_t aStartSlot, uint32_t aCount, ID3D11Buffer* const* someBuffers, const uint32_t* someStrides, const uint32_t* someOffsets);
+		void SetIndexBuffer(ID3D11Buffer* aBuffer, RenderIndexFormat aFormat, uint32_t anOffset = 0);
+		void SetConstantBuffer(uint8_t someStages, uint32_t aSlot, ID3D11Buffer* aBuffer);
+
+		/**
+		 * Binds pixel shader resources. More than MaxShaderResources views are split over several commands.
+		 */
+		void SetShaderResources(uint32_t aStartSlot, uint32_t aCount, ID3D11ShaderResourceView* const* someViews);
+
+		// A null state means the device default, same as in D3D.
+		void SetBlendState(ID3D11BlendState* aState);
+		void SetDepthStencilState(ID3D11DepthStencilState* aState);
+		void SetRasterizerState(ID3D11RasterizerState* aState);
+
+		/**
+		 * Binds pixel shader samplers, at most MaxSamplers of them.
+		 */
+		void SetSamplers(uint32_t aStartSlot, uint32_t aCount, ID3D11SamplerState* const* someSamplers);
+
+		/**
+		 * Records a write of aSize bytes into aBuffer and returns where to put them.
+		 * The pointer is 16 byte aligned and stays valid until the next WriteBuffer or Clear.
+		 * @param aDiscard True for dynamic buffers that are replaced as a whole, false to update a range of a default buffer.
+		 */
+		void* WriteBuffer(ID3D11Buffer* aBuffer, size_t aSize, bool aDiscard = true, uint32_t aDestinationOffset = 0);
+		void WriteBuffer(ID3D11Buffer* aBuffer, const void* someData, size_t aSize, bool aDiscard = true, uint32_t aDestinationOffset = 0);
+
+		/**
+		 * Like WriteBuffer, but into a range of a dynamic buffer that the GPU may still read other parts of. The caller
+		 * promises not to touch anything written since the last discarding write, which is how a ring buffer works.
+		 */
+		void* WriteBufferNoOverwrite(ID3D11Buffer* aBuffer, size_t aSize, uint32_t aDestinationOffset);
+
+		/**
+		 * Shrinks the most recent WriteBuffer to the aSize bytes that were actually written, for callers that reserve
+		 * room for a full batch up front. A size of 0 drops the write. Must be called before anything else is recorded.
+		 */
+		void TrimLastWrite(size_t aSize);
+
+		void Draw(uint32_t aVertexCount, uint32_t aStartVertex = 0);
+		void DrawIndexed(uint32_t anIndexCount, uint32_t aStartIndex = 0, int32_t aBaseVertex = 0);
+		void DrawInstanced(uint32_t aVertexCountPerInstance, uint32_t anInstanceCount, uint32_t aStartVertex = 0, uint32_t aStartInstance = 0);
+		void DrawIndexedInstanced(uint32_t anIndexCountPerInstance, uint32_t anInstanceCount, uint32_t aStartIndex = 0, int32_t aBaseVertex = 0, uint32_t aStartInstance = 0);
+
+		void Clear();
+		void Reserve(size_t aCommandCount, size_t aPayloadSize);
+
+		bool IsEmpty() const { return myCommands.empty(); }
+		size_t GetCommandCount() const { return myCommands.size(); }
+		const RenderCommand* GetCommands() const { return myCommands.data(); }
+		size_t GetPayloadSize() const { return myPayloadSize; }
+		size_t GetPacketCount() const { return myPackets.size(); }
+		const RenderPacket* GetPackets() const { return myPackets.data(); }
+		const void* GetPayload(uint32_t anOffset) const { return reinterpret_cast<const uint8_t*>(myPayload.data()) + anOffset; }
+
+	private:
+		struct alignas(16) PayloadBlock
+		{
+			uint8_t Bytes[16];
+		};
+
+		RenderCommand& Push(RenderCommandType aType);
+		void* AllocatePayload(size_t aSize, size_t& outOffset);
+
+		std::vector<RenderCommand> myCommands;
+		std::vector<RenderPacket> myPackets;
+		std::vector<PayloadBlock> myPayload;
+		size_t myPayloadSize = 0;
+	};
+}
@@ -0,0 +1,58 @@
+#include "stdafx.h"
+#include "RenderCommandMerger.h"
+
+#include <algorithm>
+#include <tge/render/RenderCommandBuffer.h>
+
+using namespace Tga;
+
+void RenderCommandMerger::Merge(const RenderCommandBuffer* const* someBuffers, size_t aBufferCount, RenderCommandBuffer& outMerged)
+{
+	myEntries.clear();
+
+	size_t commandCount = 0;
+	size_t payloadSize = 0;
+	bool isSorted = true;
+	for (size_t buffer = 0; buffer < aBufferCount; buffer++)
+	{
+		const RenderCommandBuffer& commands = *someBuffers[buffer];
+		const RenderPacket* packets = commands.GetPackets();
+		for (size_t packet = 0; packet < commands.GetPacketCount(); packet++)
+		{
+			if (packets[packet].CommandCount == 0)
+				continue;
+
+			isSorted = isSorted && (myEntries.empty() || myEntries.back().SortKey <= packets[packet].SortKey);
+			myEntries.push_back({ packets[packet].SortKey, static_cast<uint32_t>(buffer), static_cast<uint32_t>(packet) });
+		}
+		commandCount += commands.GetCommandCount();
+		payloadSize += commands.GetPayloadSize();
+	}
+
+	// Entries were added in (buffer, packet) order, so a stable sort on the key alone gives the full tie break.
+	// Workers usually get contiguous slices of something already sorted, which the check above skips entirely.
+	if (!isSorted)
+	{
+		std::stable_sort(myEntries.begin(), myEntries.end(), [](const Entry& aLeft, const Entry& aRight)
+		{
+			return aLeft.SortKey < aRight.SortKey;
+		});
+	}
+
+	outMerged.Reserve(outMerged.GetCommandCount() + commandCount, outMerged.GetPayloadSize() + payloadSize);
+
+	// Runs of packets that stay next to each other are copied together, which for sorted input is whole buffers.
+	size_t runStart = 0;
+	for (size_t i = 1; i <= myEntries.size(); i++)
+	{
+		const Entry& first = myEntries[runStart];
+		if (i < myEntries.size() && myEntries[i].Buffer == first.Buffer && myEntries[i].Packet == first.Packet + (i - runStart))
+			continue;
+
+		if (i > runStart)
+		{
+			outMerged.AppendPackets(*someBuffers[first.Buffer], first.Packet, i - runStart);
+		}
+		runStart = i;
+	}
+}
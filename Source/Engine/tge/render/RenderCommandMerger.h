@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Tga
+{
+	class RenderCommandBuffer;
+
+	/// <summary>
+	/// Merges the packets of several command buffers into one buffer ordered by sort key.
+	/// Packets with the same key keep the order of the buffers they came from, and their order within that buffer, so
+	/// the result only depends on what was recorded and never on which thread recorded it or when it finished.
+	/// </summary>
+	class RenderCommandMerger
+	{
+	public:
+		/**
+		 * Appends every packet of someBuffers to outMerged in sorted order. outMerged is not cleared first.
+		 */
+		void Merge(const RenderCommandBuffer* const* someBuffers, size_t aBufferCount, RenderCommandBuffer& outMerged);
+
+	private:
+		struct Entry
+		{
+			uint64_t SortKey;
+			uint32_t Buffer;
+			uint32_t Packet;
+		};
+
+		// Kept between merges to avoid reallocating every frame.
+		std::vector<Entry> myEntries;
+	};
+}
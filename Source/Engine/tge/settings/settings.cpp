@@ -3,9 +3,7 @@
 
 #include <nlohmann/json.hpp>
 #include <fstream>
-
-#include <io.h>
-#define access _access_s
+#include <tge/filesystem/VirtualFileSystem.h>
 
 namespace Tga {
 	namespace Settings {
@@ -16,6 +14,7 @@ namespace Tga {
 		static Path engine_assets_path;
 		static Path game_assets_path;
 		static nlohmann::json game_settings;
+		static VirtualFileSystem file_system;
 
 		static EngineConfiguration window_params;
 	}
@@ -27,46 +26,50 @@ const Tga::EngineConfiguration& Tga::Settings::GetEngineConfiguration() {
 	return window_params;
 }
 
+Tga::VirtualFileSystem& Tga::Settings::GetFileSystem() {
+	return file_system;
+}
+
 std::string Tga::Settings::ResolveAssetPath(const std::string& anAsset) {
-	if (access(anAsset.c_str(), 0) == 0) {
+	if (file_system.Exists(anAsset)) {
 		return anAsset;
 	}
-	else if (access(("data/" + anAsset).c_str(), 0) == 0) {
+	else if (file_system.Exists("data/" + anAsset)) {
 		return ("data/" + anAsset);
 	}
 
-	else if (access((game_assets_path.relative + anAsset).c_str(), 0) == 0) {
+	else if (file_system.Exists(game_assets_path.relative + anAsset)) {
 		return game_assets_path.relative + anAsset;
 	}
-	else if (access((engine_assets_path.relative + anAsset).c_str(), 0) == 0) {
+	else if (file_system.Exists(engine_assets_path.relative + anAsset)) {
 		return engine_assets_path.relative + anAsset;
 	}
-	else if (access((game_assets_path.absolute + anAsset).c_str(), 0) == 0) {
+	else if (file_system.Exists(game_assets_path.absolute + anAsset)) {
 		return game_assets_path.absolute + anAsset;
 	}
-	else if (access((engine_assets_path.absolute + anAsset).c_str(), 0) == 0) {
+	else if (file_system.Exists(engine_assets_path.absolute + anAsset)) {
 		return engine_assets_path.absolute + anAsset;
 	}
 	return engine_assets_path.relative + "Sprites/error.dds";
 }
 
 std::wstring Tga::Settings::ResolveAssetPathW(const std::string& anAsset) {
-	if (access(anAsset.c_str(), 0) == 0) {
+	if (file_system.Exists(anAsset)) {
 		return ToWstring(anAsset);
 	}
-	else if (access(("data/" + anAsset).c_str(), 0) == 0) {
+	else if (file_system.Exists("data/" + anAsset)) {
 		return (L"data/" + ToWstring(anAsset));
 	}
-	else if (access((game_assets_path.relative + anAsset).c_str(), 0) == 0) {
+	else if (file_system.Exists(game_assets_path.relative + anAsset)) {
 		return ToWstring(game_assets_path.relative + anAsset);
 	}
-	else if (access((engine_assets_path.relative + anAsset).c_str(), 0) == 0) {
+	else if (file_system.Exists(engine_assets_path.relative + anAsset)) {
 		return ToWstring(engine_assets_path.relative + anAsset);
 	}
-	else if (access((game_assets_path.absolute + anAsset).c_str(), 0) == 0) {
+	else if (file_system.Exists(game_assets_path.absolute + anAsset)) {
 		return ToWstring(game_assets_path.absolute + anAsset);
 	}
-	else if (access((engine_assets_path.absolute + anAsset).c_str(), 0) == 0) {
+	else if (file_system.Exists(engine_assets_path.absolute + anAsset)) {
 		return ToWstring(engine_assets_path.absolute + anAsset);
 	}
 	return ToWstring(engine_assets_path.relative + "Sprites/error.dds");
@@ -75,42 +78,42 @@ std::wstring Tga::Settings::ResolveAssetPathW(const std::string& anAsset) {
 std::wstring Tga::Settings::ResolveAssetPathW(const std::wstring& anAsset) {
 	std::string asset = FromWstring(anAsset);
 	
-	if (access(asset.c_str(), 0) == 0) {
+	if (file_system.Exists(asset)) {
 		return anAsset;
 	}
-	else if (access(("data/" + asset).c_str(), 0) == 0) {
+	else if (file_system.Exists("data/" + asset)) {
 		return (L"data/" + anAsset);
 	}
-	if (access((game_assets_path.relative + asset).c_str(), 0) == 0) {
+	if (file_system.Exists(game_assets_path.relative + asset)) {
 		return ToWstring(game_assets_path.relative + asset);
 	}
-	else if (access((engine_assets_path.relative + asset).c_str(), 0) == 0) {
+	else if (file_system.Exists(engine_assets_path.relative + asset)) {
 		return ToWstring(engine_assets_path.relative + asset);
 	}
-	else if (access((game_assets_path.absolute + asset).c_str(), 0) == 0) {
+	else if (file_system.Exists(game_assets_path.absolute + asset)) {
 		return ToWstring(game_assets_path.absolute + asset);
 	}
-	else if (access((engine_assets_path.absolute + asset).c_str(), 0) == 0) {
+	else if (file_system.Exists(engine_assets_path.absolute + asset)) {
 		return ToWstring(engine_assets_path.absolute + asset);
 	}
 	return ToWstring(engine_assets_path.relative + "Sprites/error.dds");
 }
 
 std::string Tga::Settings::ResolveEngineAssetPath(const std::string& anAsset) {
-	if (access(anAsset.c_str(), 0) == 0) {
+	if (file_system.Exists(anAsset)) {
 		return anAsset;
 	}
-	if (access((engine_assets_path.relative + anAsset).c_str(), 0) == 0) {
+	if (file_system.Exists(engine_assets_path.relative + anAsset)) {
 		return std::string(engine_assets_path.relative + anAsset);
 	}
 	return std::string(engine_assets_path.absolute + anAsset);
 }
 
 std::wstring Tga::Settings::ResolveEngineAssetPathW(const std::string& anAsset) {
-	if (access(anAsset.c_str(), 0) == 0) {
+	if (file_system.Exists(anAsset)) {
 		return Tga::ToWstring(anAsset);
 	}
-	if (access((engine_assets_path.relative + anAsset).c_str(), 0) == 0) {
+	if (file_system.Exists(engine_assets_path.relative + anAsset)) {
 		return std::wstring(ToWstring(engine_assets_path.relative + anAsset));
 	}
 	return std::wstring(ToWstring(engine_assets_path.absolute) + ToWstring(anAsset));
@@ -119,30 +122,30 @@ std::wstring Tga::Settings::ResolveEngineAssetPathW(const std::string& anAsset)
 std::wstring Tga::Settings::ResolveEngineAssetPathW(const std::wstring& anAsset) {
 	std::string asset = FromWstring(anAsset);
 
-	if (access(asset.c_str(), 0) == 0) {
+	if (file_system.Exists(asset)) {
 		return anAsset;
 	}
-	if (access((game_assets_path.relative + FromWstring(anAsset)).c_str(), 0) == 0) {
+	if (file_system.Exists(game_assets_path.relative + FromWstring(anAsset))) {
 		return std::wstring(ToWstring(engine_assets_path.relative) + anAsset);
 	}
 	return std::wstring(ToWstring(engine_assets_path.absolute) + anAsset);
 }
 
 std::string Tga::Settings::ResolveGameAssetPath(const std::string& anAsset) {
-	if (access(anAsset.c_str(), 0) == 0) {
+	if (file_system.Exists(anAsset)) {
 		return anAsset;
 	}
-	if (access((game_assets_path.relative + anAsset).c_str(), 0) == 0) {
+	if (file_system.Exists(game_assets_path.relative + anAsset)) {
 		return std::string(game_assets_path.relative + anAsset);
 	}
 	return std::string(game_assets_path.absolute + anAsset);
 }
 
 std::wstring Tga::Settings::ResolveGameAssetPathW(const std::string& anAsset) {
-	if (access(anAsset.c_str(), 0) == 0) {
+	if (file_system.Exists(anAsset)) {
 		return Tga::ToWstring(anAsset);
 	}
-	if (access((game_assets_path.relative + anAsset).c_str(), 0) == 0) {
+	if (file_system.Exists(game_assets_path.relative + anAsset)) {
 		return Tga::ToWstring(game_assets_path.relative + anAsset);
 	}
 	return Tga::ToWstring(game_assets_path.absolute + anAsset);
@@ -150,10 +153,10 @@ std::wstring Tga::Settings::ResolveGameAssetPathW(const std::string& anAsset) {
 std::wstring Tga::Settings::ResolveGameAssetPathW(const std::wstring& anAsset) 
 {
 	std::string asset = FromWstring(anAsset);
-	if (access(asset.c_str(), 0) == 0) {
+	if (file_system.Exists(asset)) {
 		return anAsset;
 	}
-	if (access((game_assets_path.relative + asset).c_str(), 0) == 0) {
+	if (file_system.Exists(game_assets_path.relative + asset)) {
 		return std::wstring(Tga::ToWstring(game_assets_path.relative) + anAsset);
 	}
 	return std::wstring(Tga::ToWstring(game_assets_path.absolute) + anAsset);
@@ -193,6 +196,23 @@ void Tga::LoadSettings(const std::string& aProjectName) {
 			game_assets_path.relative = game_settings["assets_path"]["game"]["relative"];
 		}
 
+		// Same order as the Resolve functions look in, the index makes every lookup after this a hash map lookup.
+		file_system.MountDirectory("");
+		file_system.MountDirectory("data/");
+		file_system.MountDirectory(game_assets_path.relative);
+		file_system.MountDirectory(engine_assets_path.relative);
+		file_system.MountDirectory(game_assets_path.absolute);
+		file_system.MountDirectory(engine_assets_path.absolute);
+
+		// A pack named after an asset root and placed next to it, like EngineAssets.pack next to EngineAssets/, is
+		// served as that root. Loose files in the root are still used over the packed ones.
+		for (const std::string& root : { std::string("data/"), game_assets_path.relative, engine_assets_path.relative }) {
+			const std::string pack = root.substr(0, root.find_last_not_of("/\\") + 1) + ".pack";
+			if (file_system.Exists(pack) && !file_system.MountPack(pack, root)) {
+				assert(false && "Asset pack is broken or was made for another version of the engine");
+			}
+		}
+
 		///////////////////////
 		// Read create params
 
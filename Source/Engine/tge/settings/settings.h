@@ -3,6 +3,8 @@
 #include <tge/engine.h>
 
 namespace Tga {
+	class VirtualFileSystem;
+
 	extern void LoadSettings(const std::string &aProjectName);
 	
 	namespace Settings {
@@ -12,6 +14,11 @@ namespace Tga {
 
 		extern const EngineConfiguration &GetEngineConfiguration();
 
+		/**
+		 * Index of the asset roots that the Resolve functions look files up in.
+		 */
+		extern VirtualFileSystem& GetFileSystem();
+
 		extern std::string ResolveAssetPath(const std::string& anAsset);
 		extern std::wstring ResolveAssetPathW(const std::string& anAsset);
 		extern std::wstring ResolveAssetPathW(const std::wstring& anAsset);
@@ -64,9 +64,12 @@ ModelVertexToPixel main(ModelVertexInput input)
 	float3x3 toWorldRotation = (float3x3)ObjectToWorld;
 	//float3 vertexWorldNormal = mul(toWorldRotation, input.myNormal);
 
-	float3 vertexWorldBinormal = mul(toWorldRotation, mul(skinnedRotation, input.binormal));
-	float3 vertexWorldTangent = mul(toWorldRotation, mul(skinnedRotation, input.tangent));
-	float3 vertexWorldNormal = mul(transpose(invertMatrix(toWorldRotation)), mul(transpose(invertMatrix(skinnedRotation)), input.normal));
+	float3 normal, tangent, binormal;
+	DecodeModelTangentFrame(input.normal, input.tangent, normal, tangent, binormal);
+
+	float3 vertexWorldBinormal = mul(toWorldRotation, mul(skinnedRotation, binormal));
+	float3 vertexWorldTangent = mul(toWorldRotation, mul(skinnedRotation, tangent));
+	float3 vertexWorldNormal = mul(transpose(invertMatrix(toWorldRotation)), mul(transpose(invertMatrix(skinnedRotation)), normal));
 
 	result.position = vertexProjectionPos;
 	result.worldPosition = vertexWorldPos;
@@ -2,7 +2,6 @@
 #include "InstancedModelShader.h"
 
 #include <tge/graphics/DX11.h>
-#include <tge/graphics/Vertex.h>
 #include <tge/model/ModelInstancer.h>
 
 Tga::InstancedModelShader::InstancedModelShader(Engine* anEngine)
@@ -36,6 +35,11 @@ void Tga::InstancedModelShader::Render(
 	UNREFERENCED_PARAMETER(someBones);
 	UNREFERENCED_PARAMETER(aModelData);
 
+	if (!myIsReadyToRender)
+	{
+		return;
+	}
+
 	{
 		ID3D11ShaderResourceView* resourceViews[4];
 		int i = 0;
@@ -45,20 +49,14 @@ void Tga::InstancedModelShader::Render(
 			i++;
 		}
 
-		DX11::Context->PSSetShaderResources(4, i, resourceViews);
-	}
-
-	if (!myIsReadyToRender)
-	{
-		return;
+		myCommands.SetShaderResources(4, i, resourceViews);
 	}
 
-	Shader::PrepareRender();
+	Shader::PrepareRender(myCommands);
 
-	ID3D11Buffer* mdlBuffers[2]{ nullptr, nullptr };
-	mdlBuffers[1] = aModelInstancer.GetInstanceBuffer();
-	UINT strides[2] = { sizeof(Vertex), sizeof(ModelInstancer::InstanceBufferData)};
-	UINT offsets[2] = { 0, 0};
+	ID3D11Buffer* mdlBuffers[3]{ nullptr, aModelInstancer.GetInstanceBuffer(), myInputLayouts.GetDefaultsBuffer() };
+	uint32_t strides[3] = { 0, sizeof(ModelInstancer::InstanceBufferData), 0 };
+	uint32_t offsets[3] = { 0, 0, 0 };
 
 	const std::shared_ptr<Model> model = aModelInstancer.myModel;
 	const std::vector<Model::MeshData>& meshDataList = model->GetMeshDataList();
@@ -67,14 +65,21 @@ void Tga::InstancedModelShader::Render(
 	for (int j = 0; j < meshCount; j++)
 	{
 		const Model::MeshData& meshData = meshDataList[j];
-		
+
+		ID3D11InputLayout* inputLayout = myInputLayouts.Get(meshData.VertexAttributes);
+		if (!inputLayout)
+		{
+			continue;
+		}
+		myCommands.SetInputLayout(inputLayout);
+
 		mdlBuffers[0] = meshData.VertexBuffer;
+		strides[0] = meshData.Stride;
 
-		DX11::Context->IASetVertexBuffers(0, 2, mdlBuffers, strides, offsets);
-		DX11::Context->IASetIndexBuffer(meshData.IndexBuffer, DXGI_FORMAT_R32_UINT, 0);
+		myCommands.SetVertexBuffers(0, 3, mdlBuffers, strides, offsets);
+		myCommands.SetIndexBuffer(meshData.IndexBuffer, RenderIndexFormat::UInt32);
 
-		DX11::Context->VSSetConstantBuffers((int)ConstantBufferSlot::Object, 1, &myObjectBuffer);
-		DX11::Context->PSSetConstantBuffers((int)ConstantBufferSlot::Object, 1, &myObjectBuffer);
+		myCommands.SetConstantBuffer(RenderStage_VertexAndPixel, (int)ConstantBufferSlot::Object, myObjectBuffer);
 
 		{
 			const TextureResource* const* textures = aModelInstancer.GetTextures(j);
@@ -86,43 +91,25 @@ void Tga::InstancedModelShader::Render(
 				i++;
 			}
 
-			DX11::Context->PSSetShaderResources(1, i, resourceViews);
+			myCommands.SetShaderResources(1, i, resourceViews);
 		}
 
-		DX11::LogDrawCall();
-		DX11::Context->DrawIndexedInstanced(meshData.NumberOfIndices, aModelInstancer.myBufferNumInstances, 0, 0, 0);
+		const MeshLOD lod = meshData.GetLOD(aModelInstancer.SelectLOD(j));
+		myCommands.DrawIndexedInstanced(lod.NumberOfIndices, aModelInstancer.myVisibleCount, lod.StartIndex, 0, 0);
 	}
+
+	SubmitCommands();
 }
 
 bool Tga::InstancedModelShader::CreateInputLayout(const std::string& aVS)
 {
-	D3D11_INPUT_ELEMENT_DESC layout[] =
+	// The per vertex part of the layout is picked per mesh in Render.
+	myInputLayouts.Init(aVS, DefaultsSlot,
 	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "COLOR", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "COLOR", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "COLOR", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-		{ "TEXCOORD", 1, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-		{ "TEXCOORD", 2, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-		{ "TEXCOORD", 3, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-		{ "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-		{ "BINORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-		{ "BONES", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "WEIGHTS", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 		{ "WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
 		{ "WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
 		{ "WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
 		{ "WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
-	};
-
-	unsigned int numElements = sizeof(layout) / sizeof(D3D11_INPUT_ELEMENT_DESC);
-	HRESULT result = DX11::Device->CreateInputLayout(&layout[0], numElements, aVS.data(), aVS.size(), myLayout.ReleaseAndGetAddressOf());
-	if (FAILED(result))
-	{
-		ERROR_PRINT("%s", "Layout error");
-	}
+	});
 	return true;
 }
@@ -2,6 +2,7 @@
 
 #include "shader.h"
 #include "ShaderCommon.h"
+#include "ModelInputLayouts.h"
 #include <tge/animation/Animation.h>
 #include <tge/math/CommonMath.h>
 #include <tge/math/matrix4x4.h>
@@ -25,7 +26,11 @@ namespace Tga
 		bool CreateInputLayout(const std::string& aVS) override;
 
 	private:
-		struct ID3D11Buffer* myBoneBuffer;
-		struct ID3D11Buffer* myObjectBuffer;
+		// Slot 1 holds the instances, the defaults for attributes a mesh doesn't store come after them.
+		static constexpr uint32_t DefaultsSlot = 2;
+
+		struct ID3D11Buffer* myBoneBuffer = nullptr;
+		struct ID3D11Buffer* myObjectBuffer = nullptr;
+		ModelInputLayouts myInputLayouts;
 	};
 }
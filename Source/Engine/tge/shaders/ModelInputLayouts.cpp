@@ -0,0 +1,88 @@
+#include "stdafx.h"
+#include <tge/shaders/ModelInputLayouts.h>
+#include <tge/graphics/DX11.h>
+#include <tge/graphics/VertexLayout.h>
+
+namespace Tga
+{
+
+namespace
+{
+	DXGI_FORMAT GetFormat(VertexElementFormat aFormat)
+	{
+		switch (aFormat)
+		{
+		case VertexElementFormat::Float3: return DXGI_FORMAT_R32G32B32_FLOAT;
+		case VertexElementFormat::Unorm8x4: return DXGI_FORMAT_R8G8B8A8_UNORM;
+		case VertexElementFormat::Half2: return DXGI_FORMAT_R16G16_FLOAT;
+		case VertexElementFormat::Snorm16x2: return DXGI_FORMAT_R16G16_SNORM;
+		case VertexElementFormat::Sint16x2: return DXGI_FORMAT_R16G16_SINT;
+		case VertexElementFormat::Uint8x4: return DXGI_FORMAT_R8G8B8A8_UINT;
+		}
+		return DXGI_FORMAT_UNKNOWN;
+	}
+}
+
+bool ModelInputLayouts::Init(const std::string& aVS, uint32_t aDefaultsSlot, std::vector<D3D11_INPUT_ELEMENT_DESC> someExtraElements)
+{
+	myVS = aVS;
+	myDefaultsSlot = aDefaultsSlot;
+	myExtraElements = std::move(someExtraElements);
+
+	{
+		std::lock_guard<std::mutex> lock(myMutex);
+		myLayouts.clear();
+	}
+
+	D3D11_BUFFER_DESC defaultsBufferDesc = {};
+	defaultsBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	defaultsBufferDesc.ByteWidth = VertexLayout::DefaultDataSize;
+	defaultsBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+	D3D11_SUBRESOURCE_DATA defaultsData = {};
+	defaultsData.pSysMem = VertexLayout::DefaultData;
+
+	HRESULT result = DX11::Device->CreateBuffer(&defaultsBufferDesc, &defaultsData, myDefaultsBuffer.ReleaseAndGetAddressOf());
+	if (FAILED(result))
+	{
+		ERROR_PRINT("%s", "Vertex defaults buffer error");
+		return false;
+	}
+
+	// Every mesh stores its positions, so this is the layout everything else builds on.
+	return Get(static_cast<uint32_t>(VertexAttribute::Position)) != nullptr;
+}
+
+ID3D11InputLayout* ModelInputLayouts::Get(uint32_t someAttributes) const
+{
+	std::lock_guard<std::mutex> lock(myMutex);
+	auto it = myLayouts.find(someAttributes);
+	if (it != myLayouts.end())
+	{
+		return it->second.Get();
+	}
+
+	VertexElement elements[VertexLayout::ElementCount];
+	VertexLayout::FromAttributes(someAttributes).GetElements(elements);
+
+	std::vector<D3D11_INPUT_ELEMENT_DESC> layout;
+	layout.reserve(VertexLayout::ElementCount + myExtraElements.size());
+	for (const VertexElement& element : elements)
+	{
+		const UINT slot = element.IsStored ? 0 : myDefaultsSlot;
+		layout.push_back({ element.SemanticName, element.SemanticIndex, GetFormat(element.Format), slot, element.Offset, D3D11_INPUT_PER_VERTEX_DATA, 0 });
+	}
+	layout.insert(layout.end(), myExtraElements.begin(), myExtraElements.end());
+
+	// Failures are remembered too, so a broken layout is reported once rather than every draw.
+	Microsoft::WRL::ComPtr<ID3D11InputLayout>& inputLayout = myLayouts[someAttributes];
+	HRESULT result = DX11::Device->CreateInputLayout(layout.data(), static_cast<UINT>(layout.size()), myVS.data(), myVS.size(), inputLayout.ReleaseAndGetAddressOf());
+	if (FAILED(result))
+	{
+		ERROR_PRINT("%s %x", "Layout error for vertex attributes", someAttributes);
+		inputLayout.Reset();
+	}
+	return inputLayout.Get();
+}
+
+} // namespace Tga
@@ -0,0 +1,44 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Tga
+{
+	/// <summary>
+	/// Input layouts for the model vertex shaders. A compact vertex only stores the attributes its mesh uses, so there is
+	/// one layout per attribute mask, created the first time a mesh with that mask is drawn. Attributes that aren't stored
+	/// are read from a small defaults buffer bound with a stride of zero.
+	/// </summary>
+	class ModelInputLayouts
+	{
+	public:
+		/**
+		 * @param aVS The vertex shader bytecode the layouts are created against.
+		 * @param aDefaultsSlot The vertex buffer slot the defaults buffer has to be bound to.
+		 * @param someExtraElements Elements read from other slots, such as per instance data.
+		 */
+		bool Init(const std::string& aVS, uint32_t aDefaultsSlot, std::vector<D3D11_INPUT_ELEMENT_DESC> someExtraElements = {});
+
+		/**
+		 * Safe to call from worker threads recording draws.
+		 * @returns nullptr if the layout couldn't be created, in which case nothing should be drawn.
+		 */
+		ID3D11InputLayout* Get(uint32_t someAttributes) const;
+
+		/** Bind to the defaults slot with a stride of zero. */
+		ID3D11Buffer* GetDefaultsBuffer() const { return myDefaultsBuffer.Get(); }
+
+	private:
+		std::string myVS;
+		uint32_t myDefaultsSlot = 0;
+		std::vector<D3D11_INPUT_ELEMENT_DESC> myExtraElements;
+		Microsoft::WRL::ComPtr<ID3D11Buffer> myDefaultsBuffer;
+
+		mutable std::mutex myMutex;
+		mutable std::unordered_map<uint32_t, Microsoft::WRL::ComPtr<ID3D11InputLayout>> myLayouts;
+	};
+} // namespace Tga
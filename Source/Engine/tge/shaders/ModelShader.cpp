@@ -60,10 +60,22 @@ bool  Tga::ModelShader::Init(const wchar_t* aVertexShaderFile, const wchar_t* aP
 	return Shader::CreateShaders(aVertexShaderFile, aPixelShaderFile, nullptr);
 }
 
-void Tga::ModelShader::Render(const TextureResource* const* someTextures, const Model::MeshData& aModelData, const Matrix4x4f& aObToWorld, const Matrix4x4f* someBones) const
+void Tga::ModelShader::Render(const TextureResource* const* someTextures, const Model::MeshData& aModelData, const Matrix4x4f& aObToWorld, const Matrix4x4f* someBones, int aLOD) const
 {
-	GraphicsStateStack& graphicsStateStack = Tga::Engine::GetInstance()->GetGraphicsEngine().GetGraphicsStateStack();
+	if (!myIsReadyToRender)
+	{
+		return;
+	}
+
+	GraphicsStateStack& graphicsStateStack = myGraphicsEngine->GetGraphicsStateStack();
+	graphicsStateStack.UpdateGpuStates();
 
+	Record(myCommands, someTextures, aModelData, aObToWorld * graphicsStateStack.GetTransform(), someBones, aLOD);
+	SubmitCommands();
+}
+
+void Tga::ModelShader::Record(RenderCommandBuffer& aCommands, const TextureResource* const* someTextures, const Model::MeshData& aModelData, const Matrix4x4f& aObToWorld, const Matrix4x4f* someBones, int aLOD) const
+{
 	{
 		ID3D11ShaderResourceView* resourceViews[4];
 		int i = 0;
@@ -73,84 +85,46 @@ void Tga::ModelShader::Render(const TextureResource* const* someTextures, const
 			i++;
 		}
 
-		DX11::Context->PSSetShaderResources(1, i, resourceViews);
+		aCommands.SetShaderResources(1, i, resourceViews);
 	}
 
-	if (!myIsReadyToRender)
+	if (!RecordShaderBinds(aCommands))
 	{
 		return;
 	}
 
-	Shader::PrepareRender();
-
-	HRESULT result;
-	D3D11_MAPPED_SUBRESOURCE mappedVResource;
-	result = DX11::Context->Map(myBoneBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedVResource);
-	if (FAILED(result))
+	ID3D11InputLayout* inputLayout = myInputLayouts.Get(aModelData.VertexAttributes);
+	if (!inputLayout)
 	{
-		//INFO_PRINT("Error in rendering!");
 		return;
 	}
-	char* dataVPtr = (char*)mappedVResource.pData;
-	if (someBones)
-	{
-		memcpy(dataVPtr, someBones, sizeof(Matrix4x4f) * MAX_ANIMATION_BONES);
-	}
-	
-	DX11::Context->Unmap(myBoneBuffer, 0);
-	DX11::Context->VSSetConstantBuffers((int)ConstantBufferSlot::Bones, 1, &myBoneBuffer);
+	aCommands.SetInputLayout(inputLayout);
 
-	result = DX11::Context->Map(myObjectBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedVResource);
-	if (FAILED(result))
+	// Static meshes use shaders that never read the bones, so there is nothing worth uploading for them.
+	if (someBones)
 	{
-		//INFO_PRINT("Error in rendering!");
-		return;
+		aCommands.WriteBuffer(myBoneBuffer, someBones, sizeof(Matrix4x4f) * MAX_ANIMATION_BONES);
 	}
-	dataVPtr = (char*)mappedVResource.pData;
+	aCommands.SetConstantBuffer(RenderStage_Vertex, (int)ConstantBufferSlot::Bones, myBoneBuffer);
 
-	CommonBuf* dataPtrCommon;
-	dataPtrCommon = (CommonBuf*)mappedVResource.pData;
-	dataPtrCommon->myObToWorld = aObToWorld * graphicsStateStack.GetTransform();
+	CommonBuf* dataPtrCommon = static_cast<CommonBuf*>(aCommands.WriteBuffer(myObjectBuffer, sizeof(CommonBuf)));
+	dataPtrCommon->myObToWorld = aObToWorld;
+	aCommands.SetConstantBuffer(RenderStage_VertexAndPixel, (int)ConstantBufferSlot::Object, myObjectBuffer);
 
-	DX11::Context->Unmap(myObjectBuffer, 0);
-	DX11::Context->VSSetConstantBuffers((int)ConstantBufferSlot::Object, 1, &myObjectBuffer);
-	DX11::Context->PSSetConstantBuffers((int)ConstantBufferSlot::Object, 1, &myObjectBuffer);
+	aCommands.SetIndexBuffer(aModelData.IndexBuffer, RenderIndexFormat::UInt32);
+	ID3D11Buffer* const buffers[2] = { aModelData.VertexBuffer, myInputLayouts.GetDefaultsBuffer() };
+	const uint32_t strides[2] = { aModelData.Stride, 0 };
+	const uint32_t offsets[2] = { 0, 0 };
+	aCommands.SetVertexBuffers(0, 2, buffers, strides, offsets);
 
-	DX11::Context->IASetIndexBuffer(aModelData.IndexBuffer, DXGI_FORMAT_R32_UINT, 0);
-	const unsigned int strides = aModelData.Stride;
-	const unsigned int offsets = 0;
-	DX11::Context->IASetVertexBuffers(0, 1, &aModelData.VertexBuffer, &strides, &offsets);
-
-	DX11::LogDrawCall();
-	DX11::Context->DrawIndexed(aModelData.NumberOfIndices, 0, 0);
+	const MeshLOD lod = aModelData.GetLOD(aLOD);
+	aCommands.DrawIndexed(lod.NumberOfIndices, lod.StartIndex, 0);
 }
 
 
 bool Tga::ModelShader::CreateInputLayout(const std::string& aVS)
 {
-	D3D11_INPUT_ELEMENT_DESC layout[] =
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "COLOR", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "COLOR", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "COLOR", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-		{ "TEXCOORD", 1, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-		{ "TEXCOORD", 2, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-		{ "TEXCOORD", 3, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-		{ "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-		{ "BINORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-		{ "BONES", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "WEIGHTS", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-	};
-
-	unsigned int numElements = sizeof(layout) / sizeof(D3D11_INPUT_ELEMENT_DESC);
-	HRESULT result = DX11::Device->CreateInputLayout(&layout[0], numElements, aVS.data(), aVS.size(), myLayout.ReleaseAndGetAddressOf());
-	if (FAILED(result))
-	{
-		ERROR_PRINT("%s", "Layout error");
-	}
+	// The layout is picked per mesh in Record.
+	myInputLayouts.Init(aVS, DefaultsSlot);
 	return true;
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "shader.h"
 #include "ShaderCommon.h"
+#include "ModelInputLayouts.h"
 #include <tge/animation/Animation.h>
 #include <tge/math/CommonMath.h>
 #include <tge/math/matrix4x4.h>
@@ -18,10 +19,21 @@ namespace Tga
 
 		bool Init() override;
 		bool Init(const wchar_t* aVertexShaderFile, const wchar_t* aPixelShaderFile);
-		void Render(const TextureResource* const* someTextures, const Model::MeshData& aModelData, const Matrix4x4f& aObToWorld, const Matrix4x4f* someBones = nullptr) const;
+		void Render(const TextureResource* const* someTextures, const Model::MeshData& aModelData, const Matrix4x4f& aObToWorld, const Matrix4x4f* someBones = nullptr, int aLOD = 0) const;
+
+		/**
+		 * Records everything Render would draw into aCommands without touching the graphics state stack or submitting,
+		 * so it can run on worker threads.
+		 * @param aObToWorld The final object matrix, including the graphics state stack transform.
+		 */
+		void Record(RenderCommandBuffer& aCommands, const TextureResource* const* someTextures, const Model::MeshData& aModelData, const Matrix4x4f& aObToWorld, const Matrix4x4f* someBones = nullptr, int aLOD = 0) const;
 		bool CreateInputLayout(const std::string& aVS) override;
 	private:
+		// The defaults for attributes a mesh doesn't store are bound after its vertex buffer.
+		static constexpr uint32_t DefaultsSlot = 1;
+
 		struct ID3D11Buffer* myBoneBuffer;
 		struct ID3D11Buffer* myObjectBuffer;
+		ModelInputLayouts myInputLayouts;
 	};
 } // namespace Tga
\ No newline at end of file
@@ -12,10 +12,13 @@ ModelVertexToPixel main(ModelVertexInput input)
 	float4 vertexViewPos = mul(WorldToCamera, vertexWorldPos);
 	float4 vertexProjectionPos = mul(CameraToProjection, vertexViewPos);
 
+	float3 normal, tangent, binormal;
+	DecodeModelTangentFrame(input.normal, input.tangent, normal, tangent, binormal);
+
 	float3x3 toWorldRotation = (float3x3)ObjectToWorld;
-	float3 vertexWorldNormal = mul(toWorldRotation, input.normal);
-	float3 vertexWorldBinormal = mul(toWorldRotation, input.binormal);
-	float3 vertexWorldTangent = mul(toWorldRotation, input.tangent);
+	float3 vertexWorldNormal = mul(toWorldRotation, normal);
+	float3 vertexWorldBinormal = mul(toWorldRotation, binormal);
+	float3 vertexWorldTangent = mul(toWorldRotation, tangent);
 	
 	result.position = vertexProjectionPos;
 	result.worldPosition = vertexWorldPos;
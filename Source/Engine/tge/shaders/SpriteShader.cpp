@@ -71,15 +71,13 @@ void Tga::SpriteShader::SetTextureAtRegister(Tga::TextureResource* aTexture, Sha
 	}
 }
 
-bool Tga::SpriteShader::PrepareRender(const SpriteSharedData& aSharedData)
+bool Tga::SpriteShader::PrepareRender(const SpriteSharedData& aSharedData, RenderCommandBuffer& aCommands)
 {
-	if (!Shader::PrepareRender())
+	if (!Shader::PrepareRender(aCommands))
 		return false;
 
 	Engine& engine = *Engine::GetInstance();
 
-	ID3D11DeviceContext* context = DX11::Context;
-
 	ID3D11ShaderResourceView* textures[1 + ShaderMap::MAP_MAX];
 
 	textures[0] = aSharedData.myTexture ? aSharedData.myTexture->GetShaderResourceView() : engine.GetTextureManager().GetWhiteSquareTexture()->GetShaderResourceView();
@@ -92,30 +90,24 @@ bool Tga::SpriteShader::PrepareRender(const SpriteSharedData& aSharedData)
 			textures[1 + index] = aSharedData.myMaps[index]->GetShaderResourceView();
 		}
 	}
-	DX11::Context->PSSetShaderResources(1, 1 + ShaderMap::MAP_MAX, textures);
+	aCommands.SetShaderResources(1, 1 + ShaderMap::MAP_MAX, textures);
 
 	if (myCustomBuffer)
 	{
-		D3D11_MAPPED_SUBRESOURCE mappedResourceCommon;
-		Tga::Vector4f* dataPtrCommon;
-		HRESULT result = context->Map(myCustomBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResourceCommon);
-		if (FAILED(result))
-		{
-			return false;
-		}
-
-		dataPtrCommon = (Tga::Vector4f*)mappedResourceCommon.pData;
-		for (int i = 0; i < myCurrentDataIndex + 1; i++)
+		if (myCurrentDataIndex >= 0)
 		{
-			dataPtrCommon[i].x = myCustomData[i].x;
-			dataPtrCommon[i].y = myCustomData[i].y;
-			dataPtrCommon[i].z = myCustomData[i].z;
-			dataPtrCommon[i].w = myCustomData[i].w;
+			// Only the values in use are written, the rest of the buffer is undefined after the discard just like before.
+			Tga::Vector4f* dataPtrCommon = static_cast<Tga::Vector4f*>(aCommands.WriteBuffer(myCustomBuffer.Get(), sizeof(Tga::Vector4f) * (myCurrentDataIndex + 1)));
+			for (int i = 0; i < myCurrentDataIndex + 1; i++)
+			{
+				dataPtrCommon[i].x = myCustomData[i].x;
+				dataPtrCommon[i].y = myCustomData[i].y;
+				dataPtrCommon[i].z = myCustomData[i].z;
+				dataPtrCommon[i].w = myCustomData[i].w;
+			}
 		}
 
-		context->Unmap(myCustomBuffer.Get(), 0);
-		context->VSSetConstantBuffers(myBufferIndex, 1, myCustomBuffer.GetAddressOf());
-		context->PSSetConstantBuffers(myBufferIndex, 1, myCustomBuffer.GetAddressOf());
+		aCommands.SetConstantBuffer(RenderStage_VertexAndPixel, myBufferIndex, myCustomBuffer.Get());
 	}
 
 	for (int i = 0; i < myCurrentTextureCount; i++)
@@ -123,7 +115,7 @@ bool Tga::SpriteShader::PrepareRender(const SpriteSharedData& aSharedData)
 		ID3D11ShaderResourceView* customTextures[1];
 		customTextures[0] = myBoundTextures[i].myTexture->GetShaderResourceView();
 
-		context->PSSetShaderResources(myBoundTextures[i].myIndex, 1, customTextures);
+		aCommands.SetShaderResources(myBoundTextures[i].myIndex, 1, customTextures);
 	}
 
 	return true;
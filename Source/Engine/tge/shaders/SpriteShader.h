@@ -55,7 +55,7 @@ namespace Tga
 		// Set a texture to the shader, the index: 0, 1, 2, 3 are reserved. Keep the index above this and register it with the same id in the shader
 		void SetTextureAtRegister(Tga::TextureResource* aTexture, ShaderTextureSlot aRegisterIndex);
 
-		bool PrepareRender(const SpriteSharedData& aSharedData);
+		bool PrepareRender(const SpriteSharedData& aSharedData, RenderCommandBuffer& aCommands);
 
 	protected:
 		bool CreateInputLayout(const std::string& aVS) override;
@@ -90,10 +90,10 @@ struct ModelVertexInput
 	float2 texCoord1	:	TEXCOORD1;
 	float2 texCoord2	:	TEXCOORD2;
 	float2 texCoord3	:	TEXCOORD3;
-	float3 normal		:	NORMAL;
-	float3 tangent		:	TANGENT;
-	float3 binormal	    :	BINORMAL;
-	float4 boneIndices  :   BONES;
+	// The compact encodings from VertexLayout.h, DecodeModelTangentFrame unpacks them.
+	float2 normal		:	NORMAL;
+	int2 tangent		:	TANGENT;
+	uint4 boneIndices   :   BONES;
 	float4 weights      :   WEIGHTS;
 };
 
@@ -177,4 +177,23 @@ float2 GetScreenCoords(float4 worldPosition)
 	projectedTextureCoords.y = viewToProj.y / viewToProj.w / 2.0f + 0.5f;
 
 	return projectedTextureCoords;
+}
+
+// Matches VertexQuantization::DecodeOctahedral, (0, 0) is +Z.
+float3 DecodeOctahedral(float2 anEncoded)
+{
+	float3 direction = float3(anEncoded, 1.0 - abs(anEncoded.x) - abs(anEncoded.y));
+	if (direction.z < 0)
+	{
+		direction.xy = (1.0 - abs(direction.yx)) * (direction.xy >= 0 ? 1.0 : -1.0);
+	}
+	return normalize(direction);
+}
+
+// The tangent is read as integers so the binormal sign survives in the lowest bit of y.
+void DecodeModelTangentFrame(float2 aNormal, int2 aTangent, out float3 outNormal, out float3 outTangent, out float3 outBinormal)
+{
+	outNormal = DecodeOctahedral(aNormal);
+	outTangent = DecodeOctahedral(max(float2(aTangent) / 32767.0, -1.0));
+	outBinormal = cross(outNormal, outTangent) * ((aTangent.y & 1) ? -1.0 : 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,33 @@
+#include "common.hlsli"
+
+SamplerState SampleType;
+
+Texture2D shaderTextures[2] : register( t1 );
+
+cbuffer DistanceFieldTextData : register(b6)
+{
+	// x: Field value at the outer edge of the border, 0.5 when there is no border.
+	float4 BorderData;
+};
+
+float4 main(SpriteVertexToPixel input) : SV_TARGET
+{
+	// The glyph edge is where the field crosses 0.5. Smoothing over one screen pixel keeps it sharp at any scale.
+	float distance = shaderTextures[0].Sample(SampleType, input.tex).a;
+	float smoothing = max(fwidth(distance) * 0.5f, 0.0001f);
+
+	float fill = smoothstep(0.5f - smoothing, 0.5f + smoothing, distance);
+	float coverage = smoothstep(BorderData.x - smoothing, BorderData.x + smoothing, distance);
+
+	// Borders are black like the ones rasterized for bitmap fonts.
+	float4 color = float4(input.color.rgb * fill, input.color.a * coverage);
+	color.rgb *= AmbientLightColorAndIntensity.xyz;
+
+	if (color.a <= alphaTestThreshold)
+	{
+		discard;
+		return float4(0.0f, 0.0f, 0.0f, 0.0f);
+	}
+
+	return color;
+}
@@ -11,10 +11,9 @@ struct VertexInputType
 	float2 texCoord1	:	TEXCOORD1;
 	float2 texCoord2	:	TEXCOORD2;
 	float2 texCoord3	:	TEXCOORD3;
-	float3 normal		:	NORMAL;
-	float3 tangent		:	TANGENT;
-	float3 binormal	    :	BINORMAL;
-	float4 boneIndices  :   BONES;
+	float2 normal		:	NORMAL;
+	int2 tangent		:	TANGENT;
+	uint4 boneIndices   :   BONES;
 	float4 weights      :   WEIGHTS;
 	float4x4 world	:	WORLD;
 };
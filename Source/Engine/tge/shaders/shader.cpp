@@ -120,19 +120,34 @@ bool Tga::Shader::CreateShaders(const wchar_t* aVertex, const wchar_t* aPixel, c
 	return true;
 }
 
-bool Tga::Shader::PrepareRender() const
+bool Tga::Shader::PrepareRender(RenderCommandBuffer& aCommands) const
 {
-	if (!myVertexShader || !myPixelShader || !myIsReadyToRender || !myEngine)
+	if (!RecordShaderBinds(aCommands))
 	{
 		return false;
 	}
 
-	DX11::Context->VSSetShader(myVertexShader.Get(), NULL, 0);
-	DX11::Context->PSSetShader(myPixelShader.Get(), NULL, 0);
-	DX11::Context->IASetInputLayout(myLayout.Get());
-	DX11::Context->IASetPrimitiveTopology(D3D10_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
+	// The state stack submits its own binds right away, so they run before the commands recorded here.
 	myGraphicsEngine->GetGraphicsStateStack().UpdateGpuStates();
 
 	return true;
 }
+
+bool Tga::Shader::RecordShaderBinds(RenderCommandBuffer& aCommands) const
+{
+	if (!myVertexShader || !myPixelShader || !myIsReadyToRender || !myEngine)
+	{
+		return false;
+	}
+
+	aCommands.SetShaders(myVertexShader.Get(), myPixelShader.Get());
+	aCommands.SetInputLayout(myLayout.Get());
+	aCommands.SetTopology(RenderTopology::TriangleList);
+
+	return true;
+}
+
+void Tga::Shader::SubmitCommands() const
+{
+	myGraphicsEngine->Submit(myCommands);
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <tge/math/matrix4x4.h>
+#include <tge/render/RenderCommandBuffer.h>
 #include <tge/render/RenderObject.h>
 #include <d3dcommon.h>
 #include <d3d11.h>
@@ -22,11 +23,26 @@ namespace Tga
 
 		typedef std::function<void(const std::string& aBlob)> callback_layout;
 		bool CreateShaders(const wchar_t* aVertex, const wchar_t* aPixel, callback_layout aLayout = nullptr);
-        bool PrepareRender() const;
+        /**
+         * Records the shader, input layout and topology binds into aCommands and applies the graphics state stack.
+         * @returns False if the shader isn't ready, in which case nothing should be drawn.
+         */
+        bool PrepareRender(RenderCommandBuffer& aCommands) const;
+
+        /**
+         * Only records the binds, without touching the graphics state stack, so it is safe on worker threads.
+         * Whoever submits the commands has to call UpdateGpuStates on the state stack first.
+         */
+        bool RecordShaderBinds(RenderCommandBuffer& aCommands) const;
 
     protected:
 		virtual bool CreateInputLayout(const std::string& aVS) { aVS; return false; }
         void DoOneFrameUpdates() const;
+        // Hands myCommands to the graphics engine's render backend.
+        void SubmitCommands() const;
+
+        // Commands recorded by derived drawers and shaders, submitted once per draw.
+        mutable RenderCommandBuffer myCommands;
         ComPtr<ID3D11VertexShader> myVertexShader;    // the vertex shader
         ComPtr<ID3D11PixelShader> myPixelShader;     // the pixel shader
         ComPtr<ID3D11InputLayout> myLayout;            // the pointer to the input layout
@@ -0,0 +1,127 @@
+#include "stdafx.h"
+#include "DistanceField.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace Tga;
+
+namespace
+{
+	constexpr float Infinity = 1e20f;
+
+	struct Scratch
+	{
+		std::vector<float> f;
+		std::vector<float> z;
+		std::vector<int> v;
+	};
+
+	/**
+	 * Squared euclidean distance transform of one row or column, Felzenszwalb and Huttenlocher's lower envelope of
+	 * parabolas. someValues holds 0 on features and Infinity elsewhere going in, squared distances coming out.
+	 */
+	void Transform1D(float* someValues, int aCount, int aStride, Scratch& aScratch)
+	{
+		float* f = aScratch.f.data();
+		float* z = aScratch.z.data();
+		int* v = aScratch.v.data();
+
+		for (int i = 0; i < aCount; i++)
+		{
+			f[i] = someValues[i * aStride];
+		}
+
+		int k = 0;
+		v[0] = 0;
+		z[0] = -Infinity;
+		z[1] = Infinity;
+
+		for (int q = 1; q < aCount; q++)
+		{
+			float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+			while (s <= z[k])
+			{
+				k--;
+				s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+			}
+			k++;
+			v[k] = q;
+			z[k] = s;
+			z[k + 1] = Infinity;
+		}
+
+		k = 0;
+		for (int q = 0; q < aCount; q++)
+		{
+			while (z[k + 1] < q)
+			{
+				k++;
+			}
+			const float distance = static_cast<float>(q - v[k]);
+			someValues[q * aStride] = distance * distance + f[v[k]];
+		}
+	}
+
+	void Transform2D(std::vector<float>& someValues, int aWidth, int aHeight, Scratch& aScratch)
+	{
+		for (int x = 0; x < aWidth; x++)
+		{
+			Transform1D(someValues.data() + x, aHeight, aWidth, aScratch);
+		}
+		for (int y = 0; y < aHeight; y++)
+		{
+			Transform1D(someValues.data() + y * aWidth, aWidth, 1, aScratch);
+		}
+	}
+}
+
+void DistanceField::Generate(const uint8_t* someCoverage, int aWidth, int aHeight, int aDownsample, float aSpread, uint8_t* outField)
+{
+	const size_t pixelCount = static_cast<size_t>(aWidth) * aHeight;
+
+	Scratch scratch;
+	const int longestSide = std::max(aWidth, aHeight);
+	scratch.f.resize(longestSide);
+	scratch.z.resize(longestSide + 1);
+	scratch.v.resize(longestSide);
+
+	// Distance from every pixel to the closest inside pixel, and to the closest outside pixel.
+	std::vector<float> toInside(pixelCount);
+	std::vector<float> toOutside(pixelCount);
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		const bool isInside = someCoverage[i] >= 128;
+		toInside[i] = isInside ? 0.0f : Infinity;
+		toOutside[i] = isInside ? Infinity : 0.0f;
+	}
+
+	Transform2D(toInside, aWidth, aHeight, scratch);
+	Transform2D(toOutside, aWidth, aHeight, scratch);
+
+	// The edge is half way between an inside and an outside pixel. Each output pixel averages the signed distances of
+	// the block it covers.
+	const int outWidth = aWidth / aDownsample;
+	const int outHeight = aHeight / aDownsample;
+	const float toOutputUnits = 1.0f / (aDownsample * aDownsample * aDownsample * aSpread * 2.0f);
+
+	for (int outY = 0; outY < outHeight; outY++)
+	{
+		for (int outX = 0; outX < outWidth; outX++)
+		{
+			float sum = 0.0f;
+			for (int y = outY * aDownsample; y < (outY + 1) * aDownsample; y++)
+			{
+				for (int x = outX * aDownsample; x < (outX + 1) * aDownsample; x++)
+				{
+					const size_t i = static_cast<size_t>(y) * aWidth + x;
+					sum += toInside[i] > 0.0f ? -(std::sqrt(toInside[i]) - 0.5f) : std::sqrt(toOutside[i]) - 0.5f;
+				}
+			}
+
+			const float value = std::clamp(0.5f + sum * toOutputUnits, 0.0f, 1.0f);
+			outField[outY * outWidth + outX] = static_cast<uint8_t>(value * 255.0f + 0.5f);
+		}
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+
+namespace Tga
+{
+
+/// <summary>
+/// Builds signed distance fields from coverage bitmaps, for text that stays sharp at any scale.
+/// </summary>
+namespace DistanceField
+{
+	/**
+	 * Turns a high resolution coverage bitmap into a distance field aDownsample times smaller in each direction.
+	 * Pixels with coverage of at least 128 are inside. The bitmap should have aSpread * aDownsample empty pixels on
+	 * every side, or the field gets cut off at the edges.
+	 * @param aWidth, aHeight Size of someCoverage. Must be multiples of aDownsample.
+	 * @param aSpread Distance in output pixels that maps to the full 0-255 range. 128 is on the edge, higher is inside.
+	 * @param outField (aWidth / aDownsample) * (aHeight / aDownsample) values.
+	 */
+	void Generate(const uint8_t* someCoverage, int aWidth, int aHeight, int aDownsample, float aSpread, uint8_t* outField);
+}
+
+} // namespace Tga
@@ -0,0 +1,191 @@
+#include "stdafx.h"
+#include "GlyphAtlas.h"
+
+#include <tge/graphics/DX11.h>
+
+using namespace Tga;
+
+GlyphAtlas::GlyphAtlas() {}
+GlyphAtlas::~GlyphAtlas() {}
+
+void GlyphAtlas::Init(int aPageSize, uint32_t aMaxPageCount)
+{
+	myPageSize = aPageSize;
+	myMaxPageCount = aMaxPageCount;
+}
+
+void GlyphAtlas::BeginFrame()
+{
+	myFrame++;
+}
+
+bool GlyphAtlas::CreatePage()
+{
+	// Pages start out cleared so the padding between glyphs never samples garbage.
+	std::vector<uint32_t> clear(static_cast<size_t>(myPageSize) * myPageSize, 0);
+
+	D3D11_SUBRESOURCE_DATA data;
+	data.pSysMem = clear.data();
+	data.SysMemPitch = myPageSize * 4;
+	data.SysMemSlicePitch = 0;
+
+	D3D11_TEXTURE2D_DESC info = {};
+	info.Width = myPageSize;
+	info.Height = myPageSize;
+	info.MipLevels = 1;
+	info.ArraySize = 1;
+	info.SampleDesc.Count = 1;
+	info.SampleDesc.Quality = 0;
+	info.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	info.Usage = D3D11_USAGE_DEFAULT;
+	info.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	info.CPUAccessFlags = 0;
+	info.MiscFlags = 0;
+
+	std::unique_ptr<Page> page = std::make_unique<Page>();
+	HRESULT hr = DX11::Device->CreateTexture2D(&info, &data, page->texture.ReleaseAndGetAddressOf());
+	if (FAILED(hr))
+	{
+		ERROR_PRINT("%s", "Failed to create glyph atlas page!");
+		return false;
+	}
+
+	ComPtr<ID3D11ShaderResourceView> view;
+	hr = DX11::Device->CreateShaderResourceView(page->texture.Get(), nullptr, view.ReleaseAndGetAddressOf());
+	if (FAILED(hr))
+	{
+		ERROR_PRINT("%s", "Failed to create glyph atlas page view!");
+		return false;
+	}
+
+	page->textureResource.SetShaderResourceView(view.Get());
+	page->packer.Init(myPageSize, myPageSize);
+	myPages.push_back(std::move(page));
+	return true;
+}
+
+GlyphAtlas::Page* GlyphAtlas::FindPageToEvict()
+{
+	Page* oldest = nullptr;
+	for (std::unique_ptr<Page>& page : myPages)
+	{
+		if (page->lastUsedFrame < myFrame && (!oldest || page->lastUsedFrame < oldest->lastUsedFrame))
+		{
+			oldest = page.get();
+		}
+	}
+	return oldest;
+}
+
+bool GlyphAtlas::Add(int aWidth, int aHeight, const uint32_t* somePixels, GlyphAtlasRegion& outRegion)
+{
+	if (aWidth <= 0 || aHeight <= 0 || aWidth > myPageSize || aHeight > myPageSize)
+	{
+		return false;
+	}
+
+	int x = 0;
+	int y = 0;
+	uint32_t pageIndex = 0;
+	for (; pageIndex < myPages.size(); pageIndex++)
+	{
+		if (myPages[pageIndex]->packer.Pack(aWidth, aHeight, x, y))
+		{
+			break;
+		}
+	}
+
+	if (pageIndex == myPages.size())
+	{
+		Page* evicted = myPages.size() >= myMaxPageCount ? FindPageToEvict() : nullptr;
+		if (evicted)
+		{
+			evicted->packer.Clear();
+			evicted->generation++;
+			myEvictionCount++;
+
+			for (pageIndex = 0; myPages[pageIndex].get() != evicted; pageIndex++) {}
+		}
+		else if (!CreatePage())
+		{
+			return false;
+		}
+
+		if (!myPages[pageIndex]->packer.Pack(aWidth, aHeight, x, y))
+		{
+			return false;
+		}
+	}
+
+	Page& page = *myPages[pageIndex];
+	page.lastUsedFrame = myFrame;
+
+	const float pageSize = static_cast<float>(myPageSize);
+	outRegion.myPage = pageIndex;
+	outRegion.myPageGeneration = page.generation;
+	outRegion.myX = x;
+	outRegion.myY = y;
+	outRegion.myTopLeftUV = { x / pageSize, y / pageSize };
+	outRegion.myBottomRightUV = { (x + aWidth) / pageSize, (y + aHeight) / pageSize };
+
+	PendingUpload upload;
+	upload.page = pageIndex;
+	upload.pageGeneration = page.generation;
+	upload.x = x;
+	upload.y = y;
+	upload.width = aWidth;
+	upload.height = aHeight;
+	upload.firstPixel = myPendingPixels.size();
+	myPendingUploads.push_back(upload);
+	myPendingPixels.insert(myPendingPixels.end(), somePixels, somePixels + static_cast<size_t>(aWidth) * aHeight);
+
+	return true;
+}
+
+bool GlyphAtlas::IsValid(const GlyphAtlasRegion& aRegion) const
+{
+	return aRegion.myPage < myPages.size() && myPages[aRegion.myPage]->generation == aRegion.myPageGeneration;
+}
+
+void GlyphAtlas::MarkUsed(uint32_t aPage)
+{
+	if (aPage < myPages.size())
+	{
+		myPages[aPage]->lastUsedFrame = myFrame;
+	}
+}
+
+void GlyphAtlas::Upload()
+{
+	for (const PendingUpload& upload : myPendingUploads)
+	{
+		// Bitmaps for a page that has been evicted since they were queued would overwrite its new glyphs.
+		Page& page = *myPages[upload.page];
+		if (page.generation != upload.pageGeneration)
+		{
+			continue;
+		}
+
+		D3D11_BOX box;
+		box.left = upload.x;
+		box.top = upload.y;
+		box.front = 0;
+		box.right = upload.x + upload.width;
+		box.bottom = upload.y + upload.height;
+		box.back = 1;
+
+		DX11::Context->UpdateSubresource(page.texture.Get(), 0, &box, myPendingPixels.data() + upload.firstPixel, upload.width * 4, 0);
+	}
+
+	myPendingUploads.clear();
+	myPendingPixels.clear();
+}
+
+const TextureResource* GlyphAtlas::GetTexture(uint32_t aPage) const
+{
+	if (aPage >= myPages.size())
+	{
+		return nullptr;
+	}
+	return &myPages[aPage]->textureResource;
+}
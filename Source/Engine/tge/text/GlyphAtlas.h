@@ -0,0 +1,114 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <tge/graphics/TextureResource.h>
+#include <tge/math/vector2.h>
+#include <tge/text/SkylinePacker.h>
+
+struct ID3D11Texture2D;
+
+namespace Tga
+{
+
+/// <summary>
+/// Where a glyph bitmap ended up in the GlyphAtlas. Only valid as long as GlyphAtlas::IsValid says so, the page it is
+/// on can be evicted and handed to other glyphs.
+/// </summary>
+struct GlyphAtlasRegion
+{
+	uint32_t myPage = 0;
+	uint32_t myPageGeneration = 0;
+	int myX = 0;
+	int myY = 0;
+	Vector2f myTopLeftUV;
+	Vector2f myBottomRightUV;
+};
+
+/// <summary>
+/// Texture pages that the glyphs of every font and size share. Pages are created when the glyphs in use don't fit in
+/// the ones there are. Once the page budget is reached, the page that was least recently drawn from is cleared and
+/// reused. Bitmaps are queued and uploaded together by Upload, so rasterizing a string only updates each page once.
+/// </summary>
+class GlyphAtlas
+{
+public:
+	GlyphAtlas();
+	~GlyphAtlas();
+
+	/**
+	 * @param aPageSize Width and height of each page in pixels.
+	 * @param aMaxPageCount Pages to keep before evicting. Goes over it rather than evicting a page drawn from this frame.
+	 */
+	void Init(int aPageSize = 512, uint32_t aMaxPageCount = 4);
+
+	/**
+	 * Advances the frame counter the least recently used page is picked by.
+	 */
+	void BeginFrame();
+
+	/**
+	 * Reserves room for an aWidth x aHeight bitmap and queues it for upload. Marks the page as used this frame.
+	 * @param somePixels RGBA, aWidth pixels per row.
+	 * @returns False if the bitmap is larger than a page or a page couldn't be created.
+	 */
+	bool Add(int aWidth, int aHeight, const uint32_t* somePixels, GlyphAtlasRegion& outRegion);
+
+	/**
+	 * @returns False if the region's page has been evicted since the region was handed out.
+	 */
+	bool IsValid(const GlyphAtlasRegion& aRegion) const;
+
+	/**
+	 * Keeps aPage from being evicted this frame.
+	 */
+	void MarkUsed(uint32_t aPage);
+
+	/**
+	 * Copies every queued bitmap to its page. Has to be called before drawing with the pages.
+	 */
+	void Upload();
+
+	const TextureResource* GetTexture(uint32_t aPage) const;
+	uint32_t GetPageCount() const { return static_cast<uint32_t>(myPages.size()); }
+	int GetPageSize() const { return myPageSize; }
+
+	/**
+	 * Goes up every time a page is evicted, so cached layouts know to look up their glyphs again.
+	 */
+	uint32_t GetEvictionCount() const { return myEvictionCount; }
+
+private:
+	struct Page
+	{
+		SkylinePacker packer;
+		ComPtr<ID3D11Texture2D> texture;
+		TextureResource textureResource;
+		uint32_t generation = 0;
+		uint64_t lastUsedFrame = 0;
+	};
+
+	struct PendingUpload
+	{
+		uint32_t page;
+		uint32_t pageGeneration;
+		int x;
+		int y;
+		int width;
+		int height;
+		size_t firstPixel;
+	};
+
+	bool CreatePage();
+	Page* FindPageToEvict();
+
+	std::vector<std::unique_ptr<Page>> myPages;
+	std::vector<PendingUpload> myPendingUploads;
+	std::vector<uint32_t> myPendingPixels;
+	uint64_t myFrame = 1;
+	uint32_t myEvictionCount = 0;
+	int myPageSize = 512;
+	uint32_t myMaxPageCount = 4;
+};
+
+} // namespace Tga
@@ -0,0 +1,130 @@
+#include "stdafx.h"
+#include "SkylinePacker.h"
+
+#include <algorithm>
+
+using namespace Tga;
+
+void SkylinePacker::Init(int aWidth, int aHeight)
+{
+	myWidth = aWidth;
+	myHeight = aHeight;
+	Clear();
+}
+
+void SkylinePacker::Clear()
+{
+	mySkyline.clear();
+	mySkyline.push_back({ 0, 0, myWidth });
+	myUsedArea = 0;
+}
+
+int SkylinePacker::FindY(size_t anIndex, int aWidth, int aHeight) const
+{
+	if (mySkyline[anIndex].x + aWidth > myWidth)
+	{
+		return -1;
+	}
+
+	int y = 0;
+	int widthLeft = aWidth;
+	for (size_t i = anIndex; widthLeft > 0; i++)
+	{
+		y = std::max(y, mySkyline[i].y);
+		if (y + aHeight > myHeight)
+		{
+			return -1;
+		}
+		widthLeft -= mySkyline[i].width;
+	}
+
+	return y;
+}
+
+bool SkylinePacker::Pack(int aWidth, int aHeight, int& outX, int& outY)
+{
+	if (aWidth <= 0 || aHeight <= 0)
+	{
+		return false;
+	}
+
+	size_t bestIndex = mySkyline.size();
+	int bestTop = myHeight + 1;
+	int bestWidth = myWidth + 1;
+	int bestY = 0;
+
+	for (size_t i = 0; i < mySkyline.size(); i++)
+	{
+		const int y = FindY(i, aWidth, aHeight);
+		if (y < 0)
+		{
+			continue;
+		}
+
+		// Lowest top edge first, then the narrowest segment so wide gaps stay free for wide rectangles.
+		const int top = y + aHeight;
+		if (top < bestTop || (top == bestTop && mySkyline[i].width < bestWidth))
+		{
+			bestIndex = i;
+			bestTop = top;
+			bestWidth = mySkyline[i].width;
+			bestY = y;
+		}
+	}
+
+	if (bestIndex == mySkyline.size())
+	{
+		return false;
+	}
+
+	outX = mySkyline[bestIndex].x;
+	outY = bestY;
+
+	// The new segment covers the rectangle's top edge. Whatever it overlaps of the segments after it is cut away.
+	const Segment added = { outX, bestTop, aWidth };
+	mySkyline.insert(mySkyline.begin() + bestIndex, added);
+
+	const int addedEnd = added.x + added.width;
+	size_t next = bestIndex + 1;
+	while (next < mySkyline.size() && mySkyline[next].x < addedEnd)
+	{
+		Segment& segment = mySkyline[next];
+		const int segmentEnd = segment.x + segment.width;
+		if (segmentEnd <= addedEnd)
+		{
+			mySkyline.erase(mySkyline.begin() + next);
+			continue;
+		}
+
+		segment.width = segmentEnd - addedEnd;
+		segment.x = addedEnd;
+		break;
+	}
+
+	// Neighbours at the same height are merged so the skyline doesn't fragment.
+	for (size_t i = 0; i + 1 < mySkyline.size();)
+	{
+		if (mySkyline[i].y == mySkyline[i + 1].y)
+		{
+			mySkyline[i].width += mySkyline[i + 1].width;
+			mySkyline.erase(mySkyline.begin() + i + 1);
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	myUsedArea += static_cast<long long>(aWidth) * aHeight;
+	return true;
+}
+
+float SkylinePacker::GetOccupancy() const
+{
+	if (myWidth <= 0 || myHeight <= 0)
+	{
+		return 0.0f;
+	}
+
+	return static_cast<float>(myUsedArea) / (static_cast<float>(myWidth) * static_cast<float>(myHeight));
+}
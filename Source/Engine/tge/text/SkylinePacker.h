@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+namespace Tga
+{
+
+/// <summary>
+/// Packs rectangles into a fixed size area by keeping track of the top edge ("skyline") of everything placed so far.
+/// Each rectangle goes where its top ends up lowest. Rectangles can't be freed one by one, only all at once with Clear.
+/// </summary>
+class SkylinePacker
+{
+public:
+	void Init(int aWidth, int aHeight);
+
+	/**
+	 * Forgets every packed rectangle.
+	 */
+	void Clear();
+
+	/**
+	 * Finds room for an aWidth x aHeight rectangle and marks it as used.
+	 * @returns False if there is no room left for it.
+	 */
+	bool Pack(int aWidth, int aHeight, int& outX, int& outY);
+
+	int GetWidth() const { return myWidth; }
+	int GetHeight() const { return myHeight; }
+
+	/**
+	 * @returns How much of the area the packed rectangles cover, between 0 and 1.
+	 */
+	float GetOccupancy() const;
+
+private:
+	struct Segment
+	{
+		int x;
+		int y;
+		int width;
+	};
+
+	/**
+	 * @returns The y an aWidth wide rectangle starting at segment anIndex would have to be placed at, or -1 if it
+	 * sticks out of the area.
+	 */
+	int FindY(size_t anIndex, int aWidth, int aHeight) const;
+
+	std::vector<Segment> mySkyline;
+	int myWidth = 0;
+	int myHeight = 0;
+	long long myUsedArea = 0;
+};
+
+} // namespace Tga
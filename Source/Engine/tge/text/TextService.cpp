@@ -15,23 +15,25 @@
 #include FT_OUTLINE_H
 
 #include <tge/drawers/SpriteDrawer.h>
+#include <tge/drawers/SpritePacking.h>
 #include <tge/graphics/DX11.h>
 #include <tge/graphics/GraphicsEngine.h>
 #include <tge/text/TextService.h>
+#include <tge/text/DistanceField.h>
+#include <tge/shaders/SpriteShader.h>
 #include <tge/texture/TextureManager.h>
 #include <tge/text/textfile.h>
 #include <tge/text/fontfile.h>
 #include <tge/sprite/sprite.h>
 #include <tge/text/text.h>
 #include <tge/engine.h>
-#include <tge/util/StringCast.h>
+#include <tge/filesystem/FileView.h>
+#include <tge/filesystem/VirtualFileSystem.h>
 #include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <sstream>
-
-#define X_OFFSET 8
-#define X_START 2
-#define Y_OFFSET 8
+#include <thread>
 
 using namespace Tga;
 using Microsoft::WRL::ComPtr;
@@ -40,8 +42,8 @@ namespace Tga
 {
 	struct CharData
 	{
-		Vector2f myTopLeftUV;
-		Vector2f myBottomRightUV;
+		// Where the bitmap is in the shared glyph atlas. Unused if myHasBitmap is false.
+		GlyphAtlasRegion myRegion;
 
 		short myWidth;
 		short myHeight;
@@ -49,23 +51,29 @@ namespace Tga
 		short myAdvanceY;
 		short myBearingX;
 		short myBearingY;
-		char myChar;
+		uint32_t myCodepoint;
+		bool myHasBitmap;
 	};
 
 	class InternalTextAndFontData
 	{
 	public:
 		~InternalTextAndFontData();
-		CharData myCharData[1024];
-		unsigned int myAtlasWidth;
-		unsigned int myAtlasHeight;
+
+		// Glyphs are rasterized the first time they are used, so this only ever holds what has been drawn or measured.
+		mutable std::unordered_map<uint32_t, CharData> myCharData;
+		mutable struct FT_FaceRec_* myFace = nullptr;
+		// FreeType reads the face from this for as long as it is open.
+		FileView myFontFile;
 		float myLineSpacing;
 		unsigned int myWordSpacing;
 		unsigned int myFontHeightWidth;
-		std::vector<int> myAtlas;
+		unsigned char myBorderSize;
 		std::wstring myName;
-		std::unique_ptr<TextureResource> myTexture;
-		ComPtr<ID3D11ShaderResourceView> myAtlasView;
+
+		// Distance field fonts are rasterized larger than myFontHeightWidth and keep their metrics in those units.
+		bool myIsDistanceField = false;
+		float myUnitsPerPixel = 1.0f;
 	};
 }
 
@@ -75,9 +83,19 @@ struct TextToRender
 	Vector2f myUvStart;
 	Vector2f myUvEnd;
 	Vector2f myPosition;
+	uint32_t myPage;
 	bool isWhitespace;
 };
 
+// Space left around every glyph in the atlas so bilinear filtering never picks up its neighbours.
+static constexpr int GlyphPadding = 2;
+
+// Distance field glyphs are stored at this pixel size. Their outlines are rasterized DistanceFieldSupersampling times
+// larger, and the field covers DistanceFieldSpread pixels on each side of the edge, which also limits border sizes.
+static constexpr int DistanceFieldSize = 40;
+static constexpr int DistanceFieldSupersampling = 4;
+static constexpr int DistanceFieldSpread = 4;
+
 struct GlyphLoader
 {
 	struct CountData
@@ -95,8 +113,8 @@ struct GlyphLoader
 
 	};
 
-	void LoadGlyph(int index, int& atlasX, int& atlasY, int& maxY, float atlasWidth, float atlasHeight, InternalTextAndFontData* aFontData, struct FT_FaceRec_* aFace, int aBorderWidth = 0);
-	void LoadOutline(const int index, const int atlasX, const int atlasY, const float atlasWidth, InternalTextAndFontData* aFontData, struct FT_FaceRec_* aFace, int aBorderWidth);
+	void LoadGlyph(int index, int bitmapX, int bitmapY, int bitmapWidth, int bitmapHeight, std::vector<int>& someBitmap, CharData& outGlyphData, struct FT_FaceRec_* aFace, int aBorderWidth = 0);
+	void LoadOutline(const int index, const int bitmapX, const int bitmapY, const int bitmapWidth, const int bitmapHeight, std::vector<int>& someBitmap, struct FT_FaceRec_* aFace, int aBorderWidth);
 	void CalculateOutlineOffsets(const int index, struct FT_FaceRec_* aFace, int aBorderWidth);
 	void CalculateGlyphOffsets(const int index, struct FT_GlyphSlotRec_* glyph);
 
@@ -265,7 +283,7 @@ int Color32Reverse(int x)
 	return returner;
 }
 
-void GlyphLoader::LoadGlyph(int index, int& atlasX, int& atlasY, int& maxY, float atlasWidth, float atlasHeight, InternalTextAndFontData* aFontData, FT_FaceRec_* aFace, int aBorderOffset)
+void GlyphLoader::LoadGlyph(int index, int bitmapX, int bitmapY, int bitmapWidth, int bitmapHeight, std::vector<int>& someBitmap, CharData& outGlyphData, FT_FaceRec_* aFace, int aBorderOffset)
 {
 	FT_Error error = FT_Load_Char(aFace, index, FT_LOAD_RENDER);
 	if (error != 0)
@@ -280,52 +298,40 @@ void GlyphLoader::LoadGlyph(int index, int& atlasX, int& atlasY, int& maxY, floa
 	int height = bitmap.rows;
 	int width = bitmap.width;
 
-	CharData glyphData;
-	glyphData.myChar = static_cast<char>(index); 
+	CharData glyphData = {};
+	glyphData.myCodepoint = static_cast<uint32_t>(index);
 	glyphData.myHeight = static_cast<short>(height + (aBorderOffset * 2));
 	glyphData.myWidth = static_cast<short>(width + (aBorderOffset * 2));
-
-	glyphData.myTopLeftUV = { (float(atlasX) / atlasWidth), (float(atlasY) / atlasHeight) };
-	glyphData.myBottomRightUV = { (float(atlasX + glyphData.myWidth) / atlasWidth), (float(atlasY + glyphData.myHeight) / atlasHeight) };
 	 
 	glyphData.myAdvanceX = static_cast<short>(slot->advance.x) >> 6;
 	glyphData.myAdvanceY = static_cast<short>(slot->advance.y) >> 6;
 
 	glyphData.myBearingX = (short)slot->bitmap_left;
 	glyphData.myBearingY = (short)slot->bitmap_top;
-	if (glyphData.myTopLeftUV.x > 1 || glyphData.myTopLeftUV.y > 1 || glyphData.myBottomRightUV.x > 1 || glyphData.myBottomRightUV.y > 1)
-	{
-		ERROR_PRINT("%s", "Tried to set a glyph UV to above 1");
-		return;
-	} 
+	glyphData.myHasBitmap = width > 0 && height > 0;
 
 	CalculateGlyphOffsets(index, slot);
 	for (int x = 0; x < width; x++)
 	{
 		for (int y = 0; y < height; y++)
 		{
-			if (x < 0 || y < 0)
+			const int targetX = bitmapX + aBorderOffset + myTextOutlineOffset.xDelta + x;
+			const int targetY = bitmapY + aBorderOffset + myTextOutlineOffset.yDelta + y;
+			if (targetX < 0 || targetY < 0 || targetX >= bitmapWidth || targetY >= bitmapHeight)
 			{
 				continue;
 			}
-			int& saved = aFontData->myAtlas[((atlasY)+aBorderOffset + myTextOutlineOffset.yDelta + y) *
-				int(atlasWidth) + ((atlasX + aBorderOffset + myTextOutlineOffset.xDelta) + x)];
+			int& saved = someBitmap[targetY * bitmapWidth + targetX];
 			saved |= bitmap.buffer[y * bitmap.width + x];
 
 			saved = Color32Reverse(saved);
-
-			if (y + (atlasY + Y_OFFSET) > maxY)
-			{
-				maxY = y + (atlasY + Y_OFFSET);
-			}
 		}
 	}
 
-	atlasX = atlasX + width + X_OFFSET;
-	aFontData->myCharData[index] = glyphData;
+	outGlyphData = glyphData;
 }
 
-void GlyphLoader::LoadOutline(const int index, const int atlasX, const int atlasY, const float atlasWidth, InternalTextAndFontData* aFontData, FT_FaceRec_* aFace, int aBorderOffset)
+void GlyphLoader::LoadOutline(const int index, const int bitmapX, const int bitmapY, const int bitmapWidth, const int bitmapHeight, std::vector<int>& someBitmap, FT_FaceRec_* aFace, int aBorderOffset)
 {
 	FT_Error err;
 	FT_Stroker stroker;
@@ -375,8 +381,14 @@ void GlyphLoader::LoadOutline(const int index, const int atlasX, const int atlas
 	{
 		for (unsigned int y = 0; y < height; y++)
 		{
+			const int targetX = bitmapX + myTextOutlineOffset.xDelta + static_cast<int>(x);
+			const int targetY = bitmapY + myTextOutlineOffset.yDelta + static_cast<int>(y);
+			if (targetX < 0 || targetY < 0 || targetX >= bitmapWidth || targetY >= bitmapHeight)
+			{
+				continue;
+			}
 
-			int& data = aFontData->myAtlas[((atlasY + myTextOutlineOffset.yDelta) + y) * int(atlasWidth) + ((atlasX + myTextOutlineOffset.xDelta) + x)];
+			int& data = someBitmap[targetY * bitmapWidth + targetX];
 			data = 0;
 			data |= bitmapGlyph->bitmap.buffer[y * width + x];
 			data = Color32Reverse2(data);
@@ -388,11 +400,8 @@ void GlyphLoader::LoadOutline(const int index, const int atlasX, const int atlas
 	FT_Done_Glyph(glyph);
 }
 
-TextToRender processNextCharacter(const InternalTextAndFontData& fontData, char aCharacter, float aSize, float& x, float& y, float& maxY)
+TextToRender processNextCharacter(const InternalTextAndFontData& fontData, const CharData& charData, float aSize, float& x, float& y, float& maxY)
 {
-	int charAsNumber = (unsigned char)aCharacter;
-	const CharData& charData = fontData.myCharData[charAsNumber];
-
 	if (maxY < charData.myHeight)
 	{
 		maxY = static_cast<float>(charData.myHeight);
@@ -403,17 +412,19 @@ TextToRender processNextCharacter(const InternalTextAndFontData& fontData, char
 	result.myPosition.Set((x + charData.myBearingX) * aSize, (y + charData.myBearingY) * aSize);
 	result.mySize.Set(static_cast<float>(charData.myWidth), static_cast<float>(charData.myHeight));
 
-	result.myUvStart = charData.myTopLeftUV;
-	result.myUvEnd = charData.myBottomRightUV;
+	result.myUvStart = charData.myRegion.myTopLeftUV;
+	result.myUvEnd = charData.myRegion.myBottomRightUV;
+	result.myPage = charData.myRegion.myPage;
+	result.isWhitespace = !charData.myHasBitmap;
 
-	if (aCharacter == '\n')
+	if (charData.myCodepoint == '\n')
 	{
 		x = 0;
-		y -= (maxY + 6);
+		y -= (maxY + 6 * fontData.myUnitsPerPixel);
 	}
 	else
 	{
-		if (aCharacter == ' ')
+		if (charData.myCodepoint == ' ')
 		{
 			x += fontData.myWordSpacing;
 		}
@@ -423,8 +434,46 @@ TextToRender processNextCharacter(const InternalTextAndFontData& fontData, char
 	return result;
 }
 
+uint32_t TextService::DecodeNextCodepoint(const std::string& aText, size_t& anIndex)
+{
+	const unsigned char lead = static_cast<unsigned char>(aText[anIndex]);
+	const int length = lead < 0x80 ? 1 : (lead & 0xE0) == 0xC0 ? 2 : (lead & 0xF0) == 0xE0 ? 3 : (lead & 0xF8) == 0xF0 ? 4 : 0;
+
+	if (length > 1 && anIndex + length <= aText.size())
+	{
+		static const uint32_t smallestCodepoint[5] = { 0, 0, 0x80, 0x800, 0x10000 };
+
+		uint32_t codepoint = lead & (0x7F >> length);
+		bool isValid = true;
+		for (int i = 1; i < length; i++)
+		{
+			const unsigned char continuation = static_cast<unsigned char>(aText[anIndex + i]);
+			if ((continuation & 0xC0) != 0x80)
+			{
+				isValid = false;
+				break;
+			}
+			codepoint = (codepoint << 6) | (continuation & 0x3F);
+		}
+
+		if (isValid && codepoint >= smallestCodepoint[length] && codepoint <= 0x10FFFF && (codepoint < 0xD800 || codepoint > 0xDFFF))
+		{
+			anIndex += length;
+			return codepoint;
+		}
+	}
+
+	anIndex++;
+	return lead;
+}
+
 InternalTextAndFontData::~InternalTextAndFontData()
-{}
+{
+	if (myFace)
+	{
+		FT_Done_Face(myFace);
+	}
+}
 
 TextService::TextService()
 {
@@ -433,13 +482,32 @@ TextService::TextService()
 void TextService::Init()
 {
 	FT_Init_FreeType(&myLibrary);
+	myGlyphAtlas.Init();
 }
 
 TextService::~TextService()
 {
+	// Fonts can outlive the service, their faces go away with the library.
+	for (auto& pair : myFontData)
+	{
+		if (std::shared_ptr<InternalTextAndFontData> fontData = pair.second.lock())
+		{
+			if (fontData->myFace)
+			{
+				FT_Done_Face(fontData->myFace);
+				fontData->myFace = nullptr;
+			}
+		}
+	}
+
 	FT_Done_FreeType(myLibrary);
 }
 
+void TextService::BeginFrame()
+{
+	myGlyphAtlas.BeginFrame();
+}
+
 inline bool FileExists(const std::string& name) 
 {
 	std::ifstream f(name.c_str());
@@ -453,7 +521,7 @@ inline bool FileExists(const std::string& name)
 	return false;
 }
 
-Font TextService::GetOrLoad(std::wstring aFontPathAndName, FontSize aFontSize, unsigned char aBorderSize)
+Font TextService::GetOrLoad(std::wstring aFontPathAndName, FontSize aFontSize, unsigned char aBorderSize, FontRenderMode aRenderMode)
 {
 	if (aFontSize == -1)
 	{
@@ -462,45 +530,67 @@ Font TextService::GetOrLoad(std::wstring aFontPathAndName, FontSize aFontSize, u
 	
 	std::wstring resolvedPath = Tga::Settings::ResolveAssetPathW(aFontPathAndName);
 
+	const bool isDistanceField = aRenderMode == FontRenderMode::DistanceField;
 	short fontWidth = (short)aFontSize;
-	const int atlasSize = 1024;
-	float atlasWidth = static_cast<float>(atlasSize);
-	float atlasHeight = static_cast<float>(atlasSize);
 
-	int atlasX = X_START;
-	int atlasY = 2;
-	int currentMaxY = 0;
+	// A distance field font is the same data for every size and border, those only change how it is drawn.
+	auto makeFont = [&](const std::shared_ptr<InternalTextAndFontData>& aFontData) -> Font
+	{
+		if (!isDistanceField)
+		{
+			return { aFontData };
+		}
+		return { aFontData, static_cast<float>(fontWidth) / DistanceFieldSize, aBorderSize };
+	};
 
 	std::shared_ptr<InternalTextAndFontData> fontData = nullptr;
 
 	std::wstringstream key;
-	key << aFontPathAndName << "-" << fontWidth << "-" << aBorderSize;
+	if (isDistanceField)
+	{
+		key << aFontPathAndName << "-sdf";
+	}
+	else
+	{
+		key << aFontPathAndName << "-" << fontWidth << "-" << aBorderSize;
+	}
 
 	auto it = myFontData.find(key.str());
 	if (it != myFontData.end())
 	{
 		fontData = it->second.lock();
 		if (fontData)
-			return { fontData };
+			return makeFont(fontData);
 	}
 
 	fontData = std::make_shared<InternalTextAndFontData>();
 	myFontData[key.str()] = fontData;
 
-	fontData->myAtlas.resize(atlasSize * atlasSize);
-	ZeroMemory(fontData->myAtlas.data(), (atlasSize * atlasSize) * sizeof(int));
-	fontData->myFontHeightWidth = fontWidth;
+	fontData->myFontHeightWidth = isDistanceField ? DistanceFieldSize : fontWidth;
+	fontData->myBorderSize = isDistanceField ? 0 : aBorderSize;
 	fontData->myName = key.str();
+	fontData->myIsDistanceField = isDistanceField;
+	fontData->myUnitsPerPixel = isDistanceField ? static_cast<float>(DistanceFieldSupersampling) : 1.0f;
 
+	if (isDistanceField && !InitDistanceFieldRendering())
+	{
+		return { nullptr };
+	}
+
+	// The face stays open for as long as the font is used, glyphs are only rasterized once something needs them.
 	FT_Face face;
-	std::string aAsciiFontPath = string_cast<std::string>(resolvedPath);
-	FT_Error error = FT_New_Face(myLibrary, aAsciiFontPath.c_str(), 0, &face);
+	if (!Settings::GetFileSystem().Open(resolvedPath, fontData->myFontFile))
+	{
+		return { nullptr };
+	}
+	FT_Error error = FT_New_Memory_Face(myLibrary, fontData->myFontFile.GetData(), static_cast<FT_Long>(fontData->myFontFile.GetSize()), 0, &face);
 	if (error != 0)
 	{
 		return { nullptr };
 	}
+	fontData->myFace = face;
 
-	FT_F26Dot6 ftSize = (FT_F26Dot6)(fontData->myFontHeightWidth * (1 << 6));
+	FT_F26Dot6 ftSize = (FT_F26Dot6)(fontData->myFontHeightWidth * fontData->myUnitsPerPixel * (1 << 6));
 	error = FT_Set_Char_Size(face, ftSize, 0, 100, 100);
 	if (error != 0)
 	{
@@ -518,182 +608,425 @@ Font TextService::GetOrLoad(std::wstring aFontPathAndName, FontSize aFontSize, u
 	FT_GlyphSlot space = face->glyph;
 
 	fontData->myWordSpacing = static_cast<short>(space->metrics.width / 256);
+	fontData->myLineSpacing = static_cast<float>((face->ascender - face->descender) >> 6);
+	
+	return makeFont(fontData);
+}
 
-	int currentMax = 256;
-	int currentI = 32;
+bool TextService::InitDistanceFieldRendering()
+{
+	if (myDistanceFieldShader)
+	{
+		return true;
+	}
 
-	GlyphLoader glyphLoader;
-	glyphLoader.myLibrary = myLibrary;
-	for (int i = currentI; i < currentMax; i++)
+	std::unique_ptr<SpriteShader> shader = std::make_unique<SpriteShader>();
+	if (!shader->Init(L"shaders/instanced_sprite_shader_VS.cso", L"shaders/distance_field_text_PS.cso"))
+	{
+		ERROR_PRINT("%s", "Failed to load the distance field text shader!");
+		return false;
+	}
+
+	// b5 is the bone buffer in common.hlsli.
+	shader->SetDataBufferIndex(ShaderDataBufferIndex::Index_2);
+	myDistanceFieldShader = std::move(shader);
+
+	myDistanceFieldThreads.Init();
+	return true;
+}
+
+bool TextService::IsGlyphReady(const InternalTextAndFontData& aFontData, uint32_t aCodepoint) const
+{
+	auto it = aFontData.myCharData.find(aCodepoint);
+	return it != aFontData.myCharData.end() && (!it->second.myHasBitmap || myGlyphAtlas.IsValid(it->second.myRegion));
+}
+
+void TextService::GenerateDistanceFieldGlyphs(const InternalTextAndFontData& aFontData, const uint32_t* someCodepoints, size_t aCount)
+{
+	struct Job
 	{
-		error = FT_Load_Char(face, i, FT_LOAD_RENDER);
-		if (error != 0)
+		CharData glyph;
+		int width;
+		int height;
+		std::vector<uint8_t> coverage;
+		std::vector<uint8_t> field;
+	};
+
+	constexpr int margin = DistanceFieldSpread * DistanceFieldSupersampling;
+	auto roundUp = [](int aValue) { return (aValue + DistanceFieldSupersampling - 1) / DistanceFieldSupersampling * DistanceFieldSupersampling; };
+
+	// FreeType faces can't be used from several threads, so the outlines are rasterized here and only the distance
+	// transforms, which is where the time goes, run on the workers.
+	std::vector<Job> jobs(aCount);
+	for (size_t i = 0; i < aCount; i++)
+	{
+		Job& job = jobs[i];
+		job.glyph = {};
+		job.glyph.myCodepoint = someCodepoints[i];
+
+		if (!aFontData.myFace || FT_Load_Char(aFontData.myFace, someCodepoints[i], FT_LOAD_RENDER) != 0)
 		{
-			ERROR_PRINT("%s%s", "Failed to load glyph! ", (char)i);
+			ERROR_PRINT("%s%u", "Failed to load glyph! ", someCodepoints[i]);
 			continue;
 		}
 
-		FT_GlyphSlot slot = face->glyph;
+		FT_GlyphSlot slot = aFontData.myFace->glyph;
+		const FT_Bitmap& bitmap = slot->bitmap;
 
-		if (atlasX + slot->bitmap.width + (aBorderSize * 2) > atlasWidth)
+		job.glyph.myAdvanceX = static_cast<short>(slot->advance.x) >> 6;
+		job.glyph.myAdvanceY = static_cast<short>(slot->advance.y) >> 6;
+		job.glyph.myBearingX = static_cast<short>(slot->bitmap_left - margin);
+		job.glyph.myBearingY = static_cast<short>(slot->bitmap_top + margin);
+		job.glyph.myHasBitmap = bitmap.width > 0 && bitmap.rows > 0;
+		if (!job.glyph.myHasBitmap)
 		{
-			atlasX = X_START;
-			atlasY = currentMaxY;
+			continue;
 		}
-		if (aBorderSize > 0)
+
+		job.width = roundUp(static_cast<int>(bitmap.width) + margin * 2);
+		job.height = roundUp(static_cast<int>(bitmap.rows) + margin * 2);
+		job.glyph.myWidth = static_cast<short>(job.width);
+		job.glyph.myHeight = static_cast<short>(job.height);
+
+		job.coverage.assign(static_cast<size_t>(job.width) * job.height, 0);
+		for (unsigned int y = 0; y < bitmap.rows; y++)
 		{
-			glyphLoader.LoadOutline(i, atlasX, atlasY, atlasWidth, fontData.get(), face, aBorderSize);
+			memcpy(&job.coverage[(margin + y) * job.width + margin], bitmap.buffer + y * bitmap.pitch, bitmap.width);
 		}
-
-		glyphLoader.LoadGlyph(i, atlasX, atlasY, currentMaxY, atlasWidth, atlasHeight, fontData.get(), face, aBorderSize);
 	}
 
-	D3D11_SUBRESOURCE_DATA data;
-	data.pSysMem = fontData->myAtlas.data();
-	data.SysMemPitch = atlasSize * 4;
+	std::atomic<size_t> nextJob{ 0 };
+	auto generateJob = [&]()
+	{
+		for (size_t i = nextJob++; i < jobs.size(); i = nextJob++)
+		{
+			Job& job = jobs[i];
+			if (!job.glyph.myHasBitmap)
+			{
+				continue;
+			}
 
-	D3D11_TEXTURE2D_DESC info;
-	info.Width = atlasSize;
-	info.Height = atlasSize;
-	info.MipLevels = 0;
-	info.ArraySize = 1;
-	info.SampleDesc.Count = 1;
-	info.SampleDesc.Quality = 0;
-	info.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
-	info.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	info.Usage = D3D11_USAGE_DEFAULT;
-	info.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
-	info.CPUAccessFlags = 0;
+			job.field.resize((job.width / DistanceFieldSupersampling) * (job.height / DistanceFieldSupersampling));
+			DistanceField::Generate(job.coverage.data(), job.width, job.height, DistanceFieldSupersampling, static_cast<float>(DistanceFieldSpread), job.field.data());
+		}
+	};
 
-	ID3D11Texture2D* texture;
-	HRESULT hr = DX11::Device->CreateTexture2D(&info, nullptr, &texture);
-	if (FAILED(hr))
+	// Same as the model drawer's parallel recording, the calling thread works too and waits for every helper.
+	const size_t helperCount = std::min<size_t>(myDistanceFieldThreads.GetThreadCount(), aCount > 0 ? aCount - 1 : 0);
+	std::atomic<size_t> finishedHelpers{ 0 };
+	for (size_t i = 0; i < helperCount; i++)
 	{
-		ERROR_PRINT("%s", "Failed to load texture for text!");
-		return { nullptr };
+		myDistanceFieldThreads.Enqueue([&]()
+		{
+			generateJob();
+			finishedHelpers++;
+		});
 	}
 
-	DX11::Context->UpdateSubresource(texture, 0, NULL, fontData->myAtlas.data(), atlasSize * 4, 0);
+	generateJob();
 
-	DX11::Device->CreateShaderResourceView(texture, nullptr, fontData->myAtlasView.ReleaseAndGetAddressOf());
-	DX11::Context->GenerateMips(fontData->myAtlasView.Get());
-	texture->Release();
+	while (finishedHelpers.load() < helperCount)
+	{
+		std::this_thread::yield();
+	}
 
-	fontData->myAtlasHeight = atlasSize;
-	fontData->myAtlasWidth = atlasSize;
-	fontData->myLineSpacing = static_cast<float>((face->ascender - face->descender) >> 6);
-	FT_Done_Face(face);
-	
-	fontData->myTexture = std::make_unique<TextureResource>(fontData->myAtlasView.Get());
-	
-	return { fontData };
+	const float pageSize = static_cast<float>(myGlyphAtlas.GetPageSize());
+	std::vector<uint32_t> pixels;
+	for (Job& job : jobs)
+	{
+		if (job.glyph.myHasBitmap)
+		{
+			const int fieldWidth = job.width / DistanceFieldSupersampling;
+			const int fieldHeight = job.height / DistanceFieldSupersampling;
+			const int pixelsWidth = fieldWidth + GlyphPadding * 2;
+			const int pixelsHeight = fieldHeight + GlyphPadding * 2;
+
+			// The distance goes in alpha, the padding reads as far outside.
+			pixels.assign(static_cast<size_t>(pixelsWidth) * pixelsHeight, 0);
+			for (int y = 0; y < fieldHeight; y++)
+			{
+				for (int x = 0; x < fieldWidth; x++)
+				{
+					pixels[(y + GlyphPadding) * pixelsWidth + x + GlyphPadding] = 0x00FFFFFF | (static_cast<uint32_t>(job.field[y * fieldWidth + x]) << 24);
+				}
+			}
+
+			GlyphAtlasRegion& region = job.glyph.myRegion;
+			if (myGlyphAtlas.Add(pixelsWidth, pixelsHeight, pixels.data(), region))
+			{
+				region.myTopLeftUV = { (region.myX + GlyphPadding) / pageSize, (region.myY + GlyphPadding) / pageSize };
+				region.myBottomRightUV = { (region.myX + GlyphPadding + fieldWidth) / pageSize, (region.myY + GlyphPadding + fieldHeight) / pageSize };
+			}
+			else
+			{
+				ERROR_PRINT("%s%u", "No room for glyph in the glyph atlas! ", job.glyph.myCodepoint);
+				job.glyph.myHasBitmap = false;
+			}
+		}
+
+		aFontData.myCharData[job.glyph.myCodepoint] = job.glyph;
+	}
 }
 
-float Tga::TextService::GetSentenceWidth(Tga::Text& aText)
+const CharData& TextService::GetGlyph(const InternalTextAndFontData& aFontData, uint32_t aCodepoint)
 {
-	if (aText.myText.size() <= 0)
+	auto it = aFontData.myCharData.find(aCodepoint);
+	if (it != aFontData.myCharData.end())
 	{
-		return 0.0f;
+		CharData& glyph = it->second;
+		if (!glyph.myHasBitmap)
+		{
+			return glyph;
+		}
+		if (myGlyphAtlas.IsValid(glyph.myRegion))
+		{
+			myGlyphAtlas.MarkUsed(glyph.myRegion.myPage);
+			return glyph;
+		}
 	}
 
-	const InternalTextAndFontData* fontData = aText.myFont.myData.get();
-	if (!fontData)
+	if (aFontData.myIsDistanceField)
 	{
-		return 0.0f;
+		GenerateDistanceFieldGlyphs(aFontData, &aCodepoint, 1);
+		return aFontData.myCharData[aCodepoint];
 	}
 
-	int count = static_cast<int>(aText.myText.length());
+	CharData& glyph = aFontData.myCharData[aCodepoint];
+	glyph = {};
+	glyph.myCodepoint = aCodepoint;
+	if (!aFontData.myFace)
+	{
+		return glyph;
+	}
 
-	float maxX = FLT_MIN;
+	FT_Error error = FT_Load_Char(aFontData.myFace, aCodepoint, FT_LOAD_RENDER);
+	if (error != 0)
+	{
+		ERROR_PRINT("%s%u", "Failed to load glyph! ", aCodepoint);
+		return glyph;
+	}
 
-	float drawX = 0.f;
-	float drawY = 0.f;
-	float maxDrawY = 0.f;
+	const int border = aFontData.myBorderSize;
+	const int bitmapWidth = static_cast<int>(aFontData.myFace->glyph->bitmap.width) + (border + GlyphPadding) * 2;
+	const int bitmapHeight = static_cast<int>(aFontData.myFace->glyph->bitmap.rows) + (border + GlyphPadding) * 2;
+
+	myGlyphBitmap.assign(static_cast<size_t>(bitmapWidth) * bitmapHeight, 0);
+
+	GlyphLoader glyphLoader;
+	glyphLoader.myLibrary = myLibrary;
+	if (border > 0)
+	{
+		glyphLoader.LoadOutline(aCodepoint, GlyphPadding, GlyphPadding, bitmapWidth, bitmapHeight, myGlyphBitmap, aFontData.myFace, border);
+	}
+	glyphLoader.LoadGlyph(aCodepoint, GlyphPadding, GlyphPadding, bitmapWidth, bitmapHeight, myGlyphBitmap, glyph, aFontData.myFace, border);
 
-	for (int i = 0; i < count; i++)
+	if (!glyph.myHasBitmap)
 	{
-		TextToRender charInfo = processNextCharacter(*fontData, aText.myText[i], aText.myScale, drawX, drawY, maxDrawY);
-		maxX = std::max(maxX, charInfo.myPosition.myX + charInfo.mySize.myX);
+		return glyph;
 	}
 
-	return maxX;
+	if (!myGlyphAtlas.Add(bitmapWidth, bitmapHeight, reinterpret_cast<const uint32_t*>(myGlyphBitmap.data()), glyph.myRegion))
+	{
+		ERROR_PRINT("%s%u", "No room for glyph in the glyph atlas! ", aCodepoint);
+		glyph.myHasBitmap = false;
+		return glyph;
+	}
+
+	// The region includes the padding, the UVs only cover the glyph.
+	const float pageSize = static_cast<float>(myGlyphAtlas.GetPageSize());
+	glyph.myRegion.myTopLeftUV = { (glyph.myRegion.myX + GlyphPadding) / pageSize, (glyph.myRegion.myY + GlyphPadding) / pageSize };
+	glyph.myRegion.myBottomRightUV = { (glyph.myRegion.myX + GlyphPadding + glyph.myWidth) / pageSize, (glyph.myRegion.myY + GlyphPadding + glyph.myHeight) / pageSize };
+
+	return glyph;
 }
 
-float Tga::TextService::GetSentenceHeight(Tga::Text& aText)
+void TextService::UpdateLayout(Tga::Text& aText, const InternalTextAndFontData& aFontData)
 {
-	if (aText.myText.size() <= 0)
+	if (!aText.myIsLayoutDirty && aText.myLayoutFontData == &aFontData && aText.myLayoutAtlasEvictionCount == myGlyphAtlas.GetEvictionCount())
 	{
-		return 0.0f;
+		return;
 	}
 
-	const InternalTextAndFontData* fontData = aText.myFont.myData.get();
-	if (!fontData)
+	aText.myIsLayoutDirty = false;
+	aText.myIsPackedLayoutDirty = true;
+	aText.myLayoutFontData = &aFontData;
+	aText.myLayout.clear();
+	aText.myLayoutRuns.clear();
+	aText.myLayoutMin = { 0.f, 0.f };
+	aText.myLayoutMax = { 0.f, 0.f };
+
+	const size_t count = aText.myText.size();
+	if (count == 0)
 	{
-		return 0.0f;
+		aText.myLayoutAtlasEvictionCount = myGlyphAtlas.GetEvictionCount();
+		return;
 	}
 
-	int count = static_cast<int>(aText.myText.length());
+	const float scale = aText.myScale * aText.myFont.myScale / aFontData.myUnitsPerPixel;
+	const float rotation = aText.myRotation;
 
+	// Distance field glyphs that are missing are generated together first, so they can be spread over the workers.
+	if (aFontData.myIsDistanceField)
+	{
+		myMissingCodepoints.clear();
+		for (size_t i = 0; i < count;)
+		{
+			const uint32_t codepoint = DecodeNextCodepoint(aText.myText, i);
+			if (!IsGlyphReady(aFontData, codepoint) && std::find(myMissingCodepoints.begin(), myMissingCodepoints.end(), codepoint) == myMissingCodepoints.end())
+			{
+				myMissingCodepoints.push_back(codepoint);
+			}
+		}
+
+		if (!myMissingCodepoints.empty())
+		{
+			GenerateDistanceFieldGlyphs(aFontData, myMissingCodepoints.data(), myMissingCodepoints.size());
+		}
+	}
+
+	float minX = FLT_MAX;
+	float minY = FLT_MAX;
+	float maxX = FLT_MIN;
 	float maxY = FLT_MIN;
 
 	float drawX = 0.f;
 	float drawY = 0.f;
 	float maxDrawY = 0.f;
 
-	for (int i = 0; i < count; i++)
+	myLayoutPages.clear();
+	aText.myLayout.reserve(count);
+	for (size_t i = 0; i < count;)
 	{
-		TextToRender charInfo = processNextCharacter(*fontData, aText.myText[i], aText.myScale, drawX, drawY, maxDrawY);
-		maxY = std::max(maxY, charInfo.myPosition.myY + charInfo.mySize.myY);
+		const uint32_t codepoint = DecodeNextCodepoint(aText.myText, i);
+		TextToRender charInfo = processNextCharacter(aFontData, GetGlyph(aFontData, codepoint), scale, drawX, drawY, maxDrawY);
+		const Vector2f size = charInfo.mySize * scale;
+
+		minX = std::min(minX, charInfo.myPosition.x);
+		minY = std::min(minY, charInfo.myPosition.y);
+		maxX = std::max(maxX, charInfo.myPosition.x + size.x);
+		maxY = std::max(maxY, charInfo.myPosition.y + size.y);
+
+		// Spaces and line breaks still move the pen and count towards the bounds, but there is nothing to draw.
+		if (charInfo.isWhitespace || size.x <= 0.f || size.y <= 0.f)
+		{
+			continue;
+		}
+
+		Sprite2DInstanceData glyph = {};
+		glyph.myPivot = { 0.f, 0.f };
+		glyph.myPosition = charInfo.myPosition;
+		glyph.mySize = size;
+		glyph.myRotation = rotation;
+		glyph.myTextureRect = { charInfo.myUvStart.x, charInfo.myUvStart.y, charInfo.myUvEnd.x, charInfo.myUvEnd.y };
+		aText.myLayout.push_back(glyph);
+		myLayoutPages.push_back(charInfo.myPage);
 	}
 
-	return maxY;
-}
+	aText.myLayoutMin = { minX, minY };
+	aText.myLayoutMax = { maxX, maxY };
+	aText.myLayoutAtlasEvictionCount = myGlyphAtlas.GetEvictionCount();
 
-bool TextService::Draw(Tga::Text& aText, Tga::SpriteShader* aCustomShader)
-{
-	const InternalTextAndFontData* fontData = aText.myFont.myData.get();
-	if (!fontData || !fontData->myTexture)
+	// Every atlas page is its own texture, so glyphs are grouped by page and drawn one run per page. Almost all texts
+	// fit on one page and keep their order.
+	uint32_t firstPage = UINT32_MAX;
+	uint32_t lastPage = 0;
+	for (uint32_t page : myLayoutPages)
 	{
-		return false;
+		firstPage = std::min(firstPage, page);
+		lastPage = std::max(lastPage, page);
+	}
+
+	if (firstPage == lastPage)
+	{
+		aText.myLayoutRuns.push_back({ firstPage, 0, static_cast<uint32_t>(aText.myLayout.size()) });
 	}
+	else if (!aText.myLayout.empty())
+	{
+		std::vector<Sprite2DInstanceData> sorted;
+		sorted.reserve(aText.myLayout.size());
+		for (uint32_t page = firstPage; page <= lastPage; page++)
+		{
+			const uint32_t first = static_cast<uint32_t>(sorted.size());
+			for (size_t i = 0; i < aText.myLayout.size(); i++)
+			{
+				if (myLayoutPages[i] == page)
+				{
+					sorted.push_back(aText.myLayout[i]);
+				}
+			}
 
-	int count = (int)aText.myText.size();
-	const char* str = aText.myText.c_str();
-	float scale = aText.myScale;
-	float rotation = aText.myRotation;
+			if (sorted.size() > first)
+			{
+				aText.myLayoutRuns.push_back({ page, first, static_cast<uint32_t>(sorted.size()) - first });
+			}
+		}
+		aText.myLayout.swap(sorted);
+	}
 
-	float midX = 0;
-	float midY = 0;
 	if (rotation != 0.0f)
 	{
-		float minX = FLT_MAX;
-		float minY = FLT_MAX;
-		float maxX = FLT_MIN;
-		float maxY = FLT_MIN;
+		const float midX = 0.5f * (maxX + minX);
+		const float midY = 0.5f * (maxY + minY);
+		const float c = cos(rotation);
+		const float s = sin(rotation);
 
-		float drawX = 0.f;
-		float drawY = 0.f;
-		float maxDrawY = 0.f;
-
-		for (int i = 0; i < count; i++)
+		for (Sprite2DInstanceData& glyph : aText.myLayout)
 		{
-			TextToRender charInfo = processNextCharacter(*fontData, str[i], scale, drawX, drawY, maxDrawY);
+			const float x = glyph.myPosition.x - midX;
+			const float y = glyph.myPosition.y - midY;
 
-			minX = std::min(minX, charInfo.myPosition.myX);
-			minY = std::min(minY, charInfo.myPosition.myY);
-			maxX = std::max(maxX, charInfo.myPosition.myX + charInfo.mySize.myX);
-			maxY = std::max(maxY, charInfo.myPosition.myY + charInfo.mySize.myY);
+			glyph.myPosition.x = x * c - y * s + midX;
+			glyph.myPosition.y = (x * s + y * c) + midY;
 		}
+	}
+}
+
+float Tga::TextService::GetSentenceWidth(Tga::Text& aText)
+{
+	const InternalTextAndFontData* fontData = aText.myFont.myData.get();
+	if (!fontData)
+	{
+		return 0.0f;
+	}
 
-		midX = 0.5f * (maxX + minX);
-		midY = 0.5f * (maxY + minY);
+	UpdateLayout(aText, *fontData);
+	return aText.myLayoutMax.x;
+}
+
+float Tga::TextService::GetSentenceHeight(Tga::Text& aText)
+{
+	const InternalTextAndFontData* fontData = aText.myFont.myData.get();
+	if (!fontData)
+	{
+		return 0.0f;
 	}
 
+	UpdateLayout(aText, *fontData);
+	return aText.myLayoutMax.y;
+}
+
+bool TextService::Draw(Tga::Text& aText, Tga::SpriteShader* aCustomShader)
+{
+	const InternalTextAndFontData* fontData = aText.myFont.myData.get();
+	if (!fontData || !fontData->myFace)
+	{
+		return false;
+	}
+
+	UpdateLayout(aText, *fontData);
+	if (aText.myLayout.empty())
+	{
+		return true;
+	}
+
+	// Everything rasterized since the last draw goes to the GPU in one go.
+	myGlyphAtlas.Upload();
+
 	SpriteSharedData spriteSharedData = {};
 
 	GraphicsStateStack& graphicsStateStack = Engine::GetInstance()->GetGraphicsEngine().GetGraphicsStateStack();
 	graphicsStateStack.Push();
-	if (fontData->myFontHeightWidth < 18)
+	if (fontData->myFontHeightWidth < 18 && !fontData->myIsDistanceField)
 	{
 		graphicsStateStack.SetSamplerState(SamplerFilter::Point, SamplerAddressMode::Clamp);
 	}
@@ -702,50 +1035,61 @@ bool TextService::Draw(Tga::Text& aText, Tga::SpriteShader* aCustomShader)
 		graphicsStateStack.SetSamplerState(SamplerFilter::Bilinear, SamplerAddressMode::Clamp);
 	}
 
-	spriteSharedData.myTexture = fontData->myTexture.get();
-	spriteSharedData.myCustomShader = aCustomShader;
-
+	// Only pack again if something the packed data depends on moved. The text position is folded into the transform
+	// so the layout itself never has to be touched for it.
+	const Matrix4x4f& transform = graphicsStateStack.GetTransform();
+	if (aText.myIsPackedLayoutDirty || !(aText.myPackedPosition == aText.myPosition) || !(aText.myPackedColor == aText.myColor) || aText.myPackedTransform != transform)
 	{
-		SpriteBatchScope batchScope = Engine::GetInstance()->GetGraphicsEngine().GetSpriteDrawer().BeginBatch(spriteSharedData);
-
-		float drawX = 0.f;
-		float drawY = 0.f;
-		float maxDrawY = 0.f;
-
-		float diffX = midX;
-		float diffY = midY;
-
-		float c=0.f, s=0.f;
-		if (rotation != 0.0f)
+		for (Sprite2DInstanceData& glyph : aText.myLayout)
 		{
-			c = cos(rotation);
-			s = sin(rotation);
+			glyph.myColor = aText.myColor;
 		}
 
-		for (int i = 0; i < count; i++)
-		{
-			TextToRender charInfo = processNextCharacter(*fontData, str[i], scale, drawX, drawY, maxDrawY);
+		const Matrix4x4f packTransform = Matrix4x4f::CreateTranslationMatrix({ aText.myPosition.x, aText.myPosition.y, 0.f }) * transform;
 
-			Sprite2DInstanceData spriteInstance = {};
+		aText.myPackedLayout.resize(aText.myLayout.size());
+		const size_t packedCount = SpritePacking::Pack2D(aText.myLayout.data(), aText.myLayout.size(), packTransform, aText.myPackedLayout.data());
+		aText.myPackedLayout.resize(packedCount);
 
-			if (rotation != 0.0f)
-			{
-				spriteInstance.myRotation = rotation;
+		aText.myPackedTransform = transform;
+		aText.myPackedPosition = aText.myPosition;
+		aText.myPackedColor = aText.myColor;
+		aText.myIsPackedLayoutDirty = false;
+	}
+
+	spriteSharedData.myCustomShader = aCustomShader;
+	if (fontData->myIsDistanceField && !aCustomShader)
+	{
+		// The border is in pixels at the font size. 0.5 is the glyph edge, the border pushes it out by the matching
+		// part of the spread.
+		const float borderInField = aText.myFont.myBorderSize / (aText.myFont.myScale * DistanceFieldSpread * 2.0f);
+		myDistanceFieldShader->SetShaderdataFloat4({ std::max(0.5f - borderInField, 0.0f), 0.0f, 0.0f, 0.0f }, ShaderDataID_1);
+		spriteSharedData.myCustomShader = myDistanceFieldShader.get();
+	}
 
-				float x = charInfo.myPosition.x - diffX;
-				float y = charInfo.myPosition.y - diffY;
+	for (const Text::GlyphRun& run : aText.myLayoutRuns)
+	{
+		myGlyphAtlas.MarkUsed(run.myPage);
+		spriteSharedData.myTexture = myGlyphAtlas.GetTexture(run.myPage);
 
-				charInfo.myPosition.x = x * c - y * s + diffX;
-				charInfo.myPosition.y = (x * s + y * c) + diffY;
+		SpriteBatchScope batchScope = Engine::GetInstance()->GetGraphicsEngine().GetSpriteDrawer().BeginBatch(spriteSharedData);
+
+		const SpriteShaderInstanceData* source = aText.myPackedLayout.data() + run.myFirst;
+		size_t remaining = run.myCount;
+		while (remaining > 0)
+		{
+			size_t reserved = 0;
+			SpriteShaderInstanceData* destination = batchScope.Reserve(remaining, reserved);
+			if (!destination)
+			{
+				break;
 			}
 
-			spriteInstance.myPivot = { 0.f, 0.f };
-			spriteInstance.myPosition = charInfo.myPosition + aText.myPosition;
-			spriteInstance.mySize = charInfo.mySize * scale;
-			spriteInstance.myColor = aText.myColor;
-			spriteInstance.myTextureRect = { charInfo.myUvStart.x, charInfo.myUvStart.y, charInfo.myUvEnd.x, charInfo.myUvEnd.y };
+			memcpy(destination, source, sizeof(SpriteShaderInstanceData) * reserved);
+			batchScope.Commit(reserved);
 
-			batchScope.Draw(spriteInstance);
+			source += reserved;
+			remaining -= reserved;
 		}
 	}
 
@@ -7,7 +7,9 @@ This class handles all texts that will be rendered, don't use this to show text,
 #include <tge/EngineDefines.h>
 #include <tge/math/color.h>
 #include <tge/text/fontfile.h>
+#include <tge/text/GlyphAtlas.h>
 #include <tge/text/text.h>
+#include <tge/util/ThreadPool.h>
 #include <unordered_map>
 #include <vector>
 
@@ -15,6 +17,8 @@ namespace Tga
 {
 	class Texture;
 	class Text;
+	struct CharData;
+	class SpriteShader;
 	class TextService
 	{
 	public:
@@ -23,13 +27,59 @@ namespace Tga
 
 		void Init();
 
-		Font GetOrLoad(std::wstring aFontPathAndName, FontSize aFontSize, unsigned char aBorderSize = 0);
+		/**
+		 * Lets the glyph atlas know a new frame started, pages drawn from during the frame are never evicted in it.
+		 */
+		void BeginFrame();
+
+		/**
+		 * Distance field fonts are loaded once per font file. aFontSize and aBorderSize only go into the returned
+		 * Font, which scales the glyphs and sets the border drawn by the shader.
+		 */
+		Font GetOrLoad(std::wstring aFontPathAndName, FontSize aFontSize, unsigned char aBorderSize = 0, FontRenderMode aRenderMode = FontRenderMode::Bitmap);
 		bool Draw(Tga::Text& aText, Tga::SpriteShader* aCustomShaderToRenderWith = nullptr);
 		float GetSentenceWidth(Tga::Text& aText);
 		float GetSentenceHeight(Tga::Text& aText);
 
+		const GlyphAtlas& GetGlyphAtlas() const { return myGlyphAtlas; }
+
+		/**
+		 * Decodes the UTF-8 sequence at anIndex and moves anIndex past it. Bytes that don't start a valid sequence
+		 * are taken as Latin-1, so strings saved in that encoding still show up like they used to.
+		 */
+		static uint32_t DecodeNextCodepoint(const std::string& aText, size_t& anIndex);
+
 	private:
+		/**
+		 * Rebuilds aText's cached glyph layout if its text, scale or rotation changed since last time, if it was
+		 * laid out with another font or if the atlas evicted a page since.
+		 */
+		void UpdateLayout(Tga::Text& aText, const InternalTextAndFontData& aFontData);
+
+		/**
+		 * Looks up a glyph, rasterizing it into the atlas first if it isn't there or its page was evicted.
+		 */
+		const CharData& GetGlyph(const InternalTextAndFontData& aFontData, uint32_t aCodepoint);
+		bool IsGlyphReady(const InternalTextAndFontData& aFontData, uint32_t aCodepoint) const;
+
+		/**
+		 * Rasterizes the glyphs at a higher resolution, turns them into distance fields on the worker threads and
+		 * adds them to the atlas.
+		 */
+		void GenerateDistanceFieldGlyphs(const InternalTextAndFontData& aFontData, const uint32_t* someCodepoints, size_t aCount);
+		bool InitDistanceFieldRendering();
+
 		struct FT_LibraryRec_* myLibrary;
+		GlyphAtlas myGlyphAtlas;
+
+		// Created when the first distance field font is loaded.
+		std::unique_ptr<SpriteShader> myDistanceFieldShader;
+		ThreadPool myDistanceFieldThreads;
+
+		// Scratch memory reused between calls.
+		std::vector<int> myGlyphBitmap;
+		std::vector<uint32_t> myLayoutPages;
+		std::vector<uint32_t> myMissingCodepoints;
 
 		std::unordered_map<std::wstring, std::weak_ptr<InternalTextAndFontData>> myFontData;
 	};
@@ -16,12 +16,12 @@ Text::Text(const Font& font)
 	myRotation = 0.0f;
 }
 
-Text::Text(const wchar_t* aPathAndName, FontSize aFontSize, unsigned char aBorderSize)
+Text::Text(const wchar_t* aPathAndName, FontSize aFontSize, unsigned char aBorderSize, FontRenderMode aRenderMode)
 : myTextService(&Tga::Engine::GetInstance()->GetTextService())
 {
 	myColor.Set(1, 1, 1, 1);
 	myScale = 1.0f;
-	myFont = myTextService->GetOrLoad(aPathAndName, aFontSize, aBorderSize);
+	myFont = myTextService->GetOrLoad(aPathAndName, aFontSize, aBorderSize, aRenderMode);
 	myRotation = 0.0f;
 }
 
@@ -83,7 +83,13 @@ Tga::Color Tga::Text::GetColor() const
 
 void Tga::Text::SetText(const std::string& aText)
 {
+	if (myText == aText)
+	{
+		return;
+	}
+
 	myText = aText;
+	myIsLayoutDirty = true;
 }
 
 std::string Tga::Text::GetText() const
@@ -103,10 +109,27 @@ Vector2f Tga::Text::GetPosition() const
 
 void Tga::Text::SetScale(float aScale)
 {
+	if (myScale == aScale)
+	{
+		return;
+	}
+
 	myScale = aScale;
+	myIsLayoutDirty = true;
 }
 
 float Tga::Text::GetScale() const
 {
 	return myScale;
+}
+
+void Tga::Text::SetRotation(float aRotation)
+{
+	if (myRotation == aRotation)
+	{
+		return;
+	}
+
+	myRotation = aRotation;
+	myIsLayoutDirty = true;
 }
\ No newline at end of file
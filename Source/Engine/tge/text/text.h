@@ -6,8 +6,12 @@ Use this class to create and show a text
 #include <tge/math/Color.h>
 #include <tge/math/vector2.h>
 #include <tge/render/RenderCommon.h>
+#include <tge/shaders/ShaderCommon.h>
+#include <tge/sprite/sprite.h>
+#include <cstdint>
 #include <string>
 #include <memory>
+#include <vector>
 
 namespace Tga
 {
@@ -30,10 +34,23 @@ namespace Tga
 		FontSize_Count
 	};
 
+	enum class FontRenderMode
+	{
+		// Glyphs rasterized at the font size. Sharpest at scale 1, every size and border size is a font of its own.
+		Bitmap,
+		// Glyphs stored as signed distance fields. One font serves every size and border size and stays sharp when
+		// scaled or rotated, borders are drawn by the shader.
+		DistanceField,
+	};
+
 	class InternalTextAndFontData;
 	struct Font
 	{
 		std::shared_ptr<const InternalTextAndFontData> myData;
+
+		// Only used by distance field fonts, bitmap fonts are rasterized at their size and with their border.
+		float myScale = 1.0f;
+		unsigned char myBorderSize = 0;
 	};
 
 	class TextService;
@@ -46,7 +63,7 @@ namespace Tga
 
 		// If this is the first time creating the text, the text will be loaded in memory, dont do this runtime
 		/*aPathAndName: ex. taxe/arial.ttf, */
-		Text(const wchar_t* aPathAndName = L"Text/arial.ttf", FontSize aFontSize = FontSize_14, unsigned char aBorderSize = 0);
+		Text(const wchar_t* aPathAndName = L"Text/arial.ttf", FontSize aFontSize = FontSize_14, unsigned char aBorderSize = 0, FontRenderMode aRenderMode = FontRenderMode::Bitmap);
 		~Text();
 		void Render();
 		void Render(Tga::SpriteShader* aCustomShaderToRenderWith);
@@ -65,7 +82,7 @@ namespace Tga
 		void SetScale(float aScale);
 		float GetScale() const;
 
-		void SetRotation(float aRotation) { myRotation = aRotation; }
+		void SetRotation(float aRotation);
 		float GetRotation() const { return myRotation; }
 	
 	protected:
@@ -76,6 +93,34 @@ namespace Tga
 		float myScale;
 		float myRotation;
 		Color myColor;
+
+	private:
+		// A range of myLayout whose glyphs are all on the same glyph atlas page.
+		struct GlyphRun
+		{
+			uint32_t myPage;
+			uint32_t myFirst;
+			uint32_t myCount;
+		};
+
+		// Glyph quads relative to myPosition, with scale and rotation applied. Only rebuilt by the TextService when
+		// the text, font, scale or rotation changed, or when glyphs it used were evicted from the atlas. Reused for
+		// drawing and for GetWidth/GetHeight.
+		std::vector<Sprite2DInstanceData> myLayout;
+		std::vector<GlyphRun> myLayoutRuns;
+		Vector2f myLayoutMin;
+		Vector2f myLayoutMax;
+		const InternalTextAndFontData* myLayoutFontData = nullptr;
+		uint32_t myLayoutAtlasEvictionCount = 0;
+		bool myIsLayoutDirty = true;
+
+		// myLayout packed into shader instance data. Drawing copies these straight into the sprite batch as long as
+		// the position, color and graphics state transform are the same as when they were packed.
+		std::vector<SpriteShaderInstanceData> myPackedLayout;
+		Matrix4x4f myPackedTransform;
+		Vector2f myPackedPosition;
+		Color myPackedColor;
+		bool myIsPackedLayoutDirty = true;
 	};
 }
 
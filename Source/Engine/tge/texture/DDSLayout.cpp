@@ -0,0 +1,282 @@
+#include "stdafx.h"
+
+#include <tge/texture/DDSLayout.h>
+#include <cstring>
+
+using namespace Tga;
+
+namespace
+{
+	constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+	{
+		return static_cast<uint32_t>(static_cast<uint8_t>(a))
+			| (static_cast<uint32_t>(static_cast<uint8_t>(b)) << 8)
+			| (static_cast<uint32_t>(static_cast<uint8_t>(c)) << 16)
+			| (static_cast<uint32_t>(static_cast<uint8_t>(d)) << 24);
+	}
+
+	uint32_t ReadUInt32(const uint8_t* someData, size_t anOffset)
+	{
+		uint32_t value;
+		memcpy(&value, someData + anOffset, sizeof(value));
+		return value;
+	}
+
+	// Offsets into the file, the DDS_HEADER starts after the four byte magic.
+	constexpr size_t HeaderStart = 4;
+	constexpr size_t HeaderSize = 124;
+	constexpr size_t DX10HeaderSize = 20;
+	constexpr size_t HeightOffset = HeaderStart + 8;
+	constexpr size_t WidthOffset = HeaderStart + 12;
+	constexpr size_t DepthOffset = HeaderStart + 20;
+	constexpr size_t MipCountOffset = HeaderStart + 24;
+	constexpr size_t PixelFormatOffset = HeaderStart + 72;
+	constexpr size_t Caps2Offset = HeaderStart + 108;
+
+	constexpr uint32_t DDPF_FOURCC = 0x4;
+	constexpr uint32_t DDPF_RGB = 0x40;
+	constexpr uint32_t DDSCAPS2_CUBEMAP = 0x200;
+	constexpr uint32_t DDSCAPS2_VOLUME = 0x200000;
+	constexpr uint32_t D3D10_RESOURCE_DIMENSION_TEXTURE2D = 3;
+	constexpr uint32_t D3D10_RESOURCE_MISC_TEXTURECUBE = 0x4;
+
+	DXGI_FORMAT GetLegacyFormat(const uint8_t* somePixelFormat)
+	{
+		const uint32_t flags = ReadUInt32(somePixelFormat, 4);
+		const uint32_t fourCC = ReadUInt32(somePixelFormat, 8);
+
+		if (flags & DDPF_FOURCC)
+		{
+			switch (fourCC)
+			{
+			case MakeFourCC('D', 'X', 'T', '1'): return DXGI_FORMAT_BC1_UNORM;
+			case MakeFourCC('D', 'X', 'T', '2'):
+			case MakeFourCC('D', 'X', 'T', '3'): return DXGI_FORMAT_BC2_UNORM;
+			case MakeFourCC('D', 'X', 'T', '4'):
+			case MakeFourCC('D', 'X', 'T', '5'): return DXGI_FORMAT_BC3_UNORM;
+			case MakeFourCC('A', 'T', 'I', '1'):
+			case MakeFourCC('B', 'C', '4', 'U'): return DXGI_FORMAT_BC4_UNORM;
+			case MakeFourCC('B', 'C', '4', 'S'): return DXGI_FORMAT_BC4_SNORM;
+			case MakeFourCC('A', 'T', 'I', '2'):
+			case MakeFourCC('B', 'C', '5', 'U'): return DXGI_FORMAT_BC5_UNORM;
+			case MakeFourCC('B', 'C', '5', 'S'): return DXGI_FORMAT_BC5_SNORM;
+			// D3DFORMAT values stored as the FourCC.
+			case 36: return DXGI_FORMAT_R16G16B16A16_UNORM;
+			case 113: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+			case 116: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+			default: return DXGI_FORMAT_UNKNOWN;
+			}
+		}
+
+		if ((flags & DDPF_RGB) && ReadUInt32(somePixelFormat, 12) == 32)
+		{
+			const uint32_t redMask = ReadUInt32(somePixelFormat, 16);
+			const uint32_t greenMask = ReadUInt32(somePixelFormat, 20);
+			const uint32_t blueMask = ReadUInt32(somePixelFormat, 24);
+			const uint32_t alphaMask = ReadUInt32(somePixelFormat, 28);
+
+			if (redMask == 0x000000ff && greenMask == 0x0000ff00 && blueMask == 0x00ff0000 && alphaMask == 0xff000000)
+			{
+				return DXGI_FORMAT_R8G8B8A8_UNORM;
+			}
+			if (redMask == 0x00ff0000 && greenMask == 0x0000ff00 && blueMask == 0x000000ff)
+			{
+				return alphaMask == 0xff000000 ? DXGI_FORMAT_B8G8R8A8_UNORM : DXGI_FORMAT_B8G8R8X8_UNORM;
+			}
+		}
+
+		// Everything else is rare enough to be left to the DDS loader.
+		return DXGI_FORMAT_UNKNOWN;
+	}
+}
+
+uint64_t DDSLayout::GetSizeFromMip(uint32_t aFirstMip) const
+{
+	uint64_t size = 0;
+	for (uint32_t mip = aFirstMip; mip < GetMipCount(); mip++)
+	{
+		size += myMips[mip].mySize;
+	}
+	return size;
+}
+
+bool DDSLayout::CanBeTopMip(uint32_t aMip) const
+{
+	if (aMip >= GetMipCount())
+	{
+		return false;
+	}
+
+	uint32_t bytesPerBlock;
+	GetFormatSize(myFormat, bytesPerBlock);
+	return bytesPerBlock == 0 || (myMips[aMip].myWidth % 4 == 0 && myMips[aMip].myHeight % 4 == 0);
+}
+
+uint32_t DDSLayout::GetFormatSize(DXGI_FORMAT aFormat, uint32_t& outBytesPerBlock)
+{
+	outBytesPerBlock = 0;
+	switch (aFormat)
+	{
+	case DXGI_FORMAT_BC1_TYPELESS: case DXGI_FORMAT_BC1_UNORM: case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_TYPELESS: case DXGI_FORMAT_BC4_UNORM: case DXGI_FORMAT_BC4_SNORM:
+		outBytesPerBlock = 8;
+		return 0;
+
+	case DXGI_FORMAT_BC2_TYPELESS: case DXGI_FORMAT_BC2_UNORM: case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_TYPELESS: case DXGI_FORMAT_BC3_UNORM: case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_TYPELESS: case DXGI_FORMAT_BC5_UNORM: case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_TYPELESS: case DXGI_FORMAT_BC6H_UF16: case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_TYPELESS: case DXGI_FORMAT_BC7_UNORM: case DXGI_FORMAT_BC7_UNORM_SRGB:
+		outBytesPerBlock = 16;
+		return 0;
+
+	case DXGI_FORMAT_R32G32B32A32_TYPELESS: case DXGI_FORMAT_R32G32B32A32_FLOAT:
+	case DXGI_FORMAT_R32G32B32A32_UINT: case DXGI_FORMAT_R32G32B32A32_SINT:
+		return 128;
+
+	case DXGI_FORMAT_R32G32B32_TYPELESS: case DXGI_FORMAT_R32G32B32_FLOAT:
+	case DXGI_FORMAT_R32G32B32_UINT: case DXGI_FORMAT_R32G32B32_SINT:
+		return 96;
+
+	case DXGI_FORMAT_R16G16B16A16_TYPELESS: case DXGI_FORMAT_R16G16B16A16_FLOAT: case DXGI_FORMAT_R16G16B16A16_UNORM:
+	case DXGI_FORMAT_R16G16B16A16_UINT: case DXGI_FORMAT_R16G16B16A16_SNORM: case DXGI_FORMAT_R16G16B16A16_SINT:
+	case DXGI_FORMAT_R32G32_TYPELESS: case DXGI_FORMAT_R32G32_FLOAT: case DXGI_FORMAT_R32G32_UINT: case DXGI_FORMAT_R32G32_SINT:
+		return 64;
+
+	case DXGI_FORMAT_R10G10B10A2_TYPELESS: case DXGI_FORMAT_R10G10B10A2_UNORM: case DXGI_FORMAT_R10G10B10A2_UINT:
+	case DXGI_FORMAT_R11G11B10_FLOAT:
+	case DXGI_FORMAT_R8G8B8A8_TYPELESS: case DXGI_FORMAT_R8G8B8A8_UNORM: case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+	case DXGI_FORMAT_R8G8B8A8_UINT: case DXGI_FORMAT_R8G8B8A8_SNORM: case DXGI_FORMAT_R8G8B8A8_SINT:
+	case DXGI_FORMAT_R16G16_TYPELESS: case DXGI_FORMAT_R16G16_FLOAT: case DXGI_FORMAT_R16G16_UNORM:
+	case DXGI_FORMAT_R16G16_UINT: case DXGI_FORMAT_R16G16_SNORM: case DXGI_FORMAT_R16G16_SINT:
+	case DXGI_FORMAT_R32_TYPELESS: case DXGI_FORMAT_R32_FLOAT: case DXGI_FORMAT_R32_UINT: case DXGI_FORMAT_R32_SINT:
+	case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+	case DXGI_FORMAT_B8G8R8A8_UNORM: case DXGI_FORMAT_B8G8R8X8_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_TYPELESS: case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8X8_TYPELESS: case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+		return 32;
+
+	case DXGI_FORMAT_R8G8_TYPELESS: case DXGI_FORMAT_R8G8_UNORM: case DXGI_FORMAT_R8G8_UINT:
+	case DXGI_FORMAT_R8G8_SNORM: case DXGI_FORMAT_R8G8_SINT:
+	case DXGI_FORMAT_R16_TYPELESS: case DXGI_FORMAT_R16_FLOAT: case DXGI_FORMAT_R16_UNORM:
+	case DXGI_FORMAT_R16_UINT: case DXGI_FORMAT_R16_SNORM: case DXGI_FORMAT_R16_SINT:
+	case DXGI_FORMAT_B5G6R5_UNORM: case DXGI_FORMAT_B5G5R5A1_UNORM: case DXGI_FORMAT_B4G4R4A4_UNORM:
+		return 16;
+
+	case DXGI_FORMAT_R8_TYPELESS: case DXGI_FORMAT_R8_UNORM: case DXGI_FORMAT_R8_UINT:
+	case DXGI_FORMAT_R8_SNORM: case DXGI_FORMAT_R8_SINT: case DXGI_FORMAT_A8_UNORM:
+		return 8;
+
+	default:
+		return 0;
+	}
+}
+
+bool DDSLayout::Parse(const uint8_t* someHeaderData, size_t aHeaderDataSize, uint64_t aFileSize, DDSLayout& outLayout)
+{
+	outLayout = DDSLayout();
+
+	if (aHeaderDataSize < HeaderStart + HeaderSize || aFileSize < HeaderStart + HeaderSize
+		|| memcmp(someHeaderData, "DDS ", 4) != 0 || ReadUInt32(someHeaderData, HeaderStart) != HeaderSize)
+	{
+		return false;
+	}
+
+	const uint32_t height = ReadUInt32(someHeaderData, HeightOffset);
+	const uint32_t width = ReadUInt32(someHeaderData, WidthOffset);
+	const uint32_t depth = ReadUInt32(someHeaderData, DepthOffset);
+	const uint32_t caps2 = ReadUInt32(someHeaderData, Caps2Offset);
+	// Like the DDS loader, the count is trusted even when the header flags don't mention it.
+	uint32_t mipCount = ReadUInt32(someHeaderData, MipCountOffset);
+	if (mipCount == 0)
+	{
+		mipCount = 1;
+	}
+
+	// Larger than any D3D11 texture, this also keeps the size math below from overflowing.
+	constexpr uint32_t maxDimension = 16384;
+	if (width == 0 || height == 0 || width > maxDimension || height > maxDimension || depth > 1
+		|| (caps2 & (DDSCAPS2_CUBEMAP | DDSCAPS2_VOLUME)))
+	{
+		return false;
+	}
+
+	uint32_t fullMipCount = 1;
+	while (((width | height) >> fullMipCount) > 0)
+	{
+		fullMipCount++;
+	}
+	if (mipCount > fullMipCount)
+	{
+		return false;
+	}
+
+	const uint8_t* pixelFormat = someHeaderData + PixelFormatOffset;
+	size_t dataOffset = HeaderStart + HeaderSize;
+	DXGI_FORMAT format;
+	if ((ReadUInt32(pixelFormat, 4) & DDPF_FOURCC) && ReadUInt32(pixelFormat, 8) == MakeFourCC('D', 'X', '1', '0'))
+	{
+		if (aHeaderDataSize < MaxHeaderSize)
+		{
+			return false;
+		}
+
+		const uint8_t* dx10Header = someHeaderData + dataOffset;
+		format = static_cast<DXGI_FORMAT>(ReadUInt32(dx10Header, 0));
+		const uint32_t dimension = ReadUInt32(dx10Header, 4);
+		const uint32_t miscFlags = ReadUInt32(dx10Header, 8);
+		const uint32_t arraySize = ReadUInt32(dx10Header, 12);
+		if (dimension != D3D10_RESOURCE_DIMENSION_TEXTURE2D || (miscFlags & D3D10_RESOURCE_MISC_TEXTURECUBE) || arraySize != 1)
+		{
+			return false;
+		}
+		dataOffset += DX10HeaderSize;
+	}
+	else
+	{
+		format = GetLegacyFormat(pixelFormat);
+	}
+
+	uint32_t bytesPerBlock;
+	const uint32_t bitsPerPixel = GetFormatSize(format, bytesPerBlock);
+	if (bitsPerPixel == 0 && bytesPerBlock == 0)
+	{
+		return false;
+	}
+
+	outLayout.myFormat = format;
+	outLayout.myWidth = width;
+	outLayout.myHeight = height;
+	outLayout.myMips.resize(mipCount);
+
+	uint64_t offset = dataOffset;
+	for (uint32_t mip = 0; mip < mipCount; mip++)
+	{
+		DDSMipLevel& level = outLayout.myMips[mip];
+		level.myWidth = width >> mip > 0 ? width >> mip : 1;
+		level.myHeight = height >> mip > 0 ? height >> mip : 1;
+
+		uint32_t rowCount;
+		if (bytesPerBlock > 0)
+		{
+			level.myRowPitch = ((level.myWidth + 3) / 4) * bytesPerBlock;
+			rowCount = (level.myHeight + 3) / 4;
+		}
+		else
+		{
+			level.myRowPitch = (level.myWidth * bitsPerPixel + 7) / 8;
+			rowCount = level.myHeight;
+		}
+
+		level.myOffset = offset;
+		level.mySize = static_cast<uint64_t>(level.myRowPitch) * rowCount;
+		offset += level.mySize;
+	}
+
+	if (offset > aFileSize)
+	{
+		outLayout = DDSLayout();
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <dxgiformat.h>
+
+namespace Tga
+{
+
+struct DDSMipLevel
+{
+	// Where the mip starts in the .dds file and how many bytes it takes.
+	uint64_t myOffset;
+	uint64_t mySize;
+	uint32_t myRowPitch;
+	uint32_t myWidth;
+	uint32_t myHeight;
+};
+
+/// <summary>
+/// Where every mip of a plain 2D .dds texture is in the file, so mips can be read on their own.
+/// Only needs the header, nothing here touches the GPU.
+/// </summary>
+struct DDSLayout
+{
+	// "DDS " and the DDS_HEADER, plus the DDS_HEADER_DXT10 if there is one. Reading this much is always enough for Parse.
+	static constexpr size_t MaxHeaderSize = 4 + 124 + 20;
+
+	DXGI_FORMAT myFormat = DXGI_FORMAT_UNKNOWN;
+	uint32_t myWidth = 0;
+	uint32_t myHeight = 0;
+	std::vector<DDSMipLevel> myMips;
+
+	uint32_t GetMipCount() const { return static_cast<uint32_t>(myMips.size()); }
+
+	/**
+	 * @returns The bytes of the mips from aFirstMip to the smallest one, which is what a texture that has aFirstMip as
+	 * its top mip takes.
+	 */
+	uint64_t GetSizeFromMip(uint32_t aFirstMip) const;
+
+	/**
+	 * @returns true if a texture can be created with aMip as its top mip. D3D11 wants the top mip of a block compressed
+	 * texture to be whole 4x4 blocks, so the smallest mips of those can only be below another mip.
+	 */
+	bool CanBeTopMip(uint32_t aMip) const;
+
+	/**
+	 * Reads the layout from the start of a .dds file. Cube maps, volumes, arrays and formats that aren't a whole
+	 * number of bytes per pixel or block are refused, those have to be loaded whole.
+	 * @param someHeaderData At least the first min(MaxHeaderSize, aFileSize) bytes of the file.
+	 * @param aFileSize Size of the whole file, mips that don't fit in it make the parse fail.
+	 * @returns false if the file isn't a .dds texture that can be streamed by mip.
+	 */
+	static bool Parse(const uint8_t* someHeaderData, size_t aHeaderDataSize, uint64_t aFileSize, DDSLayout& outLayout);
+
+	/**
+	 * @param outBytesPerBlock Bytes per 4x4 block for block compressed formats, 0 for the others.
+	 * @returns Bits per pixel for formats that aren't block compressed, 0 for unsupported formats.
+	 */
+	static uint32_t GetFormatSize(DXGI_FORMAT aFormat, uint32_t& outBytesPerBlock);
+};
+
+} // namespace Tga
@@ -0,0 +1,126 @@
+#include "stdafx.h"
+
+#include <tge/texture/MipStreamingPolicy.h>
+#include <tge/texture/DDSLayout.h>
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <vector>
+
+using namespace Tga;
+
+uint32_t MipStreamingPolicy::CalculateTailMip(const DDSLayout& aLayout, uint32_t aTailSize)
+{
+	const uint32_t mipCount = aLayout.GetMipCount();
+	uint32_t tailMip = mipCount > 0 ? mipCount - 1 : 0;
+	for (uint32_t mip = 0; mip < mipCount; mip++)
+	{
+		if (aLayout.myMips[mip].myWidth <= aTailSize && aLayout.myMips[mip].myHeight <= aTailSize)
+		{
+			tailMip = mip;
+			break;
+		}
+	}
+
+	// Every mip is half of the one above, so the mips that can be a top mip all come before the ones that can't.
+	while (tailMip > 0 && !aLayout.CanBeTopMip(tailMip))
+	{
+		tailMip--;
+	}
+	return tailMip;
+}
+
+uint32_t MipStreamingPolicy::CalculateFinestMip(const DDSLayout& aLayout, uint32_t aMaxSize)
+{
+	if (aMaxSize == 0)
+	{
+		return 0;
+	}
+	return CalculateTailMip(aLayout, aMaxSize);
+}
+
+uint32_t MipStreamingPolicy::CalculateWantedMip(const DDSLayout& aLayout, float aScreenSize, uint32_t aFinestMip, uint32_t aTailMip)
+{
+	if (aScreenSize <= 0.0f || aLayout.GetMipCount() == 0)
+	{
+		return aTailMip;
+	}
+
+	// Each mip down halves the size, so the coarsest mip that is still at least aScreenSize is log2(size / screen) down.
+	const float size = static_cast<float>(std::max(aLayout.myWidth, aLayout.myHeight));
+	const float mip = std::floor(std::log2(size / aScreenSize));
+	if (mip <= static_cast<float>(aFinestMip))
+	{
+		return aFinestMip;
+	}
+	return std::min(static_cast<uint32_t>(mip), aTailMip);
+}
+
+uint64_t MipStreamingPolicy::FitToBudget(Entry* someEntries, size_t anEntryCount, uint64_t aBudget)
+{
+	uint64_t total = 0;
+	for (size_t i = 0; i < anEntryCount; i++)
+	{
+		Entry& entry = someEntries[i];
+		entry.myTargetMip = std::clamp(entry.myWantedMip, std::min(entry.myFinestMip, entry.myTailMip), entry.myTailMip);
+		total += entry.myLayout->GetSizeFromMip(entry.myTargetMip);
+	}
+	if (total <= aBudget)
+	{
+		// Dropping a mip that is still resident would only have to be streamed back in if the texture comes closer.
+		using Candidate = std::pair<uint64_t, size_t>;
+		std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> keep;
+		for (size_t i = 0; i < anEntryCount; i++)
+		{
+			const Entry& entry = someEntries[i];
+			if (entry.myResidentMip < entry.myTargetMip)
+			{
+				keep.push({ entry.myLayout->myMips[entry.myTargetMip - 1].mySize, i });
+			}
+		}
+
+		while (!keep.empty() && total + keep.top().first <= aBudget)
+		{
+			const size_t index = keep.top().second;
+			keep.pop();
+
+			Entry& entry = someEntries[index];
+			entry.myTargetMip--;
+			total += entry.myLayout->myMips[entry.myTargetMip].mySize;
+			if (entry.myResidentMip < entry.myTargetMip)
+			{
+				keep.push({ entry.myLayout->myMips[entry.myTargetMip - 1].mySize, index });
+			}
+		}
+		return total;
+	}
+
+	// Largest top mip first. Entries are pushed back with their next mip until they reach their tail.
+	using Candidate = std::pair<uint64_t, size_t>;
+	std::vector<Candidate> heapStorage;
+	heapStorage.reserve(anEntryCount);
+	for (size_t i = 0; i < anEntryCount; i++)
+	{
+		const Entry& entry = someEntries[i];
+		if (entry.myTargetMip < entry.myTailMip)
+		{
+			heapStorage.push_back({ entry.myLayout->myMips[entry.myTargetMip].mySize, i });
+		}
+	}
+	std::priority_queue<Candidate> candidates(std::less<Candidate>(), std::move(heapStorage));
+
+	while (total > aBudget && !candidates.empty())
+	{
+		const size_t index = candidates.top().second;
+		candidates.pop();
+
+		Entry& entry = someEntries[index];
+		total -= entry.myLayout->myMips[entry.myTargetMip].mySize;
+		entry.myTargetMip++;
+		if (entry.myTargetMip < entry.myTailMip)
+		{
+			candidates.push({ entry.myLayout->myMips[entry.myTargetMip].mySize, index });
+		}
+	}
+	return total;
+}
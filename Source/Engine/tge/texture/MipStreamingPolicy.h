@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace Tga
+{
+
+struct DDSLayout;
+
+/// <summary>
+/// Decides which mips of streamed textures should be resident. Works on layouts and sizes only, so it has no GPU or
+/// file dependencies.
+/// </summary>
+namespace MipStreamingPolicy
+{
+	// Mips at or below this size are loaded with the texture and never streamed out.
+	constexpr uint32_t TailSize = 64;
+
+	struct Entry
+	{
+		const DDSLayout* myLayout;
+		// Finest mip the texture is allowed to have, from the max size it was requested with.
+		uint32_t myFinestMip;
+		// Coarsest top mip, the mip tail below it is always resident.
+		uint32_t myTailMip;
+		// The top mip its on-screen size asks for.
+		uint32_t myWantedMip;
+		// The top mip it has on the GPU right now.
+		uint32_t myResidentMip;
+		// Written by FitToBudget: the top mip it gets.
+		uint32_t myTargetMip;
+	};
+
+	/**
+	 * @returns The largest mip whose width and height both fit in aTailSize, or the smallest mip if none does. Moved up
+	 * to a finer mip if that one can't be a top mip, see DDSLayout::CanBeTopMip.
+	 */
+	uint32_t CalculateTailMip(const DDSLayout& aLayout, uint32_t aTailSize = TailSize);
+
+	/**
+	 * @returns The largest mip whose width and height both fit in aMaxSize, 0 for no limit.
+	 */
+	uint32_t CalculateFinestMip(const DDSLayout& aLayout, uint32_t aMaxSize);
+
+	/**
+	 * Picks the coarsest mip that still has at least one texel per pixel when the texture is aScreenSize pixels at
+	 * its largest on screen. 0 means it wasn't drawn and gives the tail mip.
+	 */
+	uint32_t CalculateWantedMip(const DDSLayout& aLayout, float aScreenSize, uint32_t aFinestMip, uint32_t aTailMip);
+
+	/**
+	 * Gives every entry its wanted mip, then drops the top mip of whichever texture has the largest top mip until the
+	 * total fits in aBudget or only mip tails are left. Each step halves the resolution of one texture, so taking the
+	 * largest top mip frees the most memory per step. If the wanted mips fit, resident mips finer than wanted are kept
+	 * while there is room for them, smallest first, so mips are only streamed out when the budget needs it.
+	 * @returns The total bytes of the resulting mips.
+	 */
+	uint64_t FitToBudget(Entry* someEntries, size_t anEntryCount, uint64_t aBudget);
+}
+
+} // namespace Tga
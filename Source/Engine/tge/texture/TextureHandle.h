@@ -0,0 +1,35 @@
+#pragma once
+
+namespace Tga
+{
+	class Texture;
+	class TextureManager;
+
+	/// <summary>
+	/// Reference counted access to a texture from TextureManager::AcquireTexture. The texture can't be evicted while
+	/// a handle to it exists.
+	/// </summary>
+	class TextureHandle
+	{
+	public:
+		TextureHandle() = default;
+		TextureHandle(const TextureHandle& anOther);
+		TextureHandle(TextureHandle&& anOther) noexcept;
+		~TextureHandle();
+		TextureHandle& operator=(const TextureHandle& anOther);
+		TextureHandle& operator=(TextureHandle&& anOther) noexcept;
+
+		Texture* Get() const { return myTexture; }
+		Texture* operator->() const { return myTexture; }
+		explicit operator bool() const { return myTexture != nullptr; }
+
+		void Reset();
+
+	private:
+		friend class TextureManager;
+		TextureHandle(TextureManager* aManager, Texture* aTexture);
+
+		TextureManager* myManager = nullptr;
+		Texture* myTexture = nullptr;
+	};
+}
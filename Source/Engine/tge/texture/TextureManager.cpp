@@ -1,6 +1,7 @@
 #include "stdafx.h"
 
 #include <tge/texture/TextureManager.h>
+#include <tge/texture/MipStreamingPolicy.h>
 #include <DDSTextureLoader/DDSTextureLoader11.h>
 #include <WICTextureLoader/WICTextureLoader11.h>
 #include <tge/engine.h>
@@ -12,6 +13,8 @@
 #include <tge/filewatcher/FileWatcher.h>
 #include "xxh64_en.hpp"
 #include <tge/settings/settings.h>
+#include <tge/filesystem/FileView.h>
+#include <tge/filesystem/VirtualFileSystem.h>
 
 //  Define min max macros required by GDI+ headers.
 #ifndef max
@@ -79,36 +82,557 @@ bool IsTarga(std::wstring aPath)
 	}
 }
 
+namespace
+{
+	// How many frames a mip streamed texture has to be drawn smaller before its mips are picked for the smaller size.
+	constexpr uint64_t ScreenSizeWindow = 30;
+
+	DXGI_FORMAT MakeSRGB(DXGI_FORMAT aFormat)
+	{
+		switch (aFormat)
+		{
+		case DXGI_FORMAT_R8G8B8A8_UNORM: return DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+		case DXGI_FORMAT_B8G8R8A8_UNORM: return DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+		case DXGI_FORMAT_B8G8R8X8_UNORM: return DXGI_FORMAT_B8G8R8X8_UNORM_SRGB;
+		case DXGI_FORMAT_BC1_UNORM: return DXGI_FORMAT_BC1_UNORM_SRGB;
+		case DXGI_FORMAT_BC2_UNORM: return DXGI_FORMAT_BC2_UNORM_SRGB;
+		case DXGI_FORMAT_BC3_UNORM: return DXGI_FORMAT_BC3_UNORM_SRGB;
+		case DXGI_FORMAT_BC7_UNORM: return DXGI_FORMAT_BC7_UNORM_SRGB;
+		default: return aFormat;
+		}
+	}
+}
+
+uint64_t TextureManager::HashPath(const wchar_t* aTexturePath)
+{
+	return xxh64::hash(reinterpret_cast<const char*>(aTexturePath), sizeof(wchar_t) * wcslen(aTexturePath), 0);
+}
+
 Texture* TextureManager::GetTexture(const wchar_t* aTexturePath, bool aForceSRGB, bool aForceReload)
 {
 	if (!aTexturePath)
 	{
 		aTexturePath = L"";
 	}
-	
-	std::wstring toString = aTexturePath;
-	const uint64_t hashedID = xxh64::hash((char*)toString.c_str(), sizeof(wchar_t)*toString.length(), 0);
-	auto it = std::find_if(myResourceViews.begin(), myResourceViews.end(), [hashedID](const std::unique_ptr<Texture>& s) { return s->myID == hashedID; });
-	
-	Texture* loadedTexture = nullptr;
-	if (it != myResourceViews.end())
+
+	Texture* texture = LoadTexture(aTexturePath, HashPath(aTexturePath), aForceSRGB, aForceReload);
+	if (texture)
+	{
+		texture->myIsPinned = true;
+		texture->myLastUsedFrame = myFrame;
+	}
+	return texture;
+}
+
+TextureHandle TextureManager::AcquireTexture(const wchar_t* aTexturePath, bool aForceSRGB)
+{
+	if (!aTexturePath)
+	{
+		aTexturePath = L"";
+	}
+
+	Texture* texture = LoadTexture(aTexturePath, HashPath(aTexturePath), aForceSRGB, false);
+	if (!texture)
+	{
+		return TextureHandle();
+	}
+	texture->myLastUsedFrame = myFrame;
+	return TextureHandle(this, texture);
+}
+
+TextureHandle TextureManager::TryAcquireTexture(const wchar_t* aTexturePath, bool aForceSRGB)
+{
+	if (!aTexturePath)
+	{
+		return TextureHandle();
+	}
+
+	Texture* texture = TryLoadTexture(aTexturePath, HashPath(aTexturePath), aForceSRGB);
+	if (!texture)
+	{
+		return TextureHandle();
+	}
+	texture->myLastUsedFrame = myFrame;
+	return TextureHandle(this, texture);
+}
+
+TextureHandle TextureManager::RequestTexture(const wchar_t* aTexturePath, bool aForceSRGB, int aPriority, uint32_t aMaxSize)
+{
+	if (!aTexturePath)
+	{
+		aTexturePath = L"";
+	}
+
+	const uint64_t hashedID = HashPath(aTexturePath);
+	auto it = myTextures.find(hashedID);
+	Texture* texture = it != myTextures.end() ? it->second.get() : nullptr;
+	if (texture && !texture->myIsReleased)
+	{
+		texture->myLastUsedFrame = myFrame;
+		return TextureHandle(this, texture);
+	}
+
+	auto streaming = myStreamingRequests.find(hashedID);
+	if (streaming != myStreamingRequests.end())
+	{
+		TextureStreamer::Request& request = *streaming->second;
+		if (aPriority > request.myPriority)
+		{
+			request.myPriority = aPriority;
+		}
+		return TextureHandle(this, texture);
+	}
+
+	if (!texture)
+	{
+		texture = new Texture();
+		texture->myID = hashedID;
+		texture->myPath = Settings::ResolveAssetPathW(aTexturePath);
+		myTextures.emplace(hashedID, std::unique_ptr<Texture>(texture));
+		Engine::GetInstance()->GetFileWatcher()->WatchFileChange(texture->myPath, std::bind(&Tga::TextureManager::OnTextureChanged, this, std::placeholders::_1));
+	}
+
+	// Not resident until the upload, so GetTexture still loads it synchronously if someone can't wait.
+	texture->SetShaderResourceView(myWhiteSquareTexture->GetShaderResourceView());
+	texture->mySize = myWhiteSquareTexture->mySize;
+	texture->myImageSize = myWhiteSquareTexture->myImageSize;
+	texture->myIsSRGB = aForceSRGB;
+	texture->myIsReleased = true;
+	texture->myLastUsedFrame = myFrame;
+
+	std::shared_ptr<TextureStreamer::Request> request = std::make_shared<TextureStreamer::Request>();
+	request->myPath = texture->myPath;
+	request->myID = hashedID;
+	request->myIsSRGB = aForceSRGB;
+	request->myMaxSize = aMaxSize;
+	request->myPriority = aPriority;
+	request->myIsMipStreamed = true;
+
+	myStreamer.Init();
+	myStreamer.Enqueue(request);
+	myStreamingRequests.emplace(hashedID, std::move(request));
+
+	return TextureHandle(this, texture);
+}
+
+void TextureManager::CancelTextureRequest(const Texture* aTexture)
+{
+	if (aTexture)
+	{
+		CancelStreaming(aTexture->myID);
+	}
+}
+
+bool TextureManager::IsStreaming(const Texture* aTexture) const
+{
+	return aTexture && myStreamingRequests.find(aTexture->myID) != myStreamingRequests.end();
+}
+
+void TextureManager::CancelStreaming(uint64_t aHashedID)
+{
+	auto it = myStreamingRequests.find(aHashedID);
+	if (it == myStreamingRequests.end())
+	{
+		return;
+	}
+
+	// The I/O thread skips or drops it, and so does UploadStreamedTextures if it is already decoded.
+	it->second->myIsCancelled = true;
+	myStreamingRequests.erase(it);
+}
+
+void TextureManager::UploadStreamedTextures()
+{
+	myStatistics.StreamedBytesLastFrame = 0;
+	myStreamer.CollectCompleted(myDecodedRequests);
+	if (myDecodedRequests.empty())
+	{
+		myStatistics.StreamingCount = myStreamingRequests.size();
+		return;
+	}
+
+	// Stable so equal priorities upload in the order they finished decoding.
+	std::stable_sort(myDecodedRequests.begin(), myDecodedRequests.end(), [](const std::shared_ptr<TextureStreamer::Request>& aFirst, const std::shared_ptr<TextureStreamer::Request>& aSecond)
+	{
+		return aFirst->myPriority > aSecond->myPriority;
+	});
+
+	size_t uploadedCount = 0;
+	size_t processedCount = 0;
+	for (; processedCount < myDecodedRequests.size(); processedCount++)
+	{
+		const TextureStreamer::Request& request = *myDecodedRequests[processedCount];
+		if (request.myIsCancelled)
+		{
+			continue;
+		}
+		if (uploadedCount > 0 && myStatistics.StreamedBytesLastFrame + request.myUploadSize > myStreamingUploadBudget)
+		{
+			break;
+		}
+
+		if (request.myIsMipUpdate)
+		{
+			FinishMipUpdate(request);
+		}
+		else
+		{
+			FinishStreaming(request);
+		}
+		myStatistics.StreamedBytesLastFrame += request.myUploadSize;
+		uploadedCount++;
+	}
+	myDecodedRequests.erase(myDecodedRequests.begin(), myDecodedRequests.begin() + processedCount);
+	myStatistics.StreamingCount = myStreamingRequests.size();
+}
+
+void TextureManager::FinishStreaming(const TextureStreamer::Request& aRequest)
+{
+	auto streaming = myStreamingRequests.find(aRequest.myID);
+	if (streaming == myStreamingRequests.end() || streaming->second.get() != &aRequest)
+	{
+		return;
+	}
+	myStreamingRequests.erase(streaming);
+
+	Texture& texture = *myTextures.at(aRequest.myID);
+	if (aRequest.myIsDecoded && aRequest.myDataType == TextureStreamer::DataType::DDSMips)
+	{
+		if (StartMipStreaming(texture, aRequest))
+		{
+			return;
+		}
+
+		// The mips couldn't be put together on the GPU, so the texture is streamed again and loaded whole by the DDS
+		// loader, like files that can't be streamed by mip are.
+		std::shared_ptr<TextureStreamer::Request> request = std::make_shared<TextureStreamer::Request>();
+		request->myPath = aRequest.myPath;
+		request->myID = aRequest.myID;
+		request->myIsSRGB = aRequest.myIsSRGB;
+		request->myMaxSize = aRequest.myMaxSize;
+		request->myPriority = aRequest.myPriority.load();
+		myStreamer.Enqueue(request);
+		myStreamingRequests.emplace(aRequest.myID, std::move(request));
+		return;
+	}
+
+	ComPtr<ID3D11ShaderResourceView> resource;
+	if (!aRequest.myIsDecoded || !CreateStreamedResource(aRequest, resource))
+	{
+		ERROR_PRINT("%s %s", "Failed to load resource: ", aRequest.myPath.c_str());
+		SetFailed(texture);
+		return;
+	}
+
+	texture.myIsFailedTexture = false;
+	SetResident(texture, resource.Get());
+	SetDebugObjectName(texture.GetShaderResourceView(), texture.myPath);
+	texture.mySize = GetTextureSize(resource.Get());
+	texture.myImageSize = GetTextureSize(resource.Get(), false);
+}
+
+bool TextureManager::CreateStreamedResource(const TextureStreamer::Request& aRequest, ComPtr<ID3D11ShaderResourceView>& outResource)
+{
+	if (aRequest.myDataType == TextureStreamer::DataType::DDS)
+	{
+		const HRESULT hr = DirectX::CreateDDSTextureFromMemoryEx(DX11::Device, aRequest.GetData(), aRequest.GetDataSize(),
+			aRequest.myMaxSize, D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0,
+			aRequest.myIsSRGB,
+			nullptr, outResource.ReleaseAndGetAddressOf());
+		return SUCCEEDED(hr);
+	}
+
+	// Like the WIC loader, the full mip chain is generated on the GPU from the top level.
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = aRequest.myWidth;
+	desc.Height = aRequest.myHeight;
+	desc.MipLevels = 0;
+	desc.ArraySize = 1;
+	desc.Format = aRequest.myIsSRGB ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+	desc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
+
+	ComPtr<ID3D11Texture2D> texture;
+	if (FAILED(DX11::Device->CreateTexture2D(&desc, nullptr, texture.GetAddressOf()))
+		|| FAILED(DX11::Device->CreateShaderResourceView(texture.Get(), nullptr, outResource.ReleaseAndGetAddressOf())))
+	{
+		return false;
+	}
+
+	DX11::Context->UpdateSubresource(texture.Get(), 0, nullptr, aRequest.GetData(), aRequest.myWidth * 4, 0);
+	DX11::Context->GenerateMips(outResource.Get());
+	return true;
+}
+
+bool TextureManager::StartMipStreaming(Texture& aTexture, const TextureStreamer::Request& aRequest)
+{
+	StopMipStreaming(aTexture);
+
+	MipStreamingState& state = myMipStreaming.try_emplace(aRequest.myID).first->second;
+	state.myLayout = aRequest.myLayout;
+	state.myFormat = aRequest.myIsSRGB ? MakeSRGB(aRequest.myLayout.myFormat) : aRequest.myLayout.myFormat;
+	state.myPriority = aRequest.myPriority;
+	state.myFinestMip = MipStreamingPolicy::CalculateFinestMip(state.myLayout, aRequest.myMaxSize);
+	state.myTailMip = aRequest.myFirstMip;
+	state.myResidentMip = aRequest.myFirstMip;
+
+	ComPtr<ID3D11ShaderResourceView> resource;
+	if (!CreateMipRange(state, aRequest.myFirstMip, aRequest.GetData(), aRequest.myFirstMip, aRequest.myEndMip, nullptr, 0, resource))
+	{
+		myMipStreaming.erase(aRequest.myID);
+		return false;
+	}
+
+	aTexture.myIsFailedTexture = false;
+	SetResident(aTexture, resource.Get());
+	SetDebugObjectName(aTexture.GetShaderResourceView(), aTexture.myPath);
+	aTexture.SetScreenSizeFeedback(&state.myScreenSizeFeedback);
+
+	// Sizes are of the full texture, so nothing drawn with it changes size when mips stream in or out.
+	const float targetHeight = static_cast<float>(Engine::GetInstance()->GetTargetSize().y);
+	aTexture.myImageSize = Vector2ui(state.myLayout.myWidth, state.myLayout.myHeight);
+	aTexture.mySize = Vector2f(static_cast<float>(state.myLayout.myWidth), static_cast<float>(state.myLayout.myHeight)) / targetHeight;
+	return true;
+}
+
+void TextureManager::StopMipStreaming(Texture& aTexture)
+{
+	auto it = myMipStreaming.find(aTexture.myID);
+	if (it == myMipStreaming.end())
+	{
+		return;
+	}
+
+	if (it->second.myPendingRequest)
+	{
+		it->second.myPendingRequest->myIsCancelled = true;
+	}
+	aTexture.SetScreenSizeFeedback(nullptr);
+	myMipStreaming.erase(it);
+}
+
+void TextureManager::UpdateMipStreaming()
+{
+	if (myMipStreaming.empty())
+	{
+		return;
+	}
+
+	const bool isWindowEnd = myFrame % ScreenSizeWindow == 0;
+	std::vector<MipStreamingPolicy::Entry> entries;
+	std::vector<std::pair<Texture*, MipStreamingState*>> streamed;
+	entries.reserve(myMipStreaming.size());
+	streamed.reserve(myMipStreaming.size());
+	size_t streamedBytes = 0;
+	for (auto& [id, state] : myMipStreaming)
+	{
+		// Grows right away so textures sharpen as soon as they come closer, but only shrinks once it was smaller for a
+		// whole window, so textures that are culled for a few frames don't stream out and back in.
+		const uint32_t frameScreenSize = state.myScreenSizeFeedback.exchange(0, std::memory_order_relaxed);
+		state.myWindowScreenSize = std::max(state.myWindowScreenSize, frameScreenSize);
+		state.myScreenSize = std::max(state.myScreenSize, frameScreenSize);
+		if (isWindowEnd)
+		{
+			state.myScreenSize = state.myWindowScreenSize;
+			state.myWindowScreenSize = 0;
+		}
+
+		MipStreamingPolicy::Entry entry;
+		entry.myLayout = &state.myLayout;
+		entry.myFinestMip = state.myFinestMip;
+		entry.myTailMip = state.myTailMip;
+		entry.myWantedMip = MipStreamingPolicy::CalculateWantedMip(state.myLayout, static_cast<float>(state.myScreenSize), state.myFinestMip, state.myTailMip);
+		entry.myResidentMip = state.myResidentMip;
+		entry.myTargetMip = state.myResidentMip;
+		entries.push_back(entry);
+
+		Texture* texture = myTextures.at(id).get();
+		streamed.push_back({ texture, &state });
+		streamedBytes += texture->myMemorySize;
+	}
+
+	// Mip streamed textures share what the rest of the textures leave of the budget.
+	const size_t otherBytes = myStatistics.ResidentBytes - streamedBytes;
+	const size_t budget = myStatistics.BudgetBytes > otherBytes ? myStatistics.BudgetBytes - otherBytes : 0;
+	MipStreamingPolicy::FitToBudget(entries.data(), entries.size(), budget);
+
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		const uint32_t targetMip = entries[i].myTargetMip;
+		Texture& texture = *streamed[i].first;
+		MipStreamingState& state = *streamed[i].second;
+
+		if (targetMip < state.myResidentMip)
+		{
+			// A request that is already reading finer mips finishes first, the rest is asked for after it.
+			if (state.myPendingRequest)
+			{
+				continue;
+			}
+
+			std::shared_ptr<TextureStreamer::Request> request = std::make_shared<TextureStreamer::Request>();
+			request->myPath = texture.myPath;
+			request->myID = texture.myID;
+			request->myIsSRGB = texture.myIsSRGB;
+			request->myPriority = state.myPriority;
+			request->myIsMipUpdate = true;
+			request->myLayout = state.myLayout;
+			request->myFirstMip = targetMip;
+			request->myEndMip = state.myResidentMip;
+			myStreamer.Enqueue(request);
+			state.myPendingRequest = std::move(request);
+			continue;
+		}
+
+		if (state.myPendingRequest)
+		{
+			state.myPendingRequest->myIsCancelled = true;
+			state.myPendingRequest.reset();
+		}
+
+		// Dropping mips copies the ones that stay to a smaller texture, so it shares the upload budget.
+		if (targetMip > state.myResidentMip)
+		{
+			const size_t copySize = static_cast<size_t>(state.myLayout.GetSizeFromMip(targetMip));
+			if (myStatistics.StreamedBytesLastFrame > 0 && myStatistics.StreamedBytesLastFrame + copySize > myStreamingUploadBudget)
+			{
+				continue;
+			}
+			if (ChangeResidentMip(texture, state, targetMip, nullptr, targetMip))
+			{
+				myStatistics.StreamedBytesLastFrame += copySize;
+			}
+		}
+	}
+}
+
+void TextureManager::FinishMipUpdate(const TextureStreamer::Request& aRequest)
+{
+	auto it = myMipStreaming.find(aRequest.myID);
+	if (it == myMipStreaming.end() || it->second.myPendingRequest.get() != &aRequest)
+	{
+		return;
+	}
+	MipStreamingState& state = it->second;
+	state.myPendingRequest.reset();
+
+	// A failed read keeps the mips it has, the next frame asks again.
+	if (!aRequest.myIsDecoded || aRequest.myEndMip != state.myResidentMip)
+	{
+		return;
+	}
+	ChangeResidentMip(*myTextures.at(aRequest.myID), state, aRequest.myFirstMip, aRequest.GetData(), aRequest.myEndMip);
+}
+
+bool TextureManager::ChangeResidentMip(Texture& aTexture, MipStreamingState& aState, uint32_t aTopMip, const uint8_t* someData, uint32_t aDataEndMip)
+{
+	ComPtr<ID3D11ShaderResourceView> resource;
+	if (!CreateMipRange(aState, aTopMip, someData, aTopMip, aDataEndMip, aTexture.GetShaderResourceView(), aState.myResidentMip, resource))
 	{
-		loadedTexture = it->get();
+		return false;
+	}
+
+	SetResident(aTexture, resource.Get());
+	SetDebugObjectName(aTexture.GetShaderResourceView(), aTexture.myPath);
+	aState.myResidentMip = aTopMip;
+	return true;
+}
+
+bool TextureManager::CreateMipRange(const MipStreamingState& aState, uint32_t aTopMip, const uint8_t* someData, uint32_t aDataFirstMip, uint32_t aDataEndMip,
+	ID3D11ShaderResourceView* anOldResource, uint32_t anOldTopMip, ComPtr<ID3D11ShaderResourceView>& outResource)
+{
+	const DDSLayout& layout = aState.myLayout;
+
+	// The policy never picks such a mip, a block compressed texture with a top mip that isn't whole blocks would
+	// fail to create anyway.
+	if (!layout.CanBeTopMip(aTopMip))
+	{
+		return false;
+	}
+
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = layout.myMips[aTopMip].myWidth;
+	desc.Height = layout.myMips[aTopMip].myHeight;
+	desc.MipLevels = layout.GetMipCount() - aTopMip;
+	desc.ArraySize = 1;
+	desc.Format = aState.myFormat;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	ComPtr<ID3D11Texture2D> texture;
+	if (FAILED(DX11::Device->CreateTexture2D(&desc, nullptr, texture.GetAddressOf()))
+		|| FAILED(DX11::Device->CreateShaderResourceView(texture.Get(), nullptr, outResource.ReleaseAndGetAddressOf())))
+	{
+		return false;
 	}
-	if (!aForceReload && loadedTexture)
+
+	ComPtr<ID3D11Resource> oldTexture;
+	if (anOldResource)
 	{
-		Texture* texture = it->get();
-		return texture;
+		anOldResource->GetResource(oldTexture.GetAddressOf());
+	}
+
+	// New mips come from the data, mips both textures have are copied on the GPU.
+	const uint8_t* data = someData;
+	for (uint32_t mip = aTopMip; mip < layout.GetMipCount(); mip++)
+	{
+		if (mip >= aDataFirstMip && mip < aDataEndMip)
+		{
+			DX11::Context->UpdateSubresource(texture.Get(), mip - aTopMip, nullptr, data, layout.myMips[mip].myRowPitch, 0);
+			data += layout.myMips[mip].mySize;
+		}
+		else if (oldTexture && mip >= anOldTopMip)
+		{
+			DX11::Context->CopySubresourceRegion(texture.Get(), mip - aTopMip, 0, 0, 0, oldTexture.Get(), mip - anOldTopMip, nullptr);
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void TextureManager::SetFailed(Texture& aTexture)
+{
+	SetResident(aTexture, myFailedResource.Get());
+	aTexture.myIsFailedTexture = true;
+	aTexture.mySize = Vector2f(0.3f, 0.3f);
+	aTexture.myImageSize = Vector2f(512, 512);
+}
+
+Texture* TextureManager::LoadTexture(const wchar_t* aTexturePath, uint64_t aHashedID, bool aForceSRGB, bool aForceReload)
+{
+	auto it = myTextures.find(aHashedID);
+	Texture* loadedTexture = it != myTextures.end() ? it->second.get() : nullptr;
+	if (!aForceReload && loadedTexture && !loadedTexture->myIsReleased)
+	{
+		return loadedTexture;
+	}
+	// Loading it here makes a streaming load of the same texture pointless. Mip streamed textures are loaded whole.
+	CancelStreaming(aHashedID);
+	if (loadedTexture)
+	{
+		StopMipStreaming(*loadedTexture);
 	}
 
 	ComPtr<ID3D11ShaderResourceView> resource;
 	const std::wstring asset_path = Settings::ResolveAssetPathW(aTexturePath);
 
-	HRESULT hr = DirectX::CreateDDSTextureFromFileEx(DX11::Device, nullptr,
-		asset_path.c_str(), 0,
-		D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0,
-		aForceSRGB,
-		nullptr, resource.ReleaseAndGetAddressOf(), nullptr);
+	// Read once, from disk or a pack, and handed to every loader that gets to try it.
+	FileView file;
+	HRESULT hr = HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+	if (Settings::GetFileSystem().Open(asset_path, file))
+	{
+		hr = DirectX::CreateDDSTextureFromMemoryEx(DX11::Device,
+			file.GetData(), file.GetSize(), 0,
+			D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0,
+			aForceSRGB,
+			nullptr, resource.ReleaseAndGetAddressOf(), nullptr);
+	}
 
 	if (FAILED(hr))
 	{
@@ -119,37 +643,34 @@ Texture* TextureManager::GetTexture(const wchar_t* aTexturePath, bool aForceSRGB
 		}
 		else if (DX11::IsOnSameThreadAsEngine())
 		{
-			hr = DirectX::CreateWICTextureFromFileEx(
-				DX11::Device, 
-				DX11::Context, 
-				asset_path.c_str(),
-				16384,
-				D3D11_USAGE_DEFAULT,
-				D3D11_BIND_SHADER_RESOURCE,
-				0,
-				0,
-				aForceSRGB ? DirectX::WIC_LOADER_FORCE_SRGB : DirectX::WIC_LOADER_DEFAULT,
-				nullptr, 
-				resource.ReleaseAndGetAddressOf());
+			if (file.IsOpen())
+			{
+				hr = DirectX::CreateWICTextureFromMemoryEx(
+					DX11::Device, 
+					DX11::Context, 
+					file.GetData(),
+					file.GetSize(),
+					16384,
+					D3D11_USAGE_DEFAULT,
+					D3D11_BIND_SHADER_RESOURCE,
+					0,
+					0,
+					aForceSRGB ? DirectX::WIC_LOADER_FORCE_SRGB : DirectX::WIC_LOADER_DEFAULT,
+					nullptr, 
+					resource.ReleaseAndGetAddressOf());
+			}
 
 			if (FAILED(hr))
 			{
 				if (IsTarga(asset_path))
 				{
-					Tga32 targa;
-					Tga32::Image* image = targa.Load(asset_path.c_str());
-					if(image)
+					if (CreateTargaResource(file, aForceSRGB, resource))
 					{
-						loadedTexture = CreateTextureFromTarga(image);
-						if (loadedTexture)
-						{
-							resource = loadedTexture->GetShaderResourceView();
-							hr = S_OK;
-						}
+						hr = S_OK;
 					}
 					else
 					{
-						ERROR_PRINT("%s %s", "This targa image is not supported, please use 32bit non compressed ", asset_path.c_str());
+						ERROR_PRINT("%s %s", "This targa image is broken or not supported ", asset_path.c_str());
 					}
 				}
 				else
@@ -211,18 +732,14 @@ Texture* TextureManager::GetTexture(const wchar_t* aTexturePath, bool aForceSRGB
 			newTexture = new Texture();
 		}
 		newTexture->myPath = asset_path;
-		newTexture->SetShaderResourceView(resource.Get());
-		newTexture->myID = hashedID;
+		newTexture->myID = aHashedID;
+		newTexture->myIsSRGB = aForceSRGB;
+		SetFailed(*newTexture);
 		SetDebugObjectName(newTexture->GetShaderResourceView(), asset_path);
-		newTexture->myIsFailedTexture = true;
-
-		Vector2f texSize = GetTextureSize(resource.Get());
-		newTexture->mySize = Vector2f(0.3f, 0.3f);
-		newTexture->myImageSize = Vector2f(512, 512);
 
 		if (!loadedTexture)
 		{
-			myResourceViews.push_back(std::unique_ptr<Texture>(newTexture));
+			myTextures.emplace(aHashedID, std::unique_ptr<Texture>(newTexture));
 		}
 		return newTexture;
 	}
@@ -235,8 +752,10 @@ Texture* TextureManager::GetTexture(const wchar_t* aTexturePath, bool aForceSRGB
 			newTexture = new Texture();
 		}
 		newTexture->myPath = asset_path;
-		newTexture->myID = hashedID;
-		newTexture->SetShaderResourceView(resource.Get());
+		newTexture->myID = aHashedID;
+		newTexture->myIsSRGB = aForceSRGB;
+		newTexture->myIsFailedTexture = false;
+		SetResident(*newTexture, resource.Get());
 		SetDebugObjectName(newTexture->GetShaderResourceView(), asset_path);
 
 		Vector2f texSize = GetTextureSize(resource.Get());
@@ -246,7 +765,7 @@ Texture* TextureManager::GetTexture(const wchar_t* aTexturePath, bool aForceSRGB
 
 		if (!loadedTexture)
 		{
-			myResourceViews.push_back(std::unique_ptr<Texture>(newTexture));
+			myTextures.emplace(aHashedID, std::unique_ptr<Texture>(newTexture));
 		}
 
 		return newTexture;
@@ -262,27 +781,36 @@ Texture* TextureManager::TryGetTexture(const wchar_t* aTexturePath, bool aForceS
 		return nullptr;
 	}
 
-	std::wstring toString = std::wstring(aTexturePath);
-	const uint64_t hashedID = xxh64::hash((char*)toString.c_str(), sizeof(wchar_t) * toString.length(), 0);
-	auto it = std::find_if(myResourceViews.begin(), myResourceViews.end(), [hashedID](const std::unique_ptr<Texture>& s) { return s->myID == hashedID; });
-
-	Texture* loadedTexture = nullptr;
-	if (it != myResourceViews.end())
+	Texture* texture = TryLoadTexture(aTexturePath, HashPath(aTexturePath), aForceSRGB);
+	if (texture)
 	{
-		loadedTexture = it->get();
+		texture->myIsPinned = true;
+		texture->myLastUsedFrame = myFrame;
 	}
-	if (loadedTexture)
+	return texture;
+}
+
+Texture* TextureManager::TryLoadTexture(const wchar_t* aTexturePath, uint64_t aHashedID, bool aForceSRGB)
+{
+	auto it = myTextures.find(aHashedID);
+	Texture* loadedTexture = it != myTextures.end() ? it->second.get() : nullptr;
+	if (loadedTexture && !loadedTexture->myIsReleased)
 	{
-		Texture* texture = it->get();
-		return texture;
+		return loadedTexture;
 	}
+	CancelStreaming(aHashedID);
 
 	ComPtr<ID3D11ShaderResourceView> resource;
-	HRESULT hr = DirectX::CreateDDSTextureFromFileEx(DX11::Device, nullptr,
-		aTexturePath, 0,
-		D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0,
-		aForceSRGB,
-		nullptr, resource.ReleaseAndGetAddressOf(), nullptr);
+	FileView file;
+	HRESULT hr = HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+	if (Settings::GetFileSystem().Open(aTexturePath, file))
+	{
+		hr = DirectX::CreateDDSTextureFromMemoryEx(DX11::Device,
+			file.GetData(), file.GetSize(), 0,
+			D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0,
+			aForceSRGB,
+			nullptr, resource.ReleaseAndGetAddressOf(), nullptr);
+	}
 
 	if (FAILED(hr))
 	{
@@ -293,26 +821,22 @@ Texture* TextureManager::TryGetTexture(const wchar_t* aTexturePath, bool aForceS
 		}
 		else if (DX11::IsOnSameThreadAsEngine())
 		{
-			hr = DirectX::CreateWICTextureFromFile(DX11::Device, DX11::Context, aTexturePath, nullptr,
-				resource.ReleaseAndGetAddressOf());
+			if (file.IsOpen())
+			{
+				hr = DirectX::CreateWICTextureFromMemory(DX11::Device, DX11::Context, file.GetData(), file.GetSize(), nullptr,
+					resource.ReleaseAndGetAddressOf());
+			}
 			if (FAILED(hr))
 			{
 				if (IsTarga(aTexturePath))
 				{
-					Tga32 targa;
-					Tga32::Image* image = targa.Load(aTexturePath);
-					if (image)
+					if (CreateTargaResource(file, aForceSRGB, resource))
 					{
-						loadedTexture = CreateTextureFromTarga(image);
-						if (loadedTexture)
-						{
-							resource = loadedTexture->GetShaderResourceView();
-							hr = S_OK;
-						}
+						hr = S_OK;
 					}
 					else
 					{
-						ERROR_PRINT("%s %s", "This targa image is not supported, please use 32bit non compressed ", aTexturePath);
+						ERROR_PRINT("%s %s", "This targa image is broken or not supported ", aTexturePath);
 					}
 				}
 				else
@@ -367,8 +891,9 @@ Texture* TextureManager::TryGetTexture(const wchar_t* aTexturePath, bool aForceS
 			newTexture = new Texture();
 		}
 		newTexture->myPath = aTexturePath;
-		newTexture->myID = hashedID;
-		newTexture->SetShaderResourceView(resource.Get());
+		newTexture->myID = aHashedID;
+		newTexture->myIsSRGB = aForceSRGB;
+		SetResident(*newTexture, resource.Get());
 		SetDebugObjectName(newTexture->GetShaderResourceView(), aTexturePath);
 
 		Vector2f texSize = GetTextureSize(resource.Get());
@@ -378,7 +903,7 @@ Texture* TextureManager::TryGetTexture(const wchar_t* aTexturePath, bool aForceS
 
 		if (!loadedTexture)
 		{
-			myResourceViews.push_back(std::unique_ptr<Texture>(newTexture));
+			myTextures.emplace(aHashedID, std::unique_ptr<Texture>(newTexture));
 		}
 
 		return newTexture;
@@ -389,19 +914,201 @@ Texture* TextureManager::TryGetTexture(const wchar_t* aTexturePath, bool aForceS
 
 void TextureManager::OnTextureChanged(std::wstring aFile)
 {
-	std::wstring notWide = aFile;
-	std::replace(notWide.begin(), notWide.end(), '\\', '/');
-	for (int i=0; i< myResourceViews.size(); i++)
+	std::wstring changedPath = aFile;
+	std::replace(changedPath.begin(), changedPath.end(), '\\', '/');
+	for (auto& [id, texture] : myTextures)
+	{
+		std::wstring path = texture->myPath;
+		std::replace(path.begin(), path.end(), '\\', '/');
+		if (path != changedPath)
+		{
+			continue;
+		}
+
+		INFO_PRINT("%s%s", "Texture changed: ", changedPath.c_str());
+		// Evicted textures pick up the change the next time they are loaded.
+		if (!texture->myIsReleased)
+		{
+			// Reloads in place so everything holding the Texture sees the new image.
+			LoadTexture(texture->myPath.c_str(), id, texture->myIsSRGB, true);
+		}
+		break;
+	}
+}
+
+size_t TextureManager::CalculateMemorySize(ID3D11ShaderResourceView* aResourceView)
+{
+	if (!aResourceView)
+	{
+		return 0;
+	}
+
+	ComPtr<ID3D11Resource> resource;
+	aResourceView->GetResource(resource.GetAddressOf());
+	ComPtr<ID3D11Texture2D> texture;
+	if (!resource || FAILED(resource.As(&texture)))
+	{
+		return 0;
+	}
+
+	D3D11_TEXTURE2D_DESC desc;
+	texture->GetDesc(&desc);
+
+	// Block compressed formats store 4x4 pixel blocks, everything else is counted per pixel.
+	size_t bytesPerBlock = 0;
+	size_t bitsPerPixel = 32;
+	switch (desc.Format)
+	{
+	case DXGI_FORMAT_BC1_TYPELESS: case DXGI_FORMAT_BC1_UNORM: case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_TYPELESS: case DXGI_FORMAT_BC4_UNORM: case DXGI_FORMAT_BC4_SNORM:
+		bytesPerBlock = 8;
+		break;
+	case DXGI_FORMAT_BC2_TYPELESS: case DXGI_FORMAT_BC2_UNORM: case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_TYPELESS: case DXGI_FORMAT_BC3_UNORM: case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_TYPELESS: case DXGI_FORMAT_BC5_UNORM: case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_TYPELESS: case DXGI_FORMAT_BC6H_UF16: case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_TYPELESS: case DXGI_FORMAT_BC7_UNORM: case DXGI_FORMAT_BC7_UNORM_SRGB:
+		bytesPerBlock = 16;
+		break;
+	case DXGI_FORMAT_R32G32B32A32_FLOAT: case DXGI_FORMAT_R32G32B32A32_UINT: case DXGI_FORMAT_R32G32B32A32_SINT:
+		bitsPerPixel = 128;
+		break;
+	case DXGI_FORMAT_R16G16B16A16_FLOAT: case DXGI_FORMAT_R16G16B16A16_UNORM: case DXGI_FORMAT_R16G16B16A16_SNORM:
+	case DXGI_FORMAT_R32G32_FLOAT:
+		bitsPerPixel = 64;
+		break;
+	case DXGI_FORMAT_R8G8_UNORM: case DXGI_FORMAT_R16_FLOAT: case DXGI_FORMAT_R16_UNORM:
+	case DXGI_FORMAT_B5G6R5_UNORM: case DXGI_FORMAT_B5G5R5A1_UNORM:
+		bitsPerPixel = 16;
+		break;
+	case DXGI_FORMAT_R8_UNORM: case DXGI_FORMAT_A8_UNORM:
+		bitsPerPixel = 8;
+		break;
+	default:
+		break;
+	}
+
+	size_t size = 0;
+	for (UINT mip = 0; mip < desc.MipLevels; mip++)
+	{
+		const size_t width = std::max<size_t>(1, desc.Width >> mip);
+		const size_t height = std::max<size_t>(1, desc.Height >> mip);
+		if (bytesPerBlock > 0)
+		{
+			size += ((width + 3) / 4) * ((height + 3) / 4) * bytesPerBlock;
+		}
+		else
+		{
+			size += width * height * bitsPerPixel / 8;
+		}
+	}
+	return size * desc.ArraySize;
+}
+
+void TextureManager::SetResident(Texture& aTexture, ID3D11ShaderResourceView* aResourceView)
+{
+	// The error texture is shared, it doesn't count towards any texture's memory.
+	const size_t memorySize = aResourceView == myFailedResource.Get() ? 0 : CalculateMemorySize(aResourceView);
+
+	if (aTexture.myMemorySize > 0)
+	{
+		myStatistics.ResidentBytes -= aTexture.myMemorySize;
+		myStatistics.ResidentCount--;
+	}
+	if (memorySize > 0)
+	{
+		myStatistics.ResidentBytes += memorySize;
+		myStatistics.ResidentCount++;
+	}
+
+	aTexture.SetShaderResourceView(aResourceView);
+	aTexture.myMemorySize = memorySize;
+	aTexture.myIsReleased = false;
+	aTexture.myLastUsedFrame = myFrame;
+}
+
+void TextureManager::Evict(Texture& aTexture)
+{
+	if (aTexture.myIsReleased)
+	{
+		return;
+	}
+	StopMipStreaming(aTexture);
+
+	if (aTexture.myMemorySize > 0)
+	{
+		myStatistics.ResidentBytes -= aTexture.myMemorySize;
+		myStatistics.ResidentCount--;
+		myStatistics.EvictedCount++;
+	}
+
+	// Dropping the view frees the GPU memory. The Texture itself stays so pointers to it remain valid, it shows the
+	// error texture until it is loaded again.
+	aTexture.SetShaderResourceView(myFailedResource.Get());
+	aTexture.myMemorySize = 0;
+	aTexture.myIsReleased = true;
+}
+
+void TextureManager::EvictOverBudget()
+{
+	if (myStatistics.ResidentBytes <= myStatistics.BudgetBytes)
+	{
+		return;
+	}
+
+	std::vector<Texture*> candidates;
+	for (auto& [id, texture] : myTextures)
+	{
+		if (!texture->myIsPinned && texture->myReferenceCount == 0 && texture->myMemorySize > 0)
+		{
+			candidates.push_back(texture.get());
+		}
+	}
+	std::sort(candidates.begin(), candidates.end(), [](const Texture* aFirst, const Texture* aSecond)
 	{
-		if (myResourceViews[i]->myPath.compare(notWide) != std::wstring::npos)
+		return aFirst->myLastUsedFrame < aSecond->myLastUsedFrame;
+	});
+
+	for (Texture* texture : candidates)
+	{
+		if (myStatistics.ResidentBytes <= myStatistics.BudgetBytes)
 		{
-			INFO_PRINT("%s%s", "Texture changed: ", notWide.c_str());
-			GetTexture(notWide.c_str(), true);
 			break;
 		}
+		Evict(*texture);
 	}
 }
 
+void TextureManager::AddReference(Texture* aTexture)
+{
+	aTexture->myReferenceCount++;
+	aTexture->myLastUsedFrame = myFrame;
+}
+
+void TextureManager::RemoveReference(Texture* aTexture)
+{
+	assert(aTexture->myReferenceCount > 0);
+	aTexture->myReferenceCount--;
+	aTexture->myLastUsedFrame = myFrame;
+
+	if (aTexture->myReferenceCount == 0 && !aTexture->myIsPinned)
+	{
+		CancelStreaming(aTexture->myID);
+	}
+
+	// Unreferenced textures are kept as a cache while there is room for them.
+	if (aTexture->myReferenceCount == 0 && !aTexture->myIsPinned && myStatistics.ResidentBytes > myStatistics.BudgetBytes)
+	{
+		Evict(*aTexture);
+	}
+}
+
+void TextureManager::SetMemoryBudget(size_t aBudgetInBytes)
+{
+	myStatistics.BudgetBytes = aBudgetInBytes;
+	EvictOverBudget();
+}
+
 DXGI_FORMAT TextureManager::GetTextureFormat(ID3D11ShaderResourceView* aResourceView) const
 {
 	ID3D11Resource* resource = nullptr;
@@ -445,73 +1152,74 @@ Vector2f TextureManager::GetTextureSize( ID3D11ShaderResourceView* aResourceView
 
 Texture* TextureManager::CreateTextureFromTarga(Tga32::Image* aImage)
 {
-	if (!aImage)
+	if (!aImage || !aImage->myImage)
 	{
 		return nullptr;
 	}
-	ID3D11Texture2D* texture = nullptr;
-	Texture *tex = nullptr;
-	ID3D11ShaderResourceView* resource = nullptr;
 
-	D3D11_TEXTURE2D_DESC tdesc;
+	// Tga32 images are already RGBA8 top row first, so they are uploaded as they are.
 	D3D11_SUBRESOURCE_DATA tbsd;
+	tbsd.pSysMem = aImage->myImage;
+	tbsd.SysMemPitch = aImage->myWidth * 4;
+	tbsd.SysMemSlicePitch = aImage->myWidth * aImage->myHeight * 4;
 
-	int h = aImage->myHeight;
-	int w = aImage->myWidth;
-	int *buf = new int[h*w];
-	for (int i = 0; i < (h*w) * 4; i+=4)
-	{
-		unsigned char b = static_cast<unsigned char>(aImage->myImage[i]);
-		unsigned char g = static_cast<unsigned char>(aImage->myImage[i+1]);
-		unsigned char r = static_cast<unsigned char>(aImage->myImage[i+2]);
-		unsigned char a = static_cast<unsigned char>(aImage->myImage[i+3]);
-
-		unsigned int final = 0;
-		final |= (a << 24);
-		final |= (r << 16);
-		final |= (g << 8);
-		final |= (b);
-
-		buf[i/4] = final;
-	}
-
-	tbsd.pSysMem = (void *)buf;
-	tbsd.SysMemPitch = w * 4;
-	tbsd.SysMemSlicePitch = w * h * 4;
-
-	tdesc.Width = w;
-	tdesc.Height = h;
+	D3D11_TEXTURE2D_DESC tdesc = {};
+	tdesc.Width = aImage->myWidth;
+	tdesc.Height = aImage->myHeight;
 	tdesc.MipLevels = 1;
 	tdesc.ArraySize = 1;
-
 	tdesc.SampleDesc.Count = 1;
-	tdesc.SampleDesc.Quality = 0;
-	tdesc.Usage = D3D11_USAGE_DYNAMIC;
+	tdesc.Usage = D3D11_USAGE_IMMUTABLE;
 	tdesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
 	tdesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-	tdesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	tdesc.MiscFlags = 0;
 
-	if (FAILED(DX11::Device->CreateTexture2D(&tdesc, &tbsd, &texture)))
+	ComPtr<ID3D11Texture2D> texture;
+	ComPtr<ID3D11ShaderResourceView> resource;
+	if (FAILED(DX11::Device->CreateTexture2D(&tdesc, &tbsd, texture.GetAddressOf()))
+		|| FAILED(DX11::Device->CreateShaderResourceView(texture.Get(), nullptr, resource.GetAddressOf())))
+	{
 		return nullptr;
+	}
 
-	delete[] buf;
+	Texture* tex = new Texture();
+	tex->myImageSize.Set(aImage->myWidth, aImage->myHeight);
+	tex->myPath = L"Lol";
+	tex->SetShaderResourceView(resource.Get());
+	return tex;
+}
 
-	HRESULT hr = DX11::Device->CreateShaderResourceView(texture, NULL, &resource);
-	if (FAILED(hr))
+bool TextureManager::CreateTargaResource(const FileView& aFile, bool aForceSRGB, ComPtr<ID3D11ShaderResourceView>& outResource)
+{
+	Tga32::TgaHeader header;
+	if (!aFile.IsOpen() || !Tga32::ReadHeader(aFile.GetData(), aFile.GetSize(), header))
 	{
-		return nullptr;
+		return false;
 	}
 
-	if(resource)
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = header.myWidth;
+	desc.Height = header.myHeight;
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.Format = aForceSRGB ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	ComPtr<ID3D11Texture2D> texture;
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(DX11::Device->CreateTexture2D(&desc, nullptr, texture.GetAddressOf()))
+		|| FAILED(DX11::Context->Map(texture.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
 	{
-		tex = new Texture();
-		tex->myImageSize.Set(aImage->myWidth, aImage->myHeight);
-		tex->myPath = L"Lol";
-		tex->SetShaderResourceView(resource);
+		return false;
 	}
 
-	return tex;
+	// Decodes from the mapped file straight into the mapped texture, the pixels are written once and never copied.
+	const bool isDecoded = Tga32::Decode(aFile.GetData(), aFile.GetSize(), static_cast<unsigned char*>(mapped.pData), mapped.RowPitch);
+	DX11::Context->Unmap(texture.Get(), 0);
+
+	return isDecoded && SUCCEEDED(DX11::Device->CreateShaderResourceView(texture.Get(), nullptr, outResource.ReleaseAndGetAddressOf()));
 }
 
 void TextureManager::CreateErrorSquareTexture()
@@ -688,9 +1396,86 @@ void Tga::TextureManager::Init()
 
 void Tga::TextureManager::ReleaseTexture(Texture* aTexture)
 {
-	aTexture->SetShaderResourceView(myFailedResource.Get());
+	aTexture->myIsPinned = false;
+	if (aTexture->myReferenceCount == 0)
+	{
+		CancelStreaming(aTexture->myID);
+		Evict(*aTexture);
+	}
 }
 
 void Tga::TextureManager::Update()
 {
+	myFrame++;
+	UploadStreamedTextures();
+	UpdateMipStreaming();
+	EvictOverBudget();
+}
+
+TextureHandle::TextureHandle(TextureManager* aManager, Texture* aTexture)
+	: myManager(aManager)
+	, myTexture(aTexture)
+{
+	myManager->AddReference(myTexture);
+}
+
+TextureHandle::TextureHandle(const TextureHandle& anOther)
+	: myManager(anOther.myManager)
+	, myTexture(anOther.myTexture)
+{
+	if (myTexture)
+	{
+		myManager->AddReference(myTexture);
+	}
+}
+
+TextureHandle::TextureHandle(TextureHandle&& anOther) noexcept
+	: myManager(anOther.myManager)
+	, myTexture(anOther.myTexture)
+{
+	anOther.myManager = nullptr;
+	anOther.myTexture = nullptr;
+}
+
+TextureHandle::~TextureHandle()
+{
+	Reset();
+}
+
+TextureHandle& TextureHandle::operator=(const TextureHandle& anOther)
+{
+	if (this != &anOther)
+	{
+		if (anOther.myTexture)
+		{
+			anOther.myManager->AddReference(anOther.myTexture);
+		}
+		Reset();
+		myManager = anOther.myManager;
+		myTexture = anOther.myTexture;
+	}
+	return *this;
+}
+
+TextureHandle& TextureHandle::operator=(TextureHandle&& anOther) noexcept
+{
+	if (this != &anOther)
+	{
+		Reset();
+		myManager = anOther.myManager;
+		myTexture = anOther.myTexture;
+		anOther.myManager = nullptr;
+		anOther.myTexture = nullptr;
+	}
+	return *this;
+}
+
+void TextureHandle::Reset()
+{
+	if (myTexture)
+	{
+		myManager->RemoveReference(myTexture);
+	}
+	myManager = nullptr;
+	myTexture = nullptr;
 }
@@ -4,7 +4,12 @@ This class handles all the textures created, please use this when you create a t
 
 #pragma once
 #include "Texture.h"
+#include <tge/texture/TextureHandle.h>
+#include <tge/texture/TextureStreamer.h>
+#include <tge/texture/DDSLayout.h>
+#include <atomic>
 #include <dxgiformat.h>
+#include <unordered_map>
 #include <vector>
 #include <tge/loaders/tgaloader.h>
 
@@ -13,29 +18,154 @@ struct ID3D11Texture2D;
 namespace Tga
 {
 	class GraphicsEngine;
+	class TextureManager;
+
+	struct TextureMemoryStatistics
+	{
+		// Estimated GPU memory of all loaded textures, mips included.
+		size_t ResidentBytes = 0;
+		size_t BudgetBytes = 512ull * 1024 * 1024;
+		// Textures that currently have GPU memory of their own.
+		size_t ResidentCount = 0;
+		// Textures freed since start, by ReleaseTexture or to stay within the budget.
+		size_t EvictedCount = 0;
+		// Requested textures that aren't uploaded yet, and how much the last frame uploaded.
+		size_t StreamingCount = 0;
+		size_t StreamedBytesLastFrame = 0;
+	};
+
 	class TextureManager
 	{
 	public:
 		TextureManager(void);
 		~TextureManager(void);
 		void Init();
+		/**
+		 * Loads the texture the first time it is asked for, after that it is a hash map lookup.
+		 * Textures returned here are pinned: they are never evicted until ReleaseTexture is called. Use AcquireTexture
+		 * for textures that may be freed when nothing uses them anymore.
+		 */
 		Texture* GetTexture(const wchar_t* aTexturePath, bool aForceSRGB = true, bool aForceReload = false);
 		Texture* TryGetTexture(const wchar_t* aTexturePath, bool aForceSRGB = true);
 
+		/**
+		 * Returns a reference counted handle to the texture, loading it if it isn't resident. When the last handle is
+		 * dropped the texture stays cached until the memory budget needs the space, then its GPU memory is freed and
+		 * the next AcquireTexture loads it again.
+		 */
+		TextureHandle AcquireTexture(const wchar_t* aTexturePath, bool aForceSRGB = true);
+		/**
+		 * Same as AcquireTexture but returns an empty handle instead of the error texture when the file doesn't exist.
+		 */
+		TextureHandle TryAcquireTexture(const wchar_t* aTexturePath, bool aForceSRGB = true);
+
+		/**
+		 * Same as AcquireTexture but loads on the I/O threads and returns right away. The texture shows the white
+		 * square until it is uploaded at the start of a later frame, or the error texture if it fails to load.
+		 * Dropping the last handle before then cancels the load.
+		 * Power of two .dds files are mip streamed: only mips up to 64x64 are loaded at first, finer mips are streamed
+		 * in and out by how large the texture is drawn, within the memory budget. Sprites and models report that size
+		 * when they are drawn.
+		 * @param aPriority Higher priorities are decoded and uploaded first. Requesting a texture that is already
+		 * streaming raises its priority if the new one is higher.
+		 * @param aMaxSize Largest width or height to load, 0 loads the full texture.
+		 */
+		TextureHandle RequestTexture(const wchar_t* aTexturePath, bool aForceSRGB = true, int aPriority = 0, uint32_t aMaxSize = 0);
+
+		/**
+		 * Stops streaming the texture if it isn't uploaded yet, it keeps showing the white square.
+		 */
+		void CancelTextureRequest(const Texture* aTexture);
+		bool IsStreaming(const Texture* aTexture) const;
+
+		/**
+		 * Bytes streamed textures may upload per frame. At least one texture is uploaded every frame, however large.
+		 */
+		void SetStreamingUploadBudget(size_t aBytesPerFrame) { myStreamingUploadBudget = aBytesPerFrame; }
+
 		Texture* GetWhiteSquareTexture() { return myWhiteSquareTexture.get(); }
 		static Vector2f GetTextureSize(struct ID3D11ShaderResourceView* aResourceView, bool aNormalize = true);
 
 		Texture * CreateTextureFromTarga(Tga32::Image * aImage);
 
+		/**
+		 * Unpins a texture from GetTexture. If no handle references it, its GPU memory is freed right away and it
+		 * shows the error texture until it is loaded again.
+		 */
 		void ReleaseTexture(Texture* aTexture);
 
+		/**
+		 * Uploads streamed textures that finished decoding, picks the mips of mip streamed textures, then evicts the least recently used unreferenced textures
+		 * while resident memory is over the budget. Called by the engine once per frame.
+		 */
 		void Update();
 
+		void SetMemoryBudget(size_t aBudgetInBytes);
+		size_t GetMemoryBudget() const { return myStatistics.BudgetBytes; }
+		const TextureMemoryStatistics& GetStatistics() const { return myStatistics; }
+
 		/* Requires DX11 includes */
 		ID3D11ShaderResourceView* GetDefaultNormalMapResource() const { return myDefaultNormalMapResource.Get(); }
 	private:
+		friend class TextureHandle;
+
+		Texture* LoadTexture(const wchar_t* aTexturePath, uint64_t aHashedID, bool aForceSRGB, bool aForceReload);
+		Texture* TryLoadTexture(const wchar_t* aTexturePath, uint64_t aHashedID, bool aForceSRGB);
+		static uint64_t HashPath(const wchar_t* aTexturePath);
+		static size_t CalculateMemorySize(ID3D11ShaderResourceView* aResourceView);
+		void SetResident(Texture& aTexture, ID3D11ShaderResourceView* aResourceView);
+		void Evict(Texture& aTexture);
+		void EvictOverBudget();
+		void AddReference(Texture* aTexture);
+		void RemoveReference(Texture* aTexture);
+		void CancelStreaming(uint64_t aHashedID);
+		void UploadStreamedTextures();
+		void FinishStreaming(const TextureStreamer::Request& aRequest);
+		bool CreateStreamedResource(const TextureStreamer::Request& aRequest, ComPtr<ID3D11ShaderResourceView>& outResource);
+		void SetFailed(Texture& aTexture);
+		bool CreateTargaResource(const FileView& aFile, bool aForceSRGB, ComPtr<ID3D11ShaderResourceView>& outResource);
+
+		struct MipStreamingState
+		{
+			DDSLayout myLayout;
+			DXGI_FORMAT myFormat = DXGI_FORMAT_UNKNOWN;
+			int myPriority = 0;
+			// Mips before myFinestMip are never loaded, myTailMip and the ones after it always are.
+			uint32_t myFinestMip = 0;
+			uint32_t myTailMip = 0;
+			// Top mip of the texture on the GPU.
+			uint32_t myResidentMip = 0;
+			// Written by TextureResource::ReportScreenSize while drawing, taken once per frame.
+			std::atomic<uint32_t> myScreenSizeFeedback = 0;
+			// Largest size reported this window, and the size the mips are picked for.
+			uint32_t myWindowScreenSize = 0;
+			uint32_t myScreenSize = 0;
+			// Finer mips being read, at most one request at a time.
+			std::shared_ptr<TextureStreamer::Request> myPendingRequest;
+		};
+
+		bool StartMipStreaming(Texture& aTexture, const TextureStreamer::Request& aRequest);
+		void StopMipStreaming(Texture& aTexture);
+		void UpdateMipStreaming();
+		void FinishMipUpdate(const TextureStreamer::Request& aRequest);
+		bool ChangeResidentMip(Texture& aTexture, MipStreamingState& aState, uint32_t aTopMip, const uint8_t* someData, uint32_t aDataEndMip);
+		bool CreateMipRange(const MipStreamingState& aState, uint32_t aTopMip, const uint8_t* someData, uint32_t aDataFirstMip, uint32_t aDataEndMip,
+			ID3D11ShaderResourceView* anOldResource, uint32_t anOldTopMip, ComPtr<ID3D11ShaderResourceView>& outResource);
+
 		DXGI_FORMAT GetTextureFormat(struct ID3D11ShaderResourceView* aResourceView) const;
-		std::vector<std::unique_ptr<Texture>> myResourceViews;
+		// Keyed on the xxh64 hash of the path the texture was asked for.
+		std::unordered_map<uint64_t, std::unique_ptr<Texture>> myTextures;
+		TextureMemoryStatistics myStatistics;
+		uint64_t myFrame = 0;
+
+		TextureStreamer myStreamer;
+		// Requests that are decoding or waiting for their upload, keyed like myTextures.
+		std::unordered_map<uint64_t, std::shared_ptr<TextureStreamer::Request>> myStreamingRequests;
+		// Decoded requests that didn't fit in an earlier frame's upload budget.
+		std::vector<std::shared_ptr<TextureStreamer::Request>> myDecodedRequests;
+		size_t myStreamingUploadBudget = 16 * 1024 * 1024;
+		// Keyed like myTextures. Nodes don't move, so textures can point at the feedback in them.
+		std::unordered_map<uint64_t, MipStreamingState> myMipStreaming;
 		void CreateErrorSquareTexture();
 		ComPtr<ID3D11ShaderResourceView> CreateWhiteSquareTexture();
 		void CreateDefaultNormalmapTexture();
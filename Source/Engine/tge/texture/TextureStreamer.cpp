@@ -0,0 +1,342 @@
+#include "stdafx.h"
+
+#include <tge/texture/TextureStreamer.h>
+#include <tge/texture/MipStreamingPolicy.h>
+#include <tge/EngineDefines.h>
+#include <tge/loaders/tgaloader.h>
+#include <tge/filesystem/VirtualFileSystem.h>
+#include <tge/settings/settings.h>
+#include <wincodec.h>
+#include <wrl/client.h>
+
+using namespace Tga;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	bool HasExtension(const std::wstring& aPath, const wchar_t* anExtension)
+	{
+		const size_t dot = aPath.find_last_of(L'.');
+		return dot != std::wstring::npos && _wcsicmp(aPath.c_str() + dot + 1, anExtension) == 0;
+	}
+
+	// Reads a byte of every page, so the data comes off the disk here on the I/O thread and not when the main thread
+	// uploads it.
+	void TouchPages(const uint8_t* someData, size_t aSize)
+	{
+		constexpr size_t pageSize = 4096;
+		const volatile uint8_t* data = someData;
+		for (size_t i = 0; i < aSize; i += pageSize)
+		{
+			static_cast<void>(data[i]);
+		}
+	}
+
+	bool DecodeDDS(TextureStreamer::Request& aRequest)
+	{
+		if (!Settings::GetFileSystem().Open(aRequest.myPath, aRequest.myFile))
+		{
+			return false;
+		}
+		const uint8_t* data = aRequest.myFile.GetData();
+		const size_t size = aRequest.myFile.GetSize();
+
+		// "DDS " followed by the 124 byte DDS_HEADER. Everything else is parsed by the DDS loader when it is uploaded.
+		constexpr size_t headerSize = 4 + 124;
+		if (size < headerSize || memcmp(data, "DDS ", 4) != 0)
+		{
+			return false;
+		}
+
+		uint32_t height, width, mipCount;
+		memcpy(&height, data + 12, sizeof(height));
+		memcpy(&width, data + 16, sizeof(width));
+		memcpy(&mipCount, data + 28, sizeof(mipCount));
+
+		// The DDS loader skips mips larger than myMaxSize, each skipped mip leaves a quarter of the data to upload.
+		size_t uploadSize = size - headerSize;
+		uint32_t skippedMips = 0;
+		while (aRequest.myMaxSize > 0 && (std::max(width, height) >> skippedMips) > aRequest.myMaxSize && skippedMips + 1 < mipCount)
+		{
+			skippedMips++;
+			uploadSize /= 4;
+		}
+
+		TouchPages(data, size);
+
+		aRequest.myDataType = TextureStreamer::DataType::DDS;
+		aRequest.myFileDataOffset = 0;
+		aRequest.myFileDataSize = size;
+		aRequest.myWidth = std::max(1u, width >> skippedMips);
+		aRequest.myHeight = std::max(1u, height >> skippedMips);
+		aRequest.myUploadSize = uploadSize;
+		return true;
+	}
+
+	bool IsPowerOfTwo(uint32_t aValue)
+	{
+		return aValue != 0 && (aValue & (aValue - 1)) == 0;
+	}
+
+	// Uses only the mips the request needs, at the offsets the header gives for them.
+	bool DecodeDDSMips(TextureStreamer::Request& aRequest)
+	{
+		if (!Settings::GetFileSystem().Open(aRequest.myPath, aRequest.myFile))
+		{
+			return false;
+		}
+		const uint8_t* data = aRequest.myFile.GetData();
+		const size_t fileSize = aRequest.myFile.GetSize();
+
+		if (!aRequest.myIsMipUpdate)
+		{
+			if (!DDSLayout::Parse(data, std::min<size_t>(DDSLayout::MaxHeaderSize, fileSize), fileSize, aRequest.myLayout))
+			{
+				return false;
+			}
+
+			// Every mip has to be exactly half of the one above it for the mip chain to be put back together from
+			// parts, and block compressed mips have to stay whole blocks.
+			const DDSLayout& layout = aRequest.myLayout;
+			if (!IsPowerOfTwo(layout.myWidth) || !IsPowerOfTwo(layout.myHeight) || layout.GetMipCount() < 2)
+			{
+				return false;
+			}
+
+			const uint32_t tailMip = MipStreamingPolicy::CalculateTailMip(layout);
+			const uint32_t finestMip = MipStreamingPolicy::CalculateFinestMip(layout, aRequest.myMaxSize);
+			aRequest.myFirstMip = std::max(tailMip, finestMip);
+			aRequest.myEndMip = layout.GetMipCount();
+			if (!layout.CanBeTopMip(aRequest.myFirstMip))
+			{
+				return false;
+			}
+		}
+
+		const DDSLayout& layout = aRequest.myLayout;
+		if (aRequest.myFirstMip >= aRequest.myEndMip || aRequest.myEndMip > layout.GetMipCount())
+		{
+			return false;
+		}
+
+		// Mips are stored largest first, so the range is one contiguous span of the file. The file may have changed
+		// since the layout was parsed, so the span is checked against the file as it is now.
+		const DDSMipLevel& first = layout.myMips[aRequest.myFirstMip];
+		const DDSMipLevel& last = layout.myMips[aRequest.myEndMip - 1];
+		const uint64_t size = last.myOffset + last.mySize - first.myOffset;
+		if (first.myOffset + size > fileSize)
+		{
+			return false;
+		}
+
+		TouchPages(data + first.myOffset, static_cast<size_t>(size));
+
+		aRequest.myDataType = TextureStreamer::DataType::DDSMips;
+		aRequest.myFileDataOffset = static_cast<size_t>(first.myOffset);
+		aRequest.myFileDataSize = static_cast<size_t>(size);
+		aRequest.myWidth = first.myWidth;
+		aRequest.myHeight = first.myHeight;
+		aRequest.myUploadSize = aRequest.myFileDataSize;
+		return true;
+	}
+
+	bool DecodeTarga(TextureStreamer::Request& aRequest)
+	{
+		FileView file;
+		Tga32::TgaHeader header;
+		if (!Settings::GetFileSystem().Open(aRequest.myPath, file) || !Tga32::ReadHeader(file.GetData(), file.GetSize(), header))
+		{
+			return false;
+		}
+
+		// Decodes from the mapped file straight into the upload data.
+		aRequest.myData.resize(static_cast<size_t>(header.myWidth) * header.myHeight * 4);
+		if (!Tga32::Decode(file.GetData(), file.GetSize(), aRequest.myData.data(), static_cast<size_t>(header.myWidth) * 4))
+		{
+			return false;
+		}
+
+		aRequest.myDataType = TextureStreamer::DataType::Pixels;
+		aRequest.myWidth = header.myWidth;
+		aRequest.myHeight = header.myHeight;
+		aRequest.myUploadSize = aRequest.myData.size() * 4 / 3;
+		return true;
+	}
+
+	bool DecodeWIC(TextureStreamer::Request& aRequest)
+	{
+		FileView file;
+		if (!Settings::GetFileSystem().Open(aRequest.myPath, file))
+		{
+			return false;
+		}
+
+		// The WIC factory is free threaded, every I/O thread only needs COM initialized once.
+		thread_local ComPtr<IWICImagingFactory> factory;
+		if (!factory)
+		{
+			CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+			if (FAILED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(factory.GetAddressOf()))))
+			{
+				return false;
+			}
+		}
+
+		ComPtr<IWICStream> stream;
+		ComPtr<IWICBitmapDecoder> decoder;
+		ComPtr<IWICBitmapFrameDecode> frame;
+		if (FAILED(factory->CreateStream(stream.GetAddressOf()))
+			|| FAILED(stream->InitializeFromMemory(const_cast<BYTE*>(file.GetData()), static_cast<DWORD>(file.GetSize())))
+			|| FAILED(factory->CreateDecoderFromStream(stream.Get(), nullptr, WICDecodeMetadataCacheOnDemand, decoder.GetAddressOf()))
+			|| FAILED(decoder->GetFrame(0, frame.GetAddressOf())))
+		{
+			return false;
+		}
+
+		UINT width, height;
+		frame->GetSize(&width, &height);
+		ComPtr<IWICBitmapSource> source = frame;
+
+		const UINT size = std::max(width, height);
+		if (aRequest.myMaxSize > 0 && size > aRequest.myMaxSize)
+		{
+			width = std::max(1u, static_cast<UINT>(static_cast<uint64_t>(width) * aRequest.myMaxSize / size));
+			height = std::max(1u, static_cast<UINT>(static_cast<uint64_t>(height) * aRequest.myMaxSize / size));
+
+			ComPtr<IWICBitmapScaler> scaler;
+			if (FAILED(factory->CreateBitmapScaler(scaler.GetAddressOf()))
+				|| FAILED(scaler->Initialize(frame.Get(), width, height, WICBitmapInterpolationModeFant)))
+			{
+				return false;
+			}
+			source = scaler;
+		}
+
+		ComPtr<IWICFormatConverter> converter;
+		if (FAILED(factory->CreateFormatConverter(converter.GetAddressOf()))
+			|| FAILED(converter->Initialize(source.Get(), GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeMedianCut)))
+		{
+			return false;
+		}
+
+		aRequest.myData.resize(static_cast<size_t>(width) * height * 4);
+		if (FAILED(converter->CopyPixels(nullptr, width * 4, static_cast<UINT>(aRequest.myData.size()), aRequest.myData.data())))
+		{
+			return false;
+		}
+
+		aRequest.myDataType = TextureStreamer::DataType::Pixels;
+		aRequest.myWidth = width;
+		aRequest.myHeight = height;
+		aRequest.myUploadSize = aRequest.myData.size() * 4 / 3;
+		return true;
+	}
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	Shutdown();
+}
+
+void TextureStreamer::Init(unsigned int aThreadCount)
+{
+	myIOThreads.Init(aThreadCount);
+}
+
+void TextureStreamer::Shutdown()
+{
+	// The queued jobs still run, with nothing pending they return without decoding.
+	{
+		std::lock_guard<std::mutex> lock(myMutex);
+		myPending.clear();
+	}
+	myIOThreads.Shutdown();
+
+	std::lock_guard<std::mutex> lock(myMutex);
+	myPending.clear();
+	myCompleted.clear();
+	myInFlightCount = 0;
+}
+
+void TextureStreamer::Enqueue(const std::shared_ptr<Request>& aRequest)
+{
+	{
+		std::lock_guard<std::mutex> lock(myMutex);
+		myPending.push_back(aRequest);
+		myInFlightCount++;
+	}
+
+	// Every job decodes whichever request has the highest priority when it starts, not necessarily this one.
+	myIOThreads.Enqueue([this]() { DecodeNext(); });
+}
+
+void TextureStreamer::DecodeNext()
+{
+	std::shared_ptr<Request> request;
+	{
+		std::lock_guard<std::mutex> lock(myMutex);
+		if (myPending.empty())
+		{
+			return;
+		}
+
+		// Priorities can be raised while waiting, so this is a scan rather than a heap.
+		auto best = std::max_element(myPending.begin(), myPending.end(), [](const std::shared_ptr<Request>& aFirst, const std::shared_ptr<Request>& aSecond)
+		{
+			return aFirst->myPriority < aSecond->myPriority;
+		});
+		request = std::move(*best);
+		myPending.erase(best);
+	}
+
+	if (!request->myIsCancelled)
+	{
+		request->myIsDecoded = Decode(*request);
+	}
+
+	std::lock_guard<std::mutex> lock(myMutex);
+	if (!request->myIsCancelled)
+	{
+		myCompleted.push_back(std::move(request));
+	}
+	myInFlightCount--;
+}
+
+void TextureStreamer::CollectCompleted(std::vector<std::shared_ptr<Request>>& outRequests)
+{
+	std::lock_guard<std::mutex> lock(myMutex);
+	for (std::shared_ptr<Request>& request : myCompleted)
+	{
+		if (!request->myIsCancelled)
+		{
+			outRequests.push_back(std::move(request));
+		}
+	}
+	myCompleted.clear();
+}
+
+bool TextureStreamer::Decode(Request& aRequest)
+{
+	if (HasExtension(aRequest.myPath, L"dds"))
+	{
+		if (aRequest.myIsMipUpdate)
+		{
+			return DecodeDDSMips(aRequest);
+		}
+		// Files that can't be streamed by mip are loaded whole.
+		if (aRequest.myIsMipStreamed && DecodeDDSMips(aRequest))
+		{
+			return true;
+		}
+		return DecodeDDS(aRequest);
+	}
+	if (!CAN_USE_OTHER_FORMATS_THAN_DDS)
+	{
+		return false;
+	}
+	if (HasExtension(aRequest.myPath, L"tga"))
+	{
+		return DecodeTarga(aRequest);
+	}
+	return DecodeWIC(aRequest);
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <tge/filesystem/FileView.h>
+#include <tge/texture/DDSLayout.h>
+#include <tge/util/ThreadPool.h>
+
+namespace Tga
+{
+
+/// <summary>
+/// Reads and decodes textures on I/O threads so nothing but the GPU upload happens on the main thread.
+/// The TextureManager enqueues requests and picks up the decoded results once per frame.
+/// </summary>
+class TextureStreamer
+{
+public:
+	enum class DataType
+	{
+		// The data is the whole .dds file, the upload creates the texture from it as is.
+		DDS,
+		// The data is myWidth * myHeight RGBA8 pixels, mips are generated on upload.
+		Pixels,
+		// The data is mips myFirstMip to myEndMip of myLayout back to back, exactly as they are stored in the .dds file.
+		DDSMips,
+	};
+
+	struct Request
+	{
+		std::wstring myPath;
+		uint64_t myID = 0;
+		bool myIsSRGB = true;
+		// Largest width or height to upload, 0 loads the full texture. DDS files skip their larger mips instead.
+		uint32_t myMaxSize = 0;
+		// Higher priorities are decoded and uploaded first.
+		std::atomic<int> myPriority = 0;
+		std::atomic<bool> myIsCancelled = false;
+		// DDS files that can be streamed by mip only read their mip tail, finer mips are requested later as updates.
+		bool myIsMipStreamed = false;
+		// Reads mips myFirstMip to myEndMip of myLayout instead of a whole texture, set by the TextureManager.
+		bool myIsMipUpdate = false;
+
+		// Written by the I/O thread, only read after the request was handed back by CollectCompleted.
+		bool myIsDecoded = false;
+		DataType myDataType = DataType::DDS;
+		// Pixels are decoded into myData. DDS data isn't copied, it is used where it is in myFile, the mapped file or
+		// pack entry, which stays open until the request is dropped.
+		std::vector<uint8_t> myData;
+		FileView myFile;
+		size_t myFileDataOffset = 0;
+		size_t myFileDataSize = 0;
+		uint32_t myWidth = 0;
+		uint32_t myHeight = 0;
+		// Estimated bytes the upload sends to the GPU, used for the per frame upload budget.
+		size_t myUploadSize = 0;
+		// Set for DDSMips, written by the TextureManager for mip updates.
+		DDSLayout myLayout;
+		uint32_t myFirstMip = 0;
+		uint32_t myEndMip = 0;
+
+		const uint8_t* GetData() const { return myDataType == DataType::Pixels ? myData.data() : myFile.GetData() + myFileDataOffset; }
+		size_t GetDataSize() const { return myDataType == DataType::Pixels ? myData.size() : myFileDataSize; }
+	};
+
+	TextureStreamer() = default;
+	~TextureStreamer();
+
+	/**
+	 * Starts the I/O threads the first time it is called.
+	 */
+	void Init(unsigned int aThreadCount = 2);
+	void Shutdown();
+
+	/**
+	 * Queues a request for decoding. Requests waiting for a thread are taken highest priority first.
+	 */
+	void Enqueue(const std::shared_ptr<Request>& aRequest);
+
+	/**
+	 * Moves every request that finished decoding, successfully or not, to the end of outRequests.
+	 * Cancelled requests are dropped instead.
+	 */
+	void CollectCompleted(std::vector<std::shared_ptr<Request>>& outRequests);
+
+	size_t GetInFlightCount() const { return myInFlightCount; }
+
+	/**
+	 * Reads and decodes the request's file into its data. Safe to call from any thread.
+	 * @returns false if the file couldn't be read or isn't a supported image.
+	 */
+	static bool Decode(Request& aRequest);
+
+private:
+	void DecodeNext();
+
+	ThreadPool myIOThreads;
+
+	std::vector<std::shared_ptr<Request>> myPending;
+	std::vector<std::shared_ptr<Request>> myCompleted;
+	std::mutex myMutex;
+	std::atomic<size_t> myInFlightCount = 0;
+};
+
+} // namespace Tga
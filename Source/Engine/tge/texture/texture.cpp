@@ -6,7 +6,9 @@
 Tga::Texture::Texture()
 {
 	myPath = L"undefined";
+	myID = 0;
 	myIsFailedTexture = false;
+	myIsReleased = false;
 }
 
 Tga::Texture::~Texture()
@@ -23,5 +23,12 @@ namespace Tga
 		Vector2ui myImageSize;
 		bool myIsFailedTexture;
 		bool myIsReleased;
+
+		// Lifetime bookkeeping for the TextureManager.
+		bool myIsSRGB = true;
+		bool myIsPinned = false;
+		uint32_t myReferenceCount = 0;
+		size_t myMemorySize = 0;
+		uint64_t myLastUsedFrame = 0;
 	};
 }
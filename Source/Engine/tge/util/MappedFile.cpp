@@ -0,0 +1,107 @@
+#include "stdafx.h"
+#include <tge/util/MappedFile.h>
+
+#define WIN32_LEAN_AND_MEAN 
+#define NOMINMAX 
+#include <windows.h>
+
+using namespace Tga;
+
+namespace
+{
+	// Empty files can't be mapped, they all point here so they still read as open.
+	const uint8_t ourEmptyFileData[1] = {};
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+MappedFile::MappedFile(MappedFile&& anOther) noexcept
+{
+	*this = std::move(anOther);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& anOther) noexcept
+{
+	if (this != &anOther)
+	{
+		Close();
+		myData = anOther.myData;
+		mySize = anOther.mySize;
+		myFileHandle = anOther.myFileHandle;
+		myMappingHandle = anOther.myMappingHandle;
+
+		anOther.myData = nullptr;
+		anOther.mySize = 0;
+		anOther.myFileHandle = nullptr;
+		anOther.myMappingHandle = nullptr;
+	}
+	return *this;
+}
+
+bool MappedFile::Open(const std::wstring& aPath)
+{
+	Close();
+
+	// Files stay open as long as they are mapped, which can be for as long as the game runs. Sharing write and delete
+	// access lets editors save over them and tools rename or delete them meanwhile, for hot reloading.
+	HANDLE file = CreateFileW(aPath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize))
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	if (fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		myData = ourEmptyFileData;
+		return true;
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == nullptr)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	myData = static_cast<const uint8_t*>(view);
+	mySize = static_cast<size_t>(fileSize.QuadPart);
+	myFileHandle = file;
+	myMappingHandle = mapping;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (myMappingHandle)
+	{
+		UnmapViewOfFile(myData);
+		CloseHandle(static_cast<HANDLE>(myMappingHandle));
+		myMappingHandle = nullptr;
+	}
+	myData = nullptr;
+	if (myFileHandle)
+	{
+		CloseHandle(static_cast<HANDLE>(myFileHandle));
+		myFileHandle = nullptr;
+	}
+	mySize = 0;
+}
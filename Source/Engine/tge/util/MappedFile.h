@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Tga
+{
+
+/// <summary>
+/// Read-only memory mapping of a whole file. The view stays valid until Close() or destruction,
+/// so loaders can hand pointers into it straight to the GPU or their own parsers without copying.
+/// </summary>
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& anOther) noexcept;
+	MappedFile& operator=(MappedFile&& anOther) noexcept;
+
+	/**
+	 * Maps the whole file. Empty files open too, with a size of 0.
+	 */
+	bool Open(const std::wstring& aPath);
+	void Close();
+
+	bool IsOpen() const { return myData != nullptr; }
+	const uint8_t* GetData() const { return myData; }
+	size_t GetSize() const { return mySize; }
+
+private:
+	const uint8_t* myData = nullptr;
+	size_t mySize = 0;
+
+	void* myFileHandle = nullptr;
+	void* myMappingHandle = nullptr;
+};
+
+} // namespace Tga
@@ -0,0 +1,114 @@
+#include "stdafx.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+
+using namespace Tga;
+
+ThreadPool::~ThreadPool()
+{
+	Shutdown();
+}
+
+void ThreadPool::Init(unsigned int aThreadCount)
+{
+	if (IsRunning())
+	{
+		return;
+	}
+
+	if (aThreadCount == 0)
+	{
+		const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		aThreadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	myShouldStop = false;
+	myThreads.reserve(aThreadCount);
+	for (unsigned int i = 0; i < aThreadCount; i++)
+	{
+		myThreads.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+void ThreadPool::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(myMutex);
+		myShouldStop = true;
+	}
+	myJobAdded.notify_all();
+
+	for (std::thread& thread : myThreads)
+	{
+		thread.join();
+	}
+	myThreads.clear();
+}
+
+void ThreadPool::Enqueue(std::function<void()> aJob)
+{
+	{
+		std::lock_guard<std::mutex> lock(myMutex);
+		myJobs.push_back(std::move(aJob));
+	}
+	myJobAdded.notify_one();
+}
+
+void ThreadPool::ParallelFor(size_t aCount, const std::function<void(size_t anIndex)>& aFunction)
+{
+	std::atomic<size_t> nextIndex{ 0 };
+	auto runIndices = [&]()
+	{
+		for (size_t i = nextIndex++; i < aCount; i = nextIndex++)
+		{
+			aFunction(i);
+		}
+	};
+
+	const size_t helperCount = std::min<size_t>(GetThreadCount(), aCount > 0 ? aCount - 1 : 0);
+	size_t finishedHelpers = 0;
+	std::mutex finishedMutex;
+	std::condition_variable helperFinished;
+	for (size_t i = 0; i < helperCount; i++)
+	{
+		Enqueue([&]()
+		{
+			runIndices();
+
+			// Notified under the lock, the waiting thread may return and take the condition variable with it as soon as the lock is released.
+			std::lock_guard<std::mutex> lock(finishedMutex);
+			finishedHelpers++;
+			helperFinished.notify_one();
+		});
+	}
+
+	runIndices();
+
+	// The helpers reference this stack frame, so wait for every one of them, not just for the indices to run out.
+	std::unique_lock<std::mutex> lock(finishedMutex);
+	helperFinished.wait(lock, [&]() { return finishedHelpers == helperCount; });
+}
+
+void ThreadPool::WorkerLoop()
+{
+	for (;;)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(myMutex);
+			myJobAdded.wait(lock, [this]() { return myShouldStop || !myJobs.empty(); });
+			// Queued jobs still run when stopping, whoever waits on them would otherwise wait forever.
+			if (myJobs.empty())
+			{
+				return;
+			}
+
+			job = std::move(myJobs.front());
+			myJobs.pop_front();
+		}
+
+		job();
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Tga
+{
+
+/// <summary>
+/// Fixed set of worker threads pulling jobs from a shared FIFO queue.
+/// Jobs must not touch the GPU context, hand results back to the main thread for that.
+/// </summary>
+class ThreadPool
+{
+public:
+	ThreadPool() = default;
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/**
+	 * Starts the worker threads. Does nothing if the pool is already running.
+	 * Init and Shutdown aren't synchronized with each other or with Enqueue, call them from the thread that owns the pool.
+	 * @param aThreadCount Number of workers, 0 uses one per hardware thread minus one for the main thread.
+	 */
+	void Init(unsigned int aThreadCount = 0);
+
+	/**
+	 * Runs every job that is still queued, then stops and joins the workers.
+	 * Jobs that need to be abandoned have to check for that themselves.
+	 */
+	void Shutdown();
+
+	void Enqueue(std::function<void()> aJob);
+
+	/**
+	 * Calls aFunction once for every index below aCount, spread over the workers and the calling thread, and returns
+	 * when every helper job has finished. The calling thread takes indices too, so this also works without workers.
+	 * Don't call it from a job on the same pool, the helpers could end up queued behind the job waiting for them.
+	 */
+	void ParallelFor(size_t aCount, const std::function<void(size_t anIndex)>& aFunction);
+
+	bool IsRunning() const { return !myThreads.empty(); }
+	unsigned int GetThreadCount() const { return static_cast<unsigned int>(myThreads.size()); }
+
+private:
+	void WorkerLoop();
+
+	std::vector<std::thread> myThreads;
+	std::deque<std::function<void()>> myJobs;
+	std::mutex myMutex;
+	std::condition_variable myJobAdded;
+	bool myShouldStop = false;
+};
+
+} // namespace Tga
@@ -0,0 +1,114 @@
+#include "TestFramework.h"
+
+#include <tge/text/DistanceField.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+using namespace Tga;
+
+namespace
+{
+	constexpr int Downsample = 4;
+	constexpr int BitmapSize = 64;
+	constexpr int FieldSize = BitmapSize / Downsample;
+
+	// A 32 x 32 square in the middle of the bitmap, 8 x 8 in the field.
+	std::vector<uint8_t> CreateSquare()
+	{
+		std::vector<uint8_t> coverage(BitmapSize * BitmapSize, 0);
+		for (int y = 16; y < 48; y++)
+		{
+			for (int x = 16; x < 48; x++)
+			{
+				coverage[y * BitmapSize + x] = 255;
+			}
+		}
+		return coverage;
+	}
+
+	std::vector<uint8_t> Generate(const std::vector<uint8_t>& someCoverage, float aSpread)
+	{
+		std::vector<uint8_t> field(FieldSize * FieldSize);
+		DistanceField::Generate(someCoverage.data(), BitmapSize, BitmapSize, Downsample, aSpread, field.data());
+		return field;
+	}
+
+	bool IsRowClose(const std::vector<uint8_t>& someField, int aRow, const int* someExpected)
+	{
+		bool isClose = true;
+		for (int x = 0; x < FieldSize; x++)
+		{
+			isClose &= std::abs(someField[aRow * FieldSize + x] - someExpected[x]) <= 1;
+		}
+		return isClose;
+	}
+}
+
+TGA_TEST(DistanceField_SquareHasLinearSignedDistances)
+{
+	const std::vector<uint8_t> field = Generate(CreateSquare(), 4.0f);
+
+	// Across the middle every field pixel is a whole pixel further from the edge, 1/8 of the range with a spread of 4.
+	// The edge runs between two field pixels, so none of them sit at exactly 128. In the center the other edges of the
+	// square are about as close, which pulls the value down a bit.
+	const int expected[FieldSize] = { 16, 48, 80, 112, 143, 175, 207, 234, 234, 207, 175, 143, 112, 80, 48, 16 };
+	TGA_CHECK(IsRowClose(field, FieldSize / 2, expected));
+
+	// Same down the middle column.
+	bool isColumnClose = true;
+	for (int y = 0; y < FieldSize; y++)
+	{
+		isColumnClose &= std::abs(field[y * FieldSize + FieldSize / 2] - expected[y]) <= 1;
+	}
+	TGA_CHECK(isColumnClose);
+
+	// Inside the square is above the edge value and outside below, everywhere.
+	bool isSignCorrect = true;
+	for (int y = 0; y < FieldSize; y++)
+	{
+		for (int x = 0; x < FieldSize; x++)
+		{
+			const bool isInside = x >= 4 && x < 12 && y >= 4 && y < 12;
+			isSignCorrect &= isInside == (field[y * FieldSize + x] >= 128);
+		}
+	}
+	TGA_CHECK(isSignCorrect);
+
+	// The corner is a bit more than the spread away from the corner of the square.
+	TGA_CHECK(field[0] == 0);
+}
+
+TGA_TEST(DistanceField_SpreadSetsTheRange)
+{
+	// Half the spread, twice the slope, and it runs out of range two pixels from the edge.
+	const std::vector<uint8_t> field = Generate(CreateSquare(), 2.0f);
+	const int expected[FieldSize] = { 0, 0, 32, 96, 160, 224, 255, 255, 255, 255, 224, 160, 96, 32, 0, 0 };
+	TGA_CHECK(IsRowClose(field, FieldSize / 2, expected));
+}
+
+TGA_TEST(DistanceField_EmptyAndFullBitmaps)
+{
+	bool isEmptyOutside = true;
+	for (uint8_t value : Generate(std::vector<uint8_t>(BitmapSize * BitmapSize, 0), 4.0f))
+	{
+		isEmptyOutside &= value == 0;
+	}
+	TGA_CHECK(isEmptyOutside);
+
+	// Coverage just under half is still outside.
+	bool isFaintOutside = true;
+	for (uint8_t value : Generate(std::vector<uint8_t>(BitmapSize * BitmapSize, 127), 4.0f))
+	{
+		isFaintOutside &= value == 0;
+	}
+	TGA_CHECK(isFaintOutside);
+
+	bool isFullInside = true;
+	for (uint8_t value : Generate(std::vector<uint8_t>(BitmapSize * BitmapSize, 128), 4.0f))
+	{
+		isFullInside &= value == 255;
+	}
+	TGA_CHECK(isFullInside);
+}
@@ -0,0 +1,185 @@
+#include "TestFramework.h"
+#include "TestFiles.h"
+
+#include <tge/filewatcher/FileWatcher.h>
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+using namespace Tga;
+namespace fs = std::filesystem;
+
+namespace
+{
+	// How long FileWatcher waits for a path to be left alone before it reports the change.
+	constexpr std::chrono::milliseconds SettleTime(100);
+
+	// The calls to one callback.
+	struct Calls
+	{
+		int myCount = 0;
+		std::wstring myPath;
+		std::chrono::steady_clock::time_point myFirstCall;
+	};
+
+	bool Watch(FileWatcher& aFileWatcher, const fs::path& aPath, Calls& outCalls)
+	{
+		return aFileWatcher.WatchFileChange(aPath.wstring(), [&outCalls](const std::wstring& aChangedPath)
+		{
+			if (outCalls.myCount++ == 0)
+			{
+				outCalls.myFirstCall = std::chrono::steady_clock::now();
+			}
+			outCalls.myPath = aChangedPath;
+		});
+	}
+
+	void FlushFor(FileWatcher& aFileWatcher, std::chrono::milliseconds aDuration)
+	{
+		const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + aDuration;
+		while (std::chrono::steady_clock::now() < end)
+		{
+			aFileWatcher.FlushChanges();
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+	}
+
+	/**
+	 * Flushes until aCalls has been called back, then long enough after that for the change to settle again, so a change
+	 * reported twice shows up in the count.
+	 * @returns false if nothing was called back within a few seconds.
+	 */
+	bool FlushUntilCalled(FileWatcher& aFileWatcher, const Calls& aCalls)
+	{
+		const std::chrono::steady_clock::time_point timeout = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (aCalls.myCount == 0)
+		{
+			if (std::chrono::steady_clock::now() >= timeout)
+			{
+				return false;
+			}
+			aFileWatcher.FlushChanges();
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		FlushFor(aFileWatcher, SettleTime * 5);
+		return true;
+	}
+
+	// Called back once, and not before the change had time to settle.
+	bool IsSettledOnce(const Calls& aCalls, std::chrono::steady_clock::time_point aChangeTime)
+	{
+		return aCalls.myCount == 1 && aCalls.myFirstCall - aChangeTime >= SettleTime;
+	}
+}
+
+TGA_TEST(FileWatcher_ModifiedFileCallsBackOnce)
+{
+	Tests::TempDirectory directory("FileWatcher_Modify");
+	const std::string file = directory.GetPath("File.txt");
+	TGA_CHECK(Tests::WriteFile(fs::u8path(file), "before"));
+
+	FileWatcher fileWatcher;
+	Calls fileCalls;
+	Calls directoryCalls;
+	TGA_CHECK(Watch(fileWatcher, fs::u8path(file), fileCalls));
+	TGA_CHECK(Watch(fileWatcher, directory.GetPath(), directoryCalls));
+
+	// Truncating and writing are separate changes, they settle as one.
+	const std::chrono::steady_clock::time_point changeTime = std::chrono::steady_clock::now();
+	TGA_CHECK(Tests::WriteFile(fs::u8path(file), "after"));
+	TGA_CHECK(FlushUntilCalled(fileWatcher, fileCalls));
+	TGA_CHECK(IsSettledOnce(fileCalls, changeTime));
+	TGA_CHECK(fileCalls.myPath == fs::u8path(file).wstring());
+
+	// The directory only cares about entries being added, removed or renamed.
+	TGA_CHECK(directoryCalls.myCount == 0);
+}
+
+TGA_TEST(FileWatcher_RenamedFileCallsBackOnce)
+{
+	Tests::TempDirectory directory("FileWatcher_Rename");
+	const std::string file = directory.GetPath("File.txt");
+	TGA_CHECK(Tests::WriteFile(fs::u8path(file), "file"));
+
+	FileWatcher fileWatcher;
+	Calls fileCalls;
+	Calls directoryCalls;
+	TGA_CHECK(Watch(fileWatcher, fs::u8path(file), fileCalls));
+	TGA_CHECK(Watch(fileWatcher, directory.GetPath(), directoryCalls));
+
+	// The old and the new name are both reported, the directory hears about it once.
+	const std::chrono::steady_clock::time_point changeTime = std::chrono::steady_clock::now();
+	std::error_code error;
+	fs::rename(fs::u8path(file), fs::u8path(directory.GetPath("Renamed.txt")), error);
+	TGA_CHECK(!error);
+	TGA_CHECK(FlushUntilCalled(fileWatcher, fileCalls));
+	TGA_CHECK(IsSettledOnce(fileCalls, changeTime));
+	TGA_CHECK(IsSettledOnce(directoryCalls, changeTime));
+}
+
+TGA_TEST(FileWatcher_DeletedFileCallsBackOnce)
+{
+	Tests::TempDirectory directory("FileWatcher_Delete");
+	const std::string file = directory.GetPath("File.txt");
+	TGA_CHECK(Tests::WriteFile(fs::u8path(file), "file"));
+
+	FileWatcher fileWatcher;
+	Calls fileCalls;
+	Calls directoryCalls;
+	TGA_CHECK(Watch(fileWatcher, fs::u8path(file), fileCalls));
+	TGA_CHECK(Watch(fileWatcher, directory.GetPath(), directoryCalls));
+
+	const std::chrono::steady_clock::time_point changeTime = std::chrono::steady_clock::now();
+	std::error_code error;
+	TGA_CHECK(fs::remove(fs::u8path(file), error));
+	TGA_CHECK(FlushUntilCalled(fileWatcher, fileCalls));
+	TGA_CHECK(IsSettledOnce(fileCalls, changeTime));
+	TGA_CHECK(IsSettledOnce(directoryCalls, changeTime));
+}
+
+TGA_TEST(FileWatcher_CreatedFileCallsBackOnce)
+{
+	Tests::TempDirectory directory("FileWatcher_Create");
+	const std::string other = directory.GetPath("Other.txt");
+	TGA_CHECK(Tests::WriteFile(fs::u8path(other), "other"));
+
+	FileWatcher fileWatcher;
+	Calls otherCalls;
+	Calls directoryCalls;
+	TGA_CHECK(Watch(fileWatcher, fs::u8path(other), otherCalls));
+	TGA_CHECK(Watch(fileWatcher, directory.GetPath(), directoryCalls));
+
+	// Files that don't exist can't be watched, their directory tells when they show up.
+	TGA_CHECK(!Watch(fileWatcher, fs::u8path(directory.GetPath("Created.txt")), otherCalls));
+
+	// Created and then written, the directory hears about it once and other files in it not at all.
+	const std::chrono::steady_clock::time_point changeTime = std::chrono::steady_clock::now();
+	TGA_CHECK(Tests::WriteFile(fs::u8path(directory.GetPath("Created.txt")), "created"));
+	TGA_CHECK(FlushUntilCalled(fileWatcher, directoryCalls));
+	TGA_CHECK(IsSettledOnce(directoryCalls, changeTime));
+	TGA_CHECK(otherCalls.myCount == 0);
+}
+
+TGA_TEST(FileWatcher_StoppedAndDisabledWatchersStayQuiet)
+{
+	Tests::TempDirectory directory("FileWatcher_Stop");
+	const std::string file = directory.GetPath("File.txt");
+	TGA_CHECK(Tests::WriteFile(fs::u8path(file), "before"));
+
+	FileWatcher disabledWatcher(false);
+	Calls disabledCalls;
+	TGA_CHECK(!Watch(disabledWatcher, fs::u8path(file), disabledCalls));
+
+	FileWatcher fileWatcher;
+	Calls fileCalls;
+	TGA_CHECK(Watch(fileWatcher, fs::u8path(file), fileCalls));
+	fileWatcher.StopWatching(fs::u8path(file).wstring());
+
+	TGA_CHECK(Tests::WriteFile(fs::u8path(file), "after"));
+	FlushFor(fileWatcher, SettleTime * 5);
+	disabledWatcher.FlushChanges();
+	TGA_CHECK(fileCalls.myCount == 0);
+	TGA_CHECK(disabledCalls.myCount == 0);
+}
@@ -0,0 +1,176 @@
+#include "TestFramework.h"
+
+#include <tge/graphics/Frustum.h>
+#include <tge/math/Matrix4x4.h>
+
+#include <cfloat>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace Tga;
+
+namespace
+{
+	// Looking down +Z from the origin with a 90 degree field of view, so the side planes are |x| = z and |y| = z.
+	Frustum CreateTestFrustum()
+	{
+		return Frustum::CreateFromViewProjection(Matrix4x4f::CreatePerspectiveMatrixFovX(3.14159265f * 0.5f, 1.0f, 1.0f, 100.0f));
+	}
+
+	struct SphereSet
+	{
+		std::vector<float> X;
+		std::vector<float> Y;
+		std::vector<float> Z;
+		std::vector<float> Radii;
+	};
+
+	SphereSet CreateRandomSpheres(size_t aCount)
+	{
+		std::mt19937 random(9);
+		std::uniform_real_distribution<float> position(-150.0f, 150.0f);
+		std::uniform_real_distribution<float> radius(0.1f, 20.0f);
+
+		SphereSet spheres;
+		for (size_t i = 0; i < aCount; i++)
+		{
+			spheres.X.push_back(position(random));
+			spheres.Y.push_back(position(random));
+			spheres.Z.push_back(position(random));
+			spheres.Radii.push_back(radius(random));
+		}
+		return spheres;
+	}
+}
+
+TGA_TEST(Frustum_Spheres4InsideOutsideAndStraddling)
+{
+	const Frustum frustum = CreateTestFrustum();
+
+	// Inside, behind the camera, across the left plane and far off to the right.
+	const float x[4] = { 0.0f, 0.0f, -50.0f, 200.0f };
+	const float y[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	const float z[4] = { 50.0f, -10.0f, 50.0f, 50.0f };
+	const float radii[4] = { 1.0f, 1.0f, 5.0f, 1.0f };
+
+	int crossingMask = -1;
+	const int visibleMask = frustum.IntersectsSpheres4(x, y, z, radii, crossingMask);
+	TGA_CHECK(visibleMask == 0x5);
+	TGA_CHECK(crossingMask == 0x4);
+
+	for (int i = 0; i < 4; i++)
+	{
+		TGA_CHECK(frustum.IntersectsSphere({ x[i], y[i], z[i] }, radii[i]) == (((visibleMask >> i) & 1) != 0));
+	}
+
+	// Touching the near plane from behind still counts, missing it by a bit doesn't.
+	const float nearX[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	const float nearZ[4] = { 0.5f, 0.0f, -1.0f, -5.0f };
+	const float nearRadii[4] = { 1.0f, 1.01f, 1.0f, 1.0f };
+	TGA_CHECK(frustum.IntersectsSpheres4(nearX, nearX, nearZ, nearRadii, crossingMask) == 0x3);
+	TGA_CHECK(crossingMask == 0x3);
+}
+
+TGA_TEST(Frustum_Spheres4PaddingIsNeverVisible)
+{
+	const Frustum frustum = CreateTestFrustum();
+
+	// ModelInstancer pads the last group with these, at the origin or wherever the previous instance was.
+	const float x[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	const float y[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	const float z[4] = { 50.0f, 0.0f, 50.0f, 0.0f };
+	const float radii[4] = { 1.0f, -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+	int crossingMask = -1;
+	TGA_CHECK(frustum.IntersectsSpheres4(x, y, z, radii, crossingMask) == 0x1);
+	TGA_CHECK(crossingMask == 0);
+}
+
+TGA_TEST(Frustum_Spheres4MatchesSingleSphereTest)
+{
+	const Frustum frustum = CreateTestFrustum();
+	const SphereSet spheres = CreateRandomSpheres(4096);
+
+	size_t mismatches = 0;
+	size_t visibleCount = 0;
+	for (size_t i = 0; i < spheres.X.size(); i += 4)
+	{
+		int crossingMask = 0;
+		const int visibleMask = frustum.IntersectsSpheres4(&spheres.X[i], &spheres.Y[i], &spheres.Z[i], &spheres.Radii[i], crossingMask);
+		for (size_t lane = 0; lane < 4; lane++)
+		{
+			const bool isVisible = frustum.IntersectsSphere({ spheres.X[i + lane], spheres.Y[i + lane], spheres.Z[i + lane] }, spheres.Radii[i + lane]);
+			mismatches += isVisible != (((visibleMask >> lane) & 1) != 0) ? 1 : 0;
+			visibleCount += isVisible ? 1 : 0;
+		}
+		TGA_CHECK((crossingMask & ~visibleMask) == 0);
+	}
+
+	TGA_CHECK(mismatches == 0);
+	// Some of each, or the comparison above doesn't say much.
+	TGA_CHECK(visibleCount > 100 && visibleCount < spheres.X.size() - 100);
+}
+
+TGA_TEST(Frustum_BoxInsideOutsideAndStraddling)
+{
+	const Frustum frustum = CreateTestFrustum();
+	const Matrix4x4f identity;
+	const Vector3f unitExtents(1.0f, 1.0f, 1.0f);
+
+	TGA_CHECK(frustum.IntersectsBox({ 0.0f, 0.0f, 50.0f }, unitExtents, identity));
+	TGA_CHECK(!frustum.IntersectsBox({ 0.0f, 0.0f, -10.0f }, unitExtents, identity));
+	TGA_CHECK(!frustum.IntersectsBox({ 0.0f, 0.0f, 110.0f }, unitExtents, identity));
+	TGA_CHECK(frustum.IntersectsBox({ 0.0f, 0.0f, 100.5f }, unitExtents, identity));
+	TGA_CHECK(frustum.IntersectsBox({ -50.5f, 0.0f, 50.0f }, unitExtents, identity));
+	TGA_CHECK(!frustum.IntersectsBox({ -53.0f, 0.0f, 50.0f }, unitExtents, identity));
+
+	// The box ends before the near plane, but scaling it along Z makes it reach into view. The center is scaled too.
+	const Vector3f behind(0.0f, 0.0f, -0.25f);
+	TGA_CHECK(!frustum.IntersectsBox(behind, unitExtents, identity));
+	TGA_CHECK(frustum.IntersectsBox(behind, unitExtents, Matrix4x4f::CreateScaleMatrix({ 1.0f, 1.0f, 20.0f })));
+
+	// Same for a box that is long along its local X and turned to point down the view direction.
+	const Vector3f longExtents(20.0f, 0.5f, 0.5f);
+	const Matrix4x4f aboveView = Matrix4x4f::CreateTranslationMatrix({ 0.0f, 30.0f, 25.0f });
+	TGA_CHECK(!frustum.IntersectsBox({ 0.0f, 0.0f, 0.0f }, longExtents, aboveView));
+	TGA_CHECK(frustum.IntersectsBox({ 0.0f, 0.0f, 0.0f }, longExtents, Matrix4x4f::CreateRotationAroundY(3.14159265f * 0.5f) * aboveView));
+}
+
+TGA_BENCHMARK(Frustum_Cull)
+{
+	constexpr size_t SphereCount = 100000;
+	const Frustum frustum = CreateTestFrustum();
+	const SphereSet spheres = CreateRandomSpheres(SphereCount);
+	std::vector<uint8_t> visible(SphereCount);
+
+	Tests::Benchmark("IntersectsSphere", [&]()
+	{
+		for (size_t i = 0; i < SphereCount; i++)
+		{
+			visible[i] = frustum.IntersectsSphere({ spheres.X[i], spheres.Y[i], spheres.Z[i] }, spheres.Radii[i]) ? 1 : 0;
+		}
+		Tests::DoNotOptimize(visible.data());
+	}, SphereCount);
+
+	Tests::Benchmark("IntersectsSpheres4", [&]()
+	{
+		for (size_t i = 0; i < SphereCount; i += 4)
+		{
+			int crossingMask = 0;
+			const int visibleMask = frustum.IntersectsSpheres4(&spheres.X[i], &spheres.Y[i], &spheres.Z[i], &spheres.Radii[i], crossingMask);
+			visible[i] = static_cast<uint8_t>(visibleMask);
+		}
+		Tests::DoNotOptimize(visible.data());
+	}, SphereCount);
+
+	const Matrix4x4f identity;
+	Tests::Benchmark("IntersectsBox", [&]()
+	{
+		for (size_t i = 0; i < SphereCount; i++)
+		{
+			visible[i] = frustum.IntersectsBox({ spheres.X[i], spheres.Y[i], spheres.Z[i] }, { spheres.Radii[i], spheres.Radii[i], spheres.Radii[i] }, identity) ? 1 : 0;
+		}
+		Tests::DoNotOptimize(visible.data());
+	}, SphereCount);
+}
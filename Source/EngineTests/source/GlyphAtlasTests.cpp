@@ -0,0 +1,197 @@
+#include "TestFramework.h"
+#include "TestDevice.h"
+
+#include <tge/text/GlyphAtlas.h>
+#include <tge/text/SkylinePacker.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace Tga;
+
+namespace
+{
+	struct PackedRect
+	{
+		int X;
+		int Y;
+		int Width;
+		int Height;
+	};
+
+	// Marks every packed pixel, fails on pixels outside the area or packed twice.
+	bool IsEachRectInsideAndApart(const std::vector<PackedRect>& someRects, int aWidth, int aHeight)
+	{
+		std::vector<uint8_t> isUsed(static_cast<size_t>(aWidth) * static_cast<size_t>(aHeight), 0);
+		for (const PackedRect& rect : someRects)
+		{
+			if (rect.X < 0 || rect.Y < 0 || rect.X + rect.Width > aWidth || rect.Y + rect.Height > aHeight)
+			{
+				return false;
+			}
+
+			for (int y = rect.Y; y < rect.Y + rect.Height; y++)
+			{
+				for (int x = rect.X; x < rect.X + rect.Width; x++)
+				{
+					uint8_t& pixel = isUsed[static_cast<size_t>(y) * static_cast<size_t>(aWidth) + static_cast<size_t>(x)];
+					if (pixel != 0)
+					{
+						return false;
+					}
+					pixel = 1;
+				}
+			}
+		}
+		return true;
+	}
+
+	// A page sized bitmap fills a page on its own, so every Add past the first on a page needs a new one.
+	std::vector<uint32_t> CreateFullPage(int aPageSize)
+	{
+		return std::vector<uint32_t>(static_cast<size_t>(aPageSize) * static_cast<size_t>(aPageSize), 0xffffffffu);
+	}
+}
+
+TGA_TEST(SkylinePacker_PlacesOnTheLowestTop)
+{
+	SkylinePacker packer;
+	packer.Init(64, 64);
+
+	int x = -1;
+	int y = -1;
+	TGA_CHECK(packer.Pack(32, 16, x, y) && x == 0 && y == 0);
+	TGA_CHECK(packer.Pack(16, 8, x, y) && x == 32 && y == 0);
+
+	TGA_CHECK(packer.Pack(16, 4, x, y) && x == 48 && y == 0);
+
+	// Spanning both short segments puts its top at 12, on the tall one it would be at 20.
+	TGA_CHECK(packer.Pack(32, 4, x, y) && x == 32 && y == 8);
+
+	// Too wide to start anywhere but the left edge.
+	TGA_CHECK(packer.Pack(64, 4, x, y) && x == 0 && y == 16);
+
+	TGA_CHECK(!packer.Pack(0, 4, x, y));
+	TGA_CHECK(!packer.Pack(4, 0, x, y));
+	TGA_CHECK(!packer.Pack(65, 1, x, y));
+	TGA_CHECK(!packer.Pack(1, 65, x, y));
+}
+
+TGA_TEST(SkylinePacker_RectsNeverOverlap)
+{
+	constexpr int PageSize = 256;
+	SkylinePacker packer;
+	packer.Init(PageSize, PageSize);
+
+	// Glyph sized rectangles until one doesn't fit any more.
+	std::mt19937 random(5);
+	std::uniform_int_distribution<int> size(1, 24);
+	std::vector<PackedRect> rects;
+	int failures = 0;
+	while (failures < 50)
+	{
+		PackedRect rect = { 0, 0, size(random), size(random) };
+		if (packer.Pack(rect.Width, rect.Height, rect.X, rect.Y))
+		{
+			rects.push_back(rect);
+		}
+		else
+		{
+			failures++;
+		}
+	}
+
+	TGA_CHECK(IsEachRectInsideAndApart(rects, PageSize, PageSize));
+
+	long long area = 0;
+	for (const PackedRect& rect : rects)
+	{
+		area += static_cast<long long>(rect.Width) * rect.Height;
+	}
+	TGA_CHECK(packer.GetOccupancy() == static_cast<float>(area) / static_cast<float>(PageSize * PageSize));
+	// Skyline packing wastes the gaps under overhangs, but not most of the page.
+	TGA_CHECK(packer.GetOccupancy() > 0.6f);
+}
+
+TGA_TEST(SkylinePacker_FullPageRejectsUntilCleared)
+{
+	SkylinePacker packer;
+	packer.Init(64, 64);
+
+	std::vector<PackedRect> rects;
+	for (int i = 0; i < 16; i++)
+	{
+		PackedRect rect = { 0, 0, 16, 16 };
+		TGA_CHECK(packer.Pack(rect.Width, rect.Height, rect.X, rect.Y));
+		rects.push_back(rect);
+	}
+	TGA_CHECK(IsEachRectInsideAndApart(rects, 64, 64));
+	TGA_CHECK(packer.GetOccupancy() == 1.0f);
+
+	int x = 0;
+	int y = 0;
+	TGA_CHECK(!packer.Pack(1, 1, x, y));
+
+	packer.Clear();
+	TGA_CHECK(packer.GetOccupancy() == 0.0f);
+	TGA_CHECK(packer.Pack(64, 64, x, y) && x == 0 && y == 0);
+}
+
+TGA_TEST(GlyphAtlas_EvictsLeastRecentlyUsedPage)
+{
+	if (!Tests::CreateTestDevice())
+	{
+		return;
+	}
+
+	constexpr int PageSize = 32;
+	const std::vector<uint32_t> pixels = CreateFullPage(PageSize);
+
+	GlyphAtlas atlas;
+	atlas.Init(PageSize, 3);
+
+	// One page per frame, up to the budget.
+	GlyphAtlasRegion regions[3];
+	for (GlyphAtlasRegion& region : regions)
+	{
+		atlas.BeginFrame();
+		TGA_CHECK(atlas.Add(PageSize, PageSize, pixels.data(), region));
+	}
+	TGA_CHECK(atlas.GetPageCount() == 3);
+	TGA_CHECK(regions[0].myPage == 0 && regions[1].myPage == 1 && regions[2].myPage == 2);
+	TGA_CHECK(atlas.GetEvictionCount() == 0);
+
+	// Drawing from the first page makes the second the least recently used.
+	atlas.BeginFrame();
+	atlas.MarkUsed(regions[0].myPage);
+
+	GlyphAtlasRegion replacement;
+	TGA_CHECK(atlas.Add(PageSize, PageSize, pixels.data(), replacement));
+	TGA_CHECK(atlas.GetPageCount() == 3);
+	TGA_CHECK(atlas.GetEvictionCount() == 1);
+	TGA_CHECK(replacement.myPage == 1);
+	TGA_CHECK(replacement.myPageGeneration == regions[1].myPageGeneration + 1);
+	TGA_CHECK(atlas.IsValid(regions[0]));
+	TGA_CHECK(!atlas.IsValid(regions[1]));
+	TGA_CHECK(atlas.IsValid(regions[2]));
+	TGA_CHECK(atlas.IsValid(replacement));
+
+	// The third page is the only one not used this frame.
+	GlyphAtlasRegion second;
+	TGA_CHECK(atlas.Add(PageSize, PageSize, pixels.data(), second));
+	TGA_CHECK(second.myPage == 2 && !atlas.IsValid(regions[2]));
+	TGA_CHECK(atlas.GetEvictionCount() == 2);
+
+	// Every page is in use this frame, so the atlas grows past the budget instead of evicting.
+	GlyphAtlasRegion overBudget;
+	TGA_CHECK(atlas.Add(PageSize, PageSize, pixels.data(), overBudget));
+	TGA_CHECK(atlas.GetPageCount() == 4 && overBudget.myPage == 3);
+	TGA_CHECK(atlas.GetEvictionCount() == 2);
+
+	// Uploads queued for evicted pages are dropped.
+	atlas.Upload();
+
+	GlyphAtlasRegion tooLarge;
+	TGA_CHECK(!atlas.Add(PageSize + 1, 1, pixels.data(), tooLarge));
+}
@@ -0,0 +1,179 @@
+#include "TestFramework.h"
+
+#include <tge/filesystem/LZ4.h>
+
+#include <cstdint>
+#include <vector>
+
+using namespace Tga;
+
+namespace
+{
+	// Deterministic noise, nothing in it repeats so it doesn't compress.
+	std::vector<uint8_t> CreateNoise(size_t aSize, uint32_t aSeed)
+	{
+		std::vector<uint8_t> data(aSize);
+		uint32_t state = aSeed;
+		for (uint8_t& value : data)
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			value = static_cast<uint8_t>(state >> 24);
+		}
+		return data;
+	}
+
+	std::vector<uint8_t> CreateText(size_t aSize)
+	{
+		static const char line[] = "The quick brown fox jumps over the lazy dog. ";
+		std::vector<uint8_t> data(aSize);
+		for (size_t i = 0; i < aSize; i++)
+		{
+			data[i] = static_cast<uint8_t>(line[i % (sizeof(line) - 1)]);
+		}
+		return data;
+	}
+
+	std::vector<uint8_t> Compress(const std::vector<uint8_t>& someData)
+	{
+		std::vector<uint8_t> compressed(LZ4::CompressBound(someData.size()));
+		compressed.resize(LZ4::Compress(someData.data(), someData.size(), compressed.data(), compressed.size()));
+		return compressed;
+	}
+
+	// Decompresses into a buffer of exactly aSize bytes, so the address sanitizer catches any write past it.
+	bool Decompress(const std::vector<uint8_t>& someCompressed, size_t aSize, std::vector<uint8_t>& outData)
+	{
+		outData.assign(aSize, 0);
+		return LZ4::Decompress(someCompressed.data(), someCompressed.size(), outData.data(), outData.size());
+	}
+
+	bool RoundTrips(const std::vector<uint8_t>& someData)
+	{
+		const std::vector<uint8_t> compressed = Compress(someData);
+		std::vector<uint8_t> decompressed;
+		return !compressed.empty() && Decompress(compressed, someData.size(), decompressed) && decompressed == someData;
+	}
+}
+
+TGA_TEST(LZ4_EmptyData)
+{
+	TGA_CHECK(LZ4::Compress(nullptr, 0, nullptr, 0) == 0);
+
+	// An empty block, or a single token without literals as other implementations write it.
+	TGA_CHECK(LZ4::Decompress(nullptr, 0, nullptr, 0));
+	const uint8_t emptyToken[] = { 0x00 };
+	TGA_CHECK(LZ4::Decompress(emptyToken, sizeof(emptyToken), nullptr, 0));
+
+	const uint8_t literal[] = { 0x10, 'a' };
+	TGA_CHECK(!LZ4::Decompress(literal, sizeof(literal), nullptr, 0));
+
+	std::vector<uint8_t> decompressed;
+	TGA_CHECK(!Decompress({}, 1, decompressed));
+}
+
+TGA_TEST(LZ4_RoundTripsIncompressibleData)
+{
+	// Short blocks are all literals, around 12 bytes is where matches may start.
+	bool isEveryShortSizeIntact = true;
+	for (size_t size = 1; size <= 32; size++)
+	{
+		isEveryShortSizeIntact &= RoundTrips(CreateNoise(size, static_cast<uint32_t>(size)));
+	}
+	TGA_CHECK(isEveryShortSizeIntact);
+
+	// A long run of literals, its length continues over many bytes.
+	const std::vector<uint8_t> noise = CreateNoise(5000, 1);
+	TGA_CHECK(RoundTrips(noise));
+	const std::vector<uint8_t> compressed = Compress(noise);
+	TGA_CHECK(compressed.size() > noise.size());
+	TGA_CHECK(compressed.size() <= LZ4::CompressBound(noise.size()));
+
+	// Too small an output isn't enough, the data is stored as is then.
+	std::vector<uint8_t> small(noise.size());
+	TGA_CHECK(LZ4::Compress(noise.data(), noise.size(), small.data(), small.size()) == 0);
+}
+
+TGA_TEST(LZ4_RoundTripsRepetitiveData)
+{
+	// One byte repeated is a match overlapping itself.
+	const std::vector<uint8_t> zeros(100000, 0);
+	TGA_CHECK(RoundTrips(zeros));
+	TGA_CHECK(Compress(zeros).size() < zeros.size() / 100);
+
+	const std::vector<uint8_t> text = CreateText(100000);
+	TGA_CHECK(RoundTrips(text));
+	TGA_CHECK(Compress(text).size() < text.size() / 100);
+}
+
+TGA_TEST(LZ4_RoundTripsDataLargerThanTheWindow)
+{
+	// Matches only reach 64 KB back, the second copy of the noise is further away than that and has to be literals.
+	std::vector<uint8_t> data = CreateNoise(70000, 2);
+	const std::vector<uint8_t> text = CreateText(30000);
+	data.insert(data.end(), text.begin(), text.end());
+	const std::vector<uint8_t> copy(data.begin(), data.begin() + 70000);
+	data.insert(data.end(), copy.begin(), copy.end());
+	TGA_CHECK(RoundTrips(data));
+
+	// Within the window it is a match.
+	std::vector<uint8_t> near = CreateNoise(60000, 3);
+	near.insert(near.end(), near.begin(), near.end());
+	TGA_CHECK(RoundTrips(near));
+	TGA_CHECK(Compress(near).size() < 61000);
+}
+
+TGA_TEST(LZ4_RejectsTruncatedBlocks)
+{
+	const std::vector<uint8_t> data = CreateText(1000);
+	const std::vector<uint8_t> compressed = Compress(data);
+	TGA_CHECK(!compressed.empty());
+
+	// The block always ends in literals, so cutting any of it off leaves the output short.
+	bool isEveryTruncationRejected = true;
+	std::vector<uint8_t> decompressed;
+	for (size_t size = 0; size < compressed.size(); size++)
+	{
+		const std::vector<uint8_t> truncated(compressed.begin(), compressed.begin() + static_cast<std::ptrdiff_t>(size));
+		isEveryTruncationRejected &= !Decompress(truncated, data.size(), decompressed);
+	}
+	TGA_CHECK(isEveryTruncationRejected);
+
+	// Decompressing to anything but the exact size fails too.
+	TGA_CHECK(!Decompress(compressed, data.size() - 1, decompressed));
+	TGA_CHECK(!Decompress(compressed, data.size() + 1, decompressed));
+}
+
+TGA_TEST(LZ4_RejectsCorruptBlocks)
+{
+	std::vector<uint8_t> decompressed;
+
+	// Matches with an offset of 0, or reaching back before the start of the output.
+	TGA_CHECK(!Decompress({ 0x10, 'a', 0x00, 0x00, 0x50, 'a', 'b', 'c', 'd', 'e' }, 10, decompressed));
+	TGA_CHECK(!Decompress({ 0x10, 'a', 0x02, 0x00, 0x50, 'a', 'b', 'c', 'd', 'e' }, 10, decompressed));
+	TGA_CHECK(Decompress({ 0x10, 'a', 0x01, 0x00, 0x50, 'a', 'b', 'c', 'd', 'e' }, 10, decompressed));
+
+	// A match offset cut in half.
+	TGA_CHECK(!Decompress({ 0x10, 'a', 0x01 }, 5, decompressed));
+
+	// Literals past the end of the block, and a length that never ends.
+	TGA_CHECK(!Decompress({ 0x50, 'a', 'b' }, 5, decompressed));
+	TGA_CHECK(!Decompress({ 0xF0, 0xFF, 0xFF }, 600, decompressed));
+
+	// Literals and matches that don't fit the output.
+	TGA_CHECK(!Decompress({ 0x30, 'a', 'b', 'c' }, 2, decompressed));
+	TGA_CHECK(!Decompress({ 0x1F, 'a', 0x01, 0x00, 0xFF, 0x00, 0x00 }, 100, decompressed));
+
+	// Whatever the bytes are, nothing is read or written out of bounds.
+	const std::vector<uint8_t> compressed = Compress(CreateText(1000));
+	for (size_t i = 0; i < compressed.size(); i++)
+	{
+		for (int value : { 0x00, 0x0F, 0x80, 0xF0, 0xFF })
+		{
+			std::vector<uint8_t> corrupt = compressed;
+			corrupt[i] = static_cast<uint8_t>(value);
+			Decompress(corrupt, 1000, decompressed);
+		}
+	}
+}
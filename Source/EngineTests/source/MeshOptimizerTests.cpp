@@ -0,0 +1,251 @@
+#include "TestFramework.h"
+
+#include <tge/model/MeshOptimizer.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace Tga;
+
+namespace
+{
+	struct TestVertex
+	{
+		float Position[3];
+		uint32_t Id;
+	};
+
+	struct TestMesh
+	{
+		std::vector<TestVertex> Vertices;
+		std::vector<unsigned int> Indices;
+	};
+
+	// A face of an axis aligned box, wound so it faces away from the box center.
+	void AddBoxFace(TestMesh& inOutMesh, int anAxis, float aSign, float aHalfSize, uint32_t aGridSize)
+	{
+		const unsigned int firstVertex = static_cast<unsigned int>(inOutMesh.Vertices.size());
+		const int uAxis = (anAxis + 1) % 3;
+		const int vAxis = (anAxis + 2) % 3;
+
+		for (uint32_t v = 0; v <= aGridSize; v++)
+		{
+			for (uint32_t u = 0; u <= aGridSize; u++)
+			{
+				TestVertex vertex = {};
+				vertex.Position[anAxis] = aSign * aHalfSize;
+				vertex.Position[uAxis] = (2.0f * static_cast<float>(u) / static_cast<float>(aGridSize) - 1.0f) * aHalfSize;
+				vertex.Position[vAxis] = (2.0f * static_cast<float>(v) / static_cast<float>(aGridSize) - 1.0f) * aHalfSize;
+				vertex.Id = static_cast<uint32_t>(inOutMesh.Vertices.size());
+				inOutMesh.Vertices.push_back(vertex);
+			}
+		}
+
+		// u x v points along +axis, so flip the winding on the negative faces.
+		for (uint32_t v = 0; v < aGridSize; v++)
+		{
+			for (uint32_t u = 0; u < aGridSize; u++)
+			{
+				const unsigned int corner = firstVertex + v * (aGridSize + 1) + u;
+				const unsigned int right = corner + 1;
+				const unsigned int up = corner + aGridSize + 1;
+				const unsigned int diagonal = up + 1;
+				if (aSign > 0.0f)
+				{
+					inOutMesh.Indices.insert(inOutMesh.Indices.end(), { corner, right, diagonal, corner, diagonal, up });
+				}
+				else
+				{
+					inOutMesh.Indices.insert(inOutMesh.Indices.end(), { corner, diagonal, right, corner, up, diagonal });
+				}
+			}
+		}
+	}
+
+	void AddBox(TestMesh& inOutMesh, float aHalfSize, uint32_t aGridSize)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			AddBoxFace(inOutMesh, axis, 1.0f, aHalfSize, aGridSize);
+			AddBoxFace(inOutMesh, axis, -1.0f, aHalfSize, aGridSize);
+		}
+	}
+
+	// A grid with its triangles in random order, about the worst case for the vertex cache.
+	TestMesh CreateShuffledGrid(uint32_t aGridSize)
+	{
+		TestMesh mesh;
+		AddBoxFace(mesh, 2, 1.0f, 100.0f, aGridSize);
+
+		std::vector<std::array<unsigned int, 3>> triangles(mesh.Indices.size() / 3);
+		memcpy(triangles.data(), mesh.Indices.data(), sizeof(unsigned int) * mesh.Indices.size());
+		std::shuffle(triangles.begin(), triangles.end(), std::mt19937(3));
+		memcpy(mesh.Indices.data(), triangles.data(), sizeof(unsigned int) * mesh.Indices.size());
+		return mesh;
+	}
+
+	typedef std::array<float, 9> Triangle;
+
+	// Rotates each triangle so it starts at its smallest corner, reordering may rotate triangles but must keep the winding.
+	std::vector<Triangle> GetTriangles(const std::vector<TestVertex>& someVertices, const std::vector<unsigned int>& someIndices)
+	{
+		std::vector<Triangle> triangles;
+		for (size_t i = 0; i + 2 < someIndices.size(); i += 3)
+		{
+			std::array<const float*, 3> corners = { someVertices[someIndices[i]].Position, someVertices[someIndices[i + 1]].Position, someVertices[someIndices[i + 2]].Position };
+			auto isLess = [](const float* aFirst, const float* aSecond)
+			{
+				return std::lexicographical_compare(aFirst, aFirst + 3, aSecond, aSecond + 3);
+			};
+			std::rotate(corners.begin(), std::min_element(corners.begin(), corners.end(), isLess), corners.end());
+
+			Triangle triangle;
+			for (int c = 0; c < 3; c++)
+			{
+				std::copy(corners[c], corners[c] + 3, triangle.begin() + c * 3);
+			}
+			triangles.push_back(triangle);
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	const uint8_t* GetPositions(const TestMesh& aMesh)
+	{
+		return reinterpret_cast<const uint8_t*>(aMesh.Vertices.data());
+	}
+}
+
+TGA_TEST(MeshOptimizer_AnalyzeVertexCacheCountsMisses)
+{
+	const unsigned int triangle[] = { 0, 1, 2 };
+	const VertexCacheStatistics single = MeshOptimizer::AnalyzeVertexCache(triangle, 3, 3);
+	TGA_CHECK(single.ACMR == 3.0f && single.ATVR == 1.0f);
+
+	// The second triangle reuses two cached vertices.
+	const unsigned int quad[] = { 0, 1, 2, 2, 1, 3 };
+	const VertexCacheStatistics shared = MeshOptimizer::AnalyzeVertexCache(quad, 6, 4);
+	TGA_CHECK(shared.ACMR == 2.0f && shared.ATVR == 1.0f);
+}
+
+TGA_TEST(MeshOptimizer_VertexCacheImprovesAndKeepsTriangles)
+{
+	TestMesh mesh = CreateShuffledGrid(64);
+	const std::vector<Triangle> trianglesBefore = GetTriangles(mesh.Vertices, mesh.Indices);
+	const VertexCacheStatistics before = MeshOptimizer::AnalyzeVertexCache(mesh.Indices.data(), mesh.Indices.size(), mesh.Vertices.size());
+
+	MeshOptimizer::OptimizeVertexCache(mesh.Indices.data(), mesh.Indices.size(), mesh.Vertices.size());
+	const VertexCacheStatistics after = MeshOptimizer::AnalyzeVertexCache(mesh.Indices.data(), mesh.Indices.size(), mesh.Vertices.size());
+
+	TGA_CHECK(GetTriangles(mesh.Vertices, mesh.Indices) == trianglesBefore);
+	TGA_CHECK(after.ACMR < before.ACMR && after.ATVR < before.ATVR);
+	// A regular grid approaches 0.5, a shuffled one is close to 3.
+	TGA_CHECK(after.ACMR < 0.8f);
+	TGA_CHECK(after.ATVR < 1.6f);
+}
+
+TGA_TEST(MeshOptimizer_OverdrawPutsOuterShellFirst)
+{
+	// An inner box listed before an outer one, drawn that way every outer pixel is shaded twice.
+	TestMesh mesh;
+	AddBox(mesh, 2.0f, 4);
+	const size_t innerIndexCount = mesh.Indices.size();
+	const unsigned int innerVertexCount = static_cast<unsigned int>(mesh.Vertices.size());
+	AddBox(mesh, 10.0f, 4);
+
+	MeshOptimizer::OptimizeVertexCache(mesh.Indices.data(), mesh.Indices.size(), mesh.Vertices.size());
+	const std::vector<Triangle> trianglesBefore = GetTriangles(mesh.Vertices, mesh.Indices);
+	const VertexCacheStatistics before = MeshOptimizer::AnalyzeVertexCache(mesh.Indices.data(), mesh.Indices.size(), mesh.Vertices.size());
+
+	const float threshold = 1.05f;
+	MeshOptimizer::OptimizeOverdraw(mesh.Indices.data(), mesh.Indices.size(), GetPositions(mesh), sizeof(TestVertex), mesh.Vertices.size(), threshold);
+	const VertexCacheStatistics after = MeshOptimizer::AnalyzeVertexCache(mesh.Indices.data(), mesh.Indices.size(), mesh.Vertices.size());
+
+	TGA_CHECK(GetTriangles(mesh.Vertices, mesh.Indices) == trianglesBefore);
+	TGA_CHECK(after.ACMR <= before.ACMR * threshold);
+
+	const size_t outerIndexCount = mesh.Indices.size() - innerIndexCount;
+	bool isOuterFirst = true;
+	for (size_t i = 0; i < mesh.Indices.size(); i++)
+	{
+		isOuterFirst &= (mesh.Indices[i] >= innerVertexCount) == (i < outerIndexCount);
+	}
+	TGA_CHECK(isOuterFirst);
+}
+
+TGA_TEST(MeshOptimizer_OverdrawKeepsOrderPastThreshold)
+{
+	TestMesh mesh;
+	AddBox(mesh, 2.0f, 4);
+	AddBox(mesh, 10.0f, 4);
+	MeshOptimizer::OptimizeVertexCache(mesh.Indices.data(), mesh.Indices.size(), mesh.Vertices.size());
+
+	// No reorder can halve the ACMR, so the result has to be thrown away and the input kept as it was.
+	const std::vector<unsigned int> indicesBefore = mesh.Indices;
+	const VertexCacheStatistics before = MeshOptimizer::AnalyzeVertexCache(mesh.Indices.data(), mesh.Indices.size(), mesh.Vertices.size());
+	MeshOptimizer::OptimizeOverdraw(mesh.Indices.data(), mesh.Indices.size(), GetPositions(mesh), sizeof(TestVertex), mesh.Vertices.size(), 0.5f);
+
+	TGA_CHECK(mesh.Indices == indicesBefore);
+	TGA_CHECK(MeshOptimizer::AnalyzeVertexCache(mesh.Indices.data(), mesh.Indices.size(), mesh.Vertices.size()).ACMR == before.ACMR);
+}
+
+TGA_TEST(MeshOptimizer_VertexFetchRemapsInFirstUseOrder)
+{
+	TestMesh mesh = CreateShuffledGrid(16);
+	MeshOptimizer::OptimizeVertexCache(mesh.Indices.data(), mesh.Indices.size(), mesh.Vertices.size());
+
+	// Drop the last row of triangles so the vertices along the edge are no longer referenced.
+	std::vector<unsigned int> indices;
+	for (size_t i = 0; i < mesh.Indices.size(); i += 3)
+	{
+		const bool isOnEdge = mesh.Vertices[mesh.Indices[i]].Position[1] == 100.0f ||
+			mesh.Vertices[mesh.Indices[i + 1]].Position[1] == 100.0f ||
+			mesh.Vertices[mesh.Indices[i + 2]].Position[1] == 100.0f;
+		if (!isOnEdge)
+		{
+			indices.insert(indices.end(), mesh.Indices.begin() + static_cast<std::ptrdiff_t>(i), mesh.Indices.begin() + static_cast<std::ptrdiff_t>(i + 3));
+		}
+	}
+	mesh.Indices = indices;
+
+	const std::vector<Triangle> trianglesBefore = GetTriangles(mesh.Vertices, mesh.Indices);
+
+	std::vector<uint8_t> vertexData(sizeof(TestVertex) * mesh.Vertices.size());
+	memcpy(vertexData.data(), mesh.Vertices.data(), vertexData.size());
+	const size_t vertexCount = MeshOptimizer::OptimizeVertexFetch(vertexData, sizeof(TestVertex), mesh.Indices.data(), mesh.Indices.size());
+
+	// 17 x 17 vertices, minus the top row of 17.
+	TGA_CHECK(vertexCount == 17 * 16);
+	TGA_CHECK(vertexData.size() == sizeof(TestVertex) * vertexCount);
+
+	std::vector<TestVertex> vertices(vertexCount);
+	memcpy(vertices.data(), vertexData.data(), vertexData.size());
+	TGA_CHECK(GetTriangles(vertices, mesh.Indices) == trianglesBefore);
+
+	// Every index is either one seen before or the next new vertex.
+	unsigned int nextVertex = 0;
+	bool isFirstUseOrder = true;
+	for (unsigned int index : mesh.Indices)
+	{
+		isFirstUseOrder &= index <= nextVertex;
+		if (index == nextVertex)
+		{
+			nextVertex++;
+		}
+	}
+	TGA_CHECK(isFirstUseOrder && nextVertex == vertexCount);
+
+	// The remap moves whole vertices, nothing gets mixed up between them.
+	bool isEachVertexIntact = true;
+	for (const TestVertex& vertex : vertices)
+	{
+		const TestVertex& original = mesh.Vertices[vertex.Id];
+		isEachVertexIntact &= memcmp(&vertex, &original, sizeof(TestVertex)) == 0;
+	}
+	TGA_CHECK(isEachVertexIntact);
+}
@@ -0,0 +1,352 @@
+#include "TestFramework.h"
+
+#include <tge/model/ModelCooker.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <vector>
+
+using namespace Tga;
+
+namespace
+{
+	constexpr uint32_t GridSize = 16;
+
+	// A wavy grid, so the simplifier has something to do and the LODs actually get generated.
+	TGA::FBX::Mesh::Element CreateGridElement(const char* aName, unsigned int aMaterialIndex, float anOffset)
+	{
+		TGA::FBX::Mesh::Element element;
+		element.MeshName = aName;
+		element.MaterialIndex = aMaterialIndex;
+
+		for (uint32_t y = 0; y <= GridSize; y++)
+		{
+			for (uint32_t x = 0; x <= GridSize; x++)
+			{
+				TGA::FBX::Vertex vertex;
+				vertex.Position[0] = anOffset + static_cast<float>(x) * 10.0f;
+				vertex.Position[1] = static_cast<float>((x * 7 + y * 3) % 5);
+				vertex.Position[2] = static_cast<float>(y) * 10.0f;
+				vertex.Normal[1] = 1.0f;
+				vertex.UVs[0][0] = static_cast<float>(x) / static_cast<float>(GridSize);
+				vertex.UVs[0][1] = static_cast<float>(y) / static_cast<float>(GridSize);
+				element.Vertices.push_back(vertex);
+			}
+		}
+
+		for (uint32_t y = 0; y < GridSize; y++)
+		{
+			for (uint32_t x = 0; x < GridSize; x++)
+			{
+				const unsigned int corner = y * (GridSize + 1) + x;
+				element.Indices.insert(element.Indices.end(), { corner, corner + GridSize + 1, corner + 1 });
+				element.Indices.insert(element.Indices.end(), { corner + 1, corner + GridSize + 1, corner + GridSize + 2 });
+			}
+		}
+
+		return element;
+	}
+
+	TGA::FBX::Mesh CreateMesh()
+	{
+		TGA::FBX::Mesh mesh;
+		mesh.Elements.push_back(CreateGridElement("Floor", 1, 0.0f));
+		mesh.Elements.push_back(CreateGridElement("Roof", 0, 500.0f));
+		mesh.Materials.resize(2);
+		mesh.Materials[0].MaterialName = "Tiles";
+		mesh.Materials[1].MaterialName = "Stone";
+
+		const char* boneNames[] = { "Root", "Spine", "Head" };
+		for (int b = 0; b < 3; b++)
+		{
+			TGA::FBX::Skeleton::Bone bone;
+			bone.Name = boneNames[b];
+			bone.ParentIdx = b - 1;
+			if (b < 2)
+			{
+				bone.Children.push_back(static_cast<unsigned int>(b + 1));
+			}
+			for (int i = 0; i < 16; i++)
+			{
+				bone.BindPoseInverse.Data[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+			}
+			mesh.Skeleton.Bones.push_back(bone);
+		}
+		return mesh;
+	}
+
+	typedef std::array<float, 9> Triangle;
+
+	// Rotates each triangle so it starts at its smallest corner, the optimizers may rotate them but must keep the winding.
+	std::vector<Triangle> GetTriangles(const std::vector<Vector3f>& somePositions, const unsigned int* someIndices, size_t anIndexCount)
+	{
+		std::vector<Triangle> triangles;
+		for (size_t i = 0; i + 2 < anIndexCount; i += 3)
+		{
+			std::array<Vector3f, 3> corners = { somePositions[someIndices[i]], somePositions[someIndices[i + 1]], somePositions[someIndices[i + 2]] };
+			auto isLess = [](const Vector3f& aFirst, const Vector3f& aSecond)
+			{
+				return std::tie(aFirst.X, aFirst.Y, aFirst.Z) < std::tie(aSecond.X, aSecond.Y, aSecond.Z);
+			};
+			std::rotate(corners.begin(), std::min_element(corners.begin(), corners.end(), isLess), corners.end());
+
+			Triangle triangle;
+			for (int c = 0; c < 3; c++)
+			{
+				triangle[c * 3 + 0] = corners[c].X;
+				triangle[c * 3 + 1] = corners[c].Y;
+				triangle[c * 3 + 2] = corners[c].Z;
+			}
+			triangles.push_back(triangle);
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	std::vector<Vector3f> GetPositions(const TGA::FBX::Mesh::Element& anElement)
+	{
+		std::vector<Vector3f> positions;
+		for (const TGA::FBX::Vertex& vertex : anElement.Vertices)
+		{
+			positions.push_back({ vertex.Position[0], vertex.Position[1], vertex.Position[2] });
+		}
+		return positions;
+	}
+
+	std::vector<Vector3f> GetPositions(const CookedModelView::Element& anElement)
+	{
+		std::vector<Vertex> vertices(anElement.NumberOfVertices);
+		anElement.Layout.DecodeVertices(anElement.VertexData, vertices.size(), vertices.data());
+
+		std::vector<Vector3f> positions;
+		for (const Vertex& vertex : vertices)
+		{
+			positions.push_back({ vertex.Position.x, vertex.Position.y, vertex.Position.z });
+		}
+		return positions;
+	}
+
+	std::vector<uint8_t> CookMesh()
+	{
+		std::vector<uint8_t> data;
+		const bool isCooked = ModelCooker::Cook(CreateMesh(), { 1234, 5678 }, data);
+		TGA_CHECK(isCooked);
+		return data;
+	}
+
+	size_t GetOffset(const std::vector<uint8_t>& someData, const void* aPointer)
+	{
+		return static_cast<size_t>(static_cast<const uint8_t*>(aPointer) - someData.data());
+	}
+
+	bool CanParse(const std::vector<uint8_t>& someData)
+	{
+		CookedModelView view;
+		return ModelCooker::Parse(someData.data(), someData.size(), view);
+	}
+}
+
+TGA_TEST(ModelCooker_RoundTripsThroughParse)
+{
+	const TGA::FBX::Mesh mesh = CreateMesh();
+	const std::vector<uint8_t> data = CookMesh();
+
+	CookedModelView view;
+	TGA_CHECK(ModelCooker::Parse(data.data(), data.size(), view));
+	TGA_CHECK(view.SourceKey.Timestamp == 1234 && view.SourceKey.Hash == 5678);
+	TGA_CHECK(view.Elements.size() == 2);
+	if (view.Elements.size() != 2)
+	{
+		return;
+	}
+
+	TGA_CHECK(strcmp(view.Elements[0].Name, "Floor") == 0 && strcmp(view.Elements[0].MaterialName, "Stone") == 0);
+	TGA_CHECK(strcmp(view.Elements[1].Name, "Roof") == 0 && strcmp(view.Elements[1].MaterialName, "Tiles") == 0);
+
+	for (size_t e = 0; e < view.Elements.size(); e++)
+	{
+		const CookedModelView::Element& element = view.Elements[e];
+		TGA_CHECK(element.Layout.Has(VertexAttribute::Position) && element.Layout.Has(VertexAttribute::Normal) && element.Layout.Has(VertexAttribute::UV0));
+		TGA_CHECK(!element.Layout.Has(VertexAttribute::Skin));
+		TGA_CHECK(element.NumberOfVertices == (GridSize + 1) * (GridSize + 1));
+
+		// LOD 0 is the full mesh, reordered but with every triangle intact.
+		TGA_CHECK(!element.LODs.empty());
+		if (element.LODs.empty())
+		{
+			continue;
+		}
+		TGA_CHECK(element.LODs[0].StartIndex == 0 && element.LODs[0].NumberOfIndices == mesh.Elements[e].Indices.size());
+		TGA_CHECK(GetTriangles(GetPositions(element), element.Indices, element.LODs[0].NumberOfIndices) ==
+			GetTriangles(GetPositions(mesh.Elements[e]), mesh.Elements[e].Indices.data(), mesh.Elements[e].Indices.size()));
+
+		TGA_CHECK(element.LODs.size() > 1);
+		for (size_t lod = 1; lod < element.LODs.size(); lod++)
+		{
+			TGA_CHECK(element.LODs[lod].NumberOfIndices < element.LODs[lod - 1].NumberOfIndices);
+			TGA_CHECK(element.LODs[lod].StartIndex == element.LODs[lod - 1].StartIndex + element.LODs[lod - 1].NumberOfIndices);
+		}
+	}
+
+	TGA_CHECK(view.Joints.size() == 3);
+	if (view.Joints.size() == 3)
+	{
+		TGA_CHECK(strcmp(view.Joints[0].Name, "Root") == 0 && view.Joints[0].Parent == -1);
+		TGA_CHECK(strcmp(view.Joints[2].Name, "Head") == 0 && view.Joints[2].Parent == 1 && view.Joints[2].NumberOfChildren == 0);
+		TGA_CHECK(view.Joints[1].NumberOfChildren == 1 && view.Joints[1].Children[0] == 2);
+	}
+}
+
+TGA_TEST(ModelCooker_BoundsFitVerticesAwayFromOrigin)
+{
+	// Entirely on the positive side of every axis, the origin must not end up inside the box.
+	std::vector<Vertex> vertices(2);
+	vertices[0].Position = { 100.0f, 10.0f, 1000.0f, 1.0f };
+	vertices[1].Position = { 110.0f, 30.0f, 1040.0f, 1.0f };
+
+	const BoxSphereBounds bounds = ModelCooker::CalculateBoxSphereBounds(vertices.data(), vertices.size());
+	TGA_CHECK(bounds.Center.X == 105.0f && bounds.Center.Y == 20.0f && bounds.Center.Z == 1020.0f);
+	TGA_CHECK(bounds.BoxExtents.X == 5.0f && bounds.BoxExtents.Y == 10.0f && bounds.BoxExtents.Z == 20.0f);
+	TGA_CHECK(std::fabs(bounds.Radius - std::sqrt(5.0f * 5.0f + 10.0f * 10.0f + 20.0f * 20.0f)) < 1e-4f);
+
+	const BoxSphereBounds point = ModelCooker::CalculateBoxSphereBounds(vertices.data(), 1);
+	TGA_CHECK(point.Center.X == 100.0f && point.BoxExtents.X == 0.0f && point.Radius == 0.0f);
+
+	const BoxSphereBounds empty = ModelCooker::CalculateBoxSphereBounds(vertices.data(), 0);
+	TGA_CHECK(empty.Center.X == 0.0f && empty.BoxExtents.X == 0.0f && empty.Radius == 0.0f);
+
+	// The cooked elements carry the same tight bounds, the second grid starts 500 units out along X.
+	const std::vector<uint8_t> data = CookMesh();
+	CookedModelView view;
+	TGA_CHECK(ModelCooker::Parse(data.data(), data.size(), view) && view.Elements.size() == 2);
+	if (view.Elements.size() == 2)
+	{
+		const BoxSphereBounds& roof = view.Elements[1].Bounds;
+		TGA_CHECK(roof.Center.X == 500.0f + GridSize * 5.0f && roof.BoxExtents.X == GridSize * 5.0f);
+		TGA_CHECK(roof.Center.Z == GridSize * 5.0f && roof.BoxExtents.Z == GridSize * 5.0f);
+	}
+}
+
+TGA_TEST(ModelCooker_ParseRejectsTruncatedBlobs)
+{
+	const std::vector<uint8_t> data = CookMesh();
+	TGA_CHECK(CanParse(data));
+
+	bool isAnyTruncationParsed = false;
+	for (size_t size = 0; size < data.size(); size++)
+	{
+		const std::vector<uint8_t> truncated(data.begin(), data.begin() + size);
+		isAnyTruncationParsed |= CanParse(truncated);
+	}
+	TGA_CHECK(!isAnyTruncationParsed);
+
+	// Padding the blob doesn't make it valid either, the header knows its size.
+	std::vector<uint8_t> padded = data;
+	padded.resize(data.size() + 16);
+	TGA_CHECK(!CanParse(padded));
+}
+
+TGA_TEST(ModelCooker_ParseRejectsCorruptBlobs)
+{
+	const std::vector<uint8_t> data = CookMesh();
+	CookedModelView view;
+	if (!ModelCooker::Parse(data.data(), data.size(), view) || view.Elements.empty() || view.Joints.size() < 2)
+	{
+		TGA_CHECK(false);
+		return;
+	}
+
+	const CookedModelView::Element& element = view.Elements[0];
+	const size_t indexOffset = GetOffset(data, element.Indices);
+
+	// The version sits right after the magic.
+	{
+		std::vector<uint8_t> corrupt = data;
+		corrupt[4]++;
+		TGA_CHECK(!CanParse(corrupt));
+	}
+
+	// An index just past the last vertex.
+	{
+		std::vector<uint8_t> corrupt = data;
+		const unsigned int index = element.NumberOfVertices;
+		memcpy(corrupt.data() + indexOffset + sizeof(unsigned int) * 7, &index, sizeof(unsigned int));
+		TGA_CHECK(!CanParse(corrupt));
+	}
+
+	// The LOD table follows the indices, 16 byte aligned. Move LOD 1 so it ends past the index buffer, then so it splits a triangle.
+	{
+		const size_t lodOffset = (indexOffset + sizeof(unsigned int) * element.NumberOfIndices + 15) & ~size_t(15);
+		const size_t lodSize = sizeof(uint32_t) * 4;
+		uint32_t lodStart = 0;
+		memcpy(&lodStart, data.data() + lodOffset + lodSize, sizeof(uint32_t));
+		TGA_CHECK(lodStart == element.LODs[1].StartIndex);
+
+		std::vector<uint8_t> corrupt = data;
+		const uint32_t pastEnd = element.NumberOfIndices - element.LODs[1].NumberOfIndices + 3;
+		memcpy(corrupt.data() + lodOffset + lodSize, &pastEnd, sizeof(uint32_t));
+		TGA_CHECK(!CanParse(corrupt));
+
+		corrupt = data;
+		const uint32_t unaligned = lodStart + 1;
+		memcpy(corrupt.data() + lodOffset + lodSize, &unaligned, sizeof(uint32_t));
+		TGA_CHECK(!CanParse(corrupt));
+	}
+
+	// The parent follows the bind pose of each joint.
+	{
+		const size_t parentOffset = GetOffset(data, view.Joints[1].BindPoseInverse) + sizeof(float) * 16;
+		int32_t parent = 0;
+		memcpy(&parent, data.data() + parentOffset, sizeof(int32_t));
+		TGA_CHECK(parent == 0);
+
+		std::vector<uint8_t> corrupt = data;
+		const int32_t pastEnd = static_cast<int32_t>(view.Joints.size());
+		memcpy(corrupt.data() + parentOffset, &pastEnd, sizeof(int32_t));
+		TGA_CHECK(!CanParse(corrupt));
+	}
+
+	// A child that isn't a joint.
+	{
+		std::vector<uint8_t> corrupt = data;
+		const unsigned int child = static_cast<unsigned int>(view.Joints.size());
+		memcpy(corrupt.data() + GetOffset(data, view.Joints[0].Children), &child, sizeof(unsigned int));
+		TGA_CHECK(!CanParse(corrupt));
+	}
+}
+
+TGA_TEST(ModelCooker_RejectsBonesPastCompactLayout)
+{
+	TGA::FBX::Mesh mesh;
+	mesh.Elements.push_back(CreateGridElement("Arm", 0, 0.0f));
+	mesh.Materials.resize(1);
+	for (TGA::FBX::Vertex& vertex : mesh.Elements[0].Vertices)
+	{
+		vertex.BoneIDs[0] = VertexLayout::MaxBones - 1;
+		vertex.BoneWeights[0] = 1.0f;
+	}
+
+	std::vector<uint8_t> data;
+	ModelCookReport report;
+	TGA_CHECK(ModelCooker::Cook(mesh, {}, data, ModelCookSettings(), &report));
+	TGA_CHECK(report.Error.empty());
+
+	CookedModelView view;
+	TGA_CHECK(ModelCooker::Parse(data.data(), data.size(), view) && view.Elements.size() == 1);
+	if (view.Elements.size() == 1)
+	{
+		Vertex vertex;
+		view.Elements[0].Layout.Decode(view.Elements[0].VertexData, vertex);
+		TGA_CHECK(vertex.Bones.x == static_cast<float>(VertexLayout::MaxBones - 1) && vertex.Weights.x == 1.0f);
+	}
+
+	// Even with no weight on it, the index would be truncated to another joint.
+	mesh.Elements[0].Vertices[5].BoneIDs[3] = VertexLayout::MaxBones;
+	report = ModelCookReport();
+	TGA_CHECK(!ModelCooker::Cook(mesh, {}, data, ModelCookSettings(), &report));
+	TGA_CHECK(!report.Error.empty());
+}
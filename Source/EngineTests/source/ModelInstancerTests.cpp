@@ -0,0 +1,220 @@
+#include "TestFramework.h"
+#include "TestDevice.h"
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <d3d11.h>
+
+#include <tge/graphics/DX11RenderBackend.h>
+#include <tge/math/Transform.h>
+#include <tge/model/Model.h>
+#include <tge/model/ModelInstancer.h>
+#include <tge/render/RenderCommandBuffer.h>
+
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace Tga;
+
+namespace
+{
+	// Large enough that a full upload is clearly more expensive than writing the dirty ranges.
+	constexpr uint32_t InstanceCount = 100000;
+
+	std::shared_ptr<Model> CreateBoxModel()
+	{
+		Model::MeshData meshData = {};
+		meshData.Bounds.Center = Vector3f::Zero;
+		meshData.Bounds.BoxExtents = { 50.0f, 50.0f, 50.0f };
+		meshData.Bounds.Radius = meshData.Bounds.BoxExtents.Length();
+
+		std::shared_ptr<Model> model = std::make_shared<Model>();
+		model->Init(meshData, L"Box");
+		return model;
+	}
+
+	Transform RandomTransform(std::mt19937& aRandom)
+	{
+		std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+		std::uniform_real_distribution<float> angle(-180.0f, 180.0f);
+		return Transform({ position(aRandom), position(aRandom), position(aRandom) }, Rotator(angle(aRandom), angle(aRandom), angle(aRandom)));
+	}
+
+	// Checks that every command is a range write into one buffer and returns them.
+	std::vector<RenderCommand::WriteBufferData> GetRangeWrites(const RenderCommandBuffer& someCommands)
+	{
+		std::vector<RenderCommand::WriteBufferData> writes;
+		for (size_t i = 0; i < someCommands.GetCommandCount(); i++)
+		{
+			const RenderCommand& command = someCommands.GetCommands()[i];
+			TGA_CHECK(command.Type == RenderCommandType::WriteBuffer);
+			if (command.Type == RenderCommandType::WriteBuffer)
+			{
+				TGA_CHECK(!command.WriteBuffer.Discard && !command.WriteBuffer.NoOverwrite);
+				writes.push_back(command.WriteBuffer);
+			}
+		}
+		return writes;
+	}
+}
+
+TGA_TEST(ModelInstancer_RecordsDirtyRangesAsBufferWrites)
+{
+	if (!Tests::CreateTestDevice())
+	{
+		return;
+	}
+
+	constexpr uint32_t MatrixSize = sizeof(Matrix4x4f);
+	std::mt19937 random(11);
+
+	ModelInstancer instancer;
+	instancer.Init(CreateBoxModel());
+	std::vector<ModelInstanceHandle> handles;
+	for (uint32_t i = 0; i < InstanceCount; i++)
+	{
+		handles.push_back(instancer.AddInstance(RandomTransform(random)));
+	}
+
+	// A new buffer is written as a whole.
+	RenderCommandBuffer commands;
+	instancer.RebuildInstances(commands);
+	std::vector<RenderCommand::WriteBufferData> writes = GetRangeWrites(commands);
+	TGA_CHECK(writes.size() == 1);
+	TGA_CHECK(writes.size() == 1 && writes[0].DestinationOffset == 0 && writes[0].Size == InstanceCount * MatrixSize);
+	commands.Clear();
+
+	// Slots further apart than the merge gap get a write each, close ones share one.
+	const Transform moved({ 1.0f, 2.0f, 3.0f }, Rotator(10.0f, 20.0f, 30.0f));
+	instancer.SetInstanceTransform(handles[10], moved);
+	instancer.SetInstanceTransform(handles[12], moved);
+	instancer.SetInstanceTransform(handles[500], moved);
+	instancer.RebuildInstances(commands);
+	writes = GetRangeWrites(commands);
+	TGA_CHECK(writes.size() == 2);
+	if (writes.size() == 2)
+	{
+		TGA_CHECK(writes[0].DestinationOffset == 10 * MatrixSize && writes[0].Size == 3 * MatrixSize);
+		TGA_CHECK(writes[1].DestinationOffset == 500 * MatrixSize && writes[1].Size == MatrixSize);
+
+		const Matrix4x4f expected = moved.GetMatrix();
+		TGA_CHECK(std::memcmp(commands.GetPayload(writes[1].PayloadOffset), &expected, MatrixSize) == 0);
+	}
+	commands.Clear();
+
+	// Nothing changed, nothing to write.
+	instancer.RebuildInstances(commands);
+	TGA_CHECK(commands.IsEmpty());
+}
+
+TGA_TEST(ModelInstancer_RemovalKeepsOtherHandlesStable)
+{
+	if (!Tests::CreateTestDevice())
+	{
+		return;
+	}
+
+	constexpr uint32_t MatrixSize = sizeof(Matrix4x4f);
+	auto transformAt = [](uint32_t anIndex) { return Transform(Vector3f(static_cast<float>(anIndex), 0.0f, 0.0f)); };
+
+	ModelInstancer instancer;
+	instancer.Init(CreateBoxModel());
+	std::vector<ModelInstanceHandle> handles;
+	for (uint32_t i = 0; i < InstanceCount; i++)
+	{
+		handles.push_back(instancer.AddInstance(transformAt(i)));
+	}
+
+	RenderCommandBuffer commands;
+	instancer.RebuildInstances(commands);
+	commands.Clear();
+
+	// The last instance moves into the freed slot and is the only thing written, its handle follows it.
+	const uint32_t last = InstanceCount - 1;
+	TGA_CHECK(instancer.RemoveInstance(handles[10]));
+	TGA_CHECK(!instancer.IsValid(handles[10]) && instancer.GetInstanceTransform(handles[10]) == nullptr);
+	TGA_CHECK(!instancer.RemoveInstance(handles[10]));
+	TGA_CHECK(instancer.IsValid(handles[last]) && instancer.GetInstanceTransform(handles[last])->GetPosition().X == static_cast<float>(last));
+	TGA_CHECK(instancer.GetInstanceTransform(handles[11])->GetPosition().X == 11.0f);
+
+	instancer.RebuildInstances(commands);
+	std::vector<RenderCommand::WriteBufferData> writes = GetRangeWrites(commands);
+	TGA_CHECK(writes.size() == 1);
+	if (writes.size() == 1)
+	{
+		TGA_CHECK(writes[0].DestinationOffset == 10 * MatrixSize && writes[0].Size == MatrixSize);
+		const Matrix4x4f expected = transformAt(last).GetMatrix();
+		TGA_CHECK(std::memcmp(commands.GetPayload(writes[0].PayloadOffset), &expected, MatrixSize) == 0);
+	}
+	commands.Clear();
+
+	// A new instance reuses the freed handle index, but the old handle stays invalid.
+	const ModelInstanceHandle added = instancer.AddInstance(transformAt(InstanceCount));
+	TGA_CHECK(added.Index == handles[10].Index && added.Generation != handles[10].Generation);
+	TGA_CHECK(instancer.IsValid(added) && !instancer.IsValid(handles[10]));
+	TGA_CHECK(instancer.GetInstanceTransform(added)->GetPosition().X == static_cast<float>(InstanceCount));
+
+	instancer.RebuildInstances(commands);
+	writes = GetRangeWrites(commands);
+	TGA_CHECK(writes.size() == 1 && writes[0].DestinationOffset == last * MatrixSize && writes[0].Size == MatrixSize);
+	commands.Clear();
+
+	// Removing the instance in the last slot moves nothing, so there is nothing to upload either.
+	TGA_CHECK(instancer.RemoveInstance(added));
+	instancer.RebuildInstances(commands);
+	TGA_CHECK(commands.IsEmpty());
+	TGA_CHECK(instancer.GetInstanceTransform(handles[last])->GetPosition().X == static_cast<float>(last));
+}
+
+TGA_BENCHMARK(ModelInstancer_RebuildInstances)
+{
+	if (!Tests::CreateTestDevice())
+	{
+		return;
+	}
+
+	std::mt19937 random(1);
+
+	ModelInstancer instancer;
+	instancer.Init(CreateBoxModel());
+	instancer.Reserve(InstanceCount);
+
+	std::vector<ModelInstanceHandle> handles;
+	std::vector<Transform> transforms;
+	for (size_t i = 0; i < InstanceCount; i++)
+	{
+		transforms.push_back(RandomTransform(random));
+		handles.push_back(instancer.AddInstance(transforms.back()));
+	}
+
+	// Executed on the device like the engine does, so the numbers include the copy into the instance buffer.
+	DX11RenderBackend backend;
+	RenderCommandBuffer commands;
+	auto rebuild = [&]()
+	{
+		instancer.RebuildInstances(commands);
+		backend.Execute(commands);
+		commands.Clear();
+	};
+
+	Tests::Benchmark("all instances moved", [&]()
+	{
+		for (size_t i = 0; i < InstanceCount; i++)
+		{
+			instancer.SetInstanceTransform(handles[i], transforms[i]);
+		}
+		rebuild();
+	}, InstanceCount);
+
+	Tests::Benchmark("1% of the instances moved", [&]()
+	{
+		for (size_t i = 0; i < InstanceCount; i += 100)
+		{
+			instancer.SetInstanceTransform(handles[i], transforms[i]);
+		}
+		rebuild();
+	}, InstanceCount / 100);
+}
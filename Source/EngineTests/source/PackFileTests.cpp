@@ -0,0 +1,338 @@
+#include "TestFramework.h"
+#include "TestFiles.h"
+
+#include <tge/filesystem/FileView.h>
+#include <tge/filesystem/LZ4.h>
+#include <tge/filesystem/PackFile.h>
+#include <tge/filesystem/PackWriter.h>
+#include <tge/filesystem/VirtualFileSystem.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <string>
+
+using namespace Tga;
+namespace fs = std::filesystem;
+
+namespace
+{
+	std::string CreateNoise(size_t aSize)
+	{
+		std::string data(aSize, '\0');
+		uint32_t state = 1;
+		for (char& value : data)
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			value = static_cast<char>(state >> 24);
+		}
+		return data;
+	}
+
+	std::string CreateText(size_t aSize)
+	{
+		std::string data;
+		for (int line = 0; data.size() < aSize; line++)
+		{
+			data += "Line " + std::to_string(line % 100) + " of the text.\n";
+		}
+		data.resize(aSize);
+		return data;
+	}
+
+	// Files for a pack, at least one of them compresses.
+	void WriteSources(const Tests::TempDirectory& aDirectory)
+	{
+		Tests::WriteFile(aDirectory.GetPath("Source/Empty.txt"), "");
+		Tests::WriteFile(aDirectory.GetPath("Source/Noise.bin"), CreateNoise(5000));
+		Tests::WriteFile(aDirectory.GetPath("Source/Text.txt"), CreateText(1000));
+		Tests::WriteFile(aDirectory.GetPath("Source/Sub/Large.txt"), CreateText(200000));
+	}
+
+	bool Pack(const Tests::TempDirectory& aDirectory, const std::string& aPackPath, bool aCompress, PackWriterReport& outReport)
+	{
+		PackWriterSettings settings;
+		settings.myCompress = aCompress;
+		return PackWriter::PackDirectory(fs::u8path(aDirectory.GetPath("Source")).wstring(), fs::u8path(aPackPath).wstring(), settings, outReport);
+	}
+
+	std::string Read(const PackFile& aPack, const PackEntry& anEntry)
+	{
+		std::string data(static_cast<size_t>(anEntry.mySize), '\0');
+		if (anEntry.myCompression == PackCompression::None)
+		{
+			memcpy(data.data(), aPack.GetData(anEntry), data.size());
+		}
+		else if (!LZ4::Decompress(aPack.GetData(anEntry), static_cast<size_t>(anEntry.myStoredSize), reinterpret_cast<uint8_t*>(data.data()), data.size()))
+		{
+			return "<corrupt>";
+		}
+		return data;
+	}
+
+	bool Open(PackFile& outPack, const std::string& aPath)
+	{
+		return outPack.Open(fs::u8path(aPath).wstring());
+	}
+
+	PackHeader GetHeader(const std::string& aPack)
+	{
+		PackHeader header;
+		memcpy(&header, aPack.data(), sizeof(header));
+		return header;
+	}
+
+	/**
+	 * Writes aPack to aPath with aChange made to its header.
+	 */
+	void WriteWithHeader(const std::string& aPath, std::string aPack, const std::function<void(PackHeader&)>& aChange)
+	{
+		PackHeader header = GetHeader(aPack);
+		aChange(header);
+		memcpy(aPack.data(), &header, sizeof(header));
+		Tests::WriteFile(fs::u8path(aPath), aPack);
+	}
+
+	/**
+	 * Writes aPack to aPath with aChange made to the entry with the key aKey.
+	 */
+	void WriteWithEntry(const std::string& aPath, std::string aPack, const std::string& aKey, const std::function<void(PackEntry&)>& aChange)
+	{
+		const PackHeader header = GetHeader(aPack);
+		for (uint32_t i = 0; i < header.myEntryCount; i++)
+		{
+			const size_t offset = sizeof(PackHeader) + i * sizeof(PackEntry);
+			PackEntry entry;
+			memcpy(&entry, aPack.data() + offset, sizeof(entry));
+			if (aKey == aPack.c_str() + header.myNamesOffset + entry.myNameOffset)
+			{
+				aChange(entry);
+				memcpy(aPack.data() + offset, &entry, sizeof(entry));
+			}
+		}
+		Tests::WriteFile(fs::u8path(aPath), aPack);
+	}
+}
+
+TGA_TEST(PackFile_RoundTripsStoredFiles)
+{
+	Tests::TempDirectory directory("PackFile_Stored");
+	WriteSources(directory);
+
+	PackWriterReport report;
+	TGA_CHECK(Pack(directory, directory.GetPath("Stored.tgepack"), false, report));
+	TGA_CHECK(report.myError.empty());
+	TGA_CHECK(report.myFileCount == 4);
+	TGA_CHECK(report.myCompressedFileCount == 0);
+	TGA_CHECK(report.myStoredSize == report.mySize);
+
+	PackFile pack;
+	TGA_CHECK(Open(pack, directory.GetPath("Stored.tgepack")));
+	TGA_CHECK(pack.GetEntryCount() == 4);
+
+	// Keys are relative to the packed directory and lower case.
+	const PackEntry* empty = pack.Find("empty.txt");
+	const PackEntry* noise = pack.Find("noise.bin");
+	const PackEntry* large = pack.Find("sub/large.txt");
+	TGA_CHECK(empty && noise && large && pack.Find("text.txt"));
+	TGA_CHECK(!pack.Find("Empty.txt"));
+	TGA_CHECK(!pack.Find("large.txt"));
+	TGA_CHECK(!pack.Find(""));
+	if (!empty || !noise || !large)
+	{
+		return;
+	}
+
+	TGA_CHECK(empty->mySize == 0);
+	TGA_CHECK(Read(pack, *empty).empty());
+	TGA_CHECK(Read(pack, *noise) == CreateNoise(5000));
+	TGA_CHECK(Read(pack, *large) == CreateText(200000));
+
+	// Entries are aligned.
+	bool isEveryEntryAligned = true;
+	for (size_t i = 0; i < pack.GetEntryCount(); i++)
+	{
+		isEveryEntryAligned &= pack.GetEntries()[i].myOffset % 16 == 0;
+	}
+	TGA_CHECK(isEveryEntryAligned);
+}
+
+TGA_TEST(PackFile_RoundTripsCompressedFiles)
+{
+	Tests::TempDirectory directory("PackFile_Compressed");
+	WriteSources(directory);
+
+	PackWriterReport report;
+	TGA_CHECK(Pack(directory, directory.GetPath("Compressed.tgepack"), true, report));
+	TGA_CHECK(report.myFileCount == 4);
+	TGA_CHECK(report.myCompressedFileCount == 2);
+	TGA_CHECK(report.myStoredSize < report.mySize);
+
+	PackFile pack;
+	TGA_CHECK(Open(pack, directory.GetPath("Compressed.tgepack")));
+	const PackEntry* empty = pack.Find("empty.txt");
+	const PackEntry* noise = pack.Find("noise.bin");
+	const PackEntry* text = pack.Find("text.txt");
+	const PackEntry* large = pack.Find("sub/large.txt");
+	TGA_CHECK(empty && noise && text && large);
+	if (!empty || !noise || !text || !large)
+	{
+		return;
+	}
+
+	// Files that don't compress, or have nothing to compress, are stored as is.
+	TGA_CHECK(empty->myCompression == PackCompression::None);
+	TGA_CHECK(noise->myCompression == PackCompression::None);
+	TGA_CHECK(text->myCompression == PackCompression::LZ4);
+	TGA_CHECK(large->myCompression == PackCompression::LZ4);
+
+	TGA_CHECK(Read(pack, *empty).empty());
+	TGA_CHECK(Read(pack, *noise) == CreateNoise(5000));
+	TGA_CHECK(Read(pack, *text) == CreateText(1000));
+	TGA_CHECK(Read(pack, *large) == CreateText(200000));
+
+	// The same files give the same pack.
+	TGA_CHECK(Pack(directory, directory.GetPath("Again.tgepack"), true, report));
+	TGA_CHECK(Tests::ReadFile(fs::u8path(directory.GetPath("Again.tgepack"))) == Tests::ReadFile(fs::u8path(directory.GetPath("Compressed.tgepack"))));
+}
+
+TGA_TEST(PackFile_RejectsCorruptHeaders)
+{
+	Tests::TempDirectory directory("PackFile_Headers");
+	WriteSources(directory);
+	PackWriterReport report;
+	TGA_CHECK(Pack(directory, directory.GetPath("Valid.tgepack"), false, report));
+	const std::string valid = Tests::ReadFile(fs::u8path(directory.GetPath("Valid.tgepack")));
+	const std::string corrupt = directory.GetPath("Corrupt.tgepack");
+	PackFile pack;
+
+	TGA_CHECK(!Open(pack, directory.GetPath("Missing.tgepack")));
+
+	Tests::WriteFile(fs::u8path(corrupt), "");
+	TGA_CHECK(!Open(pack, corrupt));
+	Tests::WriteFile(fs::u8path(corrupt), valid.substr(0, sizeof(PackHeader) - 1));
+	TGA_CHECK(!Open(pack, corrupt));
+
+	WriteWithHeader(corrupt, valid, [](PackHeader& aHeader) { aHeader.myMagic[3] = 'X'; });
+	TGA_CHECK(!Open(pack, corrupt));
+	WriteWithHeader(corrupt, valid, [](PackHeader& aHeader) { aHeader.myVersion++; });
+	TGA_CHECK(!Open(pack, corrupt));
+
+	// A table of contents or names past the end of the file.
+	WriteWithHeader(corrupt, valid, [](PackHeader& aHeader) { aHeader.myEntryCount = 0x10000000; });
+	TGA_CHECK(!Open(pack, corrupt));
+	WriteWithHeader(corrupt, valid, [](PackHeader& aHeader) { aHeader.myNamesOffset = sizeof(PackHeader); });
+	TGA_CHECK(!Open(pack, corrupt));
+	WriteWithHeader(corrupt, valid, [&](PackHeader& aHeader) { aHeader.myNamesOffset = valid.size() + 1; });
+	TGA_CHECK(!Open(pack, corrupt));
+	WriteWithHeader(corrupt, valid, [&](PackHeader& aHeader) { aHeader.myNamesSize = valid.size(); });
+	TGA_CHECK(!Open(pack, corrupt));
+
+	// Names that don't end in a 0 would be read past their end.
+	WriteWithHeader(corrupt, valid, [](PackHeader& aHeader) { aHeader.myNamesSize--; });
+	TGA_CHECK(!Open(pack, corrupt));
+
+	// The valid pack still opens after all that, so the checks above failed for the right reason.
+	Tests::WriteFile(fs::u8path(corrupt), valid);
+	TGA_CHECK(Open(pack, corrupt));
+}
+
+TGA_TEST(PackFile_RejectsCorruptEntries)
+{
+	Tests::TempDirectory directory("PackFile_Entries");
+	WriteSources(directory);
+	PackWriterReport report;
+	TGA_CHECK(Pack(directory, directory.GetPath("Valid.tgepack"), true, report));
+	const std::string valid = Tests::ReadFile(fs::u8path(directory.GetPath("Valid.tgepack")));
+	const std::string corrupt = directory.GetPath("Corrupt.tgepack");
+	PackFile pack;
+
+	// Cutting the end off leaves the last entry's data out of bounds.
+	Tests::WriteFile(fs::u8path(corrupt), valid.substr(0, valid.size() - 1));
+	TGA_CHECK(!Open(pack, corrupt));
+
+	WriteWithEntry(corrupt, valid, "noise.bin", [&](PackEntry& anEntry) { anEntry.myOffset = valid.size() + 1; });
+	TGA_CHECK(!Open(pack, corrupt));
+	WriteWithEntry(corrupt, valid, "noise.bin", [&](PackEntry& anEntry) { anEntry.myOffset = valid.size() - 16; });
+	TGA_CHECK(!Open(pack, corrupt));
+	WriteWithEntry(corrupt, valid, "text.txt", [](PackEntry& anEntry) { anEntry.myStoredSize = ~0ull; });
+	TGA_CHECK(!Open(pack, corrupt));
+	WriteWithEntry(corrupt, valid, "text.txt", [&](PackEntry& anEntry) { anEntry.myNameOffset = static_cast<uint32_t>(GetHeader(valid).myNamesSize); });
+	TGA_CHECK(!Open(pack, corrupt));
+
+	// Stored entries are used as is, their stored size has to be their size.
+	WriteWithEntry(corrupt, valid, "noise.bin", [](PackEntry& anEntry) { anEntry.mySize++; });
+	TGA_CHECK(!Open(pack, corrupt));
+	WriteWithEntry(corrupt, valid, "text.txt", [](PackEntry& anEntry) { anEntry.myCompression = static_cast<PackCompression>(2); });
+	TGA_CHECK(!Open(pack, corrupt));
+
+	// Find does a binary search, so the hashes have to be sorted.
+	std::string unsorted = valid;
+	const size_t second = sizeof(PackHeader) + sizeof(PackEntry);
+	std::swap_ranges(unsorted.begin() + sizeof(PackHeader), unsorted.begin() + second, unsorted.begin() + second);
+	Tests::WriteFile(fs::u8path(corrupt), unsorted);
+	TGA_CHECK(!Open(pack, corrupt));
+
+	Tests::WriteFile(fs::u8path(corrupt), valid);
+	TGA_CHECK(Open(pack, corrupt));
+}
+
+TGA_TEST(PackFile_VirtualFileSystemRejectsCorruptBlocks)
+{
+	Tests::TempDirectory directory("PackFile_Blocks");
+	WriteSources(directory);
+	PackWriterReport report;
+	TGA_CHECK(Pack(directory, directory.GetPath("Valid.tgepack"), true, report));
+	const std::string valid = Tests::ReadFile(fs::u8path(directory.GetPath("Valid.tgepack")));
+	const std::string corrupt = directory.GetPath("Corrupt.tgepack");
+
+	// The table of contents is fine, the compressed block is cut short, or says it decompresses to more than it does.
+	WriteWithEntry(corrupt, valid, "text.txt", [](PackEntry& anEntry) { anEntry.myStoredSize--; });
+	WriteWithEntry(corrupt, Tests::ReadFile(fs::u8path(corrupt)), "sub/large.txt", [](PackEntry& anEntry) { anEntry.mySize++; });
+
+	const std::string root = directory.GetPath("Assets");
+	VirtualFileSystem fileSystem;
+	TGA_CHECK(fileSystem.MountPack(corrupt, root));
+
+	FileView file;
+	TGA_CHECK(fileSystem.Exists(root + "/Text.txt"));
+	TGA_CHECK(!fileSystem.Open(root + "/Text.txt", file));
+	TGA_CHECK(!file.IsOpen());
+	TGA_CHECK(!fileSystem.Open(root + "/Sub/Large.txt", file));
+	TGA_CHECK(fileSystem.Open(root + "/Noise.bin", file));
+	TGA_CHECK(file.GetSize() == 5000);
+}
+
+TGA_TEST(PackFile_VirtualFileSystemOpensCompressedEntries)
+{
+	Tests::TempDirectory directory("PackFile_Open");
+	WriteSources(directory);
+	PackWriterReport report;
+	TGA_CHECK(Pack(directory, directory.GetPath("Valid.tgepack"), true, report));
+
+	// Other packers may mark an empty entry as compressed, with an empty block.
+	const std::string pack = directory.GetPath("Empty.tgepack");
+	WriteWithEntry(pack, Tests::ReadFile(fs::u8path(directory.GetPath("Valid.tgepack"))), "empty.txt", [](PackEntry& anEntry) { anEntry.myCompression = PackCompression::LZ4; });
+
+	const std::string root = directory.GetPath("Assets");
+	TGA_CHECK(Tests::WriteFile(root + "/Sub/Large.txt", "loose"));
+	VirtualFileSystem fileSystem;
+	fileSystem.MountDirectory(root);
+	TGA_CHECK(fileSystem.MountPack(pack, root));
+
+	FileView file;
+	TGA_CHECK(fileSystem.Open(root + "/Empty.txt", file));
+	TGA_CHECK(file.IsOpen());
+	TGA_CHECK(file.GetSize() == 0);
+
+	TGA_CHECK(fileSystem.Open(root + "/Text.txt", file));
+	TGA_CHECK(std::string(reinterpret_cast<const char*>(file.GetData()), file.GetSize()) == CreateText(1000));
+
+	// Loose files win over compressed entries as well.
+	TGA_CHECK(fileSystem.Open(root + "/Sub/Large.txt", file));
+	TGA_CHECK(std::string(reinterpret_cast<const char*>(file.GetData()), file.GetSize()) == "loose");
+}
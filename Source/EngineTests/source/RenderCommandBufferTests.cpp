@@ -0,0 +1,140 @@
+#include "TestFramework.h"
+
+#include <tge/render/RenderCommandBuffer.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+using namespace Tga;
+
+namespace
+{
+	// Never dereferenced, the command buffer only stores the pointers.
+	char ourBufferStorage[2];
+	ID3D11Buffer* const ourFirstBuffer = reinterpret_cast<ID3D11Buffer*>(&ourBufferStorage[0]);
+	ID3D11Buffer* const ourSecondBuffer = reinterpret_cast<ID3D11Buffer*>(&ourBufferStorage[1]);
+
+	std::vector<uint8_t> CreatePattern(size_t aSize, uint8_t aSeed)
+	{
+		std::vector<uint8_t> pattern(aSize);
+		for (size_t i = 0; i < aSize; i++)
+		{
+			pattern[i] = static_cast<uint8_t>(aSeed + i * 7);
+		}
+		return pattern;
+	}
+}
+
+TGA_TEST(RenderCommandBuffer_WriteBufferKeepsAlignedPayload)
+{
+	RenderCommandBuffer commands;
+
+	// Enough writes of odd sizes to make the payload grow a few times.
+	std::vector<std::vector<uint8_t>> patterns;
+	for (size_t i = 0; i < 100; i++)
+	{
+		patterns.push_back(CreatePattern(1 + i * 37, static_cast<uint8_t>(i)));
+		void* payload = commands.WriteBuffer(ourFirstBuffer, patterns.back().size(), false, static_cast<uint32_t>(i * 16));
+		TGA_CHECK((reinterpret_cast<uintptr_t>(payload) & 15) == 0);
+		std::memcpy(payload, patterns.back().data(), patterns.back().size());
+	}
+
+	TGA_CHECK(commands.GetCommandCount() == patterns.size());
+	for (size_t i = 0; i < commands.GetCommandCount(); i++)
+	{
+		const RenderCommand::WriteBufferData& write = commands.GetCommands()[i].WriteBuffer;
+		TGA_CHECK(write.Buffer == ourFirstBuffer && write.Size == patterns[i].size() && write.DestinationOffset == i * 16);
+		TGA_CHECK(std::memcmp(commands.GetPayload(write.PayloadOffset), patterns[i].data(), patterns[i].size()) == 0);
+	}
+
+	// Clear keeps the allocation, so the same writes again don't grow anything.
+	const size_t payloadSize = commands.GetPayloadSize();
+	commands.Clear();
+	TGA_CHECK(commands.IsEmpty() && commands.GetPayloadSize() == 0);
+	for (const std::vector<uint8_t>& pattern : patterns)
+	{
+		commands.WriteBuffer(ourFirstBuffer, pattern.data(), pattern.size(), false);
+	}
+	TGA_CHECK(commands.GetPayloadSize() == payloadSize);
+}
+
+TGA_TEST(RenderCommandBuffer_TrimLastWrite)
+{
+	RenderCommandBuffer commands;
+	commands.WriteBuffer(ourFirstBuffer, 1024);
+	commands.TrimLastWrite(100);
+	TGA_CHECK(commands.GetCommandCount() == 1 && commands.GetCommands()[0].WriteBuffer.Size == 100);
+	TGA_CHECK(commands.GetPayloadSize() == 112);
+
+	// Trimming to nothing drops the write and its payload.
+	commands.WriteBuffer(ourSecondBuffer, 1024);
+	commands.TrimLastWrite(0);
+	TGA_CHECK(commands.GetCommandCount() == 1 && commands.GetPayloadSize() == 112);
+	TGA_CHECK(commands.GetPacketCount() == 1 && commands.GetPackets()[0].CommandCount == 1);
+}
+
+TGA_TEST(RenderCommandBuffer_AppendPacketsMovesPayload)
+{
+	const std::vector<uint8_t> first = CreatePattern(48, 1);
+	const std::vector<uint8_t> second = CreatePattern(20, 2);
+
+	RenderCommandBuffer source;
+	source.BeginPacket(5);
+	source.WriteBuffer(ourFirstBuffer, first.data(), first.size());
+	source.Draw(3);
+	source.BeginPacket(7);
+	source.WriteBuffer(ourSecondBuffer, second.data(), second.size());
+	source.Draw(6);
+
+	// The destination already has payload, so the appended writes end up at other offsets.
+	RenderCommandBuffer destination;
+	destination.WriteBuffer(ourFirstBuffer, 64);
+	destination.AppendPackets(source, 0, 2);
+
+	TGA_CHECK(destination.GetPacketCount() == 3);
+	TGA_CHECK(destination.GetCommandCount() == 5);
+	if (destination.GetPacketCount() == 3 && destination.GetCommandCount() == 5)
+	{
+		TGA_CHECK(destination.GetPackets()[1].SortKey == 5 && destination.GetPackets()[1].FirstCommand == 1 && destination.GetPackets()[1].CommandCount == 2);
+		TGA_CHECK(destination.GetPackets()[2].SortKey == 7 && destination.GetPackets()[2].FirstCommand == 3 && destination.GetPackets()[2].CommandCount == 2);
+
+		const RenderCommand::WriteBufferData& firstWrite = destination.GetCommands()[1].WriteBuffer;
+		const RenderCommand::WriteBufferData& secondWrite = destination.GetCommands()[3].WriteBuffer;
+		TGA_CHECK(firstWrite.PayloadOffset == 64);
+		TGA_CHECK(std::memcmp(destination.GetPayload(firstWrite.PayloadOffset), first.data(), first.size()) == 0);
+		TGA_CHECK(std::memcmp(destination.GetPayload(secondWrite.PayloadOffset), second.data(), second.size()) == 0);
+		TGA_CHECK(destination.GetCommands()[4].Draw.VertexCount == 6);
+	}
+}
+
+TGA_BENCHMARK(RenderCommandBuffer_Record)
+{
+	// Roughly what a sprite batch or an instancer records per object: a write, a few binds and a draw.
+	constexpr size_t ObjectCount = 10000;
+	constexpr size_t WriteSize = 112;
+	const std::vector<uint8_t> data = CreatePattern(WriteSize, 3);
+
+	RenderCommandBuffer commands;
+	Tests::Benchmark("write, binds and draw per object", [&]()
+	{
+		commands.Clear();
+		for (size_t i = 0; i < ObjectCount; i++)
+		{
+			commands.BeginPacket(i);
+			commands.WriteBuffer(ourFirstBuffer, data.data(), WriteSize);
+			commands.SetConstantBuffer(RenderStage_VertexAndPixel, 1, ourSecondBuffer);
+			commands.SetIndexBuffer(ourSecondBuffer, RenderIndexFormat::UInt32);
+			commands.DrawIndexed(36);
+		}
+		Tests::DoNotOptimize(commands.GetCommands());
+	}, ObjectCount);
+
+	RenderCommandBuffer merged;
+	Tests::Benchmark("AppendPackets of the whole buffer", [&]()
+	{
+		merged.Clear();
+		merged.AppendPackets(commands, 0, commands.GetPacketCount());
+		Tests::DoNotOptimize(merged.GetCommands());
+	}, ObjectCount);
+}
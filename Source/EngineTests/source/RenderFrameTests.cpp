@@ -0,0 +1,102 @@
+#include "TestFramework.h"
+#include "TestDevice.h"
+
+#include <cstdio>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <d3d11.h>
+
+#include <tge/drawers/SpriteDrawer.h>
+#include <tge/graphics/GraphicsEngine.h>
+#include <tge/graphics/GraphicsStateStack.h>
+#include <tge/render/RecordingRenderBackend.h>
+#include <tge/sprite/sprite.h>
+#include <tge/text/text.h>
+#include <tge/texture/TextureManager.h>
+#include <tge/engine.h>
+
+using namespace Tga;
+
+namespace
+{
+	// Sprites and text take turns, so every switch between the sprite and the font shader sets the states again.
+	void RenderTextAndSprites(const SpriteSharedData& aLogo, const SpriteSharedData& aSquare, Text& aText)
+	{
+		SpriteDrawer& spriteDrawer = Engine::GetInstance()->GetGraphicsEngine().GetSpriteDrawer();
+		for (int i = 0; i < 4; i++)
+		{
+			Sprite2DInstanceData instance;
+			instance.myPosition = { 100.0f + 200.0f * i, 300.0f };
+			instance.mySize = { 128.0f, 128.0f };
+			spriteDrawer.Submit(aLogo, instance);
+			instance.myPosition.y += 200.0f;
+			spriteDrawer.Submit(aSquare, instance);
+			spriteDrawer.FlushQueue();
+
+			aText.SetPosition({ 100.0f + 200.0f * i, 100.0f });
+			aText.Render();
+		}
+	}
+}
+
+TGA_TEST(RenderFrame_TextAndSpritesHaveNoRedundantStateBinds)
+{
+	if (!Tests::StartTestEngine())
+	{
+		return;
+	}
+
+	Engine& engine = *Engine::GetInstance();
+	GraphicsEngine& graphicsEngine = engine.GetGraphicsEngine();
+
+	TextureHandle logo = engine.GetTextureManager().AcquireTexture(L"Sprites/tge_logo_w.dds");
+	SpriteSharedData logoData;
+	logoData.myTexture = logo.Get();
+	SpriteSharedData squareData;
+
+	Text text(L"Text/arial.ttf", FontSize_14);
+	text.SetText("Redundant state binds");
+
+	// Still draws through the real backend, the recorder only looks at the commands on their way.
+	RecordingRenderBackend recorder(&graphicsEngine.GetRenderBackend());
+	graphicsEngine.SetRenderBackend(&recorder);
+
+	for (int frame = 0; frame < 2; frame++)
+	{
+		recorder.BeginFrame();
+		if (!engine.BeginFrame())
+		{
+			// Only happens once the window has been closed, there is nothing to check then. Once a frame has rendered
+			// the next one has to as well.
+			if (frame == 0)
+			{
+				printf("  Engine could not begin a frame, skipping\n");
+			}
+			TGA_CHECK(frame == 0);
+			graphicsEngine.SetRenderBackend(nullptr);
+			return;
+		}
+		RenderTextAndSprites(logoData, squareData, text);
+		engine.EndFrame();
+
+		const RenderCommandStatistics& statistics = recorder.GetStatistics();
+		TGA_CHECK(statistics.DrawCount > 0);
+		TGA_CHECK(statistics.RedundantCommandCounts[(int)RenderCommandType::SetBlendState] == 0);
+		TGA_CHECK(statistics.RedundantCommandCounts[(int)RenderCommandType::SetDepthStencilState] == 0);
+		TGA_CHECK(statistics.RedundantCommandCounts[(int)RenderCommandType::SetRasterizerState] == 0);
+		TGA_CHECK(statistics.RedundantCommandCounts[(int)RenderCommandType::SetSamplers] == 0);
+	}
+
+	// The statistics of the last frame are swapped in by the next one.
+	const bool isFrameBegun = engine.BeginFrame();
+	TGA_CHECK(isFrameBegun);
+	if (isFrameBegun)
+	{
+		TGA_CHECK(graphicsEngine.GetGraphicsStateStack().GetPreviousStatistics().AvoidedStateBinds > 0);
+		engine.EndFrame();
+	}
+
+	graphicsEngine.SetRenderBackend(nullptr);
+}
@@ -0,0 +1,197 @@
+#include "TestFramework.h"
+
+#include <tge/drawers/SpritePacking.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace Tga;
+
+namespace
+{
+	constexpr size_t FloatsPerInstance = sizeof(SpriteShaderInstanceData) / sizeof(float);
+
+	std::vector<Sprite2DInstanceData> CreateSprites(size_t aCount, float aHiddenFraction, bool aShouldRotate)
+	{
+		std::mt19937 random(5);
+		std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::uniform_real_distribution<float> angle(-10.0f, 10.0f);
+
+		std::vector<Sprite2DInstanceData> sprites(aCount);
+		for (Sprite2DInstanceData& sprite : sprites)
+		{
+			sprite.myPosition = { position(random), position(random) };
+			sprite.myPivot = { unit(random), unit(random) };
+			sprite.mySize = { 1.0f + 100.0f * unit(random), 1.0f + 100.0f * unit(random) };
+			sprite.mySizeMultiplier = { 0.5f + unit(random), 0.5f + unit(random) };
+			sprite.myUV = { unit(random), unit(random) };
+			sprite.myUVScale = { unit(random), unit(random) };
+			sprite.myColor = Color(unit(random), unit(random), unit(random), unit(random));
+			sprite.myTextureRect = { unit(random), unit(random), unit(random), unit(random) };
+			sprite.myRotation = aShouldRotate ? angle(random) : 0.0f;
+			sprite.myIsHidden = unit(random) < aHiddenFraction;
+		}
+		return sprites;
+	}
+
+	Matrix4x4f CreateScreenTransform()
+	{
+		Matrix4x4f transform;
+		transform(1, 1) = 2.0f / 1920.0f;
+		transform(2, 2) = 2.0f / 1080.0f;
+		transform(4, 1) = -1.0f;
+		transform(4, 2) = -1.0f;
+		return transform;
+	}
+
+	// Allowed difference, relative to the size of the value for the large positions.
+	bool IsNear(const SpriteShaderInstanceData& aFirst, const SpriteShaderInstanceData& aSecond)
+	{
+		const float* first = reinterpret_cast<const float*>(&aFirst);
+		const float* second = reinterpret_cast<const float*>(&aSecond);
+		for (size_t i = 0; i < FloatsPerInstance; i++)
+		{
+			if (std::fabs(first[i] - second[i]) > 1e-4f * std::max(1.0f, std::fabs(second[i])))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void CheckMatchesReference(const std::vector<Sprite2DInstanceData>& someSprites, size_t anOutputOffset)
+	{
+		const Matrix4x4f transform = CreateScreenTransform();
+
+		std::vector<SpriteShaderInstanceData> expected(someSprites.size());
+		const size_t expectedCount = SpritePacking::Pack2DReference(someSprites.data(), someSprites.size(), transform, expected.data());
+
+		// The offset moves the output off 16 byte alignment, to cover the unaligned path as well.
+		std::vector<float> storage((someSprites.size() + 1) * FloatsPerInstance + 4);
+		float* alignedStorage = reinterpret_cast<float*>((reinterpret_cast<uintptr_t>(storage.data()) + 15) & ~uintptr_t(15));
+		SpriteShaderInstanceData* packed = reinterpret_cast<SpriteShaderInstanceData*>(alignedStorage + anOutputOffset);
+		const size_t packedCount = SpritePacking::Pack2D(someSprites.data(), someSprites.size(), transform, packed);
+
+		TGA_CHECK(packedCount == expectedCount);
+		size_t mismatches = 0;
+		for (size_t i = 0; i < std::min(packedCount, expectedCount); i++)
+		{
+			if (!IsNear(packed[i], expected[i]))
+			{
+				mismatches++;
+			}
+		}
+		TGA_CHECK(mismatches == 0);
+	}
+}
+
+TGA_TEST(SpritePacking_Pack2DMatchesReference)
+{
+	// Odd counts so the scalar tail after the groups of four is covered too.
+	CheckMatchesReference(CreateSprites(1023, 0.0f, true), 0);
+	CheckMatchesReference(CreateSprites(1023, 0.0f, false), 0);
+	CheckMatchesReference(CreateSprites(1023, 0.3f, true), 0);
+	CheckMatchesReference(CreateSprites(1023, 0.3f, true), 1);
+	CheckMatchesReference(CreateSprites(3, 0.0f, true), 0);
+}
+
+TGA_TEST(SpritePacking_Pack2DSoAMatchesReference)
+{
+	constexpr size_t Count = 257;
+	constexpr size_t PaddedCount = (Count + 3) & ~size_t(3);
+
+	std::vector<Sprite2DInstanceData> sprites = CreateSprites(Count, 0.0f, true);
+	for (Sprite2DInstanceData& sprite : sprites)
+	{
+		// The SoA data shares these and already has linear colors.
+		sprite.myPivot = { 0.25f, 0.75f };
+		sprite.myUV = { 0.0f, 0.0f };
+		sprite.myUVScale = { 1.0f, 1.0f };
+		sprite.myTextureRect = { 0.0f, 0.0f, 1.0f, 1.0f };
+		sprite.myColor = Color(0.25f, 0.5f, 0.75f, 1.0f);
+	}
+
+	struct alignas(16) Stream { float Values[PaddedCount]; };
+	std::vector<Stream> streams(9);
+	for (size_t i = 0; i < Count; i++)
+	{
+		const Sprite2DInstanceData& sprite = sprites[i];
+		const Vector4f linearColor = sprite.myColor.AsLinearVec4();
+		streams[0].Values[i] = sprite.myPosition.x;
+		streams[1].Values[i] = sprite.myPosition.y;
+		streams[2].Values[i] = sprite.mySize.x * sprite.mySizeMultiplier.x;
+		streams[3].Values[i] = sprite.mySize.y * sprite.mySizeMultiplier.y;
+		streams[4].Values[i] = sprite.myRotation;
+		streams[5].Values[i] = linearColor.x;
+		streams[6].Values[i] = linearColor.y;
+		streams[7].Values[i] = linearColor.z;
+		streams[8].Values[i] = linearColor.w;
+	}
+
+	Sprite2DSoAData soa;
+	soa.PositionX = streams[0].Values;
+	soa.PositionY = streams[1].Values;
+	soa.SizeX = streams[2].Values;
+	soa.SizeY = streams[3].Values;
+	soa.Rotation = streams[4].Values;
+	soa.ColorR = streams[5].Values;
+	soa.ColorG = streams[6].Values;
+	soa.ColorB = streams[7].Values;
+	soa.ColorA = streams[8].Values;
+	soa.Pivot = { 0.25f, 0.75f };
+
+	const Matrix4x4f transform = CreateScreenTransform();
+	std::vector<SpriteShaderInstanceData> expected(Count);
+	SpritePacking::Pack2DReference(sprites.data(), Count, transform, expected.data());
+	std::vector<SpriteShaderInstanceData> packed(Count);
+	SpritePacking::Pack2DSoA(soa, Count, transform, packed.data());
+
+	size_t mismatches = 0;
+	for (size_t i = 0; i < Count; i++)
+	{
+		if (!IsNear(packed[i], expected[i]))
+		{
+			mismatches++;
+		}
+	}
+	TGA_CHECK(mismatches == 0);
+}
+
+TGA_BENCHMARK(SpritePacking_Pack2D)
+{
+	// One sprite batch worth of output, which stays in cache the way a command buffer payload does.
+	constexpr size_t SpriteCount = 4096;
+	const Matrix4x4f transform = CreateScreenTransform();
+	std::vector<SpriteShaderInstanceData> packed(SpriteCount);
+
+	const std::vector<Sprite2DInstanceData> rotated = CreateSprites(SpriteCount, 0.0f, true);
+	const std::vector<Sprite2DInstanceData> unrotated = CreateSprites(SpriteCount, 0.0f, false);
+
+	Tests::Benchmark("reference, rotated", [&]()
+	{
+		SpritePacking::Pack2DReference(rotated.data(), SpriteCount, transform, packed.data());
+		Tests::DoNotOptimize(packed.data());
+	}, SpriteCount);
+
+	Tests::Benchmark("SSE, rotated", [&]()
+	{
+		SpritePacking::Pack2D(rotated.data(), SpriteCount, transform, packed.data());
+		Tests::DoNotOptimize(packed.data());
+	}, SpriteCount);
+
+	Tests::Benchmark("reference, unrotated", [&]()
+	{
+		SpritePacking::Pack2DReference(unrotated.data(), SpriteCount, transform, packed.data());
+		Tests::DoNotOptimize(packed.data());
+	}, SpriteCount);
+
+	Tests::Benchmark("SSE, unrotated", [&]()
+	{
+		SpritePacking::Pack2D(unrotated.data(), SpriteCount, transform, packed.data());
+		Tests::DoNotOptimize(packed.data());
+	}, SpriteCount);
+}
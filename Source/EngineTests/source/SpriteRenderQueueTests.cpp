@@ -0,0 +1,66 @@
+#include "TestFramework.h"
+
+#include <tge/drawers/SpriteRenderQueue.h>
+
+#include <vector>
+
+using namespace Tga;
+
+namespace
+{
+	class RecordingSpriteBackend : public SpriteRenderBackend
+	{
+	public:
+		size_t GetMaxBatchSize() const override { return 1024; }
+
+		void DrawBatch(const SpriteSharedData& aSharedData, const Sprite2DInstanceData*, size_t) override
+		{
+			myTextures.push_back(aSharedData.myTexture);
+		}
+
+		std::vector<const TextureResource*> myTextures;
+	};
+
+	// Never dereferenced, the queue only compares the pointers.
+	char ourTextureStorage[2];
+	const TextureResource* const ourLowTexture = reinterpret_cast<const TextureResource*>(&ourTextureStorage[0]);
+	const TextureResource* const ourHighTexture = reinterpret_cast<const TextureResource*>(&ourTextureStorage[1]);
+}
+
+TGA_TEST(SpriteRenderQueue_OrdersTexturesByFirstSubmission)
+{
+	// The higher address goes first, so sorting by address would swap them.
+	SpriteSharedData high;
+	high.myTexture = ourHighTexture;
+	SpriteSharedData low;
+	low.myTexture = ourLowTexture;
+
+	SpriteRenderQueue queue;
+	queue.Submit(high, Sprite2DInstanceData());
+	queue.Submit(low, Sprite2DInstanceData());
+	queue.Submit(high, Sprite2DInstanceData());
+
+	RecordingSpriteBackend backend;
+	queue.Flush(backend);
+
+	TGA_CHECK(backend.myTextures.size() == 2);
+	TGA_CHECK(backend.myTextures.size() == 2 && backend.myTextures[0] == ourHighTexture && backend.myTextures[1] == ourLowTexture);
+	TGA_CHECK(queue.GetLastFlushStatistics().BatchCount == 2);
+}
+
+TGA_TEST(SpriteRenderQueue_LayersComeBeforeSubmissionOrder)
+{
+	SpriteSharedData high;
+	high.myTexture = ourHighTexture;
+	SpriteSharedData low;
+	low.myTexture = ourLowTexture;
+
+	SpriteRenderQueue queue;
+	queue.Submit(high, Sprite2DInstanceData(), 1);
+	queue.Submit(low, Sprite2DInstanceData(), -1);
+
+	RecordingSpriteBackend backend;
+	queue.Flush(backend);
+
+	TGA_CHECK(backend.myTextures.size() == 2 && backend.myTextures[0] == ourLowTexture && backend.myTextures[1] == ourHighTexture);
+}
@@ -0,0 +1,59 @@
+#include "TestDevice.h"
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <d3d11.h>
+#include <tge/graphics/GraphicsEngine.h>
+#include <tge/texture/TextureManager.h>
+#include <tge/engine.h>
+#include <tge/graphics/DX11.h>
+#include <tge/settings/settings.h>
+
+#include <cstdio>
+
+bool Tga::Tests::CreateTestDevice()
+{
+	if (DX11::Device)
+	{
+		return true;
+	}
+
+	const D3D_FEATURE_LEVEL featureLevel = D3D_FEATURE_LEVEL_11_0;
+	for (D3D_DRIVER_TYPE driverType : { D3D_DRIVER_TYPE_HARDWARE, D3D_DRIVER_TYPE_WARP })
+	{
+		ID3D11Device* device = nullptr;
+		ID3D11DeviceContext* context = nullptr;
+		const HRESULT result = D3D11CreateDevice(nullptr, driverType, nullptr, 0, &featureLevel, 1, D3D11_SDK_VERSION, &device, nullptr, &context);
+		if (SUCCEEDED(result))
+		{
+			// Never released, the engine doesn't expect the device to go away while it is running either.
+			DX11::Device = device;
+			DX11::Context = context;
+			return true;
+		}
+	}
+
+	printf("  No D3D11 device, skipping\n");
+	return false;
+}
+
+bool Tga::Tests::StartTestEngine()
+{
+	if (Engine::GetInstance())
+	{
+		return true;
+	}
+
+	LoadSettings(TGE_PROJECT_SETTINGS_FILE);
+
+	EngineConfiguration configuration;
+	configuration.myApplicationName = L"TGE - Engine Tests";
+	configuration.myActivateDebugSystems = DebugFeature::None;
+	if (!Engine::Start(configuration))
+	{
+		printf("  Engine could not start, skipping\n");
+		return false;
+	}
+	return true;
+}
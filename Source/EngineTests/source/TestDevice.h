@@ -0,0 +1,22 @@
+#pragma once
+
+namespace Tga
+{
+namespace Tests
+{
+	/**
+	 * Creates a D3D11 device without a window and sets it as DX11::Device and DX11::Context, for tests of code that
+	 * creates or fills GPU resources. Falls back to WARP when there is no hardware device, so it also works on
+	 * build machines. The device lives until the process exits.
+	 * @returns false if no device could be created, tests needing one should skip themselves.
+	 */
+	bool CreateTestDevice();
+
+	/**
+	 * Starts the engine with its window and without debug systems, for tests that render through the drawers. Settings
+	 * come from EngineTests.json like a game's do. The engine is started once and runs until the process exits.
+	 * @returns false if the engine couldn't start, tests needing it should skip themselves.
+	 */
+	bool StartTestEngine();
+}
+}
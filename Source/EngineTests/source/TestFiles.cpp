@@ -0,0 +1,41 @@
+#include "TestFiles.h"
+
+#include <fstream>
+#include <iterator>
+
+namespace fs = std::filesystem;
+
+Tga::Tests::TempDirectory::TempDirectory(const char* aName)
+{
+	std::error_code error;
+	myPath = fs::temp_directory_path(error) / "TgaEngineTests" / aName;
+	fs::remove_all(myPath, error);
+	fs::create_directories(myPath, error);
+}
+
+Tga::Tests::TempDirectory::~TempDirectory()
+{
+	std::error_code error;
+	fs::remove_all(myPath, error);
+}
+
+std::string Tga::Tests::TempDirectory::GetPath(const std::string& aRelativePath) const
+{
+	return (myPath / fs::u8path(aRelativePath)).generic_u8string();
+}
+
+bool Tga::Tests::WriteFile(const fs::path& aPath, const std::string& someContents)
+{
+	std::error_code error;
+	fs::create_directories(aPath.parent_path(), error);
+
+	std::ofstream file(aPath, std::ios::binary | std::ios::trunc);
+	file.write(someContents.data(), static_cast<std::streamsize>(someContents.size()));
+	return file.good();
+}
+
+std::string Tga::Tests::ReadFile(const fs::path& aPath)
+{
+	std::ifstream file(aPath, std::ios::binary);
+	return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
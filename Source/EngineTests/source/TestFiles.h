@@ -0,0 +1,44 @@
+#pragma once
+#include <filesystem>
+#include <string>
+
+namespace Tga
+{
+namespace Tests
+{
+	/**
+	 * An empty directory under the system temp directory, removed with everything in it when this goes out of scope.
+	 * Whatever a failed run left behind under the same name is removed first.
+	 */
+	class TempDirectory
+	{
+	public:
+		explicit TempDirectory(const char* aName);
+		~TempDirectory();
+
+		TempDirectory(const TempDirectory&) = delete;
+		TempDirectory& operator=(const TempDirectory&) = delete;
+
+		const std::filesystem::path& GetPath() const { return myPath; }
+
+		/**
+		 * @returns aRelativePath under the directory, / separated.
+		 */
+		std::string GetPath(const std::string& aRelativePath) const;
+
+	private:
+		std::filesystem::path myPath;
+	};
+
+	/**
+	 * Writes someContents to aPath, creating the directories on the way.
+	 * @returns false if the file couldn't be written.
+	 */
+	bool WriteFile(const std::filesystem::path& aPath, const std::string& someContents);
+
+	/**
+	 * @returns The contents of aPath, empty if it couldn't be read.
+	 */
+	std::string ReadFile(const std::filesystem::path& aPath);
+}
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Tga
+{
+namespace Tests
+{
+	typedef void (*TestFunction)();
+
+	struct TestCase
+	{
+		const char* Name;
+		TestFunction Function;
+		bool IsBenchmark;
+	};
+
+	std::vector<TestCase>& GetTestCases();
+
+	struct TestRegistrar
+	{
+		TestRegistrar(const char* aName, TestFunction aFunction, bool anIsBenchmark)
+		{
+			GetTestCases().push_back({ aName, aFunction, anIsBenchmark });
+		}
+	};
+
+	void ReportFailure(const char* aFile, int aLine, const char* anExpression);
+
+	/**
+	 * Keeps the optimizer from removing work whose result is otherwise unused.
+	 */
+	void DoNotOptimize(const void* aValue);
+
+	void PrintBenchmark(const char* aName, double aNanoseconds, size_t anItemCount);
+
+	/**
+	 * Runs aFunction until at least aMinimumTime has passed and prints the average time per call.
+	 * @param anItemCount Items processed per call, also prints the time per item when above 1.
+	 */
+	template<typename Function>
+	void Benchmark(const char* aName, Function aFunction, size_t anItemCount = 1, std::chrono::milliseconds aMinimumTime = std::chrono::milliseconds(250))
+	{
+		// One untimed call warms caches and lets lazily created resources settle.
+		aFunction();
+
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::chrono::steady_clock::duration elapsed;
+		uint64_t iterations = 0;
+		do
+		{
+			aFunction();
+			iterations++;
+			elapsed = std::chrono::steady_clock::now() - start;
+		} while (elapsed < aMinimumTime);
+
+		const double nanoseconds = std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(iterations);
+		PrintBenchmark(aName, nanoseconds, anItemCount);
+	}
+}
+}
+
+#define TGA_TEST_NAME_(aPrefix, aName) aPrefix##aName
+
+/** Defines a test, run by default. Fails when any TGA_CHECK in it fails. */
+#define TGA_TEST(aName) \
+	static void aName(); \
+	static Tga::Tests::TestRegistrar TGA_TEST_NAME_(Registrar_, aName)(#aName, &aName, false); \
+	static void aName()
+
+/** Defines a benchmark, only run when EngineTests is started with --bench. */
+#define TGA_BENCHMARK(aName) \
+	static void aName(); \
+	static Tga::Tests::TestRegistrar TGA_TEST_NAME_(Registrar_, aName)(#aName, &aName, true); \
+	static void aName()
+
+#define TGA_CHECK(anExpression) \
+	do \
+	{ \
+		if (!(anExpression)) \
+		{ \
+			Tga::Tests::ReportFailure(__FILE__, __LINE__, #anExpression); \
+		} \
+	} while (false)
@@ -0,0 +1,75 @@
+#include "TestFramework.h"
+
+#include <tge/text/TextService.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace Tga;
+
+namespace
+{
+	std::vector<uint32_t> Decode(const std::string& aText)
+	{
+		std::vector<uint32_t> codepoints;
+		for (size_t i = 0; i < aText.size();)
+		{
+			const size_t start = i;
+			codepoints.push_back(TextService::DecodeNextCodepoint(aText, i));
+			if (i <= start)
+			{
+				// Stuck, the caller would loop forever.
+				return {};
+			}
+		}
+		return codepoints;
+	}
+}
+
+TGA_TEST(TextService_DecodesUTF8)
+{
+	TGA_CHECK(Decode("Ab") == std::vector<uint32_t>({ 'A', 'b' }));
+	TGA_CHECK(Decode("\xC3\xA9") == std::vector<uint32_t>({ 0xE9 }));
+	TGA_CHECK(Decode("\xE2\x82\xAC!") == std::vector<uint32_t>({ 0x20AC, '!' }));
+	TGA_CHECK(Decode("\xF0\x9F\x98\x80") == std::vector<uint32_t>({ 0x1F600 }));
+
+	// The smallest and largest of each length.
+	TGA_CHECK(Decode("\xC2\x80\xDF\xBF") == std::vector<uint32_t>({ 0x80, 0x7FF }));
+	TGA_CHECK(Decode("\xE0\xA0\x80\xEF\xBF\xBF") == std::vector<uint32_t>({ 0x800, 0xFFFF }));
+	TGA_CHECK(Decode("\xF0\x90\x80\x80\xF4\x8F\xBF\xBF") == std::vector<uint32_t>({ 0x10000, 0x10FFFF }));
+}
+
+TGA_TEST(TextService_RejectsOverlongUTF8)
+{
+	// Each of these encodes a codepoint that fits a shorter sequence, every byte falls back to Latin-1.
+	TGA_CHECK(Decode("\xC0\x80") == std::vector<uint32_t>({ 0xC0, 0x80 }));
+	TGA_CHECK(Decode("\xC1\xBF") == std::vector<uint32_t>({ 0xC1, 0xBF }));
+	TGA_CHECK(Decode("\xE0\x9F\xBF") == std::vector<uint32_t>({ 0xE0, 0x9F, 0xBF }));
+	TGA_CHECK(Decode("\xF0\x8F\xBF\xBF") == std::vector<uint32_t>({ 0xF0, 0x8F, 0xBF, 0xBF }));
+}
+
+TGA_TEST(TextService_FallsBackToLatin1OnInvalidUTF8)
+{
+	// Latin-1 text, 0xE9 looks like the start of a three byte sequence that is cut short.
+	TGA_CHECK(Decode("caf\xE9") == std::vector<uint32_t>({ 'c', 'a', 'f', 0xE9 }));
+	TGA_CHECK(Decode("\xE9t\xE9") == std::vector<uint32_t>({ 0xE9, 't', 0xE9 }));
+
+	// Truncated at the end of the string.
+	TGA_CHECK(Decode("\xE2\x82") == std::vector<uint32_t>({ 0xE2, 0x82 }));
+	TGA_CHECK(Decode("\xF0\x9F\x98") == std::vector<uint32_t>({ 0xF0, 0x9F, 0x98 }));
+
+	// A continuation byte missing in the middle doesn't swallow the character after it.
+	TGA_CHECK(Decode("\xC3" "A") == std::vector<uint32_t>({ 0xC3, 'A' }));
+	TGA_CHECK(Decode("\xE2\x82" "A") == std::vector<uint32_t>({ 0xE2, 0x82, 'A' }));
+
+	// Lone continuation bytes and lead bytes of five and six byte sequences.
+	TGA_CHECK(Decode("\x80\xBF") == std::vector<uint32_t>({ 0x80, 0xBF }));
+	TGA_CHECK(Decode("\xF8\x88\x80\x80\x80") == std::vector<uint32_t>({ 0xF8, 0x88, 0x80, 0x80, 0x80 }));
+	TGA_CHECK(Decode("\xFE\xFF") == std::vector<uint32_t>({ 0xFE, 0xFF }));
+
+	// UTF-16 surrogates and codepoints past the end of Unicode.
+	TGA_CHECK(Decode("\xED\xA0\x80") == std::vector<uint32_t>({ 0xED, 0xA0, 0x80 }));
+	TGA_CHECK(Decode("\xED\xBF\xBF") == std::vector<uint32_t>({ 0xED, 0xBF, 0xBF }));
+	TGA_CHECK(Decode("\xF4\x90\x80\x80") == std::vector<uint32_t>({ 0xF4, 0x90, 0x80, 0x80 }));
+}
@@ -0,0 +1,274 @@
+#include "TestFramework.h"
+
+#include <tge/texture/DDSLayout.h>
+#include <tge/texture/MipStreamingPolicy.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace Tga;
+
+namespace
+{
+	constexpr uint32_t DDPF_FOURCC = 0x4;
+	constexpr uint32_t DDPF_RGB = 0x40;
+	constexpr uint32_t DDSCAPS2_CUBEMAP = 0x200;
+	constexpr size_t LegacyHeaderSize = 4 + 124;
+
+	void WriteUInt32(std::vector<uint8_t>& someData, size_t anOffset, uint32_t aValue)
+	{
+		std::memcpy(someData.data() + anOffset, &aValue, sizeof(aValue));
+	}
+
+	uint32_t FourCC(const char* aCode)
+	{
+		uint32_t value;
+		std::memcpy(&value, aCode, sizeof(value));
+		return value;
+	}
+
+	// The start of a .dds file, the caller adds the mips. Offsets are from the start of the file, after "DDS ".
+	std::vector<uint8_t> CreateHeader(uint32_t aWidth, uint32_t aHeight, uint32_t aMipCount, uint32_t aPixelFormatFlags, uint32_t aFourCC)
+	{
+		std::vector<uint8_t> file(LegacyHeaderSize);
+		std::memcpy(file.data(), "DDS ", 4);
+		WriteUInt32(file, 4, 124);
+		WriteUInt32(file, 12, aHeight);
+		WriteUInt32(file, 16, aWidth);
+		WriteUInt32(file, 28, aMipCount);
+		WriteUInt32(file, 76, 32);
+		WriteUInt32(file, 80, aPixelFormatFlags);
+		WriteUInt32(file, 84, aFourCC);
+		if (aPixelFormatFlags & DDPF_RGB)
+		{
+			WriteUInt32(file, 88, 32);
+			WriteUInt32(file, 92, 0x000000ff);
+			WriteUInt32(file, 96, 0x0000ff00);
+			WriteUInt32(file, 100, 0x00ff0000);
+			WriteUInt32(file, 104, 0xff000000);
+		}
+		return file;
+	}
+
+	std::vector<uint8_t> CreateBC1File(uint32_t aWidth, uint32_t aHeight, uint32_t aMipCount, size_t aDataSize)
+	{
+		std::vector<uint8_t> file = CreateHeader(aWidth, aHeight, aMipCount, DDPF_FOURCC, FourCC("DXT1"));
+		file.resize(file.size() + aDataSize);
+		return file;
+	}
+
+	bool Parse(const std::vector<uint8_t>& aFile, DDSLayout& outLayout)
+	{
+		return DDSLayout::Parse(aFile.data(), std::min(DDSLayout::MaxHeaderSize, aFile.size()), aFile.size(), outLayout);
+	}
+
+	// Layouts for the policy tests don't need a file, only the mip sizes.
+	DDSLayout CreateRGBALayout(uint32_t aSize)
+	{
+		std::vector<uint8_t> file = CreateHeader(aSize, aSize, 0, DDPF_RGB, 0);
+		uint32_t mipCount = 0;
+		size_t dataSize = 0;
+		for (uint32_t size = aSize; size > 0; size /= 2)
+		{
+			dataSize += static_cast<size_t>(size) * size * 4;
+			mipCount++;
+		}
+		WriteUInt32(file, 28, mipCount);
+		file.resize(file.size() + dataSize);
+
+		DDSLayout layout;
+		Parse(file, layout);
+		return layout;
+	}
+}
+
+TGA_TEST(DDSLayout_ParsesBlockCompressedMips)
+{
+	// 256x128 down to 1x1, every BC1 mip is at least one 8 byte block.
+	size_t dataSize = 0;
+	for (uint32_t width = 256, height = 128; width > 0; width /= 2, height = height > 1 ? height / 2 : 1)
+	{
+		dataSize += static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * 8;
+	}
+	const std::vector<uint8_t> file = CreateBC1File(256, 128, 9, dataSize);
+
+	DDSLayout layout;
+	TGA_CHECK(Parse(file, layout));
+	TGA_CHECK(layout.myFormat == DXGI_FORMAT_BC1_UNORM);
+	TGA_CHECK(layout.myWidth == 256 && layout.myHeight == 128);
+	TGA_CHECK(layout.GetMipCount() == 9);
+	if (layout.GetMipCount() != 9)
+	{
+		return;
+	}
+
+	TGA_CHECK(layout.myMips[0].myOffset == LegacyHeaderSize);
+	TGA_CHECK(layout.myMips[0].myRowPitch == 64 * 8 && layout.myMips[0].mySize == 64 * 32 * 8);
+	TGA_CHECK(layout.myMips[8].myWidth == 1 && layout.myMips[8].myHeight == 1 && layout.myMips[8].mySize == 8);
+	for (uint32_t mip = 1; mip < layout.GetMipCount(); mip++)
+	{
+		TGA_CHECK(layout.myMips[mip].myOffset == layout.myMips[mip - 1].myOffset + layout.myMips[mip - 1].mySize);
+	}
+	TGA_CHECK(layout.myMips[8].myOffset + layout.myMips[8].mySize == file.size());
+	TGA_CHECK(layout.GetSizeFromMip(0) == dataSize);
+}
+
+TGA_TEST(DDSLayout_ParsesDX10Header)
+{
+	constexpr uint32_t DXGIFormatR8G8B8A8UNorm = 28;
+	constexpr uint32_t Texture2D = 3;
+
+	std::vector<uint8_t> file = CreateHeader(64, 64, 1, DDPF_FOURCC, FourCC("DX10"));
+	file.resize(DDSLayout::MaxHeaderSize + 64 * 64 * 4);
+	WriteUInt32(file, LegacyHeaderSize, DXGIFormatR8G8B8A8UNorm);
+	WriteUInt32(file, LegacyHeaderSize + 4, Texture2D);
+	WriteUInt32(file, LegacyHeaderSize + 12, 1);
+
+	DDSLayout layout;
+	TGA_CHECK(Parse(file, layout));
+	TGA_CHECK(layout.myFormat == DXGI_FORMAT_R8G8B8A8_UNORM);
+	TGA_CHECK(layout.GetMipCount() == 1 && layout.myMips[0].myOffset == DDSLayout::MaxHeaderSize && layout.myMips[0].myRowPitch == 64 * 4);
+}
+
+TGA_TEST(DDSLayout_RefusesWhatCantBeStreamed)
+{
+	DDSLayout layout;
+
+	// Mips that don't fit in the file.
+	TGA_CHECK(!Parse(CreateBC1File(64, 64, 1, 64 * 8), layout));
+	TGA_CHECK(layout.GetMipCount() == 0);
+
+	// More mips than 64x64 has.
+	TGA_CHECK(!Parse(CreateBC1File(64, 64, 8, 1 << 16), layout));
+
+	std::vector<uint8_t> cubeMap = CreateBC1File(64, 64, 1, 6 * 16 * 16 * 8);
+	WriteUInt32(cubeMap, 112, DDSCAPS2_CUBEMAP);
+	TGA_CHECK(!Parse(cubeMap, layout));
+
+	std::vector<uint8_t> notDDS = CreateBC1File(64, 64, 1, 16 * 16 * 8);
+	notDDS[0] = 'X';
+	TGA_CHECK(!Parse(notDDS, layout));
+
+	TGA_CHECK(!Parse(CreateHeader(64, 64, 1, DDPF_FOURCC, FourCC("ABCD")), layout));
+
+	std::vector<uint8_t> cutHeader = CreateBC1File(64, 64, 1, 16 * 16 * 8);
+	cutHeader.resize(100);
+	TGA_CHECK(!Parse(cutHeader, layout));
+}
+
+TGA_TEST(MipStreamingPolicy_KeepsBlockCompressedTopMipsWhole)
+{
+	// 256x8: mip 1 is 128x4, mip 2 is 64x2 and can't be a top mip.
+	size_t dataSize = 0;
+	for (uint32_t width = 256, height = 8; width > 0; width /= 2, height = height > 1 ? height / 2 : 1)
+	{
+		dataSize += static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * 8;
+	}
+	DDSLayout layout;
+	TGA_CHECK(Parse(CreateBC1File(256, 8, 9, dataSize), layout));
+
+	TGA_CHECK(layout.CanBeTopMip(1));
+	TGA_CHECK(!layout.CanBeTopMip(2));
+	TGA_CHECK(!layout.CanBeTopMip(layout.GetMipCount()));
+	TGA_CHECK(MipStreamingPolicy::CalculateTailMip(layout) == 1);
+	TGA_CHECK(MipStreamingPolicy::CalculateFinestMip(layout, 16) == 1);
+
+	// Uncompressed textures can have any mip on top.
+	const DDSLayout rgba = CreateRGBALayout(256);
+	TGA_CHECK(rgba.CanBeTopMip(rgba.GetMipCount() - 1));
+	TGA_CHECK(MipStreamingPolicy::CalculateTailMip(rgba, 1) == rgba.GetMipCount() - 1);
+}
+
+TGA_TEST(MipStreamingPolicy_CalculateWantedMip)
+{
+	const DDSLayout layout = CreateRGBALayout(1024);
+	const uint32_t tailMip = MipStreamingPolicy::CalculateTailMip(layout);
+	TGA_CHECK(tailMip == 4);
+
+	// Not drawn gives the tail, and the coarsest mip that still has a texel per pixel otherwise.
+	TGA_CHECK(MipStreamingPolicy::CalculateWantedMip(layout, 0.0f, 0, tailMip) == tailMip);
+	TGA_CHECK(MipStreamingPolicy::CalculateWantedMip(layout, 1024.0f, 0, tailMip) == 0);
+	TGA_CHECK(MipStreamingPolicy::CalculateWantedMip(layout, 4096.0f, 0, tailMip) == 0);
+	TGA_CHECK(MipStreamingPolicy::CalculateWantedMip(layout, 256.0f, 0, tailMip) == 2);
+	TGA_CHECK(MipStreamingPolicy::CalculateWantedMip(layout, 100.0f, 0, tailMip) == 3);
+	TGA_CHECK(MipStreamingPolicy::CalculateWantedMip(layout, 10.0f, 0, tailMip) == tailMip);
+
+	// The max size it was requested with wins over the screen size.
+	TGA_CHECK(MipStreamingPolicy::CalculateWantedMip(layout, 2000.0f, 1, tailMip) == 1);
+}
+
+TGA_TEST(MipStreamingPolicy_FitsWantedMipsToBudget)
+{
+	const DDSLayout layout = CreateRGBALayout(1024);
+	const uint32_t tailMip = MipStreamingPolicy::CalculateTailMip(layout);
+
+	auto createEntry = [&](uint32_t aWantedMip, uint32_t aResidentMip)
+	{
+		MipStreamingPolicy::Entry entry = {};
+		entry.myLayout = &layout;
+		entry.myFinestMip = 0;
+		entry.myTailMip = tailMip;
+		entry.myWantedMip = aWantedMip;
+		entry.myResidentMip = aResidentMip;
+		return entry;
+	};
+
+	// Enough for one full texture and one without its top mip: one of the two gives up its top mip.
+	MipStreamingPolicy::Entry entries[2] = { createEntry(0, tailMip), createEntry(0, tailMip) };
+	const uint64_t budget = layout.GetSizeFromMip(0) + layout.GetSizeFromMip(1);
+	TGA_CHECK(MipStreamingPolicy::FitToBudget(entries, 2, budget) == budget);
+	TGA_CHECK(entries[0].myTargetMip + entries[1].myTargetMip == 1);
+
+	// Without room for anything, everything drops to its tail and the total is over the budget.
+	entries[0] = createEntry(0, tailMip);
+	entries[1] = createEntry(0, tailMip);
+	TGA_CHECK(MipStreamingPolicy::FitToBudget(entries, 2, 0) == 2 * layout.GetSizeFromMip(tailMip));
+	TGA_CHECK(entries[0].myTargetMip == tailMip && entries[1].myTargetMip == tailMip);
+
+	// Resident mips finer than wanted are kept while they fit, and only as far as they fit.
+	entries[0] = createEntry(2, 0);
+	TGA_CHECK(MipStreamingPolicy::FitToBudget(entries, 1, layout.GetSizeFromMip(0)) == layout.GetSizeFromMip(0));
+	TGA_CHECK(entries[0].myTargetMip == 0);
+	entries[0] = createEntry(2, 0);
+	MipStreamingPolicy::FitToBudget(entries, 1, layout.GetSizeFromMip(1));
+	TGA_CHECK(entries[0].myTargetMip == 1);
+}
+
+TGA_BENCHMARK(MipStreamingPolicy_FitToBudget)
+{
+	// Runs every frame over every streamed texture, sizes from 64 to 4096.
+	constexpr size_t EntryCount = 2000;
+	std::vector<DDSLayout> layouts;
+	for (uint32_t size = 64; size <= 4096; size *= 2)
+	{
+		layouts.push_back(CreateRGBALayout(size));
+	}
+
+	std::mt19937 random(5);
+	std::vector<MipStreamingPolicy::Entry> entries(EntryCount);
+	uint64_t wantedTotal = 0;
+	for (MipStreamingPolicy::Entry& entry : entries)
+	{
+		entry.myLayout = &layouts[random() % layouts.size()];
+		entry.myFinestMip = 0;
+		entry.myTailMip = MipStreamingPolicy::CalculateTailMip(*entry.myLayout);
+		entry.myWantedMip = random() % (entry.myTailMip + 1);
+		entry.myResidentMip = entry.myTailMip;
+		wantedTotal += entry.myLayout->GetSizeFromMip(entry.myWantedMip);
+	}
+
+	Tests::Benchmark("everything fits", [&]()
+	{
+		const uint64_t total = MipStreamingPolicy::FitToBudget(entries.data(), entries.size(), wantedTotal);
+		Tests::DoNotOptimize(&total);
+	}, EntryCount);
+
+	Tests::Benchmark("a quarter of the wanted mips fit", [&]()
+	{
+		const uint64_t total = MipStreamingPolicy::FitToBudget(entries.data(), entries.size(), wantedTotal / 4);
+		Tests::DoNotOptimize(&total);
+	}, EntryCount);
+}
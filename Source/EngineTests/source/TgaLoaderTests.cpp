@@ -0,0 +1,439 @@
+#include "TestFramework.h"
+
+#include <tge/loaders/tgaloader.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace Tga;
+
+namespace
+{
+	constexpr unsigned char RightToLeft = 0x10;
+	constexpr unsigned char TopToBottom = 0x20;
+
+	// Written after the decoded pixels, a decoder that writes past its rows changes them.
+	constexpr size_t GuardSize = 64;
+	constexpr unsigned char GuardValue = 0xCD;
+
+	enum class Encoding
+	{
+		TrueColor32,
+		TrueColor24,
+		TrueColor16,
+		Grayscale8,
+		Grayscale16,
+		ColorMapped8,
+	};
+
+	struct Image
+	{
+		uint16_t myWidth = 0;
+		uint16_t myHeight = 0;
+		// RGBA8, top row first, the same as Tga32::Decode writes.
+		std::vector<uint32_t> myPixels;
+	};
+
+	uint32_t MakeRGBA(uint32_t aR, uint32_t aG, uint32_t aB, uint32_t aA)
+	{
+		return aR | (aG << 8) | (aB << 16) | (aA << 24);
+	}
+
+	uint32_t GetChannel(uint32_t aPixel, int aChannel)
+	{
+		return (aPixel >> (aChannel * 8)) & 0xFF;
+	}
+
+	// Runs of one color and runs of noise, so the RLE encoding gets both kinds of packets and runs across rows.
+	// Colors come from a small set so they fit in an 8 bit color map.
+	Image CreateImage(uint16_t aWidth, uint16_t aHeight, uint32_t aSeed)
+	{
+		std::mt19937 random(aSeed);
+		uint32_t colors[200];
+		for (uint32_t& color : colors)
+		{
+			color = static_cast<uint32_t>(random());
+		}
+
+		Image image;
+		image.myWidth = aWidth;
+		image.myHeight = aHeight;
+		image.myPixels.resize(static_cast<size_t>(aWidth) * aHeight);
+		for (size_t i = 0; i < image.myPixels.size();)
+		{
+			const size_t runLength = std::min<size_t>(1 + random() % 300, image.myPixels.size() - i);
+			const bool isRun = random() % 2 == 0;
+			const uint32_t runColor = colors[random() % 200];
+			for (size_t end = i + runLength; i < end; i++)
+			{
+				image.myPixels[i] = isRun ? runColor : colors[random() % 200];
+			}
+		}
+		return image;
+	}
+
+	// What the decoder gives back for a pixel after it went through the encoding.
+	uint32_t GetExpected(uint32_t aPixel, Encoding anEncoding)
+	{
+		switch (anEncoding)
+		{
+		case Encoding::TrueColor24:
+			return aPixel | 0xFF000000;
+		case Encoding::TrueColor16:
+		{
+			uint32_t channels[3];
+			for (int channel = 0; channel < 3; channel++)
+			{
+				const uint32_t value = GetChannel(aPixel, channel) >> 3;
+				channels[channel] = (value << 3) | (value >> 2);
+			}
+			return MakeRGBA(channels[0], channels[1], channels[2], GetChannel(aPixel, 3) >= 128 ? 255 : 0);
+		}
+		case Encoding::Grayscale8:
+			return MakeRGBA(GetChannel(aPixel, 0), GetChannel(aPixel, 0), GetChannel(aPixel, 0), 255);
+		case Encoding::Grayscale16:
+			return MakeRGBA(GetChannel(aPixel, 0), GetChannel(aPixel, 0), GetChannel(aPixel, 0), GetChannel(aPixel, 3));
+		default:
+			return aPixel;
+		}
+	}
+
+	// The pixel as it is stored in the file, or in the color map for color mapped images.
+	void AppendPixel(std::vector<unsigned char>& someData, uint32_t aPixel, Encoding anEncoding)
+	{
+		const uint32_t r = GetChannel(aPixel, 0);
+		const uint32_t g = GetChannel(aPixel, 1);
+		const uint32_t b = GetChannel(aPixel, 2);
+		const uint32_t a = GetChannel(aPixel, 3);
+		switch (anEncoding)
+		{
+		case Encoding::TrueColor32:
+		case Encoding::ColorMapped8:
+			someData.insert(someData.end(), { static_cast<unsigned char>(b), static_cast<unsigned char>(g), static_cast<unsigned char>(r), static_cast<unsigned char>(a) });
+			break;
+		case Encoding::TrueColor24:
+			someData.insert(someData.end(), { static_cast<unsigned char>(b), static_cast<unsigned char>(g), static_cast<unsigned char>(r) });
+			break;
+		case Encoding::TrueColor16:
+		{
+			const uint32_t value = ((a >= 128 ? 1u : 0u) << 15) | ((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3);
+			someData.insert(someData.end(), { static_cast<unsigned char>(value), static_cast<unsigned char>(value >> 8) });
+			break;
+		}
+		case Encoding::Grayscale8:
+			someData.push_back(static_cast<unsigned char>(r));
+			break;
+		case Encoding::Grayscale16:
+			someData.insert(someData.end(), { static_cast<unsigned char>(r), static_cast<unsigned char>(a) });
+			break;
+		}
+	}
+
+	void WriteUInt16(std::vector<unsigned char>& someData, size_t anOffset, uint16_t aValue)
+	{
+		someData[anOffset] = static_cast<unsigned char>(aValue);
+		someData[anOffset + 1] = static_cast<unsigned char>(aValue >> 8);
+	}
+
+	/**
+	 * Encodes anImage the way a .tga writer would, so the decoder is checked against files it didn't produce itself.
+	 * RLE packets run across rows, which the format allows and some writers do.
+	 */
+	std::vector<unsigned char> Encode(const Image& anImage, Encoding anEncoding, bool anIsRLE, unsigned char anOrigin)
+	{
+		std::vector<unsigned char> file(18, 0);
+		const char id[] = "EngineTests";
+		file[0] = sizeof(id);
+		file.insert(file.end(), id, id + sizeof(id));
+
+		// Pixels in file order, which is what the origin bits describe.
+		std::vector<uint32_t> filePixels;
+		filePixels.reserve(anImage.myPixels.size());
+		for (size_t fileRow = 0; fileRow < anImage.myHeight; fileRow++)
+		{
+			const size_t row = (anOrigin & TopToBottom) ? fileRow : anImage.myHeight - 1 - fileRow;
+			for (size_t fileColumn = 0; fileColumn < anImage.myWidth; fileColumn++)
+			{
+				const size_t column = (anOrigin & RightToLeft) ? anImage.myWidth - 1 - fileColumn : fileColumn;
+				filePixels.push_back(anImage.myPixels[row * anImage.myWidth + column]);
+			}
+		}
+
+		unsigned char bpp = 32;
+		unsigned char imageType = 2;
+		unsigned char alphaBits = 8;
+		std::vector<uint32_t> colorMap;
+		switch (anEncoding)
+		{
+		case Encoding::TrueColor24: bpp = 24; alphaBits = 0; break;
+		case Encoding::TrueColor16: bpp = 16; alphaBits = 1; break;
+		case Encoding::Grayscale8: bpp = 8; imageType = 3; alphaBits = 0; break;
+		case Encoding::Grayscale16: bpp = 16; imageType = 3; break;
+		case Encoding::ColorMapped8:
+		{
+			bpp = 8;
+			imageType = 1;
+			std::unordered_map<uint32_t, uint32_t> indices;
+			for (uint32_t& pixel : filePixels)
+			{
+				auto inserted = indices.emplace(pixel, static_cast<uint32_t>(colorMap.size()));
+				if (inserted.second)
+				{
+					colorMap.push_back(pixel);
+				}
+				pixel = inserted.first->second;
+			}
+			break;
+		}
+		default: break;
+		}
+
+		file[2] = static_cast<unsigned char>(imageType + (anIsRLE ? 8 : 0));
+		WriteUInt16(file, 12, anImage.myWidth);
+		WriteUInt16(file, 14, anImage.myHeight);
+		file[16] = bpp;
+		file[17] = static_cast<unsigned char>(anOrigin | alphaBits);
+		if (!colorMap.empty())
+		{
+			file[1] = 1;
+			WriteUInt16(file, 5, static_cast<uint16_t>(colorMap.size()));
+			file[7] = 32;
+			for (uint32_t color : colorMap)
+			{
+				AppendPixel(file, color, Encoding::TrueColor32);
+			}
+		}
+
+		auto appendFilePixel = [&](uint32_t aPixel)
+		{
+			if (colorMap.empty())
+			{
+				AppendPixel(file, aPixel, anEncoding);
+			}
+			else
+			{
+				file.push_back(static_cast<unsigned char>(aPixel));
+			}
+		};
+
+		if (!anIsRLE)
+		{
+			for (uint32_t pixel : filePixels)
+			{
+				appendFilePixel(pixel);
+			}
+			return file;
+		}
+
+		for (size_t i = 0; i < filePixels.size();)
+		{
+			size_t runLength = 1;
+			while (i + runLength < filePixels.size() && runLength < 128 && filePixels[i + runLength] == filePixels[i])
+			{
+				runLength++;
+			}
+			if (runLength > 1)
+			{
+				file.push_back(static_cast<unsigned char>(0x80 | (runLength - 1)));
+				appendFilePixel(filePixels[i]);
+				i += runLength;
+				continue;
+			}
+
+			size_t rawLength = 1;
+			while (i + rawLength < filePixels.size() && rawLength < 128
+				&& (i + rawLength + 1 == filePixels.size() || filePixels[i + rawLength] != filePixels[i + rawLength + 1]))
+			{
+				rawLength++;
+			}
+			file.push_back(static_cast<unsigned char>(rawLength - 1));
+			for (size_t end = i + rawLength; i < end; i++)
+			{
+				appendFilePixel(filePixels[i]);
+			}
+		}
+		return file;
+	}
+
+	// Decodes into rows with padding and a guard after the last one, and checks that neither was written.
+	bool DecodeChecked(const std::vector<unsigned char>& aFile, size_t aWidth, size_t aHeight, std::vector<uint32_t>& outPixels)
+	{
+		const size_t rowPitch = aWidth * 4 + 12;
+		std::vector<unsigned char> destination(rowPitch * aHeight + GuardSize, GuardValue);
+		const bool isDecoded = Tga32::Decode(aFile.data(), aFile.size(), destination.data(), rowPitch);
+
+		bool isInside = true;
+		for (size_t row = 0; row < aHeight; row++)
+		{
+			for (size_t i = aWidth * 4; i < rowPitch; i++)
+			{
+				isInside &= destination[row * rowPitch + i] == GuardValue;
+			}
+		}
+		for (size_t i = rowPitch * aHeight; i < destination.size(); i++)
+		{
+			isInside &= destination[i] == GuardValue;
+		}
+		TGA_CHECK(isInside);
+
+		outPixels.resize(aWidth * aHeight);
+		for (size_t row = 0; row < aHeight; row++)
+		{
+			std::memcpy(outPixels.data() + row * aWidth, destination.data() + row * rowPitch, aWidth * 4);
+		}
+		return isDecoded;
+	}
+
+	bool CheckRoundTrip(const Image& anImage, Encoding anEncoding, bool anIsRLE, unsigned char anOrigin)
+	{
+		const std::vector<unsigned char> file = Encode(anImage, anEncoding, anIsRLE, anOrigin);
+
+		Tga32::TgaHeader header;
+		if (!Tga32::ReadHeader(file.data(), file.size(), header) || header.myWidth != anImage.myWidth || header.myHeight != anImage.myHeight)
+		{
+			return false;
+		}
+
+		std::vector<uint32_t> pixels;
+		if (!DecodeChecked(file, anImage.myWidth, anImage.myHeight, pixels))
+		{
+			return false;
+		}
+		for (size_t i = 0; i < pixels.size(); i++)
+		{
+			if (pixels[i] != GetExpected(anImage.myPixels[i], anEncoding))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+TGA_TEST(TgaLoader_RoundTripsEveryEncodingAndOrigin)
+{
+	const Encoding encodings[] = { Encoding::TrueColor32, Encoding::TrueColor24, Encoding::TrueColor16, Encoding::Grayscale8, Encoding::Grayscale16, Encoding::ColorMapped8 };
+	const unsigned char origins[] = { 0, TopToBottom, RightToLeft, TopToBottom | RightToLeft };
+
+	// Odd widths leave a few pixels after the four at a time SSSE3 swizzle.
+	const Image images[] = { CreateImage(1, 1, 1), CreateImage(37, 19, 2), CreateImage(64, 48, 3) };
+	for (const Image& image : images)
+	{
+		for (Encoding encoding : encodings)
+		{
+			for (unsigned char origin : origins)
+			{
+				TGA_CHECK(CheckRoundTrip(image, encoding, false, origin));
+				TGA_CHECK(CheckRoundTrip(image, encoding, true, origin));
+			}
+		}
+	}
+}
+
+TGA_TEST(TgaLoader_RefusesTruncatedFiles)
+{
+	const Image image = CreateImage(16, 16, 4);
+	for (bool isRLE : { false, true })
+	{
+		const std::vector<unsigned char> file = Encode(image, Encoding::TrueColor32, isRLE, 0);
+		std::vector<uint32_t> pixels;
+		TGA_CHECK(DecodeChecked(file, 16, 16, pixels));
+
+		bool isAnyDecoded = false;
+		for (size_t size = 0; size < file.size(); size++)
+		{
+			const std::vector<unsigned char> truncated(file.begin(), file.begin() + size);
+			isAnyDecoded |= DecodeChecked(truncated, 16, 16, pixels);
+		}
+		TGA_CHECK(!isAnyDecoded);
+	}
+}
+
+TGA_TEST(TgaLoader_RefusesUnsupportedHeaders)
+{
+	std::vector<unsigned char> file = Encode(CreateImage(4, 4, 5), Encoding::TrueColor32, false, 0);
+	Tga32::TgaHeader header;
+	TGA_CHECK(Tga32::ReadHeader(file.data(), file.size(), header));
+	TGA_CHECK(!Tga32::ReadHeader(nullptr, file.size(), header));
+	TGA_CHECK(!Tga32::ReadHeader(file.data(), 17, header));
+
+	auto isRefused = [&](size_t anOffset, unsigned char aValue)
+	{
+		std::vector<unsigned char> changed = file;
+		changed[anOffset] = aValue;
+		return !Tga32::ReadHeader(changed.data(), changed.size(), header);
+	};
+	TGA_CHECK(isRefused(2, 0));
+	TGA_CHECK(isRefused(2, 32));
+	TGA_CHECK(isRefused(16, 12));
+	TGA_CHECK(isRefused(12, 0));
+	TGA_CHECK(isRefused(14, 0));
+
+	// Too small a row pitch.
+	std::vector<unsigned char> pixels(4 * 4 * 4);
+	TGA_CHECK(!Tga32::Decode(file.data(), file.size(), pixels.data(), 4 * 4 - 1));
+}
+
+TGA_TEST(TgaLoader_FuzzedFilesStayInsideTheDestination)
+{
+	const Encoding encodings[] = { Encoding::TrueColor32, Encoding::TrueColor24, Encoding::TrueColor16, Encoding::Grayscale16, Encoding::ColorMapped8 };
+	std::vector<std::vector<unsigned char>> seeds;
+	for (Encoding encoding : encodings)
+	{
+		seeds.push_back(Encode(CreateImage(23, 17, 6), encoding, false, TopToBottom));
+		seeds.push_back(Encode(CreateImage(23, 17, 7), encoding, true, RightToLeft));
+	}
+
+	// Random byte changes, header ones included, and random truncation. Nothing has to decode, but whatever the
+	// header says has to be all that is written.
+	std::mt19937 random(8);
+	std::vector<uint32_t> pixels;
+	for (int iteration = 0; iteration < 4000; iteration++)
+	{
+		std::vector<unsigned char> file = seeds[random() % seeds.size()];
+		const int changeCount = 1 + random() % 8;
+		for (int change = 0; change < changeCount; change++)
+		{
+			const size_t offset = random() % 4 == 0 ? random() % 18 : random() % file.size();
+			file[offset] = static_cast<unsigned char>(random());
+		}
+		if (random() % 4 == 0)
+		{
+			file.resize(random() % file.size());
+		}
+
+		Tga32::TgaHeader header;
+		if (!Tga32::ReadHeader(file.data(), file.size(), header) || static_cast<size_t>(header.myWidth) * header.myHeight > 1024 * 1024)
+		{
+			continue;
+		}
+		DecodeChecked(file, header.myWidth, header.myHeight, pixels);
+	}
+}
+
+TGA_BENCHMARK(TgaLoader_Decode4K)
+{
+	constexpr uint16_t Size = 4096;
+	const Image image = CreateImage(Size, Size, 9);
+	std::vector<unsigned char> destination(static_cast<size_t>(Size) * Size * 4);
+
+	auto benchmark = [&](const char* aName, Encoding anEncoding, bool anIsRLE)
+	{
+		const std::vector<unsigned char> file = Encode(image, anEncoding, anIsRLE, 0);
+		Tests::Benchmark(aName, [&]()
+		{
+			Tga32::Decode(file.data(), file.size(), destination.data(), static_cast<size_t>(Size) * 4);
+			Tests::DoNotOptimize(destination.data());
+		}, static_cast<size_t>(Size) * Size);
+	};
+
+	benchmark("32 bit", Encoding::TrueColor32, false);
+	benchmark("24 bit", Encoding::TrueColor24, false);
+	benchmark("16 bit", Encoding::TrueColor16, false);
+	benchmark("32 bit RLE", Encoding::TrueColor32, true);
+	benchmark("8 bit color mapped RLE", Encoding::ColorMapped8, true);
+}
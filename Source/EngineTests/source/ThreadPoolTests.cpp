@@ -0,0 +1,53 @@
+#include "TestFramework.h"
+
+#include <tge/util/ThreadPool.h>
+
+#include <atomic>
+#include <vector>
+
+using namespace Tga;
+
+namespace
+{
+	bool IsEachIndexRunOnce(ThreadPool& aPool, size_t aCount)
+	{
+		std::vector<std::atomic<int>> runs(aCount);
+		aPool.ParallelFor(aCount, [&](size_t anIndex)
+		{
+			runs[anIndex]++;
+		});
+
+		bool isEachRunOnce = true;
+		for (const std::atomic<int>& run : runs)
+		{
+			isEachRunOnce &= run.load() == 1;
+		}
+		return isEachRunOnce;
+	}
+}
+
+TGA_TEST(ThreadPool_ParallelForRunsEachIndexOnce)
+{
+	ThreadPool pool;
+	pool.Init(4);
+
+	TGA_CHECK(IsEachIndexRunOnce(pool, 0));
+	TGA_CHECK(IsEachIndexRunOnce(pool, 1));
+	TGA_CHECK(IsEachIndexRunOnce(pool, 3));
+	TGA_CHECK(IsEachIndexRunOnce(pool, 10000));
+
+	// Back to back calls, each one has to be done with its stack frame before the next reuses it.
+	bool isEachRunOnce = true;
+	for (int i = 0; i < 200; i++)
+	{
+		isEachRunOnce &= IsEachIndexRunOnce(pool, 17);
+	}
+	TGA_CHECK(isEachRunOnce);
+}
+
+TGA_TEST(ThreadPool_ParallelForWithoutWorkers)
+{
+	// Never started, everything runs on the calling thread.
+	ThreadPool pool;
+	TGA_CHECK(IsEachIndexRunOnce(pool, 100));
+}
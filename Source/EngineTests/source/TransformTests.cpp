@@ -0,0 +1,185 @@
+#include "TestFramework.h"
+
+#include <tge/animation/Animation.h>
+#include <tge/animation/AnimationPlayer.h>
+#include <tge/math/Transform.h>
+#include <tge/model/Model.h>
+
+#include <cmath>
+#include <memory>
+#include <random>
+#include <string>
+
+using namespace Tga;
+
+namespace
+{
+	bool IsNear(const Matrix4x4f& aFirst, const Matrix4x4f& aSecond, float aTolerance = 1e-4f)
+	{
+		for (int row = 1; row <= 4; row++)
+		{
+			for (int column = 1; column <= 4; column++)
+			{
+				if (std::fabs(aFirst(row, column) - aSecond(row, column)) > aTolerance)
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	Transform RandomTransform(std::mt19937& aRandom)
+	{
+		std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+		std::uniform_real_distribution<float> angle(-180.0f, 180.0f);
+		std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+		return Transform({ position(aRandom), position(aRandom), position(aRandom) }, Rotator(angle(aRandom), angle(aRandom), angle(aRandom)), { scale(aRandom), scale(aRandom), scale(aRandom) });
+	}
+
+	std::shared_ptr<Model> CreateBoxModel()
+	{
+		Model::MeshData meshData = {};
+		meshData.Bounds.Center = Vector3f::Zero;
+		meshData.Bounds.BoxExtents = { 50.0f, 50.0f, 50.0f };
+		meshData.Bounds.Radius = meshData.Bounds.BoxExtents.Length();
+
+		std::shared_ptr<Model> model = std::make_shared<Model>();
+		model->Init(meshData, L"Box");
+		return model;
+	}
+
+	constexpr size_t JointCount = MAX_ANIMATION_BONES;
+	constexpr unsigned int FrameCount = 60;
+
+	std::shared_ptr<Model> CreateSkinnedModel()
+	{
+		Skeleton skeleton;
+		skeleton.Joints.resize(JointCount);
+		for (size_t j = 0; j < JointCount; j++)
+		{
+			skeleton.Joints[j].Name = "Joint" + std::to_string(j);
+			skeleton.Joints[j].Parent = static_cast<int>(j) - 1;
+			skeleton.JointNameToIndex.insert({ skeleton.Joints[j].Name, j });
+			skeleton.JointName.push_back(skeleton.Joints[j].Name);
+		}
+
+		std::shared_ptr<Model> model = CreateBoxModel();
+		model->SetSkeleton(skeleton);
+		return model;
+	}
+
+	std::shared_ptr<Animation> CreateAnimation(std::mt19937& aRandom)
+	{
+		std::shared_ptr<Animation> animation = std::make_shared<Animation>();
+		animation->Length = FrameCount - 1;
+		animation->FramesPerSecond = 30.0f;
+		animation->Duration = animation->Length / animation->FramesPerSecond;
+		animation->Frames.resize(FrameCount);
+		for (Animation::Frame& frame : animation->Frames)
+		{
+			for (size_t j = 0; j < JointCount; j++)
+			{
+				frame.LocalTransforms.insert({ "Joint" + std::to_string(j), RandomTransform(aRandom) });
+			}
+		}
+		return animation;
+	}
+}
+
+TGA_TEST(Transform_AddRotationAppliesDeltaAfterCurrentRotation)
+{
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> angle(-180.0f, 180.0f);
+
+	for (int i = 0; i < 1000; i++)
+	{
+		Transform transform = RandomTransform(random);
+		const Rotator delta(angle(random), angle(random), angle(random));
+
+		const Matrix4x4f before = transform.GetMatrix(true);
+		const Matrix4x4f deltaMatrix = Transform(Vector3f::Zero, delta).GetMatrix(true);
+
+		transform.AddRotation(delta);
+		const Matrix4x4f after = transform.GetMatrix(true);
+
+		// Row vectors, so applying the delta after the current rotation multiplies on the right.
+		Matrix4x4f expectedMatrix = before * deltaMatrix;
+		expectedMatrix(4, 1) = before(4, 1);
+		expectedMatrix(4, 2) = before(4, 2);
+		expectedMatrix(4, 3) = before(4, 3);
+		TGA_CHECK(IsNear(after, expectedMatrix));
+
+		const Quatf& rotation = transform.GetQuaternion();
+		TGA_CHECK(std::fabs(rotation.W * rotation.W + rotation.X * rotation.X + rotation.Y * rotation.Y + rotation.Z * rotation.Z - 1.0f) < 1e-5f);
+	}
+}
+
+TGA_TEST(Transform_AddRotationKeepsPositionAndScale)
+{
+	Transform transform({ 1.0f, 2.0f, 3.0f }, Rotator(10.0f, 20.0f, 30.0f), { 2.0f, 3.0f, 4.0f });
+	transform.AddRotation(Rotator(0.0f, 90.0f, 0.0f));
+
+	TGA_CHECK(transform.GetPosition() == Vector3f(1.0f, 2.0f, 3.0f));
+	TGA_CHECK(transform.GetScale() == Vector3f(2.0f, 3.0f, 4.0f));
+}
+
+TGA_TEST(Transform_AddRotationAccumulatesWithoutDrift)
+{
+	// A full turn in one degree steps lands back where it started.
+	Transform transform(Vector3f::Zero, Rotator(30.0f, 45.0f, 60.0f));
+	const Matrix4x4f start = transform.GetMatrix();
+	for (int i = 0; i < 360; i++)
+	{
+		transform.AddRotation(Rotator(0.0f, 1.0f, 0.0f));
+	}
+	TGA_CHECK(IsNear(transform.GetMatrix(), start, 1e-3f));
+}
+
+TGA_BENCHMARK(Transform_GetMatrix)
+{
+	constexpr size_t TransformCount = 64 * 1024;
+	std::mt19937 random(2);
+
+	std::vector<Transform> transforms;
+	for (size_t i = 0; i < TransformCount; i++)
+	{
+		transforms.push_back(RandomTransform(random));
+	}
+	std::vector<Matrix4x4f> matrices(TransformCount);
+
+	Tests::Benchmark("GetMatrix", [&]()
+	{
+		for (size_t i = 0; i < TransformCount; i++)
+		{
+			matrices[i] = transforms[i].GetMatrix();
+		}
+		Tests::DoNotOptimize(matrices.data());
+	}, TransformCount);
+}
+
+TGA_BENCHMARK(AnimationPlayer_Update)
+{
+	std::mt19937 random(3);
+	std::shared_ptr<Model> model = CreateSkinnedModel();
+	std::shared_ptr<Animation> animation = CreateAnimation(random);
+
+	AnimationPlayer player;
+	player.Init(animation, model);
+	player.SetIsLooping(true);
+
+	player.SetIsInterpolating(true);
+	player.Play();
+	Tests::Benchmark("interpolated, 64 joints", [&]()
+	{
+		player.Update(1.0f / 60.0f);
+		Tests::DoNotOptimize(&player.GetLocalSpacePose());
+	}, JointCount);
+
+	player.SetIsInterpolating(false);
+	Tests::Benchmark("nearest frame, 64 joints", [&]()
+	{
+		player.Update(1.0f / 60.0f);
+		Tests::DoNotOptimize(&player.GetLocalSpacePose());
+	}, JointCount);
+}
@@ -0,0 +1,225 @@
+#include "TestFramework.h"
+#include "TestFiles.h"
+
+#include <tge/filesystem/FileView.h>
+#include <tge/filesystem/PackWriter.h>
+#include <tge/filesystem/VirtualFileSystem.h>
+#include <tge/filewatcher/FileWatcher.h>
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <thread>
+
+using namespace Tga;
+namespace fs = std::filesystem;
+
+namespace
+{
+	std::string Read(VirtualFileSystem& aFileSystem, const std::string& aPath)
+	{
+		FileView file;
+		if (!aFileSystem.Open(aPath, file))
+		{
+			return "<missing>";
+		}
+		return std::string(reinterpret_cast<const char*>(file.GetData()), file.GetSize());
+	}
+
+	bool Pack(const std::string& aDirectory, const std::string& aPackPath)
+	{
+		PackWriterReport report;
+		return PackWriter::PackDirectory(fs::u8path(aDirectory).wstring(), fs::u8path(aPackPath).wstring(), PackWriterSettings(), report);
+	}
+
+	// Flushes the watcher until aCondition holds, the operating system reports changes a while after they happen.
+	bool FlushUntil(FileWatcher& aFileWatcher, const std::function<bool()>& aCondition)
+	{
+		const std::chrono::steady_clock::time_point timeout = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (std::chrono::steady_clock::now() < timeout)
+		{
+			aFileWatcher.FlushChanges();
+			if (aCondition())
+			{
+				return true;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		return false;
+	}
+}
+
+TGA_TEST(VirtualFileSystem_MakeKeyNormalizes)
+{
+	TGA_CHECK(VirtualFileSystem::MakeKey("Sprites\\Logo.DDS") == "sprites/logo.dds");
+	TGA_CHECK(VirtualFileSystem::MakeKey("./a//b/./c/") == "a/b/c");
+	TGA_CHECK(VirtualFileSystem::MakeKey("a/b/../c") == "a/c");
+	TGA_CHECK(VirtualFileSystem::MakeKey("a/b/../../c") == "c");
+	TGA_CHECK(VirtualFileSystem::MakeKey("") == "");
+	TGA_CHECK(VirtualFileSystem::MakeKey(".") == "");
+	TGA_CHECK(VirtualFileSystem::MakeKey("a/..") == "");
+
+	// Relative paths can climb out of the working directory, so leading .. are kept.
+	TGA_CHECK(VirtualFileSystem::MakeKey("../a") == "../a");
+	TGA_CHECK(VirtualFileSystem::MakeKey("a/../../b") == "../b");
+	TGA_CHECK(VirtualFileSystem::MakeKey("../../a/../b") == "../../b");
+
+	// Absolute paths can't, and keep their root.
+	TGA_CHECK(VirtualFileSystem::MakeKey("C:\\Data\\..\\Sprites") == "c:/sprites");
+	TGA_CHECK(VirtualFileSystem::MakeKey("c:/../a") == "c:/a");
+	TGA_CHECK(VirtualFileSystem::MakeKey("/a/../../b") == "/b");
+	TGA_CHECK(VirtualFileSystem::MakeKey("\\\\A") == "/a");
+}
+
+TGA_TEST(VirtualFileSystem_IndexAnswersUnderMountedRoot)
+{
+	Tests::TempDirectory directory("VirtualFileSystem_Index");
+	const std::string root = directory.GetPath("Assets");
+	TGA_CHECK(Tests::WriteFile(root + "/Logo.dds", "logo"));
+	TGA_CHECK(Tests::WriteFile(root + "/Text/Arial.ttf", "arial"));
+
+	VirtualFileSystem fileSystem;
+	fileSystem.MountDirectory(root);
+
+	TGA_CHECK(fileSystem.Exists(root + "/Logo.dds"));
+	TGA_CHECK(fileSystem.Exists(root + "/LOGO.DDS"));
+	TGA_CHECK(fileSystem.Exists(root + "\\text\\..\\logo.dds"));
+	TGA_CHECK(fileSystem.Exists(root + "/Text"));
+	TGA_CHECK(fileSystem.Exists(root + "/text/arial.ttf"));
+	TGA_CHECK(!fileSystem.Exists(root + "/arial.ttf"));
+	TGA_CHECK(Read(fileSystem, root + "/Text/Arial.ttf") == "arial");
+	TGA_CHECK(Read(fileSystem, root + "/Missing.dds") == "<missing>");
+
+	// Nothing watches the root, so the index doesn't know about changes on disk.
+	TGA_CHECK(Tests::WriteFile(root + "/Added.dds", "added"));
+	std::error_code error;
+	fs::remove(fs::u8path(root + "/Logo.dds"), error);
+	TGA_CHECK(!fileSystem.Exists(root + "/Added.dds"));
+	TGA_CHECK(fileSystem.Exists(root + "/Logo.dds"));
+
+	// Mounting a directory under the root again changes nothing.
+	fileSystem.MountDirectory(root + "/Text");
+	TGA_CHECK(!fileSystem.Exists(root + "/Added.dds"));
+}
+
+TGA_TEST(VirtualFileSystem_ChecksDiskOutsideMountedRoots)
+{
+	Tests::TempDirectory directory("VirtualFileSystem_Disk");
+	const std::string root = directory.GetPath("Assets");
+	const std::string outside = directory.GetPath("Outside/File.txt");
+	TGA_CHECK(Tests::WriteFile(root + "/File.txt", "inside"));
+	TGA_CHECK(Tests::WriteFile(outside, "outside"));
+
+	VirtualFileSystem fileSystem;
+	fileSystem.MountDirectory(root);
+
+	TGA_CHECK(fileSystem.Exists(outside));
+	TGA_CHECK(Read(fileSystem, outside) == "outside");
+
+	// A hit outside the roots isn't remembered, nothing would tell the index when the file goes away.
+	std::error_code error;
+	fs::remove(fs::u8path(outside), error);
+	TGA_CHECK(!fileSystem.Exists(outside));
+	TGA_CHECK(Read(fileSystem, outside) == "<missing>");
+
+	TGA_CHECK(Tests::WriteFile(outside, "back"));
+	TGA_CHECK(fileSystem.Exists(outside));
+	TGA_CHECK(Read(fileSystem, outside) == "back");
+}
+
+TGA_TEST(VirtualFileSystem_LooseFilesOverridePacks)
+{
+	Tests::TempDirectory directory("VirtualFileSystem_Packs");
+	const std::string root = directory.GetPath("Assets");
+	const std::string firstPack = directory.GetPath("First.tgepack");
+	const std::string secondPack = directory.GetPath("Second.tgepack");
+
+	TGA_CHECK(Tests::WriteFile(directory.GetPath("FirstSource/Shared.txt"), "first"));
+	TGA_CHECK(Tests::WriteFile(directory.GetPath("FirstSource/Sub/Packed.txt"), "packed"));
+	TGA_CHECK(Tests::WriteFile(directory.GetPath("FirstSource/Edited.txt"), "stale"));
+	TGA_CHECK(Pack(directory.GetPath("FirstSource"), firstPack));
+	TGA_CHECK(Tests::WriteFile(directory.GetPath("SecondSource/Shared.txt"), "second"));
+	TGA_CHECK(Pack(directory.GetPath("SecondSource"), secondPack));
+
+	TGA_CHECK(Tests::WriteFile(root + "/Edited.txt", "edited"));
+
+	VirtualFileSystem fileSystem;
+	fileSystem.MountDirectory(root);
+	TGA_CHECK(fileSystem.MountPack(firstPack, root));
+	TGA_CHECK(fileSystem.MountPack(secondPack, root));
+	TGA_CHECK(!fileSystem.MountPack(directory.GetPath("Missing.tgepack"), root));
+
+	// Packed files show up as if they were loose files under the root.
+	TGA_CHECK(fileSystem.Exists(root + "/SUB/packed.txt"));
+	TGA_CHECK(Read(fileSystem, root + "/Sub/Packed.txt") == "packed");
+
+	// Later packs win over earlier ones, loose files over every pack.
+	TGA_CHECK(Read(fileSystem, root + "/Shared.txt") == "second");
+	TGA_CHECK(Read(fileSystem, root + "/Edited.txt") == "edited");
+
+	// Paths only match a pack under the directory it is mounted as.
+	TGA_CHECK(!fileSystem.Exists(directory.GetPath("Sub/Packed.txt")));
+}
+
+TGA_TEST(VirtualFileSystem_OpensEmptyFiles)
+{
+	Tests::TempDirectory directory("VirtualFileSystem_Empty");
+	const std::string root = directory.GetPath("Assets");
+	const std::string pack = directory.GetPath("Empty.tgepack");
+	TGA_CHECK(Tests::WriteFile(root + "/Loose.txt", ""));
+	TGA_CHECK(Tests::WriteFile(directory.GetPath("Source/Packed.txt"), ""));
+	TGA_CHECK(Pack(directory.GetPath("Source"), pack));
+
+	VirtualFileSystem fileSystem;
+	fileSystem.MountDirectory(root);
+	TGA_CHECK(fileSystem.MountPack(pack, root));
+
+	// Empty files are there, they just have nothing in them.
+	FileView file;
+	TGA_CHECK(fileSystem.Open(root + "/Loose.txt", file));
+	TGA_CHECK(file.IsOpen());
+	TGA_CHECK(file.GetSize() == 0);
+	TGA_CHECK(fileSystem.Open(root + "/Packed.txt", file));
+	TGA_CHECK(file.IsOpen());
+	TGA_CHECK(file.GetSize() == 0);
+
+	file.Close();
+	TGA_CHECK(!file.IsOpen());
+	TGA_CHECK(!fileSystem.Open(root + "/Missing.txt", file));
+	TGA_CHECK(!file.IsOpen());
+}
+
+TGA_TEST(VirtualFileSystem_WatcherKeepsIndexUpToDate)
+{
+	Tests::TempDirectory directory("VirtualFileSystem_Watch");
+	const std::string root = directory.GetPath("Assets");
+	TGA_CHECK(Tests::WriteFile(root + "/Old.txt", "old"));
+	TGA_CHECK(Tests::WriteFile(root + "/Gone/Inside.txt", "inside"));
+
+	VirtualFileSystem fileSystem;
+	fileSystem.MountDirectory(root);
+	FileWatcher fileWatcher;
+	fileSystem.WatchForChanges(fileWatcher);
+
+	TGA_CHECK(Tests::WriteFile(root + "/New.txt", "new"));
+	TGA_CHECK(FlushUntil(fileWatcher, [&]() { return fileSystem.Exists(root + "/New.txt"); }));
+	TGA_CHECK(Read(fileSystem, root + "/New.txt") == "new");
+
+	std::error_code error;
+	fs::remove(fs::u8path(root + "/Old.txt"), error);
+	TGA_CHECK(FlushUntil(fileWatcher, [&]() { return !fileSystem.Exists(root + "/Old.txt"); }));
+
+	// Removed directories take their files with them, added ones are indexed with theirs.
+	fs::remove_all(fs::u8path(root + "/Gone"), error);
+	TGA_CHECK(FlushUntil(fileWatcher, [&]() { return !fileSystem.Exists(root + "/Gone"); }));
+	TGA_CHECK(!fileSystem.Exists(root + "/Gone/Inside.txt"));
+
+	fs::create_directories(fs::u8path(root + "/Added/Deeper"), error);
+	TGA_CHECK(Tests::WriteFile(root + "/Added/Deeper/File.txt", "deeper"));
+	TGA_CHECK(FlushUntil(fileWatcher, [&]() { return fileSystem.Exists(root + "/Added/Deeper/File.txt"); }));
+
+	// Files added to the new directory later are picked up through its own watch.
+	TGA_CHECK(Tests::WriteFile(root + "/Added/Later.txt", "later"));
+	TGA_CHECK(FlushUntil(fileWatcher, [&]() { return fileSystem.Exists(root + "/Added/Later.txt"); }));
+}
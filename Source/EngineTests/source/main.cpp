@@ -0,0 +1,92 @@
+#include "TestFramework.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	int ourFailureCount = 0;
+	volatile const void* ourOptimizerSink = nullptr;
+
+	void PrintUsage()
+	{
+		printf("Runs the engine tests.\n\n");
+		printf("EngineTests [--bench] [<filter>]\n\n");
+		printf("  --bench   Runs the benchmarks instead of the tests.\n");
+		printf("  <filter>  Only runs the cases whose name contains this.\n");
+	}
+}
+
+std::vector<Tga::Tests::TestCase>& Tga::Tests::GetTestCases()
+{
+	// A function local, so registrars in other files can't run before it exists.
+	static std::vector<TestCase> testCases;
+	return testCases;
+}
+
+void Tga::Tests::ReportFailure(const char* aFile, int aLine, const char* anExpression)
+{
+	printf("  %s(%i): check failed: %s\n", aFile, aLine, anExpression);
+	ourFailureCount++;
+}
+
+void Tga::Tests::DoNotOptimize(const void* aValue)
+{
+	ourOptimizerSink = aValue;
+}
+
+void Tga::Tests::PrintBenchmark(const char* aName, double aNanoseconds, size_t anItemCount)
+{
+	if (anItemCount > 1)
+	{
+		printf("  %-48s %12.1f us %10.2f ns/item\n", aName, aNanoseconds / 1000.0, aNanoseconds / static_cast<double>(anItemCount));
+	}
+	else
+	{
+		printf("  %-48s %12.1f us\n", aName, aNanoseconds / 1000.0);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	bool runBenchmarks = false;
+	const char* filter = nullptr;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--bench") == 0)
+		{
+			runBenchmarks = true;
+		}
+		else if (argv[i][0] == '-')
+		{
+			PrintUsage();
+			return 1;
+		}
+		else
+		{
+			filter = argv[i];
+		}
+	}
+
+	int failedCases = 0;
+	int runCases = 0;
+	for (const Tga::Tests::TestCase& testCase : Tga::Tests::GetTestCases())
+	{
+		if (testCase.IsBenchmark != runBenchmarks || (filter && !strstr(testCase.Name, filter)))
+		{
+			continue;
+		}
+
+		printf("%s\n", testCase.Name);
+		const int failuresBefore = ourFailureCount;
+		testCase.Function();
+		runCases++;
+		if (ourFailureCount != failuresBefore)
+		{
+			failedCases++;
+		}
+	}
+
+	printf("\n%i of %i %s passed\n", runCases - failedCases, runCases, runBenchmarks ? "benchmarks" : "tests");
+	return failedCases == 0 ? 0 : 1;
+}
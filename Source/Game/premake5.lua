@@ -16,6 +16,8 @@ include "../../Premake/common.lua"
 
 include (dirs.external)
 include (dirs.engine)
+include (dirs.asset_packer)
+include (dirs.engine_tests)
 
 
 -------------------------------------------------------------
@@ -64,7 +64,7 @@ void AABB2D::DebugDraw()
 	Tga::LineDrawer& dbg = Tga::Engine::GetInstance()->GetGraphicsEngine().GetLineDrawer();
 	for (int i = 0; i < 4; i++)
 	{
-		dbg.Draw(Sides[i]);
+		dbg.Submit(Sides[i]);
 	}
 }
 
@@ -16,28 +16,39 @@ GameObject::~GameObject()
 
 void GameObject::Init(std::string aFileName)
 {
-	if (Tga::Engine::GetInstance()->GetTextureManager().GetTexture(Tga::Settings::ResolveEngineAssetPathW("Sprites/"+aFileName+".png").c_str()))
-	{
-		mySharedData.myTexture= Tga::Engine::GetInstance()->GetTextureManager().GetTexture(Tga::Settings::ResolveEngineAssetPathW("Sprites/" + aFileName + ".png").c_str());
-	}
-	else
-	{
-		std::cout << "Inputed sprite does not exist, defualt is used" << std::endl;
-		mySharedData.myTexture = Tga::Engine::GetInstance()->GetTextureManager().GetTexture(Tga::Settings::ResolveEngineAssetPathW("hej").c_str());
-	}
-	mySpriteInstance.mySize = mySharedData.myTexture->CalculateTextureSize();
+	// Loaded on the I/O threads, the sprite shows the white square until it is uploaded and the error texture if the
+	// file doesn't exist. The size is only known after that, see ApplyTextureSize.
+	Tga::TextureManager& textureManager = Tga::Engine::GetInstance()->GetTextureManager();
+	myTexture = textureManager.RequestTexture(Tga::Settings::ResolveEngineAssetPathW("Sprites/" + aFileName + ".png").c_str());
+	mySharedData.myTexture = myTexture.Get();
+	mySpriteInstance.mySize = { 0.0f, 0.0f };
 	mySpriteInstance.myPivot = { 0.5,0.5 };
-	myScale = mySharedData.myTexture->CalculateTextureSize();
 	mySpriteInstance.myPosition.x = myPos.x;
 	mySpriteInstance.myPosition.y = myPos.y;
-	Tga::Engine::GetInstance()->GetWindowSize().y;
 	myHitbox = std::make_shared<Hitbox>();
-	myHitbox->Init({ myPos.x,myPos.y }, myScale.x);
+	myHitbox->Init({ myPos.x,myPos.y }, 0.0f);
 	myHitbox->ChangeColor(1, 0, 0);
+	myIsWaitingForTexture = true;
+	ApplyTextureSize();
+}
+
+void GameObject::ApplyTextureSize()
+{
+	if (!myIsWaitingForTexture || Tga::Engine::GetInstance()->GetTextureManager().IsStreaming(myTexture.Get()))
+	{
+		return;
+	}
+
+	// The image size is the full texture even when only some of its mips are loaded.
+	myIsWaitingForTexture = false;
+	myScale = Tga::Vector2f(static_cast<float>(myTexture->myImageSize.x), static_cast<float>(myTexture->myImageSize.y));
+	SetScale(mySizeScale);
+	myHitbox->Init({ myPos.x,myPos.y }, myScale.x);
 }
 
 void GameObject::Update(float aDeltaTime)
 {
+	ApplyTextureSize();
 	mySpriteInstance.myPosition.x = myPos.x;
 	mySpriteInstance.myPosition.y = myPos.y;
 	myHitbox->UpdatePos({ myPos.x,myPos.y });
@@ -66,7 +77,8 @@ int GameObject::GetID()
 
 void GameObject::Render(Tga::SpriteDrawer& aDrawer)
 {
-	aDrawer.Draw(mySharedData, mySpriteInstance);
+	ApplyTextureSize();
+	aDrawer.Submit(mySharedData, mySpriteInstance);
 	if (myHitbox)
 	{
 		myHitbox->DebugDraw();
@@ -75,6 +87,7 @@ void GameObject::Render(Tga::SpriteDrawer& aDrawer)
 
 void GameObject::SetScale(float aScale)
 {
+	mySizeScale = aScale;
 	if (aScale>=0&& aScale<=1)
 	{
 
@@ -2,6 +2,7 @@
 #include <tge/sprite/sprite.h>
 #include <tge/graphics/GraphicsEngine.h>
 #include <tge/drawers/SpriteDrawer.h>
+#include <tge/texture/TextureHandle.h>
 #include "Hitbox.h"
 #include "tge\math\Vector.h"
 #include "..\..\Source\Game\source\GlobalGameObjectID.h"
@@ -22,10 +23,16 @@ public:
 	void SetScale(float aScaleX);
 	std::shared_ptr<Hitbox> GetHitBox();
 private:
+	// Sets the sprite and hitbox size once the texture is uploaded.
+	void ApplyTextureSize();
+
 	int myID;
 	Tga::Vector2f myScale;
 	Tga::Sprite2DInstanceData mySpriteInstance;
 	Tga::SpriteSharedData mySharedData;
+	Tga::TextureHandle myTexture;
+	float mySizeScale = 1.0f;
+	bool myIsWaitingForTexture = false;
 	Tga::Vector3f myPos;
 	std::shared_ptr<Hitbox> myHitbox;
 
@@ -13,6 +13,8 @@ public:
 	bool HasGameObjectCollided();
 	std::vector<int> GetCollidedGameObjects();
 	std::vector<int> GetPreviousGameObjects() { return PreviousHitID; }
+	// Drops every game object, must be called before the engine shuts down since they hold textures.
+	void Clear() { myGameObjects.clear(); }
 	void InitHitBoxCommand() { PreviousHitID.push_back(0); PreviousHitID.push_back(0); return; }
 	
 private:
@@ -13,12 +13,17 @@
 
 #include "ScriptGraphEditor/ScriptGraphEditor.h"
 #include "GameObjectRegistery.h"
+#include "ParticleEffectRegistery.h"
 
 GameWorld::GameWorld()
 {}
 
 GameWorld::~GameWorld() 
-{}
+{
+	// The registries outlive the engine, so their textures are released here while the texture manager still exists.
+	ParticleEffectRegistery::Get().Clear();
+	GameObjectRegistery::Get().Clear();
+}
 
 void GameWorld::Init()  
 {
@@ -43,6 +48,7 @@ void GameWorld::Update(float aTimeDelta)
 {
 	UNREFERENCED_PARAMETER(aTimeDelta);
 	myScriptGraphEditor->Update(aTimeDelta);
+	ParticleEffectRegistery::Get().Update(aTimeDelta);
 }
 
 void GameWorld::Render()
@@ -51,11 +57,16 @@ void GameWorld::Render()
 	Tga::SpriteDrawer& spriteDrawer(engine.GetGraphicsEngine().GetSpriteDrawer());
 	// Game update
 	{
-		spriteDrawer.Draw(mySharedData, myTGELogoInstance);
+		// The logo is the background, so it goes on a lower layer than the game objects.
+		spriteDrawer.Submit(mySharedData, myTGELogoInstance, -1);
 		for (size_t i = 0; i < GameObjectRegistery::Get().GetAllGameObject().size(); i++)
 		{
 			GameObjectRegistery::Get().GetAllGameObject()[i]->Render(spriteDrawer);
 		}
+		spriteDrawer.FlushQueue();
+
+		// Particles write straight into the instance buffer, so they draw after the queued sprites.
+		ParticleEffectRegistery::Get().Render();
 	}
 
 	// Debug draw pivot
@@ -0,0 +1,47 @@
+#include "ParticleEffectRegistery.h"
+#include <iostream>
+#include <tge/engine.h>
+#include <tge/graphics/GraphicsEngine.h>
+#include <tge/drawers/SpriteDrawer.h>
+#include <tge/texture/TextureManager.h>
+#include <tge/settings/settings.h>
+
+int ParticleEffectRegistery::CreateEmitter(const std::string& aSpriteName, const Tga::Vector2f& aPosition, float aSpawnRate)
+{
+	// Emitters only keep the texture pointer, the handle here keeps it loaded for as long as the emitters may use it.
+	Tga::TextureHandle& texture = myTextures[aSpriteName];
+	if (!texture)
+	{
+		texture = Tga::Engine::GetInstance()->GetTextureManager().AcquireTexture(Tga::Settings::ResolveEngineAssetPathW("Sprites/" + aSpriteName + ".png").c_str());
+	}
+	if (!texture)
+	{
+		std::cout << "Inputed sprite does not exist, defualt is used" << std::endl;
+	}
+
+	Tga::SpriteSharedData sharedData;
+	sharedData.myTexture = texture.Get();
+
+	Tga::ParticleEmitterSettings settings;
+	settings.SpawnRate = aSpawnRate;
+	settings.MaxParticles = aSpawnRate > 0.0f ? static_cast<size_t>(aSpawnRate * settings.LifetimeMax) + 1 : 10000;
+	settings.Gravity = { 0.0f, -100.0f };
+
+	return myParticleSystem.CreateEmitter(settings, sharedData, aPosition);
+}
+
+void ParticleEffectRegistery::Clear()
+{
+	myParticleSystem.Clear();
+	myTextures.clear();
+}
+
+void ParticleEffectRegistery::Update(float aTimeDelta)
+{
+	myParticleSystem.Update(aTimeDelta);
+}
+
+void ParticleEffectRegistery::Render()
+{
+	myParticleSystem.Render(Tga::Engine::GetInstance()->GetGraphicsEngine().GetSpriteDrawer());
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <tge/particles/ParticleSystem.h>
+#include <tge/texture/TextureHandle.h>
+class ParticleEffectRegistery
+{
+public:
+	~ParticleEffectRegistery() = default;
+	static ParticleEffectRegistery& Get() { static ParticleEffectRegistery myInstance; return myInstance; }
+
+	// Creates an emitter using Sprites/<aSpriteName>.png, returns its ID.
+	int CreateEmitter(const std::string& aSpriteName, const Tga::Vector2f& aPosition, float aSpawnRate);
+	Tga::ParticleSystem& GetParticleSystem() { return myParticleSystem; }
+
+	// Removes every emitter and lets go of their textures, must be called before the engine shuts down.
+	void Clear();
+
+	void Update(float aTimeDelta);
+	void Render();
+
+private:
+	Tga::ParticleSystem myParticleSystem;
+	std::unordered_map<std::string, Tga::TextureHandle> myTextures;
+};
@@ -209,3 +209,76 @@ void SGNode_OnTriggerExit::Init()
 	CreateDataPin<int>("Source ID", PinDirection::Output);
 	CreateDataPin<int>("Target ID", PinDirection::Output);
 }
+
+void SGNode_SpawnParticleEmitter::Init()
+{
+	CreateExecPin("In", PinDirection::Input, true);
+	CreateExecPin("Out", PinDirection::Output, true);
+
+	CreateDataPin<std::string>("SpriteName", PinDirection::Input);
+	CreateDataPin<float>("X", PinDirection::Input);
+	CreateDataPin<float>("Y", PinDirection::Input);
+	CreateDataPin<float>("Rate", PinDirection::Input);
+	CreateDataPin<int>("ID", PinDirection::Output);
+}
+
+size_t SGNode_SpawnParticleEmitter::DoOperation()
+{
+	std::string spriteName;
+	float x = 0;
+	float y = 0;
+	float rate = 0;
+	GetPinData("SpriteName", spriteName);
+	GetPinData("X", x);
+	GetPinData("Y", y);
+	GetPinData("Rate", rate);
+
+	const int ID = ParticleEffectRegistery::Get().CreateEmitter(spriteName, { x, y }, rate);
+	SetPinData("ID", ID);
+	return ExitViaPin("Out");
+}
+
+void SGNode_ParticleBurst::Init()
+{
+	CreateExecPin("In", PinDirection::Input, true);
+	CreateExecPin("Out", PinDirection::Output, true);
+
+	CreateDataPin<int>("ID", PinDirection::Input);
+	CreateDataPin<int>("Count", PinDirection::Input);
+}
+
+size_t SGNode_ParticleBurst::DoOperation()
+{
+	int ID = 0;
+	int count = 0;
+	GetPinData("ID", ID);
+	GetPinData("Count", count);
+
+	if (count > 0 && ParticleEffectRegistery::Get().GetParticleSystem().Burst(ID, static_cast<size_t>(count)))
+	{
+		return ExitViaPin("Out");
+	}
+	std::cout << "Emitter does not exist" << std::endl;
+	return -1;
+}
+
+void SGNode_StopParticleEmitter::Init()
+{
+	CreateExecPin("In", PinDirection::Input, true);
+	CreateExecPin("Out", PinDirection::Output, true);
+
+	CreateDataPin<int>("ID", PinDirection::Input);
+}
+
+size_t SGNode_StopParticleEmitter::DoOperation()
+{
+	int ID = 0;
+	GetPinData("ID", ID);
+
+	if (ParticleEffectRegistery::Get().GetParticleSystem().Stop(ID))
+	{
+		return ExitViaPin("Out");
+	}
+	std::cout << "Emitter does not exist" << std::endl;
+	return -1;
+}
@@ -3,6 +3,7 @@
 #include <string>
 #include "ScriptGraph/ScriptGraphNode.h"
 #include "GameObjectRegistery.h"
+#include "ParticleEffectRegistery.h"
 #include <memory>
 #include "CommonUtilities\InputHandler.h"
 #include <ScriptGraph/Nodes/Events/SGNode_EventBase.h>
@@ -117,3 +118,35 @@ public:
 	std::string GetNodeCategory() const override { return "Event"; }
 };
 
+BeginScriptGraphNode(SGNode_SpawnParticleEmitter)
+{
+public:
+	void Init() override;
+	std::string GetNodeTitle()const override { return "SpawnEmitter"; }
+	std::string GetDescription()const override { return "Creates a particle emitter and returns its ID"; }
+	std::string GetNodeCategory()const override { return "Particles"; }
+	size_t DoOperation()override;
+	bool IsSimpleNode()const override { return false; }
+};
+
+BeginScriptGraphNode(SGNode_ParticleBurst)
+{
+public:
+	void Init() override;
+	std::string GetNodeTitle()const override { return "ParticleBurst"; }
+	std::string GetDescription()const override { return "Spawns a number of particles at once from an emitter"; }
+	std::string GetNodeCategory()const override { return "Particles"; }
+	size_t DoOperation()override;
+	bool IsSimpleNode()const override { return false; }
+};
+
+BeginScriptGraphNode(SGNode_StopParticleEmitter)
+{
+public:
+	void Init() override;
+	std::string GetNodeTitle()const override { return "StopEmitter"; }
+	std::string GetDescription()const override { return "Stops an emitter, it is removed once its particles have died"; }
+	std::string GetNodeCategory()const override { return "Particles"; }
+	size_t DoOperation()override;
+	bool IsSimpleNode()const override { return false; }
+};
@@ -32,6 +32,9 @@
 
 #include <DDSTextureLoader/DDSTextureLoader11.h>
 #include <tge/texture/texture.h>
+#include <tge/filesystem/FileView.h>
+#include <tge/filesystem/VirtualFileSystem.h>
+#include <tge/settings/settings.h>
 
 namespace ImNodeEd = ax::NodeEditor;
 
@@ -1288,9 +1291,14 @@ void ScriptGraphEditor::Render()
 		ImGui::SameLine();
 		if(ImGui::Button("Load"))
 		{
-			std::ifstream file("file.txt");
-			const std::string inGraph = std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
-			file.close();
+			// Through the file system like every other load, so a graph packed with the assets is found too.
+			std::string inGraph;
+			Tga::FileView file;
+			if (Tga::Settings::GetFileSystem().Open("file.txt", file))
+			{
+				inGraph.assign(reinterpret_cast<const char*>(file.GetData()), file.GetSize());
+			}
+			file.Close();
 
 			if(!inGraph.empty())
 			{